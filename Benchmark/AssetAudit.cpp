@@ -0,0 +1,420 @@
+//--------------------------------------------------------------------------------------
+// Report the GPU cost of every mesh and texture in the media folder
+//--------------------------------------------------------------------------------------
+// Standalone program, not part of RenderTexture.vcxproj. Build on Linux with the Makefile in this folder:
+//
+//     make AssetAudit       - builds this program (.x files only, the native reader)
+//     make ASSIMP=1 ...     - also builds the assimp importer, to audit the other mesh formats it reads
+//     make audit            - runs it on ../Media/ and writes AssetAudit.json
+//
+// Command line options:
+//     --out <file>      write JSON results to file (default is stdout, with the tables on stderr)
+//     --media <folder>  folder of meshes and textures to audit (default ../Media/)
+//     --tangents        import meshes with tangents, as for normal mapping
+//     --compact         pack meshes with the compact vertex profile (VertexProfile::Compact)
+//
+// Each mesh is imported exactly as the Mesh class imports it when there is no cooked file (ImportMesh,
+// MeshImport.h), so the numbers are those of the buffers the GPU would get:
+//     vertices, indices  - in the GPU buffers, the indices include every level of detail
+//     bytes_per_vertex   - size of one vertex in the chosen profile
+//     gpu_bytes          - all the mesh's GPU buffers (MeshGPUBytes, MeshImport.h), as Mesh::GPUBytes less
+//                          the constant buffer
+//     acmr               - average cache miss ratio of the full detail mesh (MeshOptimiser.h), the vertices
+//                          transformed per triangle. 0.5 is very good, 3 is the worst possible
+//     degenerate         - full detail triangles with two corners at the same position after packing, which
+//                          cost vertex work but draw nothing
+//     duplicate          - full detail triangles with the same positions and winding as an earlier one, which
+//                          draw the same pixels twice
+//
+// Only the header of each texture is read (TextureInfo.h) to find the texture LoadTexture would create:
+//     width, height, format, mips - as created, including mip levels the loader generates for PNG and JPEG
+//     vram_bytes                  - all the mip levels, an estimate as drivers add some padding
+//
+// The tables list the meshes and textures from most to least GPU memory. The program exits with 2 if any file
+// couldn't be read, so it can check a media folder as part of a build.
+
+#include "MeshData.h"
+#include "MeshImport.h"
+#include "MeshOptimiser.h"
+#include "MappedFile.h"
+#include "TextureInfo.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+
+
+/*-----------------------------------------------------------------------------------------
+    Settings
+-----------------------------------------------------------------------------------------*/
+
+// Folder of meshes and textures to audit
+std::string gMediaFolder = "../Media/";
+
+// How meshes are imported, as the arguments to the Mesh constructor
+bool          gRequireTangents = false;
+VertexProfile gProfile         = VertexProfile::Full;
+
+
+/*-----------------------------------------------------------------------------------------
+    Results
+-----------------------------------------------------------------------------------------*/
+
+struct MeshAudit
+{
+    std::string file;
+    std::string error;          // Empty if the mesh was imported
+    uint32_t    vertices        = 0;
+    uint32_t    indices         = 0;
+    uint32_t    triangles       = 0; // Full detail
+    uint32_t    bytesPerVertex  = 0;
+    uint32_t    indexSize       = 0;
+    uint32_t    lods            = 0;
+    uint32_t    meshlets        = 0;
+    size_t      gpuBytes        = 0;
+    float       acmr            = 0;
+    uint32_t    degenerate      = 0;
+    uint32_t    duplicate       = 0;
+};
+
+struct TextureAudit
+{
+    std::string file;
+    std::string error;          // Empty if the header was read
+    TextureInfo info;
+    size_t      vramBytes       = 0;
+};
+
+std::vector<MeshAudit>    gMeshes;
+std::vector<TextureAudit> gTextures;
+
+
+/*-----------------------------------------------------------------------------------------
+    Helpers
+-----------------------------------------------------------------------------------------*/
+
+// Lower case extension of a file name including the dot, empty if none
+std::string Extension(const std::string& name)
+{
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos)  return "";
+    std::string extension = name.substr(dot);
+    for (char& c : extension)  c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return extension;
+}
+
+bool IsMeshFile(const std::string& name)
+{
+    std::string extension = Extension(name);
+#if !defined(MESH_NO_ASSIMP)
+    const char* assimpTypes[] = { ".fbx", ".obj", ".3ds", ".dae", ".gltf", ".glb", ".ply", ".blend" };
+    for (const char* type : assimpTypes)
+    {
+        if (extension == type)  return true;
+    }
+#endif
+    return extension == ".x";
+}
+
+bool IsTextureFile(const std::string& name)
+{
+    std::string extension = Extension(name);
+    return extension == ".dds" || extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+}
+
+
+// Names of the files in the media folder the given function accepts, sorted
+std::vector<std::string> MediaFiles(bool (*accept)(const std::string&))
+{
+    std::vector<std::string> files;
+    DIR* dir = opendir(gMediaFolder.c_str());
+    if (dir == nullptr)  return files;
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (accept(name))  files.push_back(name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+
+// Text for a number of bytes in the tables, e.g. "1.25 MB"
+std::string ByteText(size_t bytes)
+{
+    char text[32];
+    if      (bytes >= 1024 * 1024)  std::snprintf(text, sizeof(text), "%.2f MB", bytes / (1024.0 * 1024.0));
+    else if (bytes >= 1024)         std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+    else                            std::snprintf(text, sizeof(text), "%zu B", bytes);
+    return text;
+}
+
+
+// Text as a JSON string. File names and error messages only need quotes and backslashes escaped
+std::string JSONString(const std::string& text)
+{
+    std::string result = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')  result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Meshes
+-----------------------------------------------------------------------------------------*/
+
+// Count the degenerate and duplicate triangles of the full detail mesh. The depth stream (MeshData.h) holds
+// each packed position once, so triangles are compared by their depth indices: two equal corners is a
+// degenerate triangle, and the same three corners in the same winding order is a duplicate
+void CountWastedTriangles(const MeshDataView& mesh, uint32_t numParts, MeshAudit& audit)
+{
+    struct Triangle
+    {
+        uint32_t corners[3];
+        bool operator<(const Triangle& other) const   { return std::lexicographical_compare(corners, corners + 3, other.corners, other.corners + 3); }
+        bool operator==(const Triangle& other) const  { return std::equal(corners, corners + 3, other.corners); }
+    };
+
+    const uint16_t* indices16 = static_cast<const uint16_t*>(mesh.depthIndices);
+    const uint32_t* indices32 = static_cast<const uint32_t*>(mesh.depthIndices);
+    std::vector<Triangle> triangles;
+    for (uint32_t s = 0; s < numParts; ++s)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[s];
+        for (uint32_t i = subMesh.startIndex; i + 2 < subMesh.startIndex + subMesh.numIndices; i += 3)
+        {
+            Triangle t;
+            for (uint32_t c = 0; c < 3; ++c)  t.corners[c] = (mesh.depthIndexSize == 2) ? indices16[i + c] : indices32[i + c];
+            if (t.corners[0] == t.corners[1] || t.corners[1] == t.corners[2] || t.corners[2] == t.corners[0])
+            {
+                ++audit.degenerate;
+                continue;
+            }
+
+            // Rotate the smallest corner first, which keeps the winding
+            std::rotate(t.corners, std::min_element(t.corners, t.corners + 3), t.corners + 3);
+            triangles.push_back(t);
+        }
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    for (size_t t = 1; t < triangles.size(); ++t)
+    {
+        if (triangles[t] == triangles[t - 1])  ++audit.duplicate;
+    }
+}
+
+
+void AuditMesh(const std::string& name)
+{
+    MeshAudit audit;
+    audit.file = name;
+
+    MappedFile file;
+    if (!file.Open(gMediaFolder + name))
+    {
+        audit.error = "cannot open file";
+        gMeshes.push_back(audit);
+        return;
+    }
+
+    PackedMesh packedMesh;
+    try
+    {
+        packedMesh = ImportMesh(gMediaFolder + name, file, gRequireTangents, gProfile);
+    }
+    catch (const std::runtime_error& e)
+    {
+        audit.error = e.what();
+        gMeshes.push_back(audit);
+        return;
+    }
+    MeshDataView mesh = packedMesh.View();
+
+    const uint32_t numParts = (mesh.numLODs > 0) ? mesh.lods[0].numSubMeshes : mesh.numSubMeshes;
+    audit.vertices       = mesh.numVertices;
+    audit.indices        = mesh.numIndices;
+    audit.bytesPerVertex = mesh.vertexSize;
+    audit.indexSize      = mesh.indexSize;
+    audit.lods           = mesh.numLODs;
+    audit.meshlets       = mesh.numMeshlets;
+    audit.gpuBytes       = MeshGPUBytes(mesh);
+    audit.acmr           = MeasureACMR(mesh, 0, numParts);
+    for (uint32_t s = 0; s < numParts; ++s)  audit.triangles += mesh.subMeshes[s].numIndices / 3;
+    CountWastedTriangles(mesh, numParts, audit);
+    gMeshes.push_back(audit);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Textures
+-----------------------------------------------------------------------------------------*/
+
+void AuditTexture(const std::string& name)
+{
+    TextureAudit audit;
+    audit.file = name;
+
+    MappedFile file;
+    if (!file.Open(gMediaFolder + name))            audit.error = "cannot open file";
+    else if (!ReadTextureInfo(file.Data(), file.Size(), audit.info))  audit.error = "not a DDS, PNG or JPEG file";
+    else if (audit.info.format == 0 || TextureFormatBits(audit.info.format) == 0)  audit.error = "format not supported by the loader";
+    else                                            audit.vramBytes = TextureBytes(audit.info);
+    gTextures.push_back(audit);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Output
+-----------------------------------------------------------------------------------------*/
+
+void WriteTables(FILE* file)
+{
+    std::vector<const MeshAudit*> meshes;
+    for (const MeshAudit& m : gMeshes)  meshes.push_back(&m);
+    std::stable_sort(meshes.begin(), meshes.end(), [](const MeshAudit* a, const MeshAudit* b) { return a->gpuBytes > b->gpuBytes; });
+
+    size_t totalMeshBytes = 0;
+    std::fprintf(file, "Meshes (%s vertex profile%s)\n", gProfile == VertexProfile::Compact ? "compact" : "full",
+                 gRequireTangents ? ", tangents" : "");
+    std::fprintf(file, "  %-28s %10s %10s %10s %6s %12s %6s %6s %6s\n",
+                 "file", "vertices", "indices", "triangles", "bytes", "gpu", "acmr", "degen", "dup");
+    for (const MeshAudit* m : meshes)
+    {
+        if (!m->error.empty())
+        {
+            std::fprintf(file, "  %-28s error: %s\n", m->file.c_str(), m->error.c_str());
+            continue;
+        }
+        std::fprintf(file, "  %-28s %10u %10u %10u %6u %12s %6.3f %6u %6u\n",
+                     m->file.c_str(), m->vertices, m->indices, m->triangles, m->bytesPerVertex, ByteText(m->gpuBytes).c_str(),
+                     m->acmr, m->degenerate, m->duplicate);
+        totalMeshBytes += m->gpuBytes;
+    }
+    std::fprintf(file, "  %-28s %52s\n\n", "total", ByteText(totalMeshBytes).c_str());
+
+    std::vector<const TextureAudit*> textures;
+    for (const TextureAudit& t : gTextures)  textures.push_back(&t);
+    std::stable_sort(textures.begin(), textures.end(), [](const TextureAudit* a, const TextureAudit* b) { return a->vramBytes > b->vramBytes; });
+
+    size_t totalTextureBytes = 0;
+    std::fprintf(file, "Textures\n");
+    std::fprintf(file, "  %-34s %6s %6s %-22s %5s %12s\n", "file", "width", "height", "format", "mips", "vram");
+    for (const TextureAudit* t : textures)
+    {
+        if (!t->error.empty())
+        {
+            std::fprintf(file, "  %-34s error: %s\n", t->file.c_str(), t->error.c_str());
+            continue;
+        }
+        std::fprintf(file, "  %-34s %6u %6u %-22s %4u%s %12s\n", t->file.c_str(), t->info.width, t->info.height,
+                     TextureFormatName(t->info.format), t->info.mipLevels, t->info.mipsGenerated ? "*" : " ",
+                     ByteText(t->vramBytes).c_str());
+        totalTextureBytes += t->vramBytes;
+    }
+    std::fprintf(file, "  %-34s %55s\n", "total", ByteText(totalTextureBytes).c_str());
+    std::fprintf(file, "  * mip levels generated by the loader\n\n");
+    std::fprintf(file, "Total GPU memory %s\n", ByteText(totalMeshBytes + totalTextureBytes).c_str());
+}
+
+
+void WriteJSON(FILE* file)
+{
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"profile\": \"%s\",\n", gProfile == VertexProfile::Compact ? "compact" : "full");
+    std::fprintf(file, "  \"tangents\": %s,\n", gRequireTangents ? "true" : "false");
+    std::fprintf(file, "  \"meshes\": [\n");
+    for (size_t i = 0; i < gMeshes.size(); ++i)
+    {
+        const MeshAudit& m = gMeshes[i];
+        const char* separator = (i + 1 < gMeshes.size()) ? "," : "";
+        if (!m.error.empty())
+        {
+            std::fprintf(file, "    { \"file\": %s, \"error\": %s }%s\n", JSONString(m.file).c_str(), JSONString(m.error).c_str(), separator);
+            continue;
+        }
+        std::fprintf(file, "    { \"file\": %s, \"vertices\": %u, \"indices\": %u, \"triangles\": %u, \"bytes_per_vertex\": %u, "
+                           "\"index_size\": %u, \"lods\": %u, \"meshlets\": %u, \"gpu_bytes\": %zu, \"acmr\": %.4f, "
+                           "\"degenerate\": %u, \"duplicate\": %u }%s\n",
+                     JSONString(m.file).c_str(), m.vertices, m.indices, m.triangles, m.bytesPerVertex, m.indexSize, m.lods,
+                     m.meshlets, m.gpuBytes, m.acmr, m.degenerate, m.duplicate, separator);
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"textures\": [\n");
+    for (size_t i = 0; i < gTextures.size(); ++i)
+    {
+        const TextureAudit& t = gTextures[i];
+        const char* separator = (i + 1 < gTextures.size()) ? "," : "";
+        if (!t.error.empty())
+        {
+            std::fprintf(file, "    { \"file\": %s, \"error\": %s }%s\n", JSONString(t.file).c_str(), JSONString(t.error).c_str(), separator);
+            continue;
+        }
+        std::fprintf(file, "    { \"file\": %s, \"container\": \"%s\", \"width\": %u, \"height\": %u, \"depth\": %u, \"array_size\": %u, "
+                           "\"format\": \"%s\", \"mips\": %u, \"mips_generated\": %s, \"vram_bytes\": %zu }%s\n",
+                     JSONString(t.file).c_str(), t.info.container, t.info.width, t.info.height, t.info.depth, t.info.arraySize,
+                     TextureFormatName(t.info.format), t.info.mipLevels, t.info.mipsGenerated ? "true" : "false", t.vramBytes, separator);
+    }
+    std::fprintf(file, "  ]\n");
+    std::fprintf(file, "}\n");
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Main
+-----------------------------------------------------------------------------------------*/
+
+int main(int argc, char* argv[])
+{
+    const char* outFile = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if      (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)    outFile = argv[++i];
+        else if (std::strcmp(argv[i], "--media") == 0 && i + 1 < argc)  gMediaFolder = std::string(argv[++i]) + "/";
+        else if (std::strcmp(argv[i], "--tangents") == 0)               gRequireTangents = true;
+        else if (std::strcmp(argv[i], "--compact") == 0)                gProfile = VertexProfile::Compact;
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--out file.json] [--media folder] [--tangents] [--compact]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (const std::string& name : MediaFiles(IsMeshFile))     AuditMesh(name);
+    for (const std::string& name : MediaFiles(IsTextureFile))  AuditTexture(name);
+
+    // The tables go to stdout unless it has the JSON
+    WriteTables(outFile != nullptr ? stdout : stderr);
+    if (outFile != nullptr)
+    {
+        FILE* file = std::fopen(outFile, "w");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", outFile);
+            return 1;
+        }
+        WriteJSON(file);
+        std::fclose(file);
+    }
+    else
+    {
+        WriteJSON(stdout);
+    }
+
+    bool failed = false;
+    for (const MeshAudit& m : gMeshes)        failed = failed || !m.error.empty();
+    for (const TextureAudit& t : gTextures)   failed = failed || !t.error.empty();
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,1013 @@
+//--------------------------------------------------------------------------------------
+// Microbenchmarks for the Math library
+//--------------------------------------------------------------------------------------
+// Standalone program, not part of RenderTexture.vcxproj. Build on Linux with the Makefile in this
+// folder, which compiles ../Math/*.cpp directly:
+//
+//     make              - builds MathBenchmark (SIMD backend picked by MathSIMD.h), MathBenchmarkScalar
+//                         (MATH_NO_SIMD) and MathBenchmarkFast (MATH_FAST_MATH) for comparison
+//     make run          - runs all three and writes MathBenchmark.json, MathBenchmarkScalar.json and
+//                         MathBenchmarkFast.json
+//     make codegen      - shows the code generated for inlined and out-of-line vector expressions (VectorChains.h)
+//
+// Command line options:
+//     --out <file>      write JSON results to file (default is stdout)
+//     --filter <text>   only run benchmarks whose name contains text
+//     --quick           shorter timing runs and smaller batch sizes (for a smoke test)
+//     --max-batch <n>   largest batch size used for the batch transform benchmarks (default 10000000)
+//
+// Before timing anything the program checks the accuracy of the approximate / lossy functions (FastMath.h,
+// Packing.h) against the maximum errors documented in their headers, and that each bulk (SIMD) version
+// gives the same results as the single value version. It also checks that the CMatrix4x4 multiply and inverse
+// match their scalar reference versions to the last bit, that the compile-time tangents and projection matrices
+// (ConstexprTan, ConstexprMatrixProjection) match the run-time ones, that the batch transforms (TransformBatch.h)
+// match the single point versions, and that CMatrix3x4 gives the same results as CMatrix4x4. These are reported in the "accuracy" section of the JSON and the program exits with 2 if any
+// check fails, so the benchmark run doubles as a regression check.
+//
+// Every benchmark processes arrays of a given batch size so results reflect data coming from memory rather
+// than a single value sitting in registers. Each result is the fastest of several timed runs:
+//     ns_per_op     - nanoseconds per operation (one operation = one call / one element)
+//     ops_per_sec   - operations per second
+//     cycles_per_op - time stamp counter ticks per operation, null where no counter is available. On x86
+//                     the TSC runs at the nominal clock rate so this is not affected by turbo / power saving
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
+#include "CQuaternion.h"
+#include "TransformBatch.h"
+#include "BoundingVolumes.h"
+#include "FastMath.h"
+#include "Packing.h"
+#include "MathHelpers.h"
+#include "MathSIMD.h"
+#include "VectorChains.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define BENCHMARK_HAS_CYCLE_COUNTER
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Settings
+-----------------------------------------------------------------------------------------*/
+
+// Minimum time for each timed run (seconds) and number of timed runs per benchmark
+double   gMinRunTime = 0.05;
+int      gNumRuns    = 5;
+
+// Batch sizes used for per-object operations (a few objects, a typical scene, a large scene)
+std::vector<unsigned int> gBatchSizes = { 16, 1024, 65536 };
+
+// Batch sizes used for vertex transforms (small mesh up to a large streamed mesh)
+unsigned int gMaxTransformBatch = 10000000;
+
+// Only run benchmarks containing this text
+std::string gFilter;
+
+// Results from all benchmarks are folded into this so the compiler cannot remove any of the work
+volatile float gSink = 0.0f;
+
+
+/*-----------------------------------------------------------------------------------------
+    Timing
+-----------------------------------------------------------------------------------------*/
+
+struct BenchmarkResult
+{
+    std::string  name;
+    unsigned int batch;
+    double       nsPerOp;
+    double       opsPerSec;
+    double       cyclesPerOp; // Negative if not available
+};
+
+std::vector<BenchmarkResult> gResults;
+
+
+struct AccuracyResult
+{
+    std::string name;
+    double      maxError;
+    double      bound;
+    bool        bulkMatches; // Bulk version gave the same results as the single value version
+};
+
+std::vector<AccuracyResult> gAccuracy;
+
+
+inline unsigned long long ReadCycleCounter()
+{
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+// Time the given function, which performs batch operations each time it is called. The function is called
+// repeatedly until gMinRunTime has passed, this is done gNumRuns times and the fastest run is recorded
+template <typename Fn>
+void Run(const char* name, unsigned int batch, Fn fn)
+{
+    if (!gFilter.empty() && std::strstr(name, gFilter.c_str()) == nullptr)  return;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Warm up caches and find how many calls fill the minimum run time
+    unsigned long long calls = 1;
+    for (;;)
+    {
+        auto start = Clock::now();
+        for (unsigned long long i = 0; i < calls; ++i)  fn();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= gMinRunTime)  break;
+        calls = (seconds < gMinRunTime / 10) ? calls * 10 : calls * 2;
+    }
+
+    double bestNs = 0, bestCycles = 0;
+    for (int run = 0; run < gNumRuns; ++run)
+    {
+        unsigned long long startCycles = ReadCycleCounter();
+        auto start = Clock::now();
+        for (unsigned long long i = 0; i < calls; ++i)  fn();
+        auto end = Clock::now();
+        unsigned long long endCycles = ReadCycleCounter();
+
+        double ops = static_cast<double>(calls) * batch;
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / ops;
+        if (run == 0 || ns < bestNs)
+        {
+            bestNs = ns;
+            bestCycles = static_cast<double>(endCycles - startCycles) / ops;
+        }
+    }
+
+    BenchmarkResult result;
+    result.name        = name;
+    result.batch       = batch;
+    result.nsPerOp     = bestNs;
+    result.opsPerSec   = 1e9 / bestNs;
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+    result.cyclesPerOp = bestCycles;
+#else
+    result.cyclesPerOp = -1;
+#endif
+    gResults.push_back(result);
+
+    std::fprintf(stderr, "%-36s %9u %10.3f ns/op\n", name, batch, bestNs);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Test data
+-----------------------------------------------------------------------------------------*/
+
+std::mt19937 gRandom(12345);
+
+float Random(float min, float max)
+{
+    return std::uniform_real_distribution<float>(min, max)(gRandom);
+}
+
+CVector2 RandomVector2()
+{
+    return { Random(-100, 100), Random(-100, 100) };
+}
+
+CVector3 RandomVector3()
+{
+    return { Random(-100, 100), Random(-100, 100), Random(-100, 100) };
+}
+
+CVector3 RandomRotation()
+{
+    return { Random(-PI, PI), Random(-PI, PI), Random(-PI, PI) };
+}
+
+// Typical model world matrix - rotation, scale and translation
+CMatrix4x4 RandomWorldMatrix()
+{
+    return MatrixFromTRS(RandomVector3(), RandomRotation(), { Random(0.5f, 2), Random(0.5f, 2), Random(0.5f, 2) });
+}
+
+template <typename T>
+float Checksum(const std::vector<T>& v)
+{
+    const float* p = reinterpret_cast<const float*>(v.data());
+    return p[0] + p[(v.size() * sizeof(T) / sizeof(float)) / 2];
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Vector benchmarks
+-----------------------------------------------------------------------------------------*/
+
+void BenchmarkVector3(unsigned int n)
+{
+    std::vector<CVector3> a(n), b(n), out(n);
+    std::vector<float> s(n), f(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        a[i] = RandomVector3();
+        b[i] = RandomVector3();
+        s[i] = Random(-2, 2);
+    }
+
+    Run("CVector3::operator+", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = a[i] + b[i]; });
+    Run("CVector3::operator-", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = a[i] - b[i]; });
+    Run("CVector3::operator*(v,s)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = a[i] * s[i]; });
+    Run("CVector3::operator*(s,v)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = s[i] * a[i]; });
+
+    // The compound operators start from the inputs each time, as accumulating into out over the repeated runs
+    // would drift into denormals and infinities and time the slow paths of the FPU instead
+    Run("CVector3::operator+=", n, [&] { for (unsigned int i = 0; i < n; ++i)  { CVector3 v = a[i];  v += b[i];  out[i] = v; } });
+    Run("CVector3::operator-=", n, [&] { for (unsigned int i = 0; i < n; ++i)  { CVector3 v = a[i];  v -= b[i];  out[i] = v; } });
+    Run("CVector3::operator*=", n, [&] { for (unsigned int i = 0; i < n; ++i)  { CVector3 v = a[i];  v *= s[i];  out[i] = v; } });
+    Run("CVector3::operator-(unary)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = -a[i]; });
+    Run("CVector3::Dot", n, [&] { for (unsigned int i = 0; i < n; ++i)  f[i] = Dot(a[i], b[i]); });
+    Run("CVector3::Cross", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = Cross(a[i], b[i]); });
+    Run("CVector3::Normalise", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = Normalise(a[i]); });
+    Run("CVector3::Length", n, [&] { for (unsigned int i = 0; i < n; ++i)  f[i] = Length(a[i]); });
+
+    gSink = gSink + Checksum(out) + Checksum(f);
+}
+
+// Whole expressions with the vector maths inlined against the same expressions making one call per
+// operation (see VectorChains.h, "make codegen" shows the generated code for both)
+void BenchmarkVectorChains(unsigned int n)
+{
+    std::vector<CVector3> a(n), b(n), c(n), out(n);
+    std::vector<float> s(n), t(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        a[i] = RandomVector3();
+        b[i] = RandomVector3();
+        c[i] = RandomVector3();
+        s[i] = Random(-1, 1);
+        t[i] = Random(-1, 1);
+    }
+
+    Run("FaceNormal(inline)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = FaceNormal(a[i], b[i], c[i]); });
+    Run("FaceNormal(out of line)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = FaceNormalOutOfLine(a[i], b[i], c[i]); });
+    Run("OrbitPosition(inline)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = OrbitPosition(a[i], s[i], t[i], 20.0f); });
+    Run("OrbitPosition(out of line)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = OrbitPositionOutOfLine(a[i], s[i], t[i], 20.0f); });
+    Run("MoveAndBlend(inline)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = MoveAndBlend(a[i], b[i], c[i], s[i], t[i]); });
+    Run("MoveAndBlend(out of line)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = MoveAndBlendOutOfLine(a[i], b[i], c[i], s[i], t[i]); });
+
+    gSink = gSink + Checksum(out);
+}
+
+void BenchmarkVector2(unsigned int n)
+{
+    std::vector<CVector2> a(n), b(n), out(n);
+    std::vector<float> f(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        a[i] = RandomVector2();
+        b[i] = RandomVector2();
+    }
+
+    Run("CVector2::operator+", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = a[i] + b[i]; });
+    Run("CVector2::operator-", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = a[i] - b[i]; });
+    Run("CVector2::operator+=", n, [&] { for (unsigned int i = 0; i < n; ++i)  { CVector2 v = a[i];  v += b[i];  out[i] = v; } });
+    Run("CVector2::operator-=", n, [&] { for (unsigned int i = 0; i < n; ++i)  { CVector2 v = a[i];  v -= b[i];  out[i] = v; } });
+    Run("CVector2::operator-(unary)", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = -a[i]; });
+    Run("CVector2::Dot", n, [&] { for (unsigned int i = 0; i < n; ++i)  f[i] = Dot(a[i], b[i]); });
+    Run("CVector2::Normalise", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = Normalise(a[i]); });
+
+    gSink = gSink + Checksum(out) + Checksum(f);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Matrix / quaternion benchmarks
+-----------------------------------------------------------------------------------------*/
+
+void BenchmarkMatrix(unsigned int n)
+{
+    std::vector<CMatrix4x4> a(n), b(n), out(n);
+    std::vector<CVector3> positions(n), rotations(n), scales(n), targets(n), v(n);
+    std::vector<CQuaternion> q(n), qOut(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        a[i] = RandomWorldMatrix();
+        b[i] = RandomWorldMatrix();
+        positions[i] = RandomVector3();
+        rotations[i] = RandomRotation();
+        scales[i]    = { Random(0.5f, 2), Random(0.5f, 2), Random(0.5f, 2) };
+        targets[i]   = RandomVector3();
+        q[i] = QuaternionFromEuler(rotations[i]);
+    }
+
+    Run("CMatrix4x4::operator*", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = a[i] * b[i]; });
+    Run("CMatrix4x4::operator*=", n, [&] { for (unsigned int i = 0; i < n; ++i)  { CMatrix4x4 m = a[i];  m *= b[i];  out[i] = m; } });
+    Run("CMatrix4x4::MultiplyScalar", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = MultiplyScalar(a[i], b[i]); });
+    Run("CMatrix4x4::InverseAffine", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = InverseAffine(a[i]); });
+    Run("CMatrix4x4::InverseAffineScalar", n, [&] { for (unsigned int i = 0; i < n; ++i)  out[i] = InverseAffineScalar(a[i]); });
+    Run("CMatrix4x4::FaceTarget", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            out[i] = a[i];
+            out[i].FaceTarget(targets[i]);
+        }
+    });
+    Run("CMatrix4x4::GetEulerAngles", n, [&] { for (unsigned int i = 0; i < n; ++i)  v[i] = a[i].GetEulerAngles(); });
+    Run("CMatrix4x4::GetScale", n, [&] { for (unsigned int i = 0; i < n; ++i)  v[i] = a[i].GetScale(); });
+    Run("MatrixFromTRS(euler)", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)  out[i] = MatrixFromTRS(positions[i], rotations[i], scales[i]);
+    });
+    Run("MatrixFromTRS(quaternion)", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)  out[i] = MatrixFromTRS(positions[i], q[i], scales[i]);
+    });
+
+    // The way world matrices were built before MatrixFromTRS, for comparison
+    Run("MatrixProductChain(TRS)", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            out[i] = MatrixScaling(scales[i]) * MatrixRotationZ(rotations[i].z) * MatrixRotationX(rotations[i].x) *
+                     MatrixRotationY(rotations[i].y) * MatrixTranslation(positions[i]);
+        }
+    });
+
+    Run("CQuaternion::operator*", n, [&] { for (unsigned int i = 0; i < n; ++i)  qOut[i] = q[i] * q[n - 1 - i]; });
+    Run("CQuaternion::Normalise", n, [&] { for (unsigned int i = 0; i < n; ++i)  qOut[i] = Normalise(q[i]); });
+    Run("CQuaternion::GetEulerAngles", n, [&] { for (unsigned int i = 0; i < n; ++i)  v[i] = q[i].GetEulerAngles(); });
+    Run("QuaternionFromEuler", n, [&] { for (unsigned int i = 0; i < n; ++i)  qOut[i] = QuaternionFromEuler(rotations[i]); });
+    Run("QuaternionFaceTarget", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)  qOut[i] = QuaternionFaceTarget(positions[i], targets[i], q[i]);
+    });
+
+    // Compact affine versions of the above
+    std::vector<CMatrix3x4> a34(n), b34(n), out34(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        a34[i] = ToMatrix3x4(a[i]);
+        b34[i] = ToMatrix3x4(b[i]);
+    }
+    Run("CMatrix3x4::operator*", n, [&] { for (unsigned int i = 0; i < n; ++i)  out34[i] = a34[i] * b34[i]; });
+    Run("CMatrix3x4::MultiplyScalar", n, [&] { for (unsigned int i = 0; i < n; ++i)  out34[i] = MultiplyScalar(a34[i], b34[i]); });
+    Run("CMatrix3x4::InverseAffine", n, [&] { for (unsigned int i = 0; i < n; ++i)  out34[i] = InverseAffine(a34[i]); });
+    Run("CMatrix3x4::InverseAffineScalar", n, [&] { for (unsigned int i = 0; i < n; ++i)  out34[i] = InverseAffineScalar(a34[i]); });
+    Run("AffineFromTRS(quaternion)", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)  out34[i] = AffineFromTRS(positions[i], q[i], scales[i]);
+    });
+
+    gSink = gSink + Checksum(out) + Checksum(v) + Checksum(qOut) + Checksum(out34);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Batch transform benchmarks
+-----------------------------------------------------------------------------------------*/
+
+void BenchmarkTransforms(unsigned int n)
+{
+    CMatrix4x4 world = RandomWorldMatrix();
+    CMatrix4x4 viewProj = InverseAffine(RandomWorldMatrix()) * MatrixProjection(16.0f / 9.0f, ToRadians(60.0f), 1.0f, 10000.0f);
+
+    std::vector<float> x(n), y(n), z(n), xOut(n), yOut(n), zOut(n);
+    std::vector<CVector3> aos(n), aosOut(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        aos[i] = RandomVector3();
+        x[i] = aos[i].x;
+        y[i] = aos[i].y;
+        z[i] = aos[i].z;
+    }
+
+    Run("TransformPoint(single)", n, [&] { for (unsigned int i = 0; i < n; ++i)  aosOut[i] = TransformPoint(aos[i], world); });
+    Run("TransformPoints(SoA)", n, [&] { TransformPoints(world, x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), n); });
+    Run("TransformNormals(SoA)", n, [&] { TransformNormals(world, x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), n); });
+    Run("TransformAndProject(SoA)", n, [&] { TransformAndProject(viewProj, x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), n); });
+    Run("TransformPoints(AoS)", n, [&] { TransformPoints(world, aos.data(), sizeof(CVector3), aosOut.data(), sizeof(CVector3), n); });
+    Run("TransformNormals(AoS)", n, [&] { TransformNormals(world, aos.data(), sizeof(CVector3), aosOut.data(), sizeof(CVector3), n); });
+    Run("TransformAndProject(AoS)", n, [&] { TransformAndProject(viewProj, aos.data(), sizeof(CVector3), aosOut.data(), sizeof(CVector3), n); });
+
+    gSink = gSink + Checksum(xOut) + Checksum(aosOut);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Fast maths benchmarks
+-----------------------------------------------------------------------------------------*/
+// Each fast function is timed next to the standard library version it replaces
+
+void BenchmarkFastMath(unsigned int n)
+{
+    std::vector<float> angles(n), sines(n), cosines(n), lengthsSq(n), f(n);
+    std::vector<float> x(n), y(n), z(n), xOut(n), yOut(n), zOut(n);
+    std::vector<CVector3> v(n), vOut(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        angles[i] = Random(-100, 100);
+        lengthsSq[i] = Random(0.01f, 1000);
+        v[i] = RandomVector3();
+        x[i] = v[i].x;
+        y[i] = v[i].y;
+        z[i] = v[i].z;
+    }
+
+    Run("std::sin+std::cos", n, [&]
+    {
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            sines[i]   = std::sin(angles[i]);
+            cosines[i] = std::cos(angles[i]);
+        }
+    });
+    Run("FastSinCos(single)", n, [&] { for (unsigned int i = 0; i < n; ++i)  FastSinCos(angles[i], sines[i], cosines[i]); });
+    Run("FastSinCos(batch)", n, [&] { FastSinCos(angles.data(), sines.data(), cosines.data(), n); });
+
+    Run("1/std::sqrt", n, [&] { for (unsigned int i = 0; i < n; ++i)  f[i] = 1.0f / std::sqrt(lengthsSq[i]); });
+    Run("FastInvSqrt", n, [&] { for (unsigned int i = 0; i < n; ++i)  f[i] = FastInvSqrt(lengthsSq[i]); });
+
+    Run("Normalise(loop)", n, [&] { for (unsigned int i = 0; i < n; ++i)  vOut[i] = Normalise(v[i]); });
+    Run("FastNormalise(SoA)", n, [&] { FastNormalise(x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), n); });
+    Run("FastNormalise(AoS)", n, [&] { FastNormalise(v.data(), sizeof(CVector3), vOut.data(), sizeof(CVector3), n); });
+
+    gSink = gSink + Checksum(sines) + Checksum(cosines) + Checksum(f) + Checksum(xOut) + Checksum(vOut);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Accuracy checks
+-----------------------------------------------------------------------------------------*/
+
+void CheckAccuracy(const char* name, double maxError, double bound, bool bulkMatches)
+{
+    gAccuracy.push_back({ name, maxError, bound, bulkMatches });
+    std::fprintf(stderr, "%-36s max error %10.4g (bound %.4g)%s\n", name, maxError, bound,
+                 (maxError <= bound && bulkMatches) ? "" : "  FAILED");
+}
+
+// Angle in degrees between two vectors, calculated in double precision
+double AngleDegrees(const CVector3& a, const CVector3& b)
+{
+    double cx = (double)a.y * b.z - (double)a.z * b.y;
+    double cy = (double)a.z * b.x - (double)a.x * b.z;
+    double cz = (double)a.x * b.y - (double)a.y * b.x;
+    double d  = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+    return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), d) * 180.0 / 3.14159265358979;
+}
+
+void CheckFastMathAccuracy(unsigned int n)
+{
+    std::vector<float> angles(n), sines(n), cosines(n);
+    for (unsigned int i = 0; i < n; ++i)  angles[i] = Random(-8192, 8192);
+    FastSinCos(angles.data(), sines.data(), cosines.data(), n);
+
+    double maxError = 0;
+    bool matches = true;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        maxError = std::max(maxError, std::abs(sines[i]   - std::sin(static_cast<double>(angles[i]))));
+        maxError = std::max(maxError, std::abs(cosines[i] - std::cos(static_cast<double>(angles[i]))));
+        float s, c;
+        FastSinCos(angles[i], s, c);
+        matches = matches && std::abs(s - sines[i]) <= 1.2e-7f && std::abs(c - cosines[i]) <= 1.2e-7f; // May round quadrant ties differently
+    }
+    CheckAccuracy("FastSinCos", maxError, 1e-7, matches);
+
+    maxError = 0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        float x = std::exp2(Random(-30, 30));
+        double exact = 1.0 / std::sqrt(static_cast<double>(x));
+        maxError = std::max(maxError, std::abs(FastInvSqrt(x) - exact) / exact);
+    }
+    CheckAccuracy("FastInvSqrt(relative)", maxError, 3e-7, true);
+}
+
+// Distance between two floats in units in the last place (0 if they are equal, 1 for neighbouring floats)
+int64_t UlpDistance(float a, float b)
+{
+    int32_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(float));
+    std::memcpy(&ib, &b, sizeof(float));
+    if (ia < 0)  ia = INT32_MIN - ia; // Order negative floats below positive ones
+    if (ib < 0)  ib = INT32_MIN - ib;
+    return std::abs(static_cast<int64_t>(ia) - ib);
+}
+
+int64_t MaxUlpDistance(const CMatrix4x4& a, const CMatrix4x4& b)
+{
+    int64_t maxUlps = 0;
+    for (int j = 0; j < 16; ++j)  maxUlps = std::max(maxUlps, UlpDistance((&a.e00)[j], (&b.e00)[j]));
+    return maxUlps;
+}
+
+// The 4x4 matrix multiply and inverse (SIMD where available) must match the scalar reference versions to the
+// last bit: they do the same multiplies and adds in the same order (the Makefile stops the compiler fusing the
+// scalar ones into FMA instructions)
+const double MATRIX_ULP_BOUND = 0;
+
+void CheckMatrix4x4Accuracy(unsigned int n)
+{
+    int64_t maxUlps = 0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        CMatrix4x4 a = RandomWorldMatrix();
+        CMatrix4x4 b = RandomWorldMatrix();
+        CMatrix4x4 expected = MultiplyScalar(a, b);
+
+        CMatrix4x4 product = a * b;
+        CMatrix4x4 compound = a;
+        compound *= b;
+        CMatrix4x4 self = a;
+        self *= self;
+        maxUlps = std::max(maxUlps, MaxUlpDistance(product, expected));
+        maxUlps = std::max(maxUlps, MaxUlpDistance(compound, expected));
+        maxUlps = std::max(maxUlps, MaxUlpDistance(self, MultiplyScalar(a, a)));
+        maxUlps = std::max(maxUlps, MaxUlpDistance(InverseAffine(a), InverseAffineScalar(a)));
+    }
+    CheckAccuracy("CMatrix4x4(ulps)", static_cast<double>(maxUlps), MATRIX_ULP_BOUND, true);
+}
+
+// Tangents and projection matrices calculated by the compiler, to compare with the run-time versions
+const int NUM_CONSTEXPR_ANGLES      = 129;
+const int NUM_CONSTEXPR_PROJECTIONS = 17;
+struct ConstexprResults
+{
+    float      angles[NUM_CONSTEXPR_ANGLES];
+    float      tangents[NUM_CONSTEXPR_ANGLES];
+    float      fovs[NUM_CONSTEXPR_PROJECTIONS];
+    CMatrix4x4 projections[NUM_CONSTEXPR_PROJECTIONS];
+};
+
+constexpr ConstexprResults MakeConstexprResults()
+{
+    ConstexprResults results = {};
+    for (int i = 0; i < NUM_CONSTEXPR_ANGLES; ++i)
+    {
+        // Angles across -PI/2 to PI/2, stopping short of the asymptotes
+        results.angles[i]   = (PI - 0.02f) * (static_cast<float>(i) / (NUM_CONSTEXPR_ANGLES - 1) - 0.5f);
+        results.tangents[i] = ConstexprTan(results.angles[i]);
+    }
+    for (int i = 0; i < NUM_CONSTEXPR_PROJECTIONS; ++i)
+    {
+        // Fields of view from 5 to 165 degrees
+        results.fovs[i]        = ToRadians(5.0f + 10.0f * i);
+        results.projections[i] = ConstexprMatrixProjection(16.0f / 9.0f, results.fovs[i], 0.1f, 10000.0f);
+    }
+    return results;
+}
+
+constexpr ConstexprResults CONSTEXPR_RESULTS = MakeConstexprResults();
+
+// The compile-time tangents and projection matrices must match std::tan and MatrixProjection, which the
+// run-time code uses, to within 1 ulp (std::tan is within 1 ulp of the exact result, as is ConstexprTan).
+// ConstexprTan called at run-time must give exactly the compiler's results, and angles that are not finite
+// must not hang it or break the projection matrix
+void CheckConstexprAccuracy()
+{
+    int64_t maxUlps = 0;
+    bool matches = true;
+    for (int i = 0; i < NUM_CONSTEXPR_ANGLES; ++i)
+    {
+        volatile float angle = CONSTEXPR_RESULTS.angles[i]; // Stop the compiler evaluating ConstexprTan below
+        maxUlps = std::max(maxUlps, UlpDistance(CONSTEXPR_RESULTS.tangents[i], std::tan(angle)));
+        matches = matches && ConstexprTan(angle) == CONSTEXPR_RESULTS.tangents[i];
+    }
+    for (int i = 0; i < NUM_CONSTEXPR_PROJECTIONS; ++i)
+    {
+        volatile float fov = CONSTEXPR_RESULTS.fovs[i];
+        maxUlps = std::max(maxUlps, MaxUlpDistance(CONSTEXPR_RESULTS.projections[i], MatrixProjection(16.0f / 9.0f, fov, 0.1f, 10000.0f)));
+    }
+
+    volatile float infinity = std::numeric_limits<float>::infinity();
+    volatile float notANumber = std::numeric_limits<float>::quiet_NaN();
+    matches = matches && std::isnan(ConstexprTan(infinity)) && std::isnan(ConstexprTan(-infinity)) && std::isnan(ConstexprTan(notANumber));
+    for (float fov : { static_cast<float>(infinity), static_cast<float>(-infinity), static_cast<float>(notANumber), 10.0f, -1.0f })
+    {
+        CMatrix4x4 runTime = MatrixProjection(1.0f, fov, 1.0f, 100.0f);
+        matches = matches && std::isfinite(runTime.e00) && std::isfinite(runTime.e11) && runTime.e00 > 0 &&
+                  MaxUlpDistance(runTime, MatrixProjection(1.0f, ClampProjectionFOV(fov), 1.0f, 100.0f)) == 0;
+    }
+    CheckAccuracy("ConstexprTan/Projection(ulps)", static_cast<double>(maxUlps), 1, matches);
+}
+
+// Scalar reference for TransformAndProject: the point with a w of 1 times the matrix, x, y and z then
+// multiplied by 1/w as the batch version does
+CVector3 ProjectPointScalar(const CVector3& p, const CMatrix4x4& m)
+{
+    CVector3 t = TransformPoint(p, m);
+    float w = p.x * m.e03 + p.y * m.e13 + p.z * m.e23 + m.e33;
+    float invW = 1.0f / w;
+    return { t.x * invW, t.y * invW, t.z * invW };
+}
+
+int64_t MaxUlpDistance(const CVector3& a, const CVector3& b)
+{
+    return std::max(UlpDistance(a.x, b.x), std::max(UlpDistance(a.y, b.y), UlpDistance(a.z, b.z)));
+}
+
+// The batch transforms must match TransformPoint, TransformVector and ProjectPointScalar to the last bit (they
+// do the same operations in the same order), for counts that leave a partial SIMD block, for strided vertex
+// data like Mesh.cpp's and when transforming in place
+void CheckTransformAccuracy()
+{
+    CMatrix4x4 world = RandomWorldMatrix();
+    CMatrix4x4 viewProj = InverseAffine(RandomWorldMatrix()) * MatrixProjection(16.0f / 9.0f, ToRadians(60.0f), 1.0f, 1000.0f);
+
+    // Position, normal and UV vertices (32 bytes) as in Mesh.cpp
+    struct Vertex { CVector3 position; CVector3 normal; CVector2 uv; };
+    // Points, normals then projection, in both layouts
+    using SoATransform = void(*)(const CMatrix4x4&, const float*, const float*, const float*, float*, float*, float*, unsigned int);
+    using AoSTransform = void(*)(const CMatrix4x4&, const void*, unsigned int, void*, unsigned int, unsigned int);
+    const int NUM_MODES = 3;
+    const SoATransform SOA_TRANSFORMS[NUM_MODES] = { TransformPoints, TransformNormals, TransformAndProject };
+    const AoSTransform AOS_TRANSFORMS[NUM_MODES] = { TransformPoints, TransformNormals, TransformAndProject };
+    auto Reference = [&](int mode, const CVector3& v)
+    {
+        return mode == 0 ? TransformPoint(v, world) : (mode == 1 ? TransformVector(v, world) : ProjectPointScalar(v, viewProj));
+    };
+
+    int64_t maxUlps = 0;
+    for (unsigned int count : { 0u, 1u, 3u, 4u, 5u, 7u, 8u, 9u, 15u, 17u, 33u, 1001u })
+    {
+        std::vector<Vertex> vertices(count);
+        std::vector<float> x(count), y(count), z(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            vertices[i] = { RandomVector3(), RandomVector3(), RandomVector2() };
+            x[i] = vertices[i].normal.x;
+            y[i] = vertices[i].normal.y;
+            z[i] = vertices[i].normal.z;
+        }
+
+        for (int mode = 0; mode < NUM_MODES; ++mode)
+        {
+            const CMatrix4x4& m = (mode == 2) ? viewProj : world;
+            SoATransform TransformSoA = SOA_TRANSFORMS[mode];
+            AoSTransform TransformAoS = AOS_TRANSFORMS[mode];
+
+            // SoA into separate arrays, then in place
+            std::vector<float> xOut(count), yOut(count), zOut(count);
+            TransformSoA(m, x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), count);
+            std::vector<float> xInPlace = x, yInPlace = y, zInPlace = z;
+            TransformSoA(m, xInPlace.data(), yInPlace.data(), zInPlace.data(), xInPlace.data(), yInPlace.data(), zInPlace.data(), count);
+
+            // Strided normals of the vertices into a packed array, then in place in the vertices
+            std::vector<CVector3> packed(count);
+            TransformAoS(m, reinterpret_cast<const unsigned char*>(vertices.data()) + offsetof(Vertex, normal), sizeof(Vertex),
+                         packed.data(), sizeof(CVector3), count);
+            std::vector<Vertex> inPlace = vertices;
+            TransformAoS(m, reinterpret_cast<unsigned char*>(inPlace.data()) + offsetof(Vertex, normal), sizeof(Vertex),
+                            reinterpret_cast<unsigned char*>(inPlace.data()) + offsetof(Vertex, normal), sizeof(Vertex), count);
+
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                CVector3 expected = Reference(mode, vertices[i].normal);
+                maxUlps = std::max(maxUlps, MaxUlpDistance(expected, { xOut[i], yOut[i], zOut[i] }));
+                maxUlps = std::max(maxUlps, MaxUlpDistance(expected, { xInPlace[i], yInPlace[i], zInPlace[i] }));
+                maxUlps = std::max(maxUlps, MaxUlpDistance(expected, packed[i]));
+                maxUlps = std::max(maxUlps, MaxUlpDistance(expected, inPlace[i].normal));
+                if (std::memcmp(&inPlace[i].position, &vertices[i].position, sizeof(CVector3)) != 0 ||
+                    std::memcmp(&inPlace[i].uv, &vertices[i].uv, sizeof(CVector2)) != 0)  maxUlps = INT32_MAX; // Other elements changed
+            }
+        }
+    }
+    CheckAccuracy("TransformBatch(ulps)", static_cast<double>(maxUlps), 0, true);
+}
+
+// The 3x4 matrix functions must match the 4x4 ones they replace, and the SIMD versions the scalar ones
+void CheckMatrixAccuracy(unsigned int n)
+{
+    double maxError = 0;
+    bool matches = true;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        CMatrix4x4 a = RandomWorldMatrix();
+        CMatrix4x4 b = RandomWorldMatrix();
+        CMatrix3x4 a34 = ToMatrix3x4(a);
+        CMatrix3x4 b34 = ToMatrix3x4(b);
+
+        CMatrix3x4 product = a34 * b34;
+        CMatrix3x4 inverse = InverseAffine(a34);
+        CMatrix4x4 expected[2] = { a * b, InverseAffine(a) };
+        CMatrix4x4 actual[2]   = { ToMatrix4x4(product), ToMatrix4x4(inverse) };
+        for (int m = 0; m < 2; ++m)
+        {
+            const float* e = &expected[m].e00;
+            const float* f = &actual[m].e00;
+            for (int j = 0; j < 16; ++j)  maxError = std::max(maxError, static_cast<double>(std::abs(e[j] - f[j])));
+        }
+
+        CMatrix3x4 productScalar = MultiplyScalar(a34, b34);
+        CMatrix3x4 inverseScalar = InverseAffineScalar(a34);
+        for (int j = 0; j < 12; ++j)
+        {
+            matches = matches && (&product.e00)[j] == (&productScalar.e00)[j] && (&inverse.e00)[j] == (&inverseScalar.e00)[j];
+        }
+    }
+    CheckAccuracy("CMatrix3x4", maxError, 1e-4, matches);
+}
+
+void CheckPackingAccuracy(unsigned int n)
+{
+    // Half - every half value must survive half -> float -> half, and random floats in the normal range
+    // must round trip within the relative error
+    bool matches = true;
+    for (unsigned int h = 0; h < 0x10000; ++h)
+    {
+        bool isNaN = (h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0;
+        if (!isNaN && FloatToHalf(HalfToFloat(static_cast<uint16_t>(h))) != h)  matches = false;
+    }
+    std::vector<float> floats(n), unpacked(n);
+    std::vector<uint16_t> halves(n);
+    for (unsigned int i = 0; i < n; ++i)  floats[i] = std::exp2(Random(-14, 15.99f)) * (i % 2 ? -1 : 1);
+    FloatToHalf(floats.data(), halves.data(), n);
+    HalfToFloat(halves.data(), unpacked.data(), n);
+    double maxError = 0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        maxError = std::max(maxError, std::abs(static_cast<double>(unpacked[i]) - floats[i]) / std::abs(floats[i]));
+        matches = matches && halves[i] == FloatToHalf(floats[i]) && unpacked[i] == HalfToFloat(halves[i]);
+    }
+    CheckAccuracy("Half(relative)", maxError, std::exp2(-11), matches);
+
+    // Normalised integers, inputs include values outside the range which are clamped
+    std::vector<int16_t> snorm16(n);
+    std::vector<uint8_t> unorm8(n);
+    for (unsigned int i = 0; i < n; ++i)  floats[i] = Random(-1.1f, 1.1f);
+    FloatToSnorm16(floats.data(), snorm16.data(), n);
+    Snorm16ToFloat(snorm16.data(), unpacked.data(), n);
+    maxError = 0;
+    matches = true;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        float clamped = std::min(std::max(floats[i], -1.0f), 1.0f);
+        maxError = std::max(maxError, static_cast<double>(std::abs(unpacked[i] - clamped)));
+        matches = matches && snorm16[i] == FloatToSnorm16(floats[i]) && unpacked[i] == Snorm16ToFloat(snorm16[i]);
+    }
+    CheckAccuracy("SNORM16", maxError, 1.0 / (2 * 32767) + 1e-7, matches);
+
+    maxError = 0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        float clamped = std::min(std::max(floats[i], -1.0f), 1.0f);
+        maxError = std::max(maxError, static_cast<double>(std::abs(Snorm8ToFloat(FloatToSnorm8(floats[i])) - clamped)));
+    }
+    CheckAccuracy("SNORM8", maxError, 1.0 / 254 + 1e-7, true);
+
+    FloatToUnorm8(floats.data(), unorm8.data(), n);
+    Unorm8ToFloat(unorm8.data(), unpacked.data(), n);
+    maxError = 0;
+    matches = true;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        float clamped = std::min(std::max(floats[i], 0.0f), 1.0f);
+        maxError = std::max(maxError, static_cast<double>(std::abs(unpacked[i] - clamped)));
+        matches = matches && unorm8[i] == FloatToUnorm8(floats[i]) && unpacked[i] == Unorm8ToFloat(unorm8[i]);
+    }
+    CheckAccuracy("UNORM8", maxError, 1.0 / 510 + 1e-7, matches);
+
+    // Octahedral - random unit vectors plus the axes, where the octahedron folds
+    std::vector<CVector3> normals(n), unpackedNormals(n);
+    std::normal_distribution<float> gaussian;
+    for (unsigned int i = 0; i < n; ++i)  normals[i] = Normalise(CVector3{ gaussian(gRandom), gaussian(gRandom), gaussian(gRandom) });
+    const CVector3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (unsigned int i = 0; i < 6 && i < n; ++i)  normals[i] = axes[i];
+
+    std::vector<uint32_t> octahedral16(n);
+    PackOctahedral16(normals.data(), sizeof(CVector3), octahedral16.data(), n);
+    UnpackOctahedral16(octahedral16.data(), unpackedNormals.data(), sizeof(CVector3), n);
+    maxError = 0;
+    matches = true;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        maxError = std::max(maxError, AngleDegrees(normals[i], unpackedNormals[i]));
+        matches = matches && octahedral16[i] == PackOctahedral16(normals[i]);
+    }
+    CheckAccuracy("Octahedral16(degrees)", maxError, 0.004, matches);
+
+    std::vector<uint16_t> octahedral8(n);
+    PackOctahedral8(normals.data(), sizeof(CVector3), octahedral8.data(), n);
+    UnpackOctahedral8(octahedral8.data(), unpackedNormals.data(), sizeof(CVector3), n);
+    maxError = 0;
+    matches = true;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        maxError = std::max(maxError, AngleDegrees(normals[i], unpackedNormals[i]));
+        matches = matches && octahedral8[i] == PackOctahedral8(normals[i]);
+    }
+    CheckAccuracy("Octahedral8(degrees)", maxError, 1.0, matches);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Packing benchmarks
+-----------------------------------------------------------------------------------------*/
+
+void BenchmarkPacking(unsigned int n)
+{
+    std::vector<float> floats(n), unpacked(n);
+    std::vector<uint16_t> halves(n);
+    std::vector<int16_t> snorm16(n);
+    std::vector<uint8_t> unorm8(n);
+    std::vector<CVector3> normals(n), unpackedNormals(n);
+    std::vector<uint32_t> octahedral16(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        floats[i] = Random(-1, 1);
+        normals[i] = Normalise(RandomVector3());
+    }
+
+    Run("FloatToHalf(single)", n, [&] { for (unsigned int i = 0; i < n; ++i)  halves[i] = FloatToHalf(floats[i]); });
+    Run("FloatToHalf(bulk)", n, [&] { FloatToHalf(floats.data(), halves.data(), n); });
+    Run("HalfToFloat(single)", n, [&] { for (unsigned int i = 0; i < n; ++i)  unpacked[i] = HalfToFloat(halves[i]); });
+    Run("HalfToFloat(bulk)", n, [&] { HalfToFloat(halves.data(), unpacked.data(), n); });
+    Run("FloatToSnorm16(bulk)", n, [&] { FloatToSnorm16(floats.data(), snorm16.data(), n); });
+    Run("Snorm16ToFloat(bulk)", n, [&] { Snorm16ToFloat(snorm16.data(), unpacked.data(), n); });
+    Run("FloatToUnorm8(bulk)", n, [&] { FloatToUnorm8(floats.data(), unorm8.data(), n); });
+    Run("Unorm8ToFloat(bulk)", n, [&] { Unorm8ToFloat(unorm8.data(), unpacked.data(), n); });
+    Run("PackOctahedral16(single)", n, [&] { for (unsigned int i = 0; i < n; ++i)  octahedral16[i] = PackOctahedral16(normals[i]); });
+    Run("PackOctahedral16(bulk)", n, [&] { PackOctahedral16(normals.data(), sizeof(CVector3), octahedral16.data(), n); });
+    Run("UnpackOctahedral16(bulk)", n, [&] { UnpackOctahedral16(octahedral16.data(), unpackedNormals.data(), sizeof(CVector3), n); });
+
+    gSink = gSink + Checksum(unpacked) + Checksum(unpackedNormals) + static_cast<float>(halves[0] + snorm16[0] + unorm8[0]);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Frustum culling benchmarks
+-----------------------------------------------------------------------------------------*/
+
+void BenchmarkCulling(unsigned int n)
+{
+    CMatrix4x4 viewProj = InverseAffine(RandomWorldMatrix()) * MatrixProjection(16.0f / 9.0f, ToRadians(60.0f), 1.0f, 1000.0f);
+    CFrustum frustum = FrustumFromMatrix(viewProj);
+
+    std::vector<float> x(n), y(n), z(n), radius(n), hx(n), hy(n), hz(n);
+    std::vector<unsigned int> visible(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        x[i] = Random(-500, 500);
+        y[i] = Random(-500, 500);
+        z[i] = Random(-500, 500);
+        radius[i] = Random(1, 20);
+        hx[i] = Random(1, 20);
+        hy[i] = Random(1, 20);
+        hz[i] = Random(1, 20);
+    }
+
+    unsigned int numVisible = 0;
+    Run("IsVisible(sphere)", n, [&]
+    {
+        numVisible = 0;
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            if (IsVisible(frustum, CSphere{ { x[i], y[i], z[i] }, radius[i] }))  visible[numVisible++] = i;
+        }
+    });
+    Run("CullSpheres", n, [&] { numVisible = CullSpheres(frustum, x.data(), y.data(), z.data(), radius.data(), n, visible.data()); });
+    Run("CullAABBs", n, [&] { numVisible = CullAABBs(frustum, x.data(), y.data(), z.data(), hx.data(), hy.data(), hz.data(), n, visible.data()); });
+
+    gSink = gSink + static_cast<float>(numVisible);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Output
+-----------------------------------------------------------------------------------------*/
+
+void WriteJSON(FILE* file)
+{
+    char timeText[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timeText, sizeof(timeText), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#if defined(__clang__)
+    const char* compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const char* compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    const char* compiler = "msvc";
+#else
+    const char* compiler = "unknown";
+#endif
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"simd\": \"%s\",\n", MATH_SIMD_NAME);
+    std::fprintf(file, "  \"simd_width\": %d,\n", SIMD_WIDTH);
+    std::fprintf(file, "  \"compiler\": \"%s\",\n", compiler);
+    std::fprintf(file, "  \"timestamp\": \"%s\",\n", timeText);
+    std::fprintf(file, "  \"min_run_time_s\": %g,\n", gMinRunTime);
+    std::fprintf(file, "  \"runs\": %d,\n", gNumRuns);
+    std::fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < gResults.size(); ++i)
+    {
+        const BenchmarkResult& r = gResults[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"batch\": %u, \"ns_per_op\": %.4f, \"ops_per_sec\": %.1f, ",
+                     r.name.c_str(), r.batch, r.nsPerOp, r.opsPerSec);
+        if (r.cyclesPerOp < 0)  std::fprintf(file, "\"cycles_per_op\": null }");
+        else                    std::fprintf(file, "\"cycles_per_op\": %.3f }", r.cyclesPerOp);
+        std::fprintf(file, "%s\n", (i + 1 < gResults.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"accuracy\": [\n");
+    for (size_t i = 0; i < gAccuracy.size(); ++i)
+    {
+        const AccuracyResult& a = gAccuracy[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"max_error\": %.6g, \"bound\": %.6g, \"bulk_matches\": %s, \"pass\": %s }%s\n",
+                     a.name.c_str(), a.maxError, a.bound, a.bulkMatches ? "true" : "false",
+                     (a.maxError <= a.bound && a.bulkMatches) ? "true" : "false", (i + 1 < gAccuracy.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ]\n");
+    std::fprintf(file, "}\n");
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Main
+-----------------------------------------------------------------------------------------*/
+
+int main(int argc, char* argv[])
+{
+    const char* outFile = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if      (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)        outFile = argv[++i];
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)     gFilter = argv[++i];
+        else if (std::strcmp(argv[i], "--max-batch") == 0 && i + 1 < argc)  gMaxTransformBatch = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            gMinRunTime = 0.005;
+            gNumRuns = 2;
+            gBatchSizes = { 16, 1024 };
+            gMaxTransformBatch = std::min(gMaxTransformBatch, 100000u);
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--out file.json] [--filter text] [--quick] [--max-batch n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::fprintf(stderr, "Math benchmark (%s)\n", MATH_SIMD_NAME);
+
+    CheckFastMathAccuracy(1000000);
+    CheckMatrix4x4Accuracy(100000);
+    CheckConstexprAccuracy();
+    CheckTransformAccuracy();
+    CheckMatrixAccuracy(100000);
+    CheckPackingAccuracy(1000000);
+
+    for (unsigned int n : gBatchSizes)  BenchmarkVector3(n);
+    for (unsigned int n : gBatchSizes)  BenchmarkVectorChains(n);
+    for (unsigned int n : gBatchSizes)  BenchmarkVector2(n);
+    for (unsigned int n : gBatchSizes)  BenchmarkMatrix(n);
+    for (unsigned int n = 1000; n <= gMaxTransformBatch; n *= 10)  BenchmarkTransforms(n);
+    for (unsigned int n : gBatchSizes)  BenchmarkCulling(n);
+    for (unsigned int n : gBatchSizes)  BenchmarkFastMath(n);
+    for (unsigned int n : gBatchSizes)  BenchmarkPacking(n);
+
+    if (outFile != nullptr)
+    {
+        FILE* file = std::fopen(outFile, "w");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", outFile);
+            return 1;
+        }
+        WriteJSON(file);
+        std::fclose(file);
+    }
+    else
+    {
+        WriteJSON(stdout);
+    }
+
+    for (const AccuracyResult& a : gAccuracy)
+    {
+        if (a.maxError > a.bound || !a.bulkMatches)  return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,2802 @@
+//--------------------------------------------------------------------------------------
+// Checks and benchmarks for the mesh geometry code
+//--------------------------------------------------------------------------------------
+// Standalone program, not part of RenderTexture.vcxproj. Build on Linux with the Makefile in this
+// folder, which compiles ../Geometry/*.cpp and the parts of ../Utility they use directly:
+//
+//     make MeshBenchmark    - builds this program
+//     make ASSIMP=1 ...     - also builds the assimp importer (AssimpImport.cpp, AssimpIOSystem.cpp) and links
+//                             with -lassimp, to compare the native .x reader with assimp
+//     make run              - runs it with the math benchmarks and writes MeshBenchmark.json
+//
+// Command line options:
+//     --out <file>      write JSON results to file (default is stdout)
+//     --filter <text>   only run benchmarks whose name contains text
+//     --quick           shorter timing runs and smaller meshes (for a smoke test)
+//     --media <folder>  folder of .x files to check and time (default ../Media/)
+//
+// Before timing anything the program checks the geometry code on generated meshes and the .x files in the
+// media folder. Cooked mesh files (CookedMesh.h) must load back identical to the data written, and files
+// with the wrong key, an old version, damaged contents or missing bytes must be rejected. ParseFloat must
+// match std::strtof. Every .x file must load with the native reader (XFile.h) into a valid mesh, and binary
+// versions of each file (made by this program) must give exactly the same mesh. With assimp, the native
+// reader must give the same triangles and bounds as assimp. Welding, normals and tangents (MeshProcessing.h)
+// must give exactly the same result with any number of threads, and with assimp, normals and tangents close
+// to those assimp calculates. Levels of detail (MeshSimplifier.h) must each have fewer triangles and no less
+// error than the one before, a flat surface must simplify with no error, a seam must only move along itself
+// and every .x file that is large enough must get at least 3 levels. Meshlets (Meshlets.h) must keep
+// to their size limits, cover every triangle once and bound their vertices and normals, and culling them must
+// never remove a triangle that faces the camera or is inside the frustum. The depth stream of a packed mesh
+// (VertexPacking.h) must hold each position once and give every triangle the same positions as the full
+// vertices. A mesh's BVH (MeshBVH.h) must hold every triangle once in boxes that bound it, find the same closest
+// hit as testing every triangle and be the same with any number of threads. The vertex and index codec
+// (MeshCodec.h) must give back exactly the buffers it was given, for every .x file with both vertex profiles
+// and for random data, and must reject damaged data. The streaming import (MeshStreaming.h) of a generated .x
+// file must keep within its memory budget, leave no temporary files and give a streamed mesh (StreamedMesh.h)
+// whose chunks fill every index once, with the same triangles and bounds as LoadXFile, and damaged streamed
+// files must be rejected. The checks are reported in the
+// "checks" section of the JSON and the program exits with 2 if any fail, so the benchmark run doubles as a
+// regression check.
+//
+// Each result is the fastest of several timed runs:
+//     ns_per_op      - nanoseconds per operation (one operation = one call)
+//     ns_per_vertex  - the same divided by the number of vertices in the mesh
+//
+// The "imports" section has the time, peak heap memory and bytes of file read to load each .x file with each
+// importer (for assimp, the bytes it reads through MappedIOSystem, which includes reading file headers to
+// pick an importer). Every allocation in the program is counted (see Memory use below), including those made
+// inside assimp. It also has the whole import (MeshImport.h) of a generated .x file against the streaming
+// import (MeshStreaming.h) of the same file with the smallest budget
+//
+// The "optimisation" section has the ACMR, ATVR, overdraw and overfetch (see MeshOptimiser.h) of each .x file
+// as loaded and after each step of OptimiseMesh
+//
+// The "lods" section has the triangles and error (in model space, and as a fraction of the bounding sphere's
+// radius) of each level of detail of each .x file
+//
+// The "meshlets" section has the number and average size of the meshlets of each .x file, and the fraction of
+// triangles left after culling back facing meshlets, averaged over views from the six axis directions
+//
+// The "bvh" section has the triangles, nodes, memory, SAH cost and build time of each .x file's BVH, and the
+// rays per second traced against it on one core (rays from around the mesh towards random points in its bounding
+// box, some hitting and some missing)
+//
+// The "codec" section has the size of the vertex and index buffers of each .x file (full vertex profile, with
+// levels of detail and meshlets, as cooked) before and after compression (MeshCodec.h), and the speed of
+// decoding each in GB/s of decoded data on one core
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "MeshData.h"
+#include "CookedMesh.h"
+#include "MappedFile.h"
+#include "Hash.h"
+#include "XFile.h"
+#include "VertexPacking.h"
+#include "MeshOptimiser.h"
+#include "MeshProcessing.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "MeshBVH.h"
+#include "MeshCodec.h"
+#include "MeshImport.h"
+#include "MeshStreaming.h"
+#include "StreamedMesh.h"
+#include "ParallelFor.h"
+#ifdef MESH_BENCHMARK_ASSIMP
+#include "AssimpImport.h"
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#endif
+
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <new>
+
+#include <dirent.h>
+
+
+/*-----------------------------------------------------------------------------------------
+    Settings
+-----------------------------------------------------------------------------------------*/
+
+// Minimum time for each timed run (seconds) and number of timed runs per benchmark
+double   gMinRunTime = 0.05;
+int      gNumRuns    = 5;
+
+// Approximate vertex counts of the generated meshes (a prop, a character, a large scanned mesh)
+std::vector<unsigned int> gMeshSizes = { 1000, 50000, 1000000 };
+
+// Only run benchmarks containing this text
+std::string gFilter;
+
+// Folder for temporary files
+std::string gTempFolder = "/tmp/";
+
+// Folder of .x files to check and time
+std::string gMediaFolder = "../Media/";
+
+// Results from all benchmarks are folded into this so the compiler cannot remove any of the work
+volatile unsigned int gSink = 0;
+
+
+/*-----------------------------------------------------------------------------------------
+    Memory use
+-----------------------------------------------------------------------------------------*/
+
+// Replacement global new and delete that keep count of the heap memory in use. Each block has a header
+// holding its size, aligned like malloc's blocks so the memory after it is too. The default array and nothrow
+// versions of new and delete call these ones
+size_t gHeapInUse = 0;
+size_t gHeapPeak  = 0;
+
+struct alignas(std::max_align_t) HeapBlockHeader
+{
+    size_t size;
+};
+
+void* operator new(size_t size)
+{
+    HeapBlockHeader* header = static_cast<HeapBlockHeader*>(std::malloc(sizeof(HeapBlockHeader) + size));
+    if (header == nullptr)  throw std::bad_alloc();
+    header->size = size;
+    gHeapInUse += size;
+    if (gHeapInUse > gHeapPeak)  gHeapPeak = gHeapInUse;
+    return header + 1;
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p == nullptr)  return;
+    HeapBlockHeader* header = static_cast<HeapBlockHeader*>(p) - 1;
+    gHeapInUse -= header->size;
+    std::free(header);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+// Peak extra heap memory used while running the given function
+template <typename Fn>
+size_t PeakHeapUse(Fn fn)
+{
+    size_t start = gHeapInUse;
+    gHeapPeak = gHeapInUse;
+    fn();
+    return gHeapPeak - start;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Timing
+-----------------------------------------------------------------------------------------*/
+
+struct BenchmarkResult
+{
+    std::string  name;
+    unsigned int vertices;
+    double       nsPerOp;
+};
+
+std::vector<BenchmarkResult> gResults;
+
+
+// Loading a .x file with one of the importers
+struct ImportResult
+{
+    std::string  file;
+    std::string  importer;
+    double       ns;
+    size_t       peakHeap;
+    unsigned int vertices;
+    unsigned int triangles;
+    uint64_t     bytesRead; // Bytes of the file(s) read by the importer
+};
+
+std::vector<ImportResult> gImports;
+
+
+struct PackingResult
+{
+    std::string   file;
+    PackingReport report;
+    uint32_t      vertices;
+    uint32_t      depthVertices; // Positions in the depth stream
+};
+
+std::vector<PackingResult> gPacking;
+
+
+struct OptimisationResult
+{
+    std::string            file;
+    MeshOptimisationReport report;
+};
+
+std::vector<OptimisationResult> gOptimisation;
+
+
+struct LODResult
+{
+    std::string          file;
+    float                radius;
+    std::vector<MeshLOD> lods;
+};
+
+std::vector<LODResult> gLODs;
+
+
+struct MeshletResult
+{
+    std::string file;
+    uint32_t    meshlets;
+    float       vertices;        // Average per meshlet
+    float       triangles;
+    float       backFacingKept;  // Fraction of triangles left after back face culling
+};
+
+std::vector<MeshletResult> gMeshlets;
+
+
+struct BVHResult
+{
+    std::string file;
+    uint32_t    triangles;
+    uint32_t    nodes;
+    size_t      memoryBytes;
+    float       sahCost;
+    double      buildNs;       // With every core
+    double      raysPerSecond; // On one core
+    float       hitFraction;   // Of the rays traced
+};
+
+std::vector<BVHResult> gBVHs;
+
+
+struct CodecResult
+{
+    std::string file;
+    size_t      vertexBytes;
+    size_t      encodedVertexBytes;
+    size_t      indexBytes;
+    size_t      encodedIndexBytes;
+    double      vertexGBPerSecond; // Of decoded data
+    double      indexGBPerSecond;
+};
+
+std::vector<CodecResult> gCodecs;
+
+
+struct CheckResult
+{
+    std::string name;
+    bool        pass;
+};
+
+std::vector<CheckResult> gChecks;
+
+
+// Time the given function. The function is called repeatedly until gMinRunTime has passed, this is done
+// gNumRuns times and the fastest run is recorded
+template <typename Fn>
+void Run(const char* name, unsigned int vertices, Fn fn)
+{
+    if (!gFilter.empty() && std::strstr(name, gFilter.c_str()) == nullptr)  return;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Warm up caches and find how many calls fill the minimum run time
+    unsigned long long calls = 1;
+    for (;;)
+    {
+        auto start = Clock::now();
+        for (unsigned long long i = 0; i < calls; ++i)  fn();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= gMinRunTime)  break;
+        calls = (seconds < gMinRunTime / 10) ? calls * 10 : calls * 2;
+    }
+
+    double bestNs = 0;
+    for (int run = 0; run < gNumRuns; ++run)
+    {
+        auto start = Clock::now();
+        for (unsigned long long i = 0; i < calls; ++i)  fn();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+        if (run == 0 || ns < bestNs)  bestNs = ns;
+    }
+
+    gResults.push_back({ name, vertices, bestNs });
+    std::fprintf(stderr, "%-36s %9u %14.1f ns/op %8.3f ns/vertex\n", name, vertices, bestNs, bestNs / vertices);
+}
+
+
+void Check(const std::string& name, bool pass)
+{
+    gChecks.push_back({ name, pass });
+    std::fprintf(stderr, "%-60s %s\n", name.c_str(), pass ? "ok" : "FAILED");
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Test data
+-----------------------------------------------------------------------------------------*/
+
+std::mt19937 gRandom(12345);
+
+float Random(float min, float max)
+{
+    return std::uniform_real_distribution<float>(min, max)(gRandom);
+}
+
+// Generate a mesh of numSubMeshes bumpy grids with roughly numVertices vertices in total, with the same
+// layout the Mesh class imports (position, normal, optional tangent and UV)
+MeshData GenerateMesh(unsigned int numVertices, unsigned int numSubMeshes, bool tangents)
+{
+    MeshData mesh;
+    uint32_t positionOffset = mesh.AddElement("Position", VertexFormat::Float3);
+    uint32_t normalOffset   = mesh.AddElement("Normal",   VertexFormat::Float3);
+    uint32_t tangentOffset  = tangents ? mesh.AddElement("Tangent", VertexFormat::Float3) : 0;
+    uint32_t uvOffset       = mesh.AddElement("UV",       VertexFormat::Float2);
+
+    unsigned int side = std::max(2u, static_cast<unsigned int>(std::sqrt(static_cast<float>(numVertices / numSubMeshes))));
+    for (unsigned int s = 0; s < numSubMeshes; ++s)
+    {
+        SubMesh subMesh;
+        subMesh.startIndex  = static_cast<uint32_t>(mesh.indices.size());
+        subMesh.baseVertex  = mesh.numVertices;
+        subMesh.numVertices = side * side;
+
+        mesh.vertices.resize((mesh.numVertices + subMesh.numVertices) * mesh.vertexSize);
+        unsigned char* vertex = mesh.vertices.data() + mesh.numVertices * mesh.vertexSize;
+        for (unsigned int y = 0; y < side; ++y)
+        {
+            for (unsigned int x = 0; x < side; ++x, vertex += mesh.vertexSize)
+            {
+                *(CVector3*)(vertex + positionOffset) = { x + 100.0f * s, Random(-1, 1), static_cast<float>(y) };
+                *(CVector3*)(vertex + normalOffset)   = Normalise({ Random(-0.2f, 0.2f), 1, Random(-0.2f, 0.2f) });
+                if (tangents)  *(CVector3*)(vertex + tangentOffset) = { 1, 0, 0 };
+                *(CVector2*)(vertex + uvOffset) = { static_cast<float>(x) / (side - 1), static_cast<float>(y) / (side - 1) };
+            }
+        }
+
+        for (unsigned int y = 0; y < side - 1; ++y)
+        {
+            for (unsigned int x = 0; x < side - 1; ++x)
+            {
+                uint32_t i = y * side + x;
+                uint32_t quad[6] = { i, i + side, i + 1, i + 1, i + side, i + side + 1 };
+                mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+            }
+        }
+
+        subMesh.numIndices = static_cast<uint32_t>(mesh.indices.size()) - subMesh.startIndex;
+        mesh.subMeshes.push_back(subMesh);
+        mesh.numVertices += subMesh.numVertices;
+    }
+
+    CalculateBounds(mesh);
+    return mesh;
+}
+
+
+// Read a whole file into memory, empty if it can't be read
+std::vector<unsigned char> ReadFile(const std::string& fileName)
+{
+    std::vector<unsigned char> data;
+    FILE* file = std::fopen(fileName.c_str(), "rb");
+    if (file == nullptr)  return data;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size > 0)
+    {
+        data.resize(size);
+        if (std::fread(data.data(), 1, data.size(), file) != data.size())  data.clear();
+    }
+    std::fclose(file);
+    return data;
+}
+
+bool WriteFile(const std::string& fileName, const std::vector<unsigned char>& data)
+{
+    FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (file == nullptr)  return false;
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (std::fclose(file) == 0) && ok;
+}
+
+
+// Names of the .x files in the media folder, sorted
+std::vector<std::string> MediaXFiles()
+{
+    std::vector<std::string> files;
+    DIR* dir = opendir(gMediaFolder.c_str());
+    if (dir == nullptr)  return files;
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > 2 && (name.substr(name.size() - 2) == ".x" || name.substr(name.size() - 2) == ".X"))  files.push_back(name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+
+// Convert a text .x file to the binary form, to test the binary reader as there are no binary files in the
+// media folder. Names, braces, strings and GUIDs become single tokens and runs of numbers become integer or
+// float lists, as DirectX writes them. Numbers containing a '.' or exponent are floats. Float lists hold
+// floats (header float size 0032) or doubles (0064)
+std::vector<unsigned char> TextXFileToBinary(const std::vector<unsigned char>& text, bool doubles)
+{
+    const char* header = doubles ? "xof 0303bin 0064" : "xof 0303bin 0032";
+    std::vector<unsigned char> binary(header, header + 16);
+
+    auto put = [&](const void* data, size_t size)
+    {
+        size_t end = binary.size();
+        binary.resize(end + size);
+        std::memcpy(binary.data() + end, data, size);
+    };
+    auto putToken = [&](uint16_t token)  { put(&token, 2); };
+    auto putUInt  = [&](uint32_t value)  { put(&value, 4); };
+
+    std::vector<uint32_t> ints;
+    std::vector<float>    floats;
+    auto flush = [&]()
+    {
+        if (!ints.empty())
+        {
+            putToken(6);
+            putUInt(static_cast<uint32_t>(ints.size()));
+            put(ints.data(), ints.size() * 4);
+            ints.clear();
+        }
+        if (!floats.empty())
+        {
+            putToken(7);
+            putUInt(static_cast<uint32_t>(floats.size()));
+            for (float f : floats)
+            {
+                if (doubles)  { double d = f; put(&d, 8); }
+                else          put(&f, 4);
+            }
+            floats.clear();
+        }
+    };
+
+    const char* p   = reinterpret_cast<const char*>(text.data()) + 16;
+    const char* end = reinterpret_cast<const char*>(text.data()) + text.size();
+    while (p < end)
+    {
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';')  { ++p; continue; }
+        if (c == '#' || (c == '/' && p + 1 < end && p[1] == '/'))
+        {
+            while (p < end && *p != '\n')  ++p;
+            continue;
+        }
+
+        bool isNumber = std::isdigit(static_cast<unsigned char>(c)) ||
+                        ((c == '-' || c == '.') && p + 1 < end && (std::isdigit(static_cast<unsigned char>(p[1])) || p[1] == '.'));
+        if (isNumber)
+        {
+            const char* numberEnd = p + 1;
+            bool isFloat = false;
+            while (numberEnd < end && (std::isalnum(static_cast<unsigned char>(*numberEnd)) || *numberEnd == '.' || *numberEnd == '-' || *numberEnd == '+'))
+            {
+                if (*numberEnd == '.' || *numberEnd == 'e' || *numberEnd == 'E')  isFloat = true;
+                ++numberEnd;
+            }
+            if (isFloat)
+            {
+                if (!ints.empty())  flush();
+                float f = 0;
+                ParseFloat(p, numberEnd, f);
+                floats.push_back(f);
+            }
+            else
+            {
+                if (!floats.empty())  flush();
+                ints.push_back(static_cast<uint32_t>(std::strtoul(std::string(p, numberEnd).c_str(), nullptr, 10)));
+            }
+            p = numberEnd;
+            continue;
+        }
+
+        flush();
+        if      (c == '{')  { putToken(10); ++p; }
+        else if (c == '}')  { putToken(11); ++p; }
+        else if (c == '[')  { putToken(14); ++p; }
+        else if (c == ']')  { putToken(15); ++p; }
+        else if (c == '"')
+        {
+            const char* stringEnd = p + 1;
+            while (stringEnd < end && *stringEnd != '"')  ++stringEnd;
+            putToken(2);
+            putUInt(static_cast<uint32_t>(stringEnd - p - 1));
+            put(p + 1, stringEnd - p - 1);
+            putToken(20);
+            p = stringEnd + 1;
+        }
+        else if (c == '<')
+        {
+            while (p < end && *p != '>')  ++p;
+            ++p;
+            unsigned char guid[16] = {};
+            putToken(5);
+            put(guid, 16);
+        }
+        else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+        {
+            const char* nameEnd = p;
+            while (nameEnd < end && (std::isalnum(static_cast<unsigned char>(*nameEnd)) || *nameEnd == '_' || *nameEnd == '-' || *nameEnd == '.'))  ++nameEnd;
+            std::string name(p, nameEnd);
+            if (name == "template")
+            {
+                putToken(31);
+            }
+            else
+            {
+                putToken(1);
+                putUInt(static_cast<uint32_t>(name.size()));
+                put(name.data(), name.size());
+            }
+            p = nameEnd;
+        }
+        else
+        {
+            ++p;
+        }
+    }
+    flush();
+    return binary;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Checks
+-----------------------------------------------------------------------------------------*/
+
+bool SameBounds(const MeshDataView& a, const MeshDataView& b)
+{
+    return std::memcmp(&a.boundingBox, &b.boundingBox, sizeof(CAABB)) == 0 &&
+           std::memcmp(&a.boundingSphere, &b.boundingSphere, sizeof(CSphere)) == 0;
+}
+
+// Two views hold exactly the same mesh
+bool SameMesh(const MeshDataView& a, const MeshDataView& b)
+{
+    return a.numElements == b.numElements && a.numSubMeshes == b.numSubMeshes && a.numLODs == b.numLODs &&
+           a.numMeshlets == b.numMeshlets && a.numVertices == b.numVertices && a.vertexSize == b.vertexSize &&
+           a.numIndices == b.numIndices && a.indexSize == b.indexSize && SameBounds(a, b) &&
+           std::memcmp(a.elements, b.elements, a.numElements * sizeof(VertexElement)) == 0 &&
+           std::memcmp(a.subMeshes, b.subMeshes, a.numSubMeshes * sizeof(SubMesh)) == 0 &&
+           std::memcmp(a.lods, b.lods, a.numLODs * sizeof(MeshLOD)) == 0 &&
+           std::memcmp(a.meshlets, b.meshlets, a.numMeshlets * sizeof(Meshlet)) == 0 &&
+           std::memcmp(a.vertices, b.vertices, static_cast<size_t>(a.numVertices) * a.vertexSize) == 0 &&
+           std::memcmp(a.indices, b.indices, static_cast<size_t>(a.numIndices) * a.indexSize) == 0 &&
+           a.numDepthVertices == b.numDepthVertices && a.depthVertexSize == b.depthVertexSize &&
+           (a.numDepthVertices == 0 || (a.depthIndexSize == b.depthIndexSize &&
+           std::memcmp(a.depthVertices, b.depthVertices, static_cast<size_t>(a.numDepthVertices) * a.depthVertexSize) == 0 &&
+           std::memcmp(a.depthIndices, b.depthIndices, static_cast<size_t>(a.numIndices) * a.depthIndexSize) == 0));
+}
+
+void CheckCookedMesh()
+{
+    const std::string fileName = gTempFolder + "MeshBenchmarkCheck.cooked";
+    const uint64_t key = HashValue(12345ULL);
+
+    for (int test = 0; test < 4; ++test)
+    {
+        bool tangents = (test % 2) == 1;
+        bool compress = test >= 2;
+        std::string layout = std::string(tangents ? " (tangents" : " (no tangents") + (compress ? ", compressed)" : ")");
+        MeshData mesh = GenerateMesh(5000, 3, tangents);
+        MeshDataView view = mesh.View();
+
+        bool written = WriteCookedMesh(fileName, key, view, compress);
+        Check("CookedMesh: write" + layout, written);
+
+        CookedMesh cooked;
+        bool opened = cooked.Open(fileName, key);
+        Check("CookedMesh: open" + layout, opened);
+        Check("CookedMesh: identical after loading" + layout, opened && SameMesh(view, cooked.View()));
+        Check("CookedMesh: sections aligned" + layout, opened && 
+              reinterpret_cast<uintptr_t>(cooked.View().vertices) % 16 == 0 &&
+              reinterpret_cast<uintptr_t>(cooked.View().indices) % 16 == 0);
+        cooked.Close();
+    }
+
+    MeshData lodMesh = GenerateMesh(5000, 2, false);
+    OptimiseMesh(lodMesh);
+    BuildMeshlets(lodMesh);
+    GenerateLODs(lodMesh);
+    CookedMesh cookedLODs;
+    Check("CookedMesh: identical after loading (levels of detail, meshlets)", !lodMesh.lods.empty() && !lodMesh.meshlets.empty() &&
+          WriteCookedMesh(fileName, key, lodMesh.View()) && cookedLODs.Open(fileName, key) && SameMesh(lodMesh.View(), cookedLODs.View()));
+    cookedLODs.Close();
+
+    // A packed mesh has a depth stream, which is compressed too
+    PackedMesh packedLODs = PackMesh(lodMesh.View(), VertexProfile::Compact);
+    Check("CookedMesh: identical after loading (packed, compressed)", packedLODs.View().numDepthVertices > 0 &&
+          WriteCookedMesh(fileName, key, packedLODs.View(), true) && cookedLODs.Open(fileName, key) && SameMesh(packedLODs.View(), cookedLODs.View()));
+    cookedLODs.Close();
+
+    MeshData mesh = GenerateMesh(5000, 2, false);
+    WriteCookedMesh(fileName, key, mesh.View());
+    std::vector<unsigned char> original = ReadFile(fileName);
+    CookedMesh cooked;
+
+    Check("CookedMesh: rejects different key", !cooked.Open(fileName, key + 1));
+    Check("CookedMesh: rejects missing file", !cooked.Open(fileName + ".missing", key));
+
+    // Damaged copies of the file must all be rejected
+    std::vector<unsigned char> damaged = original;
+    damaged[0] = 'X';
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects wrong magic", !cooked.Open(fileName, key));
+
+    damaged = original;
+    damaged[4] += 1;
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects different version", !cooked.Open(fileName, key));
+
+    damaged.assign(original.begin(), original.end() - 1);
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects truncated file", !cooked.Open(fileName, key));
+
+    damaged.assign(original.begin(), original.begin() + 64);
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects header only", !cooked.Open(fileName, key));
+
+    damaged = original;
+    damaged.push_back(0);
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects extra bytes", !cooked.Open(fileName, key));
+
+    // Sections follow the 208 byte header, each on a 16 byte boundary
+    size_t elementsStart  = 208;
+    size_t subMeshesStart = (elementsStart + mesh.elements.size() * sizeof(VertexElement) + 15) & ~size_t(15);
+
+    damaged = original;
+    SubMesh badSubMesh = mesh.subMeshes.back();
+    badSubMesh.numIndices += 3;
+    std::memcpy(&damaged[subMeshesStart + sizeof(SubMesh) * (mesh.subMeshes.size() - 1)], &badSubMesh, sizeof(SubMesh));
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects sub-mesh outside buffers", !cooked.Open(fileName, key));
+
+    damaged = original;
+    VertexElement badElement = mesh.elements.back();
+    badElement.offset = mesh.vertexSize - 4;
+    std::memcpy(&damaged[elementsStart + sizeof(VertexElement) * (mesh.elements.size() - 1)], &badElement, sizeof(VertexElement));
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects element outside vertex", !cooked.Open(fileName, key));
+
+    WriteFile(fileName, original);
+    Check("CookedMesh: opens after damage is repaired", cooked.Open(fileName, key));
+    cooked.Close();
+
+    // Damage to compressed vertices or indices that the codec notices must be rejected. The vertex section
+    // follows the elements and sub-meshes (no LODs or meshlets), the indices are at the end of the file
+    WriteCookedMesh(fileName, key, mesh.View(), true);
+    original = ReadFile(fileName);
+    size_t verticesStart = (subMeshesStart + mesh.subMeshes.size() * sizeof(SubMesh) + 15) & ~size_t(15);
+    damaged = original;
+    std::fill(damaged.begin() + verticesStart, damaged.begin() + verticesStart + 16, static_cast<unsigned char>(0xFF));
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects damaged compressed vertices", !cooked.Open(fileName, key));
+
+    damaged = original;
+    std::fill(damaged.end() - 64, damaged.end(), static_cast<unsigned char>(0xFF));
+    WriteFile(fileName, damaged);
+    Check("CookedMesh: rejects damaged compressed indices", !cooked.Open(fileName, key));
+
+    WriteFile(fileName, original);
+    Check("CookedMesh: opens compressed file after damage is repaired", cooked.Open(fileName, key) && SameMesh(mesh.View(), cooked.View()));
+    cooked.Close();
+
+    std::remove(fileName.c_str());
+}
+
+
+// Distance between two floats in units in the last place
+int64_t UlpDistance(float a, float b)
+{
+    int32_t ia, ib;
+    std::memcpy(&ia, &a, 4);
+    std::memcpy(&ib, &b, 4);
+    if (ia < 0)  ia = INT32_MIN - ia; // Make the integers ordered the same way as the floats
+    if (ib < 0)  ib = INT32_MIN - ib;
+    return std::abs(static_cast<int64_t>(ia) - ib);
+}
+
+void CheckParseFloat(unsigned int n)
+{
+    // Numbers printed in the ways .x and other text mesh files do, and some awkward cases
+    const char* formats[] = { "%.6f", "%f", "%g", "%.9g", "%e", "%.3e", "%.12f" };
+    std::vector<std::string> numbers = { "0", "-0", "1", "-1", ".5", "5.", "1e10", "1.5E-7", "123456789012345678901234",
+                                         "0.000000000000000000000000000001", "3.4028234e38", "1e-45", "16777217", "0.1" };
+    char text[64];
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        float f = Random(-1, 1) * std::pow(10.0f, Random(-8, 8));
+        std::snprintf(text, sizeof(text), formats[i % 7], f);
+        numbers.push_back(text);
+    }
+
+    int64_t maxUlps = 0;
+    bool allParsed = true;
+    unsigned int numExact = 0;
+    for (const std::string& number : numbers)
+    {
+        float value;
+        const char* end = ParseFloat(number.data(), number.data() + number.size(), value);
+        if (end != number.data() + number.size())  allParsed = false;
+        int64_t ulps = UlpDistance(value, std::strtof(number.c_str(), nullptr));
+        maxUlps = std::max(maxUlps, ulps);
+        if (ulps == 0)  ++numExact;
+    }
+    Check("ParseFloat: reads whole number", allParsed);
+    Check("ParseFloat: within 1 ulp of strtof (" + std::to_string(numExact) + " of " + std::to_string(numbers.size()) + " exact)", maxUlps <= 1);
+
+    float value;
+    const char* empty = "-.e5";
+    Check("ParseFloat: rejects text with no digits", ParseFloat(empty, empty + 4, value) == nullptr);
+    const char* partial = "2.5e;";
+    Check("ParseFloat: stops before exponent with no digits", ParseFloat(partial, partial + 5, value) == partial + 3 && value == 2.5f);
+}
+
+
+// Mesh is usable: has triangles, all indices are in range and the bounds are finite
+bool ValidMesh(const MeshData& mesh)
+{
+    if (mesh.subMeshes.empty() || mesh.indices.empty() || mesh.vertices.size() != mesh.numVertices * static_cast<size_t>(mesh.vertexSize))  return false;
+    for (const SubMesh& subMesh : mesh.subMeshes)
+    {
+        if (subMesh.numIndices % 3 != 0 || subMesh.baseVertex + subMesh.numVertices > mesh.numVertices)  return false;
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; ++i)
+        {
+            if (mesh.indices[i] >= subMesh.numVertices)  return false;
+        }
+    }
+    for (const MeshLOD& lod : mesh.lods)
+    {
+        if (lod.firstSubMesh + lod.numSubMeshes > mesh.subMeshes.size())  return false;
+    }
+    return std::isfinite(mesh.boundingSphere.radius) && std::isfinite(mesh.boundingBox.centre.x) &&
+           std::isfinite(mesh.boundingBox.centre.y) && std::isfinite(mesh.boundingBox.centre.z);
+}
+
+// Bounding boxes within a small fraction of the size of the mesh
+bool SimilarBounds(const CAABB& a, const CAABB& b)
+{
+    float tolerance = 1e-4f * std::max({ 1.0f, a.halfSize.x, a.halfSize.y, a.halfSize.z });
+    CVector3 d1 = a.Min() - b.Min();
+    CVector3 d2 = a.Max() - b.Max();
+    return std::abs(d1.x) <= tolerance && std::abs(d1.y) <= tolerance && std::abs(d1.z) <= tolerance &&
+           std::abs(d2.x) <= tolerance && std::abs(d2.y) <= tolerance && std::abs(d2.z) <= tolerance;
+}
+
+void CheckXFiles()
+{
+    std::vector<std::string> files = MediaXFiles();
+    Check("XFile: found .x files in " + gMediaFolder, !files.empty());
+
+    for (const std::string& file : files)
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData mesh;
+        bool loaded = LoadXFile(text.data(), text.size(), mesh);
+        Check("XFile: " + file + " loads", loaded);
+        if (!loaded)  continue;
+        Check("XFile: " + file + " is a valid mesh", ValidMesh(mesh));
+
+        for (bool doubles : { false, true })
+        {
+            std::vector<unsigned char> binary = TextXFileToBinary(text, doubles);
+            MeshData binaryMesh;
+            bool same = LoadXFile(binary.data(), binary.size(), binaryMesh) && SameMesh(mesh.View(), binaryMesh.View());
+            Check("XFile: " + file + (doubles ? " binary (doubles)" : " binary") + " gives same mesh", same);
+        }
+
+#ifdef MESH_BENCHMARK_ASSIMP
+        MeshData assimpMesh = ImportMeshAssimp(gMediaFolder + file, false);
+        Check("XFile: " + file + " same triangles as assimp", mesh.indices.size() == assimpMesh.indices.size());
+        Check("XFile: " + file + " same bounds as assimp", SimilarBounds(mesh.boundingBox, assimpMesh.boundingBox));
+#endif
+    }
+
+    // Damaged files must be rejected, not crash: every prefix of a small file and a file with a count too large
+    std::vector<unsigned char> cube = ReadFile(gMediaFolder + "Cube.x");
+    if (!cube.empty())
+    {
+        bool allRejected = true;
+        for (size_t size = 0; size < cube.size() - 8; size += 7)
+        {
+            std::vector<unsigned char> truncated(cube.begin(), cube.begin() + size);
+            MeshData mesh;
+            if (LoadXFile(truncated.data(), truncated.size(), mesh))  allRejected = false;
+        }
+        Check("XFile: rejects truncated files", allRejected);
+
+        std::string damaged(cube.begin(), cube.end());
+        size_t count = damaged.find(" 24;");
+        if (count != std::string::npos)  damaged.replace(count, 4, " 4000000000;");
+        MeshData mesh;
+        Check("XFile: rejects impossible counts", count != std::string::npos && !LoadXFile(damaged.data(), damaged.size(), mesh));
+
+        std::vector<unsigned char> compressed = cube;
+        std::memcpy(&compressed[8], "tzip", 4);
+        Check("XFile: rejects compressed files", !LoadXFile(compressed.data(), compressed.size(), mesh));
+    }
+}
+
+
+
+// Largest distance of a packed mesh's decoded positions from the original positions
+float MaxPositionError(const MeshData& original, const PackedMesh& packed)
+{
+    MeshDataView view = packed.View();
+    CVector3 scale, offset;
+    PositionDecoding(view, scale, offset);
+    const VertexElement* position = FindElement(view, "Position");
+
+    float maxError = 0;
+    for (uint32_t v = 0; v < original.numVertices; ++v)
+    {
+        const uint16_t* q = reinterpret_cast<const uint16_t*>(packed.vertices.data() + v * packed.vertexSize + position->offset);
+        CVector3 decoded = { q[0] / 65535.0f * scale.x + offset.x, q[1] / 65535.0f * scale.y + offset.y, q[2] / 65535.0f * scale.z + offset.z };
+        maxError = std::max(maxError, Length(decoded - *(const CVector3*)(original.vertices.data() + v * original.vertexSize)));
+    }
+    return maxError;
+}
+
+// Half of one quantisation step in each axis of the mesh's bounding box, the largest error a quantised
+// position should have (plus a little for float rounding)
+float PositionTolerance(const CAABB& box)
+{
+    return Length(box.halfSize) / 65535.0f * 1.01f + 1e-6f;
+}
+
+// The depth stream holds each packed position once, and every depth index gives the same position as the
+// index it stands for
+bool ValidDepthStream(const PackedMesh& packed)
+{
+    const VertexElement* position = FindElement(packed.View(), "Position");
+    uint32_t size = VertexFormatSize(position->format);
+    if (packed.numDepthVertices == 0 || packed.depthVertexSize != size ||
+        packed.depthIndexSize != (packed.numDepthVertices <= 65536 ? 2u : 4u))  return false;
+
+    std::vector<std::string> positions;
+    for (uint32_t v = 0; v < packed.numDepthVertices; ++v)
+    {
+        positions.emplace_back(reinterpret_cast<const char*>(packed.depthVertices.data()) + v * size, size);
+    }
+    std::sort(positions.begin(), positions.end());
+    if (std::unique(positions.begin(), positions.end()) != positions.end())  return false;
+
+    auto index = [](const std::vector<unsigned char>& indices, uint32_t indexSize, uint32_t i)
+    {
+        return (indexSize == 2) ? reinterpret_cast<const uint16_t*>(indices.data())[i] : reinterpret_cast<const uint32_t*>(indices.data())[i];
+    };
+    for (const SubMesh& subMesh : packed.subMeshes)
+    {
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; ++i)
+        {
+            uint32_t vertex = subMesh.baseVertex + index(packed.indices, packed.indexSize, i);
+            uint32_t depthVertex = index(packed.depthIndices, packed.depthIndexSize, i);
+            if (depthVertex >= packed.numDepthVertices ||
+                std::memcmp(&packed.vertices[static_cast<size_t>(vertex) * packed.vertexSize + position->offset],
+                            &packed.depthVertices[static_cast<size_t>(depthVertex) * size], size) != 0)  return false;
+        }
+    }
+    return true;
+}
+
+void CheckVertexPacking()
+{
+    for (bool tangents : { false, true })
+    {
+        std::string layout = tangents ? " (tangents)" : "";
+        MeshData mesh = GenerateMesh(5000, 3, tangents);
+
+        PackingReport report;
+        PackedMesh packed = PackMesh(mesh.View(), VertexProfile::Compact, &report);
+        Check("VertexPacking: compact vertex size" + layout, packed.vertexSize == (tangents ? 20u : 16u));
+        Check("VertexPacking: 16-bit indices" + layout, packed.indexSize == 2 && report.indexBytesAfter * 2 == report.indexBytesBefore);
+        Check("VertexPacking: positions within half a step" + layout, MaxPositionError(mesh, packed) <= PositionTolerance(mesh.boundingBox) &&
+                                                                      report.maxPositionError <= PositionTolerance(mesh.boundingBox));
+        Check("VertexPacking: normals within 0.005 degrees" + layout, report.maxNormalError < 0.005f && report.maxTangentError < 0.005f);
+        Check("VertexPacking: UVs within half float error" + layout, !report.uvsKeptAsFloat && report.maxUVError <= 1.0f / 4096);
+
+        // Indices have the same values, in 16 bits
+        bool sameIndices = true;
+        const uint16_t* indices16 = reinterpret_cast<const uint16_t*>(packed.indices.data());
+        for (size_t i = 0; i < mesh.indices.size(); ++i)  if (indices16[i] != mesh.indices[i])  sameIndices = false;
+        Check("VertexPacking: same index values" + layout, sameIndices);
+
+        // The full profile changes nothing but the index size
+        PackedMesh full = PackMesh(mesh.View(), VertexProfile::Full);
+        Check("VertexPacking: full profile keeps vertices" + layout, full.vertices == mesh.vertices && full.indexSize == 2);
+
+        // Both profiles have a depth stream of their packed positions
+        Check("VertexPacking: depth stream matches positions" + layout, ValidDepthStream(packed) && packed.depthVertexSize == 8 &&
+                                                                        ValidDepthStream(full) && full.depthVertexSize == 12);
+
+        // A packed mesh cooks and loads back the same
+        const std::string fileName = gTempFolder + "MeshBenchmarkPacked.cooked";
+        CookedMesh cooked;
+        bool same = WriteCookedMesh(fileName, 1, packed.View()) && cooked.Open(fileName, 1) && SameMesh(packed.View(), cooked.View());
+        Check("VertexPacking: packed mesh cooks and loads identical" + layout, same);
+        cooked.Close();
+        std::remove(fileName.c_str());
+    }
+
+    // A sub-mesh with more than 65536 vertices needs 32-bit indices
+    MeshData large = GenerateMesh(70000, 1, false);
+    PackedMesh largePacked = PackMesh(large.View(), VertexProfile::Full);
+    Check("VertexPacking: 32-bit indices for large sub-mesh", large.subMeshes[0].numVertices > 65536 && largePacked.indexSize == 4);
+    Check("VertexPacking: 32-bit depth indices for large mesh", largePacked.numDepthVertices > 65536 && ValidDepthStream(largePacked));
+
+    // Vertices split only by UV share a depth position
+    MeshData split = GenerateMesh(1000, 1, false);
+    UnweldVertices(split);
+    PackedMesh splitPacked = PackMesh(split.View(), VertexProfile::Full);
+    Check("VertexPacking: depth stream merges split vertices", ValidDepthStream(splitPacked) &&
+                                                               splitPacked.numDepthVertices * 4 < splitPacked.numVertices);
+
+    // UVs that half floats can't hold closely enough stay as floats
+    MeshData tiled = GenerateMesh(1000, 1, false);
+    const VertexElement* uvElement = FindElement(tiled.View(), "UV");
+    for (uint32_t v = 0; v < tiled.numVertices; ++v)  *(CVector2*)(tiled.vertices.data() + v * tiled.vertexSize + uvElement->offset) += CVector2(100.3f, 0);
+    PackingReport tiledReport;
+    PackedMesh tiledPacked = PackMesh(tiled.View(), VertexProfile::Compact, &tiledReport);
+    Check("VertexPacking: large UVs kept as floats", tiledReport.uvsKeptAsFloat && tiledPacked.vertexSize == 20 &&
+                                                     FindElement(tiledPacked.View(), "UV")->format == VertexFormat::Float2);
+
+    // Report the savings and errors for each .x file
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData mesh;
+        if (!LoadXFile(text.data(), text.size(), mesh))  continue;
+
+        PackingReport report;
+        PackedMesh packed = PackMesh(mesh.View(), VertexProfile::Compact, &report);
+        gPacking.push_back({ file, report, packed.numVertices, packed.numDepthVertices });
+        Check("VertexPacking: " + file + " positions within half a step", MaxPositionError(mesh, packed) <= PositionTolerance(mesh.boundingBox));
+        Check("VertexPacking: " + file + " normals within 0.005 degrees", report.maxNormalError < 0.005f);
+        Check("VertexPacking: " + file + " depth stream matches positions", ValidDepthStream(packed));
+    }
+
+    for (const PackingResult& r : gPacking)
+    {
+        const PackingReport& p = r.report;
+        std::fprintf(stderr, "%-20s vertices %9zu -> %9zu bytes, indices %9zu -> %9zu bytes, max error: position %.6f, normal %.4f deg, uv %.6f%s\n",
+                     r.file.c_str(), p.vertexBytesBefore, p.vertexBytesAfter, p.indexBytesBefore, p.indexBytesAfter,
+                     p.maxPositionError, p.maxNormalError, p.maxUVError, p.uvsKeptAsFloat ? " (float UVs)" : "");
+        std::fprintf(stderr, "%-20s depth stream %u of %u vertices, %zu bytes\n", "", r.depthVertices, r.vertices, p.depthBytes);
+    }
+}
+
+
+// The triangles of each sub-mesh as the bytes of their three vertices, sorted, to compare meshes whose
+// triangles and vertices have been reordered
+std::vector<std::vector<std::string>> SortedTriangles(const MeshData& mesh)
+{
+    std::vector<std::vector<std::string>> subMeshTriangles;
+    for (const SubMesh& subMesh : mesh.subMeshes)
+    {
+        std::vector<std::string> triangles;
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; i += 3)
+        {
+            std::string triangle;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const char* vertex = reinterpret_cast<const char*>(mesh.vertices.data()) + (subMesh.baseVertex + mesh.indices[i + c]) * mesh.vertexSize;
+                triangle.append(vertex, mesh.vertexSize);
+            }
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        subMeshTriangles.push_back(triangles);
+    }
+    return subMeshTriangles;
+}
+
+// Put the triangles and vertices of each sub-mesh in a random order, the worst case for the vertex cache and
+// for reading the vertex buffer
+void ShuffleMesh(MeshData& mesh)
+{
+    for (const SubMesh& subMesh : mesh.subMeshes)
+    {
+        uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+        for (uint32_t t = subMesh.numIndices / 3 - 1; t > 0; --t)
+        {
+            uint32_t other = std::uniform_int_distribution<uint32_t>(0, t)(gRandom);
+            for (int c = 0; c < 3; ++c)  std::swap(indices[t * 3 + c], indices[other * 3 + c]);
+        }
+
+        std::vector<uint32_t> newVertex(subMesh.numVertices);
+        for (uint32_t v = 0; v < subMesh.numVertices; ++v)  newVertex[v] = v;
+        std::shuffle(newVertex.begin(), newVertex.end(), gRandom);
+        std::vector<unsigned char> vertices(mesh.vertices.begin() + subMesh.baseVertex * mesh.vertexSize,
+                                            mesh.vertices.begin() + (subMesh.baseVertex + subMesh.numVertices) * mesh.vertexSize);
+        for (uint32_t v = 0; v < subMesh.numVertices; ++v)
+        {
+            std::memcpy(mesh.vertices.data() + (subMesh.baseVertex + newVertex[v]) * mesh.vertexSize, vertices.data() + v * mesh.vertexSize, mesh.vertexSize);
+        }
+        for (uint32_t i = 0; i < subMesh.numIndices; ++i)  indices[i] = newVertex[indices[i]];
+    }
+}
+
+void CheckMeshOptimiser()
+{
+    // A shuffled grid must come out with about the vertex reuse of a well ordered grid (0.5 is the ideal) and
+    // its vertices in order
+    MeshData mesh = GenerateMesh(5000, 3, false);
+    ShuffleMesh(mesh);
+    MeshData optimised = mesh;
+    MeshOptimisationReport report;
+    OptimiseMesh(optimised, &report);
+    Check("MeshOptimiser: valid mesh", ValidMesh(optimised));
+    Check("MeshOptimiser: same triangles", SortedTriangles(mesh) == SortedTriangles(optimised));
+    Check("MeshOptimiser: ACMR of shuffled grid below 0.8", report.original.acmr > 2 && report.vertexCache.acmr < 0.8f);
+    Check("MeshOptimiser: overdraw step keeps ACMR", report.overdraw.acmr <= report.vertexCache.acmr * 1.05f + 0.01f);
+    Check("MeshOptimiser: vertex fetch step reduces overfetch", report.vertexFetch.overfetch < report.overdraw.overfetch);
+    Check("MeshOptimiser: vertex fetch step keeps ACMR", report.vertexFetch.acmr == report.overdraw.acmr);
+
+    // Vertices no triangle uses are removed
+    MeshData unused = GenerateMesh(1000, 1, false);
+    CAABB box = unused.boundingBox;
+    std::vector<uint32_t>(unused.indices.begin(), unused.indices.end() - 3).swap(unused.indices);
+    unused.subMeshes[0].numIndices -= 3;
+    unused.vertices.resize(unused.vertices.size() + unused.vertexSize, 0);
+    ++unused.numVertices;
+    ++unused.subMeshes[0].numVertices;
+    OptimiseMesh(unused);
+    Check("MeshOptimiser: unused vertices removed", unused.numVertices < unused.subMeshes[0].numVertices + 2 &&
+                                                    unused.numVertices == unused.subMeshes[0].numVertices &&
+                                                    unused.boundingBox.halfSize.x <= box.halfSize.x && ValidMesh(unused));
+
+    // Report the gains for each .x file
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData original;
+        if (!LoadXFile(text.data(), text.size(), original))  continue;
+
+        MeshData mesh = original;
+        OptimisationResult result = { file, {} };
+        OptimiseMesh(mesh, &result.report);
+        gOptimisation.push_back(result);
+        const MeshOptimisationReport& r = result.report;
+        Check("MeshOptimiser: " + file + " same triangles", SortedTriangles(original) == SortedTriangles(mesh));
+        Check("MeshOptimiser: " + file + " ACMR no worse", r.vertexFetch.acmr <= r.original.acmr * 1.05f + 0.01f);
+        Check("MeshOptimiser: " + file + " overfetch no worse", r.vertexFetch.overfetch <= r.original.overfetch * MAX_OVERFETCH_INCREASE + 0.01f);
+    }
+
+    std::fprintf(stderr, "%-20s %-13s %6s %6s %8s %9s\n", "", "", "ACMR", "ATVR", "overdraw", "overfetch");
+    for (const OptimisationResult& r : gOptimisation)
+    {
+        const MeshEfficiency* steps[] = { &r.report.original, &r.report.vertexCache, &r.report.overdraw, &r.report.vertexFetch };
+        const char* names[] = { "original", "vertex cache", "overdraw", "vertex fetch" };
+        for (int i = 0; i < 4; ++i)
+        {
+            std::fprintf(stderr, "%-20s %-13s %6.3f %6.3f %8.3f %9.3f\n", i == 0 ? r.file.c_str() : "", names[i],
+                         steps[i]->acmr, steps[i]->atvr, steps[i]->overdraw, steps[i]->overfetch);
+        }
+    }
+}
+
+
+// Triangles of a mesh's level of detail
+uint32_t LODTriangles(const MeshData& mesh, const MeshLOD& lod)
+{
+    uint32_t numTriangles = 0;
+    for (uint32_t s = lod.firstSubMesh; s < lod.firstSubMesh + lod.numSubMeshes; ++s)  numTriangles += mesh.subMeshes[s].numIndices / 3;
+    return numTriangles;
+}
+
+// Levels of detail are valid: LOD 0 is the mesh as it was, each LOD has a sub-mesh using the vertices of each
+// full detail part, fewer triangles and no less error than the one before
+bool ValidLODs(const MeshData& original, const MeshData& mesh)
+{
+    if (mesh.lods.size() < 2 || mesh.lods[0].firstSubMesh != 0 || mesh.lods[0].numSubMeshes != original.subMeshes.size() ||
+        mesh.vertices != original.vertices || !std::equal(original.indices.begin(), original.indices.end(), mesh.indices.begin()))  return false;
+    for (size_t l = 0; l < mesh.lods.size(); ++l)
+    {
+        const MeshLOD& lod = mesh.lods[l];
+        if (lod.numSubMeshes != original.subMeshes.size() || lod.numTriangles != LODTriangles(mesh, lod))  return false;
+        if (l > 0 && (lod.numTriangles >= mesh.lods[l - 1].numTriangles || lod.error < mesh.lods[l - 1].error))  return false;
+        for (uint32_t p = 0; p < lod.numSubMeshes; ++p)
+        {
+            const SubMesh& part = original.subMeshes[p];
+            const SubMesh& subMesh = mesh.subMeshes[lod.firstSubMesh + p];
+            if (subMesh.baseVertex != part.baseVertex || subMesh.numVertices != part.numVertices)  return false;
+        }
+    }
+    return true;
+}
+
+// Bounding box of the vertices used by a level of detail
+CAABB LODBounds(const MeshData& mesh, const MeshLOD& lod)
+{
+    MeshData used = mesh;
+    used.indices.clear();
+    used.subMeshes.assign(mesh.subMeshes.begin() + lod.firstSubMesh, mesh.subMeshes.begin() + lod.firstSubMesh + lod.numSubMeshes);
+    for (SubMesh& subMesh : used.subMeshes)
+    {
+        uint32_t start = static_cast<uint32_t>(used.indices.size());
+        used.indices.insert(used.indices.end(), mesh.indices.begin() + subMesh.startIndex, mesh.indices.begin() + subMesh.startIndex + subMesh.numIndices);
+        subMesh.startIndex = start;
+    }
+    used.lods.clear();
+    OptimiseVertexFetch(used); // Removes unused vertices and recalculates the bounds
+    return used.boundingBox;
+}
+
+void CheckMeshSimplifier()
+{
+    // A bumpy grid simplifies into a chain of LODs
+    MeshData mesh = GenerateMesh(20000, 2, false);
+    OptimiseMesh(mesh);
+    MeshData simplified = mesh;
+    GenerateLODs(simplified);
+    Check("MeshSimplifier: valid mesh", ValidMesh(simplified));
+    Check("MeshSimplifier: valid levels of detail", ValidLODs(mesh, simplified));
+    Check("MeshSimplifier: full chain of levels of detail", simplified.lods.size() == MAX_MESH_LODS &&
+          simplified.lods.back().numTriangles < simplified.lods[0].numTriangles / 8);
+
+    // A flat grid simplifies with no error and keeps its outline
+    MeshData flat = GenerateMesh(20000, 1, false);
+    const VertexElement* position = FindElement(flat.View(), "Position");
+    for (uint32_t v = 0; v < flat.numVertices; ++v)  reinterpret_cast<CVector3*>(&flat.vertices[v * flat.vertexSize + position->offset])->y = 0;
+    CalculateBounds(flat);
+    OptimiseMesh(flat);
+    MeshData flatSimplified = flat;
+    GenerateLODs(flatSimplified);
+    Check("MeshSimplifier: flat grid valid levels of detail", ValidLODs(flat, flatSimplified));
+    Check("MeshSimplifier: flat grid has no error", !flatSimplified.lods.empty() && flatSimplified.lods.back().error < 1e-4f &&
+          flatSimplified.lods.back().numTriangles < flatSimplified.lods[0].numTriangles / 8);
+    Check("MeshSimplifier: flat grid keeps its outline", !flatSimplified.lods.empty() &&
+          SimilarBounds(LODBounds(flatSimplified, flatSimplified.lods.back()), flat.boundingBox));
+
+    // A grid with a seam down the middle (the UVs split) simplifies with each side's triangles using only that
+    // side's vertices, the seam vertices moving along the seam in pairs
+    MeshData seamed = GenerateMesh(20000, 1, false);
+    const uint32_t side = static_cast<uint32_t>(std::sqrt(static_cast<float>(seamed.numVertices)));
+    const float seamX = static_cast<float>(side / 2);
+    const VertexElement* seamedPosition = FindElement(seamed.View(), "Position");
+    const VertexElement* seamedUV       = FindElement(seamed.View(), "UV");
+    std::vector<uint32_t> rightVertex(seamed.numVertices);
+    for (uint32_t v = 0; v < side * side; ++v)
+    {
+        rightVertex[v] = v;
+        if (v % side != side / 2)  continue;
+        rightVertex[v] = seamed.numVertices++;
+        seamed.vertices.insert(seamed.vertices.end(), seamed.vertices.begin() + v * seamed.vertexSize, seamed.vertices.begin() + (v + 1) * seamed.vertexSize);
+        reinterpret_cast<CVector2*>(&seamed.vertices[rightVertex[v] * seamed.vertexSize + seamedUV->offset])->x += 1;
+    }
+    for (size_t i = 0; i < seamed.indices.size(); i += 3)
+    {
+        if (std::all_of(&seamed.indices[i], &seamed.indices[i] + 3, [&](uint32_t v) { return v % side <= side / 2; }))  continue;
+        for (size_t c = i; c < i + 3; ++c)  seamed.indices[c] = rightVertex[seamed.indices[c]];
+    }
+    seamed.subMeshes[0].numVertices = seamed.numVertices;
+    OptimiseMesh(seamed);
+    MeshData seamedSimplified = seamed;
+    GenerateLODs(seamedSimplified);
+    auto rightSide = [&](uint32_t v)
+    {
+        const unsigned char* vertex = &seamedSimplified.vertices[v * seamedSimplified.vertexSize];
+        float x = reinterpret_cast<const CVector3*>(vertex + seamedPosition->offset)->x;
+        return x > seamX || (x == seamX && reinterpret_cast<const CVector2*>(vertex + seamedUV->offset)->x > 1);
+    };
+    bool sidesKept = true;
+    for (size_t i = 0; i < seamedSimplified.indices.size(); i += 3)
+    {
+        sidesKept = sidesKept && rightSide(seamedSimplified.indices[i]) == rightSide(seamedSimplified.indices[i + 1]) &&
+                                 rightSide(seamedSimplified.indices[i]) == rightSide(seamedSimplified.indices[i + 2]);
+    }
+    Check("MeshSimplifier: seam valid levels of detail", ValidLODs(seamed, seamedSimplified));
+    Check("MeshSimplifier: seam moves along itself", seamedSimplified.lods.size() >= 3 && sidesKept);
+
+    // Small meshes are left alone
+    MeshData small = GenerateMesh(25, 1, false);
+    GenerateLODs(small);
+    Check("MeshSimplifier: small mesh has no levels of detail", small.lods.empty());
+
+    // Report the levels of detail for each .x file
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData original;
+        if (!LoadXFile(text.data(), text.size(), original))  continue;
+
+        OptimiseMesh(original);
+        MeshData lodMesh = original;
+        GenerateLODs(lodMesh);
+        Check("MeshSimplifier: " + file + " valid mesh", ValidMesh(lodMesh));
+        Check("MeshSimplifier: " + file + " valid levels of detail", lodMesh.lods.empty() || ValidLODs(original, lodMesh));
+        Check("MeshSimplifier: " + file + " at least 3 levels of detail", original.indices.size() / 3 < MIN_LOD_TRIANGLES || lodMesh.lods.size() >= 3);
+        gLODs.push_back({ file, original.boundingSphere.radius, lodMesh.lods });
+    }
+
+    std::fprintf(stderr, "%-20s %4s %9s %10s %12s\n", "", "LOD", "triangles", "error", "error/radius");
+    for (const LODResult& r : gLODs)
+    {
+        for (size_t l = 0; l < r.lods.size(); ++l)
+        {
+            std::fprintf(stderr, "%-20s %4zu %9u %10.4g %12.4g\n", l == 0 ? r.file.c_str() : "", l, r.lods[l].numTriangles,
+                         r.lods[l].error, r.radius > 0 ? r.lods[l].error / r.radius : 0);
+        }
+        if (r.lods.empty())  std::fprintf(stderr, "%-20s none\n", r.file.c_str());
+    }
+}
+
+
+// A frustum containing everything
+CFrustum OpenFrustum()
+{
+    CFrustum frustum;
+    for (CPlane& plane : frustum.planes)  plane = CPlane({ 0, 1, 0 }, 1e30f);
+    return frustum;
+}
+
+// Position of a vertex of a sub-mesh of a mesh with the import layout
+CVector3 SubMeshPosition(const MeshData& mesh, const SubMesh& subMesh, uint32_t index)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    CVector3 p;
+    std::memcpy(&p, &mesh.vertices[static_cast<size_t>(subMesh.baseVertex + index) * mesh.vertexSize + position->offset], sizeof(p));
+    return p;
+}
+
+// Number of full detail sub-meshes, the ones split into meshlets
+uint32_t FullDetailParts(const MeshData& mesh)
+{
+    return mesh.lods.empty() ? static_cast<uint32_t>(mesh.subMeshes.size()) : mesh.lods[0].numSubMeshes;
+}
+
+// Meshlets keep to the limits, cover each full detail sub-mesh in order and bound their vertices and normals
+bool ValidMeshlets(const MeshData& mesh)
+{
+    uint32_t numParts = FullDetailParts(mesh);
+    uint32_t part = 0, nextIndex = mesh.subMeshes[0].startIndex;
+    auto skipCovered = [&]
+    {
+        while (part < numParts && nextIndex == mesh.subMeshes[part].startIndex + mesh.subMeshes[part].numIndices)
+        {
+            if (++part < numParts)  nextIndex = mesh.subMeshes[part].startIndex;
+        }
+    };
+    for (const Meshlet& meshlet : mesh.meshlets)
+    {
+        // Ranges follow on from each other, moving to the next sub-mesh when one is covered
+        skipCovered();
+        if (part >= numParts || meshlet.subMesh != part || meshlet.startIndex != nextIndex || meshlet.numIndices == 0 ||
+            meshlet.numIndices > MAX_MESHLET_TRIANGLES * 3 || meshlet.numVertices > MAX_MESHLET_VERTICES)  return false;
+        nextIndex += meshlet.numIndices;
+
+        const SubMesh& subMesh = mesh.subMeshes[part];
+        std::vector<uint32_t> used(mesh.indices.begin() + meshlet.startIndex, mesh.indices.begin() + meshlet.startIndex + meshlet.numIndices);
+        std::sort(used.begin(), used.end());
+        if (std::unique(used.begin(), used.end()) - used.begin() != meshlet.numVertices)  return false;
+
+        float minDot = std::sqrt(std::max(1 - meshlet.coneCutoff * meshlet.coneCutoff, 0.0f)) - 1e-4f;
+        for (uint32_t i = meshlet.startIndex; i < meshlet.startIndex + meshlet.numIndices; i += 3)
+        {
+            CVector3 p[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                p[c] = SubMeshPosition(mesh, subMesh, mesh.indices[i + c]);
+                if (Length(p[c] - meshlet.centre) > meshlet.radius * 1.0001f + 1e-6f)  return false;
+            }
+            CVector3 normal = Cross(p[1] - p[0], p[2] - p[0]);
+            if (meshlet.coneCutoff < 1 && Length(normal) > 0 && Dot(normal, meshlet.coneAxis) < minDot * Length(normal))  return false;
+        }
+    }
+    skipCovered();
+    return part == numParts;
+}
+
+// A triangle as its sub-mesh and sorted indices, for finding it in a culled index list
+using PartTriangle = std::array<uint32_t, 4>;
+PartTriangle MakePartTriangle(uint32_t part, const uint32_t* triangle)
+{
+    PartTriangle t = {{ part, triangle[0], triangle[1], triangle[2] }};
+    std::sort(t.begin() + 1, t.end());
+    return t;
+}
+
+// Cull the meshlets of a mesh with 32-bit indices and check every triangle the rasteriser would keep, and that
+// is in front of clipPlane, is still there. Returns the fraction of triangles left, or -1 if one is missing
+float CheckCulledMeshlets(const MeshData& mesh, MeshletCuller& culler, const CVector3& camera, FaceCulling faceCulling,
+                          const CPlane& clipPlane)
+{
+    CFrustum frustum = OpenFrustum();
+    frustum.planes[CFrustum::Left] = clipPlane;
+    uint32_t numTriangles = culler.Cull(frustum, camera, faceCulling);
+
+    std::vector<PartTriangle> kept;
+    const uint32_t* indices = static_cast<const uint32_t*>(culler.Indices());
+    for (uint32_t part = 0; part < culler.SubMeshes().size(); ++part)
+    {
+        const SubMesh& subMesh = culler.SubMeshes()[part];
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; i += 3)  kept.push_back(MakePartTriangle(part, indices + i));
+    }
+    std::sort(kept.begin(), kept.end());
+    if (kept.size() != numTriangles)  return -1;
+
+    uint32_t total = 0;
+    for (uint32_t part = 0; part < FullDetailParts(mesh); ++part)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[part];
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; i += 3, ++total)
+        {
+            CVector3 p0 = SubMeshPosition(mesh, subMesh, mesh.indices[i]);
+            CVector3 p1 = SubMeshPosition(mesh, subMesh, mesh.indices[i + 1]);
+            CVector3 p2 = SubMeshPosition(mesh, subMesh, mesh.indices[i + 2]);
+            float facing = Dot(Cross(p1 - p0, p2 - p0), p0 - camera); // Negative if facing the camera
+            if ((faceCulling == FaceCulling::Back && facing >= 0) || (faceCulling == FaceCulling::Front && facing <= 0))  continue;
+            if (clipPlane.Distance(p0) < 0 && clipPlane.Distance(p1) < 0 && clipPlane.Distance(p2) < 0)  continue;
+            if (!std::binary_search(kept.begin(), kept.end(), MakePartTriangle(part, &mesh.indices[i])))  return -1;
+        }
+    }
+    return numTriangles / static_cast<float>(total);
+}
+
+void CheckMeshlets()
+{
+    const CPlane noClip = CPlane({ 0, 1, 0 }, 1e30f);
+
+    MeshData mesh = GenerateMesh(20000, 2, false);
+    OptimiseMesh(mesh);
+    MeshData withMeshlets = mesh;
+    BuildMeshlets(withMeshlets);
+    Check("Meshlets: valid", !withMeshlets.meshlets.empty() && ValidMeshlets(withMeshlets));
+    Check("Meshlets: same triangles", SortedTriangles(withMeshlets) == SortedTriangles(mesh));
+
+    // With nothing culled the index list is the whole full detail mesh, LODs are left out
+    GenerateLODs(withMeshlets);
+    MeshletCuller culler;
+    culler.Init(withMeshlets.View());
+    uint32_t numTriangles = culler.Cull(OpenFrustum(), { 0, 0, 0 }, FaceCulling::None);
+    Check("Meshlets: nothing culled keeps every triangle", !withMeshlets.lods.empty() && numTriangles == withMeshlets.lods[0].numTriangles &&
+          culler.NumVisibleMeshlets() == culler.NumMeshlets() &&
+          std::memcmp(culler.Indices(), withMeshlets.indices.data(), culler.NumIndices() * sizeof(uint32_t)) == 0);
+
+    // A plane through the middle of the mesh culls meshlets but keeps every triangle in front of it
+    CVector3 centre = withMeshlets.boundingBox.centre;
+    float kept = CheckCulledMeshlets(withMeshlets, culler, centre, FaceCulling::None, CPlane({ 0, 0, 1 }, -centre.z));
+    Check("Meshlets: frustum culling keeps visible triangles", kept > 0.3f && kept < 0.7f);
+
+    // Culling faces keeps every triangle facing the right way from every direction, for the .x files too
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData fileMesh;
+        if (!LoadXFile(text.data(), text.size(), fileMesh))  continue;
+        OptimiseMesh(fileMesh);
+        BuildMeshlets(fileMesh);
+        if (fileMesh.meshlets.empty())  continue;
+        Check("Meshlets: " + file + " valid", ValidMeshlets(fileMesh));
+
+        culler.Init(fileMesh.View());
+        MeshletResult result = { file, culler.NumMeshlets(), 0, 0, 0 };
+        for (const Meshlet& meshlet : fileMesh.meshlets)
+        {
+            result.vertices  += meshlet.numVertices;
+            result.triangles += meshlet.numIndices / 3;
+        }
+        result.vertices  /= result.meshlets;
+        result.triangles /= result.meshlets;
+
+        const CSphere& sphere = fileMesh.boundingSphere;
+        bool backPass = true, frontPass = true;
+        for (int axis = 0; axis < 6; ++axis)
+        {
+            CVector3 direction = { 0, 0, 0 };
+            (&direction.x)[axis / 2] = (axis % 2 == 0) ? 1.0f : -1.0f;
+            CVector3 camera = sphere.centre + direction * (3 * sphere.radius);
+            float backKept = CheckCulledMeshlets(fileMesh, culler, camera, FaceCulling::Back, noClip);
+            backPass  = backPass  && backKept >= 0;
+            frontPass = frontPass && CheckCulledMeshlets(fileMesh, culler, camera, FaceCulling::Front, noClip) >= 0;
+            result.backFacingKept += backKept / 6;
+        }
+        Check("Meshlets: " + file + " back face culling keeps front faces", backPass);
+        Check("Meshlets: " + file + " front face culling keeps back faces", frontPass);
+        gMeshlets.push_back(result);
+    }
+
+    // Small meshes are drawn whole
+    MeshData small = GenerateMesh(400, 1, false);
+    BuildMeshlets(small);
+    Check("Meshlets: small mesh has no meshlets", small.meshlets.empty());
+
+    std::fprintf(stderr, "%-20s %8s %9s %10s %10s\n", "", "meshlets", "vertices", "triangles", "back face");
+    for (const MeshletResult& r : gMeshlets)
+    {
+        std::fprintf(stderr, "%-20s %8u %9.1f %10.1f %9.1f%%\n", r.file.c_str(), r.meshlets, r.vertices, r.triangles, r.backFacingKept * 100);
+    }
+}
+
+
+// Largest angle in degrees between the given element (e.g. "Normal") of the corners of two meshes with the same
+// triangles in the same order, whatever their vertices
+float MaxCornerAngle(const MeshData& a, const MeshData& b, const char* semantic)
+{
+    const VertexElement* elementA = FindElement(a.View(), semantic);
+    const VertexElement* elementB = FindElement(b.View(), semantic);
+    if (elementA == nullptr || elementB == nullptr || a.indices.size() != b.indices.size() || a.subMeshes.size() != b.subMeshes.size())  return 180;
+
+    float maxAngle = 0;
+    for (size_t s = 0; s < a.subMeshes.size(); ++s)
+    {
+        const SubMesh& subMeshA = a.subMeshes[s];
+        const SubMesh& subMeshB = b.subMeshes[s];
+        for (uint32_t i = 0; i < subMeshA.numIndices; ++i)
+        {
+            const CVector3& va = *(const CVector3*)(a.vertices.data() + (subMeshA.baseVertex + a.indices[subMeshA.startIndex + i]) * a.vertexSize + elementA->offset);
+            const CVector3& vb = *(const CVector3*)(b.vertices.data() + (subMeshB.baseVertex + b.indices[subMeshB.startIndex + i]) * b.vertexSize + elementB->offset);
+            maxAngle = std::max(maxAngle, std::atan2(Length(Cross(va, vb)), Dot(va, vb)) * 57.2957795f);
+        }
+    }
+    return maxAngle;
+}
+
+bool SameBuffers(const MeshData& a, const MeshData& b)
+{
+    return a.vertices == b.vertices && a.indices == b.indices && a.numVertices == b.numVertices;
+}
+
+// A flat version of a generated grid, facing up
+void FlattenMesh(MeshData& mesh)
+{
+    uint32_t positionOffset = FindElement(mesh.View(), "Position")->offset;
+    uint32_t normalOffset   = FindElement(mesh.View(), "Normal")->offset;
+    for (uint32_t v = 0; v < mesh.numVertices; ++v)
+    {
+        unsigned char* vertex = mesh.vertices.data() + v * mesh.vertexSize;
+        ((CVector3*)(vertex + positionOffset))->y = 0;
+        *(CVector3*)(vertex + normalOffset) = { 0, 1, 0 };
+    }
+}
+
+#ifdef MESH_BENCHMARK_ASSIMP
+// Mean angle in degrees between the normals and tangents of a mesh and those assimp calculates for the same
+// file (with the normals in the file removed). Vertices are matched by position, taking the closest normal
+// where assimp has several vertices at a position. Returns false if the file can't be read
+bool AngleToAssimp(const std::string& fileName, const MeshData& mesh, float& normalAngle, float& tangentAngle)
+{
+    Assimp::Importer importer;
+    importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, MAX_SMOOTHING_ANGLE);
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_NORMALS | aiComponent_TANGENTS_AND_BITANGENTS);
+    const aiScene* scene = importer.ReadFile(fileName, aiProcess_MakeLeftHanded | aiProcess_FlipUVs | aiProcess_FlipWindingOrder |
+                                                       aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_RemoveComponent |
+                                                       aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+    if (scene == nullptr)  return false;
+
+    struct AssimpVertex
+    {
+        std::string position; // Rounded position as text
+        CVector3    normal;
+        CVector3    tangent;
+    };
+    auto positionKey = [](float x, float y, float z)
+    {
+        char key[64];
+        std::snprintf(key, sizeof(key), "%.4g %.4g %.4g", x, y, z);
+        return std::string(key);
+    };
+    auto byPosition = [](const AssimpVertex& a, const AssimpVertex& b) { return a.position < b.position; };
+
+    std::vector<AssimpVertex> assimpVertices;
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
+    {
+        const aiMesh* assimpMesh = scene->mMeshes[m];
+        if (!assimpMesh->HasNormals() || !assimpMesh->HasTangentsAndBitangents())  continue;
+        for (unsigned int v = 0; v < assimpMesh->mNumVertices; ++v)
+        {
+            const aiVector3D& p = assimpMesh->mVertices[v];
+            const aiVector3D& n = assimpMesh->mNormals[v];
+            const aiVector3D& t = assimpMesh->mTangents[v];
+            assimpVertices.push_back({ positionKey(p.x, p.y, p.z), { n.x, n.y, n.z }, { t.x, t.y, t.z } });
+        }
+    }
+    std::sort(assimpVertices.begin(), assimpVertices.end(), byPosition);
+
+    uint32_t positionOffset = FindElement(mesh.View(), "Position")->offset;
+    uint32_t normalOffset   = FindElement(mesh.View(), "Normal")->offset;
+    uint32_t tangentOffset  = FindElement(mesh.View(), "Tangent")->offset;
+    auto angle = [](const CVector3& a, const CVector3& b) { return std::atan2(Length(Cross(a, b)), Dot(a, b)) * 57.2957795f; };
+    double normalSum = 0, tangentSum = 0;
+    uint32_t numMatched = 0;
+    for (uint32_t v = 0; v < mesh.numVertices; ++v)
+    {
+        const unsigned char* vertex = mesh.vertices.data() + v * mesh.vertexSize;
+        const CVector3& p = *(const CVector3*)(vertex + positionOffset);
+        AssimpVertex key = { positionKey(p.x, p.y, p.z), {}, {} };
+        auto range = std::equal_range(assimpVertices.begin(), assimpVertices.end(), key, byPosition);
+        if (range.first == range.second)  continue;
+
+        float bestNormal = 180, bestTangent = 180;
+        for (auto i = range.first; i != range.second; ++i)
+        {
+            float normalError = angle(*(const CVector3*)(vertex + normalOffset), i->normal);
+            if (normalError < bestNormal)
+            {
+                bestNormal  = normalError;
+                bestTangent = angle(*(const CVector3*)(vertex + tangentOffset), i->tangent);
+            }
+        }
+        normalSum  += bestNormal;
+        tangentSum += bestTangent;
+        ++numMatched;
+    }
+    normalAngle  = numMatched > 0 ? static_cast<float>(normalSum  / numMatched) : 180;
+    tangentAngle = numMatched > 0 ? static_cast<float>(tangentSum / numMatched) : 180;
+    return true;
+}
+#endif
+
+void CheckMeshProcessing()
+{
+    // Welding a mesh with a vertex per corner gets back the original vertices and triangles
+    MeshData mesh = GenerateMesh(20000, 3, true);
+    MeshData unwelded = mesh;
+    UnweldVertices(unwelded);
+    Check("MeshProcessing: unweld gives a vertex per corner", unwelded.numVertices == unwelded.indices.size() && ValidMesh(unwelded));
+    MeshData welded = unwelded;
+    WeldVertices(welded);
+    Check("MeshProcessing: weld restores vertices", welded.numVertices == mesh.numVertices && ValidMesh(welded));
+    Check("MeshProcessing: weld keeps triangles", SortedTriangles(welded) == SortedTriangles(mesh));
+
+    // With a tolerance, vertices moved slightly still weld
+    uint32_t positionOffset = FindElement(unwelded.View(), "Position")->offset;
+    for (uint32_t v = 0; v < unwelded.numVertices; ++v)
+    {
+        CVector3& p = *(CVector3*)(unwelded.vertices.data() + v * unwelded.vertexSize + positionOffset);
+        p += CVector3{ Random(-1e-3f, 1e-3f), Random(-1e-3f, 1e-3f), Random(-1e-3f, 1e-3f) };
+    }
+    MeshData nearlyWelded = unwelded;
+    WeldVertices(nearlyWelded, 1e-2f);
+    Check("MeshProcessing: weld with tolerance", nearlyWelded.numVertices == mesh.numVertices && ValidMesh(nearlyWelded));
+    WeldVertices(unwelded);
+    Check("MeshProcessing: exact weld ignores moved vertices", unwelded.numVertices > unwelded.indices.size() * 9 / 10);
+
+    // Every thread count gives exactly the same result
+    MeshData large = GenerateMesh(200000, 2, false);
+    ShuffleMesh(large);
+    UnweldVertices(large);
+    MeshData single = large, multiple = large;
+    WeldVertices(single, 0, 1);                                  WeldVertices(multiple, 0, 7);
+    bool sameWeld = SameBuffers(single, multiple);
+    GenerateSmoothNormals(single, MAX_SMOOTHING_ANGLE, true, 1); GenerateSmoothNormals(multiple, MAX_SMOOTHING_ANGLE, true, 7);
+    bool sameNormals = SameBuffers(single, multiple);
+    GenerateTangents(single, 1);                                 GenerateTangents(multiple, 7);
+    Check("MeshProcessing: same weld with 1 and 7 threads", sameWeld);
+    Check("MeshProcessing: same normals with 1 and 7 threads", sameNormals);
+    Check("MeshProcessing: same tangents with 1 and 7 threads", SameBuffers(single, multiple) && ValidMesh(multiple));
+
+    // Tangents of a flat grid point along x (the direction u increases). Mirroring the UVs on one half splits
+    // the column of vertices on the mirror line and gives that half tangents along -x
+    MeshData grid = GenerateMesh(400, 1, false);
+    FlattenMesh(grid);
+    MeshData mirrored = grid;
+    uint32_t side = static_cast<uint32_t>(std::sqrt(static_cast<float>(grid.numVertices)) + 0.5f);
+    uint32_t uvOffset = FindElement(mirrored.View(), "UV")->offset;
+    for (uint32_t v = 0; v < mirrored.numVertices; ++v)
+    {
+        CVector2& uv = *(CVector2*)(mirrored.vertices.data() + v * mirrored.vertexSize + uvOffset);
+        if (v % side > side / 2)  uv.x = 2 * (side / 2) / static_cast<float>(side - 1) - uv.x;
+    }
+    bool hasTangents = GenerateTangents(grid) && GenerateTangents(mirrored);
+    uint32_t tangentOffset = hasTangents ? FindElement(grid.View(), "Tangent")->offset : 0;
+    bool alongX = hasTangents;
+    for (uint32_t v = 0; v < grid.numVertices && hasTangents; ++v)
+    {
+        const CVector3& t = *(const CVector3*)(grid.vertices.data() + v * grid.vertexSize + tangentOffset);
+        alongX = alongX && std::abs(t.x - 1) < 1e-5f && std::abs(t.y) < 1e-5f && std::abs(t.z) < 1e-5f;
+    }
+    bool mirroredAlongX = hasTangents && mirrored.numVertices == grid.numVertices + side;
+    positionOffset = FindElement(mirrored.View(), "Position")->offset;
+    for (uint32_t i = 0; i < mirrored.indices.size() && mirroredAlongX; i += 3)
+    {
+        float x[3], tx[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            const unsigned char* vertex = mirrored.vertices.data() + mirrored.indices[i + c] * mirrored.vertexSize;
+            x[c]  = ((const CVector3*)(vertex + positionOffset))->x;
+            tx[c] = ((const CVector3*)(vertex + tangentOffset))->x;
+        }
+        float expected = (x[0] + x[1] + x[2] > 3 * (side / 2)) ? -1.0f : 1.0f;
+        for (int c = 0; c < 3; ++c)  mirroredAlongX = mirroredAlongX && std::abs(tx[c] - expected) < 1e-5f;
+    }
+    Check("MeshProcessing: flat grid tangents along x", alongX);
+    Check("MeshProcessing: mirrored UVs split vertices and flip tangents", mirroredAlongX);
+    MeshData noUVs;
+    noUVs.AddElement("Position", VertexFormat::Float3);
+    noUVs.AddElement("Normal",   VertexFormat::Float3);
+    Check("MeshProcessing: no tangents without UVs", !GenerateTangents(noUVs) && noUVs.elements.size() == 2);
+
+    // Normals calculated for the .x files are close to the normals in the files, and the cube keeps its hard
+    // edges. Every file is also loaded with its normals removed, which the native reader now calculates
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData original;
+        if (!LoadXFile(text.data(), text.size(), original))  continue;
+
+        MeshData smoothed = original;
+        GenerateSmoothNormals(smoothed);
+        float maxAngle = MaxCornerAngle(original, smoothed, "Normal");
+        std::fprintf(stderr, "%-20s calculated normals up to %6.2f degrees from file\n", file.c_str(), maxAngle);
+        if (file == "Cube.x")  Check("MeshProcessing: Cube.x normals keep hard edges", maxAngle < 0.01f && smoothed.numVertices == 24);
+        if (file == "Sphere.x")  Check("MeshProcessing: Sphere.x normals close to file", maxAngle < 5);
+
+        std::string noNormals(text.begin(), text.end());
+        size_t start;
+        while ((start = noNormals.find("MeshNormals")) != std::string::npos)
+        {
+            size_t end = noNormals.find('}', start);
+            if (end == std::string::npos)  break;
+            noNormals.erase(start, end + 1 - start);
+        }
+        MeshData calculated;
+        bool loaded = LoadXFile(noNormals.data(), noNormals.size(), calculated);
+        Check("MeshProcessing: " + file + " loads without normals", loaded && ValidMesh(calculated) && FindElement(calculated.View(), "Normal") != nullptr);
+
+#ifdef MESH_BENCHMARK_ASSIMP
+        MeshData withTangents = original;
+        float normalAngle, tangentAngle;
+        GenerateSmoothNormals(withTangents);
+        if (GenerateTangents(withTangents) && AngleToAssimp(gMediaFolder + file, withTangents, normalAngle, tangentAngle))
+        {
+            std::fprintf(stderr, "%-20s mean %.2f degrees from assimp normals, %.2f degrees from assimp tangents\n", file.c_str(), normalAngle, tangentAngle);
+            Check("MeshProcessing: " + file + " normals match assimp", normalAngle < 1);
+            Check("MeshProcessing: " + file + " tangents match assimp", tangentAngle < 5);
+        }
+#endif
+    }
+}
+
+// A ray for testing a BVH
+struct TestRay
+{
+    CVector3 origin;
+    CVector3 direction;
+};
+
+// Rays from random points around a mesh towards random points in its bounding box, so most hit the mesh and
+// some miss. The directions are not unit length, a ray reaches the box's far side at a distance of about 1.5
+std::vector<TestRay> RandomRays(const MeshData& mesh, unsigned int count)
+{
+    const CAABB& box = mesh.boundingBox;
+    const CSphere& sphere = mesh.boundingSphere;
+    std::vector<TestRay> rays(count);
+    for (TestRay& ray : rays)
+    {
+        CVector3 offset;
+        do
+        {
+            offset = { Random(-1, 1), Random(-1, 1), Random(-1, 1) };
+        } while (Dot(offset, offset) > 1 || Dot(offset, offset) < 0.01f);
+        ray.origin = sphere.centre + offset * (3 * sphere.radius / Length(offset));
+
+        CVector3 target = { Random(-1, 1), Random(-1, 1), Random(-1, 1) };
+        target = box.centre + CVector3{ target.x * box.halfSize.x, target.y * box.halfSize.y, target.z * box.halfSize.z };
+        ray.direction = target - ray.origin;
+    }
+    return rays;
+}
+
+
+// Every triangle is in one leaf, and every node's box contains its children's boxes
+bool ValidBVH(const MeshBVH& bvh)
+{
+    const std::vector<BVHNode>& nodes = bvh.Nodes();
+    if (nodes.empty())  return false;
+    auto inside = [](const BVHNode& child, const BVHNode& parent)
+    {
+        return child.boundsMin.x >= parent.boundsMin.x && child.boundsMin.y >= parent.boundsMin.y && child.boundsMin.z >= parent.boundsMin.z &&
+               child.boundsMax.x <= parent.boundsMax.x && child.boundsMax.y <= parent.boundsMax.y && child.boundsMax.z <= parent.boundsMax.z;
+    };
+
+    std::vector<bool> inLeaf(bvh.NumTriangles(), false);
+    std::vector<bool> isChild(nodes.size(), false);
+    for (const BVHNode& node : nodes)
+    {
+        if (node.numTriangles > 0)
+        {
+            if (node.leftFirst + node.numTriangles > bvh.NumTriangles())  return false;
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.numTriangles; ++i)
+            {
+                if (inLeaf[i])  return false;
+                inLeaf[i] = true;
+            }
+        }
+        else
+        {
+            if (node.leftFirst == 0 || node.leftFirst + 1 >= nodes.size() || isChild[node.leftFirst])  return false;
+            isChild[node.leftFirst] = isChild[node.leftFirst + 1] = true;
+            if (!inside(nodes[node.leftFirst], node) || !inside(nodes[node.leftFirst + 1], node))  return false;
+        }
+    }
+    return std::find(inLeaf.begin(), inLeaf.end(), false) == inLeaf.end();
+}
+
+
+// Trace rays with the BVH and by testing every triangle. Both must hit or miss, at the same distance (the
+// triangle may differ where two triangles meet). Returns the fraction of rays that hit, or -1 if any differ
+float CheckBVHRays(const MeshBVH& bvh, const MeshData& mesh, unsigned int count)
+{
+    unsigned int hits = 0;
+    for (const TestRay& ray : RandomRays(mesh, count))
+    {
+        RayHit hit, expected;
+        bool found = bvh.Intersect(ray.origin, ray.direction, 1, hit);
+        if (found != bvh.IntersectAll(ray.origin, ray.direction, 1, expected))  return -1;
+        if (!found)  continue;
+        if (std::abs(hit.distance - expected.distance) > 1e-6f ||
+            (hit.triangle == expected.triangle && (hit.u != expected.u || hit.v != expected.v)))  return -1;
+        ++hits;
+    }
+    return static_cast<float>(hits) / count;
+}
+
+
+void CheckMeshBVH()
+{
+    // A generated mesh as it is cooked, with the packed positions the Mesh class builds its BVH from
+    MeshData mesh = GenerateMesh(20000, 4, false);
+    OptimiseMesh(mesh);
+    BuildMeshlets(mesh);
+    GenerateLODs(mesh);
+    PackedMesh packed = PackMesh(mesh.View(), VertexProfile::Compact);
+
+    MeshBVH bvh;
+    bool built = bvh.Build(mesh.View());
+    Check("MeshBVH: valid", built && ValidBVH(bvh) && bvh.NumTriangles() == mesh.lods[0].numTriangles);
+    // Rays aim at random points in the bounding box, so many miss the generated surface, but plenty must hit
+    Check("MeshBVH: same hits as testing every triangle", CheckBVHRays(bvh, mesh, 2000) > 0.25f);
+
+    built = bvh.Build(packed.View());
+    Check("MeshBVH: packed mesh valid", built && ValidBVH(bvh));
+    Check("MeshBVH: packed mesh same hits as testing every triangle", CheckBVHRays(bvh, mesh, 2000) > 0.25f);
+
+    // The tree is the same with any number of threads, only the order of the nodes may change
+    MeshData large = GenerateMesh(100000, 2, false);
+    MeshBVH single, threaded;
+    single.Build(large.View(), 1);
+    threaded.Build(large.View(), 8);
+    bool same = single.Nodes().size() == threaded.Nodes().size() && ValidBVH(threaded) &&
+                std::abs(single.SAHCost() - threaded.SAHCost()) < 1e-4f * single.SAHCost();
+    for (const TestRay& ray : RandomRays(large, 2000))
+    {
+        RayHit a, b;
+        bool hitA = single.Intersect(ray.origin, ray.direction, 1, a);
+        bool hitB = threaded.Intersect(ray.origin, ray.direction, 1, b);
+        same = same && hitA == hitB && (!hitA || (a.distance == b.distance && a.triangle == b.triangle));
+    }
+    Check("MeshBVH: same with 1 and 8 threads", same);
+
+    // Rays that stop short of the mesh or start past it hit nothing
+    const CSphere& sphere = mesh.boundingSphere;
+    CVector3 origin = sphere.centre + CVector3{ 0, 0, -3 * sphere.radius };
+    RayHit hit;
+    Check("MeshBVH: short and backwards rays miss", !bvh.Intersect(origin, { 0, 0, sphere.radius }, 1, hit) &&
+                                                     !bvh.Intersect(origin, { 0, 0, -sphere.radius }, 100, hit));
+
+    // The .x files
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData fileMesh;
+        if (!LoadXFile(text.data(), text.size(), fileMesh))  continue;
+        built = bvh.Build(fileMesh.View());
+        Check("MeshBVH: " + file + " valid", built && ValidBVH(bvh));
+        Check("MeshBVH: " + file + " same hits as testing every triangle", CheckBVHRays(bvh, fileMesh, 500) >= 0);
+    }
+}
+
+
+// Compress and decompress vertices, returns true if they come back exactly
+bool VerticesRoundTrip(const void* vertices, uint32_t numVertices, uint32_t vertexSize, const VertexElement* elements, uint32_t numElements)
+{
+    std::vector<unsigned char> encoded = EncodeVertices(vertices, numVertices, vertexSize, elements, numElements);
+    std::vector<unsigned char> decoded(static_cast<size_t>(numVertices) * vertexSize + 1, 0xCD);
+    return DecodeVertices(encoded.data(), encoded.size(), decoded.data(), numVertices, vertexSize, elements, numElements) &&
+           std::memcmp(decoded.data(), vertices, decoded.size() - 1) == 0 && decoded.back() == 0xCD;
+}
+
+// The same for indices
+bool IndicesRoundTrip(const void* indices, uint32_t numIndices, uint32_t indexSize)
+{
+    std::vector<unsigned char> encoded = EncodeIndices(indices, numIndices, indexSize);
+    std::vector<unsigned char> decoded(static_cast<size_t>(numIndices) * indexSize + 1, 0xCD);
+    return DecodeIndices(encoded.data(), encoded.size(), decoded.data(), numIndices, indexSize) &&
+           std::memcmp(decoded.data(), indices, decoded.size() - 1) == 0 && decoded.back() == 0xCD;
+}
+
+void CheckMeshCodec()
+{
+    // Every .x file as it is cooked, with both vertex profiles and the depth stream
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData fileMesh;
+        if (!LoadXFile(text.data(), text.size(), fileMesh))  continue;
+        OptimiseMesh(fileMesh);
+        BuildMeshlets(fileMesh);
+        GenerateLODs(fileMesh);
+
+        bool same = true;
+        for (VertexProfile profile : { VertexProfile::Full, VertexProfile::Compact })
+        {
+            PackedMesh packed = PackMesh(fileMesh.View(), profile);
+            MeshDataView view = packed.View();
+            VertexElement depthElement = *FindElement(view, "Position");
+            depthElement.offset = 0;
+            same = same && VerticesRoundTrip(view.vertices, view.numVertices, view.vertexSize, view.elements, view.numElements) &&
+                           IndicesRoundTrip(view.indices, view.numIndices, view.indexSize) &&
+                           VerticesRoundTrip(view.depthVertices, view.numDepthVertices, view.depthVertexSize, &depthElement, 1) &&
+                           IndicesRoundTrip(view.depthIndices, view.numIndices, view.depthIndexSize);
+        }
+        Check("MeshCodec: " + file + " identical after decoding", same);
+    }
+
+    // Random vertices (described by elements or not) and indices, which don't compress but must still come back
+    MeshData mesh = GenerateMesh(5000, 2, true);
+    std::vector<unsigned char> randomBytes(mesh.vertices.size());
+    for (unsigned char& byte : randomBytes)  byte = static_cast<unsigned char>(gRandom());
+    Check("MeshCodec: random vertices identical after decoding",
+          VerticesRoundTrip(randomBytes.data(), mesh.numVertices, mesh.vertexSize, mesh.elements.data(), static_cast<uint32_t>(mesh.elements.size())) &&
+          VerticesRoundTrip(randomBytes.data(), static_cast<uint32_t>(randomBytes.size() / 7), 7, nullptr, 0));
+
+    std::vector<uint32_t> randomIndices(30001);
+    std::vector<uint16_t> randomIndices16(randomIndices.size());
+    for (size_t i = 0; i < randomIndices.size(); ++i)
+    {
+        randomIndices[i]   = (i % 5 == 0) ? static_cast<uint32_t>(gRandom()) : std::uniform_int_distribution<uint32_t>(0, 1000)(gRandom);
+        randomIndices16[i] = static_cast<uint16_t>(randomIndices[i]);
+    }
+    Check("MeshCodec: random indices identical after decoding", IndicesRoundTrip(randomIndices.data(), static_cast<uint32_t>(randomIndices.size()), 4) &&
+                                                                IndicesRoundTrip(randomIndices16.data(), static_cast<uint32_t>(randomIndices16.size()), 2));
+
+    // Generated mesh (32-bit indices), index counts that aren't whole triangles and nothing at all
+    Check("MeshCodec: generated mesh identical after decoding",
+          VerticesRoundTrip(mesh.vertices.data(), mesh.numVertices, mesh.vertexSize, mesh.elements.data(), static_cast<uint32_t>(mesh.elements.size())) &&
+          IndicesRoundTrip(mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()), 4) &&
+          IndicesRoundTrip(mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()) - 1, 4) &&
+          IndicesRoundTrip(mesh.indices.data(), 2, 4) &&
+          IndicesRoundTrip(mesh.indices.data(), 0, 4) &&
+          VerticesRoundTrip(mesh.vertices.data(), 0, mesh.vertexSize, mesh.elements.data(), static_cast<uint32_t>(mesh.elements.size())));
+
+    // Damaged or mismatched data must be rejected, never read or written out of bounds
+    uint32_t numElements = static_cast<uint32_t>(mesh.elements.size());
+    std::vector<unsigned char> vertices = EncodeVertices(mesh.vertices.data(), mesh.numVertices, mesh.vertexSize, mesh.elements.data(), numElements);
+    std::vector<unsigned char> indices  = EncodeIndices(mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()), 4);
+    std::vector<unsigned char> decoded(mesh.vertices.size() + mesh.indices.size() * 4);
+    bool rejected = true;
+    for (size_t size : { size_t(0), vertices.size() / 2, vertices.size() - 1 })
+    {
+        rejected = rejected && !DecodeVertices(vertices.data(), size, decoded.data(), mesh.numVertices, mesh.vertexSize, mesh.elements.data(), numElements);
+    }
+    for (size_t size : { size_t(0), indices.size() / 2, indices.size() - 1 })
+    {
+        rejected = rejected && !DecodeIndices(indices.data(), size, decoded.data(), static_cast<uint32_t>(mesh.indices.size()), 4);
+    }
+    vertices.push_back(0);
+    indices.push_back(0);
+    rejected = rejected && !DecodeVertices(vertices.data(), vertices.size(), decoded.data(), mesh.numVertices, mesh.vertexSize, mesh.elements.data(), numElements) &&
+                           !DecodeIndices(indices.data(), indices.size(), decoded.data(), static_cast<uint32_t>(mesh.indices.size()), 4) &&
+                           !DecodeIndices(indices.data(), indices.size() - 1, decoded.data(), static_cast<uint32_t>(mesh.indices.size()), 3);
+    Check("MeshCodec: rejects truncated and extra data", rejected);
+
+    // Random 32-bit indices decoded as 16-bit indices are too big
+    std::vector<unsigned char> bigIndices = EncodeIndices(randomIndices.data(), static_cast<uint32_t>(randomIndices.size()), 4);
+    std::vector<uint16_t> decoded16(randomIndices.size());
+    Check("MeshCodec: rejects indices too big for the index size",
+          !DecodeIndices(bigIndices.data(), bigIndices.size(), decoded16.data(), static_cast<uint32_t>(decoded16.size()), 2));
+}
+
+
+// Text .x file of a bumpy grid of side x side vertices with normals and UVs, followed by a second object, a
+// smaller grid with UVs but no normals. The first grid has one extra triangle with two corners in the same
+// place, which importers remove
+std::string GenerateXFile(unsigned int side)
+{
+    std::string text = "xof 0303txt 0032\n";
+    char line[128];
+    for (int object = 0; object < 2; ++object)
+    {
+        unsigned int n = (object == 0) ? side : side / 4;
+        bool normals = (object == 0);
+        std::vector<CVector3> positions;
+        for (unsigned int y = 0; y < n; ++y)
+        {
+            for (unsigned int x = 0; x < n; ++x)  positions.push_back({ x + 2.0f * side * object, Random(-1, 1), static_cast<float>(y) });
+        }
+        std::vector<std::array<uint32_t, 3>> faces;
+        for (unsigned int y = 0; y < n - 1; ++y)
+        {
+            for (unsigned int x = 0; x < n - 1; ++x)
+            {
+                uint32_t i = y * n + x;
+                faces.push_back({ { i, i + n, i + 1 } });
+                faces.push_back({ { i + 1, i + n, i + n + 1 } });
+            }
+        }
+        if (object == 0)  faces.push_back({ { 0, 0, n } });
+
+        text += "Mesh grid" + std::to_string(object) + " {\n" + std::to_string(positions.size()) + ";\n";
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            std::snprintf(line, sizeof(line), "%.4f;%.4f;%.4f;%s\n", positions[i].x, positions[i].y, positions[i].z,
+                          (i + 1 < positions.size()) ? "," : ";");
+            text += line;
+        }
+        std::string faceList = std::to_string(faces.size()) + ";\n";
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            std::snprintf(line, sizeof(line), "3;%u,%u,%u;%s\n", faces[i][0], faces[i][1], faces[i][2], (i + 1 < faces.size()) ? "," : ";");
+            faceList += line;
+        }
+        text += faceList;
+
+        if (normals)
+        {
+            text += "MeshNormals {\n" + std::to_string(positions.size()) + ";\n";
+            for (size_t i = 0; i < positions.size(); ++i)
+            {
+                CVector3 normal = Normalise({ Random(-0.2f, 0.2f), 1, Random(-0.2f, 0.2f) });
+                std::snprintf(line, sizeof(line), "%.4f;%.4f;%.4f;%s\n", normal.x, normal.y, normal.z, (i + 1 < positions.size()) ? "," : ";");
+                text += line;
+            }
+            text += faceList + "}\n";
+        }
+
+        text += "MeshTextureCoords {\n" + std::to_string(positions.size()) + ";\n";
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            std::snprintf(line, sizeof(line), "%.4f;%.4f;%s\n", (i % n) / (n - 1.0f), (i / n) / (n - 1.0f), (i + 1 < positions.size()) ? "," : ";");
+            text += line;
+        }
+        text += "}\n}\n";
+    }
+    return text;
+}
+
+// A triangle as the bytes of its three positions, starting from the smallest corner so triangles whose
+// corners have been rotated compare equal
+std::string TrianglePositions(const unsigned char* a, const unsigned char* b, const unsigned char* c)
+{
+    std::string corners[3] = { std::string(reinterpret_cast<const char*>(a), sizeof(CVector3)),
+                               std::string(reinterpret_cast<const char*>(b), sizeof(CVector3)),
+                               std::string(reinterpret_cast<const char*>(c), sizeof(CVector3)) };
+    int first = static_cast<int>(std::min_element(corners, corners + 3) - corners);
+    return corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3];
+}
+
+// Temporary files of the streaming import (named after the streamed mesh file) left in the temporary folder
+bool StreamingTempFilesLeft(const std::string& streamedFileName)
+{
+    std::string prefix = streamedFileName.substr(gTempFolder.size());
+    bool found = false;
+    DIR* dir = opendir(gTempFolder.c_str());
+    if (dir == nullptr)  return false;
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > prefix.size() + 4 && name.compare(0, prefix.size(), prefix) == 0 &&
+            name.compare(name.size() - 4, 4, ".tmp") == 0)  found = true;
+    }
+    closedir(dir);
+    return found;
+}
+
+void CheckMeshStreaming()
+{
+    const std::string fileName     = gTempFolder + "MeshBenchmarkStreaming.x";
+    const std::string streamedName = gTempFolder + "MeshBenchmarkStreaming.x.streamed.cooked";
+    const uint64_t key = HashValue(54321ULL);
+
+    // Large enough to need several chunks with the smallest budget
+    std::string text = GenerateXFile(300);
+    WriteFile(fileName, std::vector<unsigned char>(text.begin(), text.end()));
+
+    MeshData loaded;
+    bool loadedInCore = LoadXFile(text.data(), text.size(), loaded);
+    text = std::string();
+
+    bool imported = false;
+    size_t peak = PeakHeapUse([&]
+    {
+        MappedFile sourceFile;
+        if (!sourceFile.Open(fileName))  return;
+        try
+        {
+            StreamImportMesh(fileName, sourceFile, streamedName, key, true, VertexProfile::Full, MIN_STREAMING_BUDGET);
+            imported = true;
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::fprintf(stderr, "%s\n", e.what());
+        }
+    });
+    Check("MeshStreaming: imports", loadedInCore && imported);
+    Check("MeshStreaming: heap within budget (" + std::to_string(peak / 1024) + " KB)", peak <= MIN_STREAMING_BUDGET);
+    Check("MeshStreaming: no temporary files left", !StreamingTempFilesLeft(streamedName));
+
+    StreamedMesh streamed;
+    bool opened = streamed.Open(streamedName, key);
+    Check("MeshStreaming: opens", opened && streamed.NumChunks() > 1);
+    if (!opened || !loadedInCore)  return;
+
+    // Read every chunk into copies of the buffers the Mesh class would create, checking the ranges
+    MeshDataView view = streamed.View();
+    std::vector<unsigned char> vertices(static_cast<size_t>(view.numVertices) * view.vertexSize);
+    std::vector<unsigned char> indices(static_cast<size_t>(view.numIndices) * view.indexSize);
+    std::vector<unsigned char> depthVertices(static_cast<size_t>(view.numDepthVertices) * view.depthVertexSize);
+    std::vector<uint32_t>      depthIndices(view.numIndices);
+    std::vector<bool>          indexFilled(view.numIndices, false);
+    bool read = view.indexSize == 2 && view.depthIndexSize == 4 && view.numDepthVertices > 0;
+    StreamedChunk chunk;
+    for (uint32_t i = 0; i < streamed.NumChunks() && read; ++i)
+    {
+        read = streamed.ReadChunk(i, chunk) &&
+               static_cast<uint64_t>(chunk.firstVertex) + chunk.numVertices <= view.numVertices &&
+               chunk.vertices.size() == static_cast<size_t>(chunk.numVertices) * view.vertexSize &&
+               static_cast<uint64_t>(chunk.firstDepthVertex) + chunk.numDepthVertices <= view.numDepthVertices &&
+               chunk.depthVertices.size() == static_cast<size_t>(chunk.numDepthVertices) * view.depthVertexSize &&
+               chunk.depthIndices.size() * view.indexSize == chunk.indices.size();
+        if (!read)  break;
+        std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + static_cast<size_t>(chunk.firstVertex) * view.vertexSize);
+        std::copy(chunk.depthVertices.begin(), chunk.depthVertices.end(),
+                  depthVertices.begin() + static_cast<size_t>(chunk.firstDepthVertex) * view.depthVertexSize);
+        for (const StreamedSlice& slice : chunk.slices)
+        {
+            read = static_cast<uint64_t>(slice.startIndex) + slice.numIndices <= view.numIndices &&
+                   static_cast<size_t>(slice.sourceIndex) + slice.numIndices <= chunk.depthIndices.size();
+            if (!read)  break;
+            std::copy(chunk.indices.begin() + static_cast<size_t>(slice.sourceIndex) * view.indexSize,
+                      chunk.indices.begin() + static_cast<size_t>(slice.sourceIndex + slice.numIndices) * view.indexSize,
+                      indices.begin() + static_cast<size_t>(slice.startIndex) * view.indexSize);
+            std::copy(chunk.depthIndices.begin() + slice.sourceIndex, chunk.depthIndices.begin() + slice.sourceIndex + slice.numIndices,
+                      depthIndices.begin() + slice.startIndex);
+            for (uint32_t j = slice.startIndex; j < slice.startIndex + slice.numIndices; ++j)
+            {
+                if (indexFilled[j])  read = false;
+                indexFilled[j] = true;
+            }
+        }
+    }
+    read = read && std::find(indexFilled.begin(), indexFilled.end(), false) == indexFilled.end();
+    Check("MeshStreaming: chunks read and fill every index once", read);
+    if (!read)  return;
+
+    // Every sub-mesh's indices must be inside its vertices, the depth stream must give each index the same
+    // position, and each level of detail must have no more triangles than the one before
+    const VertexElement* position = FindElement(view, "Position");
+    bool valid = position != nullptr && position->format == VertexFormat::Float3 && view.depthVertexSize == sizeof(CVector3) &&
+                 FindElement(view, "Normal") != nullptr && FindElement(view, "Tangent") != nullptr;
+    const uint16_t* index16 = reinterpret_cast<const uint16_t*>(indices.data());
+    for (uint32_t s = 0; s < view.numSubMeshes && valid; ++s)
+    {
+        const SubMesh& subMesh = view.subMeshes[s];
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices && valid; ++i)
+        {
+            valid = index16[i] < subMesh.numVertices && depthIndices[i] < view.numDepthVertices &&
+                    std::memcmp(vertices.data() + static_cast<size_t>(subMesh.baseVertex + index16[i]) * view.vertexSize + position->offset,
+                                depthVertices.data() + static_cast<size_t>(depthIndices[i]) * view.depthVertexSize, sizeof(CVector3)) == 0;
+        }
+    }
+    for (uint32_t l = 0; l < view.numLODs && valid; ++l)
+    {
+        uint64_t lodIndices = 0;
+        for (uint32_t s = view.lods[l].firstSubMesh; s < view.lods[l].firstSubMesh + view.lods[l].numSubMeshes; ++s)  lodIndices += view.subMeshes[s].numIndices;
+        valid = lodIndices == view.lods[l].numTriangles * 3ull && (l == 0 || view.lods[l].numTriangles <= view.lods[l - 1].numTriangles);
+    }
+    Check("MeshStreaming: valid sub-meshes, depth stream and levels of detail", valid && view.numLODs > 1 &&
+          view.lods[view.numLODs - 1].numTriangles < view.lods[0].numTriangles);
+
+    // Divided between sets of buffers small enough to need several, as Mesh does for meshes too large for one
+    // Direct3D buffer, each sub-mesh must draw the same positions from its set's buffers as from the whole ones
+    uint64_t maxBufferBytes = static_cast<uint64_t>(view.numVertices) * view.vertexSize / 3;
+    StreamedBufferPlan plan = streamed.PlanBuffers(maxBufferBytes);
+    bool planned = plan.sets.size() > 1 && plan.chunkSets.size() == streamed.NumChunks() && plan.subMeshes.size() == view.numSubMeshes;
+    std::vector<std::vector<unsigned char>> setVertices, setIndices;
+    std::vector<std::vector<uint32_t>>      setDepthIndices;
+    std::vector<uint32_t>                   setChunks(plan.sets.size(), 0);
+    for (uint32_t c = 0; c < plan.chunkSets.size() && planned; ++c)  ++setChunks[plan.chunkSets[c]];
+    for (size_t i = 0; i < plan.sets.size() && planned; ++i)
+    {
+        const StreamedBufferSet& set = plan.sets[i];
+        planned = setChunks[i] > 0 && (setChunks[i] == 1 || (static_cast<uint64_t>(set.numVertices) * view.vertexSize <= maxBufferBytes &&
+                                                               static_cast<uint64_t>(set.numIndices)  * view.depthIndexSize <= maxBufferBytes));
+        setVertices.emplace_back(static_cast<size_t>(set.numVertices) * view.vertexSize);
+        setIndices.emplace_back(static_cast<size_t>(set.numIndices) * view.indexSize);
+        setDepthIndices.emplace_back(set.numIndices);
+    }
+    for (uint32_t c = 0; c < streamed.NumChunks() && planned; ++c)
+    {
+        planned = streamed.ReadChunk(c, chunk);
+        const StreamedBufferSet& set = plan.sets[plan.chunkSets[c]];
+        planned = planned && chunk.firstVertex >= set.firstVertex && chunk.firstVertex + chunk.numVertices <= set.firstVertex + set.numVertices &&
+                  chunk.firstDepthVertex >= set.firstDepthVertex && chunk.firstDepthVertex + chunk.numDepthVertices <= set.firstDepthVertex + set.numDepthVertices;
+        if (!planned)  break;
+        std::copy(chunk.vertices.begin(), chunk.vertices.end(),
+                  setVertices[plan.chunkSets[c]].begin() + static_cast<size_t>(chunk.firstVertex - set.firstVertex) * view.vertexSize);
+        for (const StreamedSlice& slice : chunk.slices)
+        {
+            const SubMesh& subMesh = plan.subMeshes[slice.subMesh];
+            planned = plan.subMeshSets[slice.subMesh] == plan.chunkSets[c] && slice.numIndices == subMesh.numIndices &&
+                      static_cast<uint64_t>(subMesh.startIndex) + subMesh.numIndices <= set.numIndices;
+            if (!planned)  break;
+            std::copy(chunk.indices.begin() + static_cast<size_t>(slice.sourceIndex) * view.indexSize,
+                      chunk.indices.begin() + static_cast<size_t>(slice.sourceIndex + slice.numIndices) * view.indexSize,
+                      setIndices[plan.chunkSets[c]].begin() + static_cast<size_t>(subMesh.startIndex) * view.indexSize);
+            for (uint32_t j = 0; j < slice.numIndices; ++j)
+            {
+                setDepthIndices[plan.chunkSets[c]][subMesh.startIndex + j] = chunk.depthIndices[slice.sourceIndex + j] - set.firstDepthVertex;
+            }
+        }
+    }
+    for (uint32_t s = 0; s < view.numSubMeshes && planned; ++s)
+    {
+        const SubMesh& whole   = view.subMeshes[s];
+        const SubMesh& subMesh = plan.subMeshes[s];
+        const StreamedBufferSet& set = plan.sets[plan.subMeshSets[s]];
+        const uint16_t* setIndex16 = reinterpret_cast<const uint16_t*>(setIndices[plan.subMeshSets[s]].data());
+        for (uint32_t i = 0; i < subMesh.numIndices && planned; ++i)
+        {
+            uint32_t depthIndex = setDepthIndices[plan.subMeshSets[s]][subMesh.startIndex + i];
+            planned = setIndex16[subMesh.startIndex + i] == index16[whole.startIndex + i] && depthIndex < set.numDepthVertices &&
+                      depthIndex + set.firstDepthVertex == depthIndices[whole.startIndex + i] &&
+                      std::memcmp(setVertices[plan.subMeshSets[s]].data() + static_cast<size_t>(subMesh.baseVertex + setIndex16[subMesh.startIndex + i]) * view.vertexSize,
+                                  vertices.data() + static_cast<size_t>(whole.baseVertex + index16[whole.startIndex + i]) * view.vertexSize, view.vertexSize) == 0;
+        }
+    }
+    Check("MeshStreaming: divided between " + std::to_string(plan.sets.size()) + " sets of buffers", planned);
+
+    // The full detail triangles must be those the in-core reader loads
+    std::vector<std::string> streamedTriangles;
+    uint32_t firstSubMesh = view.numLODs > 0 ? view.lods[0].firstSubMesh : 0;
+    uint32_t numSubMeshes = view.numLODs > 0 ? view.lods[0].numSubMeshes : view.numSubMeshes;
+    for (uint32_t s = firstSubMesh; s < firstSubMesh + numSubMeshes; ++s)
+    {
+        const SubMesh& subMesh = view.subMeshes[s];
+        auto corner = [&](uint32_t i) { return vertices.data() + static_cast<size_t>(subMesh.baseVertex + index16[i]) * view.vertexSize + position->offset; };
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; i += 3)
+        {
+            streamedTriangles.push_back(TrianglePositions(corner(i), corner(i + 1), corner(i + 2)));
+        }
+    }
+    std::vector<std::string> loadedTriangles;
+    const VertexElement* loadedPosition = FindElement(loaded.View(), "Position");
+    for (const SubMesh& subMesh : loaded.subMeshes)
+    {
+        auto corner = [&](uint32_t i) { return loaded.vertices.data() + (subMesh.baseVertex + loaded.indices[i]) * loaded.vertexSize + loadedPosition->offset; };
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; i += 3)
+        {
+            loadedTriangles.push_back(TrianglePositions(corner(i), corner(i + 1), corner(i + 2)));
+        }
+    }
+    std::sort(streamedTriangles.begin(), streamedTriangles.end());
+    std::sort(loadedTriangles.begin(), loadedTriangles.end());
+    Check("MeshStreaming: same triangles as in-core reader", streamedTriangles == loadedTriangles);
+    Check("MeshStreaming: same bounding box as in-core reader", std::memcmp(&view.boundingBox, &loaded.boundingBox, sizeof(CAABB)) == 0);
+    streamed.Close();
+
+    // Wrong keys and damaged files must be rejected. Chunk 0's sections follow the 152 byte header, from byte 160
+    std::vector<unsigned char> original = ReadFile(streamedName);
+    Check("MeshStreaming: rejects different key", !streamed.Open(streamedName, key + 1));
+
+    std::vector<unsigned char> damaged(original.begin(), original.end() - 1);
+    WriteFile(streamedName, damaged);
+    Check("MeshStreaming: rejects truncated file", !streamed.Open(streamedName, key));
+
+    damaged = original;
+    damaged.push_back(0);
+    WriteFile(streamedName, damaged);
+    Check("MeshStreaming: rejects extra bytes", !streamed.Open(streamedName, key));
+
+    damaged = original;
+    std::fill(damaged.begin() + 160, damaged.begin() + 176, static_cast<unsigned char>(0xFF));
+    WriteFile(streamedName, damaged);
+    Check("MeshStreaming: rejects damaged chunk", streamed.Open(streamedName, key) && !streamed.ReadChunk(0, chunk));
+    streamed.Close();
+    std::remove(streamedName.c_str());
+
+    // A source file that can't be streamed must throw and leave no files
+    std::string broken = "xof 0303txt 0032\nMesh broken {\n3;\n0;0;0;,\n1;0;0;,\n0;0;1;;\n1;\n3;0,1,7;;\n}\n";
+    WriteFile(fileName, std::vector<unsigned char>(broken.begin(), broken.end()));
+    bool threw = false;
+    {
+        MappedFile sourceFile;
+        try
+        {
+            if (sourceFile.Open(fileName))  StreamImportMesh(fileName, sourceFile, streamedName, key, false, VertexProfile::Full, MIN_STREAMING_BUDGET);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+    }
+    Check("MeshStreaming: rejects bad source file and leaves no files", threw && !streamed.Open(streamedName, key) &&
+          !StreamingTempFilesLeft(streamedName));
+    std::remove(fileName.c_str());
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmarks
+-----------------------------------------------------------------------------------------*/
+
+// Loading a mesh: reading a cooked file into memory (what a loader that parses a file must do before any
+// parsing) against mapping the cooked file, and against opening a compressed cooked file, which decodes the
+// vertices and indices. All then touch every page of vertex data as buffer creation does
+void BenchmarkCookedMesh(unsigned int n)
+{
+    const std::string fileName = gTempFolder + "MeshBenchmark.cooked";
+    const uint64_t key = HashValue(n);
+
+    MeshData mesh = GenerateMesh(n, 4, true);
+    MeshDataView view = mesh.View();
+    n = mesh.numVertices;
+    WriteCookedMesh(fileName, key, view);
+
+    Run("CookedMesh: write", n, [&] { gSink = gSink + WriteCookedMesh(fileName, key, view); });
+
+    Run("Read whole file (fread)", n, [&]
+    {
+        std::vector<unsigned char> data = ReadFile(fileName);
+        for (size_t i = 0; i < data.size(); i += 4096)  gSink = gSink + data[i];
+    });
+
+    Run("CookedMesh: open", n, [&]
+    {
+        CookedMesh cooked;
+        if (!cooked.Open(fileName, key))  return;
+        const unsigned char* vertices = static_cast<const unsigned char*>(cooked.View().vertices);
+        size_t size = static_cast<size_t>(cooked.View().numVertices) * cooked.View().vertexSize;
+        for (size_t i = 0; i < size; i += 4096)  gSink = gSink + vertices[i];
+    });
+
+    Run("HashBytes(mapped file)", n, [&]
+    {
+        MappedFile file;
+        if (file.Open(fileName))  gSink = gSink + static_cast<unsigned int>(HashBytes(file.Data(), file.Size()));
+    });
+
+    Run("CookedMesh: write (compressed)", n, [&] { gSink = gSink + WriteCookedMesh(fileName, key, view, true); });
+
+    Run("CookedMesh: open (compressed)", n, [&]
+    {
+        CookedMesh cooked;
+        if (!cooked.Open(fileName, key))  return;
+        const unsigned char* vertices = static_cast<const unsigned char*>(cooked.View().vertices);
+        size_t size = static_cast<size_t>(cooked.View().numVertices) * cooked.View().vertexSize;
+        for (size_t i = 0; i < size; i += 4096)  gSink = gSink + vertices[i];
+    });
+
+    std::remove(fileName.c_str());
+}
+
+
+// Packing a mesh with the compact vertex profile, done once when a mesh is cooked
+void BenchmarkVertexPacking(unsigned int n)
+{
+    MeshData mesh = GenerateMesh(n, 4, true);
+    MeshDataView view = mesh.View();
+    n = mesh.numVertices;
+
+    Run("VertexPacking: compact profile", n, [&] { gSink = gSink + PackMesh(view, VertexProfile::Compact).vertexSize; });
+    Run("VertexPacking: full profile",    n, [&] { gSink = gSink + PackMesh(view, VertexProfile::Full).vertexSize; });
+}
+
+
+// Optimising a mesh with triangles and vertices in a random order, done once when a mesh is cooked. Includes copying the
+// mesh, as the optimisation changes it
+void BenchmarkMeshOptimiser(unsigned int n)
+{
+    MeshData mesh = GenerateMesh(n, 4, false);
+    ShuffleMesh(mesh);
+    n = mesh.numVertices;
+
+    Run("MeshOptimiser: copy mesh",          n, [&] { MeshData copy = mesh;  gSink = gSink + copy.numVertices; });
+    Run("MeshOptimiser: vertex cache",       n, [&] { MeshData copy = mesh;  OptimiseVertexCache(copy);  gSink = gSink + copy.indices[0]; });
+    Run("MeshOptimiser: all steps",          n, [&] { MeshData copy = mesh;  OptimiseMesh(copy);  gSink = gSink + copy.indices[0]; });
+}
+
+
+// Generating levels of detail for an optimised mesh, done once when a mesh is cooked. Includes copying the mesh
+void BenchmarkMeshSimplifier(unsigned int n)
+{
+    MeshData mesh = GenerateMesh(n, 4, false);
+    OptimiseMesh(mesh);
+    n = mesh.numVertices;
+
+    Run("MeshSimplifier: generate LODs", n, [&] { MeshData copy = mesh;  GenerateLODs(copy);  gSink = gSink + copy.indices.size(); });
+}
+
+
+// Building meshlets for an optimised mesh, done once when a mesh is cooked, and culling them for a view, done
+// each time the mesh is drawn. The view culls about half the meshlets by frustum, and more by direction
+void BenchmarkMeshlets(unsigned int n)
+{
+    MeshData mesh = GenerateMesh(n, 4, false);
+    OptimiseMesh(mesh);
+    n = mesh.numVertices;
+
+    Run("Meshlets: build", n, [&] { MeshData copy = mesh;  BuildMeshlets(copy);  gSink = gSink + copy.meshlets.size(); });
+
+    BuildMeshlets(mesh);
+    MeshletCuller culler;
+    culler.Init(mesh.View());
+    if (culler.Empty())  return;
+    CFrustum frustum = OpenFrustum();
+    frustum.planes[CFrustum::Left] = CPlane({ 0, 0, 1 }, -mesh.boundingBox.centre.z);
+    CVector3 camera = mesh.boundingBox.centre + CVector3{ 0, 10, 0 };
+    Run("Meshlets: cull", n, [&] { gSink = gSink + culler.Cull(frustum, camera, FaceCulling::Back); });
+}
+
+
+// Building a BVH, done when a mesh is loaded for ray queries, with different numbers of threads, and tracing
+// rays against it (1000 rays per operation)
+void BenchmarkMeshBVH(unsigned int n)
+{
+    MeshData mesh = GenerateMesh(n, 4, false);
+    OptimiseMesh(mesh);
+    n = mesh.numVertices;
+
+    std::vector<unsigned int> threadCounts = { 1, 4 };
+    if (ParallelThreads() > 4)  threadCounts.push_back(ParallelThreads());
+    MeshBVH bvh;
+    for (unsigned int threads : threadCounts)
+    {
+        std::string name = "MeshBVH: build (" + std::to_string(threads) + (threads == 1 ? " thread)" : " threads)");
+        Run(name.c_str(), n, [&] { bvh.Build(mesh.View(), threads);  gSink = gSink + bvh.NumTriangles(); });
+    }
+
+    bvh.Build(mesh.View());
+    std::vector<TestRay> rays = RandomRays(mesh, 1000);
+    Run("MeshBVH: 1000 rays", n, [&]
+    {
+        RayHit hit;
+        for (const TestRay& ray : rays)  gSink = gSink + bvh.Intersect(ray.origin, ray.direction, 1, hit);
+    });
+}
+
+
+// Welding, normals and tangents for a mesh with a vertex per triangle corner (as some files are imported),
+// with different numbers of threads. Includes copying the mesh, as the processing changes it
+void BenchmarkMeshProcessing(unsigned int n)
+{
+    MeshData mesh = GenerateMesh(n, 4, false);
+    ShuffleMesh(mesh);
+    UnweldVertices(mesh);
+    MeshData welded = mesh;
+    WeldVertices(welded);
+    GenerateSmoothNormals(welded);
+    n = welded.numVertices;
+
+    std::vector<unsigned int> threadCounts = { 1, 2, 4 };
+    if (ParallelThreads() > 4)  threadCounts.push_back(ParallelThreads());
+    for (unsigned int threads : threadCounts)
+    {
+        std::string suffix = " (" + std::to_string(threads) + (threads == 1 ? " thread)" : " threads)");
+        Run(("MeshProcessing: weld" + suffix).c_str(),    n, [&] { MeshData copy = mesh;    WeldVertices(copy, 0, threads);  gSink = gSink + copy.numVertices; });
+        Run(("MeshProcessing: normals" + suffix).c_str(), n, [&] { MeshData copy = welded;  GenerateSmoothNormals(copy, MAX_SMOOTHING_ANGLE, true, threads);  gSink = gSink + copy.numVertices; });
+        Run(("MeshProcessing: tangents" + suffix).c_str(), n, [&] { MeshData copy = welded; GenerateTangents(copy, threads);  gSink = gSink + copy.numVertices; });
+    }
+}
+
+
+// The whole import of a generated .x file (with tangents, full vertex profile) against the streaming import
+// of the same file with the smallest memory budget, added to the imports
+void BenchmarkStreaming()
+{
+    const std::string fileName     = gTempFolder + "MeshBenchmarkStreaming.x";
+    const std::string streamedName = gTempFolder + "MeshBenchmarkStreaming.x.streamed.cooked";
+    std::string text = GenerateXFile(300);
+    if (!WriteFile(fileName, std::vector<unsigned char>(text.begin(), text.end())))  return;
+    text = std::string();
+
+    MappedFile sourceFile;
+    if (!sourceFile.Open(fileName))  return;
+    unsigned int vertices = 0, triangles = 0;
+    auto importInCore = [&]
+    {
+        PackedMesh packed = ImportMesh(fileName, sourceFile, true, VertexProfile::Full);
+        vertices  = packed.numVertices;
+        triangles = packed.lods.empty() ? packed.numIndices / 3 : packed.lods[0].numTriangles;
+    };
+    auto importStreamed = [&]
+    {
+        StreamImportMesh(fileName, sourceFile, streamedName, 1, true, VertexProfile::Full, MIN_STREAMING_BUDGET);
+        StreamedMesh streamed;
+        if (!streamed.Open(streamedName, 1))  return;
+        const MeshDataView& view = streamed.View();
+        vertices  = view.numVertices;
+        triangles = view.numLODs > 0 ? view.lods[0].numTriangles : view.numIndices / 3;
+    };
+
+    const char* importers[2] = { "import", "stream" };
+    for (int i = 0; i < 2; ++i)
+    {
+        std::string name = std::string("XFile ") + importers[i] + ": generated";
+        if (!gFilter.empty() && name.find(gFilter) == std::string::npos)  continue;
+        size_t peak = (i == 0) ? PeakHeapUse(importInCore) : PeakHeapUse(importStreamed);
+        if (i == 0)  Run(name.c_str(), std::max(vertices, 1u), importInCore);
+        else         Run(name.c_str(), std::max(vertices, 1u), importStreamed);
+        if (!gResults.empty() && gResults.back().name == name)
+        {
+            gImports.push_back({ "generated", importers[i], gResults.back().nsPerOp, peak, vertices, triangles, sourceFile.Size() });
+        }
+    }
+
+    sourceFile.Close();
+    std::remove(streamedName.c_str());
+    std::remove(fileName.c_str());
+}
+
+// Loading each .x file in the media folder with the native reader (and assimp if built with it). The file
+// is mapped and read each time, as Mesh does
+void BenchmarkXFiles()
+{
+    for (const std::string& file : MediaXFiles())
+    {
+        std::string fileName = gMediaFolder + file;
+        MeshData mesh;
+        size_t fileSize = 0;
+        auto loadNative = [&]
+        {
+            MappedFile mappedFile;
+            if (mappedFile.Open(fileName))  LoadXFile(mappedFile.Data(), mappedFile.Size(), mesh);
+            fileSize = mappedFile.Size();
+        };
+        size_t peak = PeakHeapUse(loadNative);
+        unsigned int vertices  = mesh.numVertices;
+        unsigned int triangles = static_cast<unsigned int>(mesh.indices.size() / 3);
+
+        std::string name = "XFile native: " + file;
+        Run(name.c_str(), std::max(vertices, 1u), loadNative);
+        if (!gResults.empty() && gResults.back().name == name)
+        {
+            gImports.push_back({ file, "native", gResults.back().nsPerOp, peak, vertices, triangles, fileSize });
+        }
+
+#ifdef MESH_BENCHMARK_ASSIMP
+        ImportIOStats ioStats;
+        auto loadAssimp = [&]
+        {
+            MappedFile mappedFile;
+            if (mappedFile.Open(fileName))  mesh = ImportMeshAssimp(fileName, mappedFile.Data(), mappedFile.Size(), false, &ioStats);
+        };
+        mesh = MeshData();
+        peak = PeakHeapUse(loadAssimp);
+        vertices  = mesh.numVertices;
+        triangles = static_cast<unsigned int>(mesh.indices.size() / 3);
+
+        name = "XFile assimp: " + file;
+        Run(name.c_str(), std::max(vertices, 1u), loadAssimp);
+        if (!gResults.empty() && gResults.back().name == name)
+        {
+            gImports.push_back({ file, "assimp", gResults.back().nsPerOp, peak, vertices, triangles, ioStats.bytesRead });
+        }
+#endif
+    }
+
+    for (const ImportResult& r : gImports)
+    {
+        std::fprintf(stderr, "%-20s %-7s %12.3f ms %10.1f KB peak heap %8u vertices %8u triangles %10.1f KB read\n", r.file.c_str(),
+                     r.importer.c_str(), r.ns / 1e6, r.peakHeap / 1024.0, r.vertices, r.triangles, r.bytesRead / 1024.0);
+    }
+}
+
+// Building the BVH of each .x file in the media folder and tracing rays against it
+void BenchmarkBVHFiles()
+{
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData mesh;
+        if (!LoadXFile(text.data(), text.size(), mesh))  continue;
+        OptimiseMesh(mesh);
+        unsigned int vertices = std::max(mesh.numVertices, 1u);
+
+        MeshBVH bvh;
+        std::string buildName = "MeshBVH build: " + file;
+        Run(buildName.c_str(), vertices, [&] { bvh.Build(mesh.View());  gSink = gSink + bvh.NumTriangles(); });
+        if (gResults.empty() || gResults.back().name != buildName)  continue;
+        double buildNs = gResults.back().nsPerOp;
+
+        const unsigned int numRays = 1000;
+        std::vector<TestRay> rays = RandomRays(mesh, numRays);
+        unsigned int hits = 0;
+        RayHit hit;
+        for (const TestRay& ray : rays)  hits += bvh.Intersect(ray.origin, ray.direction, 1, hit) ? 1 : 0;
+
+        std::string raysName = "MeshBVH 1000 rays: " + file;
+        Run(raysName.c_str(), vertices, [&]
+        {
+            for (const TestRay& ray : rays)  gSink = gSink + bvh.Intersect(ray.origin, ray.direction, 1, hit);
+        });
+        gBVHs.push_back({ file, bvh.NumTriangles(), static_cast<uint32_t>(bvh.Nodes().size()), bvh.MemoryBytes(), bvh.SAHCost(),
+                          buildNs, numRays * 1e9 / gResults.back().nsPerOp, static_cast<float>(hits) / numRays });
+    }
+
+    std::fprintf(stderr, "%-20s %9s %8s %10s %9s %10s %12s %6s\n", "", "triangles", "nodes", "memory", "SAH cost", "build", "rays/s", "hits");
+    for (const BVHResult& r : gBVHs)
+    {
+        std::fprintf(stderr, "%-20s %9u %8u %8.1fKB %9.2f %8.3fms %12.0f %5.1f%%\n", r.file.c_str(), r.triangles, r.nodes,
+                     r.memoryBytes / 1024.0, r.sahCost, r.buildNs / 1e6, r.raysPerSecond, r.hitFraction * 100);
+    }
+}
+
+
+// Compressing the vertices and indices of each .x file in the media folder as they are cooked, and decoding them
+void BenchmarkCodecFiles()
+{
+    for (const std::string& file : MediaXFiles())
+    {
+        std::vector<unsigned char> text = ReadFile(gMediaFolder + file);
+        MeshData fileMesh;
+        if (!LoadXFile(text.data(), text.size(), fileMesh))  continue;
+        OptimiseMesh(fileMesh);
+        BuildMeshlets(fileMesh);
+        GenerateLODs(fileMesh);
+        PackedMesh packed = PackMesh(fileMesh.View(), VertexProfile::Full);
+        MeshDataView mesh = packed.View();
+        unsigned int vertices = std::max(mesh.numVertices, 1u);
+
+        std::vector<unsigned char> encodedVertices = EncodeVertices(mesh.vertices, mesh.numVertices, mesh.vertexSize, mesh.elements, mesh.numElements);
+        std::vector<unsigned char> encodedIndices  = EncodeIndices(mesh.indices, mesh.numIndices, mesh.indexSize);
+        std::vector<unsigned char> decoded(std::max(packed.vertices.size(), packed.indices.size()));
+
+        std::string verticesName = "MeshCodec decode vertices: " + file;
+        Run(verticesName.c_str(), vertices, [&]
+        {
+            gSink = gSink + DecodeVertices(encodedVertices.data(), encodedVertices.size(), decoded.data(),
+                                           mesh.numVertices, mesh.vertexSize, mesh.elements, mesh.numElements);
+        });
+        if (gResults.empty() || gResults.back().name != verticesName)  continue;
+        double verticesNs = gResults.back().nsPerOp;
+
+        std::string indicesName = "MeshCodec decode indices: " + file;
+        Run(indicesName.c_str(), vertices, [&]
+        {
+            gSink = gSink + DecodeIndices(encodedIndices.data(), encodedIndices.size(), decoded.data(), mesh.numIndices, mesh.indexSize);
+        });
+        gCodecs.push_back({ file, packed.vertices.size(), encodedVertices.size(), packed.indices.size(), encodedIndices.size(),
+                            packed.vertices.size() / verticesNs, packed.indices.size() / gResults.back().nsPerOp });
+    }
+
+    std::fprintf(stderr, "%-20s %10s %10s %6s %8s %10s %10s %6s %8s\n", "", "vertices", "encoded", "ratio", "GB/s", "indices", "encoded", "ratio", "GB/s");
+    for (const CodecResult& r : gCodecs)
+    {
+        std::fprintf(stderr, "%-20s %10zu %10zu %5.2fx %8.2f %10zu %10zu %5.2fx %8.2f\n", r.file.c_str(),
+                     r.vertexBytes, r.encodedVertexBytes, static_cast<double>(r.vertexBytes) / r.encodedVertexBytes, r.vertexGBPerSecond,
+                     r.indexBytes, r.encodedIndexBytes, static_cast<double>(r.indexBytes) / r.encodedIndexBytes, r.indexGBPerSecond);
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Output
+-----------------------------------------------------------------------------------------*/
+
+void WriteJSON(FILE* file)
+{
+    char timeText[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timeText, sizeof(timeText), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#if defined(__clang__)
+    const char* compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const char* compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    const char* compiler = "msvc";
+#else
+    const char* compiler = "unknown";
+#endif
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"compiler\": \"%s\",\n", compiler);
+    std::fprintf(file, "  \"timestamp\": \"%s\",\n", timeText);
+    std::fprintf(file, "  \"min_run_time_s\": %g,\n", gMinRunTime);
+    std::fprintf(file, "  \"runs\": %d,\n", gNumRuns);
+    std::fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < gResults.size(); ++i)
+    {
+        const BenchmarkResult& r = gResults[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"vertices\": %u, \"ns_per_op\": %.1f, \"ns_per_vertex\": %.4f }%s\n",
+                     r.name.c_str(), r.vertices, r.nsPerOp, r.nsPerOp / r.vertices, (i + 1 < gResults.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"imports\": [\n");
+    for (size_t i = 0; i < gImports.size(); ++i)
+    {
+        const ImportResult& r = gImports[i];
+        std::fprintf(file, "    { \"file\": \"%s\", \"importer\": \"%s\", \"ns\": %.0f, \"peak_heap_bytes\": %zu, \"vertices\": %u, \"triangles\": %u, \"bytes_read\": %llu }%s\n",
+                     r.file.c_str(), r.importer.c_str(), r.ns, r.peakHeap, r.vertices, r.triangles, static_cast<unsigned long long>(r.bytesRead), (i + 1 < gImports.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"packing\": [\n");
+    for (size_t i = 0; i < gPacking.size(); ++i)
+    {
+        const PackingReport& p = gPacking[i].report;
+        std::fprintf(file, "    { \"file\": \"%s\", \"vertex_bytes_before\": %zu, \"vertex_bytes_after\": %zu, \"index_bytes_before\": %zu, "
+                           "\"index_bytes_after\": %zu, \"max_position_error\": %g, \"max_normal_error_degrees\": %g, "
+                           "\"max_tangent_error_degrees\": %g, \"max_uv_error\": %g, \"float_uvs\": %s, "
+                           "\"vertices\": %u, \"depth_vertices\": %u, \"depth_bytes\": %zu }%s\n",
+                     gPacking[i].file.c_str(), p.vertexBytesBefore, p.vertexBytesAfter, p.indexBytesBefore, p.indexBytesAfter,
+                     p.maxPositionError, p.maxNormalError, p.maxTangentError, p.maxUVError, p.uvsKeptAsFloat ? "true" : "false",
+                     gPacking[i].vertices, gPacking[i].depthVertices, p.depthBytes,
+                     (i + 1 < gPacking.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"optimisation\": [\n");
+    for (size_t i = 0; i < gOptimisation.size(); ++i)
+    {
+        const MeshOptimisationReport& r = gOptimisation[i].report;
+        std::fprintf(file, "    { \"file\": \"%s\"", gOptimisation[i].file.c_str());
+        const MeshEfficiency* steps[] = { &r.original, &r.vertexCache, &r.overdraw, &r.vertexFetch };
+        const char* names[] = { "original", "vertex_cache", "overdraw", "vertex_fetch" };
+        for (int s = 0; s < 4; ++s)
+        {
+            std::fprintf(file, ", \"%s\": { \"acmr\": %.4f, \"atvr\": %.4f, \"overdraw\": %.4f, \"overfetch\": %.4f }",
+                         names[s], steps[s]->acmr, steps[s]->atvr, steps[s]->overdraw, steps[s]->overfetch);
+        }
+        std::fprintf(file, " }%s\n", (i + 1 < gOptimisation.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"lods\": [\n");
+    for (size_t i = 0; i < gLODs.size(); ++i)
+    {
+        const LODResult& r = gLODs[i];
+        std::fprintf(file, "    { \"file\": \"%s\", \"levels\": [", r.file.c_str());
+        for (size_t l = 0; l < r.lods.size(); ++l)
+        {
+            std::fprintf(file, "%s{ \"triangles\": %u, \"error\": %g, \"error_per_radius\": %g }", l == 0 ? " " : ", ",
+                         r.lods[l].numTriangles, r.lods[l].error, r.radius > 0 ? r.lods[l].error / r.radius : 0);
+        }
+        std::fprintf(file, " ] }%s\n", (i + 1 < gLODs.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"meshlets\": [\n");
+    for (size_t i = 0; i < gMeshlets.size(); ++i)
+    {
+        const MeshletResult& r = gMeshlets[i];
+        std::fprintf(file, "    { \"file\": \"%s\", \"meshlets\": %u, \"average_vertices\": %.2f, \"average_triangles\": %.2f, \"back_face_kept\": %.4f }%s\n",
+                     r.file.c_str(), r.meshlets, r.vertices, r.triangles, r.backFacingKept, (i + 1 < gMeshlets.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"bvh\": [\n");
+    for (size_t i = 0; i < gBVHs.size(); ++i)
+    {
+        const BVHResult& r = gBVHs[i];
+        std::fprintf(file, "    { \"file\": \"%s\", \"triangles\": %u, \"nodes\": %u, \"memory_bytes\": %zu, \"sah_cost\": %.3f, "
+                           "\"build_ns\": %.0f, \"rays_per_second\": %.0f, \"hit_fraction\": %.4f }%s\n",
+                     r.file.c_str(), r.triangles, r.nodes, r.memoryBytes, r.sahCost, r.buildNs, r.raysPerSecond, r.hitFraction,
+                     (i + 1 < gBVHs.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"codec\": [\n");
+    for (size_t i = 0; i < gCodecs.size(); ++i)
+    {
+        const CodecResult& r = gCodecs[i];
+        std::fprintf(file, "    { \"file\": \"%s\", \"vertex_bytes\": %zu, \"encoded_vertex_bytes\": %zu, \"vertex_ratio\": %.3f, "
+                           "\"vertex_decode_gb_per_s\": %.3f, \"index_bytes\": %zu, \"encoded_index_bytes\": %zu, \"index_ratio\": %.3f, "
+                           "\"index_decode_gb_per_s\": %.3f }%s\n",
+                     r.file.c_str(), r.vertexBytes, r.encodedVertexBytes, static_cast<double>(r.vertexBytes) / r.encodedVertexBytes,
+                     r.vertexGBPerSecond, r.indexBytes, r.encodedIndexBytes, static_cast<double>(r.indexBytes) / r.encodedIndexBytes,
+                     r.indexGBPerSecond, (i + 1 < gCodecs.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ],\n");
+    std::fprintf(file, "  \"checks\": [\n");
+    for (size_t i = 0; i < gChecks.size(); ++i)
+    {
+        const CheckResult& c = gChecks[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"pass\": %s }%s\n", c.name.c_str(), c.pass ? "true" : "false",
+                     (i + 1 < gChecks.size()) ? "," : "");
+    }
+    std::fprintf(file, "  ]\n");
+    std::fprintf(file, "}\n");
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Main
+-----------------------------------------------------------------------------------------*/
+
+int main(int argc, char* argv[])
+{
+    const char* outFile = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if      (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)     outFile = argv[++i];
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)  gFilter = argv[++i];
+        else if (std::strcmp(argv[i], "--media") == 0 && i + 1 < argc)   gMediaFolder = std::string(argv[++i]) + "/";
+        else if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            gMinRunTime = 0.005;
+            gNumRuns = 2;
+            gMeshSizes = { 1000, 50000 };
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--out file.json] [--filter text] [--quick] [--media folder]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::fprintf(stderr, "Mesh benchmark\n");
+
+    CheckCookedMesh();
+    CheckParseFloat(1000000);
+    CheckXFiles();
+    CheckVertexPacking();
+    CheckMeshOptimiser();
+    CheckMeshProcessing();
+    CheckMeshSimplifier();
+    CheckMeshlets();
+    CheckMeshBVH();
+    CheckMeshCodec();
+    CheckMeshStreaming();
+
+    for (unsigned int n : gMeshSizes)  BenchmarkCookedMesh(n);
+    for (unsigned int n : gMeshSizes)  BenchmarkVertexPacking(n);
+    for (unsigned int n : gMeshSizes)  BenchmarkMeshOptimiser(n);
+    for (unsigned int n : gMeshSizes)  BenchmarkMeshProcessing(n);
+    for (unsigned int n : gMeshSizes)  BenchmarkMeshSimplifier(n);
+    for (unsigned int n : gMeshSizes)  BenchmarkMeshlets(n);
+    for (unsigned int n : gMeshSizes)  BenchmarkMeshBVH(n);
+    BenchmarkStreaming();
+    BenchmarkXFiles();
+    BenchmarkBVHFiles();
+    BenchmarkCodecFiles();
+
+    if (outFile != nullptr)
+    {
+        FILE* file = std::fopen(outFile, "w");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", outFile);
+            return 1;
+        }
+        WriteJSON(file);
+        std::fclose(file);
+    }
+    else
+    {
+        WriteJSON(stdout);
+    }
+
+    for (const CheckResult& c : gChecks)
+    {
+        if (!c.pass)  return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// Typical vector expressions for comparing inlined and out-of-line vector maths
+//--------------------------------------------------------------------------------------
+
+#include "VectorChains.h"
+
+#if defined(_MSC_VER)
+    #define NOINLINE __declspec(noinline)
+#else
+    #define NOINLINE __attribute__((noinline))
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Out-of-line operations
+-----------------------------------------------------------------------------------------*/
+// Same code as the inline versions in CVector3.h, but each is a real call that returns its result through
+// memory, as when they lived in a separate .cpp file
+
+NOINLINE static CVector3 Add(const CVector3& v, const CVector3& w)  { return v + w; }
+NOINLINE static CVector3 Sub(const CVector3& v, const CVector3& w)  { return v - w; }
+NOINLINE static CVector3 Mul(const CVector3& v, float s)            { return v * s; }
+NOINLINE static CVector3 CrossOutOfLine(const CVector3& v, const CVector3& w)  { return Cross(v, w); }
+NOINLINE static CVector3 NormaliseOutOfLine(const CVector3& v)  { return Normalise(v); }
+
+
+/*-----------------------------------------------------------------------------------------
+    Expressions
+-----------------------------------------------------------------------------------------*/
+
+CVector3 FaceNormal(const CVector3& a, const CVector3& b, const CVector3& c)
+{
+    return Normalise(Cross(b - a, c - a));
+}
+
+CVector3 FaceNormalOutOfLine(const CVector3& a, const CVector3& b, const CVector3& c)
+{
+    return NormaliseOutOfLine(CrossOutOfLine(Sub(b, a), Sub(c, a)));
+}
+
+
+CVector3 OrbitPosition(const CVector3& centre, float sine, float cosine, float radius)
+{
+    return centre + CVector3{ cosine * radius, 10.0f, sine * radius };
+}
+
+CVector3 OrbitPositionOutOfLine(const CVector3& centre, float sine, float cosine, float radius)
+{
+    return Add(centre, CVector3{ cosine * radius, 10.0f, sine * radius });
+}
+
+
+CVector3 MoveAndBlend(const CVector3& p, const CVector3& d, const CVector3& t, float s, float w)
+{
+    return p + d * s + (t - p) * w;
+}
+
+CVector3 MoveAndBlendOutOfLine(const CVector3& p, const CVector3& d, const CVector3& t, float s, float w)
+{
+    return Add(Add(p, Mul(d, s)), Mul(Sub(t, p), w));
+}
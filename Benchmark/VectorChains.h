@@ -0,0 +1,28 @@
+//--------------------------------------------------------------------------------------
+// Typical vector expressions for comparing inlined and out-of-line vector maths
+//--------------------------------------------------------------------------------------
+// Code in .cpp file, which is compiled on its own so the benchmark calls each function once per element
+// either way. The "OutOfLine" versions call the same operations as non-inlinable functions, one call per
+// operator, which is how the vector code behaved when Normalise / Length (and before that the operators)
+// were defined in CVector3.cpp. "make codegen" writes the assembly for this file to VectorChains.s
+
+#ifndef _VECTOR_CHAINS_H_DEFINED_
+#define _VECTOR_CHAINS_H_DEFINED_
+
+#include "CVector3.h"
+
+
+// Unit normal of triangle a,b,c: Normalise(Cross(b - a, c - a))
+CVector3 FaceNormal(const CVector3& a, const CVector3& b, const CVector3& c);
+CVector3 FaceNormalOutOfLine(const CVector3& a, const CVector3& b, const CVector3& c);
+
+// Light orbiting a model, as in Scene.cpp: centre + CVector3{ cosine * radius, 10, sine * radius }
+CVector3 OrbitPosition(const CVector3& centre, float sine, float cosine, float radius);
+CVector3 OrbitPositionOutOfLine(const CVector3& centre, float sine, float cosine, float radius);
+
+// Point moved along a direction then blended towards a target: p + (d * s) + (t - p) * w
+CVector3 MoveAndBlend(const CVector3& p, const CVector3& d, const CVector3& t, float s, float w);
+CVector3 MoveAndBlendOutOfLine(const CVector3& p, const CVector3& d, const CVector3& t, float s, float w);
+
+
+#endif // _VECTOR_CHAINS_H_DEFINED_
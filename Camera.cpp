@@ -10,22 +10,25 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
                                       KeyCode moveForward, KeyCode moveBackward, KeyCode moveLeft, KeyCode moveRight)
 {
 	//**** ROTATION ****
+	// Look up/down around the camera's local X axis, turn left/right around the world Y axis so the
+	// camera never rolls
 	if (KeyHeld(Key_Down))
 	{
-		mRotation.x += ROTATION_SPEED * frameTime /2; // Use of frameTime to ensure same speed on different machines
+		mRotation = QuaternionAxisAngle({ 1, 0, 0 },  ROTATION_SPEED * frameTime / 2) * mRotation; // Use of frameTime to ensure same speed on different machines
 	}
 	if (KeyHeld(Key_Up))
 	{
-		mRotation.x -= ROTATION_SPEED * frameTime /2;
+		mRotation = QuaternionAxisAngle({ 1, 0, 0 }, -ROTATION_SPEED * frameTime / 2) * mRotation;
 	}
 	if (KeyHeld(Key_Right))
 	{
-		mRotation.y += ROTATION_SPEED * frameTime /4.5;
+		mRotation = mRotation * QuaternionAxisAngle({ 0, 1, 0 },  ROTATION_SPEED * frameTime / 4.5f);
 	}
 	if (KeyHeld(Key_Left))
 	{
-		mRotation.y -= ROTATION_SPEED * frameTime /4.5;
+		mRotation = mRotation * QuaternionAxisAngle({ 0, 1, 0 }, -ROTATION_SPEED * frameTime / 4.5f);
 	}
+	mRotation = Normalise(mRotation); // Prevent rounding errors building up
 
 	//**** LOCAL MOVEMENT ****
 	if (KeyHeld(Key_D))
@@ -59,28 +62,28 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
 void Camera::UpdateMatrices()
 {
     // "World" matrix for the camera - treat it like a model at first
-    mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
+    mWorldMatrix = AffineFromTRS(mPosition, mRotation, { 1, 1, 1 });
 
     // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
     mViewMatrix = InverseAffine(mWorldMatrix);
 
     // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
-    float tanFOVx = std::tan(mFOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = mAspectRatio / tanFOVx;
-    float scaleZa = mFarClip / (mFarClip - mNearClip);
-    float scaleZb = -mNearClip * scaleZa;
-
-    mProjectionMatrix = CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
-                                      0.0f, scaleY,    0.0f,   0.0f,
-                                      0.0f,   0.0f, scaleZa,   1.0f,
-                                      0.0f,   0.0f, scaleZb,   0.0f };
+    mProjectionMatrix = MatrixProjection(mAspectRatio, mFOVx, mNearClip, mFarClip);
 
     // The view-projection matrix combines the two matrices usually used for the camera into one, which can save a multiply in the shaders (optional)
     mViewProjectionMatrix = mViewMatrix * mProjectionMatrix;
 }
 
-void Camera::UpdateWorldMatrix()
+
+// World space ray through a pixel of a viewport, see Camera.h
+void Camera::ScreenRay(float x, float y, float viewportWidth, float viewportHeight, CVector3& origin, CVector3& direction)
 {
-	mWorldMatrix = MatrixScaling(mScale) * MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
-}
\ No newline at end of file
+    UpdateMatrices();
+
+    // Pixel to -1 to 1 across the viewport (y up), then undo the projection's scaling to get a camera space
+    // direction with z = 1, which is scaled to reach the far clip plane
+    float viewX = (2 * x / viewportWidth  - 1) / mProjectionMatrix.e00;
+    float viewY = (1 - 2 * y / viewportHeight) / mProjectionMatrix.e11;
+    origin    = mPosition;
+    direction = TransformVector(CVector3{ viewX, viewY, 1 } * mFarClip, mWorldMatrix);
+}
@@ -6,6 +6,9 @@
 #include "Common.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
+#include "CQuaternion.h"
+#include "BoundingVolumes.h"
 #include "MathHelpers.h"
 #include "Input.h"
 
@@ -23,7 +26,7 @@ public:
 	// Constructor - initialise all settings, sensible defaults provided for everything.
 	Camera(CVector3 position = {0,0,0}, CVector3 rotation = {0,0,0}, 
            float fov = PI/3, float aspectRatio = 4.0f / 3.0f, float nearClip = 0.1f, float farClip = 10000.0f)
-        : mPosition(position), mRotation(rotation), mFOVx(fov), mAspectRatio(aspectRatio), mNearClip(nearClip), mFarClip(farClip)
+        : mPosition(position), mRotation(QuaternionFromEuler(rotation)), mFOVx(fov), mAspectRatio(aspectRatio), mNearClip(nearClip), mFarClip(farClip)
     {
     }
 
@@ -32,22 +35,23 @@ public:
 	void Control( float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,  
 	              KeyCode moveForward, KeyCode moveBackward, KeyCode moveLeft, KeyCode moveRight);
 
+	// Rotate the camera so it faces the given target point
 	void FaceTarget(CVector3 target)
 	{
-		UpdateWorldMatrix();
-		mWorldMatrix.FaceTarget(target);
-		mRotation = mWorldMatrix.GetEulerAngles();
+		mRotation = QuaternionFaceTarget(mPosition, target, mRotation);
 	}
 
 	//-------------------------------------
 	// Data access
 	//-------------------------------------
 
-	// Getters / setters
-	CVector3 Position()  { return mPosition; }
-	CVector3 Rotation()  { return mRotation;	}
-	void SetPosition(CVector3 position)  { mPosition = position; }
-	void SetRotation(CVector3 rotation)  { mRotation = rotation; }
+	// Getters / setters. Rotation is stored as a quaternion, Rotation / SetRotation convert to / from Euler angles
+	CVector3    Position()     { return mPosition; }
+	CVector3    Rotation()     { return mRotation.GetEulerAngles(); }
+	CQuaternion Orientation()  { return mRotation; }
+	void SetPosition   (CVector3 position)       { mPosition = position; }
+	void SetRotation   (CVector3 rotation)       { mRotation = QuaternionFromEuler(rotation); }
+	void SetOrientation(CQuaternion orientation) { mRotation = orientation; }
 
 	float FOV()       { return mFOVx;     }
 	float NearClip()  { return mNearClip; }
@@ -57,11 +61,29 @@ public:
 	void SetNearClip(float nearClip)  { mNearClip = nearClip; }
 	void SetFarClip (float farClip )  { mFarClip  = farClip;  }
 
+	// Multiplies the error allowed on screen when choosing mesh levels of detail (see Mesh::SelectLOD). More
+	// than 1 for cameras whose view is shown small, such as a portal or reflection
+	float LODBias()                  { return mLODBias; }
+	void  SetLODBias(float lodBias)  { mLODBias = lodBias; }
+
+	// Pixels on screen covered by one unit at a distance of one unit, for a viewport of the given height.
+	// Something of size s at distance d covers about s * PixelsPerUnit / d pixels
+	float PixelsPerUnit(float viewportHeight)  { return viewportHeight * 0.5f * mAspectRatio / std::tan(mFOVx * 0.5f); }
+
 	// Read only access to camera matrices, updated on request from position, rotation and camera settings
-	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return mViewMatrix;           }
+	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return ToMatrix4x4(mViewMatrix); }
 	CMatrix4x4 ProjectionMatrix()      { UpdateMatrices(); return mProjectionMatrix;     }
 	CMatrix4x4 ViewProjectionMatrix()  { UpdateMatrices(); return mViewProjectionMatrix; }
 
+	// World space view frustum, extracted from the view-projection matrix. Use with IsVisible or the batch
+	// culling functions in BoundingVolumes.h
+	CFrustum Frustum()  { return FrustumFromMatrix(ViewProjectionMatrix()); }
+
+	// World space ray through a pixel of a viewport of the given size (x and y in pixels from the top-left, e.g.
+	// the mouse position). The ray starts at the camera and its direction reaches the far clip plane, so points
+	// on it are origin + t * direction with t from 0 to 1 inside the view (e.g. for Model::Intersect)
+	void ScreenRay(float x, float y, float viewportWidth, float viewportHeight, CVector3& origin, CVector3& direction);
+
 	
 //-------------------------------------
 // Private members
@@ -69,13 +91,11 @@ public:
 private:
 	// Update the matrices used for the camera in the rendering pipeline
 	void UpdateMatrices();
-	void UpdateWorldMatrix();
 
 
-	// Postition and rotations for the camera (rarely scale cameras)
-	CVector3 mPosition;
-	CVector3 mRotation;
-	CVector3 mScale;
+	// Postition and rotation for the camera (rarely scale cameras)
+	CVector3    mPosition;
+	CQuaternion mRotation;
 
 	// Camera settings: field of view, aspect ratio, near and far clip plane distances.
 	// Note that the FOVx angle is measured in radians (radians = degrees * PI/180) from left to right of screen
@@ -84,9 +104,11 @@ private:
 	float mNearClip;
 	float mFarClip;
 
+	float mLODBias = 1;
+
 	// Current view, projection and combined view-projection matrices (DirectX matrix type)
-	CMatrix4x4 mWorldMatrix; // Easiest to treat the camera like a model and give it a "world" matrix...
-	CMatrix4x4 mViewMatrix;  // ...then the view matrix used in the shaders is the inverse of its world matrix
+	CMatrix3x4 mWorldMatrix; // Easiest to treat the camera like a model and give it a "world" matrix...
+	CMatrix3x4 mViewMatrix;  // ...then the view matrix used in the shaders is the inverse of its world matrix. Both are affine
 
 	CMatrix4x4 mProjectionMatrix;     // Projection matrix holds the field of view and near/far clip distances
 	CMatrix4x4 mViewProjectionMatrix; // Combine (multiply) the view and projection matrices together, which
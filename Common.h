@@ -7,9 +7,11 @@
 #include <windows.h>
 #include <d3d11.h>
 #include <string>
+#include <cstdint>
 
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
 
 
 //--------------------------------------------------------------------------------------
@@ -106,9 +108,10 @@ extern ID3D11Buffer*     gPerFrameConstantBuffer; // This variable controls the
 
 // This is the matrix that positions the next thing to be rendered in the scene. Unlike the structure above this data can be
 // updated and sent to the GPU several times every frame (once per model). However, apart from that it works in the same way.
+// The world matrix is always affine so it is sent as three float4s (see CMatrix3x4.h), 16 bytes less per model
 struct PerModelConstants
 {
-    CMatrix4x4 worldMatrix;
+    CMatrix3x4 worldMatrix;
     CVector3   objectColour; // Allows each light model to be tinted to match the light colour they cast
 	float      wiggle;
 	float      lerp;
@@ -119,4 +122,15 @@ extern PerModelConstants gPerModelConstants;      // This variable holds the CPU
 extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
 
 
+// How to decode the vertices of a mesh stored with the compact vertex profile (see VertexPacking.h). This never
+// changes once a mesh is loaded, so each Mesh keeps its own constant buffer and sets it when it is rendered
+struct PerMeshConstants
+{
+    CVector3   positionScale;       // Model space position = position in vertex buffer * scale + offset
+    uint32_t   octahedralNormals;   // 1 if normals are octahedral encoded, 0 if they are float3
+    CVector3   positionOffset;
+    uint32_t   octahedralTangents;  // As above for tangents
+};
+
+
 #endif //_COMMON_H_INCLUDED_
@@ -17,6 +17,13 @@ struct BasicVertex
 };
 
 
+// Vertex with a position only, from a mesh's depth stream (see Mesh::RenderDepthOnly)
+struct PositionVertex
+{
+    float3 position : position;
+};
+
+
 // The most basic pixel shader input, just the screen space position for the pixel
 struct BasicPixelShaderInput
 {
@@ -182,7 +189,8 @@ cbuffer PerFrameConstants : register(b0) // The b0 gives this constant buffer th
 // These variables must match exactly the gPerModelConstants structure in Scene.cpp
 cbuffer PerModelConstants : register(b1) // The b1 gives this constant buffer the number 1 - used in the C++ code
 {
-    float4x4 gWorldMatrix;
+    row_major float3x4 gWorldMatrix; // World matrices are affine so the bottom row (0,0,0,1) isn't sent. mul(gWorldMatrix, v)
+                                     // works as for a 4x4 matrix but the result is a float3
 
     float3   gObjectColour;
     float    gWiggle;
@@ -191,6 +199,57 @@ cbuffer PerModelConstants : register(b1) // The b1 gives this constant buffer th
     float    padding12;  // See notes on padding in structure above
 }
 
+
+// Meshes can store their vertices in compact formats (see VertexPacking.h in the C++ code). The input assembler
+// turns them into floats but they still need decoding: positions are quantised to the mesh's bounding box and
+// read as 0 to 1, normals and tangents are octahedral encoded into two values (the third is read as 0). Each
+// mesh sets these constants when it is rendered. Full precision meshes use a scale of 1, offset of 0 and no
+// octahedral encoding, so decoding leaves their vertices unchanged.
+// These variables must match exactly the PerMeshConstants structure in Common.h
+cbuffer PerMeshConstants : register(b2)
+{
+    float3   gPositionScale;
+    uint     gOctahedralNormals;
+    float3   gPositionOffset;
+    uint     gOctahedralTangents;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Vertex decoding
+//--------------------------------------------------------------------------------------
+
+// Unit direction from an octahedral encoding. The lower half of the octahedron (z < 0) was folded out over
+// the corners of the upper half, so fold it back. Matches OctahedralDecode in Packing.cpp
+float3 DecodeOctahedral(float2 e)
+{
+    float3 v = float3(e, 1 - abs(e.x) - abs(e.y));
+    float fold = saturate(-v.z);
+    v.xy += (v.xy >= 0) ? -fold : fold;
+    return normalize(v);
+}
+
+float3 DecodePosition(float3 position)
+{
+    return position * gPositionScale + gPositionOffset;
+}
+
+// Vertex shaders decode their input vertex with these before using it
+BasicVertex DecodeVertex(BasicVertex modelVertex)
+{
+    modelVertex.position = DecodePosition(modelVertex.position);
+    if (gOctahedralNormals)  modelVertex.normal = DecodeOctahedral(modelVertex.normal.xy);
+    return modelVertex;
+}
+
+TangentVertex DecodeVertex(TangentVertex modelVertex)
+{
+    modelVertex.position = DecodePosition(modelVertex.position);
+    if (gOctahedralNormals)   modelVertex.normal  = DecodeOctahedral(modelVertex.normal.xy);
+    if (gOctahedralTangents)  modelVertex.tangent = DecodeOctahedral(modelVertex.tangent.xy);
+    return modelVertex;
+}
+
 float3 CalculateDiffuseLight(float3 lightPosition, float3 worldPosition, float3 lightColour, float3 worldNormal)
 {
     float3 light1Vector = lightPosition - worldPosition;
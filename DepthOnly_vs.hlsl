@@ -0,0 +1,25 @@
+//--------------------------------------------------------------------------------------
+// Depth-Only Vertex Shader
+//--------------------------------------------------------------------------------------
+// For passes that only write depth (depth pre-pass, shadow maps), drawn with Mesh::RenderDepthOnly, which
+// provides positions alone. Use with no pixel shader
+
+#include "Common.hlsli" // Shaders can also use include files - note the extension
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// The transformations are the same as the other vertex shaders so the depths match theirs exactly
+BasicPixelShaderInput main(PositionVertex modelVertex)
+{
+    BasicPixelShaderInput output;
+    float4 modelPosition = float4(DecodePosition(modelVertex.position), 1); // Unpack compact positions (see Common.hlsli)
+
+    float4 worldPosition     = float4(mul(gWorldMatrix, modelPosition), 1);
+    float4 viewPosition      = mul(gViewMatrix,       worldPosition);
+    output.projectedPosition = mul(gProjectionMatrix, viewPosition);
+
+    return output;
+}
@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// File access for assimp from memory mapped files and blocks of memory
+//--------------------------------------------------------------------------------------
+
+#include "AssimpIOSystem.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+
+namespace
+{
+    // Seconds since some fixed point, for timing file access
+    double Seconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    MemoryIOStream
+-----------------------------------------------------------------------------------------*/
+
+// Read from the given memory, which must stay valid while the stream is used. Reads are counted in stats
+MemoryIOStream::MemoryIOStream(const unsigned char* data, size_t size, ImportIOStats* stats)
+    : mData(data), mSize(size), mStats(stats)
+{
+}
+
+// Map the given file and read from that, the file is closed when the stream is destroyed. Check IsOpen
+// afterwards, the file may not exist
+MemoryIOStream::MemoryIOStream(const char* fileName, ImportIOStats* stats)
+    : mStats(stats)
+{
+    mMappedFile.Open(fileName);
+    mData = mMappedFile.Data();
+    mSize = mMappedFile.Size();
+}
+
+
+// Copy up to count items of the given size from the current position, returns the number of whole items read
+size_t MemoryIOStream::Read(void* buffer, size_t size, size_t count)
+{
+    if (size == 0 || count == 0)  return 0;
+    double start = Seconds();
+
+    size_t available = (mSize - mPosition) / size;
+    if (count > available)  count = available;
+    if (count > 0)  std::memcpy(buffer, mData + mPosition, size * count);
+    mPosition += size * count;
+
+    mStats->bytesRead += size * count;
+    mStats->seconds   += Seconds() - start;
+    return count;
+}
+
+// Read-only
+size_t MemoryIOStream::Write(const void* /*buffer*/, size_t /*size*/, size_t /*count*/)
+{
+    return 0;
+}
+
+aiReturn MemoryIOStream::Seek(size_t offset, aiOrigin origin)
+{
+    size_t position;
+    if      (origin == aiOrigin_SET)  position = offset;
+    else if (origin == aiOrigin_CUR)  position = mPosition + offset;
+    else if (origin == aiOrigin_END)  position = mSize - offset; // Offset back from the end, as in assimp's MemoryIOStream
+    else                              return aiReturn_FAILURE;
+
+    if (position > mSize)  return aiReturn_FAILURE; // Also catches the wrap around of a negative position
+    mPosition = position;
+    return aiReturn_SUCCESS;
+}
+
+size_t MemoryIOStream::Tell() const
+{
+    return mPosition;
+}
+
+size_t MemoryIOStream::FileSize() const
+{
+    return mSize;
+}
+
+void MemoryIOStream::Flush()
+{
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    MappedIOSystem
+-----------------------------------------------------------------------------------------*/
+
+// Serve the named file from the given memory instead of the disk. The memory must stay valid while the
+// Importer is used
+void MappedIOSystem::AddFile(const std::string& fileName, const void* data, size_t size)
+{
+    mFiles.push_back({ fileName, static_cast<const unsigned char*>(data), size });
+}
+
+// Return the added file with the given name, or nullptr if there isn't one
+const MappedIOSystem::MemoryFile* MappedIOSystem::FindFile(const char* fileName) const
+{
+    for (const MemoryFile& file : mFiles)
+    {
+        if (ComparePaths(file.name.c_str(), fileName))  return &file;
+    }
+    return nullptr;
+}
+
+
+// Assimp checks a file exists before opening it, and also uses this to look for related files
+bool MappedIOSystem::Exists(const char* fileName) const
+{
+    if (FindFile(fileName) != nullptr)  return true;
+
+    // Don't map the file just to find out if it is there
+    FILE* file = std::fopen(fileName, "rb");
+    if (file == nullptr)  return false;
+    std::fclose(file);
+    return true;
+}
+
+char MappedIOSystem::getOsSeparator() const
+{
+#ifdef _WIN32
+    return '\\';
+#else
+    return '/';
+#endif
+}
+
+
+// Open a file for reading, from memory if it was added with AddFile or else by mapping it. Returns nullptr if
+// the file can't be opened or the mode is for writing
+Assimp::IOStream* MappedIOSystem::Open(const char* fileName, const char* mode /*= "rb"*/)
+{
+    if (std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr || std::strchr(mode, '+') != nullptr)  return nullptr;
+    double start = Seconds();
+
+    MemoryIOStream* stream;
+    const MemoryFile* memoryFile = FindFile(fileName);
+    if (memoryFile != nullptr)
+    {
+        stream = new MemoryIOStream(memoryFile->data, memoryFile->size, &mStats);
+    }
+    else
+    {
+        stream = new MemoryIOStream(fileName, &mStats);
+        if (!stream->IsOpen())
+        {
+            delete stream;
+            stream = nullptr;
+        }
+    }
+
+    if (stream != nullptr)  ++mStats.filesOpened;
+    mStats.seconds += Seconds() - start;
+    return stream;
+}
+
+void MappedIOSystem::Close(Assimp::IOStream* file)
+{
+    delete file;
+}
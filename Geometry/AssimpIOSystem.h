@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------
+// File access for assimp from memory mapped files and blocks of memory
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// By default assimp opens files with fopen and most of its importers then read the whole file into a buffer
+// of their own, so the file passes through the C library's buffer on the way. An Importer given a
+// MappedIOSystem (with SetIOHandler) instead reads from memory:
+//  - Files added with AddFile are served from memory the caller already has, e.g. a mesh file the caller
+//    has mapped (as Mesh does to hash it) or a file held in an archive loaded in one block
+//  - Any other file assimp asks for (e.g. a material library next to an .obj file) is mapped with MappedFile
+// Each read is then a single copy straight from the mapped pages into assimp's buffer.
+//
+// The IOSystem also counts the files opened, the bytes assimp reads and the time spent opening and reading
+// files, which is the whole of the file access during an import. See ImportMeshAssimp in AssimpImport.h.
+//
+// Files are read-only, opening a file for writing fails. The Importer deletes its IOSystem when it is
+// destroyed (or given another one), so a MappedIOSystem must be created with new.
+
+#ifndef _ASSIMP_IO_SYSTEM_H_INCLUDED_
+#define _ASSIMP_IO_SYSTEM_H_INCLUDED_
+
+#include "AssimpImport.h"
+#include "MappedFile.h"
+
+#include <assimp/IOSystem.hpp>
+#include <assimp/IOStream.hpp>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+// Serves reads from a block of memory. Created by MappedIOSystem::Open
+class MemoryIOStream : public Assimp::IOStream
+{
+public:
+    // Read from the given memory, which must stay valid while the stream is used. Reads are counted in stats
+    MemoryIOStream(const unsigned char* data, size_t size, ImportIOStats* stats);
+
+    // Map the given file and read from that, the file is closed when the stream is destroyed. Check IsOpen
+    // afterwards, the file may not exist
+    MemoryIOStream(const char* fileName, ImportIOStats* stats);
+
+    bool IsOpen() const  { return mData != nullptr; }
+
+    size_t   Read(void* buffer, size_t size, size_t count) override;
+    size_t   Write(const void* buffer, size_t size, size_t count) override;
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    size_t   Tell() const override;
+    size_t   FileSize() const override;
+    void     Flush() override;
+
+
+private:
+    MappedFile           mMappedFile; // Only used if the stream mapped the file itself
+    const unsigned char* mData;
+    size_t               mSize;
+    size_t               mPosition = 0;
+    ImportIOStats*       mStats;
+};
+
+
+// IOSystem for an assimp Importer that reads every file from memory, see comment at top of file
+class MappedIOSystem : public Assimp::IOSystem
+{
+public:
+    // Serve the named file from the given memory instead of the disk. The memory must stay valid while the
+    // Importer is used. The name is compared with the names assimp opens in the same way assimp does (ignoring
+    // case), so pass the same name given to Importer::ReadFile
+    void AddFile(const std::string& fileName, const void* data, size_t size);
+
+    // Files opened, bytes read and time spent so far
+    const ImportIOStats& Stats() const  { return mStats; }
+
+    bool              Exists(const char* fileName) const override;
+    char              getOsSeparator() const override;
+    Assimp::IOStream* Open(const char* fileName, const char* mode = "rb") override;
+    void              Close(Assimp::IOStream* file) override;
+
+
+private:
+    struct MemoryFile
+    {
+        std::string          name;
+        const unsigned char* data;
+        size_t               size;
+    };
+
+    // Return the added file with the given name, or nullptr if there isn't one
+    const MemoryFile* FindFile(const char* fileName) const;
+
+    std::vector<MemoryFile> mFiles;
+    ImportIOStats           mStats;
+};
+
+
+#endif //_ASSIMP_IO_SYSTEM_H_INCLUDED_
@@ -0,0 +1,245 @@
+//--------------------------------------------------------------------------------------
+// Mesh import using assimp (http://www.assimp.org/)
+//--------------------------------------------------------------------------------------
+
+#include "AssimpImport.h"
+#include "AssimpIOSystem.h"
+#include "MeshProcessing.h"
+#include "CVector2.h"
+#include "CVector3.h"
+#include "Hash.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <assimp/version.h>
+
+#include <stdexcept>
+
+
+/*-----------------------------------------------------------------------------------------
+    Import settings
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // Everything that affects the result of an import apart from the file itself. The other importer
+    // properties set in ImportMeshAssimp are fixed, change COOKED_MESH_VERSION if they are changed
+    struct ImportSettings
+    {
+        unsigned int assimpFlags;
+        int          removeComponents;
+        unsigned int generateTangents;
+        unsigned int assimpVersion[3];
+    };
+
+    ImportSettings GetImportSettings(bool requireTangents)
+    {
+        ImportSettings settings;
+
+        // Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
+        // and "Peek Definition" to see documention above each constant. The triangle order is optimised after
+        // import for every importer (MeshOptimiser.h), so aiProcess_ImproveCacheLocality is not used. Welding,
+        // normals and tangents are also done after import (MeshProcessing.h), using every core, so
+        // aiProcess_JoinIdenticalVertices, GenSmoothNormals and CalcTangentSpace are not used either
+        settings.assimpFlags = aiProcess_MakeLeftHanded |
+                               aiProcess_FixInfacingNormals |
+                               aiProcess_GenUVCoords | 
+                               aiProcess_TransformUVCoords |
+                               aiProcess_FlipUVs |
+                               aiProcess_FlipWindingOrder |
+                               aiProcess_Triangulate |
+                               aiProcess_PreTransformVertices |
+                               aiProcess_SortByPType |
+                               aiProcess_FindInvalidData | 
+                               aiProcess_OptimizeMeshes |
+                               aiProcess_FindInstances |
+                               aiProcess_FindDegenerates |
+                               aiProcess_RemoveRedundantMaterials |
+                               aiProcess_Debone |
+                               aiProcess_RemoveComponent;
+
+        // Flags to specify what mesh data to ignore. Tangents in the file are ignored too, they are always
+        // calculated after import if required by the user
+        settings.removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS | 
+                                    aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_MATERIALS |
+                                    aiComponent_TANGENTS_AND_BITANGENTS;
+        settings.generateTangents = requireTangents ? 1 : 0;
+
+        // A different version of assimp may give different results
+        settings.assimpVersion[0] = aiGetVersionMajor();
+        settings.assimpVersion[1] = aiGetVersionMinor();
+        settings.assimpVersion[2] = aiGetVersionRevision();
+
+        return settings;
+    }
+}
+
+
+// Hash of the import settings used for the given requirements (including the assimp version), to combine
+// with a hash of the file when making a cooked mesh key
+uint64_t AssimpImportKey(bool requireTangents, uint64_t seed /*= 0*/)
+{
+    ImportSettings settings = GetImportSettings(requireTangents);
+    return HashValue(settings, seed);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Import
+-----------------------------------------------------------------------------------------*/
+
+// Import a mesh file with assimp into a single vertex and index buffer, throws a std::runtime_error on failure
+MeshData ImportMeshAssimp(const std::string& fileName, bool requireTangents, ImportIOStats* ioStats /*= nullptr*/)
+{
+    return ImportMeshAssimp(fileName, nullptr, 0, requireTangents, ioStats);
+}
+
+// As above, but the contents of the file are already in memory (or data is nullptr to read the file)
+MeshData ImportMeshAssimp(const std::string& fileName, const void* data, size_t size, bool requireTangents,
+                          ImportIOStats* ioStats /*= nullptr*/)
+{
+    // All file access goes through the IOSystem, which reads from memory and counts the bytes read. The
+    // importer owns and deletes the IOSystem
+    Assimp::Importer importer;
+    MappedIOSystem* ioSystem = new MappedIOSystem;
+    if (data != nullptr)  ioSystem->AddFile(fileName, data, size);
+    importer.SetIOHandler(ioSystem);
+
+    ImportSettings settings = GetImportSettings(requireTangents);
+
+    // Other miscellaneous settings
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
+    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
+    importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+  
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, settings.removeComponents);
+
+    // Import mesh with assimp given above requirements - log output
+    Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
+    const aiScene* scene = importer.ReadFile(fileName, settings.assimpFlags);
+    Assimp::DefaultLogger::kill();
+    if (ioStats != nullptr)  *ioStats = ioSystem->Stats();
+    if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
+    if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+
+
+    //-----------------------------------
+
+    // All sub-meshes go into one vertex buffer and one index buffer so the whole mesh is rendered with a single
+    // set of buffers. They must share a vertex layout: positions are required in every sub-mesh. Normals are
+    // calculated for sub-meshes without (and tangents for every sub-mesh if requested) once the mesh is
+    // built. UVs are included if any sub-mesh has them, sub-meshes without get zeros.
+    MeshData mesh;
+    bool hasUVs = false;
+    unsigned int numIndices = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[i];
+        std::string subMeshName = assimpMesh->mName.C_Str();
+
+        if (!assimpMesh->HasPositions())  throw std::runtime_error("No position data for sub-mesh " + subMeshName + " in " + fileName);
+        if (!assimpMesh->HasFaces())      throw std::runtime_error("No face data in " + subMeshName + " in " + fileName);
+        if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+        {
+            if (assimpMesh->mNumUVComponents[0] != 2)  throw std::runtime_error("Unsupported texture coordinates in " + subMeshName + " in " + fileName);
+            hasUVs = true;
+        }
+
+        // Each sub-mesh is a range of the shared index buffer. Its indices are relative to its first vertex
+        // (base vertex), so they are the same values assimp gives
+        SubMesh subMesh;
+        subMesh.startIndex  = numIndices;
+        subMesh.numIndices  = assimpMesh->mNumFaces * 3;
+        subMesh.baseVertex  = mesh.numVertices;
+        subMesh.numVertices = assimpMesh->mNumVertices;
+        mesh.subMeshes.push_back(subMesh);
+
+        mesh.numVertices += subMesh.numVertices;
+        numIndices       += subMesh.numIndices;
+    }
+
+
+    //-----------------------------------
+
+    // Vertex layout shared by all sub-meshes
+    unsigned int positionOffset = mesh.AddElement("Position", VertexFormat::Float3);
+    unsigned int normalOffset   = mesh.AddElement("Normal",   VertexFormat::Float3);
+    unsigned int uvOffset       = hasUVs          ? mesh.AddElement("UV",      VertexFormat::Float2) : 0;
+    unsigned int vertexSize     = mesh.vertexSize;
+
+
+    //-----------------------------------
+
+    // Create CPU-side buffers to hold current mesh data - exact content is flexible so can't use a structure for a vertex - so just a block of bytes
+    mesh.vertices.resize(mesh.numVertices * vertexSize);
+    mesh.indices.resize(numIndices);
+
+
+    //-----------------------------------
+
+    // Copy mesh data from assimp to our CPU-side vertex and index buffers, one sub-mesh after another
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[i];
+        const SubMesh& subMesh = mesh.subMeshes[i];
+        unsigned char* subMeshVertices = mesh.vertices.data() + subMesh.baseVertex * vertexSize;
+        unsigned int   subMeshSize     = subMesh.numVertices * vertexSize;
+
+        CVector3* assimpPosition = reinterpret_cast<CVector3*>(assimpMesh->mVertices);
+        unsigned char* position = subMeshVertices + positionOffset;
+        unsigned char* positionEnd = position + subMeshSize;
+        while (position != positionEnd)
+        {
+            *(CVector3*)position = *assimpPosition;
+            position += vertexSize;
+            ++assimpPosition;
+        }
+
+        bool subMeshHasNormals = assimpMesh->HasNormals();
+        CVector3* assimpNormal = reinterpret_cast<CVector3*>(assimpMesh->mNormals);
+        unsigned char* normal = subMeshVertices + normalOffset;
+        unsigned char* normalEnd = normal + subMeshSize;
+        while (normal != normalEnd)
+        {
+            *(CVector3*)normal = subMeshHasNormals ? *assimpNormal : CVector3{ 0, 0, 0 };
+            normal += vertexSize;
+            if (subMeshHasNormals)  ++assimpNormal;
+        }
+
+        if (hasUVs)
+        {
+            bool subMeshHasUVs = assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0);
+            aiVector3D* assimpUV = assimpMesh->mTextureCoords[0];
+            unsigned char* uv = subMeshVertices + uvOffset;
+            unsigned char* uvEnd = uv + subMeshSize;
+            while (uv != uvEnd)
+            {
+                *(CVector2*)uv = subMeshHasUVs ? CVector2(assimpUV->x, assimpUV->y) : CVector2(0, 0);
+                uv += vertexSize;
+                if (subMeshHasUVs)  ++assimpUV;
+            }
+        }
+
+        uint32_t* index = mesh.indices.data() + subMesh.startIndex;
+        for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
+        {
+            *index++ = assimpMesh->mFaces[face].mIndices[0];
+            *index++ = assimpMesh->mFaces[face].mIndices[1];
+            *index++ = assimpMesh->mFaces[face].mIndices[2];
+        }
+    }
+
+
+    //-----------------------------------
+
+    // Assimp gives a vertex per face corner for some file types, so weld before calculating normals and
+    // tangents (which split the vertices again where needed)
+    WeldVertices(mesh);
+    GenerateSmoothNormals(mesh, MAX_SMOOTHING_ANGLE, false);
+    if (requireTangents && !GenerateTangents(mesh))  throw std::runtime_error("No texture coordinates to calculate tangents in " + fileName);
+
+    CalculateBounds(mesh);
+    return mesh;
+}
@@ -0,0 +1,44 @@
+//--------------------------------------------------------------------------------------
+// Mesh import using assimp (http://www.assimp.org/)
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Assimp supports many file types and is used for any mesh file the native parsers (e.g. XFile.h) can't
+// read. Every sub-mesh (part) of the file is imported into one shared vertex buffer and one index buffer
+// with the vertex layout used by the Mesh class: position, normal, tangent (if requested) and UV (if any
+// sub-mesh has them, sub-meshes without get zeros).
+
+#ifndef _ASSIMP_IMPORT_H_INCLUDED_
+#define _ASSIMP_IMPORT_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// File access during an import. Assimp reads files through a MappedIOSystem (AssimpIOSystem.h)
+struct ImportIOStats
+{
+    uint32_t filesOpened = 0;
+    uint64_t bytesRead   = 0;
+    double   seconds     = 0; // Time spent opening and reading files
+};
+
+// Import a mesh file with assimp into a single vertex and index buffer. Optionally calculate tangents (for
+// normal and parallax mapping). Optionally pass a pointer to get the file access during the import. Throws a
+// std::runtime_error on failure
+MeshData ImportMeshAssimp(const std::string& fileName, bool requireTangents, ImportIOStats* ioStats = nullptr);
+
+// As above, but the contents of the file are already in memory (e.g. a mapped file or a file in an archive),
+// so assimp reads them from there rather than opening the file. Any other files the mesh refers to are still
+// read from disk. The file name is needed for the file type and to find those other files
+MeshData ImportMeshAssimp(const std::string& fileName, const void* data, size_t size, bool requireTangents,
+                          ImportIOStats* ioStats = nullptr);
+
+// Hash of the import settings used for the given requirements (including the assimp version), to combine
+// with a hash of the file when making a cooked mesh key
+uint64_t AssimpImportKey(bool requireTangents, uint64_t seed = 0);
+
+
+#endif //_ASSIMP_IMPORT_H_INCLUDED_
@@ -0,0 +1,395 @@
+//--------------------------------------------------------------------------------------
+// Cooked mesh files - processed mesh data saved in a form that can be used without parsing
+//--------------------------------------------------------------------------------------
+
+#include "CookedMesh.h"
+#include "MeshCodec.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+/*-----------------------------------------------------------------------------------------
+    File format
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    const char COOKED_MESH_MAGIC[4] = { 'C', 'M', 'S', 'H' };
+
+    // All sections of the file start on this boundary
+    const uint64_t SECTION_ALIGNMENT = 16;
+
+    struct CookedMeshHeader
+    {
+        char     magic[4];       // COOKED_MESH_MAGIC
+        uint32_t version;        // COOKED_MESH_VERSION
+        uint64_t key;            // Given by the cooker, see CookedMesh.h
+        uint64_t fileSize;       // Size of the whole file, catches truncated files
+
+        uint32_t numElements;
+        uint32_t numSubMeshes;
+        uint32_t numVertices;
+        uint32_t vertexSize;
+        uint32_t numIndices;
+        uint32_t indexSize;
+
+        float    boxCentre[3];
+        float    boxHalfSize[3];
+        float    sphereCentre[3];
+        float    sphereRadius;
+
+        uint32_t numLODs;
+        uint32_t numMeshlets;
+
+        uint32_t numDepthVertices;
+        uint32_t depthVertexSize;
+        uint32_t depthIndexSize;
+        uint32_t compressed;     // 1 if the vertex and index sections are compressed (MeshCodec.h)
+
+        // Offsets from the start of the file
+        uint64_t elementsOffset;
+        uint64_t subMeshesOffset;
+        uint64_t lodsOffset;
+        uint64_t meshletsOffset;
+        uint64_t verticesOffset;
+        uint64_t indicesOffset;
+        uint64_t depthVerticesOffset;
+        uint64_t depthIndicesOffset;
+
+        // Sizes of the vertex and index sections in the file, only different from their number of items times
+        // the item size if they are compressed
+        uint64_t verticesSize;
+        uint64_t indicesSize;
+        uint64_t depthVerticesSize;
+        uint64_t depthIndicesSize;
+    };
+
+    static_assert(sizeof(CookedMeshHeader) == 208, "Cooked mesh header must have no padding");
+    static_assert(sizeof(VertexElement) == 36 && sizeof(SubMesh) == 16 && sizeof(MeshLOD) == 16 && sizeof(Meshlet) == 48,
+                  "Cooked mesh sections must have no padding");
+
+    uint64_t AlignSection(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+
+    // Write size bytes then pad the file up to the next section boundary
+    bool WriteSection(FILE* file, const void* data, uint64_t size, uint64_t& offset)
+    {
+        if (size > 0 && std::fwrite(data, 1, static_cast<size_t>(size), file) != size)  return false;
+        offset += size;
+
+        static const unsigned char zeros[SECTION_ALIGNMENT] = {};
+        uint64_t padding = AlignSection(offset) - offset;
+        if (padding > 0 && std::fwrite(zeros, 1, static_cast<size_t>(padding), file) != padding)  return false;
+        offset += padding;
+        return true;
+    }
+
+    // Check a section of count items of the given size lies within the file and is aligned
+    bool SectionValid(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+    {
+        return offset % SECTION_ALIGNMENT == 0 && offset <= fileSize && count * size <= fileSize - offset;
+    }
+
+    // Check a vertex or index section stored in the file with the given size holds count items of the given
+    // size, and lies within the file. A section that isn't compressed must be exactly the items
+    bool StoredSectionValid(uint64_t offset, uint64_t storedSize, uint64_t count, uint64_t size, bool compressed, uint64_t fileSize)
+    {
+        return (compressed || storedSize == count * size) && SectionValid(offset, storedSize, 1, fileSize);
+    }
+
+    // The element describing the depth stream's vertices, the position element moved to the start of the vertex
+    VertexElement DepthElement(const VertexElement& position)
+    {
+        VertexElement element = position;
+        element.offset = 0;
+        return element;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Writing
+-----------------------------------------------------------------------------------------*/
+
+// Write a cooked mesh file with the given key, with the vertex and index sections compressed if requested.
+// The file is written under a temporary name then renamed, so an interrupted write never leaves a partial
+// file. Returns false on failure
+bool WriteCookedMesh(const std::string& fileName, uint64_t key, const MeshDataView& mesh, bool compress /*= false*/)
+{
+    CookedMeshHeader header = {};
+    std::memcpy(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic));
+    header.version          = COOKED_MESH_VERSION;
+    header.key              = key;
+    header.numElements      = mesh.numElements;
+    header.numSubMeshes     = mesh.numSubMeshes;
+    header.numLODs          = mesh.numLODs;
+    header.numMeshlets      = mesh.numMeshlets;
+    header.numVertices      = mesh.numVertices;
+    header.vertexSize       = mesh.vertexSize;
+    header.numIndices       = mesh.numIndices;
+    header.indexSize        = mesh.indexSize;
+    header.numDepthVertices = mesh.numDepthVertices;
+    header.depthVertexSize  = mesh.depthVertexSize;
+    header.depthIndexSize   = mesh.depthIndexSize;
+    header.compressed       = compress ? 1 : 0;
+
+    header.boxCentre[0]    = mesh.boundingBox.centre.x;
+    header.boxCentre[1]    = mesh.boundingBox.centre.y;
+    header.boxCentre[2]    = mesh.boundingBox.centre.z;
+    header.boxHalfSize[0]  = mesh.boundingBox.halfSize.x;
+    header.boxHalfSize[1]  = mesh.boundingBox.halfSize.y;
+    header.boxHalfSize[2]  = mesh.boundingBox.halfSize.z;
+    header.sphereCentre[0] = mesh.boundingSphere.centre.x;
+    header.sphereCentre[1] = mesh.boundingSphere.centre.y;
+    header.sphereCentre[2] = mesh.boundingSphere.centre.z;
+    header.sphereRadius    = mesh.boundingSphere.radius;
+
+    uint64_t elementsSize      = static_cast<uint64_t>(mesh.numElements)  * sizeof(VertexElement);
+    uint64_t subMeshesSize     = static_cast<uint64_t>(mesh.numSubMeshes) * sizeof(SubMesh);
+    uint64_t lodsSize          = static_cast<uint64_t>(mesh.numLODs)      * sizeof(MeshLOD);
+    uint64_t meshletsSize      = static_cast<uint64_t>(mesh.numMeshlets)  * sizeof(Meshlet);
+    uint64_t verticesSize      = static_cast<uint64_t>(mesh.numVertices)  * mesh.vertexSize;
+    uint64_t indicesSize       = static_cast<uint64_t>(mesh.numIndices)   * mesh.indexSize;
+    uint64_t depthVerticesSize = static_cast<uint64_t>(mesh.numDepthVertices) * mesh.depthVertexSize;
+    uint64_t depthIndicesSize  = (mesh.numDepthVertices > 0) ? static_cast<uint64_t>(mesh.numIndices) * mesh.depthIndexSize : 0;
+
+    // Compressed sections are written from these instead of the mesh
+    const void* vertices      = mesh.vertices;
+    const void* indices       = mesh.indices;
+    const void* depthVertices = mesh.depthVertices;
+    const void* depthIndices  = mesh.depthIndices;
+    std::vector<unsigned char> encodedVertices, encodedIndices, encodedDepthVertices, encodedDepthIndices;
+    if (compress)
+    {
+        encodedVertices = EncodeVertices(mesh.vertices, mesh.numVertices, mesh.vertexSize, mesh.elements, mesh.numElements);
+        encodedIndices  = EncodeIndices(mesh.indices, mesh.numIndices, mesh.indexSize);
+        vertices     = encodedVertices.data();
+        indices      = encodedIndices.data();
+        verticesSize = encodedVertices.size();
+        indicesSize  = encodedIndices.size();
+
+        const VertexElement* position = FindElement(mesh, "Position");
+        if (mesh.numDepthVertices > 0 && position != nullptr)
+        {
+            VertexElement depthElement = DepthElement(*position);
+            encodedDepthVertices = EncodeVertices(mesh.depthVertices, mesh.numDepthVertices, mesh.depthVertexSize, &depthElement, 1);
+            encodedDepthIndices  = EncodeIndices(mesh.depthIndices, mesh.numIndices, mesh.depthIndexSize);
+            depthVertices     = encodedDepthVertices.data();
+            depthIndices      = encodedDepthIndices.data();
+            depthVerticesSize = encodedDepthVertices.size();
+            depthIndicesSize  = encodedDepthIndices.size();
+        }
+    }
+    header.verticesSize      = verticesSize;
+    header.indicesSize       = indicesSize;
+    header.depthVerticesSize = depthVerticesSize;
+    header.depthIndicesSize  = depthIndicesSize;
+
+    header.elementsOffset      = AlignSection(sizeof(CookedMeshHeader));
+    header.subMeshesOffset     = AlignSection(header.elementsOffset      + elementsSize);
+    header.lodsOffset          = AlignSection(header.subMeshesOffset     + subMeshesSize);
+    header.meshletsOffset      = AlignSection(header.lodsOffset          + lodsSize);
+    header.verticesOffset      = AlignSection(header.meshletsOffset      + meshletsSize);
+    header.indicesOffset       = AlignSection(header.verticesOffset      + verticesSize);
+    header.depthVerticesOffset = AlignSection(header.indicesOffset       + indicesSize);
+    header.depthIndicesOffset  = AlignSection(header.depthVerticesOffset + depthVerticesSize);
+    header.fileSize            = AlignSection(header.depthIndicesOffset  + depthIndicesSize);
+
+    std::string tempFileName = fileName + ".tmp";
+    FILE* file = std::fopen(tempFileName.c_str(), "wb");
+    if (file == nullptr)  return false;
+
+    uint64_t offset = 0;
+    bool ok = WriteSection(file, &header,            sizeof(header),    offset) &&
+              WriteSection(file, mesh.elements,      elementsSize,      offset) &&
+              WriteSection(file, mesh.subMeshes,     subMeshesSize,     offset) &&
+              WriteSection(file, mesh.lods,          lodsSize,          offset) &&
+              WriteSection(file, mesh.meshlets,      meshletsSize,      offset) &&
+              WriteSection(file, vertices,           verticesSize,      offset) &&
+              WriteSection(file, indices,            indicesSize,       offset) &&
+              WriteSection(file, depthVertices,      depthVerticesSize, offset) &&
+              WriteSection(file, depthIndices,       depthIndicesSize,  offset);
+    ok = (std::fclose(file) == 0) && ok;
+
+    // Replace any existing file (rename won't overwrite on Windows)
+    if (ok)
+    {
+        std::remove(fileName.c_str());
+        ok = (std::rename(tempFileName.c_str(), fileName.c_str()) == 0);
+    }
+    if (!ok)  std::remove(tempFileName.c_str());
+    return ok;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Reading
+-----------------------------------------------------------------------------------------*/
+
+// Map the given cooked mesh file. Returns false if it can't be opened, was cooked with a different key
+// or is not a valid cooked mesh
+bool CookedMesh::Open(const std::string& fileName, uint64_t key)
+{
+    Close();
+    if (!mFile.Open(fileName))  return false;
+
+    // The header is copied out rather than used in place, the rest of the file is used where it is
+    uint64_t fileSize = mFile.Size();
+    CookedMeshHeader header;
+    if (fileSize < sizeof(header))  { Close(); return false; }
+    std::memcpy(&header, mFile.Data(), sizeof(header));
+    const bool compressed = (header.compressed == 1);
+
+    if (std::memcmp(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != COOKED_MESH_VERSION || header.key != key || header.fileSize != fileSize ||
+        header.numElements == 0 || header.vertexSize == 0 || (header.indexSize != 2 && header.indexSize != 4) ||
+        header.compressed > 1 ||
+        !SectionValid(header.elementsOffset,  header.numElements,  sizeof(VertexElement), fileSize) ||
+        !SectionValid(header.subMeshesOffset, header.numSubMeshes, sizeof(SubMesh),       fileSize) ||
+        !SectionValid(header.lodsOffset,      header.numLODs,      sizeof(MeshLOD),       fileSize) ||
+        !SectionValid(header.meshletsOffset,  header.numMeshlets,  sizeof(Meshlet),       fileSize) ||
+        !StoredSectionValid(header.verticesOffset, header.verticesSize, header.numVertices, header.vertexSize, compressed, fileSize) ||
+        !StoredSectionValid(header.indicesOffset,  header.indicesSize,  header.numIndices,  header.indexSize,  compressed, fileSize) ||
+        (header.numDepthVertices > 0 && ((header.depthIndexSize != 2 && header.depthIndexSize != 4) ||
+        !StoredSectionValid(header.depthVerticesOffset, header.depthVerticesSize, header.numDepthVertices, header.depthVertexSize, compressed, fileSize) ||
+        !StoredSectionValid(header.depthIndicesOffset,  header.depthIndicesSize,  header.numIndices,       header.depthIndexSize,  compressed, fileSize))))
+    {
+        Close();
+        return false;
+    }
+
+    const unsigned char* data = mFile.Data();
+    mView.elements     = reinterpret_cast<const VertexElement*>(data + header.elementsOffset);
+    mView.numElements  = header.numElements;
+    mView.subMeshes    = reinterpret_cast<const SubMesh*>(data + header.subMeshesOffset);
+    mView.numSubMeshes = header.numSubMeshes;
+    mView.lods         = reinterpret_cast<const MeshLOD*>(data + header.lodsOffset);
+    mView.numLODs      = header.numLODs;
+    mView.meshlets     = reinterpret_cast<const Meshlet*>(data + header.meshletsOffset);
+    mView.numMeshlets  = header.numMeshlets;
+    mView.vertices     = data + header.verticesOffset;
+    mView.numVertices  = header.numVertices;
+    mView.vertexSize   = header.vertexSize;
+    mView.indices      = data + header.indicesOffset;
+    mView.numIndices   = header.numIndices;
+    mView.indexSize    = header.indexSize;
+    if (header.numDepthVertices > 0)
+    {
+        mView.depthVertices    = data + header.depthVerticesOffset;
+        mView.numDepthVertices = header.numDepthVertices;
+        mView.depthVertexSize  = header.depthVertexSize;
+        mView.depthIndices     = data + header.depthIndicesOffset;
+        mView.depthIndexSize   = header.depthIndexSize;
+    }
+    mView.boundingBox    = CAABB{ { header.boxCentre[0], header.boxCentre[1], header.boxCentre[2] },
+                                  { header.boxHalfSize[0], header.boxHalfSize[1], header.boxHalfSize[2] } };
+    mView.boundingSphere = CSphere{ { header.sphereCentre[0], header.sphereCentre[1], header.sphereCentre[2] }, header.sphereRadius };
+
+    // Every element must be a known format lying within the vertex, with a terminated name
+    for (uint32_t i = 0; i < mView.numElements; ++i)
+    {
+        const VertexElement& element = mView.elements[i];
+        uint32_t size = VertexFormatSize(element.format);
+        if (size == 0 || static_cast<uint64_t>(element.offset) + size > mView.vertexSize ||
+            std::memchr(element.semantic, 0, sizeof(element.semantic)) == nullptr)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // Every sub-mesh must lie within the buffers (the index values themselves are not checked, the GPU
+    // treats an out of range index as a zero vertex)
+    for (uint32_t i = 0; i < mView.numSubMeshes; ++i)
+    {
+        const SubMesh& subMesh = mView.subMeshes[i];
+        if (static_cast<uint64_t>(subMesh.startIndex) + subMesh.numIndices  > mView.numIndices ||
+            static_cast<uint64_t>(subMesh.baseVertex) + subMesh.numVertices > mView.numVertices)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // A depth stream holds the positions in the same format as the vertices
+    if (mView.numDepthVertices > 0)
+    {
+        const VertexElement* position = FindElement(mView, "Position");
+        if (position == nullptr || VertexFormatSize(position->format) != mView.depthVertexSize)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // Every LOD must be a range of the sub-meshes
+    for (uint32_t i = 0; i < mView.numLODs; ++i)
+    {
+        const MeshLOD& lod = mView.lods[i];
+        if (static_cast<uint64_t>(lod.firstSubMesh) + lod.numSubMeshes > mView.numSubMeshes)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // Every meshlet must be a range of its sub-mesh's indices
+    for (uint32_t i = 0; i < mView.numMeshlets; ++i)
+    {
+        const Meshlet& meshlet = mView.meshlets[i];
+        if (meshlet.subMesh >= mView.numSubMeshes ||
+            meshlet.startIndex < mView.subMeshes[meshlet.subMesh].startIndex ||
+            static_cast<uint64_t>(meshlet.startIndex) + meshlet.numIndices >
+            static_cast<uint64_t>(mView.subMeshes[meshlet.subMesh].startIndex) + mView.subMeshes[meshlet.subMesh].numIndices)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // Compressed sections are decoded into buffers owned by this object, the rest of the file stays mapped
+    if (compressed)
+    {
+        mVertices.resize(static_cast<size_t>(mView.numVertices) * mView.vertexSize);
+        mIndices.resize(static_cast<size_t>(mView.numIndices) * mView.indexSize);
+        bool decoded = DecodeVertices(data + header.verticesOffset, static_cast<size_t>(header.verticesSize), mVertices.data(),
+                                      mView.numVertices, mView.vertexSize, mView.elements, mView.numElements) &&
+                       DecodeIndices(data + header.indicesOffset, static_cast<size_t>(header.indicesSize), mIndices.data(),
+                                     mView.numIndices, mView.indexSize);
+        if (decoded && mView.numDepthVertices > 0)
+        {
+            VertexElement depthElement = DepthElement(*FindElement(mView, "Position"));
+            mDepthVertices.resize(static_cast<size_t>(mView.numDepthVertices) * mView.depthVertexSize);
+            mDepthIndices.resize(static_cast<size_t>(mView.numIndices) * mView.depthIndexSize);
+            decoded = DecodeVertices(data + header.depthVerticesOffset, static_cast<size_t>(header.depthVerticesSize), mDepthVertices.data(),
+                                     mView.numDepthVertices, mView.depthVertexSize, &depthElement, 1) &&
+                      DecodeIndices(data + header.depthIndicesOffset, static_cast<size_t>(header.depthIndicesSize), mDepthIndices.data(),
+                                    mView.numIndices, mView.depthIndexSize);
+            mView.depthVertices = mDepthVertices.data();
+            mView.depthIndices  = mDepthIndices.data();
+        }
+        if (!decoded)
+        {
+            Close();
+            return false;
+        }
+        mView.vertices = mVertices.data();
+        mView.indices  = mIndices.data();
+    }
+
+    return true;
+}
+
+
+void CookedMesh::Close()
+{
+    mFile.Close();
+    mView = MeshDataView();
+    mVertices.clear();
+    mIndices.clear();
+    mDepthVertices.clear();
+    mDepthIndices.clear();
+}
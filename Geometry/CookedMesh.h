@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------
+// Cooked mesh files - processed mesh data saved in a form that can be used without parsing
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Importing a mesh with assimp (parsing the file then running all the post-processing steps) is slow, so the
+// Mesh class saves the result of the first import as a cooked mesh file next to the original. On later runs
+// the cooked file is memory mapped and its vertices, indices and layout are handed straight to buffer
+// creation, nothing is parsed or copied on the CPU.
+//
+// The vertex and index sections can be compressed (MeshCodec.h), which makes the file about half the size.
+// Opening a compressed file decodes those sections into memory owned by the CookedMesh object. Decoding is
+// slower than an NVMe drive reads and indices no faster than a SATA one (see MeshCodec.h), so this is only
+// faster than reading the extra data from slower storage, and it gives up using the vertices and indices in place. Everything else is still used in place.
+//
+// Each cooked file holds a 64-bit key given by the code that cooked it. The key should identify everything
+// the result depends on (a hash of the source file and the import settings), opening with a different key
+// fails, so a cooked file is remade whenever the source file or the settings change. A file from an older
+// version of this code, a truncated file or any file that fails the size and range checks is also rejected.
+//
+// File layout (little-endian, as written by the machine that cooked it): a fixed size header, then the vertex
+// elements, sub-meshes, levels of detail, meshlets, vertices, indices and the depth stream's positions and
+// indices, each starting on a 16 byte boundary so they can be used in place. The header gives the size of the
+// four vertex and index sections as stored, which is smaller than their contents if they are compressed.
+
+#ifndef _COOKED_MESH_H_INCLUDED_
+#define _COOKED_MESH_H_INCLUDED_
+
+#include "MeshData.h"
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+// Version of the file format, increase this whenever the format or the cooking process changes
+const uint32_t COOKED_MESH_VERSION = 12;
+
+
+// Write a cooked mesh file with the given key, with the vertex and index sections compressed if requested
+// (see comment at top of file). The file is written under a temporary name then renamed, so an interrupted
+// write never leaves a partial file. Returns false on failure (the caller can carry on without a cooked file)
+bool WriteCookedMesh(const std::string& fileName, uint64_t key, const MeshDataView& mesh, bool compress = false);
+
+
+// A cooked mesh file opened for use. The data stays mapped until the object is closed or destroyed
+class CookedMesh
+{
+public:
+    // Map the given cooked mesh file. Returns false if it can't be opened, was cooked with a different key
+    // or is not a valid cooked mesh
+    bool Open(const std::string& fileName, uint64_t key);
+
+    void Close();
+
+    bool IsOpen() const  { return mFile.IsOpen(); }
+
+    // The mesh data, pointing straight into the mapped file or into the decoded sections of a compressed file
+    const MeshDataView& View() const  { return mView; }
+
+
+private:
+    MappedFile   mFile;
+    MeshDataView mView;
+
+    // Decoded vertex and index sections of a compressed file, empty otherwise
+    std::vector<unsigned char> mVertices;
+    std::vector<unsigned char> mIndices;
+    std::vector<unsigned char> mDepthVertices;
+    std::vector<unsigned char> mDepthIndices;
+};
+
+
+#endif //_COOKED_MESH_H_INCLUDED_
@@ -0,0 +1,538 @@
+//--------------------------------------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles for ray queries on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "MeshBVH.h"
+#include "VertexPacking.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    // Deepest node allowed, which is also the most nodes a ray can have waiting to be visited
+    const uint32_t MAX_BVH_DEPTH = 64;
+
+    // Subtrees are only given to another thread if they have at least this many triangles
+    const uint32_t MIN_PARALLEL_TRIANGLES = 4096;
+
+    const float INFINITE_DISTANCE = std::numeric_limits<float>::infinity();
+
+
+    CVector3 Minimum(const CVector3& a, const CVector3& b)  { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+    CVector3 Maximum(const CVector3& a, const CVector3& b)  { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+
+    // Half the surface area of a box, 0 for an empty box. Only ratios of areas are used so the half doesn't matter
+    float HalfArea(const CVector3& boxMin, const CVector3& boxMax)
+    {
+        CVector3 size = boxMax - boxMin;
+        if (size.x < 0 || size.y < 0 || size.z < 0)  return 0;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+
+    // A triangle while building, with its bounds. The triangles of a node are moved to either side of the
+    // split in this array, so each node's triangles are together in memory
+    struct BuildTriangle
+    {
+        CVector3 boundsMin;
+        uint32_t triangle;
+        CVector3 boundsMax;
+        uint32_t unused;
+
+        CVector3 Centre() const  { return (boundsMin + boundsMax) * 0.5f; }
+    };
+
+    // Bounds of some triangles and of their centres. Not initialised, start from EMPTY_BOUNDS
+    struct BuildBounds
+    {
+        CVector3 boundsMin;
+        CVector3 boundsMax;
+        CVector3 centreMin;
+        CVector3 centreMax;
+        uint32_t count;
+
+        void Add(const BuildTriangle& triangle, const CVector3& centre)
+        {
+            boundsMin = Minimum(boundsMin, triangle.boundsMin);
+            boundsMax = Maximum(boundsMax, triangle.boundsMax);
+            centreMin = Minimum(centreMin, centre);
+            centreMax = Maximum(centreMax, centre);
+            ++count;
+        }
+
+        void Add(const BuildBounds& other)
+        {
+            boundsMin = Minimum(boundsMin, other.boundsMin);
+            boundsMax = Maximum(boundsMax, other.boundsMax);
+            centreMin = Minimum(centreMin, other.centreMin);
+            centreMax = Maximum(centreMax, other.centreMax);
+            count += other.count;
+        }
+    };
+
+    const BuildBounds EMPTY_BOUNDS = { {  INFINITE_DISTANCE,  INFINITE_DISTANCE,  INFINITE_DISTANCE },
+                                       { -INFINITE_DISTANCE, -INFINITE_DISTANCE, -INFINITE_DISTANCE },
+                                       {  INFINITE_DISTANCE,  INFINITE_DISTANCE,  INFINITE_DISTANCE },
+                                       { -INFINITE_DISTANCE, -INFINITE_DISTANCE, -INFINITE_DISTANCE }, 0 };
+
+    // The triangles whose centres are in one bin when choosing a split. Only their bounds are needed for the
+    // SAH, the children's centre bounds are found when the triangles are split
+    struct BuildBin
+    {
+        CVector3 boundsMin;
+        CVector3 boundsMax;
+        uint32_t count;
+
+        void Add(const CVector3& otherMin, const CVector3& otherMax, uint32_t otherCount)
+        {
+            boundsMin = Minimum(boundsMin, otherMin);
+            boundsMax = Maximum(boundsMax, otherMax);
+            count += otherCount;
+        }
+    };
+
+    const BuildBin EMPTY_BIN = { {  INFINITE_DISTANCE,  INFINITE_DISTANCE,  INFINITE_DISTANCE },
+                                 { -INFINITE_DISTANCE, -INFINITE_DISTANCE, -INFINITE_DISTANCE }, 0 };
+
+    // A node whose subtree is left to be built by one of the threads
+    struct BuildTask
+    {
+        uint32_t    node;
+        uint32_t    first;
+        uint32_t    depth;
+        BuildBounds bounds;
+    };
+
+    // Which of numBins bins on an axis a triangle centre is in, where the bins start at binsStart with binsScale
+    // bins per unit
+    inline uint32_t BinOf(float centre, float binsStart, float binsScale, uint32_t numBins)
+    {
+        float position = (centre - binsStart) * binsScale;
+        return std::min(static_cast<uint32_t>(std::max(position, 0.0f)), numBins - 1);
+    }
+
+
+    // Build the subtree of nodes[nodeIndex] from the triangles from first, which have the given bounds. The
+    // triangles are put into leaf order. Each node is split at the bin edge with the lowest SAH cost (see comment
+    // at top of MeshBVH.h) on any axis, with all three axes binned in one pass. Nodes with few triangles use
+    // fewer bins, as most of the tree's nodes are small. If tasks isn't null, a node with no more than taskSize
+    // triangles is added to the list instead, to be built later
+    void BuildNode(std::vector<BVHNode>& nodes, uint32_t nodeIndex, uint32_t first, uint32_t depth, const BuildBounds& bounds,
+                   BuildTriangle* triangles, uint32_t taskSize, std::vector<BuildTask>* tasks)
+    {
+        const uint32_t count = bounds.count;
+        if (tasks != nullptr && count <= taskSize)
+        {
+            tasks->push_back({ nodeIndex, first, depth, bounds });
+            return;
+        }
+
+        // Start as a leaf
+        BVHNode& node = nodes[nodeIndex];
+        node.boundsMin    = bounds.boundsMin;
+        node.boundsMax    = bounds.boundsMax;
+        node.leftFirst    = first;
+        node.numTriangles = count;
+        if (count <= 1 || depth + 1 >= MAX_BVH_DEPTH)  return;
+
+        // Axes where the centres are all at the same point can't be split
+        const uint32_t numBins = std::min(count, SAH_BINS);
+        float binsStart[3], binsScale[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float extent = (&bounds.centreMax.x)[axis] - (&bounds.centreMin.x)[axis];
+            binsStart[axis] = (&bounds.centreMin.x)[axis];
+            binsScale[axis] = (extent > 0) ? numBins / extent : 0;
+            if (!std::isfinite(binsScale[axis]))  binsScale[axis] = 0;
+        }
+        if (binsScale[0] == 0 && binsScale[1] == 0 && binsScale[2] == 0)  return;
+
+        BuildBin bins[3][SAH_BINS];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            for (uint32_t b = 0; b < numBins; ++b)  bins[axis][b] = EMPTY_BIN;
+        }
+        // Axes that can't be split are binned anyway (all into bin 0) to keep this loop free of branches
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const BuildTriangle& triangle = triangles[i];
+            CVector3 centre = triangle.Centre();
+            bins[0][BinOf(centre.x, binsStart[0], binsScale[0], numBins)].Add(triangle.boundsMin, triangle.boundsMax, 1);
+            bins[1][BinOf(centre.y, binsStart[1], binsScale[1], numBins)].Add(triangle.boundsMin, triangle.boundsMax, 1);
+            bins[2][BinOf(centre.z, binsStart[2], binsScale[2], numBins)].Add(triangle.boundsMin, triangle.boundsMax, 1);
+        }
+
+        // Sweep up each axis for the area and count below each bin edge, then down for the rest. A node with no area
+        // (all its triangles in a line) has splits of equal cost, any will do
+        float nodeArea = HalfArea(bounds.boundsMin, bounds.boundsMax);
+        if (nodeArea == 0)  nodeArea = 1;
+        float    bestCost = INFINITE_DISTANCE;
+        int      bestAxis = 0;
+        uint32_t bestBin  = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (binsScale[axis] == 0)  continue;
+
+            float    belowArea[SAH_BINS];
+            uint32_t belowCount[SAH_BINS];
+            BuildBin below = EMPTY_BIN;
+            for (uint32_t b = 1; b < numBins; ++b)
+            {
+                const BuildBin& bin = bins[axis][b - 1];
+                below.Add(bin.boundsMin, bin.boundsMax, bin.count);
+                belowArea[b]  = HalfArea(below.boundsMin, below.boundsMax);
+                belowCount[b] = below.count;
+            }
+            BuildBin above = EMPTY_BIN;
+            for (uint32_t b = numBins - 1; b > 0; --b)
+            {
+                const BuildBin& bin = bins[axis][b];
+                above.Add(bin.boundsMin, bin.boundsMax, bin.count);
+                if (belowCount[b] == 0 || above.count == 0)  continue;
+                float cost = BVH_TRAVERSAL_COST + (belowArea[b] * belowCount[b] + HalfArea(above.boundsMin, above.boundsMax) * above.count) / nodeArea;
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin  = b;
+                }
+            }
+        }
+
+        // Split if it is cheaper than testing every triangle, or if there are too many to test
+        if (bestCost == INFINITE_DISTANCE)  return;
+        if (bestCost >= count && count <= MAX_BVH_LEAF_TRIANGLES)  return;
+
+        // Move the triangles below the split to the start, finding the bounds of each side as they are placed
+        BuildBounds below = EMPTY_BOUNDS;
+        BuildBounds above = EMPTY_BOUNDS;
+        uint32_t i = first;
+        uint32_t j = first + count;
+        while (i < j)
+        {
+            CVector3 centre = triangles[i].Centre();
+            if (BinOf((&centre.x)[bestAxis], binsStart[bestAxis], binsScale[bestAxis], numBins) < bestBin)
+            {
+                below.Add(triangles[i++], centre);
+            }
+            else
+            {
+                std::swap(triangles[i], triangles[--j]);
+                above.Add(triangles[j], centre);
+            }
+        }
+
+        uint32_t children = static_cast<uint32_t>(nodes.size());
+        nodes.resize(children + 2); // May move the nodes, so node is not used after this
+        nodes[nodeIndex].leftFirst    = children;
+        nodes[nodeIndex].numTriangles = 0;
+        BuildNode(nodes, children,     first,               depth + 1, below, triangles, taskSize, tasks);
+        BuildNode(nodes, children + 1, first + below.count, depth + 1, above, triangles, taskSize, tasks);
+    }
+
+
+    // Distance along a ray to where it enters a box, infinite if it misses the box or enters it beyond maxDistance.
+    // inverseDirection is 1 / each component of the direction
+    inline float RayBoxDistance(const CVector3& origin, const CVector3& inverseDirection, const BVHNode& node, float maxDistance)
+    {
+        float x1 = (node.boundsMin.x - origin.x) * inverseDirection.x;
+        float x2 = (node.boundsMax.x - origin.x) * inverseDirection.x;
+        float y1 = (node.boundsMin.y - origin.y) * inverseDirection.y;
+        float y2 = (node.boundsMax.y - origin.y) * inverseDirection.y;
+        float z1 = (node.boundsMin.z - origin.z) * inverseDirection.z;
+        float z2 = (node.boundsMax.z - origin.z) * inverseDirection.z;
+        float enter = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+        float leave = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), maxDistance));
+        return (enter <= leave) ? enter : INFINITE_DISTANCE;
+    }
+
+
+    // Moller-Trumbore ray / triangle test from either side. Updates the hit and returns true if the triangle is
+    // hit closer than hit.distance
+    inline bool IntersectTriangle(const CVector3& origin, const CVector3& direction,
+                                  const CVector3& p0, const CVector3& p1, const CVector3& p2, RayHit& hit)
+    {
+        CVector3 edge1 = p1 - p0;
+        CVector3 edge2 = p2 - p0;
+        CVector3 p = Cross(direction, edge2);
+        float determinant = Dot(edge1, p);
+        if (determinant == 0)  return false; // Ray parallel to the triangle, or the triangle has no area
+
+        float inverseDeterminant = 1.0f / determinant;
+        CVector3 s = origin - p0;
+        float u = Dot(s, p) * inverseDeterminant;
+        if (u < 0 || u > 1)  return false;
+        CVector3 q = Cross(s, edge1);
+        float v = Dot(direction, q) * inverseDeterminant;
+        if (v < 0 || u + v > 1)  return false;
+        float t = Dot(edge2, q) * inverseDeterminant;
+        if (t < 0 || t >= hit.distance)  return false;
+
+        hit.distance = t;
+        hit.u = u;
+        hit.v = v;
+        return true;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Building
+-----------------------------------------------------------------------------------------*/
+
+// Copy the full detail mesh's positions and indices and build the hierarchy, see comment at top of MeshBVH.h
+bool MeshBVH::Build(const MeshDataView& mesh, unsigned int numThreads /*= 0*/)
+{
+    *this = MeshBVH();
+
+    const VertexElement* position = FindElement(mesh, "Position");
+    if (position == nullptr || (position->format != VertexFormat::Float3 && position->format != VertexFormat::UNorm16x4))  return false;
+
+    // Triangles of the full detail parts, with base vertices added to the indices
+    const uint32_t numParts = (mesh.numLODs > 0) ? mesh.lods[0].numSubMeshes : mesh.numSubMeshes;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> triangleIds;
+    for (uint32_t part = 0; part < numParts; ++part)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[part];
+        for (uint32_t i = subMesh.startIndex; i + 2 < subMesh.startIndex + subMesh.numIndices; i += 3)
+        {
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                uint32_t index;
+                if (mesh.indexSize == 2)  index = static_cast<const uint16_t*>(mesh.indices)[i + corner];
+                else                      index = static_cast<const uint32_t*>(mesh.indices)[i + corner];
+                indices.push_back(subMesh.baseVertex + index);
+            }
+            triangleIds.push_back(i / 3);
+        }
+    }
+    const uint32_t numTriangles = static_cast<uint32_t>(triangleIds.size());
+    if (numTriangles == 0)  return false;
+    numThreads = ParallelThreads(numThreads);
+
+    // Model space positions, decoding quantised positions as the vertex shader does
+    CVector3 scale, offset;
+    PositionDecoding(mesh, scale, offset);
+    mPositions.resize(mesh.numVertices);
+    const unsigned char* vertices = static_cast<const unsigned char*>(mesh.vertices) + position->offset;
+    ParallelFor(mesh.numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t v = begin; v < end; ++v)
+        {
+            const unsigned char* vertex = vertices + static_cast<size_t>(v) * mesh.vertexSize;
+            if (position->format == VertexFormat::Float3)
+            {
+                std::memcpy(&mPositions[v], vertex, sizeof(CVector3));
+            }
+            else
+            {
+                uint16_t quantised[3];
+                std::memcpy(quantised, vertex, sizeof(quantised));
+                mPositions[v] = { quantised[0] / 65535.0f * scale.x + offset.x,
+                                  quantised[1] / 65535.0f * scale.y + offset.y,
+                                  quantised[2] / 65535.0f * scale.z + offset.z };
+            }
+        }
+    });
+
+    // Triangle bounds, and the bounds of all the triangles for the root node
+    std::vector<BuildTriangle> triangles(numTriangles);
+    ParallelFor(numTriangles, numThreads, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            const CVector3& p0 = mPositions[indices[t * 3]];
+            const CVector3& p1 = mPositions[indices[t * 3 + 1]];
+            const CVector3& p2 = mPositions[indices[t * 3 + 2]];
+            triangles[t].boundsMin = Minimum(Minimum(p0, p1), p2);
+            triangles[t].boundsMax = Maximum(Maximum(p0, p1), p2);
+            triangles[t].triangle  = t;
+            triangles[t].unused    = 0;
+        }
+    });
+    BuildBounds rootBounds = EMPTY_BOUNDS;
+    for (const BuildTriangle& triangle : triangles)  rootBounds.Add(triangle, triangle.Centre());
+
+    // Build the top of the tree here, leaving subtrees of about a quarter of each thread's share (so the
+    // threads can balance their work) to be built by the threads, then join the subtrees' nodes to the array
+    mNodes.reserve(numTriangles * 2 / MAX_BVH_LEAF_TRIANGLES + 1);
+    mNodes.resize(1);
+    std::vector<BuildTask> tasks;
+    bool parallel = (numThreads > 1 && numTriangles >= 2 * MIN_PARALLEL_TRIANGLES);
+    uint32_t taskSize = std::max(numTriangles / (numThreads * 4), MIN_PARALLEL_TRIANGLES);
+    BuildNode(mNodes, 0, 0, 0, rootBounds, triangles.data(), taskSize, parallel ? &tasks : nullptr);
+
+    // Each thread takes the next task left until there are none
+    std::vector<std::vector<BVHNode>> subtrees(tasks.size());
+    std::atomic<uint32_t> nextTask(0);
+    if (!tasks.empty())
+    {
+        ParallelFor(numThreads, numThreads, [&](uint32_t, uint32_t)
+        {
+            for (uint32_t t = nextTask++; t < tasks.size(); t = nextTask++)
+            {
+                const BuildTask& task = tasks[t];
+                subtrees[t].reserve(task.bounds.count * 2 / MAX_BVH_LEAF_TRIANGLES + 1);
+                subtrees[t].resize(1);
+                BuildNode(subtrees[t], 0, task.first, task.depth, task.bounds, triangles.data(), 0, nullptr);
+            }
+        }, 1);
+    }
+
+    for (size_t t = 0; t < tasks.size(); ++t)
+    {
+        // The subtree's root replaces the task's node, its other nodes go on the end of the array
+        const uint32_t moveBy = static_cast<uint32_t>(mNodes.size()) - 1;
+        for (size_t i = 0; i < subtrees[t].size(); ++i)
+        {
+            BVHNode node = subtrees[t][i];
+            if (node.numTriangles == 0)  node.leftFirst += moveBy;
+            if (i == 0)  mNodes[tasks[t].node] = node;
+            else         mNodes.push_back(node);
+        }
+    }
+    mNodes.shrink_to_fit();
+
+    // Store the triangles in leaf order
+    mIndices.resize(numTriangles * 3);
+    mTriangleIds.resize(numTriangles);
+    for (uint32_t i = 0; i < numTriangles; ++i)
+    {
+        uint32_t triangle = triangles[i].triangle;
+        mIndices[i * 3]     = indices[triangle * 3];
+        mIndices[i * 3 + 1] = indices[triangle * 3 + 1];
+        mIndices[i * 3 + 2] = indices[triangle * 3 + 2];
+        mTriangleIds[i] = triangleIds[triangle];
+    }
+    return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Ray queries
+-----------------------------------------------------------------------------------------*/
+
+// Find the closest triangle hit by the ray origin + t * direction with t from 0 to maxDistance, in model
+// space. Visits the nearer child of each node first, and skips nodes further away than the closest hit
+bool MeshBVH::Intersect(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit) const
+{
+    if (mNodes.empty())  return false;
+
+    // Components of the direction that are 0 give infinities, which the box test handles
+    const CVector3 inverseDirection = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+    RayHit closest = { maxDistance, 0, 0, 0 };
+    uint32_t closestSlot = UINT32_MAX;
+
+    struct StackEntry
+    {
+        const BVHNode* node;
+        float          distance;
+    };
+    StackEntry stack[MAX_BVH_DEPTH];
+    uint32_t   stackSize = 0;
+
+    const BVHNode* node = &mNodes[0];
+    if (RayBoxDistance(origin, inverseDirection, *node, closest.distance) == INFINITE_DISTANCE)  return false;
+    for (;;)
+    {
+        if (node->numTriangles > 0)
+        {
+            for (uint32_t slot = node->leftFirst; slot < node->leftFirst + node->numTriangles; ++slot)
+            {
+                const uint32_t* triangle = &mIndices[slot * 3];
+                if (IntersectTriangle(origin, direction, mPositions[triangle[0]], mPositions[triangle[1]], mPositions[triangle[2]], closest))
+                {
+                    closestSlot = slot;
+                }
+            }
+        }
+        else
+        {
+            const BVHNode* nearChild = &mNodes[node->leftFirst];
+            const BVHNode* farChild  = nearChild + 1;
+            float nearDistance = RayBoxDistance(origin, inverseDirection, *nearChild, closest.distance);
+            float farDistance  = RayBoxDistance(origin, inverseDirection, *farChild,  closest.distance);
+            if (farDistance < nearDistance)
+            {
+                std::swap(nearChild, farChild);
+                std::swap(nearDistance, farDistance);
+            }
+            if (nearDistance != INFINITE_DISTANCE)
+            {
+                if (farDistance != INFINITE_DISTANCE)  stack[stackSize++] = { farChild, farDistance };
+                node = nearChild;
+                continue;
+            }
+        }
+
+        // Next waiting node that is still nearer than the closest hit
+        do
+        {
+            if (stackSize == 0)
+            {
+                if (closestSlot == UINT32_MAX)  return false;
+                hit = closest;
+                hit.triangle = mTriangleIds[closestSlot];
+                return true;
+            }
+            node = stack[--stackSize].node;
+        } while (stack[stackSize].distance > closest.distance);
+    }
+}
+
+
+// The same by testing every triangle, for checking Intersect
+bool MeshBVH::IntersectAll(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit) const
+{
+    RayHit closest = { maxDistance, 0, 0, 0 };
+    uint32_t closestSlot = UINT32_MAX;
+    for (uint32_t slot = 0; slot < NumTriangles(); ++slot)
+    {
+        const uint32_t* triangle = &mIndices[slot * 3];
+        if (IntersectTriangle(origin, direction, mPositions[triangle[0]], mPositions[triangle[1]], mPositions[triangle[2]], closest))
+        {
+            closestSlot = slot;
+        }
+    }
+    if (closestSlot == UINT32_MAX)  return false;
+    hit = closest;
+    hit.triangle = mTriangleIds[closestSlot];
+    return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Statistics
+-----------------------------------------------------------------------------------------*/
+
+// Memory used by the positions, triangles and nodes
+size_t MeshBVH::MemoryBytes() const
+{
+    return mNodes.size() * sizeof(BVHNode) + mPositions.size() * sizeof(CVector3) +
+           mIndices.size() * sizeof(uint32_t) + mTriangleIds.size() * sizeof(uint32_t);
+}
+
+
+// Expected cost of a ray that hits the root box, in triangle tests: each node's cost weighted by the chance
+// the ray hits it
+float MeshBVH::SAHCost() const
+{
+    if (mNodes.empty())  return 0;
+    float rootArea = HalfArea(mNodes[0].boundsMin, mNodes[0].boundsMax);
+    if (rootArea == 0)  return static_cast<float>(NumTriangles());
+
+    float cost = 0;
+    for (const BVHNode& node : mNodes)
+    {
+        float chance = HalfArea(node.boundsMin, node.boundsMax) / rootArea;
+        cost += chance * (node.numTriangles > 0 ? node.numTriangles : BVH_TRAVERSAL_COST);
+    }
+    return cost;
+}
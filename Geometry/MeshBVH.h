@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles for ray queries on the CPU
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Once a mesh is in GPU buffers the CPU can't see its triangles, so finding what the mouse is over (or any
+// other ray test against the real shape of a mesh) needs a CPU copy. MeshBVH keeps the model space positions
+// and indices of the full detail mesh (LOD 0) with a bounding volume hierarchy (BVH) over its triangles, a
+// binary tree of boxes where each box holds its two children and each leaf a few triangles. A ray only tests
+// the triangles in the leaves whose boxes it passes through, visiting the nearer child first and skipping
+// boxes further away than the closest hit so far, so a ray against a million triangles tests a few dozen.
+//
+// The tree is built top down. Each node is split where the surface area heuristic (SAH) estimates the lowest
+// cost of tracing a random ray through the two halves: the cost of a child is its number of triangles times
+// the chance a ray that hits the parent box hits the child box, which is the ratio of their surface areas.
+// The split positions tried are the edges of SAH_BINS equal bins across the triangles' centres on each axis.
+// A node becomes a leaf when no split is cheaper than testing its triangles, as long as it has no more than
+// MAX_BVH_LEAF_TRIANGLES of them.
+//
+// Nodes are 32 bytes, two to a cache line, in one array with the two children of a node next to each other,
+// so a node needs only one index. The triangles are stored in leaf order, so a leaf is a range of them.
+// Large meshes are built in parallel: the top of the tree is built until there are enough subtrees of a
+// reasonable size, then each thread builds whole subtrees into its own array and they are joined at the end.
+// The tree is the same whatever the number of threads, only the order of the nodes in the array changes.
+
+#ifndef _MESH_BVH_H_INCLUDED_
+#define _MESH_BVH_H_INCLUDED_
+
+#include "MeshData.h"
+#include "CVector3.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Number of split positions tried on each axis when building a node, see comment at top of file
+const uint32_t SAH_BINS = 16;
+
+// Largest leaf, nodes with more triangles are always split if they can be
+const uint32_t MAX_BVH_LEAF_TRIANGLES = 8;
+
+// Cost of visiting a node relative to testing a triangle, used by the SAH
+const float BVH_TRAVERSAL_COST = 1.0f;
+
+
+// A node of the hierarchy, see comment at top of file
+struct BVHNode
+{
+    CVector3 boundsMin;
+    uint32_t leftFirst;     // Internal node: index of the first child, the second follows it. Leaf: first triangle
+    CVector3 boundsMax;
+    uint32_t numTriangles;  // 0 for an internal node
+};
+
+
+// The closest triangle hit by a ray
+struct RayHit
+{
+    float    distance;  // Along the ray, in multiples of the length of the ray's direction
+    uint32_t triangle;  // Number of the triangle in the mesh's index buffer (its first index / 3)
+    float    u;         // Barycentric coordinates: the point hit is (1 - u - v) * corner 0 + u * corner 1 + v * corner 2
+    float    v;
+};
+
+
+class MeshBVH
+{
+public:
+    // Copy the full detail mesh's positions (decoded if packed) and indices and build the hierarchy, with
+    // numThreads threads (0 for one for each core). Returns false and leaves the hierarchy empty if the mesh
+    // has no triangles or no Float3 or UNorm16x4 "Position" element
+    bool Build(const MeshDataView& mesh, unsigned int numThreads = 0);
+
+    bool Empty() const  { return mNodes.empty(); }
+
+    // Find the closest triangle hit by the ray origin + t * direction with t from 0 to maxDistance, in model
+    // space. Triangles are hit from either side. Returns false if no triangle is hit
+    bool Intersect(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit) const;
+
+    // The same by testing every triangle, for checking Intersect
+    bool IntersectAll(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit) const;
+
+    const std::vector<BVHNode>& Nodes() const  { return mNodes; }
+    uint32_t NumTriangles() const  { return static_cast<uint32_t>(mTriangleIds.size()); }
+
+    // Memory used by the positions, triangles and nodes
+    size_t MemoryBytes() const;
+
+    // Expected cost of a ray that hits the root box, in triangle tests (see comment at top of file). Lower is
+    // a better tree
+    float SAHCost() const;
+
+
+private:
+    std::vector<BVHNode>  mNodes;        // mNodes[0] is the root
+    std::vector<CVector3> mPositions;    // All the mesh's vertices, model space
+    std::vector<uint32_t> mIndices;      // Three vertices per triangle, in leaf order
+    std::vector<uint32_t> mTriangleIds;  // Triangle number in the mesh of each triangle above
+};
+
+
+#endif //_MESH_BVH_H_INCLUDED_
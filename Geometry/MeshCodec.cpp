@@ -0,0 +1,929 @@
+//--------------------------------------------------------------------------------------
+// Lossless compression of vertex and index buffers for cooked mesh files
+//--------------------------------------------------------------------------------------
+
+#include "MeshCodec.h"
+#include "MathSIMD.h"
+
+#include <algorithm>
+#include <cstring>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace
+{
+    /*-----------------------------------------------------------------------------------------
+        Byte planes
+    -----------------------------------------------------------------------------------------*/
+    // A plane is stored as a header of 2 bits per group of 16 bytes, four groups to a header byte, followed by
+    // the groups. The 2 bits choose how the group's bytes are stored: all zero (nothing stored), 2 bits each,
+    // 4 bits each or 8 bits each. With 2 and 4 bits the largest value (3 or 15) is an escape, and the real bytes
+    // of every group follow the last group in order, so a group of small values with one or two large ones
+    // stays small. Keeping the escaped bytes apart means where each group starts depends only on the header
+    // and the groups can be decoded without waiting for the one before
+
+    const uint32_t GROUP_SIZE      = 16;
+    const uint32_t GROUP_BYTES[4]  = { 0, 4, 8, 16 }; // Size of a group with each mode
+    const uint32_t GROUP_ESCAPE[4] = { 0, 3, 15, 0 }; // Value marking an escaped byte with each mode
+    const uint32_t MAX_ESCAPES     = 4; // Groups needing more use a wider mode
+
+
+    // Add count bytes to the end of encoded, see comment above
+    void EncodePlane(const unsigned char* plane, uint32_t count, std::vector<unsigned char>& encoded)
+    {
+        const uint32_t numGroups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+        size_t header = encoded.size();
+        encoded.resize(header + (numGroups + 3) / 4, 0);
+
+        std::vector<unsigned char> escapes;
+        for (uint32_t g = 0; g < numGroups; ++g)
+        {
+            unsigned char group[GROUP_SIZE] = {};
+            std::memcpy(group, plane + g * GROUP_SIZE, std::min(GROUP_SIZE, count - g * GROUP_SIZE));
+
+            // Choose the smallest mode including the escaped bytes, within the limit on escaped bytes
+            uint32_t mode = 3;
+            bool     allZero = true;
+            uint32_t size[3] = { 0, GROUP_BYTES[1], GROUP_BYTES[2] };
+            for (uint32_t i = 0; i < GROUP_SIZE; ++i)
+            {
+                allZero = allZero && group[i] == 0;
+                if (group[i] >= GROUP_ESCAPE[1])  ++size[1];
+                if (group[i] >= GROUP_ESCAPE[2])  ++size[2];
+            }
+            if      (allZero)                                                        mode = 0;
+            else if (size[1] <= size[2] && size[1] <= GROUP_BYTES[1] + MAX_ESCAPES)  mode = 1;
+            else if (size[2] <= GROUP_BYTES[2] + MAX_ESCAPES)                        mode = 2;
+            encoded[header + g / 4] |= static_cast<unsigned char>(mode << ((g % 4) * 2));
+
+            // Byte i of a group stores values 4i to 4i+3 (2 bits each) or 2i and 2i+1 (4 bits), lowest bits first
+            if (mode == 1 || mode == 2)
+            {
+                const uint32_t bits   = (mode == 1) ? 2 : 4;
+                const uint32_t escape = GROUP_ESCAPE[mode];
+                const uint32_t perByte = 8 / bits;
+                for (uint32_t i = 0; i < GROUP_SIZE; i += perByte)
+                {
+                    unsigned char packed = 0;
+                    for (uint32_t j = 0; j < perByte; ++j)  packed |= static_cast<unsigned char>(std::min<uint32_t>(group[i + j], escape) << (j * bits));
+                    encoded.push_back(packed);
+                }
+                for (uint32_t i = 0; i < GROUP_SIZE; ++i)
+                {
+                    if (group[i] >= escape)  escapes.push_back(group[i]);
+                }
+            }
+            else if (mode == 3)
+            {
+                encoded.insert(encoded.end(), group, group + GROUP_SIZE);
+            }
+        }
+        encoded.insert(encoded.end(), escapes.begin(), escapes.end());
+    }
+
+
+    // Unpack the packed bits of one group of 16 bytes stored with the given mode, leaving escaped bytes as
+    // the escape value. Returns a bit for each escaped byte
+    inline uint32_t UnpackGroup(const unsigned char* data, uint32_t mode, unsigned char* group)
+    {
+        for (uint32_t i = 0; i < GROUP_SIZE; ++i)
+        {
+            if      (mode == 0)  group[i] = 0;
+            else if (mode == 1)  group[i] = (data[i / 4] >> ((i % 4) * 2)) & 0x03;
+            else if (mode == 2)  group[i] = (data[i / 2] >> ((i % 2) * 4)) & 0x0F;
+            else                 group[i] = data[i];
+        }
+
+        uint32_t escaped = 0;
+        if (mode == 1 || mode == 2)
+        {
+            for (uint32_t i = 0; i < GROUP_SIZE; ++i)  escaped |= (group[i] == GROUP_ESCAPE[mode] ? 1u : 0u) << i;
+        }
+        return escaped;
+    }
+
+#if defined(MATH_SIMD_SSE)
+    // For each mode, masks keeping the values unpacked with 2 bits, 4 bits or 8 bits, and the escape value
+    alignas(16) const unsigned char MODE_MASKS[4][4][GROUP_SIZE] =
+    {
+        { {    0 }, {    0 }, {    0 }, {    0 } }, // Escape value 0 is never looked for, see below
+        { { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, { 0 }, { 0 },
+          { 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3 } },
+        { { 0 }, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, { 0 },
+          { 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15 } },
+        { { 0 }, { 0 }, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+          { 0 } },
+    };
+
+    // The same, but reading 16 bytes from data whatever the mode. The group is unpacked with every mode and
+    // the one it was stored with is kept, so there are no branches on the mode
+    inline uint32_t UnpackGroupSSE(const unsigned char* data, uint32_t mode, unsigned char* group)
+    {
+        static const uint32_t ESCAPE_BITS[4] = { 0, 0xFFFF, 0xFFFF, 0 };
+        const __m128i* masks = reinterpret_cast<const __m128i*>(MODE_MASKS[mode]);
+
+        const __m128i raw   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i mask2 = _mm_set1_epi8(0x03);
+        const __m128i mask4 = _mm_set1_epi8(0x0F);
+
+        // Split each byte into its fields, then interleave the fields back into value order
+        __m128i f0 = _mm_and_si128(raw, mask2);
+        __m128i f1 = _mm_and_si128(_mm_srli_epi16(raw, 2), mask2);
+        __m128i f2 = _mm_and_si128(_mm_srli_epi16(raw, 4), mask2);
+        __m128i f3 = _mm_and_si128(_mm_srli_epi16(raw, 6), mask2);
+        __m128i bits2 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(f0, f1), _mm_unpacklo_epi8(f2, f3));
+        __m128i bits4 = _mm_unpacklo_epi8(_mm_and_si128(raw, mask4), _mm_and_si128(_mm_srli_epi16(raw, 4), mask4));
+
+        __m128i values = _mm_and_si128(bits2, _mm_load_si128(masks));
+        values = _mm_or_si128(values, _mm_and_si128(bits4, _mm_load_si128(masks + 1)));
+        values = _mm_or_si128(values, _mm_and_si128(raw, _mm_load_si128(masks + 2)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(group), values);
+
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(values, _mm_load_si128(masks + 3)))) & ESCAPE_BITS[mode];
+    }
+#endif
+
+
+    // Position of the lowest set bit, bits must not be 0
+    inline uint32_t LowestBit(uint32_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long position;
+        _BitScanForward(&position, bits);
+        return position;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+    }
+
+
+    // Read a plane of count bytes into plane, which must have room for count rounded up to a whole group. Moves
+    // data past the plane, returns false if the plane runs past end
+    bool DecodePlane(const unsigned char*& data, const unsigned char* end, unsigned char* plane, uint32_t count)
+    {
+        const uint32_t numGroups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+        const unsigned char* header = data;
+        if (static_cast<size_t>(end - header) < (numGroups + 3) / 4)  return false;
+
+        // A local copy, as the compiler must assume writes to the plane could change data
+        const unsigned char* groups = header + (numGroups + 3) / 4;
+        size_t groupBytes = 0;
+        for (uint32_t g = 0; g < numGroups; ++g)  groupBytes += GROUP_BYTES[(header[g / 4] >> ((g % 4) * 2)) & 0x03];
+        if (static_cast<size_t>(end - groups) < groupBytes)  return false;
+        const unsigned char* escapes = groups + groupBytes;
+
+        for (uint32_t g = 0; g < numGroups; ++g)
+        {
+            uint32_t mode = (header[g / 4] >> ((g % 4) * 2)) & 0x03;
+            unsigned char* group = plane + g * GROUP_SIZE;
+#if defined(MATH_SIMD_SSE)
+            uint32_t escaped = (static_cast<size_t>(end - groups) >= GROUP_SIZE) ? UnpackGroupSSE(groups, mode, group) : UnpackGroup(groups, mode, group);
+#else
+            uint32_t escaped = UnpackGroup(groups, mode, group);
+#endif
+            for (; escaped != 0; escaped &= escaped - 1)
+            {
+                if (escapes == end)  return false;
+                group[LowestBit(escaped)] = *escapes++;
+            }
+            groups += GROUP_BYTES[mode];
+        }
+        data = escapes;
+        return true;
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Vertex components
+    -----------------------------------------------------------------------------------------*/
+
+    // Part of a vertex whose difference from the previous vertex is taken as one number
+    struct VertexComponent
+    {
+        uint32_t offset;
+        uint32_t size; // 1, 2 or 4 bytes
+    };
+
+    uint32_t ComponentSize(VertexFormat format)
+    {
+        switch (format)
+        {
+        case VertexFormat::Float3:
+        case VertexFormat::Float2:    return 4;
+        case VertexFormat::UNorm16x4:
+        case VertexFormat::Half2:
+        case VertexFormat::SNorm16x2: return 2;
+        }
+        return 1;
+    }
+
+    // Components covering every byte of a vertex once, in order. Bytes outside the elements, or in elements
+    // that are unknown, lie outside the vertex or overlap an earlier element, are single byte components
+    std::vector<VertexComponent> VertexComponents(uint32_t vertexSize, const VertexElement* elements, uint32_t numElements)
+    {
+        std::vector<uint32_t> componentSize(vertexSize, 1);
+        std::vector<bool>     inElement(vertexSize, false);
+        for (uint32_t e = 0; e < numElements; ++e)
+        {
+            const VertexElement& element = elements[e];
+            uint32_t size = VertexFormatSize(element.format);
+            if (size == 0 || element.offset > vertexSize || size > vertexSize - element.offset)  continue;
+            if (std::find(inElement.begin() + element.offset, inElement.begin() + element.offset + size, true) != inElement.begin() + element.offset + size)  continue;
+
+            uint32_t component = ComponentSize(element.format);
+            for (uint32_t i = 0; i < size; ++i)  inElement[element.offset + i] = true;
+            for (uint32_t i = 0; i < size; i += component)  componentSize[element.offset + i] = component;
+        }
+
+        std::vector<VertexComponent> components;
+        for (uint32_t offset = 0; offset < vertexSize; offset += componentSize[offset])
+        {
+            components.push_back({ offset, componentSize[offset] });
+        }
+        return components;
+    }
+
+
+    // Zigzag encoding of a difference at the width of T, see comment at top of MeshCodec.h
+    template <typename T> inline T ZigZag(T difference)
+    {
+        return static_cast<T>(static_cast<T>(difference << 1) ^ static_cast<T>(0 - (difference >> (sizeof(T) * 8 - 1))));
+    }
+    template <typename T> inline T UnZigZag(T value)
+    {
+        return static_cast<T>((value >> 1) ^ static_cast<T>(0 - (value & 1)));
+    }
+
+
+    // Write the zigzagged differences of one component of count vertices into its byte planes (plane stride
+    // VERTEX_CODEC_BLOCK). previous is the component of the vertex before the first, updated to the last
+    template <typename T>
+    void ComponentDifferences(const unsigned char* vertices, uint32_t count, uint32_t vertexSize, T& previous, unsigned char* planes)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            T value;
+            std::memcpy(&value, vertices + static_cast<size_t>(i) * vertexSize, sizeof(T));
+            T difference = ZigZag(static_cast<T>(value - previous));
+            previous = value;
+            for (uint32_t b = 0; b < sizeof(T); ++b)  planes[b * VERTEX_CODEC_BLOCK + i] = static_cast<unsigned char>(difference >> (b * 8));
+        }
+    }
+
+    // The reverse: add up the differences in the byte planes into count vertices
+    template <typename T>
+    void AddDifferencesScalar(const unsigned char* planes, uint32_t count, uint32_t vertexSize, T& previous, unsigned char* vertices)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            T difference = planes[i];
+            for (uint32_t b = 1; b < sizeof(T); ++b)  difference |= static_cast<T>(planes[b * VERTEX_CODEC_BLOCK + i]) << (b * 8);
+            previous = static_cast<T>(previous + UnZigZag(difference));
+            std::memcpy(vertices + static_cast<size_t>(i) * vertexSize, &previous, sizeof(T));
+        }
+    }
+
+    // Used for 1 byte components, or all components without SSE
+    template <typename T>
+    void AddDifferences(const unsigned char* planes, uint32_t count, uint32_t vertexSize, T& previous, unsigned char* vertices)
+    {
+        AddDifferencesScalar(planes, count, vertexSize, previous, vertices);
+    }
+
+
+#if defined(MATH_SIMD_SSE)
+    // SSE versions for 4 and 2 byte components, undoing the zigzag and adding up 4 or 8 differences at once
+    // with a prefix sum across the lanes. The vertices are too far apart to store other than one by one
+    template <>
+    void AddDifferences<uint32_t>(const unsigned char* planes, uint32_t count, uint32_t vertexSize, uint32_t& previous, unsigned char* vertices)
+    {
+        const __m128i one = _mm_set1_epi32(1);
+        __m128i sum = _mm_set1_epi32(static_cast<int>(previous));
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            uint32_t bytes[4];
+            for (uint32_t b = 0; b < 4; ++b)  std::memcpy(&bytes[b], planes + b * VERTEX_CODEC_BLOCK + i, sizeof(uint32_t));
+            __m128i b01 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(bytes[0])), _mm_cvtsi32_si128(static_cast<int>(bytes[1])));
+            __m128i b23 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(bytes[2])), _mm_cvtsi32_si128(static_cast<int>(bytes[3])));
+            __m128i value = _mm_unpacklo_epi16(b01, b23);
+
+            value = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)));
+            value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+            value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+            value = _mm_add_epi32(value, sum);
+            sum = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+
+            unsigned char* vertex = vertices + static_cast<size_t>(i) * vertexSize;
+            uint32_t result[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result), value);
+            for (uint32_t v = 0; v < 4; ++v)  std::memcpy(vertex + v * vertexSize, &result[v], sizeof(uint32_t));
+        }
+        previous = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+        AddDifferencesScalar(planes + i, count - i, vertexSize, previous, vertices + static_cast<size_t>(i) * vertexSize);
+    }
+
+    template <>
+    void AddDifferences<uint16_t>(const unsigned char* planes, uint32_t count, uint32_t vertexSize, uint16_t& previous, unsigned char* vertices)
+    {
+        const __m128i one = _mm_set1_epi16(1);
+        __m128i sum = _mm_set1_epi16(static_cast<short>(previous));
+        uint32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i low  = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(planes + i));
+            __m128i high = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(planes + VERTEX_CODEC_BLOCK + i));
+            __m128i value = _mm_unpacklo_epi8(low, high);
+
+            value = _mm_xor_si128(_mm_srli_epi16(value, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(value, one)));
+            value = _mm_add_epi16(value, _mm_slli_si128(value, 2));
+            value = _mm_add_epi16(value, _mm_slli_si128(value, 4));
+            value = _mm_add_epi16(value, _mm_slli_si128(value, 8));
+            value = _mm_add_epi16(value, sum);
+            sum = _mm_set1_epi16(static_cast<short>(_mm_extract_epi16(value, 7)));
+
+            unsigned char* vertex = vertices + static_cast<size_t>(i) * vertexSize;
+            uint16_t result[8];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result), value);
+            for (uint32_t v = 0; v < 8; ++v)  std::memcpy(vertex + v * vertexSize, &result[v], sizeof(uint16_t));
+        }
+        previous = static_cast<uint16_t>(_mm_extract_epi16(sum, 0));
+        AddDifferencesScalar(planes + i, count - i, vertexSize, previous, vertices + static_cast<size_t>(i) * vertexSize);
+    }
+
+
+    // When every component is aligned to its size, the SSE decoder doesn't use the functions above. It works on
+    // 16 vertices and 16 bytes of the vertex (a chunk) at a time: the 16 planes of the chunk are transposed back
+    // into the 16 vertices, then each vertex's chunk is its difference added to the chunk of the vertex before,
+    // at the width of each component. So the vertices are written 16 bytes at a time rather than one component
+    // at a time. A chunk is masks of its bytes in 4, 2 and 1 byte components
+    struct VertexChunk
+    {
+        __m128i  width4, width2, width1;
+        uint32_t width; // 4 or 2 if all the bytes are in components of that size, otherwise 0
+    };
+
+    // The chunks covering a vertex, or none if a component isn't aligned to its size
+    std::vector<VertexChunk> VertexChunks(const std::vector<VertexComponent>& components, uint32_t vertexSize)
+    {
+        // Width of the component each byte is in, 0 past the end of the vertex where any width will do
+        const uint32_t numChunks = (vertexSize + GROUP_SIZE - 1) / GROUP_SIZE;
+        std::vector<unsigned char> widths(numChunks * GROUP_SIZE, 0);
+        for (const VertexComponent& component : components)
+        {
+            if (component.offset % component.size != 0)  return {};
+            for (uint32_t i = 0; i < component.size; ++i)  widths[component.offset + i] = static_cast<unsigned char>(component.size);
+        }
+
+        std::vector<VertexChunk> chunks(numChunks);
+        for (uint32_t c = 0; c < numChunks; ++c)
+        {
+            unsigned char masks[3][GROUP_SIZE];
+            uint32_t      chunkWidths = 0; // Bit for each width used
+            for (uint32_t i = 0; i < GROUP_SIZE; ++i)
+            {
+                const unsigned char width = widths[c * GROUP_SIZE + i];
+                masks[0][i] = (width == 4) ? 0xFF : 0;
+                masks[1][i] = (width == 2) ? 0xFF : 0;
+                masks[2][i] = (width == 1) ? 0xFF : 0;
+                chunkWidths |= width;
+            }
+            chunks[c].width = (chunkWidths == 4 || chunkWidths == 2) ? chunkWidths : 0;
+            chunks[c].width4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[0]));
+            chunks[c].width2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[1]));
+            chunks[c].width1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[2]));
+        }
+        return chunks;
+    }
+
+    // Interleave row i with row i + 8 for each i, which rotates the 8 bits of a byte's row and column one place,
+    // so doing it four times transposes 16 rows of 16 bytes
+    inline void InterleaveRows(const __m128i (&rows)[16], __m128i (&interleaved)[16])
+    {
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            interleaved[i * 2]     = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+            interleaved[i * 2 + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+        }
+    }
+
+    // A chunk from the chunk of the vertex before and the zigzagged differences, see VertexChunk. WIDTH is the
+    // chunk's width, or 0 to add at every width and keep each byte's own
+    template <uint32_t WIDTH>
+    inline __m128i AddChunkDifferences(__m128i previous, __m128i value, const VertexChunk& chunk)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i add4 = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(zero, _mm_and_si128(value, _mm_set1_epi32(1))));
+        __m128i add2 = _mm_xor_si128(_mm_srli_epi16(value, 1), _mm_sub_epi16(zero, _mm_and_si128(value, _mm_set1_epi16(1))));
+        if (WIDTH == 4)  return _mm_add_epi32(previous, add4);
+        if (WIDTH == 2)  return _mm_add_epi16(previous, add2);
+
+        __m128i add1 = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(value, 1), _mm_set1_epi8(0x7F)), _mm_sub_epi8(zero, _mm_and_si128(value, _mm_set1_epi8(1))));
+        __m128i result = _mm_and_si128(_mm_add_epi32(previous, add4), chunk.width4);
+        result = _mm_or_si128(result, _mm_and_si128(_mm_add_epi16(previous, add2), chunk.width2));
+        return _mm_or_si128(result, _mm_and_si128(_mm_add_epi8(previous, add1), chunk.width1));
+    }
+
+    // Add up one chunk of count vertices from its transposed rows with AddChunkDifferences<WIDTH>, returning the
+    // last vertex's chunk
+    template <uint32_t WIDTH>
+    inline __m128i AddChunkRows(const __m128i* rows, uint32_t count, uint32_t vertexSize, const VertexChunk& chunk,
+                                __m128i previous, unsigned char* vertices)
+    {
+        for (uint32_t v = 0; v < count; ++v)
+        {
+            previous = AddChunkDifferences<WIDTH>(previous, rows[v], chunk);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(vertices + static_cast<size_t>(v) * vertexSize), previous);
+        }
+        return previous;
+    }
+
+    // Add up count vertices (up to 16) from their planes (stride VERTEX_CODEC_BLOCK, 16 planes for each chunk).
+    // previous has the chunks of the vertex before, updated to the last. Each chunk is stored whole, so the last
+    // chunk of a vertex runs into the next vertex when the vertex size isn't a multiple of 16. The chunks are
+    // written last first and the vertices in order, so what runs over is written again, except past the last
+    // vertex, where vertices needs room for 16 more bytes
+    void AddChunkDifferences(const unsigned char* planes, uint32_t count, uint32_t vertexSize,
+                             const std::vector<VertexChunk>& chunks, __m128i* previous, unsigned char* vertices)
+    {
+        for (uint32_t c = static_cast<uint32_t>(chunks.size()); c-- > 0; )
+        {
+            __m128i rows[16], interleaved[16];
+            for (uint32_t r = 0; r < 16; ++r)
+            {
+                rows[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + static_cast<size_t>(c * GROUP_SIZE + r) * VERTEX_CODEC_BLOCK));
+            }
+            InterleaveRows(rows, interleaved);
+            InterleaveRows(interleaved, rows);
+            InterleaveRows(rows, interleaved);
+            InterleaveRows(interleaved, rows);
+
+            unsigned char* chunkVertices = vertices + c * GROUP_SIZE;
+            if      (chunks[c].width == 4)  previous[c] = AddChunkRows<4>(rows, count, vertexSize, chunks[c], previous[c], chunkVertices);
+            else if (chunks[c].width == 2)  previous[c] = AddChunkRows<2>(rows, count, vertexSize, chunks[c], previous[c], chunkVertices);
+            else                            previous[c] = AddChunkRows<0>(rows, count, vertexSize, chunks[c], previous[c], chunkVertices);
+        }
+    }
+#endif
+
+    /*-----------------------------------------------------------------------------------------
+        Indices
+    -----------------------------------------------------------------------------------------*/
+    // The rotation of every triangle comes first, as a byte plane (see above) of numbers 0 to 2, then a code
+    // byte for every triangle, then the number of differences and the differences themselves, zigzagged and
+    // split into 4 byte planes. Rotated left by its rotation, a triangle starts with its first edge and ends
+    // with its third corner. The high 4 bits of the code are which of the last 15 edges in the edge FIFO the
+    // triangle shares (most recent first), which is its first edge reversed, or 15 if it shares none. Then its
+    // first edge is two differences, from the third corner of the triangle before and from the first corner,
+    // and the triangle isn't rotated. The low 4 bits give the third corner: 0 for the next unused vertex, 1 to
+    // 14 for an entry in the vertex FIFO (most recent first) or 15 for a difference from the end of the first
+    // edge. The differences are in the order the triangles use them, and indices after the last whole triangle
+    // follow as differences from the next unused vertex. The decoder reads codes and differences at fixed
+    // places rather than one after the other, so it has no branches on them
+    //
+    // Each triangle adds the edges it doesn't share to the edge FIFO, and the corners not on a shared edge
+    // to the vertex FIFO, so the decoder keeps the same FIFOs as the encoder
+
+    const uint32_t FIFO_SIZE      = 16; // Power of 2 so positions wrap with a mask
+    const uint32_t FIFO_ENTRIES   = 15; // Entries that can be referred to, the last code is "none"
+    const uint32_t VERTEX_ENTRIES = 14; // Vertex FIFO entries that can be referred to, after "next"
+    const uint32_t CODE_NONE      = 15;
+
+    // Corners of a triangle rotated left by 0 to 2, with a fourth entry keeping the decoder inside the triangle
+    // for damaged rotations
+    const uint32_t FIRST_CORNER[4] = { 0, 1, 2, 0 };
+    const uint32_t NEXT_CORNER[4]  = { 1, 2, 0, 1 };
+    const uint32_t PREV_CORNER[4]  = { 2, 0, 1, 2 };
+
+    // Ring buffers of recent edges and vertices, entry 0 is the most recent
+    struct IndexFIFOs
+    {
+        uint32_t edges[FIFO_SIZE][2] = {};
+        uint32_t vertices[FIFO_SIZE] = {};
+        uint32_t edgeHead = 0;
+        uint32_t vertexHead = 0;
+
+        const uint32_t* Edge(uint32_t entry) const { return edges[(edgeHead - 1 - entry) & (FIFO_SIZE - 1)]; }
+        uint32_t      Vertex(uint32_t entry) const { return vertices[(vertexHead - 1 - entry) & (FIFO_SIZE - 1)]; }
+
+        void AddEdge(uint32_t a, uint32_t b)
+        {
+            uint32_t* edge = edges[edgeHead++ & (FIFO_SIZE - 1)];
+            edge[0] = a;
+            edge[1] = b;
+        }
+        void AddVertex(uint32_t vertex) { vertices[vertexHead++ & (FIFO_SIZE - 1)] = vertex; }
+
+        // Add the edges and corners of a triangle (already rotated) that aren't on the shared edge, if any
+        void AddTriangle(const uint32_t* corners, uint32_t rotation, bool sharesEdge)
+        {
+            const uint32_t c0 = corners[rotation], c1 = corners[NEXT_CORNER[rotation]], c2 = corners[PREV_CORNER[rotation]];
+            if (!sharesEdge)
+            {
+                AddEdge(c0, c1);
+                AddVertex(c0);
+                AddVertex(c1);
+            }
+            AddEdge(c1, c2);
+            AddEdge(c2, c0);
+            AddVertex(c2);
+        }
+    };
+
+    inline void WriteVarint(std::vector<unsigned char>& encoded, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            encoded.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        encoded.push_back(static_cast<unsigned char>(value));
+    }
+
+    inline bool ReadVarint(const unsigned char*& data, const unsigned char* end, uint32_t& value)
+    {
+        value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7)
+        {
+            if (data == end)  return false;
+            unsigned char byte = *data++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (byte < 0x80)  return true;
+        }
+        return false;
+    }
+
+    // Update the next unused vertex after a vertex is used. The same as the decoder's max, including for vertex
+    // 0xFFFFFFFF, which leaves next alone
+    inline void UseVertex(uint32_t vertex, uint32_t& next)
+    {
+        next = std::max(next, vertex + 1);
+    }
+
+    // a where mask is all ones and b where it is zero, written with masks as compilers can turn ?: into branches
+    inline uint32_t Select(uint32_t mask, uint32_t a, uint32_t b)
+    {
+        return (a & mask) | (b & ~mask);
+    }
+
+
+    // Join the 4 byte planes (stride planeSize) of count zigzagged differences back into differences
+    void JoinDifferences(const unsigned char* planes, uint32_t planeSize, uint32_t count, uint32_t* differences)
+    {
+        uint32_t i = 0;
+#if defined(MATH_SIMD_SSE)
+        const __m128i one = _mm_set1_epi32(1);
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + i));
+            const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + planeSize + i));
+            const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + planeSize * 2 + i));
+            const __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + planeSize * 3 + i));
+            const __m128i low[2]  = { _mm_unpacklo_epi8(b0, b1), _mm_unpackhi_epi8(b0, b1) };
+            const __m128i high[2] = { _mm_unpacklo_epi8(b2, b3), _mm_unpackhi_epi8(b2, b3) };
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                __m128i value = (j % 2 == 0) ? _mm_unpacklo_epi16(low[j / 2], high[j / 2]) : _mm_unpackhi_epi16(low[j / 2], high[j / 2]);
+                value = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(differences + i + j * 4), value);
+            }
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            differences[i] = UnZigZag(static_cast<uint32_t>(planes[i]) | (static_cast<uint32_t>(planes[planeSize + i]) << 8) |
+                                      (static_cast<uint32_t>(planes[planeSize * 2 + i]) << 16) | (static_cast<uint32_t>(planes[planeSize * 3 + i]) << 24));
+        }
+    }
+
+
+    // DecodeIndices for indices of type T, see EncodeIndices. The FIFOs are the same as IndexFIFOs but held in
+    // locals so their heads stay in registers. next is written to the free slot at the head of the vertex FIFO,
+    // so code 0 reads it like the other entries. The edge and corners added by a triangle not sharing an edge are
+    // always written to the FIFOs, but the heads only move past them if it doesn't share one, and each triangle
+    // takes its corners from both cases with masks. So the only branch in the loop is the check on the number
+    // of differences used, which is not taken until the data is damaged
+    template <typename T>
+    bool DecodeTriangles(const unsigned char* data, size_t encodedSize, T* indices, uint32_t numIndices)
+    {
+        const unsigned char* end = data + encodedSize;
+        const uint32_t numTriangles = numIndices / 3;
+        std::vector<unsigned char> rotations((numTriangles + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE);
+        if (!DecodePlane(data, end, rotations.data(), numTriangles))  return false;
+        if (static_cast<size_t>(end - data) < numTriangles)  return false;
+        const unsigned char* codes = data;
+        data += numTriangles;
+
+        uint32_t numDifferences;
+        if (!ReadVarint(data, end, numDifferences) || numDifferences > numIndices)  return false; // No index uses more than one
+        const uint32_t planeSize = (numDifferences + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+        std::vector<unsigned char> planes(static_cast<size_t>(planeSize) * 4);
+        for (uint32_t b = 0; b < 4; ++b)
+        {
+            if (!DecodePlane(data, end, planes.data() + static_cast<size_t>(b) * planeSize, numDifferences))  return false;
+        }
+        if (data != end)  return false;
+
+        // With spare differences for the reads of a triangle using more than are left
+        std::vector<uint32_t> differences(numDifferences + 3, 0);
+        JoinDifferences(planes.data(), planeSize, numDifferences, differences.data());
+        const uint32_t* difference = differences.data();
+        const uint32_t* lastDifference = difference + numDifferences;
+
+        uint32_t edges[FIFO_SIZE][2] = {};
+        uint32_t vertices[FIFO_SIZE] = {};
+        uint32_t edgeHead = 0;
+        uint32_t vertexHead = 0;
+        uint32_t next = 0;
+        uint32_t last = 0;
+        uint32_t corners = 0; // All the corners or'ed together, to check they fit in T
+        uint32_t damaged = 0; // Non-zero after a rotation over 2
+        for (uint32_t t = 0; t < numTriangles; ++t)
+        {
+            const uint32_t code       = codes[t];
+            const uint32_t rotation   = rotations[t];
+            const uint32_t edgeCode   = code >> 4;
+            const uint32_t cornerCode = code & 0x0F;
+            damaged |= (rotation + 1) >> 2;
+
+            // 1 if the triangle's first edge or third corner is explicit (the code is 15)
+            const uint32_t explicitEdge   = (edgeCode + 1) >> 4;
+            const uint32_t explicitCorner = (cornerCode + 1) >> 4;
+
+            // The first edge, then the third corner
+            const uint32_t* edge = edges[(edgeHead - 1 - edgeCode) & (FIFO_SIZE - 1)];
+            const uint32_t c0 = Select(0u - explicitEdge, last + difference[0], edge[1]);
+            const uint32_t c1 = Select(0u - explicitEdge, c0 + difference[1], edge[0]);
+            difference += explicitEdge * 2;
+            const uint32_t nextAfterEdge = std::max(next, std::max(c0 + 1, c1 + 1));
+            vertices[vertexHead & (FIFO_SIZE - 1)] = nextAfterEdge;
+            const uint32_t listed = vertices[(vertexHead - cornerCode) & (FIFO_SIZE - 1)];
+            const uint32_t c2 = Select(0u - explicitCorner, c1 + difference[0], listed);
+            difference += explicitCorner;
+            if (difference > lastDifference)  return false;
+
+            // As IndexFIFOs::AddTriangle
+            edges[edgeHead & (FIFO_SIZE - 1)][0] = c0;
+            edges[edgeHead & (FIFO_SIZE - 1)][1] = c1;
+            edgeHead += explicitEdge;
+            vertices[vertexHead & (FIFO_SIZE - 1)] = c0;
+            vertexHead += explicitEdge;
+            vertices[vertexHead & (FIFO_SIZE - 1)] = c1;
+            vertexHead += explicitEdge;
+            edges[edgeHead & (FIFO_SIZE - 1)][0] = c1;
+            edges[edgeHead & (FIFO_SIZE - 1)][1] = c2;
+            edges[(edgeHead + 1) & (FIFO_SIZE - 1)][0] = c2;
+            edges[(edgeHead + 1) & (FIFO_SIZE - 1)][1] = c0;
+            edgeHead += 2;
+            vertices[vertexHead++ & (FIFO_SIZE - 1)] = c2;
+
+            next = std::max(nextAfterEdge, c2 + 1);
+            last = c2;
+            corners |= c0 | c1 | c2;
+
+            T* triangle = indices + static_cast<size_t>(t) * 3;
+            triangle[FIRST_CORNER[rotation & 3]] = static_cast<T>(c0);
+            triangle[NEXT_CORNER[rotation & 3]]  = static_cast<T>(c1);
+            triangle[PREV_CORNER[rotation & 3]]  = static_cast<T>(c2);
+        }
+
+        const uint32_t remaining = numIndices - numTriangles * 3;
+        if (damaged != 0 || static_cast<size_t>(lastDifference - difference) != remaining)  return false;
+        for (uint32_t i = numTriangles * 3; i < numIndices; ++i)
+        {
+            const uint32_t vertex = next + *difference++;
+            UseVertex(vertex, next);
+            corners |= vertex;
+            indices[i] = static_cast<T>(vertex);
+        }
+        return corners <= static_cast<T>(~0u);
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Vertices
+-----------------------------------------------------------------------------------------*/
+
+// Compress vertices laid out as the given elements, see comment at top of MeshCodec.h
+std::vector<unsigned char> EncodeVertices(const void* vertices, uint32_t numVertices, uint32_t vertexSize,
+                                          const VertexElement* elements, uint32_t numElements)
+{
+    std::vector<unsigned char> encoded;
+    const std::vector<VertexComponent> components = VertexComponents(vertexSize, elements, numElements);
+    std::vector<uint32_t>      previous(components.size(), 0);
+    std::vector<unsigned char> planes(static_cast<size_t>(vertexSize) * VERTEX_CODEC_BLOCK);
+
+    const unsigned char* source = static_cast<const unsigned char*>(vertices);
+    for (uint32_t first = 0; first < numVertices; first += VERTEX_CODEC_BLOCK)
+    {
+        const uint32_t count = std::min(VERTEX_CODEC_BLOCK, numVertices - first);
+        const unsigned char* block = source + static_cast<size_t>(first) * vertexSize;
+        for (size_t c = 0; c < components.size(); ++c)
+        {
+            const VertexComponent& component = components[c];
+            unsigned char* componentPlanes = &planes[static_cast<size_t>(component.offset) * VERTEX_CODEC_BLOCK];
+            if (component.size == 4)
+            {
+                ComponentDifferences(block + component.offset, count, vertexSize, previous[c], componentPlanes);
+            }
+            else if (component.size == 2)
+            {
+                uint16_t previous16 = static_cast<uint16_t>(previous[c]);
+                ComponentDifferences(block + component.offset, count, vertexSize, previous16, componentPlanes);
+                previous[c] = previous16;
+            }
+            else
+            {
+                uint8_t previous8 = static_cast<uint8_t>(previous[c]);
+                ComponentDifferences(block + component.offset, count, vertexSize, previous8, componentPlanes);
+                previous[c] = previous8;
+            }
+        }
+        for (uint32_t b = 0; b < vertexSize; ++b)  EncodePlane(&planes[static_cast<size_t>(b) * VERTEX_CODEC_BLOCK], count, encoded);
+    }
+    return encoded;
+}
+
+
+// Decompress vertices compressed by EncodeVertices. Returns false if the compressed data is damaged or isn't
+// for this number and layout of vertices
+bool DecodeVertices(const void* encoded, size_t encodedSize, void* vertices, uint32_t numVertices, uint32_t vertexSize,
+                    const VertexElement* elements, uint32_t numElements)
+{
+    const std::vector<VertexComponent> components = VertexComponents(vertexSize, elements, numElements);
+    std::vector<uint32_t>      previous(components.size(), 0);
+
+    // Planes for whole chunks when decoding with AddChunkDifferences
+    const uint32_t numPlanes = (vertexSize + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+    std::vector<unsigned char> planes(static_cast<size_t>(numPlanes) * VERTEX_CODEC_BLOCK, 0);
+
+#if defined(MATH_SIMD_SSE)
+    const std::vector<VertexChunk> chunks = VertexChunks(components, vertexSize);
+    std::vector<__m128i>       previousChunks(chunks.size(), _mm_setzero_si128());
+    std::vector<unsigned char> lastVertices(static_cast<size_t>(vertexSize) * 16 + GROUP_SIZE); // With room to run over
+#endif
+
+    const unsigned char* data = static_cast<const unsigned char*>(encoded);
+    const unsigned char* end  = data + encodedSize;
+    unsigned char* destination = static_cast<unsigned char*>(vertices);
+    for (uint32_t first = 0; first < numVertices; first += VERTEX_CODEC_BLOCK)
+    {
+        const uint32_t count = std::min(VERTEX_CODEC_BLOCK, numVertices - first);
+        for (uint32_t b = 0; b < vertexSize; ++b)
+        {
+            if (!DecodePlane(data, end, &planes[static_cast<size_t>(b) * VERTEX_CODEC_BLOCK], count))  return false;
+        }
+
+        unsigned char* block = destination + static_cast<size_t>(first) * vertexSize;
+#if defined(MATH_SIMD_SSE)
+        if (!chunks.empty())
+        {
+            for (uint32_t v = 0; v < count; v += 16)
+            {
+                // The 16 vertices with the last one are written to lastVertices first, as their chunks run over
+                const uint32_t numGroup = std::min(16u, count - v);
+                unsigned char* group = block + static_cast<size_t>(v) * vertexSize;
+                const bool last = (first + v + 16 >= numVertices);
+                AddChunkDifferences(&planes[v], numGroup, vertexSize, chunks, previousChunks.data(), last ? lastVertices.data() : group);
+                if (last)  std::memcpy(group, lastVertices.data(), static_cast<size_t>(numGroup) * vertexSize);
+            }
+            continue;
+        }
+#endif
+        for (size_t c = 0; c < components.size(); ++c)
+        {
+            const VertexComponent& component = components[c];
+            const unsigned char* componentPlanes = &planes[static_cast<size_t>(component.offset) * VERTEX_CODEC_BLOCK];
+            if (component.size == 4)
+            {
+                AddDifferences(componentPlanes, count, vertexSize, previous[c], block + component.offset);
+            }
+            else if (component.size == 2)
+            {
+                uint16_t previous16 = static_cast<uint16_t>(previous[c]);
+                AddDifferences(componentPlanes, count, vertexSize, previous16, block + component.offset);
+                previous[c] = previous16;
+            }
+            else
+            {
+                uint8_t previous8 = static_cast<uint8_t>(previous[c]);
+                AddDifferences(componentPlanes, count, vertexSize, previous8, block + component.offset);
+                previous[c] = previous8;
+            }
+        }
+    }
+    return data == end;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Indices
+-----------------------------------------------------------------------------------------*/
+
+// Compress indices of 2 or 4 bytes, see comment at top of MeshCodec.h
+std::vector<unsigned char> EncodeIndices(const void* indices, uint32_t numIndices, uint32_t indexSize)
+{
+    auto index = [&](uint32_t i) -> uint32_t
+    {
+        if (indexSize == 2)  return static_cast<const uint16_t*>(indices)[i];
+        return static_cast<const uint32_t*>(indices)[i];
+    };
+
+    const uint32_t numTriangles = numIndices / 3;
+    std::vector<unsigned char> rotations(numTriangles);
+    std::vector<unsigned char> codes(numTriangles);
+    std::vector<uint32_t>      values; // Zigzagged differences
+
+    IndexFIFOs fifos;
+    uint32_t next = 0;
+    uint32_t last = 0;
+    for (uint32_t t = 0; t < numTriangles; ++t)
+    {
+        const uint32_t corners[3] = { index(t * 3), index(t * 3 + 1), index(t * 3 + 2) };
+
+        // Find the most recent edge this triangle shares, in the other direction
+        uint32_t edgeCode = CODE_NONE;
+        uint32_t rotation = 0;
+        for (uint32_t entry = 0; entry < FIFO_ENTRIES && edgeCode == CODE_NONE; ++entry)
+        {
+            const uint32_t* edge = fifos.Edge(entry);
+            for (uint32_t r = 0; r < 3; ++r)
+            {
+                if (corners[r] == edge[1] && corners[(r + 1) % 3] == edge[0])
+                {
+                    edgeCode = entry;
+                    rotation = r;
+                    break;
+                }
+            }
+        }
+
+        // A triangle not sharing an edge stores its first edge, see comment above
+        if (edgeCode == CODE_NONE)
+        {
+            values.push_back(ZigZag(corners[0] - last));
+            values.push_back(ZigZag(corners[1] - corners[0]));
+        }
+
+        // The third corner, with the next unused vertex counting any first used by the first edge
+        uint32_t nextAfterEdge = next;
+        UseVertex(corners[rotation], nextAfterEdge);
+        UseVertex(corners[(rotation + 1) % 3], nextAfterEdge);
+        const uint32_t corner = corners[(rotation + 2) % 3];
+        uint32_t cornerCode = CODE_NONE;
+        if (corner == nextAfterEdge)
+        {
+            cornerCode = 0;
+        }
+        else
+        {
+            for (uint32_t entry = 0; entry < VERTEX_ENTRIES; ++entry)
+            {
+                if (fifos.Vertex(entry) == corner)
+                {
+                    cornerCode = 1 + entry;
+                    break;
+                }
+            }
+        }
+
+        rotations[t] = static_cast<unsigned char>(rotation);
+        codes[t]     = static_cast<unsigned char>((edgeCode << 4) | cornerCode);
+        if (cornerCode == CODE_NONE)  values.push_back(ZigZag(corner - corners[(rotation + 1) % 3]));
+
+        fifos.AddTriangle(corners, rotation, edgeCode != CODE_NONE);
+        for (uint32_t c = 0; c < 3; ++c)  UseVertex(corners[c], next);
+        last = corners[(rotation + 2) % 3];
+    }
+
+    for (uint32_t i = numTriangles * 3; i < numIndices; ++i)
+    {
+        values.push_back(ZigZag(index(i) - next));
+        UseVertex(index(i), next);
+    }
+
+    std::vector<unsigned char> encoded;
+    EncodePlane(rotations.data(), numTriangles, encoded);
+    encoded.insert(encoded.end(), codes.begin(), codes.end());
+    WriteVarint(encoded, static_cast<uint32_t>(values.size()));
+    std::vector<unsigned char> plane(values.size());
+    for (uint32_t b = 0; b < 4; ++b)
+    {
+        for (size_t i = 0; i < values.size(); ++i)  plane[i] = static_cast<unsigned char>(values[i] >> (b * 8));
+        EncodePlane(plane.data(), static_cast<uint32_t>(values.size()), encoded);
+    }
+    return encoded;
+}
+
+
+// Decompress indices compressed by EncodeIndices. Returns false if the compressed data is damaged or isn't for
+// this number and size of indices
+bool DecodeIndices(const void* encoded, size_t encodedSize, void* indices, uint32_t numIndices, uint32_t indexSize)
+{
+    if (indexSize == 2)  return DecodeTriangles(static_cast<const unsigned char*>(encoded), encodedSize, static_cast<uint16_t*>(indices), numIndices);
+    if (indexSize == 4)  return DecodeTriangles(static_cast<const unsigned char*>(encoded), encodedSize, static_cast<uint32_t*>(indices), numIndices);
+    return false;
+}
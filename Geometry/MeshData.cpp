@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// Mesh data held in CPU memory, ready to copy into GPU buffers
+//--------------------------------------------------------------------------------------
+
+#include "MeshData.h"
+
+#include <cstring>
+#include <cmath>
+
+
+/*-----------------------------------------------------------------------------------------
+    Vertex layout
+-----------------------------------------------------------------------------------------*/
+
+// Size in bytes of an element of the given format, 0 if the format is not known
+uint32_t VertexFormatSize(VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::Float3:     return 12;
+        case VertexFormat::UNorm16x4:  return 8;
+        case VertexFormat::Float2:     return 8;
+        case VertexFormat::Half2:      return 4;
+        case VertexFormat::SNorm16x2:  return 4;
+    }
+    return 0;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Mesh data
+-----------------------------------------------------------------------------------------*/
+
+// Add an element to the end of the vertex layout, returns its offset in the vertex
+uint32_t MeshData::AddElement(const char* semantic, VertexFormat format, uint32_t semanticIndex /*= 0*/)
+{
+    VertexElement element = {};
+    std::strncpy(element.semantic, semantic, sizeof(element.semantic) - 1);
+    element.semanticIndex = semanticIndex;
+    element.format        = format;
+    element.offset        = vertexSize;
+    elements.push_back(element);
+
+    vertexSize += VertexFormatSize(format);
+    return element.offset;
+}
+
+// View of this data, only valid until the data is changed
+MeshDataView MeshData::View() const
+{
+    MeshDataView view;
+    view.elements       = elements.data();
+    view.numElements    = static_cast<uint32_t>(elements.size());
+    view.subMeshes      = subMeshes.data();
+    view.numSubMeshes   = static_cast<uint32_t>(subMeshes.size());
+    view.lods           = lods.data();
+    view.numLODs        = static_cast<uint32_t>(lods.size());
+    view.meshlets       = meshlets.data();
+    view.numMeshlets    = static_cast<uint32_t>(meshlets.size());
+    view.vertices       = vertices.data();
+    view.numVertices    = numVertices;
+    view.vertexSize     = vertexSize;
+    view.indices        = indices.data();
+    view.numIndices     = static_cast<uint32_t>(indices.size());
+    view.indexSize      = sizeof(uint32_t);
+    view.boundingBox    = boundingBox;
+    view.boundingSphere = boundingSphere;
+    return view;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Helper functions
+-----------------------------------------------------------------------------------------*/
+
+// Find the vertex element with the given semantic name, nullptr if there isn't one
+const VertexElement* FindElement(const MeshDataView& mesh, const char* semantic, uint32_t semanticIndex /*= 0*/)
+{
+    for (uint32_t i = 0; i < mesh.numElements; ++i)
+    {
+        const VertexElement& element = mesh.elements[i];
+        if (element.semanticIndex == semanticIndex && std::strcmp(element.semantic, semantic) == 0)  return &element;
+    }
+    return nullptr;
+}
+
+
+// Calculate the bounding box and sphere of all the vertex positions (the "Position" element, which must be
+// Float3). The sphere is centred on the box and reaches the furthest vertex
+void CalculateBounds(MeshData& mesh)
+{
+    const VertexElement* positionElement = FindElement(mesh.View(), "Position");
+    if (positionElement == nullptr || positionElement->format != VertexFormat::Float3 || mesh.numVertices == 0)
+    {
+        mesh.boundingBox    = CAABB{ { 0, 0, 0 }, { 0, 0, 0 } };
+        mesh.boundingSphere = CSphere{ { 0, 0, 0 }, 0 };
+        return;
+    }
+
+    // Find the bounding box of all the positions
+    const unsigned char* position = mesh.vertices.data() + positionElement->offset;
+    CVector3 minPosition = *(const CVector3*)position;
+    CVector3 maxPosition = minPosition;
+    for (uint32_t i = 0; i < mesh.numVertices; ++i, position += mesh.vertexSize)
+    {
+        const CVector3& p = *(const CVector3*)position;
+        if (p.x < minPosition.x)  minPosition.x = p.x;
+        if (p.y < minPosition.y)  minPosition.y = p.y;
+        if (p.z < minPosition.z)  minPosition.z = p.z;
+        if (p.x > maxPosition.x)  maxPosition.x = p.x;
+        if (p.y > maxPosition.y)  maxPosition.y = p.y;
+        if (p.z > maxPosition.z)  maxPosition.z = p.z;
+    }
+    mesh.boundingBox = AABBFromMinMax(minPosition, maxPosition);
+
+    // Bounding sphere radius reaches the furthest vertex from the centre of the box
+    float maxDistanceSq = 0.0f;
+    position = mesh.vertices.data() + positionElement->offset;
+    for (uint32_t i = 0; i < mesh.numVertices; ++i, position += mesh.vertexSize)
+    {
+        CVector3 toVertex = *(const CVector3*)position - mesh.boundingBox.centre;
+        float distanceSq = Dot(toVertex, toVertex);
+        if (distanceSq > maxDistanceSq)  maxDistanceSq = distanceSq;
+    }
+    mesh.boundingSphere = CSphere{ mesh.boundingBox.centre, std::sqrt(maxDistanceSq) };
+}
@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------------------
+// Mesh data held in CPU memory, ready to copy into GPU buffers
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// MeshData is the final form of a mesh after importing and processing: one interleaved vertex buffer, one
+// index buffer, the layout of a vertex and the sub-mesh ranges, as used by the Mesh class. It doesn't use
+// any DirectX types so the geometry code can be built and tested on any platform. MeshDataView is the same
+// data seen through pointers, which may point into a MeshData or straight into a memory mapped cooked mesh
+// file (see CookedMesh.h), so the code creating GPU buffers doesn't care where the data came from.
+//
+// A mesh can also hold levels of detail (LODs), simplified versions drawn when the mesh is small on screen
+// (see MeshSimplifier.h). Each LOD is a range of the sub-mesh list with one sub-mesh for each part of the
+// mesh, using the vertices of the full detail part but its own range of the index buffer. LOD 0 is the full
+// detail mesh, the first sub-meshes. A mesh without LODs has an empty list and all its sub-meshes are parts.
+// LODs are added last, the processing that changes vertices (MeshProcessing.h, MeshOptimiser.h) expects a
+// mesh without them.
+//
+// Large meshes are also split into meshlets, clusters of triangles in the full detail mesh that can be culled
+// separately (see Meshlets.h). Each meshlet is a range of one full detail sub-mesh's indices.
+//
+// A packed mesh (VertexPacking.h) also has a depth stream for passes that only need positions (depth-only and
+// shadow passes): each different position once, in the packed position format, with its own index buffer.
+// The depth indices are in the same order as the main indices, so every sub-mesh and LOD covers the same
+// range of both, but they refer to the depth positions from the start of the stream (there is no base vertex).
+// Vertices that only differ in normal or UV share one depth position.
+
+#ifndef _MESH_DATA_H_INCLUDED_
+#define _MESH_DATA_H_INCLUDED_
+
+#include "BoundingVolumes.h"
+
+#include <vector>
+#include <cstdint>
+
+
+/*-----------------------------------------------------------------------------------------
+    Vertex layout
+-----------------------------------------------------------------------------------------*/
+
+// Format of a vertex element. The values are the matching DXGI_FORMAT so they can be passed straight to
+// DirectX (Mesh.cpp checks this at compile time). Meshes are imported with the float formats, the 16-bit
+// formats are used by the compact vertex profile (see VertexPacking.h)
+enum class VertexFormat : uint32_t
+{
+    Float3    = 6,  // DXGI_FORMAT_R32G32B32_FLOAT
+    UNorm16x4 = 11, // DXGI_FORMAT_R16G16B16A16_UNORM - quantised positions, read by the shader as 0 to 1
+    Float2    = 16, // DXGI_FORMAT_R32G32_FLOAT
+    Half2     = 34, // DXGI_FORMAT_R16G16_FLOAT
+    SNorm16x2 = 37, // DXGI_FORMAT_R16G16_SNORM - octahedral normals and tangents, read by the shader as -1 to 1
+};
+
+// Size in bytes of an element of the given format, 0 if the format is not known
+uint32_t VertexFormatSize(VertexFormat format);
+
+
+// One element of a vertex, equivalent to a D3D11_INPUT_ELEMENT_DESC in a single vertex buffer
+struct VertexElement
+{
+    char         semantic[24];  // Name used in the vertex shader input, e.g. "Position", nul terminated
+    uint32_t     semanticIndex;
+    VertexFormat format;
+    uint32_t     offset;        // Offset in bytes from the start of the vertex
+};
+
+
+// A part of the mesh, drawn from a range of the shared index buffer. Indices are relative to baseVertex
+struct SubMesh
+{
+    uint32_t startIndex;
+    uint32_t numIndices;
+    uint32_t baseVertex;
+    uint32_t numVertices;
+};
+
+
+// A level of detail, see comment at top of file
+struct MeshLOD
+{
+    uint32_t firstSubMesh;
+    uint32_t numSubMeshes;
+    float    error;         // Distance of the simplified surface from the full detail surface, in model space
+    uint32_t numTriangles;
+};
+
+
+// A cluster of triangles in a full detail sub-mesh with its bounds, see Meshlets.h
+struct Meshlet
+{
+    CVector3 centre;        // Bounding sphere of the meshlet's vertices
+    float    radius;
+    CVector3 coneAxis;      // Unit vector, the average direction the triangles face
+    float    coneCutoff;    // Sine of the largest angle between coneAxis and a triangle's normal, 1 if it can't be culled
+    uint32_t startIndex;    // Range of the index buffer, within the sub-mesh's range
+    uint32_t numIndices;
+    uint32_t subMesh;       // The sub-mesh the triangles belong to, which gives the base vertex
+    uint32_t numVertices;   // Number of different vertices the triangles use
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Mesh data
+-----------------------------------------------------------------------------------------*/
+
+// Non-owning view of a mesh's data, see comment at top of file
+struct MeshDataView
+{
+    const VertexElement* elements     = nullptr;
+    uint32_t             numElements  = 0;
+
+    const SubMesh*       subMeshes    = nullptr;
+    uint32_t             numSubMeshes = 0;
+
+    const MeshLOD*       lods         = nullptr;
+    uint32_t             numLODs      = 0;     // 0 if the mesh has no levels of detail
+
+    const Meshlet*       meshlets     = nullptr;
+    uint32_t             numMeshlets  = 0;     // 0 if the mesh isn't split into meshlets
+
+    const void*          vertices     = nullptr;
+    uint32_t             numVertices  = 0;
+    uint32_t             vertexSize   = 0;     // Size in bytes of a single vertex
+
+    const void*          indices      = nullptr;
+    uint32_t             numIndices   = 0;
+    uint32_t             indexSize    = 4;     // 2 or 4 bytes
+
+    const void*          depthVertices    = nullptr; // Depth stream, see comment at top of file
+    uint32_t             numDepthVertices = 0;       // 0 if the mesh has no depth stream
+    uint32_t             depthVertexSize  = 0;       // Size of the packed position
+    const void*          depthIndices     = nullptr; // numIndices of them
+    uint32_t             depthIndexSize   = 4;
+
+    CAABB                boundingBox;          // Model space bounding volumes of all the vertices
+    CSphere              boundingSphere;
+};
+
+
+// A mesh's data in CPU memory, see comment at top of file
+struct MeshData
+{
+    std::vector<VertexElement> elements;
+    std::vector<SubMesh>       subMeshes;
+    std::vector<MeshLOD>       lods;           // Empty if the mesh has no levels of detail
+    std::vector<Meshlet>       meshlets;       // Empty if the mesh isn't split into meshlets
+
+    std::vector<unsigned char> vertices;       // numVertices * vertexSize bytes, exact content depends on elements
+    uint32_t                   numVertices = 0;
+    uint32_t                   vertexSize  = 0;
+
+    std::vector<uint32_t>      indices;        // Three per triangle
+
+    CAABB                      boundingBox;
+    CSphere                    boundingSphere;
+
+    // Add an element to the end of the vertex layout, returns its offset in the vertex
+    uint32_t AddElement(const char* semantic, VertexFormat format, uint32_t semanticIndex = 0);
+
+    // View of this data, only valid until the data is changed
+    MeshDataView View() const;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Helper functions
+-----------------------------------------------------------------------------------------*/
+
+// Find the vertex element with the given semantic name, nullptr if there isn't one
+const VertexElement* FindElement(const MeshDataView& mesh, const char* semantic, uint32_t semanticIndex = 0);
+
+// Calculate the bounding box and sphere of all the vertex positions (the "Position" element, which must be
+// Float3). The sphere is centred on the box and reaches the furthest vertex, a tighter fit than the sphere
+// around the box corners
+void CalculateBounds(MeshData& mesh);
+
+
+#endif //_MESH_DATA_H_INCLUDED_
@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------
+// Mesh import - the steps from a mesh file to the data its GPU buffers are made from
+//--------------------------------------------------------------------------------------
+
+#include "MeshImport.h"
+#include "XFile.h"
+#include "MeshOptimiser.h"
+#include "MeshProcessing.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#if !defined(MESH_NO_ASSIMP)
+#include "AssimpImport.h"
+#endif
+
+#include <stdexcept>
+#include <algorithm>
+
+
+// Import the given mesh file, already mapped, for the GPU. Throws a std::runtime_error on failure
+PackedMesh ImportMesh(const std::string& fileName, const MappedFile& sourceFile, bool requireTangents, VertexProfile profile)
+{
+    // .x files are read by the native parser (XFile.h) from the file already mapped. Assimp is used for
+    // other file types or if the parser can't handle the file - it also reads the mapped file. Both give
+    // tangents the same way (MeshProcessing.h)
+    MeshData importedMesh;
+    std::string extension = fileName.size() > 2 ? fileName.substr(fileName.size() - 2) : "";
+    bool isXFile = (extension == ".x" || extension == ".X");
+    if (isXFile && LoadXFile(sourceFile.Data(), sourceFile.Size(), importedMesh))
+    {
+        if (requireTangents && !GenerateTangents(importedMesh))  throw std::runtime_error("No texture coordinates to calculate tangents in " + fileName);
+    }
+    else
+    {
+#if !defined(MESH_NO_ASSIMP)
+        importedMesh = ImportMeshAssimp(fileName, sourceFile.Data(), sourceFile.Size(), requireTangents);
+#else
+        throw std::runtime_error("Error loading mesh (" + fileName + "). Built without assimp");
+#endif
+    }
+
+    // Reorder triangles and vertices for the GPU's vertex cache, less overdraw and sequential vertex reads
+    // (see MeshOptimiser.h), split into meshlets (Meshlets.h), add levels of detail (MeshSimplifier.h),
+    // then convert to the final vertex formats and 16-bit indices if they fit
+    OptimiseMesh(importedMesh);
+    BuildMeshlets(importedMesh);
+    GenerateLODs(importedMesh);
+    return PackMesh(importedMesh.View(), profile);
+}
+
+
+// Bytes of GPU memory the Mesh class creates buffers of for the given mesh, not including constant buffers
+size_t MeshGPUBytes(const MeshDataView& mesh)
+{
+    size_t bytes = static_cast<size_t>(mesh.numVertices) * mesh.vertexSize + static_cast<size_t>(mesh.numIndices) * mesh.indexSize;
+    if (mesh.numDepthVertices > 0)
+    {
+        bytes += static_cast<size_t>(mesh.numDepthVertices) * mesh.depthVertexSize + static_cast<size_t>(mesh.numIndices) * mesh.depthIndexSize;
+    }
+
+    // The culled index buffer holds the full detail indices, as MeshletCuller::MaxIndices
+    if (mesh.numMeshlets > 0)
+    {
+        const uint32_t numParts = (mesh.numLODs > 0) ? mesh.lods[0].numSubMeshes : mesh.numSubMeshes;
+        uint32_t numIndices = 0;
+        for (uint32_t i = 0; i < numParts; ++i)
+        {
+            numIndices = std::max(numIndices, mesh.subMeshes[i].startIndex + mesh.subMeshes[i].numIndices);
+        }
+        bytes += static_cast<size_t>(numIndices) * mesh.indexSize;
+    }
+    return bytes;
+}
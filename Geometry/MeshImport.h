@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------
+// Mesh import - the steps from a mesh file to the data its GPU buffers are made from
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// The Mesh class imports a mesh file the first time it is loaded, then saves the result as a cooked mesh
+// (CookedMesh.h). ImportMesh is that import, kept apart from the Mesh class so tools without a GPU (e.g. the
+// asset audit in the Benchmark folder) see exactly the data the GPU would get:
+//  - .x files are read by the native parser (XFile.h), other files or .x files it can't handle by assimp
+//    (AssimpImport.h). Tangents are calculated if requested
+//  - Triangles and vertices are reordered for the GPU (MeshOptimiser.h), the mesh is split into meshlets
+//    (Meshlets.h) and levels of detail are added (MeshSimplifier.h)
+//  - The vertices are converted to the final formats for the vertex profile, and the indices to 16 bits if
+//    they fit (VertexPacking.h)
+//
+// Define MESH_NO_ASSIMP to build without assimp (e.g. on Linux without it installed), then only .x files the
+// native parser reads can be imported.
+
+#ifndef _MESH_IMPORT_H_INCLUDED_
+#define _MESH_IMPORT_H_INCLUDED_
+
+#include "VertexPacking.h"
+#include "MappedFile.h"
+
+#include <string>
+
+
+// Import the given mesh file, already mapped, for the GPU. The file name chooses the importer and is used
+// in error messages. Throws a std::runtime_error on failure
+PackedMesh ImportMesh(const std::string& fileName, const MappedFile& sourceFile, bool requireTangents, VertexProfile profile);
+
+// Bytes of GPU memory the Mesh class creates buffers of for the given mesh: vertices and indices, the depth
+// stream and the index buffer culled meshlets are written to (Meshlets.h). Doesn't include constant buffers
+size_t MeshGPUBytes(const MeshDataView& mesh);
+
+
+#endif //_MESH_IMPORT_H_INCLUDED_
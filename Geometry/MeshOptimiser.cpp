@@ -0,0 +1,593 @@
+//--------------------------------------------------------------------------------------
+// Reordering mesh triangles and vertices for faster rendering, and measuring the result
+//--------------------------------------------------------------------------------------
+
+#include "MeshOptimiser.h"
+#include "CVector3.h"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    /*-----------------------------------------------------------------------------------------
+        Vertex cache simulation
+    -----------------------------------------------------------------------------------------*/
+
+    // FIFO post-transform vertex cache as used by GPUs. Each vertex records the time it entered the cache, the
+    // time moves on at each miss, so a vertex is in the cache if it entered less than cacheSize misses ago
+    class FifoCache
+    {
+    public:
+        FifoCache(uint32_t numVertices, uint32_t cacheSize)
+            : mEntryTime(numVertices, 0), mCacheSize(cacheSize), mTime(cacheSize + 1) {}
+
+        // Returns true if the vertex was a miss and had to be transformed (it is then in the cache)
+        bool Use(uint32_t vertex)
+        {
+            if (mTime - mEntryTime[vertex] <= mCacheSize)  return false;
+            mEntryTime[vertex] = ++mTime;
+            return true;
+        }
+
+        // Empty the cache, as at the start of a draw call
+        void Reset()  { mTime += mCacheSize + 1; }
+
+    private:
+        std::vector<uint32_t> mEntryTime;
+        uint32_t              mCacheSize;
+        uint32_t              mTime;
+    };
+
+
+    // Number of vertex cache misses for each triangle of the given indices, starting with an empty cache
+    std::vector<uint32_t> TriangleCacheMisses(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices)
+    {
+        FifoCache cache(numVertices, VERTEX_CACHE_SIZE);
+        std::vector<uint32_t> misses(numIndices / 3);
+        for (uint32_t t = 0; t < numIndices / 3; ++t)
+        {
+            misses[t] = cache.Use(indices[t * 3]) + cache.Use(indices[t * 3 + 1]) + cache.Use(indices[t * 3 + 2]);
+        }
+        return misses;
+    }
+
+
+    // Memory reads through a direct mapped cache of 64 byte lines (16KB, smaller than a GPU's, for the same
+    // reason as VERTEX_CACHE_SIZE)
+    class FetchCache
+    {
+    public:
+        FetchCache() : mLines(NUM_LINES, std::numeric_limits<uint64_t>::max()) {}
+
+        // Returns the bytes read from memory for the given range of bytes, the lines read are then in the cache
+        uint32_t Fetch(uint64_t start, uint32_t size)
+        {
+            uint32_t bytesRead = 0;
+            for (uint64_t line = start / LINE_SIZE; line <= (start + size - 1) / LINE_SIZE; ++line)
+            {
+                uint64_t& cacheLine = mLines[line % NUM_LINES];
+                if (cacheLine != line)
+                {
+                    cacheLine = line;
+                    bytesRead += LINE_SIZE;
+                }
+            }
+            return bytesRead;
+        }
+
+    private:
+        static const uint32_t LINE_SIZE = 64;
+        static const uint32_t NUM_LINES = 256;
+
+        std::vector<uint64_t> mLines;
+    };
+
+
+    // Bytes read from memory for the vertices transformed by one sub-mesh's indices, starting with empty caches,
+    // once OptimiseVertexFetch has renumbered the vertices in the order they are first used. Lets the triangle
+    // reordering steps see what they will do to the overfetch measured by AnalyseMesh
+    uint64_t FetchedBytes(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices, uint32_t vertexSize)
+    {
+        const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> newIndex(numVertices, UNUSED);
+        uint32_t numUsed = 0;
+
+        FifoCache  cache(numVertices, VERTEX_CACHE_SIZE);
+        FetchCache fetchCache;
+        uint64_t bytesFetched = 0;
+        for (uint32_t i = 0; i < numIndices; ++i)
+        {
+            uint32_t vertex = indices[i];
+            if (newIndex[vertex] == UNUSED)  newIndex[vertex] = numUsed++;
+            if (cache.Use(vertex))  bytesFetched += fetchCache.Fetch(static_cast<uint64_t>(newIndex[vertex]) * vertexSize, vertexSize);
+        }
+        return bytesFetched;
+    }
+
+
+    // Model space position of a vertex
+    const CVector3& Position(const MeshData& mesh, uint32_t positionOffset, uint32_t vertex)
+    {
+        return *reinterpret_cast<const CVector3*>(mesh.vertices.data() + static_cast<size_t>(vertex) * mesh.vertexSize + positionOffset);
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Overdraw measurement
+    -----------------------------------------------------------------------------------------*/
+
+    // Size of the square image the overdraw is measured on
+    const int OVERDRAW_GRID_SIZE = 256;
+
+    // Draw every triangle of the mesh in order onto a depth buffer, looking along the given axis (0-2) in the
+    // given direction (1 or -1) with back faces culled. Adds up the pixels covered and the pixels that passed
+    // the depth test (i.e. were shaded)
+    void RasteriseView(const MeshData& mesh, uint32_t positionOffset, int axis, float direction,
+                       uint64_t& pixelsCovered, uint64_t& pixelsShaded)
+    {
+        const int uAxis = (axis + 1) % 3;
+        const int vAxis = (axis + 2) % 3;
+        const float boxMin[3]  = { mesh.boundingBox.Min().x, mesh.boundingBox.Min().y, mesh.boundingBox.Min().z };
+        const float boxSize[3] = { mesh.boundingBox.halfSize.x * 2, mesh.boundingBox.halfSize.y * 2, mesh.boundingBox.halfSize.z * 2 };
+        float extent = std::max(boxSize[uAxis], boxSize[vAxis]);
+        if (extent <= 0)  return;
+        const float scale = (OVERDRAW_GRID_SIZE - 1) / extent;
+
+        std::vector<float> depthBuffer(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE, std::numeric_limits<float>::infinity());
+        for (const SubMesh& subMesh : mesh.subMeshes)
+        {
+            const uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+            for (uint32_t i = 0; i + 2 < subMesh.numIndices; i += 3)
+            {
+                const CVector3* corners[3];
+                for (int c = 0; c < 3; ++c)  corners[c] = &Position(mesh, positionOffset, subMesh.baseVertex + indices[i + c]);
+
+                // Clockwise triangles face the viewer (DirectX convention), cull the others
+                CVector3 normal = Cross(*corners[1] - *corners[0], *corners[2] - *corners[0]);
+                const float normalAxis[3] = { normal.x, normal.y, normal.z };
+                if (normalAxis[axis] * direction >= 0)  continue;
+
+                // Corners in pixels and depth (smaller is nearer)
+                float x[3], y[3], z[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    const float p[3] = { corners[c]->x, corners[c]->y, corners[c]->z };
+                    x[c] = (p[uAxis] - boxMin[uAxis]) * scale;
+                    y[c] = (p[vAxis] - boxMin[vAxis]) * scale;
+                    z[c] = p[axis] * direction;
+                }
+                float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+                if (area == 0)  continue;
+
+                // Test the centre of each pixel in the triangle's bounding rectangle
+                int minX = std::max(static_cast<int>(std::min({ x[0], x[1], x[2] })), 0);
+                int minY = std::max(static_cast<int>(std::min({ y[0], y[1], y[2] })), 0);
+                int maxX = std::min(static_cast<int>(std::max({ x[0], x[1], x[2] })), OVERDRAW_GRID_SIZE - 1);
+                int maxY = std::min(static_cast<int>(std::max({ y[0], y[1], y[2] })), OVERDRAW_GRID_SIZE - 1);
+                for (int py = minY; py <= maxY; ++py)
+                {
+                    for (int px = minX; px <= maxX; ++px)
+                    {
+                        float cx = px + 0.5f, cy = py + 0.5f;
+                        float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) / area;
+                        float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) / area;
+                        float w2 = 1 - w0 - w1;
+                        if (w0 < 0 || w1 < 0 || w2 < 0)  continue;
+
+                        float depth = w0 * z[0] + w1 * z[1] + w2 * z[2];
+                        float& buffer = depthBuffer[py * OVERDRAW_GRID_SIZE + px];
+                        if (depth < buffer)
+                        {
+                            buffer = depth;
+                            ++pixelsShaded;
+                        }
+                    }
+                }
+            }
+        }
+
+        for (float depth : depthBuffer)
+        {
+            if (depth != std::numeric_limits<float>::infinity())  ++pixelsCovered;
+        }
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Vertex cache optimisation
+    -----------------------------------------------------------------------------------------*/
+
+    // Reorder the triangles of one sub-mesh (indices from 0 to numVertices - 1) for a FIFO vertex cache of the
+    // given size. This is Tipsify: triangles are drawn in fans, all the remaining triangles around one vertex at
+    // a time. The next fan is around a vertex of the last fan, the one that has been in the cache longest but
+    // will still be in it once its own triangles are drawn. When no such vertex has triangles left (a dead
+    // end), the most recently used vertex that has triangles left is used, or else the next in the mesh.
+    // Pass the vertex size to also keep the fetch cost within MAX_OVERFETCH_INCREASE of the original order's,
+    // or 0 if the vertices won't be renumbered afterwards
+    void OptimiseVertexCache(uint32_t* indices, uint32_t numIndices, uint32_t numVertices, uint32_t vertexSize, uint32_t cacheSize)
+    {
+        const uint32_t numTriangles = numIndices / 3;
+        if (numTriangles < 2)  return;
+
+        // List of the triangles using each vertex, all in one array
+        std::vector<uint32_t> trianglesLeft(numVertices, 0);
+        for (uint32_t i = 0; i < numTriangles * 3; ++i)  ++trianglesLeft[indices[i]];
+        std::vector<uint32_t> firstTriangle(numVertices + 1, 0);
+        for (uint32_t v = 0; v < numVertices; ++v)  firstTriangle[v + 1] = firstTriangle[v] + trianglesLeft[v];
+        std::vector<uint32_t> vertexTriangles(numTriangles * 3);
+        std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (uint32_t i = 0; i < numTriangles * 3; ++i)  vertexTriangles[fill[indices[i]]++] = i / 3;
+
+        // Cache simulated as in FifoCache
+        std::vector<uint32_t> entryTime(numVertices, 0);
+        uint32_t time = cacheSize + 1;
+
+        std::vector<bool>     drawn(numTriangles, false);
+        std::vector<uint32_t> recentVertices; // Vertices of drawn triangles, latest at the end, to recover from dead ends
+        std::vector<uint32_t> fanVertices;    // Vertices of the current fan's triangles, the candidates for the next fan
+        std::vector<uint32_t> newIndices;
+        newIndices.reserve(numTriangles * 3);
+        uint32_t nextVertex = 0;
+        int64_t  fanVertex = 0;
+        while (fanVertex >= 0)
+        {
+            // Draw the fan
+            fanVertices.clear();
+            for (uint32_t i = firstTriangle[fanVertex]; i < firstTriangle[fanVertex + 1]; ++i)
+            {
+                uint32_t t = vertexTriangles[i];
+                if (drawn[t])  continue;
+                drawn[t] = true;
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint32_t v = indices[t * 3 + c];
+                    newIndices.push_back(v);
+                    recentVertices.push_back(v);
+                    fanVertices.push_back(v);
+                    --trianglesLeft[v];
+                    if (time - entryTime[v] > cacheSize)  entryTime[v] = time++;
+                }
+            }
+
+            // Choose the next fan. Drawing a vertex's triangles adds at most 2 vertices to the cache per triangle
+            fanVertex = -1;
+            int64_t bestAge = -1;
+            for (uint32_t v : fanVertices)
+            {
+                if (trianglesLeft[v] == 0)  continue;
+                int64_t age = time - entryTime[v];
+                if (age + 2 * trianglesLeft[v] > cacheSize)  age = 0;
+                if (age > bestAge)
+                {
+                    bestAge = age;
+                    fanVertex = v;
+                }
+            }
+
+            // Dead end
+            while (fanVertex < 0 && !recentVertices.empty())
+            {
+                uint32_t v = recentVertices.back();
+                recentVertices.pop_back();
+                if (trianglesLeft[v] > 0)  fanVertex = v;
+            }
+            while (fanVertex < 0 && nextVertex < numVertices)
+            {
+                if (trianglesLeft[nextVertex] > 0)  fanVertex = nextVertex;
+                ++nextVertex;
+            }
+        }
+
+        // Meshes are often well ordered already (e.g. by a modelling package), keep the original order if it is
+        // better. A regular grid in rows, say, misses the vertex cache more but reads each vertex from memory once
+        std::vector<uint32_t> oldMisses = TriangleCacheMisses(indices, numIndices, numVertices);
+        std::vector<uint32_t> newMisses = TriangleCacheMisses(newIndices.data(), numIndices, numVertices);
+        if (std::accumulate(newMisses.begin(), newMisses.end(), 0u) < std::accumulate(oldMisses.begin(), oldMisses.end(), 0u) &&
+            (vertexSize == 0 || FetchedBytes(newIndices.data(), numIndices, numVertices, vertexSize) <=
+                                FetchedBytes(indices, numIndices, numVertices, vertexSize) * MAX_OVERFETCH_INCREASE))
+        {
+            std::memcpy(indices, newIndices.data(), newIndices.size() * sizeof(uint32_t));
+        }
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Overdraw optimisation
+    -----------------------------------------------------------------------------------------*/
+
+    // Cut a sub-mesh's triangle list (after vertex cache optimisation) into clusters that can be drawn in any
+    // order. Hard boundaries are triangles where the vertex cache starts over (all three vertices miss), cutting
+    // there costs nothing. Within each hard cluster the list is also cut where the triangles since the last cut
+    // have a cache miss ratio no worse than the whole hard cluster's times splitRatio (1 or more). The cache is
+    // emptied at each cut, as drawing the clusters in a new order will. Returns the first triangle of each
+    // cluster followed by the number of triangles
+    std::vector<uint32_t> FindClusters(const uint32_t* indices, uint32_t numTriangles, uint32_t numVertices,
+                                       const std::vector<uint32_t>& misses, float splitRatio)
+    {
+        std::vector<uint32_t> hardClusters;
+        for (uint32_t t = 0; t < numTriangles; ++t)
+        {
+            if (t == 0 || misses[t] == 3)  hardClusters.push_back(t);
+        }
+        hardClusters.push_back(numTriangles);
+        if (splitRatio <= 0)  return hardClusters;
+
+        std::vector<uint32_t> clusters;
+        FifoCache cache(numVertices, VERTEX_CACHE_SIZE);
+        for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+        {
+            uint32_t start = hardClusters[c], end = hardClusters[c + 1];
+            uint32_t clusterMisses = 0;
+            for (uint32_t t = start; t < end; ++t)  clusterMisses += misses[t];
+            float maxACMR = clusterMisses / static_cast<float>(end - start) * splitRatio;
+
+            clusters.push_back(start);
+            cache.Reset();
+            uint32_t clusterStart = start, runMisses = 0;
+            for (uint32_t t = start; t < end; ++t)
+            {
+                runMisses += cache.Use(indices[t * 3]) + cache.Use(indices[t * 3 + 1]) + cache.Use(indices[t * 3 + 2]);
+                if (t + 1 < end && runMisses <= maxACMR * (t + 1 - clusterStart))
+                {
+                    clusters.push_back(t + 1);
+                    cache.Reset();
+                    clusterStart = t + 1;
+                    runMisses = 0;
+                }
+            }
+        }
+        clusters.push_back(numTriangles);
+        return clusters;
+    }
+
+
+    // Return the indices of a sub-mesh with its clusters (from FindClusters) sorted so that clusters facing
+    // away from the centre of the sub-mesh come first. They are on the outside and likely to hide the others
+    std::vector<uint32_t> SortClusters(const MeshData& mesh, uint32_t positionOffset, const SubMesh& subMesh,
+                                       const std::vector<uint32_t>& clusters)
+    {
+        const uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+        const size_t numClusters = clusters.size() - 1;
+
+        // Area weighted centre and average normal of each cluster and the centre of the whole sub-mesh
+        std::vector<CVector3> clusterCentre(numClusters, { 0, 0, 0 }), clusterNormal(numClusters, { 0, 0, 0 });
+        std::vector<float>    clusterArea(numClusters, 0);
+        CVector3 meshCentre = { 0, 0, 0 };
+        float    meshArea = 0;
+        for (size_t c = 0; c < numClusters; ++c)
+        {
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                const CVector3& p0 = Position(mesh, positionOffset, subMesh.baseVertex + indices[t * 3]);
+                const CVector3& p1 = Position(mesh, positionOffset, subMesh.baseVertex + indices[t * 3 + 1]);
+                const CVector3& p2 = Position(mesh, positionOffset, subMesh.baseVertex + indices[t * 3 + 2]);
+                CVector3 normal = Cross(p1 - p0, p2 - p0);
+                float area = Length(normal);
+                clusterCentre[c] += (p0 + p1 + p2) * (area / 3);
+                clusterNormal[c] += normal;
+                clusterArea[c]   += area;
+            }
+            meshCentre += clusterCentre[c];
+            meshArea   += clusterArea[c];
+        }
+        if (meshArea > 0)  meshCentre *= 1 / meshArea;
+
+        std::vector<float> sortKey(numClusters, 0);
+        for (size_t c = 0; c < numClusters; ++c)
+        {
+            float normalLength = Length(clusterNormal[c]);
+            if (clusterArea[c] > 0 && normalLength > 0)
+            {
+                sortKey[c] = Dot(clusterCentre[c] * (1 / clusterArea[c]) - meshCentre, clusterNormal[c] * (1 / normalLength));
+            }
+        }
+        std::vector<uint32_t> order(numClusters);
+        for (uint32_t c = 0; c < numClusters; ++c)  order[c] = c;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<uint32_t> newIndices;
+        newIndices.reserve(subMesh.numIndices);
+        for (uint32_t c : order)  newIndices.insert(newIndices.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        return newIndices;
+    }
+
+
+    // Reorder clusters of triangles of one sub-mesh to reduce overdraw, see comment at top of header file
+    void OptimiseOverdraw(MeshData& mesh, uint32_t positionOffset, const SubMesh& subMesh,
+                          float maxACMRIncrease, float maxOverfetchIncrease)
+    {
+        uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+        const uint32_t numTriangles = subMesh.numIndices / 3;
+        if (numTriangles < 2)  return;
+
+        std::vector<uint32_t> misses = TriangleCacheMisses(indices, numTriangles * 3, subMesh.numVertices);
+        uint32_t oldMisses = std::accumulate(misses.begin(), misses.end(), 0u);
+        uint64_t oldFetched = FetchedBytes(indices, numTriangles * 3, subMesh.numVertices, mesh.vertexSize);
+
+        // The last cluster cut from each hard cluster can do worse than the rest, and clusters drawn far from their
+        // neighbours read the vertices they share from memory again, so the whole list may miss the limits. If so,
+        // try again with fewer cuts, down to the hard boundaries only (0)
+        const float splitRatios[] = { maxACMRIncrease, 1 + (maxACMRIncrease - 1) / 2, 1, 0 };
+        for (float splitRatio : splitRatios)
+        {
+            std::vector<uint32_t> clusters = FindClusters(indices, numTriangles, subMesh.numVertices, misses, splitRatio);
+            if (clusters.size() < 3)  return;
+
+            std::vector<uint32_t> newIndices = SortClusters(mesh, positionOffset, subMesh, clusters);
+            std::vector<uint32_t> newMisses = TriangleCacheMisses(newIndices.data(), numTriangles * 3, subMesh.numVertices);
+            if (std::accumulate(newMisses.begin(), newMisses.end(), 0u) <= oldMisses * maxACMRIncrease &&
+                FetchedBytes(newIndices.data(), numTriangles * 3, subMesh.numVertices, mesh.vertexSize) <= oldFetched * maxOverfetchIncrease)
+            {
+                std::memcpy(indices, newIndices.data(), newIndices.size() * sizeof(uint32_t));
+                return;
+            }
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Measuring
+-----------------------------------------------------------------------------------------*/
+
+// Measure the efficiency of the given mesh. Each sub-mesh is a separate draw call and starts with an empty
+// vertex cache
+MeshEfficiency AnalyseMesh(const MeshData& mesh)
+{
+    MeshEfficiency efficiency;
+    if (mesh.indices.empty())  return efficiency;
+
+    // Vertex cache, and the memory reads each transformed vertex needs
+    uint64_t transformed = 0, bytesFetched = 0, numUsedVertices = 0;
+    std::vector<bool> used(mesh.numVertices, false);
+    FifoCache  cache(mesh.numVertices, VERTEX_CACHE_SIZE);
+    FetchCache fetchCache;
+    for (const SubMesh& subMesh : mesh.subMeshes)
+    {
+        cache.Reset();
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; ++i)
+        {
+            uint32_t vertex = subMesh.baseVertex + mesh.indices[i];
+            if (!used[vertex])
+            {
+                used[vertex] = true;
+                ++numUsedVertices;
+            }
+            if (!cache.Use(vertex))  continue;
+
+            ++transformed;
+            bytesFetched += fetchCache.Fetch(static_cast<uint64_t>(vertex) * mesh.vertexSize, mesh.vertexSize);
+        }
+    }
+    efficiency.acmr      = transformed / (mesh.indices.size() / 3.0f);
+    efficiency.atvr      = transformed / static_cast<float>(numUsedVertices);
+    efficiency.overfetch = bytesFetched / static_cast<float>(numUsedVertices * mesh.vertexSize);
+
+    // Overdraw, looking along each axis from both sides
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    if (position != nullptr && position->format == VertexFormat::Float3)
+    {
+        uint64_t pixelsCovered = 0, pixelsShaded = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            RasteriseView(mesh, position->offset, axis,  1, pixelsCovered, pixelsShaded);
+            RasteriseView(mesh, position->offset, axis, -1, pixelsCovered, pixelsShaded);
+        }
+        efficiency.overdraw = (pixelsCovered > 0) ? pixelsShaded / static_cast<float>(pixelsCovered) : 0;
+    }
+    return efficiency;
+}
+
+
+// ACMR of a range of sub-meshes of a mesh with indices of either size
+float MeasureACMR(const MeshDataView& mesh, uint32_t firstSubMesh, uint32_t numSubMeshes)
+{
+    const uint16_t* indices16 = static_cast<const uint16_t*>(mesh.indices);
+    const uint32_t* indices32 = static_cast<const uint32_t*>(mesh.indices);
+
+    uint64_t transformed = 0, numIndices = 0;
+    FifoCache cache(mesh.numVertices, VERTEX_CACHE_SIZE);
+    for (uint32_t s = firstSubMesh; s < firstSubMesh + numSubMeshes; ++s)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[s];
+        cache.Reset();
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; ++i)
+        {
+            uint32_t index = (mesh.indexSize == 2) ? indices16[i] : indices32[i];
+            transformed += cache.Use(subMesh.baseVertex + index);
+        }
+        numIndices += subMesh.numIndices;
+    }
+    return (numIndices > 0) ? transformed / (numIndices / 3.0f) : 0.0f;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Optimising
+-----------------------------------------------------------------------------------------*/
+
+// Reorder the triangles of each sub-mesh to reuse transformed vertices as much as possible
+void OptimiseVertexCache(MeshData& mesh)
+{
+    for (const SubMesh& subMesh : mesh.subMeshes)
+    {
+        OptimiseVertexCache(mesh.indices.data() + subMesh.startIndex, subMesh.numIndices, subMesh.numVertices, mesh.vertexSize, VERTEX_CACHE_SIZE);
+    }
+}
+
+// Reorder the triangles of a single range of indices in the same way
+void OptimiseVertexCache(uint32_t* indices, uint32_t numIndices, uint32_t numVertices)
+{
+    OptimiseVertexCache(indices, numIndices, numVertices, 0, VERTEX_CACHE_SIZE);
+}
+
+// Reorder clusters of triangles in each sub-mesh to reduce overdraw. Call after OptimiseVertexCache, the
+// cache misses and the bytes read from memory will increase by at most the given ratios
+void OptimiseOverdraw(MeshData& mesh, float maxACMRIncrease /*= 1.05f*/, float maxOverfetchIncrease /*= MAX_OVERFETCH_INCREASE*/)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    if (position == nullptr || position->format != VertexFormat::Float3)  return;
+
+    for (const SubMesh& subMesh : mesh.subMeshes)
+    {
+        OptimiseOverdraw(mesh, position->offset, subMesh, maxACMRIncrease, maxOverfetchIncrease);
+    }
+}
+
+// Renumber the vertices of each sub-mesh in the order they are first used and remove unused vertices.
+// Changes the sub-mesh vertex ranges. Call last, after the triangle order is final
+void OptimiseVertexFetch(MeshData& mesh)
+{
+    const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+
+    std::vector<unsigned char> newVertices;
+    newVertices.reserve(mesh.vertices.size());
+    uint32_t numNewVertices = 0;
+    std::vector<uint32_t> newIndex;
+    for (SubMesh& subMesh : mesh.subMeshes)
+    {
+        newIndex.assign(subMesh.numVertices, UNUSED);
+        uint32_t numUsed = 0;
+        for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; ++i)
+        {
+            uint32_t& index = mesh.indices[i];
+            if (newIndex[index] == UNUSED)
+            {
+                newIndex[index] = numUsed++;
+                const unsigned char* vertex = mesh.vertices.data() + static_cast<size_t>(subMesh.baseVertex + index) * mesh.vertexSize;
+                newVertices.insert(newVertices.end(), vertex, vertex + mesh.vertexSize);
+            }
+            index = newIndex[index];
+        }
+        subMesh.baseVertex  = numNewVertices;
+        subMesh.numVertices = numUsed;
+        numNewVertices += numUsed;
+    }
+
+    bool verticesRemoved = (numNewVertices != mesh.numVertices);
+    mesh.vertices.swap(newVertices);
+    mesh.numVertices = numNewVertices;
+    if (verticesRemoved && FindElement(mesh.View(), "Position") != nullptr)  CalculateBounds(mesh);
+}
+
+
+// Run all three steps above. Optionally measure the mesh before and after each step (which takes longer
+// than the optimisation)
+void OptimiseMesh(MeshData& mesh, MeshOptimisationReport* report /*= nullptr*/)
+{
+    if (report != nullptr)  report->original = AnalyseMesh(mesh);
+
+    OptimiseVertexCache(mesh);
+    if (report != nullptr)  report->vertexCache = AnalyseMesh(mesh);
+
+    OptimiseOverdraw(mesh);
+    if (report != nullptr)  report->overdraw = AnalyseMesh(mesh);
+
+    OptimiseVertexFetch(mesh);
+    if (report != nullptr)  report->vertexFetch = AnalyseMesh(mesh);
+}
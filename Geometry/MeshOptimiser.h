@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------
+// Reordering mesh triangles and vertices for faster rendering, and measuring the result
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// The order of a mesh's triangles and vertices doesn't change what is drawn but does change how fast it is
+// drawn. OptimiseMesh runs three steps on each sub-mesh, in this order (each step keeps the gains of the
+// previous one):
+//
+//  1. Vertex cache - the GPU keeps recently transformed vertices in a small cache, so a vertex used by
+//     several triangles in a row is only run through the vertex shader once. Triangles are reordered so they
+//     reuse vertices as soon as possible ("Tipsify", from Sander, Nehab and Barczak, "Fast Triangle Reordering
+//     for Vertex Locality and Reduced Overdraw"). A sub-mesh keeps its order if that is already better, or if
+//     the new order would read more than MAX_OVERFETCH_INCREASE times the bytes from memory (after step 3).
+//  2. Overdraw - the triangle list from step 1 is cut into clusters where the cache starts over anyway (and
+//     where a cut costs little), then the clusters facing outwards from the middle of the mesh are drawn
+//     first so they hide the rest (from the same paper). Pixels behind them fail the depth test and their
+//     pixel shader doesn't run. The new order is only used if it keeps the vertex cache misses and the
+//     bytes read from memory close to step 1's, otherwise the gains of steps 1 and 3 could be lost.
+//  3. Vertex fetch - vertices are renumbered in the order the triangles first use them, so the vertex
+//     buffer is read from start to end rather than jumping about. Unused vertices are removed.
+//
+// AnalyseMesh measures the effect of each step:
+//  - ACMR (average cache miss ratio) - vertices transformed per triangle, with the FIFO cache GPUs use. 3 is
+//    the worst possible, about 0.5 the best for a large regular grid
+//  - ATVR (average transformed vertex ratio) - vertices transformed per vertex in the mesh, 1 is perfect
+//  - Overdraw - pixels shaded per pixel covered, from a small software rasteriser viewing the mesh along each
+//    axis from both sides. 1 is perfect
+//  - Overfetch - bytes read from the vertex buffer per byte in it, through a simple memory cache. 1 is perfect
+//
+// The mesh must be a triangle list with a Float3 "Position" element, as imported (MeshData.h).
+
+#ifndef _MESH_OPTIMISER_H_INCLUDED_
+#define _MESH_OPTIMISER_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <cstdint>
+
+
+/*-----------------------------------------------------------------------------------------
+    Measuring
+-----------------------------------------------------------------------------------------*/
+
+// Number of vertices in the post-transform cache assumed by AnalyseMesh and targeted by OptimiseVertexCache.
+// Real GPUs vary, 16 is typical of the smaller ones and an order that suits 16 also suits larger caches
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+// How efficiently a mesh will render, see comment at top of file
+struct MeshEfficiency
+{
+    float acmr      = 0;
+    float atvr      = 0;
+    float overdraw  = 0;
+    float overfetch = 0;
+};
+
+// Measure the efficiency of the given mesh. Each sub-mesh is a separate draw call and starts with an empty
+// vertex cache
+MeshEfficiency AnalyseMesh(const MeshData& mesh);
+
+// ACMR of the given range of sub-meshes of a mesh with indices of either size (e.g. a packed mesh, VertexPacking.h,
+// or one level of detail), each sub-mesh starting with an empty vertex cache as in AnalyseMesh
+float MeasureACMR(const MeshDataView& mesh, uint32_t firstSubMesh, uint32_t numSubMeshes);
+
+
+/*-----------------------------------------------------------------------------------------
+    Optimising
+-----------------------------------------------------------------------------------------*/
+
+// Most that the triangle reordering steps may increase the bytes read from the vertex buffer (the overfetch
+// after OptimiseVertexFetch) in return for fewer cache misses or less overdraw
+const float MAX_OVERFETCH_INCREASE = 1.02f;
+
+// The efficiency of a mesh before optimising and after each step
+struct MeshOptimisationReport
+{
+    MeshEfficiency original;
+    MeshEfficiency vertexCache;
+    MeshEfficiency overdraw;
+    MeshEfficiency vertexFetch;
+};
+
+
+// Reorder the triangles of each sub-mesh to reuse transformed vertices as much as possible
+void OptimiseVertexCache(MeshData& mesh);
+
+// Reorder the triangles of a single range of indices (relative to a base vertex, from 0 to numVertices - 1)
+// in the same way, for indices added to a mesh after it was optimised (e.g. levels of detail)
+void OptimiseVertexCache(uint32_t* indices, uint32_t numIndices, uint32_t numVertices);
+
+// Reorder clusters of triangles in each sub-mesh to reduce overdraw. Call after OptimiseVertexCache, the
+// cache misses and the bytes read from memory (once OptimiseVertexFetch has run) will increase by at most
+// the given ratios
+void OptimiseOverdraw(MeshData& mesh, float maxACMRIncrease = 1.05f, float maxOverfetchIncrease = MAX_OVERFETCH_INCREASE);
+
+// Renumber the vertices of each sub-mesh in the order they are first used and remove unused vertices.
+// Changes the sub-mesh vertex ranges. Call last, after the triangle order is final
+void OptimiseVertexFetch(MeshData& mesh);
+
+
+// Run all three steps above. Optionally measure the mesh before and after each step (which takes longer
+// than the optimisation)
+void OptimiseMesh(MeshData& mesh, MeshOptimisationReport* report = nullptr);
+
+
+#endif //_MESH_OPTIMISER_H_INCLUDED_
@@ -0,0 +1,570 @@
+//--------------------------------------------------------------------------------------
+// Mesh processing after import - welding vertices, smooth normals and tangents
+//--------------------------------------------------------------------------------------
+
+#include "MeshProcessing.h"
+#include "ParallelFor.h"
+#include "Hash.h"
+#include "CVector2.h"
+#include "CVector3.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    const float DEGREES_TO_RADIANS = 0.0174532925f;
+
+    /*-----------------------------------------------------------------------------------------
+        Helpers
+    -----------------------------------------------------------------------------------------*/
+
+    // Unit vector in the direction of v, or zero if v is zero. Normalise treats very short vectors as zero,
+    // which would lose the normals of very small triangles
+    CVector3 UnitOrZero(const CVector3& v)
+    {
+        float length = Length(v);
+        return (length > 0) ? v * (1 / length) : CVector3{ 0, 0, 0 };
+    }
+
+    // A unit vector at right angles to the given unit vector
+    CVector3 AnyPerpendicular(const CVector3& n)
+    {
+        CVector3 axis = (std::abs(n.x) < 0.9f) ? CVector3{ 1, 0, 0 } : CVector3{ 0, 1, 0 };
+        CVector3 perpendicular = UnitOrZero(axis - n * Dot(n, axis));
+        return (perpendicular.x == 0 && perpendicular.y == 0 && perpendicular.z == 0) ? axis : perpendicular;
+    }
+
+    // Element of a vertex in a block of vertices
+    template <typename T>
+    T& ElementAt(unsigned char* vertices, uint32_t vertexSize, uint32_t offset, uint32_t vertex)
+    {
+        return *reinterpret_cast<T*>(vertices + static_cast<size_t>(vertex) * vertexSize + offset);
+    }
+
+    template <typename T>
+    const T& ElementAt(const unsigned char* vertices, uint32_t vertexSize, uint32_t offset, uint32_t vertex)
+    {
+        return *reinterpret_cast<const T*>(vertices + static_cast<size_t>(vertex) * vertexSize + offset);
+    }
+
+
+    // Insert a zeroed element into the vertex layout at the given position in the list of elements, moving the
+    // later elements along. Returns the offset of the new element
+    uint32_t InsertElement(MeshData& mesh, size_t index, const char* semantic, VertexFormat format, unsigned int numThreads)
+    {
+        MeshData newLayout;
+        uint32_t newOffset = 0;
+        for (size_t i = 0; i <= mesh.elements.size(); ++i)
+        {
+            if (i == index)  newOffset = newLayout.AddElement(semantic, format);
+            if (i < mesh.elements.size())  newLayout.AddElement(mesh.elements[i].semantic, mesh.elements[i].format, mesh.elements[i].semanticIndex);
+        }
+
+        const uint32_t oldSize = mesh.vertexSize, newSize = newLayout.vertexSize;
+        std::vector<unsigned char> newVertices(static_cast<size_t>(mesh.numVertices) * newSize, 0);
+        ParallelFor(mesh.numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; ++v)
+            {
+                for (size_t i = 0; i < mesh.elements.size(); ++i)
+                {
+                    std::memcpy(&newVertices[static_cast<size_t>(v) * newSize + newLayout.elements[i < index ? i : i + 1].offset],
+                                &mesh.vertices[static_cast<size_t>(v) * oldSize + mesh.elements[i].offset], VertexFormatSize(mesh.elements[i].format));
+                }
+            }
+        });
+
+        mesh.elements.swap(newLayout.elements);
+        mesh.vertexSize = newSize;
+        mesh.vertices.swap(newVertices);
+        return newOffset;
+    }
+
+
+    // Lists of the triangle corners with each key (e.g. using each vertex), in corner order, all in one array:
+    // the corners with key k are corners[first[k]] to corners[first[k + 1] - 1]
+    struct CornerLists
+    {
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> corners;
+
+        CornerLists(const uint32_t* keys, uint32_t numCorners, uint32_t numKeys)
+            : first(numKeys + 1, 0), corners(numCorners)
+        {
+            for (uint32_t c = 0; c < numCorners; ++c)  ++first[keys[c] + 1];
+            for (uint32_t k = 0; k < numKeys; ++k)     first[k + 1] += first[k];
+            std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+            for (uint32_t c = 0; c < numCorners; ++c)  corners[fill[keys[c]]++] = c;
+        }
+    };
+
+
+    /*-----------------------------------------------------------------------------------------
+        Spatial hash
+    -----------------------------------------------------------------------------------------*/
+
+    // Spatial hash of the positions of a block of vertices. Vertices are put in grid cells and cells in a hash
+    // table, stored as one array of vertices sorted by table slot (and by vertex within each slot). Different
+    // cells can share a slot, so users must compare the actual positions
+    class PositionHash
+    {
+    public:
+        // The cells are at least minCellSize across (which may be 0), and larger if needed to average about
+        // one vertex per cell
+        PositionHash(const unsigned char* vertices, uint32_t vertexSize, uint32_t positionOffset, uint32_t numVertices,
+                     float minCellSize, unsigned int numThreads)
+        {
+            CVector3 minPosition = { 0, 0, 0 }, maxPosition = { 0, 0, 0 };
+            for (uint32_t v = 0; v < numVertices; ++v)
+            {
+                const CVector3& p = ElementAt<CVector3>(vertices, vertexSize, positionOffset, v);
+                if (v == 0 || p.x < minPosition.x)  minPosition.x = p.x;
+                if (v == 0 || p.y < minPosition.y)  minPosition.y = p.y;
+                if (v == 0 || p.z < minPosition.z)  minPosition.z = p.z;
+                if (v == 0 || p.x > maxPosition.x)  maxPosition.x = p.x;
+                if (v == 0 || p.y > maxPosition.y)  maxPosition.y = p.y;
+                if (v == 0 || p.z > maxPosition.z)  maxPosition.z = p.z;
+            }
+            CVector3 size = maxPosition - minPosition;
+            double cellSize = std::max({ size.x, size.y, size.z }) / std::cbrt(std::max(numVertices, 1u));
+            cellSize = std::max(cellSize, static_cast<double>(minCellSize));
+            mInverseCellSize = (cellSize > 0 && std::isfinite(cellSize)) ? 1 / cellSize : 1;
+
+            uint32_t tableSize = 1;
+            while (tableSize < numVertices)  tableSize *= 2;
+            mSlotMask = tableSize - 1;
+
+            std::vector<uint32_t> slots(numVertices);
+            ParallelFor(numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t v = begin; v < end; ++v)  slots[v] = Slot(Cell(ElementAt<CVector3>(vertices, vertexSize, positionOffset, v)));
+            });
+            CornerLists table(slots.data(), numVertices, tableSize);
+            mFirst.swap(table.first);
+            mVertices.swap(table.corners);
+        }
+
+        // Call fn(vertex) for every vertex in the cell containing the given position, and in the 26 cells
+        // around it if searchNeighbours is true. Vertices are passed in order within each cell
+        template <typename Fn>
+        void ForEachNearby(const CVector3& position, bool searchNeighbours, Fn fn) const
+        {
+            Cell3 cell = Cell(position);
+            int range = searchNeighbours ? 1 : 0;
+            for (int z = -range; z <= range; ++z)
+            {
+                for (int y = -range; y <= range; ++y)
+                {
+                    for (int x = -range; x <= range; ++x)
+                    {
+                        uint32_t slot = Slot({ cell.x + x, cell.y + y, cell.z + z });
+                        for (uint32_t i = mFirst[slot]; i < mFirst[slot + 1]; ++i)  fn(mVertices[i]);
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Cell3 { int64_t x, y, z; };
+
+        Cell3 Cell(const CVector3& p) const
+        {
+            auto cell = [&](float value)
+            {
+                double scaled = value * mInverseCellSize;
+                return std::isfinite(scaled) ? static_cast<int64_t>(std::floor(std::min(std::max(scaled, -1e15), 1e15))) : 0;
+            };
+            return { cell(p.x), cell(p.y), cell(p.z) };
+        }
+
+        uint32_t Slot(const Cell3& cell) const
+        {
+            uint64_t h = HashMix(static_cast<uint64_t>(cell.x) * 0x9e3779b97f4a7c15ULL ^
+                                 static_cast<uint64_t>(cell.y) * 0xc2b2ae3d27d4eb4fULL ^
+                                 static_cast<uint64_t>(cell.z) * 0x165667b19e3779f9ULL);
+            return static_cast<uint32_t>(h) & mSlotMask;
+        }
+
+        double                mInverseCellSize;
+        uint32_t              mSlotMask;
+        std::vector<uint32_t> mFirst;
+        std::vector<uint32_t> mVertices;
+    };
+
+
+    /*-----------------------------------------------------------------------------------------
+        Welding
+    -----------------------------------------------------------------------------------------*/
+
+    // Weld one sub-mesh, given as a block of vertices and indices into it. The indices are changed to refer to
+    // the welded vertices, which are added to the end of output. Returns the number of welded vertices
+    uint32_t WeldSubMesh(const unsigned char* vertices, uint32_t numVertices, uint32_t* indices, uint32_t numIndices,
+                         uint32_t vertexSize, uint32_t positionOffset, float tolerance, unsigned int numThreads,
+                         std::vector<unsigned char>& output)
+    {
+        // Find the first vertex that each vertex matches (which may be itself). Each vertex looks for itself so
+        // this can be done in any order
+        PositionHash hash(vertices, vertexSize, positionOffset, numVertices, tolerance, numThreads);
+        const float toleranceSq = tolerance * tolerance;
+        const uint32_t positionEnd = positionOffset + sizeof(CVector3);
+        std::vector<uint32_t> firstMatch(numVertices);
+        ParallelFor(numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; ++v)
+            {
+                const unsigned char* vertex = vertices + static_cast<size_t>(v) * vertexSize;
+                const CVector3& position = ElementAt<CVector3>(vertices, vertexSize, positionOffset, v);
+                uint32_t first = v;
+                hash.ForEachNearby(position, tolerance > 0, [&](uint32_t other)
+                {
+                    if (other >= first)  return;
+                    const unsigned char* otherVertex = vertices + static_cast<size_t>(other) * vertexSize;
+                    bool same;
+                    if (tolerance > 0)
+                    {
+                        CVector3 offset = ElementAt<CVector3>(vertices, vertexSize, positionOffset, other) - position;
+                        same = Dot(offset, offset) <= toleranceSq &&
+                               std::memcmp(vertex, otherVertex, positionOffset) == 0 &&
+                               std::memcmp(vertex + positionEnd, otherVertex + positionEnd, vertexSize - positionEnd) == 0;
+                    }
+                    else
+                    {
+                        same = std::memcmp(vertex, otherVertex, vertexSize) == 0;
+                    }
+                    if (same)  first = other;
+                });
+                firstMatch[v] = first;
+            }
+        });
+
+        // Number the vertices that matched only themselves, the others take the number of their match. A match
+        // is always earlier, so has its number already (and vertices matching a vertex that matched another
+        // earlier vertex join that one)
+        std::vector<uint32_t> newIndex(numVertices);
+        uint32_t numWelded = 0;
+        for (uint32_t v = 0; v < numVertices; ++v)
+        {
+            newIndex[v] = (firstMatch[v] == v) ? numWelded++ : newIndex[firstMatch[v]];
+        }
+
+        size_t outputStart = output.size();
+        output.resize(outputStart + static_cast<size_t>(numWelded) * vertexSize);
+        ParallelFor(numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; ++v)
+            {
+                if (firstMatch[v] == v)
+                {
+                    std::memcpy(&output[outputStart + static_cast<size_t>(newIndex[v]) * vertexSize], vertices + static_cast<size_t>(v) * vertexSize, vertexSize);
+                }
+            }
+        });
+        ParallelFor(numIndices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)  indices[i] = newIndex[indices[i]];
+        });
+        return numWelded;
+    }
+
+
+    // Copy the vertex of each corner of a sub-mesh into its own vertex in output
+    void CopyCornerVertices(const unsigned char* vertices, uint32_t vertexSize, const uint32_t* indices, uint32_t numIndices,
+                            unsigned int numThreads, std::vector<unsigned char>& output)
+    {
+        output.resize(static_cast<size_t>(numIndices) * vertexSize);
+        ParallelFor(numIndices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t c = begin; c < end; ++c)
+            {
+                std::memcpy(&output[static_cast<size_t>(c) * vertexSize], vertices + static_cast<size_t>(indices[c]) * vertexSize, vertexSize);
+            }
+        });
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Welding
+-----------------------------------------------------------------------------------------*/
+
+// Merge vertices of each sub-mesh whose positions are within positionTolerance of each other (0 for exactly
+// equal) and whose other elements are exactly equal. Unused vertices are kept
+void WeldVertices(MeshData& mesh, float positionTolerance /*= 0*/, unsigned int numThreads /*= 0*/)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    if (position == nullptr || position->format != VertexFormat::Float3)  return;
+    const uint32_t positionOffset = position->offset;
+
+    std::vector<unsigned char> newVertices;
+    newVertices.reserve(mesh.vertices.size());
+    uint32_t numNewVertices = 0;
+    for (SubMesh& subMesh : mesh.subMeshes)
+    {
+        const unsigned char* vertices = mesh.vertices.data() + static_cast<size_t>(subMesh.baseVertex) * mesh.vertexSize;
+        subMesh.numVertices = WeldSubMesh(vertices, subMesh.numVertices, mesh.indices.data() + subMesh.startIndex, subMesh.numIndices,
+                                          mesh.vertexSize, positionOffset, positionTolerance, numThreads, newVertices);
+        subMesh.baseVertex = numNewVertices;
+        numNewVertices += subMesh.numVertices;
+    }
+    mesh.vertices.swap(newVertices);
+    mesh.numVertices = numNewVertices;
+    if (positionTolerance > 0)  CalculateBounds(mesh);
+}
+
+
+// Give every triangle corner its own vertex, the opposite of WeldVertices (and the form many file formats use)
+void UnweldVertices(MeshData& mesh, unsigned int numThreads /*= 0*/)
+{
+    std::vector<unsigned char> newVertices, cornerVertices;
+    newVertices.reserve(mesh.indices.size() * mesh.vertexSize);
+    for (SubMesh& subMesh : mesh.subMeshes)
+    {
+        const unsigned char* vertices = mesh.vertices.data() + static_cast<size_t>(subMesh.baseVertex) * mesh.vertexSize;
+        uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+        CopyCornerVertices(vertices, mesh.vertexSize, indices, subMesh.numIndices, numThreads, cornerVertices);
+        for (uint32_t i = 0; i < subMesh.numIndices; ++i)  indices[i] = i;
+
+        subMesh.baseVertex  = static_cast<uint32_t>(newVertices.size() / mesh.vertexSize);
+        subMesh.numVertices = subMesh.numIndices;
+        newVertices.insert(newVertices.end(), cornerVertices.begin(), cornerVertices.end());
+    }
+    mesh.numVertices = static_cast<uint32_t>(newVertices.size() / mesh.vertexSize);
+    mesh.vertices.swap(newVertices);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Normals
+-----------------------------------------------------------------------------------------*/
+
+// Calculate normals from the triangles, see comment at top of header file. Adds a "Normal" element after
+// the position if there isn't one. If replaceExisting is false only sub-meshes whose normals are all zero
+// (e.g. a file that had none) are given normals, the others are left unchanged
+void GenerateSmoothNormals(MeshData& mesh, float maxSmoothingAngle /*= MAX_SMOOTHING_ANGLE*/, bool replaceExisting /*= true*/,
+                           unsigned int numThreads /*= 0*/)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    if (position == nullptr || position->format != VertexFormat::Float3)  return;
+    const uint32_t positionOffset = position->offset;
+    if (FindElement(mesh.View(), "Normal") == nullptr)
+    {
+        InsertElement(mesh, (position - mesh.elements.data()) + 1, "Normal", VertexFormat::Float3, numThreads);
+    }
+    const uint32_t normalOffset = FindElement(mesh.View(), "Normal")->offset;
+    const uint32_t vertexSize = mesh.vertexSize;
+    const float cosSmoothingAngle = std::cos(maxSmoothingAngle * DEGREES_TO_RADIANS);
+
+    std::vector<unsigned char> newVertices, cornerVertices;
+    newVertices.reserve(mesh.vertices.size());
+    std::vector<CVector3> faceNormals;
+    std::vector<uint32_t> samePosition, cornerPosition;
+    for (SubMesh& subMesh : mesh.subMeshes)
+    {
+        const unsigned char* vertices = mesh.vertices.data() + static_cast<size_t>(subMesh.baseVertex) * vertexSize;
+        uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+        const uint32_t newBaseVertex = static_cast<uint32_t>(newVertices.size() / vertexSize);
+
+        bool hasNormals = false;
+        for (uint32_t v = 0; v < subMesh.numVertices && !hasNormals; ++v)
+        {
+            const CVector3& normal = ElementAt<CVector3>(vertices, vertexSize, normalOffset, v);
+            hasNormals = (normal.x != 0 || normal.y != 0 || normal.z != 0);
+        }
+        if (hasNormals && !replaceExisting)
+        {
+            newVertices.insert(newVertices.end(), vertices, vertices + static_cast<size_t>(subMesh.numVertices) * vertexSize);
+            subMesh.baseVertex = newBaseVertex;
+            continue;
+        }
+
+        // Unit normal of each face
+        const uint32_t numTriangles = subMesh.numIndices / 3;
+        faceNormals.resize(numTriangles);
+        ParallelFor(numTriangles, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t t = begin; t < end; ++t)
+            {
+                const CVector3& p0 = ElementAt<CVector3>(vertices, vertexSize, positionOffset, indices[t * 3]);
+                const CVector3& p1 = ElementAt<CVector3>(vertices, vertexSize, positionOffset, indices[t * 3 + 1]);
+                const CVector3& p2 = ElementAt<CVector3>(vertices, vertexSize, positionOffset, indices[t * 3 + 2]);
+                faceNormals[t] = UnitOrZero(Cross(p1 - p0, p2 - p0));
+            }
+        });
+
+        // Group the corners by position: each vertex is represented by the first vertex at the same position
+        PositionHash hash(vertices, vertexSize, positionOffset, subMesh.numVertices, 0, numThreads);
+        samePosition.resize(subMesh.numVertices);
+        ParallelFor(subMesh.numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; ++v)
+            {
+                const CVector3& p = ElementAt<CVector3>(vertices, vertexSize, positionOffset, v);
+                uint32_t first = v;
+                hash.ForEachNearby(p, false, [&](uint32_t other)
+                {
+                    if (other < first && std::memcmp(&p, &ElementAt<CVector3>(vertices, vertexSize, positionOffset, other), sizeof(CVector3)) == 0)  first = other;
+                });
+                samePosition[v] = first;
+            }
+        });
+        cornerPosition.resize(subMesh.numIndices);
+        for (uint32_t c = 0; c < subMesh.numIndices; ++c)  cornerPosition[c] = samePosition[indices[c]];
+        CornerLists cornersAtPosition(cornerPosition.data(), subMesh.numIndices, subMesh.numVertices);
+
+        // Each corner gets its own vertex with the average of the normals of the faces at its position that are
+        // within the smoothing angle of its own face
+        CopyCornerVertices(vertices, vertexSize, indices, subMesh.numIndices, numThreads, cornerVertices);
+        ParallelFor(numTriangles, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t c = begin * 3; c < end * 3; ++c)
+            {
+                const CVector3& faceNormal = faceNormals[c / 3];
+                CVector3 sum = { 0, 0, 0 };
+                uint32_t group = cornerPosition[c];
+                for (uint32_t i = cornersAtPosition.first[group]; i < cornersAtPosition.first[group + 1]; ++i)
+                {
+                    const CVector3& otherNormal = faceNormals[cornersAtPosition.corners[i] / 3];
+                    if (Dot(faceNormal, otherNormal) >= cosSmoothingAngle)  sum += otherNormal;
+                }
+                CVector3 normal = UnitOrZero(sum);
+                ElementAt<CVector3>(cornerVertices.data(), vertexSize, normalOffset, c) = (Dot(normal, normal) > 0) ? normal : faceNormal;
+            }
+        }, 1024);
+
+        // Then corners with the same vertex again are merged
+        for (uint32_t c = 0; c < subMesh.numIndices; ++c)  indices[c] = c;
+        subMesh.numVertices = WeldSubMesh(cornerVertices.data(), subMesh.numIndices, indices, subMesh.numIndices,
+                                          vertexSize, positionOffset, 0, numThreads, newVertices);
+        subMesh.baseVertex = newBaseVertex;
+    }
+    mesh.numVertices = static_cast<uint32_t>(newVertices.size() / vertexSize);
+    mesh.vertices.swap(newVertices);
+    CalculateBounds(mesh);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Tangents
+-----------------------------------------------------------------------------------------*/
+
+// Calculate tangents from the normals and UVs, see comment at top of header file. Adds a "Tangent" element
+// after the normal if there isn't one. Returns false (changing nothing) if the mesh has no normals or no UVs
+bool GenerateTangents(MeshData& mesh, unsigned int numThreads /*= 0*/)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    const VertexElement* normal   = FindElement(mesh.View(), "Normal");
+    const VertexElement* uv       = FindElement(mesh.View(), "UV");
+    if (position == nullptr || position->format != VertexFormat::Float3 || normal == nullptr || normal->format != VertexFormat::Float3 ||
+        uv == nullptr || uv->format != VertexFormat::Float2)  return false;
+    if (FindElement(mesh.View(), "Tangent") == nullptr)
+    {
+        InsertElement(mesh, (normal - mesh.elements.data()) + 1, "Tangent", VertexFormat::Float3, numThreads);
+    }
+    const uint32_t positionOffset = FindElement(mesh.View(), "Position")->offset;
+    const uint32_t normalOffset   = FindElement(mesh.View(), "Normal")->offset;
+    const uint32_t uvOffset       = FindElement(mesh.View(), "UV")->offset;
+    const uint32_t tangentOffset  = FindElement(mesh.View(), "Tangent")->offset;
+    const uint32_t vertexSize     = mesh.vertexSize;
+
+    std::vector<unsigned char> newVertices;
+    newVertices.reserve(mesh.vertices.size());
+    std::vector<CVector3> cornerTangents;
+    std::vector<int8_t>   cornerSigns;
+    std::vector<uint8_t>  vertexSigns;
+    std::vector<uint32_t> mirroredVertex;
+    for (SubMesh& subMesh : mesh.subMeshes)
+    {
+        const unsigned char* vertices = mesh.vertices.data() + static_cast<size_t>(subMesh.baseVertex) * vertexSize;
+        uint32_t* indices = mesh.indices.data() + subMesh.startIndex;
+        const uint32_t numTriangles = subMesh.numIndices / 3;
+
+        // Each triangle's tangent, the direction in which u increases, projected into the plane of each
+        // corner's normal and weighted by the angle at the corner. The sign records whether the UVs are mirrored
+        // (0 for corners that give no tangent, e.g. triangles whose UVs are all in a line)
+        cornerTangents.resize(subMesh.numIndices);
+        cornerSigns.resize(subMesh.numIndices);
+        ParallelFor(numTriangles, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t t = begin; t < end; ++t)
+            {
+                CVector3 p[3], n[3];
+                CVector2 uvs[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    p[k]   = ElementAt<CVector3>(vertices, vertexSize, positionOffset, indices[t * 3 + k]);
+                    n[k]   = ElementAt<CVector3>(vertices, vertexSize, normalOffset,   indices[t * 3 + k]);
+                    uvs[k] = ElementAt<CVector2>(vertices, vertexSize, uvOffset,       indices[t * 3 + k]);
+                }
+                CVector3 edge1 = p[1] - p[0], edge2 = p[2] - p[0];
+                float du1 = uvs[1].x - uvs[0].x, dv1 = uvs[1].y - uvs[0].y;
+                float du2 = uvs[2].x - uvs[0].x, dv2 = uvs[2].y - uvs[0].y;
+                float uvArea = du1 * dv2 - du2 * dv1;
+                int8_t sign = (uvArea > 0) ? 1 : (uvArea < 0) ? -1 : 0;
+                CVector3 tangent = (edge1 * dv2 - edge2 * dv1) * static_cast<float>(sign);
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    uint32_t c = t * 3 + k;
+                    CVector3 projected = UnitOrZero(tangent - n[k] * Dot(n[k], tangent));
+                    CVector3 toNext = p[(k + 1) % 3] - p[k], toPrevious = p[(k + 2) % 3] - p[k];
+                    toNext     = UnitOrZero(toNext     - n[k] * Dot(n[k], toNext));
+                    toPrevious = UnitOrZero(toPrevious - n[k] * Dot(n[k], toPrevious));
+                    float angle = std::acos(std::min(std::max(Dot(toNext, toPrevious), -1.0f), 1.0f));
+
+                    bool valid = (sign != 0 && Dot(projected, projected) > 0);
+                    cornerTangents[c] = valid ? projected * angle : CVector3{ 0, 0, 0 };
+                    cornerSigns[c]    = valid ? sign : 0;
+                }
+            }
+        }, 1024);
+
+        // Vertices used by corners of both signs are split, the mirrored corners get a copy of the vertex
+        vertexSigns.assign(subMesh.numVertices, 0);
+        for (uint32_t c = 0; c < subMesh.numIndices; ++c)
+        {
+            if (cornerSigns[c] != 0)  vertexSigns[indices[c]] |= (cornerSigns[c] > 0) ? 1 : 2;
+        }
+        uint32_t numVertices = subMesh.numVertices;
+        mirroredVertex.assign(subMesh.numVertices, 0);
+        for (uint32_t v = 0; v < subMesh.numVertices; ++v)
+        {
+            if (vertexSigns[v] == 3)  mirroredVertex[v] = numVertices++;
+        }
+        const uint32_t newBaseVertex = static_cast<uint32_t>(newVertices.size() / vertexSize);
+        newVertices.insert(newVertices.end(), vertices, vertices + static_cast<size_t>(subMesh.numVertices) * vertexSize);
+        newVertices.resize(newVertices.size() + static_cast<size_t>(numVertices - subMesh.numVertices) * vertexSize);
+        unsigned char* subMeshVertices = newVertices.data() + static_cast<size_t>(newBaseVertex) * vertexSize;
+        for (uint32_t v = 0; v < subMesh.numVertices; ++v)
+        {
+            if (vertexSigns[v] == 3)  std::memcpy(subMeshVertices + static_cast<size_t>(mirroredVertex[v]) * vertexSize, vertices + static_cast<size_t>(v) * vertexSize, vertexSize);
+        }
+        for (uint32_t c = 0; c < subMesh.numIndices; ++c)
+        {
+            if (cornerSigns[c] < 0 && vertexSigns[indices[c]] == 3)  indices[c] = mirroredVertex[indices[c]];
+        }
+
+        // Each vertex sums the tangents of its corners
+        CornerLists vertexCorners(indices, subMesh.numIndices, numVertices);
+        ParallelFor(numVertices, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; ++v)
+            {
+                CVector3 sum = { 0, 0, 0 };
+                for (uint32_t i = vertexCorners.first[v]; i < vertexCorners.first[v + 1]; ++i)  sum += cornerTangents[vertexCorners.corners[i]];
+
+                const CVector3& n = ElementAt<CVector3>(subMeshVertices, vertexSize, normalOffset, v);
+                CVector3 tangent = UnitOrZero(sum - n * Dot(n, sum));
+                ElementAt<CVector3>(subMeshVertices, vertexSize, tangentOffset, v) = (Dot(tangent, tangent) > 0) ? tangent : AnyPerpendicular(n);
+            }
+        });
+
+        subMesh.baseVertex  = newBaseVertex;
+        subMesh.numVertices = numVertices;
+    }
+    mesh.numVertices = static_cast<uint32_t>(newVertices.size() / vertexSize);
+    mesh.vertices.swap(newVertices);
+    return true;
+}
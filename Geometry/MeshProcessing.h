@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------
+// Mesh processing after import - welding vertices, smooth normals and tangents
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// The processing assimp used to do during import (aiProcess_JoinIdenticalVertices, GenSmoothNormals and
+// CalcTangentSpace), done here for any importer and split across the CPU cores with ParallelFor. Work on
+// triangles is split by ranges of triangles and work on vertices by ranges of vertices, and every result is
+// calculated by one thread in a fixed order, so the output is exactly the same whatever the number of
+// threads. Each sub-mesh is processed separately as sub-meshes don't share vertices.
+//
+//  - WeldVertices merges vertices that are the same. Vertices are found by position with a spatial hash (a
+//    hash table of grid cells) and merged if their positions are within a tolerance and every other element
+//    is exactly equal. Each vertex goes to the first vertex it matches, so the vertex order is kept.
+//  - GenerateSmoothNormals gives each triangle corner the average of the face normals at its position,
+//    leaving out faces at more than a smoothing angle to the corner's own face so that hard edges stay sharp
+//    (as GenSmoothNormals with AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE). Vertices are split where the normals
+//    differ and welded again.
+//  - GenerateTangents follows MikkTSpace: each triangle's tangent (the direction of increasing u) is
+//    projected onto the plane of each corner's normal and weighted by the angle at that corner, and each
+//    vertex sums these over the corners that use it. Vertices shared by triangles with mirrored UVs are
+//    split, so each side gets its own tangent. MikkTSpace also stores a bitangent sign, which the vertex
+//    layout here has no room for (the shaders take the bitangent as the cross product of normal and tangent).
+//
+// The mesh must have the float formats from import (MeshData.h). numThreads of 0 uses every core.
+
+#ifndef _MESH_PROCESSING_H_INCLUDED_
+#define _MESH_PROCESSING_H_INCLUDED_
+
+#include "MeshData.h"
+
+
+// Smoothing angle in degrees used by the importers: normals are averaged across edges where the faces meet
+// at up to this angle
+const float MAX_SMOOTHING_ANGLE = 80.0f;
+
+
+// Merge vertices of each sub-mesh whose positions are within positionTolerance of each other (0 for exactly
+// equal) and whose other elements are exactly equal. Unused vertices are kept
+void WeldVertices(MeshData& mesh, float positionTolerance = 0, unsigned int numThreads = 0);
+
+// Give every triangle corner its own vertex, the opposite of WeldVertices (and the form many file formats use)
+void UnweldVertices(MeshData& mesh, unsigned int numThreads = 0);
+
+
+// Calculate normals from the triangles, see comment at top of file. Adds a "Normal" element after the
+// position if there isn't one. If replaceExisting is false only sub-meshes whose normals are all zero (e.g.
+// a file that had none) are given normals, the others are left unchanged
+void GenerateSmoothNormals(MeshData& mesh, float maxSmoothingAngle = MAX_SMOOTHING_ANGLE, bool replaceExisting = true,
+                           unsigned int numThreads = 0);
+
+// Calculate tangents from the normals and UVs, see comment at top of file. Adds a "Tangent" element after the
+// normal if there isn't one. Returns false (changing nothing) if the mesh has no normals or no UVs
+bool GenerateTangents(MeshData& mesh, unsigned int numThreads = 0);
+
+
+#endif //_MESH_PROCESSING_H_INCLUDED_
@@ -0,0 +1,546 @@
+//--------------------------------------------------------------------------------------
+// Mesh simplification and automatic levels of detail
+//--------------------------------------------------------------------------------------
+
+#include "MeshSimplifier.h"
+#include "MeshOptimiser.h"
+#include "CVector3.h"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    /*-----------------------------------------------------------------------------------------
+        Helpers
+    -----------------------------------------------------------------------------------------*/
+
+    // A LOD must have at most this fraction of the triangles of the LOD before, otherwise simplification has
+    // stalled and the LOD isn't worth its memory
+    const float MAX_LOD_TRIANGLE_RATIO = 0.8f;
+
+    // Weight of the planes holding open edges and seams in place, relative to the triangles' planes
+    const double BORDER_WEIGHT = 10;
+
+    // A collapse is rejected if a triangle's normal would turn by more than about 75 degrees
+    const float MIN_NORMAL_COS = 0.25f;
+
+
+    // Sum of squared distances to a set of planes, each weighted, as a symmetric 4x4 matrix. Divided by the
+    // total weight it gives the mean squared distance of a point from the planes
+    struct Quadric
+    {
+        double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+        double weight = 0;
+
+        // Add the plane through point p with the given unit normal
+        void AddPlane(const CVector3& normal, const CVector3& p, double planeWeight)
+        {
+            double a = normal.x, b = normal.y, c = normal.z, d = -Dot(normal, p);
+            xx += planeWeight * a * a;  xy += planeWeight * a * b;  xz += planeWeight * a * c;  xw += planeWeight * a * d;
+            yy += planeWeight * b * b;  yz += planeWeight * b * c;  yw += planeWeight * b * d;
+            zz += planeWeight * c * c;  zw += planeWeight * c * d;
+            ww += planeWeight * d * d;
+            weight += planeWeight;
+        }
+
+        Quadric& operator+=(const Quadric& q)
+        {
+            xx += q.xx;  xy += q.xy;  xz += q.xz;  xw += q.xw;  yy += q.yy;  yz += q.yz;  yw += q.yw;
+            zz += q.zz;  zw += q.zw;  ww += q.ww;  weight += q.weight;
+            return *this;
+        }
+
+        // Weighted sum of the squared distances of point p from the planes
+        double Evaluate(const CVector3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double result = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x +
+                            yy * y * y + 2 * yz * y * z + 2 * yw * y +
+                            zz * z * z + 2 * zw * z + ww;
+            return std::max(result, 0.0); // Rounding can give a small negative result
+        }
+    };
+
+
+    // How a position may move during simplification
+    enum class VertexKind : uint8_t
+    {
+        Manifold, // Inside a surface, with a single ring of triangles around it - may move onto any neighbour
+        Border,   // On the open edge of a surface - may move onto a neighbour along the edge
+        Locked,   // Where the surface isn't a simple sheet, or with no triangles - never moves
+    };
+
+
+    // Key of the edge between two positions, the same in either direction
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    }
+
+
+    // Sum of the squared differences between the elements of two vertices, all floats in an imported mesh
+    double VertexDifference(const MeshData& mesh, uint32_t a, uint32_t b)
+    {
+        const float* elementsA = reinterpret_cast<const float*>(mesh.vertices.data() + static_cast<size_t>(a) * mesh.vertexSize);
+        const float* elementsB = reinterpret_cast<const float*>(mesh.vertices.data() + static_cast<size_t>(b) * mesh.vertexSize);
+        double difference = 0;
+        for (uint32_t i = 0; i < mesh.vertexSize / sizeof(float); ++i)
+        {
+            double d = elementsA[i] - elementsB[i];
+            difference += d * d;
+        }
+        return difference;
+    }
+
+
+    // Normal (not normalised) of a triangle
+    CVector3 TriangleNormal(const CVector3& p0, const CVector3& p1, const CVector3& p2)
+    {
+        return Cross(p1 - p0, p2 - p0);
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Topology
+    -----------------------------------------------------------------------------------------*/
+
+    // The connections between the positions of the current triangles. Positions are identified by a vertex
+    // number, the lowest numbered vertex at that position. A position at a seam has more than one vertex used
+    // by its triangles, but is otherwise treated like any other
+    struct Topology
+    {
+        std::vector<uint64_t>   edges;          // Every edge once, sorted
+        std::vector<uint32_t>   edgeTriangles;  // Number of triangles using each edge
+        std::vector<VertexKind> kinds;          // For each position
+
+        // Lists of the triangle corners at each position, all in one array: the corners at position p are
+        // corners[first[p]] to corners[first[p + 1] - 1]
+        std::vector<uint32_t>   first;
+        std::vector<uint32_t>   corners;
+
+        Topology(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& positionOf, uint32_t numVertices, bool lockBorders)
+        {
+            const uint32_t numCorners = static_cast<uint32_t>(indices.size());
+
+            std::vector<uint64_t> allEdges(numCorners);
+            for (uint32_t c = 0; c < numCorners; ++c)
+            {
+                uint32_t next = (c % 3 == 2) ? c - 2 : c + 1;
+                allEdges[c] = EdgeKey(positionOf[indices[c]], positionOf[indices[next]]);
+            }
+            std::sort(allEdges.begin(), allEdges.end());
+            for (size_t e = 0; e < allEdges.size(); ++e)
+            {
+                if (e == 0 || allEdges[e] != allEdges[e - 1])
+                {
+                    edges.push_back(allEdges[e]);
+                    edgeTriangles.push_back(0);
+                }
+                ++edgeTriangles.back();
+            }
+
+            // A position inside a surface has as many edges as triangles, one on an open edge has one more
+            // edge than triangles with two of them on the open edge (locked if lockBorders). Anything else is locked
+            std::vector<uint32_t> numEdges(numVertices, 0), numBorderEdges(numVertices, 0), numTriangles(numVertices, 0);
+            std::vector<bool> nonManifold(numVertices, false);
+            std::vector<bool> seen(numVertices, false);
+            for (size_t e = 0; e < edges.size(); ++e)
+            {
+                uint32_t a = static_cast<uint32_t>(edges[e] >> 32), b = static_cast<uint32_t>(edges[e]);
+                ++numEdges[a];
+                ++numEdges[b];
+                if (edgeTriangles[e] == 1)
+                {
+                    ++numBorderEdges[a];
+                    ++numBorderEdges[b];
+                }
+                else if (edgeTriangles[e] > 2)
+                {
+                    nonManifold[a] = nonManifold[b] = true;
+                }
+            }
+            std::vector<uint32_t> keys(numCorners);
+            for (uint32_t c = 0; c < numCorners; ++c)
+            {
+                uint32_t position = positionOf[indices[c]];
+                keys[c] = position;
+                ++numTriangles[position];
+                seen[position] = true;
+            }
+
+            kinds.assign(numVertices, VertexKind::Locked);
+            for (uint32_t p = 0; p < numVertices; ++p)
+            {
+                if (!seen[p] || nonManifold[p])  continue;
+                if      (numBorderEdges[p] == 0 && numEdges[p] == numTriangles[p])      kinds[p] = VertexKind::Manifold;
+                else if (numBorderEdges[p] == 2 && numEdges[p] == numTriangles[p] + 1 && !lockBorders)  kinds[p] = VertexKind::Border;
+            }
+
+            first.assign(numVertices + 1, 0);
+            corners.resize(numCorners);
+            for (uint32_t c = 0; c < numCorners; ++c)  ++first[keys[c] + 1];
+            for (uint32_t p = 0; p < numVertices; ++p)  first[p + 1] += first[p];
+            std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+            for (uint32_t c = 0; c < numCorners; ++c)  corners[fill[keys[c]]++] = c;
+        }
+
+        // Number of triangles using the edge between two positions, 0 if there is no such edge
+        uint32_t TrianglesOnEdge(uint32_t a, uint32_t b) const
+        {
+            auto edge = std::lower_bound(edges.begin(), edges.end(), EdgeKey(a, b));
+            return (edge != edges.end() && *edge == EdgeKey(a, b)) ? edgeTriangles[edge - edges.begin()] : 0;
+        }
+    };
+
+
+    // A possible collapse, moving one position onto another
+    struct Collapse
+    {
+        double   cost;
+        uint32_t from;
+        uint32_t to;
+    };
+
+    // A vertex replaced by another in a collapse
+    struct VertexMove
+    {
+        uint32_t from;
+        uint32_t to;
+    };
+
+} // namespace
+
+
+/*-----------------------------------------------------------------------------------------
+    Simplification
+-----------------------------------------------------------------------------------------*/
+
+// Simplify the triangles of one sub-mesh towards targetIndices indices. See comment at top of header file
+float SimplifyTriangles(const MeshData& mesh, const SubMesh& subMesh, std::vector<uint32_t>& indices, uint32_t targetIndices,
+                        bool lockBorders /*= false*/)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    if (position == nullptr || position->format != VertexFormat::Float3 || indices.size() <= targetIndices)  return 0;
+
+    const uint32_t numVertices = subMesh.numVertices;
+    std::vector<CVector3> positions(numVertices);
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        std::memcpy(&positions[v], &mesh.vertices[static_cast<size_t>(subMesh.baseVertex + v) * mesh.vertexSize + position->offset], sizeof(CVector3));
+    }
+
+    // Vertices at exactly the same position are the same position for simplification, numbered by their lowest
+    // vertex. Sorting by position finds them
+    std::vector<uint32_t> order(numVertices);
+    std::iota(order.begin(), order.end(), 0);
+    auto lessPosition = [&](uint32_t a, uint32_t b)
+    {
+        const CVector3& pa = positions[a];
+        const CVector3& pb = positions[b];
+        return (pa.x != pb.x) ? pa.x < pb.x : (pa.y != pb.y) ? pa.y < pb.y : pa.z < pb.z;
+    };
+    std::stable_sort(order.begin(), order.end(), lessPosition);
+    std::vector<uint32_t> positionOf(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i)
+    {
+        bool same = (i > 0 && !lessPosition(order[i - 1], order[i]));
+        positionOf[order[i]] = same ? positionOf[order[i - 1]] : order[i];
+    }
+
+    // Remove triangles that are already degenerate
+    auto removeDegenerate = [&]()
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            uint32_t p0 = positionOf[indices[i]], p1 = positionOf[indices[i + 1]], p2 = positionOf[indices[i + 2]];
+            if (p0 == p1 || p1 == p2 || p2 == p0)  continue;
+            std::copy(&indices[i], &indices[i] + 3, &indices[kept]);
+            kept += 3;
+        }
+        indices.resize(kept);
+    };
+    removeDegenerate();
+
+    // Quadric of the planes of the triangles around each position, weighted by area
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const CVector3& p0 = positions[indices[i]];
+        CVector3 normal = TriangleNormal(p0, positions[indices[i + 1]], positions[indices[i + 2]]);
+        float length = Length(normal);
+        if (length <= 0)  continue;
+        for (int c = 0; c < 3; ++c)  quadrics[positionOf[indices[i + c]]].AddPlane(normal * (1 / length), p0, length * 0.5);
+    }
+
+    std::vector<uint32_t> newVertex(numVertices);
+    std::iota(newVertex.begin(), newVertex.end(), 0);
+    std::vector<bool>     locked(numVertices);
+    std::vector<uint32_t> neighbourMark(numVertices, 0);
+    uint32_t mark = 0;
+    std::vector<Collapse> collapses;
+    std::vector<VertexMove> vertexMoves;
+    double maxCost = 0;
+    bool firstPass = true;
+    bool moveOffSeams = false;
+    while (indices.size() > targetIndices)
+    {
+        Topology topology(indices, positionOf, numVertices, lockBorders);
+
+        // Hold open edges and seams in place with a plane through the edge at right angles to its triangle
+        // (each side's triangle at a seam), weighted by the edge's squared length so it scales like the
+        // triangles' areas. A seam edge is between two triangles that use different vertices for it
+        if (firstPass)
+        {
+            std::vector<uint64_t> vertexEdges(indices.size());
+            for (uint32_t c = 0; c < indices.size(); ++c)
+            {
+                uint32_t next = (c % 3 == 2) ? c - 2 : c + 1;
+                vertexEdges[c] = EdgeKey(indices[c], indices[next]);
+            }
+            std::sort(vertexEdges.begin(), vertexEdges.end());
+
+            for (uint32_t c = 0; c < indices.size(); ++c)
+            {
+                uint32_t next = (c % 3 == 2) ? c - 2 : c + 1;
+                uint32_t a = positionOf[indices[c]], b = positionOf[indices[next]];
+                uint32_t edgeTriangles = topology.TrianglesOnEdge(a, b);
+                auto sameVertices = std::equal_range(vertexEdges.begin(), vertexEdges.end(), EdgeKey(indices[c], indices[next]));
+                bool seam = (edgeTriangles == 2 && sameVertices.second - sameVertices.first == 1);
+                if (edgeTriangles != 1 && !seam)  continue;
+
+                uint32_t t = c - c % 3;
+                CVector3 edge = positions[b] - positions[a];
+                CVector3 normal = TriangleNormal(positions[indices[t]], positions[indices[t + 1]], positions[indices[t + 2]]);
+                CVector3 planeNormal = Cross(edge, normal);
+                float length = Length(planeNormal);
+                if (length <= 0)  continue;
+                double edgeWeight = BORDER_WEIGHT * Dot(edge, edge);
+                quadrics[a].AddPlane(planeNormal * (1 / length), positions[a], edgeWeight);
+                quadrics[b].AddPlane(planeNormal * (1 / length), positions[a], edgeWeight);
+            }
+            firstPass = false;
+        }
+
+        // Every collapse from each position that can move. A position is only moved once in a pass, so the
+        // others are only tried if the cheaper ones from the same position are rejected
+        auto cost = [&](uint32_t from, uint32_t to)
+        {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            return (q.weight > 0) ? q.Evaluate(positions[to]) / q.weight : 0.0;
+        };
+        collapses.clear();
+        for (uint32_t p = 0; p < numVertices; ++p)
+        {
+            if (topology.kinds[p] == VertexKind::Locked)  continue;
+
+            for (uint32_t i = topology.first[p]; i < topology.first[p + 1]; ++i)
+            {
+                uint32_t c = topology.corners[i], t = c - c % 3;
+                for (uint32_t other = t; other < t + 3; ++other)
+                {
+                    uint32_t to = positionOf[indices[other]];
+                    if (to == p)  continue;
+                    if (topology.kinds[p] == VertexKind::Border && topology.TrianglesOnEdge(p, to) != 1)  continue;
+                    collapses.push_back({ cost(p, to), p, to });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+        {
+            return (a.cost != b.cost) ? a.cost < b.cost : (a.from != b.from) ? a.from < b.from : a.to < b.to;
+        });
+
+        // Make the cheapest collapses that don't touch each other. Each collapse locks the positions of the
+        // triangles around it for the rest of the pass, so the triangles the checks looked at don't change.
+        // Only the cheapest half are made in a pass, unless none of them can be, so that costly collapses
+        // wait until the cheap ones elsewhere have been made
+        std::fill(locked.begin(), locked.end(), false);
+        uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+        size_t numCollapsed = 0;
+        for (size_t i = 0; i < collapses.size() && numTriangles * 3 > targetIndices; ++i)
+        {
+            if (i >= collapses.size() / 2 && numCollapsed > 0)  break;
+            const uint32_t from = collapses[i].from, to = collapses[i].to;
+            if (locked[from] || locked[to])  continue;
+
+            // The ends of the edge must share only the positions of the triangles on the edge, otherwise the
+            // collapse would join parts of the surface
+            uint32_t edgeTriangles = topology.TrianglesOnEdge(from, to);
+            if (numTriangles <= edgeTriangles)  continue;
+            ++mark;
+            for (uint32_t j = topology.first[from]; j < topology.first[from + 1]; ++j)
+            {
+                uint32_t t = topology.corners[j] - topology.corners[j] % 3;
+                for (uint32_t c = t; c < t + 3; ++c)  neighbourMark[positionOf[indices[c]]] = mark;
+            }
+            uint32_t sharedNeighbours = 0;
+            uint32_t sharedMark = ++mark;
+            for (uint32_t j = topology.first[to]; j < topology.first[to + 1]; ++j)
+            {
+                uint32_t t = topology.corners[j] - topology.corners[j] % 3;
+                for (uint32_t c = t; c < t + 3; ++c)
+                {
+                    uint32_t neighbour = positionOf[indices[c]];
+                    if (neighbour == from || neighbour == to || neighbourMark[neighbour] != sharedMark - 1)  continue;
+                    neighbourMark[neighbour] = sharedMark;
+                    ++sharedNeighbours;
+                }
+            }
+            if (sharedNeighbours != edgeTriangles)  continue;
+
+            // Each vertex at the moving position is replaced by the vertex at the other end used by the same
+            // triangle on the edge. At a seam (more than one vertex) the edge must run along the seam, with a
+            // triangle on the edge for each vertex, so both sides move together and each keeps its own vertices
+            vertexMoves.clear();
+            bool canMove = true;
+            for (uint32_t j = topology.first[from]; j < topology.first[from + 1] && canMove; ++j)
+            {
+                uint32_t corner = topology.corners[j], t = corner - corner % 3;
+                for (uint32_t c = t; c < t + 3; ++c)
+                {
+                    if (positionOf[indices[c]] != to)  continue;
+                    auto move = std::find_if(vertexMoves.begin(), vertexMoves.end(), [&](const VertexMove& m) { return m.from == indices[corner]; });
+                    if      (move == vertexMoves.end())  vertexMoves.push_back({ indices[corner], indices[c] });
+                    else if (move->to != indices[c])    canMove = false;
+                }
+            }
+            for (uint32_t j = topology.first[from]; j < topology.first[from + 1] && canMove; ++j)
+            {
+                uint32_t vertex = indices[topology.corners[j]];
+                if (std::any_of(vertexMoves.begin(), vertexMoves.end(), [&](const VertexMove& m) { return m.from == vertex; }))  continue;
+                if (!moveOffSeams)
+                {
+                    canMove = false;
+                    break;
+                }
+
+                // Once nothing else can be collapsed, a vertex with no triangle on the edge takes the most similar
+                // vertex at the other end (all of them are at the same position, so only the other elements count)
+                uint32_t closest = indices[topology.corners[topology.first[to]]];
+                double closestDifference = std::numeric_limits<double>::max();
+                for (uint32_t k = topology.first[to]; k < topology.first[to + 1]; ++k)
+                {
+                    uint32_t candidate = indices[topology.corners[k]];
+                    double difference = VertexDifference(mesh, subMesh.baseVertex + vertex, subMesh.baseVertex + candidate);
+                    if (difference < closestDifference)
+                    {
+                        closestDifference = difference;
+                        closest = candidate;
+                    }
+                }
+                vertexMoves.push_back({ vertex, closest });
+            }
+            if (!canMove)  continue;
+
+            // No remaining triangle may flip or become degenerate
+            bool flips = false;
+            for (uint32_t j = topology.first[from]; j < topology.first[from + 1] && !flips; ++j)
+            {
+                uint32_t corner = topology.corners[j], t = corner - corner % 3;
+                CVector3 before[3], after[3];
+                bool onEdge = false;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    uint32_t p = positionOf[indices[t + c]];
+                    if (p == to)  onEdge = true;
+                    before[c] = positions[p];
+                    after[c]  = (p == from) ? positions[to] : positions[p];
+                }
+                if (onEdge)  continue;
+                CVector3 normalBefore = TriangleNormal(before[0], before[1], before[2]);
+                CVector3 normalAfter  = TriangleNormal(after [0], after [1], after [2]);
+                flips = Dot(normalBefore, normalAfter) <= MIN_NORMAL_COS * Length(normalBefore) * Length(normalAfter);
+            }
+            if (flips)  continue;
+
+            // Collapse
+            for (uint32_t j = topology.first[from]; j < topology.first[from + 1]; ++j)
+            {
+                uint32_t t = topology.corners[j] - topology.corners[j] % 3;
+                for (uint32_t c = t; c < t + 3; ++c)  locked[positionOf[indices[c]]] = true;
+            }
+            for (const VertexMove& move : vertexMoves)  newVertex[move.from] = move.to;
+            quadrics[to] += quadrics[from];
+            maxCost = std::max(maxCost, collapses[i].cost);
+            numTriangles -= edgeTriangles;
+            ++numCollapsed;
+        }
+        if (numCollapsed == 0)
+        {
+            if (moveOffSeams)  break;
+            moveOffSeams = true;
+            continue;
+        }
+
+        for (uint32_t& index : indices)  index = newVertex[index];
+        removeDegenerate();
+    }
+
+    return static_cast<float>(std::sqrt(maxCost));
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Levels of detail
+-----------------------------------------------------------------------------------------*/
+
+// Add levels of detail to the mesh, see comment at top of header file
+void GenerateLODs(MeshData& mesh, uint32_t maxLODs /*= MAX_MESH_LODS*/, float reduction /*= 0.5f*/, bool lockBorders /*= false*/)
+{
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    const uint32_t numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+    if (!mesh.lods.empty() || position == nullptr || position->format != VertexFormat::Float3 ||
+        numTriangles < MIN_LOD_TRIANGLES || maxLODs < 2)  return;
+
+    const uint32_t numParts = static_cast<uint32_t>(mesh.subMeshes.size());
+    std::vector<std::vector<uint32_t>> partIndices(numParts);
+    for (uint32_t p = 0; p < numParts; ++p)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[p];
+        partIndices[p].assign(mesh.indices.begin() + subMesh.startIndex, mesh.indices.begin() + subMesh.startIndex + subMesh.numIndices);
+    }
+    mesh.lods.push_back({ 0, numParts, 0, numTriangles });
+
+    // Each LOD is simplified from the one before, which is much faster than starting from the full detail
+    // mesh each time. Errors add up, so the error of each LOD is an upper bound of its distance from LOD 0
+    std::vector<std::vector<uint32_t>> lodIndices;
+    for (uint32_t lod = 1; lod < maxLODs; ++lod)
+    {
+        lodIndices = partIndices;
+        float    error = 0;
+        uint32_t lodTriangles = 0;
+        for (uint32_t p = 0; p < numParts; ++p)
+        {
+            uint32_t targetIndices = static_cast<uint32_t>(lodIndices[p].size() / 3 * reduction) * 3;
+            error = std::max(error, SimplifyTriangles(mesh, mesh.subMeshes[p], lodIndices[p], targetIndices, lockBorders));
+            lodTriangles += static_cast<uint32_t>(lodIndices[p].size() / 3);
+        }
+        const MeshLOD& previous = mesh.lods.back();
+        if (lodTriangles > previous.numTriangles * MAX_LOD_TRIANGLE_RATIO)  break;
+
+        // Add the LOD's sub-meshes, drawing from the vertices of the full detail parts, and reorder their
+        // triangles for the vertex cache
+        MeshLOD newLOD = { static_cast<uint32_t>(mesh.subMeshes.size()), numParts, previous.error + error, lodTriangles };
+        for (uint32_t p = 0; p < numParts; ++p)
+        {
+            SubMesh subMesh = mesh.subMeshes[p];
+            subMesh.startIndex = static_cast<uint32_t>(mesh.indices.size());
+            subMesh.numIndices = static_cast<uint32_t>(lodIndices[p].size());
+            mesh.indices.insert(mesh.indices.end(), lodIndices[p].begin(), lodIndices[p].end());
+            OptimiseVertexCache(mesh.indices.data() + subMesh.startIndex, subMesh.numIndices, subMesh.numVertices);
+            mesh.subMeshes.push_back(subMesh);
+        }
+        mesh.lods.push_back(newLOD);
+        partIndices.swap(lodIndices);
+    }
+
+    // A single LOD is the same as none
+    if (mesh.lods.size() == 1)  mesh.lods.clear();
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// Mesh simplification and automatic levels of detail
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A mesh far from the camera covers few pixels, but without levels of detail (LODs) every one of its
+// triangles is still transformed and rasterised, many of them smaller than a pixel. GenerateLODs adds a chain
+// of simplified versions of the mesh, each with about half the triangles of the one before, and the Mesh
+// class draws the coarsest one whose error is less than a pixel on screen (see Mesh::SelectLOD).
+//
+// Simplification is by edge collapse with quadric error metrics (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics"). Each vertex holds the sum of the squared distances to the
+// planes of the triangles around it (a "quadric", a 4x4 matrix), and collapsing an edge moves one end onto the
+// other, costing the squared distance of the new position from the planes of both ends. The cheapest
+// collapses are made first. Collapses only move a vertex onto one of its neighbours (a half-edge collapse), so
+// no new vertices are made and every LOD draws from the full detail mesh's vertex buffer, only the index
+// buffer grows.
+//
+// To keep the mesh looking the same:
+//  - Vertices at a seam (at the same position as another vertex, e.g. where texture coordinates or normals
+//    are split) only move along the seam, all the vertices at the position together, each onto the next
+//    vertex on its own side. So textures don't tear and hard edges stay sharp. Seams are held in place by
+//    extra planes as open edges are (below)
+//  - Where seams meet or turn (e.g. at the corners of hard edged models) these collapses soon run out. Once
+//    nothing else can be collapsed, seam vertices may also move off their seam, each vertex without a triangle
+//    on the edge taking the most similar vertex at the other end, so the texture or shading can shift slightly
+//  - Vertices on the open edge of a surface only move along that edge, and the edge is held in place by
+//    extra planes at right angles to it
+//  - A collapse is rejected if it would flip a triangle or join two parts of the surface that weren't joined
+//  - Vertices where the surface isn't a simple sheet (non-manifold) are never moved
+//
+// The mesh must have the float formats from import (MeshData.h), and must be optimised (MeshOptimiser.h)
+// before the LODs are added.
+
+#ifndef _MESH_SIMPLIFIER_H_INCLUDED_
+#define _MESH_SIMPLIFIER_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <vector>
+#include <cstdint>
+
+
+// Most levels of detail GenerateLODs makes, including the full detail mesh (LOD 0)
+const uint32_t MAX_MESH_LODS = 5;
+
+// Meshes with fewer triangles than this aren't given levels of detail, they are cheap to draw anyway
+const uint32_t MIN_LOD_TRIANGLES = 64;
+
+
+// Simplify the triangles of one sub-mesh towards targetIndices indices (three per triangle). indices are the
+// triangles to simplify, relative to the sub-mesh's baseVertex, and are replaced with the result. Stops early
+// if no more edges can be collapsed. Returns the error of the result, about the largest distance between the
+// simplified surface and the one it started from, in model space. Pass lockBorders to never move vertices on
+// the open edges of the surface, for a mesh simplified in pieces that must still meet without cracks
+float SimplifyTriangles(const MeshData& mesh, const SubMesh& subMesh, std::vector<uint32_t>& indices, uint32_t targetIndices,
+                        bool lockBorders = false);
+
+
+// Add levels of detail to the mesh, see comment at top of file. Each LOD has about reduction times the
+// triangles of the one before. Stops early when a mesh can't be simplified much more. Does nothing if the mesh
+// already has LODs, is too small or has no "Position" element. lockBorders is as for SimplifyTriangles (e.g. for
+// the chunks of a streamed mesh, MeshStreaming.h)
+void GenerateLODs(MeshData& mesh, uint32_t maxLODs = MAX_MESH_LODS, float reduction = 0.5f, bool lockBorders = false);
+
+
+#endif //_MESH_SIMPLIFIER_H_INCLUDED_
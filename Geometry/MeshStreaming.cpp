@@ -0,0 +1,792 @@
+//--------------------------------------------------------------------------------------
+// Streaming import - importing meshes too large to hold in memory
+//--------------------------------------------------------------------------------------
+
+#include "MeshStreaming.h"
+#include "StreamedMesh.h"
+#include "XFile.h"
+#include "MeshProcessing.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "Packing.h"
+#include "CVector2.h"
+#include "CVector3.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+
+/*-----------------------------------------------------------------------------------------
+    Settings
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // Memory used importing a chunk, per triangle: the triangles as loaded, the mesh made from them and the
+    // working memory of each processing step (measured at about 500 bytes for chunks of 3000 to 65000
+    // triangles with normals, UVs and tangents). Chunks are given half the budget
+    const size_t CHUNK_BYTES_PER_TRIANGLE = 512;
+
+    // Fewest triangles in a chunk, however small the budget
+    const uint32_t MIN_CHUNK_TRIANGLES = 1024;
+
+    // Size of the blocks read into the caches used to look up triangle corners
+    const size_t CACHE_BLOCK_BYTES = 64 * 1024;
+
+    // Splitting into chunks: the grid of cells is 32 x 32 x 32 (5 bits of each axis), and each pass writes at
+    // most this many files. After this many passes the triangles are simply split in the order they are in
+    const uint32_t CELL_BITS          = 5;
+    const uint32_t NUM_CELLS          = 1u << (3 * CELL_BITS);
+    const uint32_t MAX_PARTITIONS     = 64;
+    const int      MAX_PARTITION_PASSES = 16;
+
+    const uint32_t NO_NORMAL = 0xffffffff;
+    const uint64_t NO_BLOCK  = ~0ull;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Temporary files
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // A temporary file, written through a buffer of a chosen size then read back. The file is removed when the
+    // object is destroyed, so nothing is left behind if the import fails. Errors throw a std::runtime_error
+    class TempFile
+    {
+    public:
+        TempFile() {}
+        ~TempFile()  { Remove(); }
+
+        // Not copyable, the file belongs to one object
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+
+        // Create the file for writing
+        void Create(const std::string& fileName, size_t bufferSize)
+        {
+            Remove();
+            mFileName = fileName;
+            Open("wb", bufferSize);
+        }
+
+        void Write(const void* data, size_t size)
+        {
+            if (std::fwrite(data, 1, size, mFile) != size)  Fail("writing");
+            mSize += size;
+        }
+
+        // Finish writing, freeing the buffer. The file is kept for Rewind
+        void Close()
+        {
+            if (mFile != nullptr && std::fclose(mFile) != 0)  { mFile = nullptr; Fail("writing"); }
+            mFile = nullptr;
+            mBuffer = std::vector<char>();
+        }
+
+        // Open the file for reading from the start. Reads are not buffered, the callers read large blocks
+        void Rewind()
+        {
+            Close();
+            Open("rb", 0);
+        }
+
+        // Read up to size bytes, returns the number read, less than size at the end of the file
+        size_t Read(void* data, size_t size)
+        {
+            size_t read = std::fread(data, 1, size, mFile);
+            if (read < size && std::ferror(mFile))  Fail("reading");
+            return read;
+        }
+
+        // Read size bytes from the given offset
+        void ReadAt(uint64_t offset, void* data, size_t size)
+        {
+#ifdef _WIN32
+            bool seeked = _fseeki64(mFile, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+            bool seeked = fseeko(mFile, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+            if (!seeked || std::fread(data, 1, size, mFile) != size)  Fail("reading");
+        }
+
+        uint64_t Size() const  { return mSize; }
+
+        // Close and delete the file
+        void Remove()
+        {
+            if (mFile != nullptr)  std::fclose(mFile);
+            mFile = nullptr;
+            mBuffer = std::vector<char>();
+            if (!mFileName.empty())  std::remove(mFileName.c_str());
+            mFileName.clear();
+            mSize = 0;
+        }
+
+    private:
+        void Open(const char* mode, size_t bufferSize)
+        {
+            mFile = std::fopen(mFileName.c_str(), mode);
+            if (mFile == nullptr)  Fail("opening");
+
+            // The buffer is owned here rather than by the C library so it counts against the budget like
+            // everything else
+            mBuffer.resize(bufferSize);
+            if (bufferSize > 0)  std::setvbuf(mFile, mBuffer.data(), _IOFBF, bufferSize);
+            else                 std::setvbuf(mFile, nullptr, _IONBF, 0);
+        }
+
+        void Fail(const char* action)
+        {
+            throw std::runtime_error(std::string("Error ") + action + " temporary file " + mFileName);
+        }
+
+        std::string       mFileName;
+        FILE*             mFile = nullptr;
+        std::vector<char> mBuffer;
+        uint64_t          mSize = 0;
+    };
+
+
+    // Reads a file of records of type T from the start, a batch at a time
+    template <typename T>
+    class RecordReader
+    {
+    public:
+        RecordReader(TempFile& file, size_t batchBytes)
+            : mFile(file), mRecords(std::max<size_t>(batchBytes / sizeof(T), 1))
+        {
+            mFile.Rewind();
+        }
+
+        // The next record, nullptr at the end of the file
+        const T* Next()
+        {
+            if (mNext == mCount)
+            {
+                mCount = mFile.Read(mRecords.data(), mRecords.size() * sizeof(T)) / sizeof(T);
+                mNext  = 0;
+                if (mCount == 0)  return nullptr;
+            }
+            return &mRecords[mNext++];
+        }
+
+    private:
+        TempFile&      mFile;
+        std::vector<T> mRecords;
+        size_t         mCount = 0;
+        size_t         mNext  = 0;
+    };
+
+
+    // Looks up records of type T anywhere in a file, through a direct mapped cache of blocks of the file
+    template <typename T>
+    class RecordCache
+    {
+    public:
+        RecordCache(TempFile& file, size_t cacheBytes)
+            : mFile(file), mNumRecords(file.Size() / sizeof(T))
+        {
+            size_t numBlocks = std::max<size_t>(cacheBytes / (BLOCK_RECORDS * sizeof(T)), 1);
+            mRecords.resize(numBlocks * BLOCK_RECORDS);
+            mBlocks.assign(numBlocks, NO_BLOCK);
+            mFile.Rewind();
+        }
+
+        const T& Get(uint32_t index)
+        {
+            // Indices were checked by the parser, so one out of range means the file was changed
+            if (index >= mNumRecords)  throw std::runtime_error("Temporary file changed during import");
+
+            uint64_t block = index / BLOCK_RECORDS;
+            size_t   slot  = static_cast<size_t>(block % mBlocks.size());
+            T* records = &mRecords[slot * BLOCK_RECORDS];
+            if (mBlocks[slot] != block)
+            {
+                uint64_t first = block * BLOCK_RECORDS;
+                size_t   count = (mNumRecords - first < BLOCK_RECORDS) ? static_cast<size_t>(mNumRecords - first) : BLOCK_RECORDS;
+                mFile.ReadAt(first * sizeof(T), records, count * sizeof(T));
+                mBlocks[slot] = block;
+            }
+            return records[index % BLOCK_RECORDS];
+        }
+
+    private:
+        static constexpr size_t BLOCK_RECORDS = CACHE_BLOCK_BYTES / sizeof(T);
+
+        TempFile&             mFile;
+        uint64_t              mNumRecords;
+        std::vector<T>        mRecords;
+        std::vector<uint64_t> mBlocks;  // Block held in each slot of the cache
+    };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Reading the file
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // A triangle as read from the file: indices of its corners' positions and of the corners themselves (which
+    // give the normal and UV), and the Mesh object it came from
+    struct TriangleRecord
+    {
+        uint32_t positions[3];
+        uint32_t corners[3];
+        uint32_t object;
+    };
+
+    // A triangle with its corners looked up, ready to be split into chunks
+    struct StreamedTriangle
+    {
+        CVector3 positions[3];
+        CVector3 normals[3];   // Zero if the mesh had no normals
+        CVector2 uvs[3];       // Zero if the mesh had no UVs
+        uint32_t object;
+    };
+
+    static_assert(sizeof(TriangleRecord) == 28 && sizeof(StreamedTriangle) == 100, "Temporary file records must have no padding");
+
+
+    // Writes the contents of a .x file to temporary files as StreamXFile reads it: positions, normals, UVs (one
+    // for each position, zero for meshes without), a normal index for each face corner (NO_NORMAL for meshes
+    // without) and the triangles of each face. All indices are for the whole file
+    class StreamingSink : public XFileStreamSink
+    {
+    public:
+        StreamingSink(TempFile& positions, TempFile& normals, TempFile& uvs, TempFile& normalCorners, TempFile& triangles)
+            : mPositions(positions), mNormals(normals), mUVs(uvs), mNormalCorners(normalCorners), mTriangles(triangles) {}
+
+        bool BeginMesh(uint32_t numPositions) override
+        {
+            mFirstPosition = mNumPositions;
+            mFirstCorner   = mNumCorners;
+            mFirstNormal   = mNumNormals;
+            mMeshPositions = numPositions;
+            mHasNormals    = false;
+            mHasUVs        = false;
+            mNumPositions += numPositions;
+            return Fits(mNumPositions);
+        }
+
+        bool Position(const CVector3& position) override
+        {
+            mPositions.Write(&position, sizeof(position));
+            return true;
+        }
+
+        // Split the face into a triangle fan. Degenerate triangles are removed once the positions can be looked up
+        bool Face(const uint32_t* positions, uint32_t numCorners) override
+        {
+            for (uint32_t i = 2; i < numCorners; ++i)
+            {
+                TriangleRecord triangle =
+                {
+                    { static_cast<uint32_t>(mFirstPosition + positions[0]), static_cast<uint32_t>(mFirstPosition + positions[i - 1]),
+                      static_cast<uint32_t>(mFirstPosition + positions[i]) },
+                    { static_cast<uint32_t>(mNumCorners), static_cast<uint32_t>(mNumCorners + i - 1), static_cast<uint32_t>(mNumCorners + i) },
+                    mNumObjects
+                };
+                mTriangles.Write(&triangle, sizeof(triangle));
+                ++numTriangles;
+            }
+            mNumCorners += numCorners;
+            return Fits(mNumCorners);
+        }
+
+        bool BeginNormals(uint32_t numNormals) override
+        {
+            mHasNormals  = true;
+            mNumNormals += numNormals;
+            return Fits(mNumNormals);
+        }
+
+        bool Normal(const CVector3& normal) override
+        {
+            mNormals.Write(&normal, sizeof(normal));
+            return true;
+        }
+
+        bool NormalFace(const uint32_t* normals, uint32_t numCorners) override
+        {
+            for (uint32_t i = 0; i < numCorners; ++i)
+            {
+                uint32_t normal = static_cast<uint32_t>(mFirstNormal + normals[i]);
+                mNormalCorners.Write(&normal, sizeof(normal));
+            }
+            return true;
+        }
+
+        bool UV(const CVector2& uv) override
+        {
+            mHasUVs = true;
+            mUVs.Write(&uv, sizeof(uv));
+            return true;
+        }
+
+        // Fill in the normal indices and UVs of a mesh without them, so the files stay in step
+        bool EndMesh() override
+        {
+            if (!mHasNormals)
+            {
+                for (uint64_t i = mFirstCorner; i < mNumCorners; ++i)  mNormalCorners.Write(&NO_NORMAL, sizeof(NO_NORMAL));
+            }
+            if (!mHasUVs)
+            {
+                const CVector2 zero = { 0, 0 };
+                for (uint32_t i = 0; i < mMeshPositions; ++i)  mUVs.Write(&zero, sizeof(zero));
+            }
+            anyNormals        = anyNormals || mHasNormals;
+            anyMissingNormals = anyMissingNormals || !mHasNormals;
+            anyUVs            = anyUVs || mHasUVs;
+            ++mNumObjects;
+            return Fits(mNumObjects);
+        }
+
+        uint64_t numTriangles      = 0;
+        bool     anyNormals        = false;
+        bool     anyMissingNormals = false;
+        bool     anyUVs            = false;
+        bool     tooLarge          = false;
+
+    private:
+        // Indices are stored in 32 bits, so the file can't have more than 4 billion of anything
+        bool Fits(uint64_t count)
+        {
+            if (count >= NO_NORMAL)  tooLarge = true;
+            return !tooLarge;
+        }
+
+        TempFile& mPositions;
+        TempFile& mNormals;
+        TempFile& mUVs;
+        TempFile& mNormalCorners;
+        TempFile& mTriangles;
+
+        uint64_t mNumPositions  = 0;
+        uint64_t mNumNormals    = 0;
+        uint64_t mNumCorners    = 0;
+        uint32_t mNumObjects    = 0;
+
+        // The current mesh
+        uint64_t mFirstPosition = 0;
+        uint64_t mFirstNormal   = 0;
+        uint64_t mFirstCorner   = 0;
+        uint32_t mMeshPositions = 0;
+        bool     mHasNormals    = false;
+        bool     mHasUVs        = false;
+    };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Importer
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    inline bool SamePosition(const CVector3& a, const CVector3& b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    inline void ExpandBox(CVector3& minimum, CVector3& maximum, const CVector3& p)
+    {
+        minimum.x = std::min(minimum.x, p.x);  maximum.x = std::max(maximum.x, p.x);
+        minimum.y = std::min(minimum.y, p.y);  maximum.y = std::max(maximum.y, p.y);
+        minimum.z = std::min(minimum.z, p.z);  maximum.z = std::max(maximum.z, p.z);
+    }
+
+    inline CVector3 Centroid(const StreamedTriangle& triangle)
+    {
+        return (triangle.positions[0] + triangle.positions[1] + triangle.positions[2]) * (1.0f / 3);
+    }
+
+    // Spread the low 5 bits of a value out to every third bit, for interleaving into a Morton code
+    inline uint32_t SpreadBits(uint32_t value)
+    {
+        uint32_t result = 0;
+        for (uint32_t bit = 0; bit < CELL_BITS; ++bit)  result |= ((value >> bit) & 1) << (3 * bit);
+        return result;
+    }
+
+    // The cell of a grid over a box of triangle centres that a triangle is in, numbered along a Morton curve so
+    // cells next to each other in the order are close in space. cellsPerUnit is the cells per unit of distance
+    uint32_t Cell(const StreamedTriangle& triangle, const CVector3& minCentre, const CVector3& cellsPerUnit)
+    {
+        const uint32_t MAX_CELL = (1u << CELL_BITS) - 1;
+        CVector3 cell = Centroid(triangle) - minCentre;
+        uint32_t x = std::min(static_cast<uint32_t>(std::max(cell.x * cellsPerUnit.x, 0.0f)), MAX_CELL);
+        uint32_t y = std::min(static_cast<uint32_t>(std::max(cell.y * cellsPerUnit.y, 0.0f)), MAX_CELL);
+        uint32_t z = std::min(static_cast<uint32_t>(std::max(cell.z * cellsPerUnit.z, 0.0f)), MAX_CELL);
+        return SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2);
+    }
+
+
+    // The steps of StreamImportMesh, see comment at top of header file
+    class StreamingImporter
+    {
+    public:
+        StreamingImporter(const std::string& fileName, const std::string& streamedFileName, bool requireTangents,
+                          VertexProfile profile, size_t memoryBudget);
+
+        void Import(const MappedFile& sourceFile, uint64_t key);
+
+    private:
+        void ReadFile(const MappedFile& sourceFile);
+        void ResolveTriangles();
+        void Partition(TempFile& file, uint64_t numTriangles, const CVector3& minCentre, const CVector3& maxCentre, int pass);
+        void ImportChunk(StreamedTriangle* triangles, uint32_t numTriangles);
+        bool ImportChunkMesh(StreamedTriangle* triangles, uint32_t numTriangles);
+
+        std::string TempFileName(const std::string& name)  { return mStreamedFileName + "." + name + ".tmp"; }
+
+        std::string   mFileName;
+        std::string   mStreamedFileName;
+        bool          mRequireTangents;
+        VertexProfile mProfile;
+
+        // Shares of the budget
+        size_t   mBufferBytes;          // Each file buffer while reading and resolving, and each batch read
+        size_t   mPartitionBufferBytes; // Each file buffer while splitting into chunks
+        size_t   mCacheBytes;           // Each corner lookup cache
+        uint32_t mChunkTriangles;
+
+        // Temporary files from reading the source file, and the resolved triangles
+        TempFile mPositions;
+        TempFile mNormals;
+        TempFile mUVs;
+        TempFile mNormalCorners;
+        TempFile mTriangles;
+        TempFile mResolved;
+        uint32_t mNextPartition = 0;
+
+        uint64_t mNumTriangles = 0;
+        bool     mAnyNormals        = false;
+        bool     mAnyMissingNormals = false;
+        bool     mAnyUVs            = false;
+        bool     mHalfUVs           = true;  // Half floats are accurate enough for every UV in the mesh
+
+        CVector3 mMinPosition, mMaxPosition; // Of every triangle corner
+        CVector3 mMinCentre,   mMaxCentre;   // Of the centres of the triangles kept
+        CAABB    mBoundingBox;
+        float    mMaxDistanceSq = 0;         // Furthest vertex from the centre of the bounding box
+
+        StreamedMeshWriter            mWriter;
+        std::vector<StreamedTriangle> mChunk;
+    };
+
+
+    StreamingImporter::StreamingImporter(const std::string& fileName, const std::string& streamedFileName, bool requireTangents,
+                                         VertexProfile profile, size_t memoryBudget)
+        : mFileName(fileName), mStreamedFileName(streamedFileName), mRequireTangents(requireTangents), mProfile(profile)
+    {
+        // Each step has about the whole budget: reading the file uses five file buffers and a window of the
+        // mapped file, resolving uses four caches of an eighth of the budget, splitting into chunks a buffer
+        // for each of up to 64 files, and importing a chunk half the budget
+        size_t budget = std::max(memoryBudget, MIN_STREAMING_BUDGET);
+        mBufferBytes          = std::min<size_t>(std::max<size_t>(budget / 64, 64 * 1024), 4 * 1024 * 1024);
+        mPartitionBufferBytes = std::max<size_t>(budget / (4 * MAX_PARTITIONS), 4 * 1024);
+        mCacheBytes           = budget / 8;
+        size_t chunkTriangles = (budget / 2) / CHUNK_BYTES_PER_TRIANGLE;
+        mChunkTriangles = static_cast<uint32_t>(std::min<size_t>(std::max<size_t>(chunkTriangles, MIN_CHUNK_TRIANGLES), MAX_CHUNK_TRIANGLES));
+    }
+
+
+    void StreamingImporter::Import(const MappedFile& sourceFile, uint64_t key)
+    {
+        ReadFile(sourceFile);
+        ResolveTriangles();
+
+        if (!mWriter.Open(mStreamedFileName, key))  throw std::runtime_error("Error creating streamed mesh file for " + mFileName);
+        Partition(mResolved, mNumTriangles, mMinCentre, mMaxCentre, 0);
+        if (!mWriter.Finish(CSphere{ mBoundingBox.centre, std::sqrt(mMaxDistanceSq) }))
+        {
+            throw std::runtime_error("Error writing streamed mesh file for " + mFileName);
+        }
+    }
+
+
+    // Step 1: read the source file into temporary files
+    void StreamingImporter::ReadFile(const MappedFile& sourceFile)
+    {
+        mPositions    .Create(TempFileName("positions"), mBufferBytes);
+        mNormals      .Create(TempFileName("normals"),   mBufferBytes);
+        mUVs          .Create(TempFileName("uvs"),       mBufferBytes);
+        mNormalCorners.Create(TempFileName("corners"),   mBufferBytes);
+        mTriangles    .Create(TempFileName("triangles"), mBufferBytes);
+
+        StreamingSink sink(mPositions, mNormals, mUVs, mNormalCorners, mTriangles);
+        if (!StreamXFile(sourceFile, sink, mCacheBytes))
+        {
+            if (sink.tooLarge)  throw std::runtime_error("Error loading mesh (" + mFileName + "). Too many vertices to import");
+            throw std::runtime_error("Error loading mesh (" + mFileName + "). Not a .x file that can be streamed");
+        }
+        if (sink.numTriangles == 0)  throw std::runtime_error("Error loading mesh (" + mFileName + "). No triangles");
+        if (mRequireTangents && !sink.anyUVs)  throw std::runtime_error("No texture coordinates to calculate tangents in " + mFileName);
+
+        mAnyNormals        = sink.anyNormals;
+        mAnyMissingNormals = sink.anyMissingNormals;
+        mAnyUVs            = sink.anyUVs;
+        mPositions.Close();
+        mNormals.Close();
+        mUVs.Close();
+        mNormalCorners.Close();
+        mTriangles.Close();
+    }
+
+
+    // Step 2: look up the corners of each triangle, removing degenerate triangles. Also finds the bounds and
+    // whether half floats will do for the UVs, which must be the same for every chunk
+    void StreamingImporter::ResolveTriangles()
+    {
+        {
+            RecordCache<CVector3> positions(mPositions, mCacheBytes);
+            RecordCache<CVector3> normals(mNormals, mAnyNormals ? mCacheBytes : 0);
+            RecordCache<uint32_t> normalCorners(mNormalCorners, mAnyNormals ? mCacheBytes : 0);
+            RecordCache<CVector2> uvs(mUVs, mAnyUVs ? mCacheBytes : 0);
+            RecordReader<TriangleRecord> triangles(mTriangles, mBufferBytes);
+            mResolved.Create(TempFileName("resolved"), mBufferBytes);
+
+            const float BIG = 3.402823466e+38f;
+            mMinPosition = mMinCentre = {  BIG,  BIG,  BIG };
+            mMaxPosition = mMaxCentre = { -BIG, -BIG, -BIG };
+            float maxUVError = 0;
+            while (const TriangleRecord* record = triangles.Next())
+            {
+                StreamedTriangle triangle;
+                for (int i = 0; i < 3; ++i)
+                {
+                    triangle.positions[i] = positions.Get(record->positions[i]);
+                    ExpandBox(mMinPosition, mMaxPosition, triangle.positions[i]);
+                }
+                if (SamePosition(triangle.positions[0], triangle.positions[1]) ||
+                    SamePosition(triangle.positions[1], triangle.positions[2]) ||
+                    SamePosition(triangle.positions[2], triangle.positions[0]))  continue;
+
+                for (int i = 0; i < 3; ++i)
+                {
+                    uint32_t normal = mAnyNormals ? normalCorners.Get(record->corners[i]) : NO_NORMAL;
+                    triangle.normals[i] = (normal != NO_NORMAL) ? normals.Get(normal) : CVector3{ 0, 0, 0 };
+                    triangle.uvs[i] = mAnyUVs ? uvs.Get(record->positions[i]) : CVector2{ 0, 0 };
+                    for (float value : { triangle.uvs[i].x, triangle.uvs[i].y })
+                    {
+                        maxUVError = std::max(maxUVError, std::abs(HalfToFloat(FloatToHalf(value)) - value));
+                    }
+                }
+                triangle.object = record->object;
+                ExpandBox(mMinCentre, mMaxCentre, Centroid(triangle));
+
+                mResolved.Write(&triangle, sizeof(triangle));
+                ++mNumTriangles;
+            }
+            mHalfUVs = (maxUVError <= MAX_HALF_UV_ERROR);
+        }
+        mPositions.Remove();
+        mNormals.Remove();
+        mUVs.Remove();
+        mNormalCorners.Remove();
+        mTriangles.Remove();
+        mResolved.Close();
+
+        if (mNumTriangles == 0)  throw std::runtime_error("Error loading mesh (" + mFileName + "). No triangles");
+        mBoundingBox = AABBFromMinMax(mMinPosition, mMaxPosition);
+    }
+
+
+    // Step 3: split the triangles in the given file into chunks, importing each chunk. The file is removed
+    void StreamingImporter::Partition(TempFile& file, uint64_t numTriangles, const CVector3& minCentre, const CVector3& maxCentre, int pass)
+    {
+        // Few enough triangles for one chunk
+        if (numTriangles <= mChunkTriangles)
+        {
+            mChunk.resize(static_cast<size_t>(numTriangles));
+            file.Rewind();
+            if (file.Read(mChunk.data(), mChunk.size() * sizeof(StreamedTriangle)) != mChunk.size() * sizeof(StreamedTriangle))
+            {
+                throw std::runtime_error("Temporary file changed during import");
+            }
+            file.Remove();
+            ImportChunk(mChunk.data(), static_cast<uint32_t>(numTriangles));
+            return;
+        }
+
+        // Count the triangles in each cell, then group cells in Morton order into at most MAX_PARTITIONS groups.
+        // Cells are cubes sized to the longest side of the box, so a flat mesh (e.g. a terrain scan) is split
+        // into patches rather than into layers
+        const float cells = static_cast<float>(1u << CELL_BITS);
+        CVector3 size = maxCentre - minCentre;
+        float longest = std::max(size.x, std::max(size.y, size.z));
+        float perUnit = longest > 0 ? cells / longest : 0;
+        CVector3 cellsPerUnit = { perUnit, perUnit, perUnit };
+        std::vector<uint32_t> cellGroup(NUM_CELLS);
+        std::vector<uint64_t> groupSizes;
+        {
+            std::vector<uint64_t> cellSizes(NUM_CELLS, 0);
+            RecordReader<StreamedTriangle> reader(file, mBufferBytes);
+            while (const StreamedTriangle* triangle = reader.Next())  ++cellSizes[Cell(*triangle, minCentre, cellsPerUnit)];
+
+            uint64_t target = std::max<uint64_t>(mChunkTriangles, (numTriangles + MAX_PARTITIONS / 2 - 1) / (MAX_PARTITIONS / 2));
+            for (uint32_t cell = 0; cell < NUM_CELLS; ++cell)
+            {
+                if (groupSizes.empty() || (groupSizes.back() > 0 && groupSizes.back() + cellSizes[cell] > target))  groupSizes.push_back(0);
+                cellGroup[cell] = static_cast<uint32_t>(groupSizes.size() - 1);
+                groupSizes.back() += cellSizes[cell];
+            }
+            if (groupSizes.back() == 0)  groupSizes.pop_back(); // Trailing empty cells
+        }
+
+        // Triangles that can't be split by position (all their centres are in one cell, e.g. many copies of the
+        // same triangles) are split in the order they are in
+        if (groupSizes.size() <= 1 || pass >= MAX_PARTITION_PASSES)
+        {
+            RecordReader<StreamedTriangle> reader(file, mBufferBytes);
+            mChunk.clear();
+            while (const StreamedTriangle* triangle = reader.Next())
+            {
+                mChunk.push_back(*triangle);
+                if (mChunk.size() == mChunkTriangles)
+                {
+                    ImportChunk(mChunk.data(), mChunkTriangles);
+                    mChunk.clear();
+                }
+            }
+            if (!mChunk.empty())  ImportChunk(mChunk.data(), static_cast<uint32_t>(mChunk.size()));
+            file.Remove();
+            return;
+        }
+
+        // Write each group to its own file, finding the bounds of its triangle centres
+        std::vector<TempFile> groups(groupSizes.size());
+        std::vector<CVector3> minCentres(groupSizes.size(), maxCentre);
+        std::vector<CVector3> maxCentres(groupSizes.size(), minCentre);
+        for (TempFile& group : groups)  group.Create(TempFileName("part" + std::to_string(mNextPartition++)), mPartitionBufferBytes);
+        {
+            RecordReader<StreamedTriangle> reader(file, mBufferBytes);
+            while (const StreamedTriangle* triangle = reader.Next())
+            {
+                uint32_t group = cellGroup[Cell(*triangle, minCentre, cellsPerUnit)];
+                groups[group].Write(triangle, sizeof(StreamedTriangle));
+                ExpandBox(minCentres[group], maxCentres[group], Centroid(*triangle));
+            }
+        }
+        for (TempFile& group : groups)  group.Close();
+        file.Remove();
+        cellGroup = std::vector<uint32_t>();
+
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            Partition(groups[i], groupSizes[i], minCentres[i], maxCentres[i], pass + 1);
+        }
+    }
+
+
+    // Step 4: import a chunk and write it to the streamed mesh. A chunk whose vertices don't fit 16-bit indices
+    // (only possible if few vertices are shared) is split in two across its longest side
+    void StreamingImporter::ImportChunk(StreamedTriangle* triangles, uint32_t numTriangles)
+    {
+        if (ImportChunkMesh(triangles, numTriangles))  return;
+
+        CVector3 minCentre = Centroid(triangles[0]);
+        CVector3 maxCentre = minCentre;
+        for (uint32_t i = 1; i < numTriangles; ++i)  ExpandBox(minCentre, maxCentre, Centroid(triangles[i]));
+        CVector3 size = maxCentre - minCentre;
+        int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+        auto AxisCentre = [axis](const StreamedTriangle& triangle)
+        {
+            CVector3 centre = Centroid(triangle);
+            return axis == 0 ? centre.x : (axis == 1 ? centre.y : centre.z);
+        };
+
+        uint32_t half = numTriangles / 2;
+        std::nth_element(triangles, triangles + half, triangles + numTriangles,
+                         [&](const StreamedTriangle& a, const StreamedTriangle& b) { return AxisCentre(a) < AxisCentre(b); });
+        ImportChunk(triangles, half);
+        ImportChunk(triangles + half, numTriangles - half);
+    }
+
+
+    // Import a chunk as ImportMesh does, with a sub-mesh for each Mesh object in the file. Returns false, doing
+    // nothing, if a sub-mesh has more vertices than 16-bit indices can use
+    bool StreamingImporter::ImportChunkMesh(StreamedTriangle* triangles, uint32_t numTriangles)
+    {
+        auto ByObject = [](const StreamedTriangle& a, const StreamedTriangle& b) { return a.object < b.object; };
+        if (!std::is_sorted(triangles, triangles + numTriangles, ByObject))  std::stable_sort(triangles, triangles + numTriangles, ByObject);
+
+        // A vertex for every corner to begin with, in the layout LoadXFile uses
+        MeshData mesh;
+        uint32_t positionOffset = mesh.AddElement("Position", VertexFormat::Float3);
+        uint32_t normalOffset   = mesh.AddElement("Normal",   VertexFormat::Float3);
+        uint32_t uvOffset       = mAnyUVs ? mesh.AddElement("UV", VertexFormat::Float2) : 0;
+        mesh.numVertices = numTriangles * 3;
+        mesh.vertices.resize(static_cast<size_t>(mesh.numVertices) * mesh.vertexSize);
+        mesh.indices.resize(mesh.numVertices);
+        for (uint32_t t = 0; t < numTriangles; ++t)
+        {
+            if (t == 0 || triangles[t].object != triangles[t - 1].object)
+            {
+                SubMesh subMesh = { t * 3, 0, t * 3, 0 };
+                mesh.subMeshes.push_back(subMesh);
+            }
+            SubMesh& subMesh = mesh.subMeshes.back();
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                uint32_t vertex = t * 3 + i;
+                unsigned char* v = mesh.vertices.data() + static_cast<size_t>(vertex) * mesh.vertexSize;
+                *(CVector3*)(v + positionOffset) = triangles[t].positions[i];
+                *(CVector3*)(v + normalOffset)   = triangles[t].normals[i];
+                if (mAnyUVs)  *(CVector2*)(v + uvOffset) = triangles[t].uvs[i];
+                mesh.indices[vertex] = vertex - subMesh.baseVertex;
+            }
+            subMesh.numIndices  += 3;
+            subMesh.numVertices += 3;
+        }
+
+        WeldVertices(mesh);
+        for (const SubMesh& subMesh : mesh.subMeshes)
+        {
+            if (subMesh.numVertices > 65536)  return false;
+        }
+
+        // The same steps as ImportMesh, except meshlets. Levels of detail keep the chunk's border in place so
+        // neighbouring chunks still meet
+        if (mAnyMissingNormals)  GenerateSmoothNormals(mesh, MAX_SMOOTHING_ANGLE, false);
+        if (mRequireTangents && !GenerateTangents(mesh))  throw std::runtime_error("No texture coordinates to calculate tangents in " + mFileName);
+        OptimiseMesh(mesh);
+        GenerateLODs(mesh, MAX_MESH_LODS, 0.5f, true);
+
+        // Every chunk is packed against the whole mesh's bounding box, and with the UV format chosen for the
+        // whole mesh, so their vertices go together
+        const unsigned char* position = mesh.vertices.data() + positionOffset;
+        for (uint32_t i = 0; i < mesh.numVertices; ++i, position += mesh.vertexSize)
+        {
+            CVector3 toVertex = *(const CVector3*)position - mBoundingBox.centre;
+            mMaxDistanceSq = std::max(mMaxDistanceSq, Dot(toVertex, toVertex));
+        }
+        mesh.boundingBox = mBoundingBox;
+        PackedMesh packed = PackMesh(mesh.View(), mProfile, nullptr, mHalfUVs);
+        if (!mWriter.AddChunk(packed.View()))  throw std::runtime_error("Error writing streamed mesh file for " + mFileName);
+        return true;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Streaming import
+-----------------------------------------------------------------------------------------*/
+
+// Import the given .x file, already mapped, into a streamed mesh file with the given key, using no more than
+// about memoryBudget bytes of memory. Throws a std::runtime_error on failure
+void StreamImportMesh(const std::string& fileName, const MappedFile& sourceFile, const std::string& streamedFileName,
+                      uint64_t key, bool requireTangents, VertexProfile profile, size_t memoryBudget)
+{
+    StreamingImporter importer(fileName, streamedFileName, requireTangents, profile, memoryBudget);
+    importer.Import(sourceFile, key);
+}
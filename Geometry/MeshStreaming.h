@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// Streaming import - importing meshes too large to hold in memory
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// ImportMesh (MeshImport.h) holds the whole mesh in memory several times over while it works on it, which is
+// fine for a prop or a character but not for a scan of hundreds of millions of triangles. StreamImportMesh
+// gives the same kind of result working within a memory budget, however large the file, by keeping the mesh in
+// temporary files on disk and only ever loading a chunk of it:
+//
+//  1. The .x file is read with StreamXFile (XFile.h), which releases the parts of the mapped file it has read.
+//     The positions, normals, UVs and the triangles (as indices into those) are written to temporary files
+//  2. The triangles are read back in order and their corners looked up, through a cache of blocks of the
+//     other files (faces nearly always use nearby vertices), giving a file of triangles holding their own
+//     positions, normals and UVs. Triangles with two corners in the same place are removed, as LoadXFile does
+//  3. The triangles are split into chunks of neighbouring triangles: each pass counts the triangles in a grid
+//     of cells along a Morton (Z-order) curve, then writes them out to one file per group of cells, and groups
+//     with too many triangles for a chunk are split again the same way
+//  4. Each chunk is loaded and imported as ImportMesh would - welded (MeshProcessing.h), given normals if the
+//     file had none and tangents if requested, optimised (MeshOptimiser.h), given levels of detail
+//     (MeshSimplifier.h) and packed (VertexPacking.h) - then written to a streamed mesh file (StreamedMesh.h)
+//
+// The budget sets the size of the chunks, the caches and the file buffers, and how much of the source file is
+// kept mapped. Memory use doesn't depend on the size of the file, except for the streamed mesh's tables (a few
+// bytes for each chunk). The Mesh class then fills its GPU buffers from the streamed mesh one chunk at a time.
+//
+// Chunks are imported on their own, so where they meet:
+//  - Levels of detail don't move the vertices on a chunk's border, so the chunks still meet without cracks
+//  - Normals calculated for a file that had none, and tangents, are averaged only over the triangles in the
+//    chunk, so they may change slightly across a chunk border
+//  - Vertices are not shared between chunks, and each chunk is one or more draw calls
+// Streamed meshes have no meshlets. Only .x files the native reader handles can be streamed.
+
+#ifndef _MESH_STREAMING_H_INCLUDED_
+#define _MESH_STREAMING_H_INCLUDED_
+
+#include "VertexPacking.h"
+#include "MappedFile.h"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+// Smallest memory budget StreamImportMesh works within, smaller budgets are raised to this
+const size_t MIN_STREAMING_BUDGET = 16 * 1024 * 1024;
+
+// Most triangles in a chunk, a larger budget doesn't make chunks larger than this
+const uint32_t MAX_CHUNK_TRIANGLES = 65536;
+
+
+// Import the given .x file, already mapped, into a streamed mesh file (StreamedMesh.h) with the given key,
+// using no more than about memoryBudget bytes of memory. Temporary files are written next to the streamed mesh
+// file and removed before returning. The file name is used in error messages. Throws a std::runtime_error on
+// failure, which leaves no streamed mesh file
+void StreamImportMesh(const std::string& fileName, const MappedFile& sourceFile, const std::string& streamedFileName,
+                      uint64_t key, bool requireTangents, VertexProfile profile, size_t memoryBudget);
+
+
+#endif //_MESH_STREAMING_H_INCLUDED_
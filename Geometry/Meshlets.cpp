@@ -0,0 +1,304 @@
+//--------------------------------------------------------------------------------------
+// Meshlets - small clusters of triangles that can be culled separately
+//--------------------------------------------------------------------------------------
+
+#include "Meshlets.h"
+#include "MeshOptimiser.h"
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    // Position of a vertex of a sub-mesh
+    CVector3 VertexPosition(const MeshData& mesh, uint32_t positionOffset, const SubMesh& subMesh, uint32_t index)
+    {
+        CVector3 p;
+        std::memcpy(&p, &mesh.vertices[static_cast<size_t>(subMesh.baseVertex + index) * mesh.vertexSize + positionOffset], sizeof(p));
+        return p;
+    }
+
+
+    // Calculate the bounding sphere and normal cone of a meshlet whose index range is set. The sphere is
+    // centred on the box around the vertices, as in CalculateBounds. The cone's axis is the average of the
+    // triangles' unit normals, and if any triangle faces at 90 degrees or more from it the meshlet can't be
+    // culled by direction
+    void CalculateMeshletBounds(const MeshData& mesh, uint32_t positionOffset, Meshlet& meshlet)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[meshlet.subMesh];
+        const uint32_t* indices = mesh.indices.data() + meshlet.startIndex;
+
+        CVector3 minPosition = VertexPosition(mesh, positionOffset, subMesh, indices[0]);
+        CVector3 maxPosition = minPosition;
+        for (uint32_t i = 1; i < meshlet.numIndices; ++i)
+        {
+            CVector3 p = VertexPosition(mesh, positionOffset, subMesh, indices[i]);
+            minPosition = { std::min(minPosition.x, p.x), std::min(minPosition.y, p.y), std::min(minPosition.z, p.z) };
+            maxPosition = { std::max(maxPosition.x, p.x), std::max(maxPosition.y, p.y), std::max(maxPosition.z, p.z) };
+        }
+        meshlet.centre = (minPosition + maxPosition) * 0.5f;
+        float radiusSquared = 0;
+        for (uint32_t i = 0; i < meshlet.numIndices; ++i)
+        {
+            CVector3 offset = VertexPosition(mesh, positionOffset, subMesh, indices[i]) - meshlet.centre;
+            radiusSquared = std::max(radiusSquared, Dot(offset, offset));
+        }
+        meshlet.radius = std::sqrt(radiusSquared);
+
+        // Triangles with no area face no direction and are left out
+        std::vector<CVector3> normals;
+        normals.reserve(meshlet.numIndices / 3);
+        CVector3 normalSum = { 0, 0, 0 };
+        for (uint32_t i = 0; i + 2 < meshlet.numIndices; i += 3)
+        {
+            CVector3 p0 = VertexPosition(mesh, positionOffset, subMesh, indices[i]);
+            CVector3 normal = Cross(VertexPosition(mesh, positionOffset, subMesh, indices[i + 1]) - p0,
+                                    VertexPosition(mesh, positionOffset, subMesh, indices[i + 2]) - p0);
+            float length = Length(normal);
+            if (length <= 0)  continue;
+            normals.push_back(normal * (1 / length));
+            normalSum += normals.back();
+        }
+
+        float sumLength = Length(normalSum);
+        meshlet.coneAxis   = (sumLength > 0) ? normalSum * (1 / sumLength) : CVector3{ 0, 0, 1 };
+        meshlet.coneCutoff = 1;
+        if (sumLength <= 0 || normals.empty())  return;
+        float minDot = 1;
+        for (const CVector3& normal : normals)  minDot = std::min(minDot, Dot(normal, meshlet.coneAxis));
+        if (minDot > 0)  meshlet.coneCutoff = std::sqrt(1 - minDot * minDot);
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Building meshlets
+-----------------------------------------------------------------------------------------*/
+
+// Split the full detail mesh into meshlets, see comment at top of header file
+void BuildMeshlets(MeshData& mesh)
+{
+    mesh.meshlets.clear();
+    const VertexElement* position = FindElement(mesh.View(), "Position");
+    if (position == nullptr || position->format != VertexFormat::Float3)  return;
+
+    const uint32_t numParts = mesh.lods.empty() ? static_cast<uint32_t>(mesh.subMeshes.size()) : mesh.lods[0].numSubMeshes;
+    uint32_t numTriangles = 0;
+    for (uint32_t p = 0; p < numParts; ++p)  numTriangles += mesh.subMeshes[p].numIndices / 3;
+    if (numTriangles < MIN_MESHLET_MESH_TRIANGLES)  return;
+
+    const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    for (uint32_t p = 0; p < numParts; ++p)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[p];
+        const uint32_t numPartTriangles = subMesh.numIndices / 3;
+        if (numPartTriangles == 0)  continue;
+        const uint32_t* partIndices = &mesh.indices[subMesh.startIndex];
+
+        // Triangles using each vertex, as offsets into one list
+        std::vector<uint32_t> vertexStart(subMesh.numVertices + 1, 0);
+        for (uint32_t i = 0; i < numPartTriangles * 3; ++i)  ++vertexStart[partIndices[i] + 1];
+        for (uint32_t v = 0; v < subMesh.numVertices; ++v)  vertexStart[v + 1] += vertexStart[v];
+        std::vector<uint32_t> vertexTriangles(numPartTriangles * 3);
+        std::vector<uint32_t> fill(vertexStart.begin(), vertexStart.end() - 1);
+        for (uint32_t i = 0; i < numPartTriangles * 3; ++i)  vertexTriangles[fill[partIndices[i]]++] = i / 3;
+
+        std::vector<CVector3> normals(numPartTriangles);
+        for (uint32_t t = 0; t < numPartTriangles; ++t)
+        {
+            CVector3 p0 = VertexPosition(mesh, position->offset, subMesh, partIndices[t * 3]);
+            CVector3 normal = Cross(VertexPosition(mesh, position->offset, subMesh, partIndices[t * 3 + 1]) - p0,
+                                    VertexPosition(mesh, position->offset, subMesh, partIndices[t * 3 + 2]) - p0);
+            float length = Length(normal);
+            normals[t] = (length > 0) ? normal * (1 / length) : CVector3{ 0, 0, 0 };
+        }
+
+        // Grow each meshlet from the first unused triangle in the optimised order. The next triangle is the
+        // neighbour that adds the fewest new vertices, less a bonus for facing the way the meshlet already
+        // faces, which keeps the normal cones narrow. When no neighbour fits the next unused triangle in order
+        // is taken, it is usually close by. Each vertex is marked with the number of the meshlet that last used it
+        std::vector<uint32_t> vertexMeshlet(subMesh.numVertices, NONE);
+        std::vector<bool>     used(numPartTriangles, false);
+        std::vector<uint32_t> order;       // Triangles in meshlet order
+        std::vector<uint32_t> candidates;  // Unused triangles next to the current meshlet
+        order.reserve(numPartTriangles);
+        uint32_t nextInOrder = 0;
+        uint32_t meshletNumber = static_cast<uint32_t>(mesh.meshlets.size());
+        while (order.size() < numPartTriangles)
+        {
+            Meshlet meshlet = {};
+            meshlet.subMesh    = p;
+            meshlet.startIndex = subMesh.startIndex + static_cast<uint32_t>(order.size()) * 3;
+            CVector3 normalSum = { 0, 0, 0 };
+            candidates.clear();
+
+            uint32_t triangle = NONE;
+            while (meshlet.numIndices < MAX_MESHLET_TRIANGLES * 3)
+            {
+                // Choose the best neighbour, dropping used ones from the candidates as they are found
+                triangle = NONE;
+                float bestScore = std::numeric_limits<float>::max();
+                CVector3 averageNormal = normalSum * (1 / std::max(Length(normalSum), 1e-20f));
+                for (size_t c = 0; c < candidates.size(); )
+                {
+                    uint32_t t = candidates[c];
+                    if (used[t])
+                    {
+                        candidates[c] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+                    ++c;
+                    uint32_t newVertices = 0;
+                    for (int v = 0; v < 3; ++v)  newVertices += (vertexMeshlet[partIndices[t * 3 + v]] != meshletNumber) ? 1 : 0;
+                    if (meshlet.numVertices + newVertices > MAX_MESHLET_VERTICES)  continue;
+                    float score = newVertices - 4 * Dot(normals[t], averageNormal);
+                    if (score < bestScore)
+                    {
+                        bestScore = score;
+                        triangle = t;
+                    }
+                }
+                if (triangle == NONE)
+                {
+                    while (nextInOrder < numPartTriangles && used[nextInOrder])  ++nextInOrder;
+                    if (nextInOrder == numPartTriangles || meshlet.numVertices + 3 > MAX_MESHLET_VERTICES)  break;
+                    triangle = nextInOrder;
+                }
+
+                used[triangle] = true;
+                order.push_back(triangle);
+                meshlet.numIndices += 3;
+                normalSum += normals[triangle];
+                for (int v = 0; v < 3; ++v)
+                {
+                    uint32_t vertex = partIndices[triangle * 3 + v];
+                    if (vertexMeshlet[vertex] == meshletNumber)  continue;
+                    vertexMeshlet[vertex] = meshletNumber;
+                    ++meshlet.numVertices;
+                    for (uint32_t a = vertexStart[vertex]; a < vertexStart[vertex + 1]; ++a)
+                    {
+                        if (!used[vertexTriangles[a]])  candidates.push_back(vertexTriangles[a]);
+                    }
+                }
+            }
+            mesh.meshlets.push_back(meshlet);
+            ++meshletNumber;
+        }
+
+        // Write the triangles in meshlet order, then the bounds can be calculated from the index ranges
+        std::vector<uint32_t> reordered(numPartTriangles * 3);
+        for (uint32_t t = 0; t < numPartTriangles; ++t)
+        {
+            for (int v = 0; v < 3; ++v)  reordered[t * 3 + v] = partIndices[order[t] * 3 + v];
+        }
+        std::copy(reordered.begin(), reordered.end(), mesh.indices.begin() + subMesh.startIndex);
+    }
+
+    // Growing a meshlet jumps between the edges of the area it covers, so reorder each one for the vertex cache.
+    // The meshlet's vertices are numbered from 0 so the optimiser only works on a few of them
+    std::vector<uint32_t> localVertices;
+    std::vector<uint32_t> localIndices;
+    std::vector<uint32_t> vertexLocal;
+    for (Meshlet& meshlet : mesh.meshlets)
+    {
+        const SubMesh& subMesh = mesh.subMeshes[meshlet.subMesh];
+        uint32_t* indices = &mesh.indices[meshlet.startIndex];
+        vertexLocal.resize(std::max<size_t>(vertexLocal.size(), subMesh.numVertices), NONE);
+        localVertices.clear();
+        localIndices.resize(meshlet.numIndices);
+        for (uint32_t i = 0; i < meshlet.numIndices; ++i)
+        {
+            uint32_t& local = vertexLocal[indices[i]];
+            if (local == NONE)
+            {
+                local = static_cast<uint32_t>(localVertices.size());
+                localVertices.push_back(indices[i]);
+            }
+            localIndices[i] = local;
+        }
+        OptimiseVertexCache(localIndices.data(), meshlet.numIndices, static_cast<uint32_t>(localVertices.size()));
+        for (uint32_t i = 0; i < meshlet.numIndices; ++i)  indices[i] = localVertices[localIndices[i]];
+        for (uint32_t vertex : localVertices)  vertexLocal[vertex] = NONE;
+
+        CalculateMeshletBounds(mesh, position->offset, meshlet);
+    }
+
+    // Put the vertices back in the order the new triangles first use them. LODs share the full detail
+    // vertices, so if there are any already the vertices are left where they are
+    if (mesh.lods.empty())  OptimiseVertexFetch(mesh);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Culling meshlets
+-----------------------------------------------------------------------------------------*/
+
+// Copy the meshlets and full detail indices of the mesh
+void MeshletCuller::Init(const MeshDataView& mesh)
+{
+    *this = MeshletCuller();
+    if (mesh.numMeshlets == 0)  return;
+
+    mMeshlets.assign(mesh.meshlets, mesh.meshlets + mesh.numMeshlets);
+    const uint32_t numParts = (mesh.numLODs > 0) ? mesh.lods[0].numSubMeshes : mesh.numSubMeshes;
+    mSubMeshes.assign(mesh.subMeshes, mesh.subMeshes + numParts);
+
+    uint32_t numIndices = 0;
+    for (const SubMesh& subMesh : mSubMeshes)  numIndices = std::max(numIndices, subMesh.startIndex + subMesh.numIndices);
+    mIndexSize = mesh.indexSize;
+    const unsigned char* indices = static_cast<const unsigned char*>(mesh.indices);
+    mIndices.assign(indices, indices + static_cast<size_t>(numIndices) * mIndexSize);
+
+    for (const Meshlet& meshlet : mMeshlets)
+    {
+        mCentreX.push_back(meshlet.centre.x);
+        mCentreY.push_back(meshlet.centre.y);
+        mCentreZ.push_back(meshlet.centre.z);
+        mRadius .push_back(meshlet.radius);
+    }
+    mVisible.resize(mMeshlets.size());
+    mCulledIndices.resize(mIndices.size());
+    mCulledSubMeshes = mSubMeshes;
+}
+
+
+// Cull the meshlets against a model space frustum and camera position. The meshlets are in sub-mesh order, so
+// the visible ones are written to the index list a sub-mesh at a time
+uint32_t MeshletCuller::Cull(const CFrustum& frustum, const CVector3& cameraPosition, FaceCulling faceCulling)
+{
+    uint32_t numInFrustum = CullSpheres(frustum, mCentreX.data(), mCentreY.data(), mCentreZ.data(), mRadius.data(),
+                                        static_cast<unsigned int>(mMeshlets.size()), mVisible.data());
+
+    // A meshlet faces away from the camera when the camera is behind the cone of its normals by more than its
+    // radius. Front face culling uses the cone facing the other way
+    const float direction = (faceCulling == FaceCulling::Front) ? -1.0f : 1.0f;
+    uint32_t numIndices = 0;
+    uint32_t part = 0;
+    mCulledSubMeshes[0].startIndex = 0;
+    for (SubMesh& subMesh : mCulledSubMeshes)  subMesh.numIndices = 0;
+    mNumVisible = 0;
+    for (uint32_t i = 0; i < numInFrustum; ++i)
+    {
+        const Meshlet& meshlet = mMeshlets[mVisible[i]];
+        if (faceCulling != FaceCulling::None && meshlet.coneCutoff < 1)
+        {
+            CVector3 toCentre = meshlet.centre - cameraPosition;
+            if (direction * Dot(toCentre, meshlet.coneAxis) >= meshlet.coneCutoff * Length(toCentre) + meshlet.radius)  continue;
+        }
+
+        while (part < meshlet.subMesh)  mCulledSubMeshes[++part].startIndex = numIndices;
+        std::memcpy(&mCulledIndices[static_cast<size_t>(numIndices) * mIndexSize], &mIndices[static_cast<size_t>(meshlet.startIndex) * mIndexSize],
+                    static_cast<size_t>(meshlet.numIndices) * mIndexSize);
+        numIndices += meshlet.numIndices;
+        mCulledSubMeshes[part].numIndices += meshlet.numIndices;
+        ++mNumVisible;
+    }
+    while (part + 1 < mCulledSubMeshes.size())  mCulledSubMeshes[++part].startIndex = numIndices;
+
+    mNumCulledIndices = numIndices;
+    return numIndices / 3;
+}
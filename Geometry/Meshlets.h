@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------------------
+// Meshlets - small clusters of triangles that can be culled separately
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A mesh is drawn as a whole, so frustum culling can only remove all of it or none of it. A large mesh such
+// as a terrain is nearly always partly visible, and about half of any closed mesh faces away from the camera,
+// but every one of its triangles is still sent to the GPU. BuildMeshlets splits the full detail mesh into
+// meshlets of at most MAX_MESHLET_VERTICES vertices and MAX_MESHLET_TRIANGLES triangles, each with:
+//  - A bounding sphere, tested against the view frustum
+//  - A normal cone, the average direction its triangles face and how far they spread from it. When the
+//    camera is inside the cone's "back side" every triangle faces away and the whole meshlet can be skipped
+//    (the cone test from meshoptimizer, which doesn't need the cone's apex)
+//
+// Each meshlet is a range of consecutive triangles in the index buffer. A meshlet grows from a seed triangle
+// by adding the neighbouring triangle that adds the fewest new vertices and faces most nearly the way the
+// meshlet already does, so meshlets are compact and their cones narrow. The triangles of each part are
+// rewritten in meshlet order, then each meshlet is reordered for the vertex cache and the vertices for fetching
+// (MeshOptimiser.h). Meshlets cost some vertex cache hits, as the vertices on their edges are loaded by each
+// meshlet that uses them.
+//
+// MeshletCuller culls the meshlets of a mesh for a view on the CPU and writes the indices of the visible
+// ones to a single index list, with a draw range for each part of the mesh, ready to copy to a dynamic index
+// buffer (see Mesh::Render). The culling runs in model space: the frustum is taken from the world matrix
+// times the view-projection matrix and the camera is moved into model space. An affine transform doesn't
+// change which way a triangle faces relative to a point, so the cone test is exact for any scaling.
+
+#ifndef _MESHLETS_H_INCLUDED_
+#define _MESHLETS_H_INCLUDED_
+
+#include "MeshData.h"
+#include "BoundingVolumes.h"
+
+#include <vector>
+#include <cstdint>
+
+
+// Meshlet size limits, as used by mesh shaders on current GPUs
+const uint32_t MAX_MESHLET_VERTICES  = 64;
+const uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+// Meshes with fewer triangles than this are not split into meshlets, culling them would cost more than
+// drawing them whole
+const uint32_t MIN_MESHLET_MESH_TRIANGLES = 1024;
+
+
+// Which triangles the rasteriser removes, matching the rasteriser state the mesh is drawn with. Meshlets
+// facing the culled way are removed too. Triangles are front facing when their corners are clockwise on screen
+// (the DirectX default)
+enum class FaceCulling
+{
+    None,
+    Back,
+    Front,
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Building meshlets
+-----------------------------------------------------------------------------------------*/
+
+// Split the full detail mesh (LOD 0) into meshlets, see comment at top of file. Replaces any meshlets the
+// mesh already has and reorders the triangles and vertices of each full detail part. Does nothing if the mesh
+// is too small or has no Float3 "Position" element. Call after OptimiseMesh and before GenerateLODs
+void BuildMeshlets(MeshData& mesh);
+
+
+/*-----------------------------------------------------------------------------------------
+    Culling meshlets
+-----------------------------------------------------------------------------------------*/
+
+class MeshletCuller
+{
+public:
+    // Copy the meshlets and full detail indices of the mesh (the view may be of a file that is later closed).
+    // Leaves the culler empty if the mesh has no meshlets
+    void Init(const MeshDataView& mesh);
+
+    bool Empty() const  { return mMeshlets.empty(); }
+
+    // Cull the meshlets against a model space frustum and camera position, with faces culled the given way.
+    // Fills the index list and draw ranges below. Returns the number of triangles left
+    uint32_t Cull(const CFrustum& frustum, const CVector3& cameraPosition, FaceCulling faceCulling);
+
+    // Results of the last Cull: the indices of the visible meshlets (IndexSize() bytes each) and a range of
+    // them for each part of the mesh, using the same base vertices as the full detail sub-meshes
+    const void*                 Indices() const     { return mCulledIndices.data(); }
+    uint32_t                    NumIndices() const  { return mNumCulledIndices; }
+    const std::vector<SubMesh>& SubMeshes() const   { return mCulledSubMeshes; }
+
+    uint32_t IndexSize() const        { return mIndexSize; }
+    uint32_t NumMeshlets() const      { return static_cast<uint32_t>(mMeshlets.size()); }
+    uint32_t NumVisibleMeshlets() const { return mNumVisible; }
+
+    // Number of full detail indices, the most Cull can give
+    uint32_t MaxIndices() const  { return static_cast<uint32_t>(mIndices.size() / mIndexSize); }
+
+
+private:
+    // Meshlet bounding spheres in structure-of-arrays form for CullSpheres (BoundingVolumes.h)
+    std::vector<float>         mCentreX;
+    std::vector<float>         mCentreY;
+    std::vector<float>         mCentreZ;
+    std::vector<float>         mRadius;
+
+    std::vector<Meshlet>       mMeshlets;
+    std::vector<SubMesh>       mSubMeshes;  // The full detail parts
+    std::vector<unsigned char> mIndices;    // The mesh's indices, up to the end of the full detail parts
+    uint32_t                   mIndexSize = 4;
+
+    std::vector<unsigned int>  mVisible;
+    uint32_t                   mNumVisible = 0;
+    std::vector<unsigned char> mCulledIndices;
+    uint32_t                   mNumCulledIndices = 0;
+    std::vector<SubMesh>       mCulledSubMeshes;
+};
+
+
+#endif //_MESHLETS_H_INCLUDED_
@@ -0,0 +1,631 @@
+//--------------------------------------------------------------------------------------
+// Streamed mesh files - cooked meshes stored in chunks, for meshes too large to hold in memory
+//--------------------------------------------------------------------------------------
+
+#include "StreamedMesh.h"
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+
+/*-----------------------------------------------------------------------------------------
+    File format
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    const char STREAMED_MESH_MAGIC[4] = { 'S', 'M', 'S', 'H' };
+
+    // All sections of the file start on this boundary
+    const uint64_t SECTION_ALIGNMENT = 16;
+
+    // The header is followed by the chunks, each its compressed vertices, indices, depth vertices and depth
+    // indices in that order, then the tables (written last, once every chunk is known)
+    struct StreamedMeshHeader
+    {
+        char     magic[4];       // STREAMED_MESH_MAGIC
+        uint32_t version;        // STREAMED_MESH_VERSION
+        uint64_t key;            // Given by the importer, see CookedMesh.h
+        uint64_t fileSize;       // Size of the whole file, catches truncated files
+
+        uint32_t numElements;
+        uint32_t numSubMeshes;   // Also the number of parts
+        uint32_t numLODs;
+        uint32_t numChunks;
+
+        uint32_t numVertices;
+        uint32_t vertexSize;
+        uint32_t numIndices;
+        uint32_t indexSize;
+
+        uint32_t numDepthVertices;
+        uint32_t depthVertexSize;
+        uint32_t depthIndexSize;
+        uint32_t unused;
+
+        float    boxCentre[3];
+        float    boxHalfSize[3];
+        float    sphereCentre[3];
+        float    sphereRadius;
+
+        // Offsets of the tables from the start of the file
+        uint64_t elementsOffset;
+        uint64_t subMeshesOffset;
+        uint64_t partsOffset;
+        uint64_t lodsOffset;
+        uint64_t chunksOffset;
+    };
+
+    // Each chunk's entry in the chunk table, matches StreamedMesh::Chunk
+    struct ChunkRecord
+    {
+        uint64_t offset;
+        uint32_t firstVertex;
+        uint32_t numVertices;
+        uint32_t firstDepthVertex;
+        uint32_t numDepthVertices;
+        uint32_t numIndices;
+        uint32_t storedSizes[4];
+        uint32_t unused;
+    };
+
+    // Each sub-mesh's entry in the part table, matches StreamedMesh::Part
+    struct PartRecord
+    {
+        uint32_t chunk;
+        uint32_t sourceIndex;
+    };
+
+    static_assert(sizeof(StreamedMeshHeader) == 152, "Streamed mesh header must have no padding");
+    static_assert(sizeof(ChunkRecord) == 48 && sizeof(PartRecord) == 8, "Streamed mesh tables must have no padding");
+
+    uint64_t AlignSection(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+
+    // Write size bytes then pad the file up to the next section boundary
+    bool WriteSection(FILE* file, const void* data, uint64_t size, uint64_t& offset)
+    {
+        if (size > 0 && std::fwrite(data, 1, static_cast<size_t>(size), file) != size)  return false;
+        offset += size;
+
+        static const unsigned char zeros[SECTION_ALIGNMENT] = {};
+        uint64_t padding = AlignSection(offset) - offset;
+        if (padding > 0 && std::fwrite(zeros, 1, static_cast<size_t>(padding), file) != padding)  return false;
+        offset += padding;
+        return true;
+    }
+
+    // Move to the given offset, which may be past 4GB
+    bool SeekFile(FILE* file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    // Size of an open file, leaving the position at the end
+    bool FileSize(FILE* file, uint64_t& size)
+    {
+#ifdef _WIN32
+        if (_fseeki64(file, 0, SEEK_END) != 0)  return false;
+        __int64 end = _ftelli64(file);
+#else
+        if (fseeko(file, 0, SEEK_END) != 0)  return false;
+        off_t end = ftello(file);
+#endif
+        if (end < 0)  return false;
+        size = static_cast<uint64_t>(end);
+        return true;
+    }
+
+    // Read count items of type T from the given offset into a vector
+    template <typename T>
+    bool ReadTable(FILE* file, uint64_t offset, uint32_t count, std::vector<T>& table)
+    {
+        table.resize(count);
+        return count == 0 || (SeekFile(file, offset) && std::fread(table.data(), sizeof(T), count, file) == count);
+    }
+
+    // Check a table of count items of the given size lies within the file and is aligned
+    bool SectionValid(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+    {
+        return offset % SECTION_ALIGNMENT == 0 && offset <= fileSize && count * size <= fileSize - offset;
+    }
+
+    // The element describing the depth stream's vertices, the position element moved to the start of the vertex
+    VertexElement DepthElement(const VertexElement& position)
+    {
+        VertexElement element = position;
+        element.offset = 0;
+        return element;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Writing
+-----------------------------------------------------------------------------------------*/
+
+StreamedMeshWriter::~StreamedMeshWriter()
+{
+    Abort();
+}
+
+
+// Start writing the file with the given key. Returns false if it can't be created
+bool StreamedMeshWriter::Open(const std::string& fileName, uint64_t key)
+{
+    Abort();
+    mFileName     = fileName;
+    mTempFileName = fileName + ".tmp";
+    mKey          = key;
+    mFile = std::fopen(mTempFileName.c_str(), "wb");
+    if (mFile == nullptr)  return false;
+
+    // The header is written again by Finish once it is known
+    StreamedMeshHeader header = {};
+    mOffset = 0;
+    if (!WriteSection(mFile, &header, sizeof(header), mOffset))
+    {
+        Abort();
+        return false;
+    }
+    return true;
+}
+
+
+// Write a chunk of the mesh, a packed mesh with 16-bit indices and a depth stream. Returns false on failure
+bool StreamedMeshWriter::AddChunk(const MeshDataView& chunk)
+{
+    if (mFile == nullptr || chunk.indexSize != 2 || chunk.numDepthVertices == 0)  return false;
+
+    // The first chunk sets the layout, the rest must match it
+    const VertexElement* position = FindElement(chunk, "Position");
+    if (position == nullptr)  return false;
+    if (mChunks.empty())
+    {
+        mElements.assign(chunk.elements, chunk.elements + chunk.numElements);
+        mVertexSize      = chunk.vertexSize;
+        mDepthVertexSize = chunk.depthVertexSize;
+        mBoundingBox     = chunk.boundingBox;
+    }
+    else if (chunk.numElements != mElements.size() || chunk.vertexSize != mVertexSize || chunk.depthVertexSize != mDepthVertexSize ||
+             std::memcmp(chunk.elements, mElements.data(), mElements.size() * sizeof(VertexElement)) != 0)
+    {
+        return false;
+    }
+    if (mNumVertices + chunk.numVertices > UINT32_MAX || mNumDepthVertices + chunk.numDepthVertices > UINT32_MAX)  return false;
+
+    // Depth indices are stored as 32-bit
+    const void* depthIndices = chunk.depthIndices;
+    if (chunk.depthIndexSize == 2)
+    {
+        const uint16_t* indices16 = static_cast<const uint16_t*>(chunk.depthIndices);
+        mDepthIndices.assign(indices16, indices16 + chunk.numIndices);
+        depthIndices = mDepthIndices.data();
+    }
+
+    VertexElement depthElement = DepthElement(*position);
+    std::vector<unsigned char> sections[4] =
+    {
+        EncodeVertices(chunk.vertices, chunk.numVertices, chunk.vertexSize, chunk.elements, chunk.numElements),
+        EncodeIndices(chunk.indices, chunk.numIndices, chunk.indexSize),
+        EncodeVertices(chunk.depthVertices, chunk.numDepthVertices, chunk.depthVertexSize, &depthElement, 1),
+        EncodeIndices(depthIndices, chunk.numIndices, 4),
+    };
+
+    Chunk record = {};
+    record.offset           = mOffset;
+    record.firstVertex      = static_cast<uint32_t>(mNumVertices);
+    record.numVertices      = chunk.numVertices;
+    record.firstDepthVertex = static_cast<uint32_t>(mNumDepthVertices);
+    record.numDepthVertices = chunk.numDepthVertices;
+    record.numIndices       = chunk.numIndices;
+    for (int i = 0; i < 4; ++i)
+    {
+        record.storedSizes[i] = static_cast<uint32_t>(sections[i].size());
+        if (!WriteSection(mFile, sections[i].data(), sections[i].size(), mOffset))  return false;
+    }
+    record.firstSubMesh = static_cast<uint32_t>(mSubMeshes.size());
+    record.numSubMeshes = chunk.numSubMeshes;
+    record.firstLOD     = static_cast<uint32_t>(mLODs.size());
+    record.numLODs      = chunk.numLODs;
+    mSubMeshes.insert(mSubMeshes.end(), chunk.subMeshes, chunk.subMeshes + chunk.numSubMeshes);
+    mLODs.insert(mLODs.end(), chunk.lods, chunk.lods + chunk.numLODs);
+    mChunks.push_back(record);
+
+    mNumVertices      += chunk.numVertices;
+    mNumDepthVertices += chunk.numDepthVertices;
+    return true;
+}
+
+
+// Write the tables for the chunks written and rename the file. Returns false on failure
+bool StreamedMeshWriter::Finish(const CSphere& boundingSphere)
+{
+    if (mFile == nullptr || mChunks.empty())  return false;
+
+    // Levels of detail of the whole mesh, see comment at top of StreamedMesh.h. A chunk without LODs is all
+    // full detail, as one level
+    uint32_t numLevels = 1;
+    for (const Chunk& chunk : mChunks)  numLevels = std::max(numLevels, chunk.numLODs);
+
+    std::vector<SubMesh>    subMeshes;
+    std::vector<PartRecord> parts;
+    std::vector<MeshLOD>    lods;
+    uint64_t numIndices = 0;
+    for (uint32_t level = 0; level < numLevels; ++level)
+    {
+        MeshLOD lod = { static_cast<uint32_t>(subMeshes.size()), 0, 0, 0 };
+        for (uint32_t c = 0; c < mChunks.size(); ++c)
+        {
+            const Chunk& chunk = mChunks[c];
+            uint32_t first = chunk.firstSubMesh;
+            uint32_t count = chunk.numSubMeshes;
+            if (chunk.numLODs > 0)
+            {
+                const MeshLOD& chunkLOD = mLODs[chunk.firstLOD + std::min(level, chunk.numLODs - 1)];
+                first += chunkLOD.firstSubMesh;
+                count  = chunkLOD.numSubMeshes;
+                lod.error = std::max(lod.error, chunkLOD.error);
+            }
+            for (uint32_t i = first; i < first + count; ++i)
+            {
+                SubMesh subMesh = mSubMeshes[i];
+                parts.push_back({ c, subMesh.startIndex });
+                subMesh.startIndex  = static_cast<uint32_t>(numIndices);
+                subMesh.baseVertex += chunk.firstVertex;
+                subMeshes.push_back(subMesh);
+                lod.numTriangles += subMesh.numIndices / 3;
+                numIndices       += subMesh.numIndices;
+            }
+        }
+        lod.numSubMeshes = static_cast<uint32_t>(subMeshes.size()) - lod.firstSubMesh;
+        lods.push_back(lod);
+    }
+    if (numIndices > UINT32_MAX)  return false;
+    if (numLevels == 1)  lods.clear(); // A mesh with one level has no LOD table
+
+    std::vector<ChunkRecord> chunks(mChunks.size());
+    for (size_t i = 0; i < mChunks.size(); ++i)
+    {
+        std::memcpy(&chunks[i], &mChunks[i], offsetof(Chunk, firstSubMesh)); // The records start the same
+        chunks[i].unused = 0;
+    }
+
+    StreamedMeshHeader header = {};
+    std::memcpy(header.magic, STREAMED_MESH_MAGIC, sizeof(header.magic));
+    header.version          = STREAMED_MESH_VERSION;
+    header.key              = mKey;
+    header.numElements      = static_cast<uint32_t>(mElements.size());
+    header.numSubMeshes     = static_cast<uint32_t>(subMeshes.size());
+    header.numLODs          = static_cast<uint32_t>(lods.size());
+    header.numChunks        = static_cast<uint32_t>(chunks.size());
+    header.numVertices      = static_cast<uint32_t>(mNumVertices);
+    header.vertexSize       = mVertexSize;
+    header.numIndices       = static_cast<uint32_t>(numIndices);
+    header.indexSize        = 2;
+    header.numDepthVertices = static_cast<uint32_t>(mNumDepthVertices);
+    header.depthVertexSize  = mDepthVertexSize;
+    header.depthIndexSize   = 4;
+
+    header.boxCentre[0]    = mBoundingBox.centre.x;
+    header.boxCentre[1]    = mBoundingBox.centre.y;
+    header.boxCentre[2]    = mBoundingBox.centre.z;
+    header.boxHalfSize[0]  = mBoundingBox.halfSize.x;
+    header.boxHalfSize[1]  = mBoundingBox.halfSize.y;
+    header.boxHalfSize[2]  = mBoundingBox.halfSize.z;
+    header.sphereCentre[0] = boundingSphere.centre.x;
+    header.sphereCentre[1] = boundingSphere.centre.y;
+    header.sphereCentre[2] = boundingSphere.centre.z;
+    header.sphereRadius    = boundingSphere.radius;
+
+    header.elementsOffset  = mOffset;
+    header.subMeshesOffset = AlignSection(header.elementsOffset  + mElements.size() * sizeof(VertexElement));
+    header.partsOffset     = AlignSection(header.subMeshesOffset + subMeshes.size() * sizeof(SubMesh));
+    header.lodsOffset      = AlignSection(header.partsOffset     + parts.size()     * sizeof(PartRecord));
+    header.chunksOffset    = AlignSection(header.lodsOffset      + lods.size()      * sizeof(MeshLOD));
+    header.fileSize        = AlignSection(header.chunksOffset    + chunks.size()    * sizeof(ChunkRecord));
+
+    uint64_t headerOffset = 0;
+    bool ok = WriteSection(mFile, mElements.data(), mElements.size() * sizeof(VertexElement), mOffset) &&
+              WriteSection(mFile, subMeshes.data(), subMeshes.size() * sizeof(SubMesh),      mOffset) &&
+              WriteSection(mFile, parts.data(),     parts.size()     * sizeof(PartRecord),   mOffset) &&
+              WriteSection(mFile, lods.data(),      lods.size()      * sizeof(MeshLOD),      mOffset) &&
+              WriteSection(mFile, chunks.data(),    chunks.size()    * sizeof(ChunkRecord),  mOffset) &&
+              SeekFile(mFile, 0) && WriteSection(mFile, &header, sizeof(header), headerOffset);
+    ok = (std::fclose(mFile) == 0) && ok;
+    mFile = nullptr;
+
+    // Replace any existing file (rename won't overwrite on Windows)
+    if (ok)
+    {
+        std::remove(mFileName.c_str());
+        ok = (std::rename(mTempFileName.c_str(), mFileName.c_str()) == 0);
+    }
+    if (!ok)  std::remove(mTempFileName.c_str());
+    mTempFileName.clear();
+    return ok;
+}
+
+
+// Give up on the file and remove it
+void StreamedMeshWriter::Abort()
+{
+    if (mFile != nullptr)
+    {
+        std::fclose(mFile);
+        mFile = nullptr;
+    }
+    if (!mTempFileName.empty())  std::remove(mTempFileName.c_str());
+    mTempFileName.clear();
+
+    mElements.clear();
+    mChunks.clear();
+    mSubMeshes.clear();
+    mLODs.clear();
+    mNumVertices      = 0;
+    mNumDepthVertices = 0;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Reading
+-----------------------------------------------------------------------------------------*/
+
+// Open the given streamed mesh file and read its tables. Returns false if it can't be opened, was written
+// with a different key or is not a valid streamed mesh
+bool StreamedMesh::Open(const std::string& fileName, uint64_t key)
+{
+    static_assert(sizeof(Chunk) == sizeof(ChunkRecord) && sizeof(Part) == sizeof(PartRecord), "Tables must match the file");
+
+    Close();
+    mFile = std::fopen(fileName.c_str(), "rb");
+    if (mFile == nullptr)  return false;
+
+    uint64_t fileSize;
+    StreamedMeshHeader header;
+    if (!FileSize(mFile, fileSize) || fileSize < sizeof(header) || !SeekFile(mFile, 0) ||
+        std::fread(&header, sizeof(header), 1, mFile) != 1 ||
+        std::memcmp(header.magic, STREAMED_MESH_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != STREAMED_MESH_VERSION || header.key != key || header.fileSize != fileSize ||
+        header.numElements == 0 || header.vertexSize == 0 || header.numChunks == 0 || header.numDepthVertices == 0 ||
+        (header.indexSize != 2 && header.indexSize != 4) || header.depthIndexSize != 4 ||
+        !SectionValid(header.elementsOffset,  header.numElements,  sizeof(VertexElement), fileSize) ||
+        !SectionValid(header.subMeshesOffset, header.numSubMeshes, sizeof(SubMesh),       fileSize) ||
+        !SectionValid(header.partsOffset,     header.numSubMeshes, sizeof(Part),          fileSize) ||
+        !SectionValid(header.lodsOffset,      header.numLODs,      sizeof(MeshLOD),       fileSize) ||
+        !SectionValid(header.chunksOffset,    header.numChunks,    sizeof(Chunk),         fileSize) ||
+        !ReadTable(mFile, header.elementsOffset,  header.numElements,  mElements)  ||
+        !ReadTable(mFile, header.subMeshesOffset, header.numSubMeshes, mSubMeshes) ||
+        !ReadTable(mFile, header.partsOffset,     header.numSubMeshes, mParts)     ||
+        !ReadTable(mFile, header.lodsOffset,      header.numLODs,      mLODs)      ||
+        !ReadTable(mFile, header.chunksOffset,    header.numChunks,    mChunks))
+    {
+        Close();
+        return false;
+    }
+
+    mView.elements         = mElements.data();
+    mView.numElements      = header.numElements;
+    mView.subMeshes        = mSubMeshes.data();
+    mView.numSubMeshes     = header.numSubMeshes;
+    mView.lods             = mLODs.data();
+    mView.numLODs          = header.numLODs;
+    mView.numVertices      = header.numVertices;
+    mView.vertexSize       = header.vertexSize;
+    mView.numIndices       = header.numIndices;
+    mView.indexSize        = header.indexSize;
+    mView.numDepthVertices = header.numDepthVertices;
+    mView.depthVertexSize  = header.depthVertexSize;
+    mView.depthIndexSize   = header.depthIndexSize;
+    mView.boundingBox    = CAABB{ { header.boxCentre[0], header.boxCentre[1], header.boxCentre[2] },
+                                  { header.boxHalfSize[0], header.boxHalfSize[1], header.boxHalfSize[2] } };
+    mView.boundingSphere = CSphere{ { header.sphereCentre[0], header.sphereCentre[1], header.sphereCentre[2] }, header.sphereRadius };
+
+    // Every element must be a known format lying within the vertex, with a terminated name, and the depth
+    // stream holds the positions in the same format as the vertices
+    for (const VertexElement& element : mElements)
+    {
+        uint32_t size = VertexFormatSize(element.format);
+        if (size == 0 || static_cast<uint64_t>(element.offset) + size > mView.vertexSize ||
+            std::memchr(element.semantic, 0, sizeof(element.semantic)) == nullptr)
+        {
+            Close();
+            return false;
+        }
+    }
+    const VertexElement* position = FindElement(mView, "Position");
+    if (position == nullptr || VertexFormatSize(position->format) != mView.depthVertexSize)
+    {
+        Close();
+        return false;
+    }
+
+    // Every chunk's data must lie within the file before the tables, and its vertices within the mesh's
+    for (const Chunk& chunk : mChunks)
+    {
+        uint64_t end = chunk.offset;
+        for (uint32_t size : chunk.storedSizes)  end = AlignSection(end + size);
+        if (chunk.offset % SECTION_ALIGNMENT != 0 || end > header.elementsOffset || chunk.numIndices > mView.numIndices ||
+            static_cast<uint64_t>(chunk.firstVertex)      + chunk.numVertices      > mView.numVertices ||
+            static_cast<uint64_t>(chunk.firstDepthVertex) + chunk.numDepthVertices > mView.numDepthVertices)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // Every sub-mesh must lie within the buffers and come from a range of its chunk's indices and vertices
+    for (uint32_t i = 0; i < mView.numSubMeshes; ++i)
+    {
+        const SubMesh& subMesh = mSubMeshes[i];
+        const Part&    part    = mParts[i];
+        if (part.chunk >= mChunks.size() ||
+            static_cast<uint64_t>(subMesh.startIndex) + subMesh.numIndices  > mView.numIndices ||
+            static_cast<uint64_t>(part.sourceIndex)   + subMesh.numIndices  > mChunks[part.chunk].numIndices ||
+            subMesh.baseVertex < mChunks[part.chunk].firstVertex ||
+            static_cast<uint64_t>(subMesh.baseVertex) + subMesh.numVertices >
+            static_cast<uint64_t>(mChunks[part.chunk].firstVertex) + mChunks[part.chunk].numVertices)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // Every LOD must be a range of the sub-meshes
+    for (const MeshLOD& lod : mLODs)
+    {
+        if (static_cast<uint64_t>(lod.firstSubMesh) + lod.numSubMeshes > mView.numSubMeshes)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    // List the parts of each chunk, counting then placing them
+    mFirstPart.assign(mChunks.size() + 1, 0);
+    for (const Part& part : mParts)  ++mFirstPart[part.chunk + 1];
+    for (size_t i = 1; i < mFirstPart.size(); ++i)  mFirstPart[i] += mFirstPart[i - 1];
+    mChunkParts.resize(mParts.size());
+    std::vector<uint32_t> next(mFirstPart.begin(), mFirstPart.end() - 1);
+    for (uint32_t i = 0; i < mParts.size(); ++i)  mChunkParts[next[mParts[i].chunk]++] = i;
+
+    return true;
+}
+
+
+void StreamedMesh::Close()
+{
+    if (mFile != nullptr)  std::fclose(mFile);
+    mFile = nullptr;
+    mView = MeshDataView();
+    mElements.clear();
+    mSubMeshes.clear();
+    mLODs.clear();
+    mChunks.clear();
+    mParts.clear();
+    mFirstPart.clear();
+    mChunkParts.clear();
+    mStored.clear();
+}
+
+
+// Divide the mesh between sets of GPU buffers with none larger than maxBufferBytes, see StreamedMesh.h
+StreamedBufferPlan StreamedMesh::PlanBuffers(uint64_t maxBufferBytes) const
+{
+    StreamedBufferPlan plan;
+    if (mFile == nullptr)  return plan;
+
+    // Indices each chunk copies into the buffers, including those copied into the levels it is missing
+    std::vector<uint64_t> chunkIndices(mChunks.size(), 0);
+    for (uint32_t i = 0; i < mSubMeshes.size(); ++i)  chunkIndices[mParts[i].chunk] += mSubMeshes[i].numIndices;
+
+    // Add chunks to the current set while its vertices follow on and its buffers fit, sizes in 64 bits as a
+    // large mesh's can pass 4GB
+    uint64_t indexSize  = std::max(mView.indexSize, mView.depthIndexSize);
+    uint64_t setIndices = 0;
+    for (uint32_t i = 0; i < mChunks.size(); ++i)
+    {
+        const Chunk& chunk = mChunks[i];
+        uint64_t vertexEnd = static_cast<uint64_t>(chunk.firstVertex)      + chunk.numVertices;
+        uint64_t depthEnd  = static_cast<uint64_t>(chunk.firstDepthVertex) + chunk.numDepthVertices;
+        StreamedBufferSet* set = plan.sets.empty() ? nullptr : &plan.sets.back();
+        if (set != nullptr &&
+            chunk.firstVertex      >= static_cast<uint64_t>(set->firstVertex)      + set->numVertices      &&
+            chunk.firstDepthVertex >= static_cast<uint64_t>(set->firstDepthVertex) + set->numDepthVertices &&
+            (vertexEnd - set->firstVertex)      * mView.vertexSize      <= maxBufferBytes &&
+            (depthEnd  - set->firstDepthVertex) * mView.depthVertexSize <= maxBufferBytes &&
+            (setIndices + chunkIndices[i]) * indexSize <= maxBufferBytes)
+        {
+            set->numVertices      = static_cast<uint32_t>(vertexEnd - set->firstVertex);
+            set->numDepthVertices = static_cast<uint32_t>(depthEnd  - set->firstDepthVertex);
+            setIndices += chunkIndices[i];
+        }
+        else
+        {
+            plan.sets.push_back({ chunk.firstVertex, chunk.numVertices, chunk.firstDepthVertex, chunk.numDepthVertices, 0 });
+            setIndices = chunkIndices[i];
+        }
+        plan.chunkSets.push_back(static_cast<uint32_t>(plan.sets.size() - 1));
+    }
+
+    // Place each set's sub-meshes in the order of the whole mesh's index buffer, and move their base vertices
+    // to the set's vertices
+    std::vector<uint32_t> order(mSubMeshes.size());
+    for (uint32_t i = 0; i < order.size(); ++i)  order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return mSubMeshes[a].startIndex < mSubMeshes[b].startIndex; });
+
+    plan.subMeshes = mSubMeshes;
+    plan.subMeshSets.resize(mSubMeshes.size());
+    for (uint32_t i : order)
+    {
+        uint32_t set = plan.chunkSets[mParts[i].chunk];
+        plan.subMeshSets[i] = set;
+        plan.subMeshes[i].startIndex  = plan.sets[set].numIndices;
+        plan.subMeshes[i].baseVertex -= plan.sets[set].firstVertex;
+        plan.sets[set].numIndices    += plan.subMeshes[i].numIndices;
+    }
+    return plan;
+}
+
+
+// Read and decode the given chunk. Returns false if the file can't be read or the chunk is damaged
+bool StreamedMesh::ReadChunk(uint32_t chunk, StreamedChunk& data)
+{
+    if (mFile == nullptr || chunk >= mChunks.size())  return false;
+    const Chunk& record = mChunks[chunk];
+
+    data.firstVertex      = record.firstVertex;
+    data.numVertices      = record.numVertices;
+    data.firstDepthVertex = record.firstDepthVertex;
+    data.numDepthVertices = record.numDepthVertices;
+    data.vertices     .resize(static_cast<size_t>(record.numVertices)      * mView.vertexSize);
+    data.indices      .resize(static_cast<size_t>(record.numIndices)       * mView.indexSize);
+    data.depthVertices.resize(static_cast<size_t>(record.numDepthVertices) * mView.depthVertexSize);
+    data.depthIndices .resize(record.numIndices);
+
+    // The four sections follow each other, each on a section boundary
+    VertexElement depthElement = DepthElement(*FindElement(mView, "Position"));
+    uint64_t offset = record.offset;
+    for (int section = 0; section < 4; ++section)
+    {
+        uint32_t size = record.storedSizes[section];
+        mStored.resize(size);
+        if (!SeekFile(mFile, offset) || (size > 0 && std::fread(mStored.data(), 1, size, mFile) != size))  return false;
+        offset = AlignSection(offset + size);
+
+        bool decoded = false;
+        switch (section)
+        {
+            case 0: decoded = DecodeVertices(mStored.data(), size, data.vertices.data(), record.numVertices, mView.vertexSize,
+                                             mView.elements, mView.numElements);                                              break;
+            case 1: decoded = DecodeIndices(mStored.data(), size, data.indices.data(), record.numIndices, mView.indexSize);    break;
+            case 2: decoded = DecodeVertices(mStored.data(), size, data.depthVertices.data(), record.numDepthVertices,
+                                             mView.depthVertexSize, &depthElement, 1);                                         break;
+            case 3: decoded = DecodeIndices(mStored.data(), size, data.depthIndices.data(), record.numIndices, 4);              break;
+        }
+        if (!decoded)  return false;
+    }
+
+    // Depth indices must lie in the chunk's depth positions, they are moved up to index the whole depth stream
+    for (uint32_t& index : data.depthIndices)
+    {
+        if (index >= record.numDepthVertices)  return false;
+        index += record.firstDepthVertex;
+    }
+
+    data.slices.clear();
+    for (uint32_t i = mFirstPart[chunk]; i < mFirstPart[chunk + 1]; ++i)
+    {
+        uint32_t subMesh = mChunkParts[i];
+        data.slices.push_back({ mSubMeshes[subMesh].startIndex, mSubMeshes[subMesh].numIndices, mParts[subMesh].sourceIndex, subMesh });
+    }
+    return true;
+}
@@ -0,0 +1,226 @@
+//--------------------------------------------------------------------------------------
+// Streamed mesh files - cooked meshes stored in chunks, for meshes too large to hold in memory
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A cooked mesh file (CookedMesh.h) is the whole mesh in one piece, which is mapped and used in place. A mesh
+// imported by StreamImportMesh (MeshStreaming.h) is too large for that, so it is written as a streamed mesh
+// file: a series of chunks, each a packed mesh of a few thousand triangles (VertexPacking.h) with its own
+// vertices, indices and depth stream, followed by tables describing the whole mesh. The Mesh class opens the
+// file, creates GPU buffers from the tables (several sets of them if the mesh is too large for one), then reads
+// the chunks one at a time and copies each into its slice of the buffers, so only one chunk is ever in CPU memory.
+//
+// Every chunk has the same vertex layout and is packed against the same bounding box (the whole mesh's), so
+// the chunks' vertices can simply be put one after another. Each chunk's indices are 16-bit, relative to the
+// base vertex of their sub-mesh. The depth indices are stored relative to the chunk's depth positions and are
+// moved up to index the whole depth stream as the chunk is read, so the mesh's depth indices are 32-bit.
+//
+// The whole mesh's levels of detail are made from the chunks' own levels of detail: level N of the mesh is
+// level N of every chunk, or the chunk's coarsest level if it has fewer. The index buffer is ordered by level
+// of detail rather than by chunk, so each level is one range of the depth indices and draws in a single call.
+// The sub-mesh table gives the range of the whole index buffer each of a chunk's sub-meshes goes to, and the
+// part table the chunk and the range of its indices it comes from - a chunk with fewer levels copies its
+// coarsest level's indices into each level it is missing.
+//
+// The key, version and size checks are as for cooked mesh files. Opening a file reads only the header and the
+// tables, checking every range in them, and each chunk is checked as it is read. The vertex and index
+// sections of each chunk are always compressed (MeshCodec.h).
+
+#ifndef _STREAMED_MESH_H_INCLUDED_
+#define _STREAMED_MESH_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+
+// Version of the file format, increase this whenever the format or the streaming import changes
+const uint32_t STREAMED_MESH_VERSION = 4;
+
+
+/*-----------------------------------------------------------------------------------------
+    Writing
+-----------------------------------------------------------------------------------------*/
+
+// Writes a streamed mesh file a chunk at a time. The file is written under a temporary name and renamed by
+// Finish, so an interrupted import never leaves a partial file. The temporary file is removed if the writer is
+// destroyed before Finish succeeds
+class StreamedMeshWriter
+{
+public:
+    ~StreamedMeshWriter();
+
+    // Start writing the file with the given key. Returns false if it can't be created
+    bool Open(const std::string& fileName, uint64_t key);
+
+    // Write a chunk of the mesh, a packed mesh with 16-bit indices and a depth stream. Every chunk must have the
+    // same vertex layout and bounding box. Returns false on failure, or if the mesh grows past 32-bit counts
+    bool AddChunk(const MeshDataView& chunk);
+
+    // Write the tables for the chunks written, with the given bounding sphere of the whole mesh (the bounding
+    // box is the chunks'), and rename the file. Returns false on failure
+    bool Finish(const CSphere& boundingSphere);
+
+    // Give up on the file and remove it
+    void Abort();
+
+
+private:
+    // What Finish needs to know about each chunk, see StreamedMesh.cpp
+    struct Chunk
+    {
+        uint64_t offset;
+        uint32_t firstVertex;
+        uint32_t numVertices;
+        uint32_t firstDepthVertex;
+        uint32_t numDepthVertices;
+        uint32_t numIndices;
+        uint32_t storedSizes[4];
+        uint32_t firstSubMesh;     // Of the chunk's sub-meshes and LODs in the lists below
+        uint32_t numSubMeshes;
+        uint32_t firstLOD;
+        uint32_t numLODs;
+    };
+
+    std::string  mFileName;
+    std::string  mTempFileName;
+    FILE*        mFile = nullptr;
+    uint64_t     mKey  = 0;
+    uint64_t     mOffset = 0;
+
+    std::vector<VertexElement> mElements;
+    uint32_t                   mVertexSize      = 0;
+    uint32_t                   mDepthVertexSize = 0;
+    CAABB                      mBoundingBox;
+
+    std::vector<Chunk>         mChunks;
+    std::vector<SubMesh>       mSubMeshes;     // Each chunk's own sub-meshes and LODs, as packed
+    std::vector<MeshLOD>       mLODs;
+    uint64_t                   mNumVertices      = 0;
+    uint64_t                   mNumDepthVertices = 0;
+
+    std::vector<uint32_t>      mDepthIndices;  // Scratch space for converting 16-bit depth indices
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Reading
+-----------------------------------------------------------------------------------------*/
+
+// Where a range of a chunk's indices goes in the whole mesh's index buffers
+struct StreamedSlice
+{
+    uint32_t startIndex;    // In the whole mesh's index and depth index buffers
+    uint32_t numIndices;
+    uint32_t sourceIndex;   // In the chunk's indices
+    uint32_t subMesh;       // The sub-mesh of the whole mesh it is
+};
+
+
+// The part of the whole mesh in one set of GPU buffers, see StreamedMesh::PlanBuffers
+struct StreamedBufferSet
+{
+    uint32_t firstVertex;       // Of the whole mesh's vertices and depth positions
+    uint32_t numVertices;
+    uint32_t firstDepthVertex;
+    uint32_t numDepthVertices;
+    uint32_t numIndices;        // Also the number of depth indices
+};
+
+// A streamed mesh divided between sets of GPU buffers
+struct StreamedBufferPlan
+{
+    std::vector<StreamedBufferSet> sets;
+    std::vector<uint32_t>          chunkSets;    // The set each chunk goes in
+    std::vector<uint32_t>          subMeshSets;  // The set each sub-mesh goes in
+    std::vector<SubMesh>           subMeshes;    // The whole mesh's sub-meshes as ranges of their set's buffers
+};
+
+
+// One chunk of a streamed mesh read for copying into the GPU buffers. Reading the next chunk into the same
+// object reuses its memory
+struct StreamedChunk
+{
+    std::vector<unsigned char> vertices;       // numVertices * vertexSize bytes, to go at firstVertex
+    uint32_t                   firstVertex = 0;
+    uint32_t                   numVertices = 0;
+
+    std::vector<unsigned char> depthVertices;  // numDepthVertices * depthVertexSize bytes, to go at firstDepthVertex
+    uint32_t                   firstDepthVertex = 0;
+    uint32_t                   numDepthVertices = 0;
+
+    std::vector<unsigned char> indices;        // The chunk's indices, indexSize bytes each, placed by the slices
+    std::vector<uint32_t>      depthIndices;   // As many depth indices, already indexing the whole depth stream
+    std::vector<StreamedSlice> slices;
+};
+
+
+// A streamed mesh file opened for reading. The file stays open until the object is closed or destroyed
+class StreamedMesh
+{
+public:
+    ~StreamedMesh()  { Close(); }
+
+    // Open the given streamed mesh file and read its tables. Returns false if it can't be opened, was written
+    // with a different key or is not a valid streamed mesh
+    bool Open(const std::string& fileName, uint64_t key);
+
+    void Close();
+
+    bool IsOpen() const  { return mFile != nullptr; }
+
+    // The whole mesh's layout, counts, sub-meshes, LODs and bounds. The vertex and index pointers are null,
+    // the data is read a chunk at a time with ReadChunk
+    const MeshDataView& View() const  { return mView; }
+
+    uint32_t NumChunks() const  { return static_cast<uint32_t>(mChunks.size()); }
+
+    // Divide the mesh between sets of GPU buffers with none larger than maxBufferBytes, for meshes too large for
+    // one buffer of each kind. Neighbouring chunks share a set, and a set's sub-meshes keep the order they have in
+    // the whole mesh's index buffer, so each level of detail is still one range of a set's depth indices. A chunk
+    // larger than maxBufferBytes has a set to itself. The chunks' depth indices are moved down to index their
+    // set's depth positions by subtracting its firstDepthVertex, and slices placed at their sub-mesh's startIndex
+    StreamedBufferPlan PlanBuffers(uint64_t maxBufferBytes) const;
+
+    // Read and decode the given chunk. Returns false if the file can't be read or the chunk is damaged
+    bool ReadChunk(uint32_t chunk, StreamedChunk& data);
+
+
+private:
+    // Entries in the file's chunk and part tables, see StreamedMesh.cpp
+    struct Chunk
+    {
+        uint64_t offset;
+        uint32_t firstVertex;
+        uint32_t numVertices;
+        uint32_t firstDepthVertex;
+        uint32_t numDepthVertices;
+        uint32_t numIndices;
+        uint32_t storedSizes[4];   // Vertices, indices, depth vertices, depth indices
+        uint32_t unused;
+    };
+    struct Part
+    {
+        uint32_t chunk;
+        uint32_t sourceIndex;
+    };
+
+    FILE*        mFile = nullptr;
+    MeshDataView mView;
+
+    std::vector<VertexElement> mElements;
+    std::vector<SubMesh>       mSubMeshes;
+    std::vector<MeshLOD>       mLODs;
+    std::vector<Chunk>         mChunks;
+    std::vector<Part>          mParts;         // One for each sub-mesh
+    std::vector<uint32_t>      mFirstPart;     // Each chunk's parts are mChunkParts[mFirstPart[chunk]] up to mFirstPart[chunk + 1]
+    std::vector<uint32_t>      mChunkParts;
+
+    std::vector<unsigned char> mStored;        // Compressed section read from the file
+};
+
+
+#endif //_STREAMED_MESH_H_INCLUDED_
@@ -0,0 +1,334 @@
+//--------------------------------------------------------------------------------------
+// Packing mesh data into its final GPU form - compact vertex formats and 16-bit indices
+//--------------------------------------------------------------------------------------
+
+#include "VertexPacking.h"
+#include "Packing.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    const float RADIANS_TO_DEGREES = 57.2957795f;
+
+    // Scale and offset to decode positions quantised to the given box
+    void BoxDecoding(const CAABB& box, CVector3& scale, CVector3& offset)
+    {
+        scale  = box.halfSize * 2.0f;
+        offset = box.Min();
+    }
+
+    // 16-bit UNORM as the GPU converts it, 0 to 65535 for 0 to 1
+    uint16_t FloatToUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+    }
+
+    float Unorm16ToFloat(uint16_t value)
+    {
+        return value / 65535.0f;
+    }
+
+    // Angle between two unit vectors in degrees. Uses atan2 rather than acos of the dot product, which can't
+    // measure angles of less than about 0.02 degrees in floats
+    float AngleBetween(const CVector3& a, const CVector3& b)
+    {
+        return std::atan2(Length(Cross(a, b)), Dot(a, b)) * RADIANS_TO_DEGREES;
+    }
+
+
+    // Make the depth stream of a packed mesh from its packed positions. Identical positions are found with a
+    // hash table of depth vertex numbers (open addressing, at most half full). Depth vertices are numbered in
+    // the order the indices first use them, so a depth pass reads them in order as the main pass does
+    void BuildDepthStream(PackedMesh& packed)
+    {
+        const VertexElement* position = FindElement(packed.View(), "Position");
+        if (position == nullptr || packed.numIndices == 0)  return;
+        const uint32_t size = VertexFormatSize(position->format);
+
+        const uint32_t UNUSED = 0xffffffff;
+        uint32_t tableSize = 16;
+        while (tableSize < packed.numVertices * 2)  tableSize *= 2;
+        std::vector<uint32_t> table(tableSize, UNUSED);
+        std::vector<uint32_t> vertexDepth(packed.numVertices, UNUSED);
+        std::vector<uint32_t> depthIndices(packed.numIndices);
+
+        packed.depthVertexSize = size;
+        for (const SubMesh& subMesh : packed.subMeshes)
+        {
+            for (uint32_t i = subMesh.startIndex; i < subMesh.startIndex + subMesh.numIndices; ++i)
+            {
+                uint32_t index = (packed.indexSize == 2) ? reinterpret_cast<const uint16_t*>(packed.indices.data())[i]
+                                                         : reinterpret_cast<const uint32_t*>(packed.indices.data())[i];
+                uint32_t vertex = subMesh.baseVertex + index;
+                if (vertexDepth[vertex] == UNUSED)
+                {
+                    const unsigned char* p = packed.vertices.data() + static_cast<size_t>(vertex) * packed.vertexSize + position->offset;
+                    uint32_t slot = static_cast<uint32_t>(HashBytes(p, size)) & (tableSize - 1);
+                    while (table[slot] != UNUSED && std::memcmp(&packed.depthVertices[static_cast<size_t>(table[slot]) * size], p, size) != 0)
+                    {
+                        slot = (slot + 1) & (tableSize - 1);
+                    }
+                    if (table[slot] == UNUSED)
+                    {
+                        table[slot] = packed.numDepthVertices++;
+                        packed.depthVertices.insert(packed.depthVertices.end(), p, p + size);
+                    }
+                    vertexDepth[vertex] = table[slot];
+                }
+                depthIndices[i] = vertexDepth[vertex];
+            }
+        }
+
+        // All the depth positions are in one range, so 16-bit indices only fit if there are few of them
+        packed.depthIndexSize = (packed.numDepthVertices <= 65536) ? 2 : 4;
+        packed.depthIndices.resize(static_cast<size_t>(packed.numIndices) * packed.depthIndexSize);
+        if (packed.depthIndexSize == 2)
+        {
+            uint16_t* dest = reinterpret_cast<uint16_t*>(packed.depthIndices.data());
+            for (uint32_t i = 0; i < packed.numIndices; ++i)  dest[i] = static_cast<uint16_t>(depthIndices[i]);
+        }
+        else
+        {
+            std::memcpy(packed.depthIndices.data(), depthIndices.data(), packed.depthIndices.size());
+        }
+    }
+}
+
+
+// Scale and offset that turn a quantised position read by the GPU (0 to 1 in each component) back into a
+// model space position: position = quantised * scale + offset
+void PositionDecoding(const MeshDataView& mesh, CVector3& scale, CVector3& offset)
+{
+    const VertexElement* position = FindElement(mesh, "Position");
+    if (position != nullptr && position->format == VertexFormat::UNorm16x4)
+    {
+        BoxDecoding(mesh.boundingBox, scale, offset);
+    }
+    else
+    {
+        scale  = { 1, 1, 1 };
+        offset = { 0, 0, 0 };
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Packed meshes
+-----------------------------------------------------------------------------------------*/
+
+// View of this data, only valid until the data is changed
+MeshDataView PackedMesh::View() const
+{
+    MeshDataView view;
+    view.elements         = elements.data();
+    view.numElements      = static_cast<uint32_t>(elements.size());
+    view.subMeshes        = subMeshes.data();
+    view.numSubMeshes     = static_cast<uint32_t>(subMeshes.size());
+    view.lods             = lods.data();
+    view.numLODs          = static_cast<uint32_t>(lods.size());
+    view.meshlets         = meshlets.data();
+    view.numMeshlets      = static_cast<uint32_t>(meshlets.size());
+    view.vertices         = vertices.data();
+    view.numVertices      = numVertices;
+    view.vertexSize       = vertexSize;
+    view.indices          = indices.data();
+    view.numIndices       = numIndices;
+    view.indexSize        = indexSize;
+    view.depthVertices    = depthVertices.data();
+    view.numDepthVertices = numDepthVertices;
+    view.depthVertexSize  = depthVertexSize;
+    view.depthIndices     = depthIndices.data();
+    view.depthIndexSize   = depthIndexSize;
+    view.boundingBox      = boundingBox;
+    view.boundingSphere   = boundingSphere;
+    return view;
+}
+
+
+// Pack the given mesh, which must use the float formats from import, with the given vertex profile. Elements
+// other than those listed at the top of the file are copied unchanged. Optionally fill in a report of the
+// errors and memory use. Pass halfUVs false to keep UVs as floats
+PackedMesh PackMesh(const MeshDataView& mesh, VertexProfile profile, PackingReport* report /*= nullptr*/, bool halfUVs /*= true*/)
+{
+    PackingReport packingReport;
+    const unsigned char* vertices = static_cast<const unsigned char*>(mesh.vertices);
+
+    PackedMesh packed;
+    packed.subMeshes.assign(mesh.subMeshes, mesh.subMeshes + mesh.numSubMeshes);
+    packed.lods.assign(mesh.lods, mesh.lods + mesh.numLODs);
+    packed.meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.numMeshlets);
+    packed.numVertices    = mesh.numVertices;
+    packed.numIndices     = mesh.numIndices;
+    packed.boundingBox    = mesh.boundingBox;
+    packed.boundingSphere = mesh.boundingSphere;
+
+    //-----------------------------------
+
+    // Choose the format of each element
+    enum class Packing { Copy, Position, Direction, UV };
+    std::vector<Packing> packing(mesh.numElements, Packing::Copy);
+    for (uint32_t i = 0; i < mesh.numElements; ++i)
+    {
+        VertexElement element = mesh.elements[i];
+        if (profile == VertexProfile::Compact && element.semanticIndex == 0)
+        {
+            bool isFloat3 = (element.format == VertexFormat::Float3);
+            if (isFloat3 && std::strcmp(element.semantic, "Position") == 0)
+            {
+                packing[i] = Packing::Position;
+                element.format = VertexFormat::UNorm16x4;
+            }
+            else if (isFloat3 && (std::strcmp(element.semantic, "Normal") == 0 || std::strcmp(element.semantic, "Tangent") == 0))
+            {
+                packing[i] = Packing::Direction;
+                element.format = VertexFormat::SNorm16x2;
+            }
+            else if (element.format == VertexFormat::Float2 && std::strcmp(element.semantic, "UV") == 0)
+            {
+                // Use half floats only if every UV is close enough
+                float maxError = 0;
+                const unsigned char* uv = vertices + element.offset;
+                for (uint32_t v = 0; v < mesh.numVertices; ++v, uv += mesh.vertexSize)
+                {
+                    for (int c = 0; c < 2; ++c)
+                    {
+                        float value = reinterpret_cast<const float*>(uv)[c];
+                        maxError = std::max(maxError, std::abs(HalfToFloat(FloatToHalf(value)) - value));
+                    }
+                }
+                if (halfUVs && maxError <= MAX_HALF_UV_ERROR)
+                {
+                    packing[i] = Packing::UV;
+                    element.format = VertexFormat::Half2;
+                    packingReport.maxUVError = maxError;
+                }
+                else
+                {
+                    packingReport.uvsKeptAsFloat = true;
+                }
+            }
+        }
+        element.offset = packed.vertexSize;
+        packed.vertexSize += VertexFormatSize(element.format);
+        packed.elements.push_back(element);
+    }
+
+
+    //-----------------------------------
+
+    // Convert the vertices one element at a time
+    CVector3 positionScale, positionOffset;
+    BoxDecoding(mesh.boundingBox, positionScale, positionOffset);
+    const float scale[3]  = { positionScale.x,  positionScale.y,  positionScale.z };
+    const float offset[3] = { positionOffset.x, positionOffset.y, positionOffset.z };
+
+    packed.vertices.resize(static_cast<size_t>(packed.numVertices) * packed.vertexSize);
+    std::vector<uint32_t> octahedral;
+    for (uint32_t i = 0; i < mesh.numElements; ++i)
+    {
+        // Normals and tangents are encoded together with the bulk (SIMD) version
+        if (packing[i] == Packing::Direction)
+        {
+            octahedral.resize(mesh.numVertices);
+            PackOctahedral16(vertices + mesh.elements[i].offset, mesh.vertexSize, octahedral.data(), mesh.numVertices);
+        }
+
+        const unsigned char* source = vertices + mesh.elements[i].offset;
+        unsigned char*       dest   = packed.vertices.data() + packed.elements[i].offset;
+        uint32_t             size   = VertexFormatSize(mesh.elements[i].format);
+        float&               maxDirectionError = (std::strcmp(mesh.elements[i].semantic, "Normal") == 0) ? packingReport.maxNormalError
+                                                                                                         : packingReport.maxTangentError;
+
+        for (uint32_t v = 0; v < mesh.numVertices; ++v, source += mesh.vertexSize, dest += packed.vertexSize)
+        {
+            if (packing[i] == Packing::Position)
+            {
+                const float* position = reinterpret_cast<const float*>(source);
+                uint16_t quantised[4] = {};
+                float errorSq = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    quantised[c] = (scale[c] > 0) ? FloatToUnorm16((position[c] - offset[c]) / scale[c]) : 0;
+                    float error = Unorm16ToFloat(quantised[c]) * scale[c] + offset[c] - position[c];
+                    errorSq += error * error;
+                }
+                std::memcpy(dest, quantised, sizeof(quantised));
+                packingReport.maxPositionError = std::max(packingReport.maxPositionError, std::sqrt(errorSq));
+            }
+            else if (packing[i] == Packing::Direction)
+            {
+                // A zero vector can't be encoded, store 0,0 (which decodes to 0,0,1)
+                const CVector3& direction = *reinterpret_cast<const CVector3*>(source);
+                float length = Length(direction);
+                uint32_t encoded = (length > 0) ? octahedral[v] : 0;
+                std::memcpy(dest, &encoded, sizeof(encoded));
+                if (length > 0)
+                {
+                    float error = AngleBetween(UnpackOctahedral16(encoded), direction * (1.0f / length));
+                    maxDirectionError = std::max(maxDirectionError, error);
+                }
+            }
+            else if (packing[i] == Packing::UV)
+            {
+                const float* uv = reinterpret_cast<const float*>(source);
+                uint16_t half[2] = { FloatToHalf(uv[0]), FloatToHalf(uv[1]) };
+                std::memcpy(dest, half, sizeof(half));
+            }
+            else
+            {
+                std::memcpy(dest, source, size);
+            }
+        }
+    }
+
+
+    //-----------------------------------
+
+    // Indices are relative to each sub-mesh's base vertex, so 16 bits are enough if every sub-mesh is small
+    bool fits16Bits = true;
+    for (uint32_t i = 0; i < mesh.numSubMeshes; ++i)
+    {
+        if (mesh.subMeshes[i].numVertices > 65536)  fits16Bits = false;
+    }
+
+    packed.indexSize = fits16Bits ? 2 : 4;
+    packed.indices.resize(static_cast<size_t>(packed.numIndices) * packed.indexSize);
+    if (mesh.indexSize == packed.indexSize)
+    {
+        std::memcpy(packed.indices.data(), mesh.indices, packed.indices.size());
+    }
+    else if (packed.indexSize == 2)
+    {
+        const uint32_t* source = static_cast<const uint32_t*>(mesh.indices);
+        uint16_t*       dest   = reinterpret_cast<uint16_t*>(packed.indices.data());
+        for (uint32_t i = 0; i < mesh.numIndices; ++i)  dest[i] = static_cast<uint16_t>(source[i]);
+    }
+    else
+    {
+        const uint16_t* source = static_cast<const uint16_t*>(mesh.indices);
+        uint32_t*       dest   = reinterpret_cast<uint32_t*>(packed.indices.data());
+        for (uint32_t i = 0; i < mesh.numIndices; ++i)  dest[i] = source[i];
+    }
+
+
+    BuildDepthStream(packed);
+
+
+    //-----------------------------------
+
+    if (report != nullptr)
+    {
+        packingReport.vertexBytesBefore = static_cast<size_t>(mesh.numVertices) * mesh.vertexSize;
+        packingReport.vertexBytesAfter  = packed.vertices.size();
+        packingReport.indexBytesBefore  = static_cast<size_t>(mesh.numIndices) * mesh.indexSize;
+        packingReport.indexBytesAfter   = packed.indices.size();
+        packingReport.depthBytes        = packed.depthVertices.size() + packed.depthIndices.size();
+        *report = packingReport;
+    }
+    return packed;
+}
@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------------------
+// Packing mesh data into its final GPU form - compact vertex formats and 16-bit indices
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Meshes are imported and processed with 32-bit float vertices and 32-bit indices (MeshData.h). PackMesh is
+// the last step before the GPU buffers are made (or the cooked file is written). It always stores indices in
+// 16 bits when they fit, that is when no sub-mesh has more than 65536 vertices (indices are relative to each
+// sub-mesh's base vertex). With the compact vertex profile it also shrinks the vertices:
+//
+//   Position  Float3 -> UNorm16x4  quantised to the mesh's bounding box (the 4th component is unused)
+//   Normal    Float3 -> SNorm16x2  octahedral encoding: the unit sphere is folded onto a square
+//   Tangent   Float3 -> SNorm16x2  as normals
+//   UV        Float2 -> Half2      unless half floats would move a UV too far (very large or tiled UVs)
+//
+// A position / normal / UV vertex goes from 32 bytes to 16, a vertex with tangents from 44 bytes to 20. The
+// vertex shaders decode the compact formats with DecodeVertex in Common.hlsli, using constants taken from the
+// packed mesh (see PositionDecoding). Full precision vertices go through the same decode, which leaves them
+// unchanged, so all the shaders work with either profile.
+//
+// PackMesh also makes the mesh's depth stream (see MeshData.h), taken from the packed positions so a depth-only
+// pass gives exactly the same depths as the full vertices. Positions are 12 bytes (8 with the compact profile)
+// where a full vertex is 32 to 44 bytes, and vertices split only by normal or UV are merged.
+//
+// The encodings are those in Packing.h. The precision lost is small: positions move by at most half of
+// 1/65535 of the mesh's size on each axis (under 1mm on a 100m mesh) and normals by 0.004 degrees. PackMesh
+// can report the errors and the memory saved for each mesh.
+
+#ifndef _VERTEX_PACKING_H_INCLUDED_
+#define _VERTEX_PACKING_H_INCLUDED_
+
+#include "MeshData.h"
+#include "CVector3.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+/*-----------------------------------------------------------------------------------------
+    Packed meshes
+-----------------------------------------------------------------------------------------*/
+
+// Vertex formats used in the GPU copy of a mesh
+enum class VertexProfile : uint32_t
+{
+    Full,    // 32-bit floats, as imported
+    Compact, // 16-bit formats, see comment at top of file
+};
+
+
+// A mesh in the form it is copied to the GPU. As MeshData but the indices may be 16-bit
+struct PackedMesh
+{
+    std::vector<VertexElement> elements;
+    std::vector<SubMesh>       subMeshes;
+    std::vector<MeshLOD>       lods;
+    std::vector<Meshlet>       meshlets;
+
+    std::vector<unsigned char> vertices;
+    uint32_t                   numVertices = 0;
+    uint32_t                   vertexSize  = 0;
+
+    std::vector<unsigned char> indices;        // numIndices * indexSize bytes
+    uint32_t                   numIndices  = 0;
+    uint32_t                   indexSize   = 4;
+
+    std::vector<unsigned char> depthVertices;  // Depth stream, see comment at top of file
+    uint32_t                   numDepthVertices = 0;
+    uint32_t                   depthVertexSize  = 0;
+    std::vector<unsigned char> depthIndices;   // numIndices * depthIndexSize bytes
+    uint32_t                   depthIndexSize   = 4;
+
+    CAABB                      boundingBox;    // Of the original positions, quantised positions are decoded with it
+    CSphere                    boundingSphere;
+
+    // View of this data, only valid until the data is changed
+    MeshDataView View() const;
+};
+
+
+// Accuracy and memory use of a packed mesh compared with the mesh it was packed from
+struct PackingReport
+{
+    size_t vertexBytesBefore = 0;
+    size_t vertexBytesAfter  = 0;
+    size_t indexBytesBefore  = 0;
+    size_t indexBytesAfter   = 0;
+    size_t depthBytes        = 0; // Depth stream vertices and indices, in addition to the above
+
+    // Largest differences between a decoded vertex and the original, 0 for elements that were not packed
+    float  maxPositionError  = 0; // Distance in model space units
+    float  maxNormalError    = 0; // Angle in degrees
+    float  maxTangentError   = 0; // Angle in degrees
+    float  maxUVError        = 0; // Largest change in u or v
+    bool   uvsKeptAsFloat    = false; // Half floats were not accurate enough for the UVs, see MAX_HALF_UV_ERROR
+};
+
+
+// Largest change in a UV the compact profile allows from half floats, half a texel of a 1024x1024 texture.
+// Half floats have 11 bits of precision, so this keeps UVs between -2 and 2 (and more where they happen to
+// be exact). If any UV would move further the UVs are left as floats
+const float MAX_HALF_UV_ERROR = 1.0f / 2048;
+
+
+// Pack the given mesh, which must use the float formats from import, with the given vertex profile. Elements
+// other than those listed at the top of the file are copied unchanged. Optionally fill in a report of the
+// errors and memory use. Pass halfUVs false to keep UVs as floats even if half floats would do, for meshes
+// packed in pieces that must all have the same layout (MeshStreaming.h)
+PackedMesh PackMesh(const MeshDataView& mesh, VertexProfile profile, PackingReport* report = nullptr, bool halfUVs = true);
+
+
+// Scale and offset that turn a quantised position read by the GPU (0 to 1 in each component) back into a
+// model space position: position = quantised * scale + offset. A mesh with float positions needs a scale of
+// 1 and offset of 0 - this returns those if the mesh's positions are not UNorm16x4
+void PositionDecoding(const MeshDataView& mesh, CVector3& scale, CVector3& offset);
+
+
+#endif //_VERTEX_PACKING_H_INCLUDED_
@@ -0,0 +1,987 @@
+//--------------------------------------------------------------------------------------
+// Native reader for DirectX .x mesh files
+//--------------------------------------------------------------------------------------
+
+#include "XFile.h"
+#include "MeshProcessing.h"
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+
+/*-----------------------------------------------------------------------------------------
+    Number parsing
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // Powers of ten that are exact in single precision (5^10 < 2^24) and double precision (5^22 < 2^53)
+    const float gFloatPowersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+    const double gDoublePowersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    inline bool IsDigit(char c)  { return c >= '0' && c <= '9'; }
+}
+
+
+// Parse a decimal number (e.g. -1.25, 3, 4.5e-3) from text that ends at end, which need not be nul
+// terminated. Returns a pointer to the character after the number or nullptr if there is no number
+const char* ParseFloat(const char* text, const char* end, float& value)
+{
+    const char* p = text;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    // Collect up to 19 significant digits (the most a uint64_t can hold) and the power of ten to scale by
+    uint64_t mantissa = 0;
+    int  numDigits = 0;
+    int  exponent  = 0;
+    bool anyDigits = false;
+    bool truncated = false;
+    while (p != end && IsDigit(*p))
+    {
+        anyDigits = true;
+        if (numDigits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0)  ++numDigits;
+        }
+        else
+        {
+            ++exponent;
+            truncated = true;
+        }
+        ++p;
+    }
+    if (p != end && *p == '.')
+    {
+        ++p;
+        while (p != end && IsDigit(*p))
+        {
+            anyDigits = true;
+            if (numDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0)  ++numDigits;
+                --exponent;
+            }
+            else
+            {
+                truncated = true;
+            }
+            ++p;
+        }
+    }
+    if (!anyDigits)  return nullptr;
+
+    // Exponent, only used if there are digits after the 'e'
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p + 1;
+        bool negativeExponent = false;
+        if (e != end && (*e == '-' || *e == '+'))
+        {
+            negativeExponent = (*e == '-');
+            ++e;
+        }
+        if (e != end && IsDigit(*e))
+        {
+            int exponentValue = 0;
+            while (e != end && IsDigit(*e))
+            {
+                if (exponentValue < 10000)  exponentValue = exponentValue * 10 + (*e - '0');
+                ++e;
+            }
+            exponent += negativeExponent ? -exponentValue : exponentValue;
+            p = e;
+        }
+    }
+
+    if (mantissa == 0)
+    {
+        value = negative ? -0.0f : 0.0f;
+    }
+    else if (!truncated && mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10)
+    {
+        // Mantissa and power of ten are both exact floats, so a single multiply or divide is correctly rounded
+        float f = static_cast<float>(mantissa);
+        value = (exponent < 0) ? f / gFloatPowersOf10[-exponent] : f * gFloatPowersOf10[exponent];
+        if (negative)  value = -value;
+    }
+    else if (!truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        // The same in double precision, rounding the result to float may rarely be 1 ulp out
+        double d = static_cast<double>(mantissa);
+        d = (exponent < 0) ? d / gDoublePowersOf10[-exponent] : d * gDoublePowersOf10[exponent];
+        value = static_cast<float>(negative ? -d : d);
+    }
+    else
+    {
+        // Rare long or large numbers use the standard library, which needs a nul terminated copy
+        std::string number(text, p);
+        value = std::strtof(number.c_str(), nullptr);
+    }
+    return p;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Tokens
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // Structure of the file as seen by the parser. Numbers, strings, GUIDs and other symbols are all Other
+    enum class Token { Name, OpenBrace, CloseBrace, Other, End };
+
+    // Tokens used in binary files (see "X File Format Reference" in the DirectX documentation)
+    enum BinaryToken : uint16_t
+    {
+        TOKEN_NAME         = 1,
+        TOKEN_STRING       = 2,
+        TOKEN_INTEGER      = 3,
+        TOKEN_GUID         = 5,
+        TOKEN_INTEGER_LIST = 6,
+        TOKEN_FLOAT_LIST   = 7,
+        TOKEN_OBRACE       = 10,
+        TOKEN_CBRACE       = 11,
+        TOKEN_OPAREN       = 12,
+        TOKEN_COMMA        = 19,
+        TOKEN_SEMICOLON    = 20,
+        TOKEN_TEMPLATE     = 31,
+        TOKEN_WORD         = 40,
+        TOKEN_CSTRING      = 51,
+        TOKEN_ARRAY        = 52,
+    };
+
+
+    // Reads tokens and numbers from the text or binary form of a .x file. Binary files hold numbers in lists,
+    // the reader works through the current list as numbers are read, so the parser is the same for both forms
+    class XFileReader
+    {
+    public:
+        // Check the file header, returns false if it is not a text or binary .x file
+        bool Open(const unsigned char* data, size_t size);
+
+        // Read the next token, skipping any numbers not yet read. Object and type names are held in Name()
+        Token Next();
+
+        const char* Name() const  { return mName; }
+        bool IsName(const char* name) const  { return std::strcmp(mName, name) == 0; }
+
+        bool ReadUInt(uint32_t& value);
+        bool ReadFloat(float& value);
+
+        // Read a count of items that take at least one byte each, checking it is not larger than the rest of
+        // the file so a damaged file can't cause a huge allocation
+        bool ReadCount(uint32_t& count);
+
+        // After an object's type name has been read, skip its (optional) name and GUID and the opening brace
+        bool OpenObject();
+
+        // Skip the rest of the current object up to and including its closing brace
+        bool SkipObject();
+
+        // The file was damaged or not understood
+        bool Failed() const  { return mFailed; }
+
+        // Bytes of the file read so far
+        size_t Offset() const  { return static_cast<size_t>(mPos - mStart); }
+
+
+    private:
+        Token NextText();
+        Token NextBinary();
+        void  SkipSeparators();
+        bool  NextBinaryList();
+
+        template <typename T>
+        bool ReadBinary(T& value)
+        {
+            if (static_cast<size_t>(mEnd - mPos) < sizeof(T))  return Fail();
+            std::memcpy(&value, mPos, sizeof(T));
+            mPos += sizeof(T);
+            return true;
+        }
+
+        bool SkipBinary(uint64_t bytes)
+        {
+            if (static_cast<uint64_t>(mEnd - mPos) < bytes)  return Fail();
+            mPos += bytes;
+            return true;
+        }
+
+        bool Fail()  { mFailed = true; return false; }
+
+        const unsigned char* mStart = nullptr;
+        const unsigned char* mPos   = nullptr;
+        const unsigned char* mEnd   = nullptr;
+        bool     mBinary     = false;
+        bool     mDoubles    = false; // Binary float lists hold doubles (file header float size 0064)
+        bool     mFailed     = false;
+        uint32_t mListCount  = 0;     // Numbers left in the current binary list
+        bool     mListFloats = false;
+        char     mName[64]   = {};
+    };
+
+
+    // Check the file header, returns false if it is not a text or binary .x file
+    bool XFileReader::Open(const unsigned char* data, size_t size)
+    {
+        // Header is "xof ", version (4 characters), format "txt " / "bin " / "tzip" / "bzip", float size
+        // "0032" / "0064"
+        if (size < 16 || std::memcmp(data, "xof ", 4) != 0)  return false;
+        if      (std::memcmp(data + 8, "txt ", 4) == 0)  mBinary = false;
+        else if (std::memcmp(data + 8, "bin ", 4) == 0)  mBinary = true;
+        else  return false; // Compressed
+        mDoubles = (std::memcmp(data + 12, "0064", 4) == 0);
+
+        mStart = data;
+        mPos   = data + 16;
+        mEnd   = data + size;
+        return true;
+    }
+
+
+    // Read the next token, skipping any numbers not yet read
+    Token XFileReader::Next()
+    {
+        mName[0] = 0;
+        return mBinary ? NextBinary() : NextText();
+    }
+
+    // Text files separate values with commas and semicolons, which the parser doesn't need. Comments start
+    // with # or //
+    void XFileReader::SkipSeparators()
+    {
+        while (mPos != mEnd)
+        {
+            char c = *mPos;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';')
+            {
+                ++mPos;
+            }
+            else if (c == '#' || (c == '/' && mEnd - mPos > 1 && mPos[1] == '/'))
+            {
+                while (mPos != mEnd && *mPos != '\n')  ++mPos;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    Token XFileReader::NextText()
+    {
+        SkipSeparators();
+        if (mPos == mEnd)  return Token::End;
+
+        char c = *mPos;
+        if (c == '{')  { ++mPos; return Token::OpenBrace;  }
+        if (c == '}')  { ++mPos; return Token::CloseBrace; }
+
+        // Names
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+        {
+            size_t length = 0;
+            while (mPos != mEnd)
+            {
+                c = *mPos;
+                if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) || c == '_' || c == '-' || c == '.'))  break;
+                if (length < sizeof(mName) - 1)  mName[length++] = c;
+                ++mPos;
+            }
+            mName[length] = 0;
+            return Token::Name;
+        }
+
+        // Strings and GUIDs
+        if (c == '"' || c == '<')
+        {
+            char close = (c == '"') ? '"' : '>';
+            ++mPos;
+            while (mPos != mEnd && *mPos != close)  ++mPos;
+            if (mPos == mEnd)  { Fail(); return Token::End; }
+            ++mPos;
+            return Token::Other;
+        }
+
+        // Anything else (numbers and symbols) up to the next separator or brace
+        do
+        {
+            ++mPos;
+        } while (mPos != mEnd && *mPos != ' ' && *mPos != '\t' && *mPos != '\r' && *mPos != '\n' &&
+                 *mPos != ',' && *mPos != ';' && *mPos != '{' && *mPos != '}');
+        return Token::Other;
+    }
+
+    Token XFileReader::NextBinary()
+    {
+        // Skip the rest of the current number list
+        if (mListCount > 0)
+        {
+            uint64_t numberSize = mListFloats ? (mDoubles ? 8 : 4) : 4;
+            if (!SkipBinary(mListCount * numberSize))  return Token::End;
+            mListCount = 0;
+        }
+
+        if (mPos == mEnd)  return Token::End;
+        uint16_t token;
+        uint32_t count;
+        if (!ReadBinary(token))  return Token::End;
+        switch (token)
+        {
+            case TOKEN_NAME:
+            {
+                if (!ReadBinary(count) || static_cast<size_t>(mEnd - mPos) < count)  { Fail(); return Token::End; }
+                size_t length = (count < sizeof(mName) - 1) ? count : sizeof(mName) - 1;
+                std::memcpy(mName, mPos, length);
+                mName[length] = 0;
+                mPos += count;
+                return Token::Name;
+            }
+
+            case TOKEN_TEMPLATE:
+                std::strcpy(mName, "template");
+                return Token::Name;
+
+            case TOKEN_OBRACE:  return Token::OpenBrace;
+            case TOKEN_CBRACE:  return Token::CloseBrace;
+
+            // String is followed by a terminating token (comma or semicolon)
+            case TOKEN_STRING:        return (ReadBinary(count) && SkipBinary(count + 2ull)) ? Token::Other : Token::End;
+            case TOKEN_INTEGER:       return SkipBinary(4) ? Token::Other : Token::End;
+            case TOKEN_GUID:          return SkipBinary(16) ? Token::Other : Token::End;
+            case TOKEN_INTEGER_LIST:  return (ReadBinary(count) && SkipBinary(count * 4ull)) ? Token::Other : Token::End;
+            case TOKEN_FLOAT_LIST:    return (ReadBinary(count) && SkipBinary(count * (mDoubles ? 8ull : 4ull))) ? Token::Other : Token::End;
+
+            default:
+                // Symbols and the keywords used in templates have no data
+                if ((token >= TOKEN_OPAREN && token <= TOKEN_SEMICOLON) || (token >= TOKEN_WORD && token <= TOKEN_ARRAY))  return Token::Other;
+                Fail();
+                return Token::End;
+        }
+    }
+
+
+    // Move on to the next binary number list if the current one is used up
+    bool XFileReader::NextBinaryList()
+    {
+        while (mListCount == 0)
+        {
+            uint16_t token;
+            if (!ReadBinary(token))  return false;
+            if (token == TOKEN_INTEGER)
+            {
+                // A single integer is read like a list of one
+                mListCount  = 1;
+                mListFloats = false;
+            }
+            else if (token == TOKEN_INTEGER_LIST || token == TOKEN_FLOAT_LIST)
+            {
+                if (!ReadBinary(mListCount))  return false;
+                mListFloats = (token == TOKEN_FLOAT_LIST);
+            }
+            else if (token != TOKEN_COMMA && token != TOKEN_SEMICOLON)
+            {
+                return Fail();
+            }
+        }
+        return true;
+    }
+
+    bool XFileReader::ReadUInt(uint32_t& value)
+    {
+        if (mBinary)
+        {
+            if (!NextBinaryList() || mListFloats)  return Fail();
+            --mListCount;
+            return ReadBinary(value);
+        }
+
+        SkipSeparators();
+        if (mPos == mEnd || !IsDigit(*mPos))  return Fail();
+        uint64_t result = 0;
+        while (mPos != mEnd && IsDigit(*mPos))
+        {
+            result = result * 10 + (*mPos - '0');
+            if (result > 0xffffffffu)  return Fail();
+            ++mPos;
+        }
+        value = static_cast<uint32_t>(result);
+        return true;
+    }
+
+    bool XFileReader::ReadFloat(float& value)
+    {
+        if (mBinary)
+        {
+            if (!NextBinaryList() || !mListFloats)  return Fail();
+            --mListCount;
+            if (!mDoubles)  return ReadBinary(value);
+            double d;
+            if (!ReadBinary(d))  return false;
+            value = static_cast<float>(d);
+            return true;
+        }
+
+        SkipSeparators();
+        const char* end = ParseFloat(reinterpret_cast<const char*>(mPos), reinterpret_cast<const char*>(mEnd), value);
+        if (end == nullptr)  return Fail();
+        mPos = reinterpret_cast<const unsigned char*>(end);
+        return true;
+    }
+
+    bool XFileReader::ReadCount(uint32_t& count)
+    {
+        if (!ReadUInt(count))  return false;
+        if (count > static_cast<size_t>(mEnd - mPos))  return Fail();
+        return true;
+    }
+
+
+    // After an object's type name has been read, skip its (optional) name and GUID and the opening brace
+    bool XFileReader::OpenObject()
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            Token token = Next();
+            if (token == Token::OpenBrace)  return true;
+            if (token != Token::Name && token != Token::Other)  break;
+        }
+        return Fail();
+    }
+
+    // Skip the rest of the current object up to and including its closing brace
+    bool XFileReader::SkipObject()
+    {
+        int depth = 1;
+        for (;;)
+        {
+            Token token = Next();
+            if      (token == Token::OpenBrace)   ++depth;
+            else if (token == Token::CloseBrace)  { if (--depth == 0)  return true; }
+            else if (token == Token::End)         return Fail();
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Parser
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    const uint32_t NO_VERTEX = 0xffffffff;
+
+    const CMatrix3x4 gIdentity3x4 = ToMatrix3x4(MatrixIdentity());
+
+    // Walks the objects in a .x file, passing each Mesh object with the transform of its frames to ParseMesh
+    class XFileWalker
+    {
+    public:
+        explicit XFileWalker(XFileReader& reader) : mReader(reader) {}
+        virtual ~XFileWalker() {}
+
+    protected:
+        // Parse every object in the file. Returns false if the file can't be read or ParseMesh fails
+        bool ParseObjects();
+
+        // Parse the contents of a Mesh object, after its opening brace, up to and including its closing brace
+        virtual bool ParseMesh(const CMatrix3x4& transform) = 0;
+
+        bool ParseObject(Token token, const CMatrix3x4& transform);
+        bool ParseFrame(const CMatrix3x4& parentTransform);
+
+        XFileReader& mReader;
+    };
+
+
+    // Reads the objects in a .x file, adding each Mesh object to the output as a sub-mesh
+    class XFileParser : public XFileWalker
+    {
+    public:
+        XFileParser(XFileReader& reader, MeshData& mesh) : XFileWalker(reader), mMesh(mesh) {}
+
+        bool Parse();
+
+    private:
+        bool ParseMesh(const CMatrix3x4& transform) override;
+        bool ReadFaces(std::vector<uint32_t>& faceSizes, std::vector<uint32_t>& faceIndices, uint32_t numVertices);
+        bool AddSubMesh(const CMatrix3x4& transform);
+
+        MeshData&    mMesh;
+
+        uint32_t mPositionOffset;
+        uint32_t mNormalOffset;
+        uint32_t mUVOffset;
+        bool     mAnyUVs = false;
+        bool     mAnyMissingNormals = false;
+
+        // Data for the current Mesh object, kept between meshes to reuse the memory
+        std::vector<CVector3> mPositions;
+        std::vector<uint32_t> mFaceSizes;         // Number of corners in each face
+        std::vector<uint32_t> mFaceIndices;       // Position index of each corner of each face in turn
+        std::vector<CVector3> mNormals;
+        std::vector<uint32_t> mNormalFaceSizes;
+        std::vector<uint32_t> mNormalFaceIndices; // Normal index of each corner
+        std::vector<CVector2> mUVs;               // One for each position
+
+        // Vertex sharing: vertices with the same position index are linked in a list starting at
+        // mFirstVertex[position], the vertex is reused if its normal index matches
+        std::vector<uint32_t> mFirstVertex;
+        std::vector<uint32_t> mNextVertex;
+        std::vector<uint32_t> mVertexNormal;
+        std::vector<uint32_t> mCornerVertex;
+    };
+
+
+    bool XFileParser::Parse()
+    {
+        mMesh = MeshData();
+        mPositionOffset = mMesh.AddElement("Position", VertexFormat::Float3);
+        mNormalOffset   = mMesh.AddElement("Normal",   VertexFormat::Float3);
+        mUVOffset       = mMesh.AddElement("UV",       VertexFormat::Float2);
+
+        if (!ParseObjects() || mMesh.subMeshes.empty())  return false;
+
+        // Remove the UVs from the layout if no mesh had any
+        if (!mAnyUVs)
+        {
+            uint32_t oldSize = mMesh.vertexSize;
+            uint32_t newSize = oldSize - VertexFormatSize(VertexFormat::Float2);
+            for (uint32_t i = 0; i < mMesh.numVertices; ++i)
+            {
+                std::memmove(&mMesh.vertices[i * newSize], &mMesh.vertices[i * oldSize], newSize);
+            }
+            mMesh.elements.pop_back();
+            mMesh.vertexSize = newSize;
+            mMesh.vertices.resize(mMesh.numVertices * newSize);
+        }
+
+        if (mAnyMissingNormals)  GenerateSmoothNormals(mMesh, MAX_SMOOTHING_ANGLE, false);
+        CalculateBounds(mMesh);
+        return true;
+    }
+
+
+    // Parse every object in the file
+    bool XFileWalker::ParseObjects()
+    {
+        for (;;)
+        {
+            Token token = mReader.Next();
+            if (token == Token::End)  break;
+            if (token == Token::CloseBrace || !ParseObject(token, gIdentity3x4))  return false;
+        }
+        return !mReader.Failed();
+    }
+
+
+    // Parse an object whose first token has been read, in a frame with the given transform
+    bool XFileWalker::ParseObject(Token token, const CMatrix3x4& transform)
+    {
+        if (token == Token::Name)
+        {
+            if (mReader.IsName("Frame"))  return mReader.OpenObject() && ParseFrame(transform);
+            if (mReader.IsName("Mesh"))   return mReader.OpenObject() && ParseMesh(transform);
+
+            // Templates, materials, animation etc.
+            return mReader.OpenObject() && mReader.SkipObject();
+        }
+        if (token == Token::OpenBrace)  return mReader.SkipObject(); // Reference to another object, e.g. { MaterialName }
+        return token == Token::Other;
+    }
+
+
+    // Parse the contents of a Frame, its transform is relative to its parent
+    bool XFileWalker::ParseFrame(const CMatrix3x4& parentTransform)
+    {
+        CMatrix3x4 transform = parentTransform;
+        bool hasChildren = false;
+        for (;;)
+        {
+            Token token = mReader.Next();
+            if (token == Token::CloseBrace)  return true;
+            if (token == Token::End)  return false;
+
+            if (token == Token::Name && mReader.IsName("FrameTransformMatrix"))
+            {
+                // Children already read used the wrong transform, the file is unusual enough to leave to assimp
+                if (hasChildren || !mReader.OpenObject())  return false;
+
+                // Stored in the same order as CMatrix4x4 (row vectors, e00, e01, e02...)
+                float m[16];
+                for (int i = 0; i < 16; ++i)
+                {
+                    if (!mReader.ReadFloat(m[i]))  return false;
+                }
+                if (!mReader.SkipObject())  return false;
+
+                CMatrix3x4 local = { m[0], m[4], m[8],  m[12],
+                                     m[1], m[5], m[9],  m[13],
+                                     m[2], m[6], m[10], m[14] };
+                transform = local * parentTransform;
+            }
+            else
+            {
+                hasChildren = hasChildren || token == Token::Name;
+                if (!ParseObject(token, transform))  return false;
+            }
+        }
+    }
+
+
+    // Read a list of faces: count then each face as a number of corners followed by that many indices
+    bool XFileParser::ReadFaces(std::vector<uint32_t>& faceSizes, std::vector<uint32_t>& faceIndices, uint32_t numVertices)
+    {
+        uint32_t numFaces;
+        if (!mReader.ReadCount(numFaces))  return false;
+        faceSizes.resize(numFaces);
+        faceIndices.clear();
+        faceIndices.reserve(numFaces * 3);
+        for (uint32_t face = 0; face < numFaces; ++face)
+        {
+            uint32_t faceSize;
+            if (!mReader.ReadCount(faceSize))  return false;
+            faceSizes[face] = faceSize;
+            for (uint32_t corner = 0; corner < faceSize; ++corner)
+            {
+                uint32_t index;
+                if (!mReader.ReadUInt(index) || index >= numVertices)  return false;
+                faceIndices.push_back(index);
+            }
+        }
+        return true;
+    }
+
+
+    // Parse the contents of a Mesh and add it as a sub-mesh
+    bool XFileParser::ParseMesh(const CMatrix3x4& transform)
+    {
+        uint32_t numPositions;
+        if (!mReader.ReadCount(numPositions))  return false;
+        mPositions.resize(numPositions);
+        for (CVector3& position : mPositions)
+        {
+            if (!mReader.ReadFloat(position.x) || !mReader.ReadFloat(position.y) || !mReader.ReadFloat(position.z))  return false;
+        }
+        if (!ReadFaces(mFaceSizes, mFaceIndices, numPositions))  return false;
+
+        mNormals.clear();
+        mUVs.clear();
+        for (;;)
+        {
+            Token token = mReader.Next();
+            if (token == Token::CloseBrace)  break;
+            if (token == Token::End)  return false;
+
+            if (token == Token::Name && mReader.IsName("MeshNormals"))
+            {
+                uint32_t numNormals;
+                if (!mReader.OpenObject() || !mReader.ReadCount(numNormals))  return false;
+                mNormals.resize(numNormals);
+                for (CVector3& normal : mNormals)
+                {
+                    if (!mReader.ReadFloat(normal.x) || !mReader.ReadFloat(normal.y) || !mReader.ReadFloat(normal.z))  return false;
+                }
+                if (!ReadFaces(mNormalFaceSizes, mNormalFaceIndices, numNormals) || !mReader.SkipObject())  return false;
+            }
+            else if (token == Token::Name && mReader.IsName("MeshTextureCoords") && mUVs.empty())
+            {
+                uint32_t numUVs;
+                if (!mReader.OpenObject() || !mReader.ReadCount(numUVs))  return false;
+                mUVs.resize(numUVs);
+                for (CVector2& uv : mUVs)
+                {
+                    if (!mReader.ReadFloat(uv.x) || !mReader.ReadFloat(uv.y))  return false;
+                }
+                if (!mReader.SkipObject())  return false;
+            }
+            else if (!ParseObject(token, transform))
+            {
+                return false;
+            }
+        }
+
+        return AddSubMesh(transform);
+    }
+
+
+    // Add the current mesh to the output, one vertex for each different position / normal pair used
+    bool XFileParser::AddSubMesh(const CMatrix3x4& transform)
+    {
+        // Meshes without normals get zero normals, which are calculated once the whole file is read. Otherwise
+        // the normal faces must match the faces
+        bool hasNormals = !mNormals.empty();
+        if (hasNormals && mNormalFaceSizes != mFaceSizes)  return false;
+        mAnyMissingNormals = mAnyMissingNormals || !hasNormals;
+        bool hasUVs = !mUVs.empty();
+        if (hasUVs && mUVs.size() != mPositions.size())  return false;
+        mAnyUVs = mAnyUVs || hasUVs;
+
+        // Normals are transformed by the inverse transpose of the transform to stay at right angles to the surface
+        bool identity = std::memcmp(&transform, &gIdentity3x4, sizeof(CMatrix3x4)) == 0;
+        CMatrix3x4 inverse = InverseAffine(transform);
+
+        uint32_t vertexSize = mMesh.vertexSize;
+        uint32_t numCorners = static_cast<uint32_t>(mFaceIndices.size());
+        uint32_t baseVertex = mMesh.numVertices;
+        mMesh.vertices.resize((baseVertex + numCorners) * static_cast<size_t>(vertexSize)); // Enough for every corner to be a new vertex
+        unsigned char* vertices = mMesh.vertices.data() + baseVertex * static_cast<size_t>(vertexSize);
+
+        mFirstVertex.assign(mPositions.size(), NO_VERTEX);
+        mNextVertex.resize(numCorners);
+        mVertexNormal.resize(numCorners);
+        mCornerVertex.resize(numCorners);
+        uint32_t numVertices = 0;
+        for (uint32_t corner = 0; corner < numCorners; ++corner)
+        {
+            uint32_t position = mFaceIndices[corner];
+            uint32_t normal   = hasNormals ? mNormalFaceIndices[corner] : 0;
+
+            uint32_t vertex = mFirstVertex[position];
+            while (vertex != NO_VERTEX && mVertexNormal[vertex] != normal)  vertex = mNextVertex[vertex];
+            if (vertex == NO_VERTEX)
+            {
+                vertex = numVertices++;
+                mVertexNormal[vertex] = normal;
+                mNextVertex[vertex] = mFirstVertex[position];
+                mFirstVertex[position] = vertex;
+
+                unsigned char* v = vertices + vertex * static_cast<size_t>(vertexSize);
+                CVector3 p = mPositions[position];
+                CVector3 n = hasNormals ? mNormals[normal] : CVector3{ 0, 0, 0 };
+                if (!identity)
+                {
+                    p = TransformPoint(p, transform);
+                    if (hasNormals)  n = Normalise({ Dot(n, inverse.GetXAxis()), Dot(n, inverse.GetYAxis()), Dot(n, inverse.GetZAxis()) });
+                }
+                *(CVector3*)(v + mPositionOffset) = p;
+                *(CVector3*)(v + mNormalOffset)   = n;
+                if (hasUVs)  *(CVector2*)(v + mUVOffset) = mUVs[position];
+            }
+            mCornerVertex[corner] = vertex;
+        }
+        mMesh.vertices.resize((baseVertex + numVertices) * static_cast<size_t>(vertexSize));
+
+        // Split faces into triangle fans, leaving out triangles with two corners in the same place
+        SubMesh subMesh;
+        subMesh.startIndex  = static_cast<uint32_t>(mMesh.indices.size());
+        subMesh.baseVertex  = baseVertex;
+        subMesh.numVertices = numVertices;
+        uint32_t faceStart = 0;
+        for (uint32_t faceSize : mFaceSizes)
+        {
+            for (uint32_t i = 2; i < faceSize; ++i)
+            {
+                uint32_t corners[3] = { faceStart, faceStart + i - 1, faceStart + i };
+                const CVector3& p0 = mPositions[mFaceIndices[corners[0]]];
+                const CVector3& p1 = mPositions[mFaceIndices[corners[1]]];
+                const CVector3& p2 = mPositions[mFaceIndices[corners[2]]];
+                if ((p0.x == p1.x && p0.y == p1.y && p0.z == p1.z) ||
+                    (p1.x == p2.x && p1.y == p2.y && p1.z == p2.z) ||
+                    (p2.x == p0.x && p2.y == p0.y && p2.z == p0.z))  continue;
+
+                for (uint32_t c : corners)  mMesh.indices.push_back(mCornerVertex[c]);
+            }
+            faceStart += faceSize;
+        }
+        subMesh.numIndices = static_cast<uint32_t>(mMesh.indices.size()) - subMesh.startIndex;
+
+        // Meshes with no triangles left are dropped (as assimp does)
+        if (subMesh.numIndices == 0)
+        {
+            mMesh.vertices.resize(baseVertex * static_cast<size_t>(vertexSize));
+            return true;
+        }
+        mMesh.subMeshes.push_back(subMesh);
+        mMesh.numVertices += numVertices;
+        return true;
+    }
+
+
+    // Largest polygon StreamXFile reads, so a damaged count can't make it allocate more than a little memory
+    const uint32_t MAX_STREAMED_FACE_CORNERS = 65536;
+
+    // Passes the contents of each Mesh object in a .x file to a sink as it is read, holding nothing but the
+    // current face. Parts of the file already read are released from memory as it goes
+    class XFileStreamParser : public XFileWalker
+    {
+    public:
+        XFileStreamParser(XFileReader& reader, const MappedFile& file, XFileStreamSink& sink, size_t readWindow)
+            : XFileWalker(reader), mFile(file), mSink(sink), mReadWindow(std::max<size_t>(readWindow, 1)) {}
+
+        bool Parse()  { return ParseObjects() && mAnyMeshes; }
+
+    private:
+        bool ParseMesh(const CMatrix3x4& transform) override;
+        bool ReadFaces(uint32_t numVertices, bool normals, uint32_t& numFaces, uint64_t& numCorners);
+        void ReleaseRead();
+
+        const MappedFile& mFile;
+        XFileStreamSink&  mSink;
+        size_t mReadWindow;
+        bool   mAnyMeshes = false;
+        size_t mReleased  = 0;     // Bytes at the start of the file already released
+
+        std::vector<uint32_t> mFace;
+    };
+
+
+    // Parse the contents of a Mesh, passing it to the sink
+    bool XFileStreamParser::ParseMesh(const CMatrix3x4& transform)
+    {
+        // Normals are transformed by the inverse transpose of the transform to stay at right angles to the surface
+        bool identity = std::memcmp(&transform, &gIdentity3x4, sizeof(CMatrix3x4)) == 0;
+        CMatrix3x4 inverse = InverseAffine(transform);
+
+        uint32_t numPositions;
+        if (!mReader.ReadCount(numPositions) || !mSink.BeginMesh(numPositions))  return false;
+        for (uint32_t i = 0; i < numPositions; ++i)
+        {
+            CVector3 p;
+            if (!mReader.ReadFloat(p.x) || !mReader.ReadFloat(p.y) || !mReader.ReadFloat(p.z))  return false;
+            if (!mSink.Position(identity ? p : TransformPoint(p, transform)))  return false;
+            if ((i & 0xfff) == 0)  ReleaseRead();
+        }
+        uint32_t numFaces;
+        uint64_t numCorners;
+        if (!ReadFaces(numPositions, false, numFaces, numCorners))  return false;
+
+        // The normal faces must have as many faces and corners as the faces, a damaged file that still matches
+        // these totals gives the wrong normals but nothing worse
+        bool hasNormals = false;
+        bool hasUVs     = false;
+        for (;;)
+        {
+            Token token = mReader.Next();
+            if (token == Token::CloseBrace)  break;
+            if (token == Token::End)  return false;
+
+            if (token == Token::Name && mReader.IsName("MeshNormals"))
+            {
+                uint32_t numNormals;
+                if (hasNormals || !mReader.OpenObject() || !mReader.ReadCount(numNormals) || !mSink.BeginNormals(numNormals))  return false;
+                hasNormals = true;
+                for (uint32_t i = 0; i < numNormals; ++i)
+                {
+                    CVector3 n;
+                    if (!mReader.ReadFloat(n.x) || !mReader.ReadFloat(n.y) || !mReader.ReadFloat(n.z))  return false;
+                    if (!identity)  n = Normalise({ Dot(n, inverse.GetXAxis()), Dot(n, inverse.GetYAxis()), Dot(n, inverse.GetZAxis()) });
+                    if (!mSink.Normal(n))  return false;
+                    if ((i & 0xfff) == 0)  ReleaseRead();
+                }
+                uint32_t numNormalFaces;
+                uint64_t numNormalCorners;
+                if (!ReadFaces(numNormals, true, numNormalFaces, numNormalCorners) ||
+                    numNormalFaces != numFaces || numNormalCorners != numCorners || !mReader.SkipObject())  return false;
+            }
+            else if (token == Token::Name && mReader.IsName("MeshTextureCoords") && !hasUVs)
+            {
+                uint32_t numUVs;
+                if (!mReader.OpenObject() || !mReader.ReadCount(numUVs) || numUVs != numPositions)  return false;
+                hasUVs = true;
+                for (uint32_t i = 0; i < numUVs; ++i)
+                {
+                    CVector2 uv;
+                    if (!mReader.ReadFloat(uv.x) || !mReader.ReadFloat(uv.y) || !mSink.UV(uv))  return false;
+                    if ((i & 0xfff) == 0)  ReleaseRead();
+                }
+                if (!mReader.SkipObject())  return false;
+            }
+            else if (!ParseObject(token, transform))
+            {
+                return false;
+            }
+        }
+
+        mAnyMeshes = true;
+        return mSink.EndMesh();
+    }
+
+
+    // Read a list of faces: count then each face as a number of corners followed by that many indices, passing
+    // each to the sink as a face or a normal face. Gives the number of faces and the total number of corners
+    bool XFileStreamParser::ReadFaces(uint32_t numVertices, bool normals, uint32_t& numFaces, uint64_t& numCorners)
+    {
+        if (!mReader.ReadCount(numFaces))  return false;
+        numCorners = 0;
+        for (uint32_t face = 0; face < numFaces; ++face)
+        {
+            uint32_t faceSize;
+            if (!mReader.ReadCount(faceSize) || faceSize > MAX_STREAMED_FACE_CORNERS)  return false;
+            mFace.resize(faceSize);
+            for (uint32_t& index : mFace)
+            {
+                if (!mReader.ReadUInt(index) || index >= numVertices)  return false;
+            }
+            if (!(normals ? mSink.NormalFace(mFace.data(), faceSize) : mSink.Face(mFace.data(), faceSize)))  return false;
+            numCorners += faceSize;
+            if ((face & 0xfff) == 0)  ReleaseRead();
+        }
+        return true;
+    }
+
+
+    // Release the file up to the read position once a read window's worth has been read, so a file larger than
+    // memory can be read
+    void XFileStreamParser::ReleaseRead()
+    {
+        size_t offset = mReader.Offset();
+        if (offset - mReleased >= mReadWindow)
+        {
+            size_t size = (offset - mReleased) / mReadWindow * mReadWindow;
+            mFile.Release(mReleased, size);
+            mReleased += size;
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Loading
+-----------------------------------------------------------------------------------------*/
+
+// Read the .x file held in the given memory into mesh (replacing its contents). Returns false if the file
+// can't be read by this code
+bool LoadXFile(const void* data, size_t size, MeshData& mesh)
+{
+    XFileReader reader;
+    if (!reader.Open(static_cast<const unsigned char*>(data), size))  return false;
+
+    XFileParser parser(reader, mesh);
+    if (!parser.Parse())
+    {
+        mesh = MeshData();
+        return false;
+    }
+    return true;
+}
+
+
+// Read the mapped .x file, passing each mesh's positions, faces, normals and UVs to the sink as they are read.
+// The parts of the file read are released from memory every readWindow bytes. Returns false if the file can't
+// be read by this code, has no meshes or the sink stops it
+bool StreamXFile(const MappedFile& file, XFileStreamSink& sink, size_t readWindow /*= 16 * 1024 * 1024*/)
+{
+    XFileReader reader;
+    if (!reader.Open(static_cast<const unsigned char*>(file.Data()), file.Size()))  return false;
+
+    XFileStreamParser parser(reader, file, sink, readWindow);
+    return parser.Parse();
+}
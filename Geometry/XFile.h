@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// Native reader for DirectX .x mesh files
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Reads the geometry of text and binary .x files (not the compressed tzip / bzip versions) straight into the
+// vertex layout the Mesh class uses, without assimp's general purpose importer or its scene graph. The file
+// is read in place (e.g. from a MappedFile) and the only allocations are the output buffers and a few
+// scratch arrays sized from the counts in the file, reused for each mesh.
+//
+// Each Mesh object in the file becomes a sub-mesh of position, normal and UV vertices (UVs are left out if no
+// mesh has texture coordinates). Frame transforms are applied to the vertices, polygons are split into
+// triangles and degenerate triangles are removed. Meshes without normals are given smooth normals
+// (MeshProcessing.h). This gives the same geometry as the assimp import in AssimpImport.h, except that
+// vertices are only shared where the file shares them (the assimp import also welds separate but identical
+// vertices).
+//
+// StreamXFile reads the same files for meshes too large to hold in memory (MeshStreaming.h). Rather than
+// building a mesh it passes each Mesh object's positions, faces, normals and UVs to a sink as they are read,
+// with frame transforms applied, and releases the parts of the mapped file it has read. It holds no more than
+// one face, so it checks less than LoadXFile: the normal faces must have the same number of faces and corners
+// as the faces, but the size of each face isn't compared.
+//
+// Anything the reader doesn't handle - compressed files, a frame transform after
+// the meshes it applies to, damaged files - makes it return false so the caller can fall back to assimp.
+// Materials, skinning, animation and other objects are skipped.
+
+#ifndef _XFILE_H_INCLUDED_
+#define _XFILE_H_INCLUDED_
+
+#include "MeshData.h"
+#include "MappedFile.h"
+#include "CVector2.h"
+#include "CVector3.h"
+
+#include <cstdint>
+#include <cstddef>
+
+
+// Read the .x file held in the given memory into mesh (replacing its contents). Returns false if the file
+// can't be read by this code, see comment at top of file
+bool LoadXFile(const void* data, size_t size, MeshData& mesh);
+
+
+// Receives the contents of a .x file from StreamXFile, see comment at top of file. For each Mesh object in the
+// file there is a call to BeginMesh, then its positions, faces, normals (if it has any) and UVs (if it has any),
+// then EndMesh. Indices are relative to the start of the current mesh's positions or normals. Each function
+// returns false to stop reading
+class XFileStreamSink
+{
+public:
+    virtual ~XFileStreamSink() {}
+
+    virtual bool BeginMesh(uint32_t numPositions) = 0;
+    virtual bool Position(const CVector3& position) = 0;                       // Frame transforms already applied
+    virtual bool Face(const uint32_t* positions, uint32_t numCorners) = 0;     // A polygon, any number of corners
+
+    virtual bool BeginNormals(uint32_t numNormals) = 0;
+    virtual bool Normal(const CVector3& normal) = 0;
+    virtual bool NormalFace(const uint32_t* normals, uint32_t numCorners) = 0; // One for each face, in the same order
+
+    virtual bool UV(const CVector2& uv) = 0;                                   // One for each position
+    virtual bool EndMesh() = 0;
+};
+
+// Read the mapped .x file, passing its contents to the sink as they are read (see comment at top of file).
+// The parts of the file read are released from memory every readWindow bytes, so no more than about that much
+// of the file is in memory at once. Returns false if the file can't be read by this code, has no meshes or the
+// sink stops it
+bool StreamXFile(const MappedFile& file, XFileStreamSink& sink, size_t readWindow = 16 * 1024 * 1024);
+
+
+// Parse a decimal number (e.g. -1.25, 3, 4.5e-3) from text that ends at end, which need not be nul
+// terminated. Returns a pointer to the character after the number or nullptr if there is no number.
+// Numbers with up to 7 significant digits and a power of ten up to 10 either way (e.g. 123.4567) are
+// correctly rounded. Others are calculated in double precision and may be 1 ulp out, except very long or
+// large numbers, which use std::strtof
+const char* ParseFloat(const char* text, const char* end, float& value);
+
+
+#endif //_XFILE_H_INCLUDED_
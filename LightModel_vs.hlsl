@@ -15,6 +15,7 @@
 SimplePixelShaderInput main(BasicVertex modelVertex)
 {
     SimplePixelShaderInput output; // This is the data the pixel shader requires from this vertex shader
+    modelVertex = DecodeVertex(modelVertex); // Unpack compact vertex formats (see Common.hlsli)
 
 
     // Input position is x,y,z only - need a 4th element to multiply by a 4x4 matrix. Use 1 for a point (0 for a vector) - recall lectures
@@ -23,7 +24,7 @@ SimplePixelShaderInput main(BasicVertex modelVertex)
     // Multiply by the world matrix passed from C++ to transform the model vertex position into world space. 
     // In a similar way use the view matrix to transform the vertex from world space into view space (camera's point of view)
     // and then use the projection matrix to transform the vertex to 2D projection space (project onto the 2D screen)
-    float4 worldPosition     = mul(gWorldMatrix,      modelPosition);
+    float4 worldPosition     = float4(mul(gWorldMatrix, modelPosition), 1);
     float4 viewPosition      = mul(gViewMatrix,       worldPosition);
     output.projectedPosition = mul(gProjectionMatrix, viewPosition);
 
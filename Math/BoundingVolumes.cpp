@@ -0,0 +1,286 @@
+//--------------------------------------------------------------------------------------
+// Bounding volumes (axis-aligned box, sphere), planes and view frustums for visibility tests
+//--------------------------------------------------------------------------------------
+
+#include "BoundingVolumes.h"
+#include "TransformBatch.h"
+#include "MathHelpers.h"
+#include "MathSIMD.h"
+#include <cmath>
+#include <cstring>
+
+
+/*-----------------------------------------------------------------------------------------
+    Construction
+-----------------------------------------------------------------------------------------*/
+
+// Return an AABB from its smallest and largest corners
+CAABB AABBFromMinMax(const CVector3& minimum, const CVector3& maximum)
+{
+    return CAABB{ (minimum + maximum) * 0.5f, (maximum - minimum) * 0.5f };
+}
+
+// Return a plane with unit normal, the same plane as the one given (which can have any non-zero normal)
+CPlane Normalise(const CPlane& plane)
+{
+    float length = Length(plane.normal);
+    if (IsZero(length))  return plane;
+
+    float invLength = 1.0f / length;
+    return CPlane{ plane.normal * invLength, plane.d * invLength };
+}
+
+// Extract the frustum planes from a view-projection matrix (e.g. Camera::ViewProjectionMatrix), so the
+// planes are in world space. Pass a projection matrix alone to get the planes in camera space
+CFrustum FrustumFromMatrix(const CMatrix4x4& m)
+{
+    // A point p is transformed to clip space (x,y,z,w) by multiplying the row vector (p,1) with each column
+    // of the matrix. It is inside the frustum if -w <= x <= w, -w <= y <= w and 0 <= z <= w (DirectX depth
+    // range), so each plane is a sum or difference of the 4th column with one of the others
+    CPlane column0{ { m.e00, m.e10, m.e20 }, m.e30 };
+    CPlane column1{ { m.e01, m.e11, m.e21 }, m.e31 };
+    CPlane column2{ { m.e02, m.e12, m.e22 }, m.e32 };
+    CPlane column3{ { m.e03, m.e13, m.e23 }, m.e33 };
+
+    CFrustum frustum;
+    frustum.planes[CFrustum::Left]   = Normalise(CPlane{ column3.normal + column0.normal, column3.d + column0.d });
+    frustum.planes[CFrustum::Right]  = Normalise(CPlane{ column3.normal - column0.normal, column3.d - column0.d });
+    frustum.planes[CFrustum::Bottom] = Normalise(CPlane{ column3.normal + column1.normal, column3.d + column1.d });
+    frustum.planes[CFrustum::Top]    = Normalise(CPlane{ column3.normal - column1.normal, column3.d - column1.d });
+    frustum.planes[CFrustum::Near]   = Normalise(column2);
+    frustum.planes[CFrustum::Far]    = Normalise(CPlane{ column3.normal - column2.normal, column3.d - column2.d });
+    return frustum;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Transformation
+-----------------------------------------------------------------------------------------*/
+
+// Return the AABB enclosing the given box after it has been transformed by an affine matrix (e.g. a
+// model's local box to a world space box). The result is a little larger than the box if rotated
+// Works for CMatrix4x4 and CMatrix3x4, which use the same element names
+template <typename Matrix>
+static CAABB TransformAABBImpl(const CAABB& box, const Matrix& m)
+{
+    // Each new half-size is the sum of the absolute contributions of the old x, y and z extents
+    const CVector3& h = box.halfSize;
+    return CAABB{ TransformPoint(box.centre, m),
+                  { std::abs(m.e00) * h.x + std::abs(m.e10) * h.y + std::abs(m.e20) * h.z,
+                    std::abs(m.e01) * h.x + std::abs(m.e11) * h.y + std::abs(m.e21) * h.z,
+                    std::abs(m.e02) * h.x + std::abs(m.e12) * h.y + std::abs(m.e22) * h.z } };
+}
+
+CAABB TransformAABB(const CAABB& box, const CMatrix4x4& m)  { return TransformAABBImpl(box, m); }
+CAABB TransformAABB(const CAABB& box, const CMatrix3x4& m)  { return TransformAABBImpl(box, m); }
+
+
+// Return the sphere enclosing the given sphere after it has been transformed by an affine matrix. The
+// radius is scaled by the largest scale in the matrix
+template <typename Matrix>
+static CSphere TransformSphereImpl(const CSphere& sphere, const Matrix& m)
+{
+    CVector3 scale = m.GetScale();
+    float maxScale = scale.x > scale.y ? scale.x : scale.y;
+    if (scale.z > maxScale)  maxScale = scale.z;
+
+    return CSphere{ TransformPoint(sphere.centre, m), sphere.radius * maxScale };
+}
+
+CSphere TransformSphere(const CSphere& sphere, const CMatrix4x4& m)  { return TransformSphereImpl(sphere, m); }
+CSphere TransformSphere(const CSphere& sphere, const CMatrix3x4& m)  { return TransformSphereImpl(sphere, m); }
+
+
+/*-----------------------------------------------------------------------------------------
+    Intersection tests
+-----------------------------------------------------------------------------------------*/
+
+bool Intersects(const CAABB& a, const CAABB& b)
+{
+    CVector3 d = a.centre - b.centre;
+    return std::abs(d.x) <= a.halfSize.x + b.halfSize.x &&
+           std::abs(d.y) <= a.halfSize.y + b.halfSize.y &&
+           std::abs(d.z) <= a.halfSize.z + b.halfSize.z;
+}
+
+bool Intersects(const CSphere& a, const CSphere& b)
+{
+    CVector3 d = a.centre - b.centre;
+    float radii = a.radius + b.radius;
+    return Dot(d, d) <= radii * radii;
+}
+
+bool Intersects(const CAABB& box, const CSphere& sphere)
+{
+    // Distance squared from sphere centre to the nearest point in the box
+    CVector3 d = sphere.centre - box.centre;
+    float dx = std::abs(d.x) - box.halfSize.x;
+    float dy = std::abs(d.y) - box.halfSize.y;
+    float dz = std::abs(d.z) - box.halfSize.z;
+    float distanceSq = 0.0f;
+    if (dx > 0)  distanceSq += dx * dx;
+    if (dy > 0)  distanceSq += dy * dy;
+    if (dz > 0)  distanceSq += dz * dz;
+    return distanceSq <= sphere.radius * sphere.radius;
+}
+
+
+// Return true if the volume is at least partly inside the frustum (conservative - see header)
+bool IsVisible(const CFrustum& frustum, const CSphere& sphere)
+{
+    for (int i = 0; i < CFrustum::NumPlanes; ++i)
+    {
+        if (frustum.planes[i].Distance(sphere.centre) < -sphere.radius)  return false;
+    }
+    return true;
+}
+
+bool IsVisible(const CFrustum& frustum, const CAABB& box)
+{
+    for (int i = 0; i < CFrustum::NumPlanes; ++i)
+    {
+        // Distance from box centre to its corner furthest in front of the plane, measured along the plane normal
+        const CVector3& n = frustum.planes[i].normal;
+        float extent = std::abs(n.x) * box.halfSize.x + std::abs(n.y) * box.halfSize.y + std::abs(n.z) * box.halfSize.z;
+        if (frustum.planes[i].Distance(box.centre) < -extent)  return false;
+    }
+    return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Batch frustum culling
+-----------------------------------------------------------------------------------------*/
+
+// Frustum planes with every value copied across all SIMD lanes - prepared once per batch
+struct FrustumSplat
+{
+    SimdFloat nx[CFrustum::NumPlanes], ny[CFrustum::NumPlanes], nz[CFrustum::NumPlanes], d[CFrustum::NumPlanes];
+    SimdFloat absNx[CFrustum::NumPlanes], absNy[CFrustum::NumPlanes], absNz[CFrustum::NumPlanes];
+
+    FrustumSplat(const CFrustum& frustum)
+    {
+        for (int i = 0; i < CFrustum::NumPlanes; ++i)
+        {
+            const CPlane& plane = frustum.planes[i];
+            nx[i] = SimdSet1(plane.normal.x);
+            ny[i] = SimdSet1(plane.normal.y);
+            nz[i] = SimdSet1(plane.normal.z);
+            d[i]  = SimdSet1(plane.d);
+            absNx[i] = SimdSet1(std::abs(plane.normal.x));
+            absNy[i] = SimdSet1(std::abs(plane.normal.y));
+            absNz[i] = SimdSet1(std::abs(plane.normal.z));
+        }
+    }
+};
+
+
+// Return bits set for each lane where the sphere is outside the frustum
+static inline int SpheresOutside(const FrustumSplat& f, const float* x, const float* y, const float* z, const float* r)
+{
+    SimdFloat cx = SimdLoad(x), cy = SimdLoad(y), cz = SimdLoad(z);
+    SimdFloat negRadius = SimdSub(SimdSet1(0.0f), SimdLoad(r));
+
+    SimdMask outside = SimdCmpLT(SimdSet1(0.0f), SimdSet1(0.0f)); // All false
+    for (int i = 0; i < CFrustum::NumPlanes; ++i)
+    {
+        SimdFloat distance = SimdAdd(SimdAdd(SimdAdd(SimdMul(cx, f.nx[i]), SimdMul(cy, f.ny[i])), SimdMul(cz, f.nz[i])), f.d[i]);
+        outside = SimdMaskOr(outside, SimdCmpLT(distance, negRadius));
+    }
+    return SimdMaskBits(outside);
+}
+
+// Return bits set for each lane where the AABB is outside the frustum
+static inline int AABBsOutside(const FrustumSplat& f, const float* x, const float* y, const float* z,
+                               const float* hx, const float* hy, const float* hz)
+{
+    SimdFloat cx = SimdLoad(x),  cy = SimdLoad(y),  cz = SimdLoad(z);
+    SimdFloat ex = SimdLoad(hx), ey = SimdLoad(hy), ez = SimdLoad(hz);
+
+    SimdMask outside = SimdCmpLT(SimdSet1(0.0f), SimdSet1(0.0f)); // All false
+    for (int i = 0; i < CFrustum::NumPlanes; ++i)
+    {
+        SimdFloat distance = SimdAdd(SimdAdd(SimdAdd(SimdMul(cx, f.nx[i]), SimdMul(cy, f.ny[i])), SimdMul(cz, f.nz[i])), f.d[i]);
+        SimdFloat extent   = SimdAdd(SimdAdd(SimdMul(ex, f.absNx[i]), SimdMul(ey, f.absNy[i])), SimdMul(ez, f.absNz[i]));
+        outside = SimdMaskOr(outside, SimdCmpLT(SimdAdd(distance, extent), SimdSet1(0.0f)));
+    }
+    return SimdMaskBits(outside);
+}
+
+
+// Write the indexes of the visible lanes of a block (first to first + blockSize - 1) to visibleIndexes and
+// return how many were written. Branch-free: every index is written but only kept if visible
+static inline unsigned int AppendVisible(int outsideBits, unsigned int first, unsigned int blockSize, unsigned int* visibleIndexes)
+{
+    unsigned int numVisible = 0;
+    for (unsigned int lane = 0; lane < blockSize; ++lane)
+    {
+        visibleIndexes[numVisible] = first + lane;
+        numVisible += ((outsideBits >> lane) & 1) ^ 1;
+    }
+    return numVisible;
+}
+
+
+unsigned int CullSpheres(const CFrustum& frustum, const float* centreX, const float* centreY, const float* centreZ,
+                         const float* radius, unsigned int count, unsigned int* visibleIndexes)
+{
+    FrustumSplat f(frustum);
+    unsigned int numVisible = 0;
+
+    unsigned int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        int outside = SpheresOutside(f, centreX + i, centreY + i, centreZ + i, radius + i);
+        numVisible += AppendVisible(outside, i, SIMD_WIDTH, visibleIndexes + numVisible);
+    }
+
+    // Remainder goes through a padded temporary block
+    unsigned int remaining = count - i;
+    if (remaining > 0)
+    {
+        float x[SIMD_WIDTH] = {}, y[SIMD_WIDTH] = {}, z[SIMD_WIDTH] = {}, r[SIMD_WIDTH] = {};
+        std::memcpy(x, centreX + i, remaining * sizeof(float));
+        std::memcpy(y, centreY + i, remaining * sizeof(float));
+        std::memcpy(z, centreZ + i, remaining * sizeof(float));
+        std::memcpy(r, radius  + i, remaining * sizeof(float));
+        int outside = SpheresOutside(f, x, y, z, r);
+        numVisible += AppendVisible(outside, i, remaining, visibleIndexes + numVisible);
+    }
+
+    return numVisible;
+}
+
+
+unsigned int CullAABBs(const CFrustum& frustum, const float* centreX, const float* centreY, const float* centreZ,
+                       const float* halfSizeX, const float* halfSizeY, const float* halfSizeZ,
+                       unsigned int count, unsigned int* visibleIndexes)
+{
+    FrustumSplat f(frustum);
+    unsigned int numVisible = 0;
+
+    unsigned int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        int outside = AABBsOutside(f, centreX + i, centreY + i, centreZ + i, halfSizeX + i, halfSizeY + i, halfSizeZ + i);
+        numVisible += AppendVisible(outside, i, SIMD_WIDTH, visibleIndexes + numVisible);
+    }
+
+    // Remainder goes through a padded temporary block
+    unsigned int remaining = count - i;
+    if (remaining > 0)
+    {
+        float x[SIMD_WIDTH] = {}, y[SIMD_WIDTH] = {}, z[SIMD_WIDTH] = {};
+        float hx[SIMD_WIDTH] = {}, hy[SIMD_WIDTH] = {}, hz[SIMD_WIDTH] = {};
+        std::memcpy(x,  centreX   + i, remaining * sizeof(float));
+        std::memcpy(y,  centreY   + i, remaining * sizeof(float));
+        std::memcpy(z,  centreZ   + i, remaining * sizeof(float));
+        std::memcpy(hx, halfSizeX + i, remaining * sizeof(float));
+        std::memcpy(hy, halfSizeY + i, remaining * sizeof(float));
+        std::memcpy(hz, halfSizeZ + i, remaining * sizeof(float));
+        int outside = AABBsOutside(f, x, y, z, hx, hy, hz);
+        numVisible += AppendVisible(outside, i, remaining, visibleIndexes + numVisible);
+    }
+
+    return numVisible;
+}
@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------------
+// Bounding volumes (axis-aligned box, sphere), planes and view frustums for visibility tests
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Planes are stored as a unit normal and distance d, a point p is in front of the plane if
+// Dot(normal, p) + d > 0. Frustum planes all face inwards, so a volume is outside the frustum if it is
+// entirely behind any one plane.
+//
+// The frustum tests are conservative: a volume that is near a corner of the frustum, outside it but not
+// entirely behind a single plane, is reported as visible. This is the usual trade-off for culling, the
+// GPU clips anything that gets through.
+
+#ifndef _BOUNDING_VOLUMES_H_DEFINED_
+#define _BOUNDING_VOLUMES_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Types
+-----------------------------------------------------------------------------------------*/
+
+// Axis-aligned bounding box, stored as centre and half-size (distance from centre to each face)
+class CAABB
+{
+public:
+    CVector3 centre;
+    CVector3 halfSize;
+
+    // Default constructor - leaves values uninitialised (for performance)
+    CAABB() {}
+
+    constexpr CAABB(const CVector3& centreIn, const CVector3& halfSizeIn) : centre(centreIn), halfSize(halfSizeIn) {}
+
+    // Corners with the smallest and largest x,y,z
+    constexpr CVector3 Min() const  { return centre - halfSize; }
+    constexpr CVector3 Max() const  { return centre + halfSize; }
+};
+
+
+// Bounding sphere
+class CSphere
+{
+public:
+    CVector3 centre;
+    float    radius;
+
+    // Default constructor - leaves values uninitialised (for performance)
+    CSphere() {}
+
+    constexpr CSphere(const CVector3& centreIn, float radiusIn) : centre(centreIn), radius(radiusIn) {}
+};
+
+
+// Plane - unit normal and distance, see comment at top of file
+class CPlane
+{
+public:
+    CVector3 normal;
+    float    d;
+
+    // Default constructor - leaves values uninitialised (for performance)
+    CPlane() {}
+
+    constexpr CPlane(const CVector3& normalIn, float dIn) : normal(normalIn), d(dIn) {}
+
+    // Signed distance from the plane to the given point, positive in front
+    constexpr float Distance(const CVector3& p) const  { return Dot(normal, p) + d; }
+};
+
+
+// View frustum - six inward facing planes
+class CFrustum
+{
+public:
+    enum { Left, Right, Bottom, Top, Near, Far, NumPlanes };
+
+    CPlane planes[NumPlanes];
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Construction
+-----------------------------------------------------------------------------------------*/
+
+// Return an AABB from its smallest and largest corners
+CAABB AABBFromMinMax(const CVector3& minimum, const CVector3& maximum);
+
+// Return a plane with unit normal, the same plane as the one given (which can have any non-zero normal)
+CPlane Normalise(const CPlane& plane);
+
+// Extract the frustum planes from a view-projection matrix (e.g. Camera::ViewProjectionMatrix), so the
+// planes are in world space. Pass a projection matrix alone to get the planes in camera space
+CFrustum FrustumFromMatrix(const CMatrix4x4& viewProjection);
+
+
+/*-----------------------------------------------------------------------------------------
+    Transformation
+-----------------------------------------------------------------------------------------*/
+
+// Return the AABB enclosing the given box after it has been transformed by an affine matrix (e.g. a
+// model's local box to a world space box). The result is a little larger than the box if rotated
+CAABB TransformAABB(const CAABB& box, const CMatrix4x4& m);
+CAABB TransformAABB(const CAABB& box, const CMatrix3x4& m);
+
+// Return the sphere enclosing the given sphere after it has been transformed by an affine matrix. The
+// radius is scaled by the largest scale in the matrix
+CSphere TransformSphere(const CSphere& sphere, const CMatrix4x4& m);
+CSphere TransformSphere(const CSphere& sphere, const CMatrix3x4& m);
+
+
+/*-----------------------------------------------------------------------------------------
+    Intersection tests
+-----------------------------------------------------------------------------------------*/
+
+bool Intersects(const CAABB& a, const CAABB& b);
+bool Intersects(const CSphere& a, const CSphere& b);
+bool Intersects(const CAABB& box, const CSphere& sphere);
+
+// Return true if the volume is at least partly inside the frustum (conservative - see top of file)
+bool IsVisible(const CFrustum& frustum, const CSphere& sphere);
+bool IsVisible(const CFrustum& frustum, const CAABB& box);
+
+
+/*-----------------------------------------------------------------------------------------
+    Batch frustum culling
+-----------------------------------------------------------------------------------------*/
+// Test count volumes held in structure-of-arrays form against a frustum, SIMD_WIDTH at a time (see
+// MathSIMD.h). The indexes of the visible volumes are written in increasing order to visibleIndexes,
+// which must have space for count entries. Returns the number of visible volumes
+
+unsigned int CullSpheres(const CFrustum& frustum, const float* centreX, const float* centreY, const float* centreZ,
+                         const float* radius, unsigned int count, unsigned int* visibleIndexes);
+
+unsigned int CullAABBs(const CFrustum& frustum, const float* centreX, const float* centreY, const float* centreZ,
+                       const float* halfSizeX, const float* halfSizeY, const float* halfSizeZ,
+                       unsigned int count, unsigned int* visibleIndexes);
+
+
+#endif // _BOUNDING_VOLUMES_H_DEFINED_
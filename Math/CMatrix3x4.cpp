@@ -0,0 +1,271 @@
+//--------------------------------------------------------------------------------------
+// Matrix3x4 class - compact affine matrix for world / view matrices
+//--------------------------------------------------------------------------------------
+
+#include "CMatrix3x4.h"
+#include "MathSIMD.h"
+
+/*-----------------------------------------------------------------------------------------
+    SIMD helpers
+-----------------------------------------------------------------------------------------*/
+// Each column of the matrix is one register. The SIMD versions perform exactly the same multiplies
+// and adds in the same order as the scalar reference code, so results are bit-identical
+
+#if defined(MATH_SIMD_SSE)
+
+// Load / store a matrix column (4 floats). CMatrix3x4 has no alignment requirement so use unaligned access
+static inline __m128 LoadColumn(const CMatrix3x4& m, int iColumn)         { return _mm_loadu_ps(&m.e00 + iColumn * 4); }
+static inline void   StoreColumn(CMatrix3x4& m, int iColumn, __m128 col)  { _mm_storeu_ps(&m.e00 + iColumn * 4, col); }
+
+// Cross product of the x,y,z elements of two registers, w element of result is unspecified
+static inline __m128 Cross3(__m128 a, __m128 b)
+{
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+    return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+}
+
+// Matrix-matrix multiplication, mOut = m1 * m2. mOut may be the same matrix as m1 or m2
+// Column j of the result is m1's columns weighted by the top three elements of m2's column j, plus
+// m2's translation element (bottom of the column) added to the translation row only
+static void MultiplySIMD(CMatrix3x4& mOut, const CMatrix3x4& m1, const CMatrix3x4& m2)
+{
+    __m128 a0 = LoadColumn(m1, 0);
+    __m128 a1 = LoadColumn(m1, 1);
+    __m128 a2 = LoadColumn(m1, 2);
+
+    __m128 b0 = LoadColumn(m2, 0);
+    __m128 b1 = LoadColumn(m2, 1);
+    __m128 b2 = LoadColumn(m2, 2);
+
+    __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    __m128 b[3] = { b0, b1, b2 };
+    for (int j = 0; j < 3; ++j)
+    {
+        __m128 out = _mm_mul_ps(a0, _mm_shuffle_ps(b[j], b[j], _MM_SHUFFLE(0, 0, 0, 0)));
+        out = _mm_add_ps(out, _mm_mul_ps(a1, _mm_shuffle_ps(b[j], b[j], _MM_SHUFFLE(1, 1, 1, 1))));
+        out = _mm_add_ps(out, _mm_mul_ps(a2, _mm_shuffle_ps(b[j], b[j], _MM_SHUFFLE(2, 2, 2, 2))));
+        out = _mm_add_ps(out, _mm_and_ps(b[j], wMask));
+        StoreColumn(mOut, j, out);
+    }
+}
+
+#elif defined(MATH_SIMD_NEON)
+
+// Matrix-matrix multiplication, mOut = m1 * m2. mOut may be the same matrix as m1 or m2
+// Uses separate multiply and add (not vfma) to match the rounding of the scalar code
+static void MultiplySIMD(CMatrix3x4& mOut, const CMatrix3x4& m1, const CMatrix3x4& m2)
+{
+    float32x4_t a0 = vld1q_f32(&m1.e00);
+    float32x4_t a1 = vld1q_f32(&m1.e01);
+    float32x4_t a2 = vld1q_f32(&m1.e02);
+
+    // Each column of m2 is read before the same column of mOut is written, so m2 may be mOut
+    for (int j = 0; j < 3; ++j)
+    {
+        const float* col = &m2.e00 + j * 4;
+        float b0 = col[0], b1 = col[1], b2 = col[2], b3 = col[3];
+        float32x4_t out = vmulq_n_f32(a0, b0);
+        out = vaddq_f32(out, vmulq_n_f32(a1, b1));
+        out = vaddq_f32(out, vmulq_n_f32(a2, b2));
+        out = vaddq_f32(out, vsetq_lane_f32(b3, vdupq_n_f32(0.0f), 3));
+        vst1q_f32(&mOut.e00 + j * 4, out);
+    }
+}
+
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Set a single row (range 0-3) of the matrix using a CVector3
+// Can be used to set position or x,y,z axes in a matrix
+void CMatrix3x4::SetRow(int iRow, const CVector3& v)
+{
+    float* pfElts = &e00 + iRow;
+    pfElts[0] = v.x;
+    pfElts[4] = v.y;
+    pfElts[8] = v.z;
+}
+
+// Get a single row (range 0-3) of the matrix into a CVector3
+// Can be used to access position or x,y,z axes from a matrix
+CVector3 CMatrix3x4::GetRow(int iRow) const
+{
+    const float* pfElts = &e00 + iRow;
+    return CVector3(pfElts[0], pfElts[4], pfElts[8]);
+}
+
+
+// Post-multiply this matrix by the given one
+CMatrix3x4& CMatrix3x4::operator*=(const CMatrix3x4& m)
+{
+#if defined(MATH_SIMD_NONE)
+    *this = MultiplyScalar(*this, m);
+#else
+    // All columns of both matrices are loaded before any are written, so multiplying by self is safe
+    MultiplySIMD(*this, *this, m);
+#endif
+    return *this;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Matrix-matrix multiplication
+CMatrix3x4 operator*(const CMatrix3x4& m1, const CMatrix3x4& m2)
+{
+#if defined(MATH_SIMD_NONE)
+    return MultiplyScalar(m1, m2);
+#else
+    CMatrix3x4 mOut;
+    MultiplySIMD(mOut, m1, m2);
+    return mOut;
+#endif
+}
+
+
+// Affine matrix followed by a general one (e.g. view matrix * projection matrix). Used once per frame
+// so only a scalar version. Same as ToMatrix4x4(m1) * m2 without the multiplies by the 0s and 1
+CMatrix4x4 operator*(const CMatrix3x4& m1, const CMatrix4x4& m2)
+{
+    return CMatrix4x4{ m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20,
+                       m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21,
+                       m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22,
+                       m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23,
+
+                       m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20,
+                       m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21,
+                       m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22,
+                       m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23,
+
+                       m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20,
+                       m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21,
+                       m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22,
+                       m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23,
+
+                       m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m2.e30,
+                       m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m2.e31,
+                       m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m2.e32,
+                       m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m2.e33 };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Transform a point by the matrix (translation is applied)
+CVector3 TransformPoint(const CVector3& p, const CMatrix3x4& m)
+{
+    return { p.x * m.e00 + p.y * m.e10 + p.z * m.e20 + m.e30,
+             p.x * m.e01 + p.y * m.e11 + p.z * m.e21 + m.e31,
+             p.x * m.e02 + p.y * m.e12 + p.z * m.e22 + m.e32 };
+}
+
+// Transform a vector by the matrix (translation is ignored)
+CVector3 TransformVector(const CVector3& v, const CMatrix3x4& m)
+{
+    return { v.x * m.e00 + v.y * m.e10 + v.z * m.e20,
+             v.x * m.e01 + v.y * m.e11 + v.z * m.e21,
+             v.x * m.e02 + v.y * m.e12 + v.z * m.e22 };
+}
+
+
+// Return the inverse of the given matrix
+CMatrix3x4 InverseAffine(const CMatrix3x4& m)
+{
+#if defined(MATH_SIMD_SSE)
+    __m128 c0 = LoadColumn(m, 0);
+    __m128 c1 = LoadColumn(m, 1);
+    __m128 c2 = LoadColumn(m, 2);
+
+    // The rows of the inverse of the upper left 3x3 are cross products of pairs of its columns
+    __m128 r0 = Cross3(c1, c2);
+    __m128 r1 = Cross3(c2, c0);
+    __m128 r2 = Cross3(c0, c1);
+
+    // Determinant is the dot product of the first column with the first row above, summed in scalar order
+    __m128 p = _mm_mul_ps(c0, r0);
+    __m128 det = _mm_add_ss(_mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(det, det, _MM_SHUFFLE(0, 0, 0, 0)));
+    r0 = _mm_mul_ps(invDet, r0);
+    r1 = _mm_mul_ps(invDet, r1);
+    r2 = _mm_mul_ps(invDet, r2);
+
+    // Transform negative translation (the w elements of the columns) by inverted 3x3
+    __m128 t = _mm_mul_ps(_mm_xor_ps(_mm_set1_ps(-0.0f), _mm_shuffle_ps(c0, c0, _MM_SHUFFLE(3, 3, 3, 3))), r0);
+    t = _mm_sub_ps(t, _mm_mul_ps(_mm_shuffle_ps(c1, c1, _MM_SHUFFLE(3, 3, 3, 3)), r1));
+    t = _mm_sub_ps(t, _mm_mul_ps(_mm_shuffle_ps(c2, c2, _MM_SHUFFLE(3, 3, 3, 3)), r2));
+
+    // Transpose the rows and translation into columns
+    _MM_TRANSPOSE4_PS(r0, r1, r2, t);
+
+    CMatrix3x4 mOut;
+    StoreColumn(mOut, 0, r0);
+    StoreColumn(mOut, 1, r1);
+    StoreColumn(mOut, 2, r2);
+    return mOut;
+#else
+    return InverseAffineScalar(m);
+#endif
+}
+
+
+// Matrix-matrix multiplication - plain C++ reference version
+CMatrix3x4 MultiplyScalar(const CMatrix3x4& m1, const CMatrix3x4& m2)
+{
+    return CMatrix3x4{ m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20,
+                       m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20,
+                       m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20,
+                       m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m2.e30,
+
+                       m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21,
+                       m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21,
+                       m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21,
+                       m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m2.e31,
+
+                       m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22,
+                       m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22,
+                       m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22,
+                       m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m2.e32 };
+}
+
+
+// Inverse of an affine matrix - plain C++ reference version
+CMatrix3x4 InverseAffineScalar(const CMatrix3x4& m)
+{
+    CMatrix3x4 mOut;
+
+    // Inverse of upper left 3x3 is its adjugate (cross products of pairs of columns) over the determinant
+    float i00 = m.e11*m.e22 - m.e21*m.e12;
+    float i01 = m.e21*m.e02 - m.e01*m.e22;
+    float i02 = m.e01*m.e12 - m.e11*m.e02;
+    float det = m.e00*i00 + m.e10*i01 + m.e20*i02;
+
+    float invDet = 1.0f / det;
+    mOut.e00 = invDet * i00;
+    mOut.e01 = invDet * i01;
+    mOut.e02 = invDet * i02;
+
+    mOut.e10 = invDet * (m.e12*m.e20 - m.e22*m.e10);
+    mOut.e11 = invDet * (m.e22*m.e00 - m.e02*m.e20);
+    mOut.e12 = invDet * (m.e02*m.e10 - m.e12*m.e00);
+
+    mOut.e20 = invDet * (m.e10*m.e21 - m.e20*m.e11);
+    mOut.e21 = invDet * (m.e20*m.e01 - m.e00*m.e21);
+    mOut.e22 = invDet * (m.e00*m.e11 - m.e10*m.e01);
+
+    // Transform negative translation by inverted 3x3 to get inverse
+    mOut.e30 = -m.e30*mOut.e00 - m.e31*mOut.e10 - m.e32*mOut.e20;
+    mOut.e31 = -m.e30*mOut.e01 - m.e31*mOut.e11 - m.e32*mOut.e21;
+    mOut.e32 = -m.e30*mOut.e02 - m.e31*mOut.e12 - m.e32*mOut.e22;
+
+    return mOut;
+}
@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------
+// Matrix3x4 class - compact affine matrix for world / view matrices
+//--------------------------------------------------------------------------------------
+// Code in .cpp file, except for constexpr functions that can be used at compile time
+//
+// An affine CMatrix4x4 (rotation, scale and translation only) always has 0,0,0,1 as its right hand column.
+// CMatrix3x4 drops that column and holds the other 12 elements in 48 bytes rather than 64. The elements are
+// named as in CMatrix4x4 (eRowColumn) and are used in the same way - points are row vectors multiplied on
+// the left, m1 * m2 is m1 followed by m2 - so code like m.e20 or m.GetPosition() works on either type.
+//
+// The elements are stored column by column, which is the layout the shaders read: a row_major float3x4 in
+// HLSL (see Common.hlsli) takes the three columns as three float4 registers. So a CMatrix3x4 can be copied
+// straight into a constant buffer with no rearranging, and mul(gWorldMatrix, float4(position, 1)) gives the
+// same result as the 4x4 matrix did
+
+#ifndef _CMATRIX3X4_H_DEFINED_
+#define _CMATRIX3X4_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+
+// Matrix class
+class CMatrix3x4
+{
+// Concrete class - public access
+public:
+    // Matrix elements, one column per line (the right hand column of the 4x4 matrix is always 0,0,0,1)
+    float e00, e10, e20, e30;
+    float e01, e11, e21, e31;
+    float e02, e12, e22, e32;
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Set a single row (range 0-3) of the matrix using a CVector3
+    // Can be used to set position or x,y,z axes in a matrix
+    void SetRow(int iRow, const CVector3& v);
+
+    // Get a single row (range 0-3) of the matrix into a CVector3
+    // Can be used to access position or x,y,z axes from a matrix
+    CVector3 GetRow(int iRow) const;
+
+    // Helper functions
+    CVector3 GetXAxis() const { return GetRow(0); }
+    CVector3 GetYAxis() const { return GetRow(1); }
+    CVector3 GetZAxis() const { return GetRow(2); }
+    CVector3 GetPosition() const  { return GetRow(3); }
+    CVector3 GetScale() const  { return { Length(GetXAxis()), Length(GetYAxis()) , Length(GetZAxis()) }; }
+
+    // Post-multiply this matrix by the given one
+    CMatrix3x4& operator*=(const CMatrix3x4& m);
+};
+
+static_assert(sizeof(CMatrix3x4) == 48, "CMatrix3x4 must be exactly three float4s to match the shaders");
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Matrix-matrix multiplication
+CMatrix3x4 operator*(const CMatrix3x4& m1, const CMatrix3x4& m2);
+
+// Affine matrix followed by a general one (e.g. view matrix * projection matrix)
+CMatrix4x4 operator*(const CMatrix3x4& m1, const CMatrix4x4& m2);
+
+
+/*-----------------------------------------------------------------------------------------
+  Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Convert from a 4x4 matrix, which must be affine (right hand column is ignored)
+constexpr CMatrix3x4 ToMatrix3x4(const CMatrix4x4& m)
+{
+    return CMatrix3x4{ m.e00, m.e10, m.e20, m.e30,
+                       m.e01, m.e11, m.e21, m.e31,
+                       m.e02, m.e12, m.e22, m.e32 };
+}
+
+// Convert to a 4x4 matrix
+constexpr CMatrix4x4 ToMatrix4x4(const CMatrix3x4& m)
+{
+    return CMatrix4x4{ m.e00, m.e01, m.e02, 0.0f,
+                       m.e10, m.e11, m.e12, 0.0f,
+                       m.e20, m.e21, m.e22, 0.0f,
+                       m.e30, m.e31, m.e32, 1.0f };
+}
+
+
+// Transform a point by the matrix (translation is applied)
+CVector3 TransformPoint(const CVector3& p, const CMatrix3x4& m);
+
+// Transform a vector by the matrix (translation is ignored)
+CVector3 TransformVector(const CVector3& v, const CMatrix3x4& m);
+
+
+// Return the inverse of the given matrix. Used for the view matrix, the inverse of the camera's world matrix
+CMatrix3x4 InverseAffine(const CMatrix3x4& m);
+
+
+// Plain C++ versions of the functions above. Matrix multiply and InverseAffine use SIMD instructions where
+// available (see MathSIMD.h), these reference versions are always scalar and give bit-identical results
+CMatrix3x4 MultiplyScalar(const CMatrix3x4& m1, const CMatrix3x4& m2);
+CMatrix3x4 InverseAffineScalar(const CMatrix3x4& m);
+
+
+#endif // _CMATRIX3X4_H_DEFINED_
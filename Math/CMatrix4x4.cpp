@@ -3,6 +3,117 @@
 //--------------------------------------------------------------------------------------
 
 #include "CMatrix4x4.h"
+#include "MathSIMD.h"
+
+/*-----------------------------------------------------------------------------------------
+    SIMD helpers
+-----------------------------------------------------------------------------------------*/
+// The SIMD versions perform exactly the same multiplies and adds in the same order as the scalar
+// reference code, so results are bit-identical unless the compiler is allowed to fuse multiply-adds
+
+#if defined(MATH_SIMD_SSE)
+
+// Load / store a matrix row (4 floats). CMatrix4x4 has no alignment requirement so use unaligned access
+static inline __m128 LoadRow(const CMatrix4x4& m, int iRow)         { return _mm_loadu_ps(&m.e00 + iRow * 4); }
+static inline void   StoreRow(CMatrix4x4& m, int iRow, __m128 row)  { _mm_storeu_ps(&m.e00 + iRow * 4, row); }
+
+// Cross product of the x,y,z elements of two registers, w element of result is unspecified
+static inline __m128 Cross3(__m128 a, __m128 b)
+{
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+    return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+}
+
+#endif
+
+#if defined(MATH_SIMD_AVX)
+
+// Matrix-matrix multiplication, mOut = m1 * m2. mOut may be the same matrix as m1 or m2
+// Two rows of the result are calculated together in each half of a 256-bit register
+static void MultiplySIMD(CMatrix4x4& mOut, const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    __m256 r0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e00));
+    __m256 r1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e10));
+    __m256 r2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e20));
+    __m256 r3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&m2.e30));
+
+    __m256 a01 = _mm256_loadu_ps(&m1.e00);
+    __m256 a23 = _mm256_loadu_ps(&m1.e20);
+
+    // Shuffles work within each 128-bit half, so these broadcast element k of two rows at once
+    __m256 out01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+    out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+    out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+    out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+
+    __m256 out23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+    out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+    out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+    out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+
+    _mm256_storeu_ps(&mOut.e00, out01);
+    _mm256_storeu_ps(&mOut.e20, out23);
+}
+
+#elif defined(MATH_SIMD_SSE)
+
+// Multiply a single row by matrix rows r0-r3 (i.e. row * matrix)
+static inline __m128 MultiplyRow(__m128 a, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+    __m128 out = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+    out = _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+    return _mm_add_ps(out, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+}
+
+// Matrix-matrix multiplication, mOut = m1 * m2. mOut may be the same matrix as m1 or m2
+static void MultiplySIMD(CMatrix4x4& mOut, const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    __m128 r0 = LoadRow(m2, 0);
+    __m128 r1 = LoadRow(m2, 1);
+    __m128 r2 = LoadRow(m2, 2);
+    __m128 r3 = LoadRow(m2, 3);
+
+    // Load all rows of m1 first, the four independent products can then overlap
+    __m128 a0 = LoadRow(m1, 0);
+    __m128 a1 = LoadRow(m1, 1);
+    __m128 a2 = LoadRow(m1, 2);
+    __m128 a3 = LoadRow(m1, 3);
+
+    StoreRow(mOut, 0, MultiplyRow(a0, r0, r1, r2, r3));
+    StoreRow(mOut, 1, MultiplyRow(a1, r0, r1, r2, r3));
+    StoreRow(mOut, 2, MultiplyRow(a2, r0, r1, r2, r3));
+    StoreRow(mOut, 3, MultiplyRow(a3, r0, r1, r2, r3));
+}
+
+#elif defined(MATH_SIMD_NEON)
+
+// Matrix-matrix multiplication, mOut = m1 * m2. mOut may be the same matrix as m1 or m2
+// Uses separate multiply and add (not vfma) to match the rounding of the scalar code
+static void MultiplySIMD(CMatrix4x4& mOut, const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    float32x4_t r0 = vld1q_f32(&m2.e00);
+    float32x4_t r1 = vld1q_f32(&m2.e10);
+    float32x4_t r2 = vld1q_f32(&m2.e20);
+    float32x4_t r3 = vld1q_f32(&m2.e30);
+
+    for (int iRow = 0; iRow < 4; ++iRow)
+    {
+        const float* a = &m1.e00 + iRow * 4;
+        float a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+        float32x4_t out = vmulq_n_f32(r0, a0);
+        out = vaddq_f32(out, vmulq_n_f32(r1, a1));
+        out = vaddq_f32(out, vmulq_n_f32(r2, a2));
+        out = vaddq_f32(out, vmulq_n_f32(r3, a3));
+        vst1q_f32(&mOut.e00 + iRow * 4, out);
+    }
+}
+
+#endif
+
 
 /*-----------------------------------------------------------------------------------------
     Member functions
@@ -30,6 +141,7 @@ CVector3 CMatrix4x4::GetRow(int iRow) const
 // Post-multiply this matrix by the given one
 CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
 {
+#if defined(MATH_SIMD_NONE)
     if (this == &m)
     {
         // Special case of multiplying by self - no copy optimisations so use binary version
@@ -71,6 +183,10 @@ CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
         e31 = t1;
         e32 = t2;
     }
+#else
+    // All rows of m are loaded before any row of this matrix is written, so multiplying by self is safe
+    MultiplySIMD(*this, *this, m);
+#endif
     return *this;
 }
 
@@ -82,29 +198,13 @@ CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
 // Matrix-matrix multiplication
 CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
 {
+#if defined(MATH_SIMD_NONE)
+    return MultiplyScalar(m1, m2);
+#else
     CMatrix4x4 mOut;
-
-    mOut.e00 = m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20 + m1.e03*m2.e30;
-    mOut.e01 = m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21 + m1.e03*m2.e31;
-    mOut.e02 = m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22 + m1.e03*m2.e32;
-    mOut.e03 = m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23 + m1.e03*m2.e33;
-
-    mOut.e10 = m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20 + m1.e13*m2.e30;
-    mOut.e11 = m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21 + m1.e13*m2.e31;
-    mOut.e12 = m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22 + m1.e13*m2.e32;
-    mOut.e13 = m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23 + m1.e13*m2.e33;
-
-    mOut.e20 = m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20 + m1.e23*m2.e30;
-    mOut.e21 = m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21 + m1.e23*m2.e31;
-    mOut.e22 = m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22 + m1.e23*m2.e32;
-    mOut.e23 = m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23 + m1.e23*m2.e33;
-
-    mOut.e30 = m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m1.e33*m2.e30;
-    mOut.e31 = m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m1.e33*m2.e31;
-    mOut.e32 = m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m1.e33*m2.e32;
-    mOut.e33 = m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m1.e33*m2.e33;
-
+    MultiplySIMD(mOut, m1, m2);
     return mOut;
+#endif
 }
 
 
@@ -117,30 +217,14 @@ CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
 // They can be used as temporaries in calculations, e.g.
 //     CMatrix4x4 m = MatrixScaling( 3.0f ) * MatrixTranslation( CVector3(10.0f, -10.0f, 20.0f) );
 
-// Return an identity matrix
-CMatrix4x4 MatrixIdentity()
-{
-    return CMatrix4x4{ 1, 0, 0, 0,
-                       0, 1, 0, 0,
-                       0, 0, 1, 0,
-                       0, 0, 0, 1 };
-}
-
-// Return a translation matrix of the given vector
-CMatrix4x4 MatrixTranslation(const CVector3& t)
-{
-    return CMatrix4x4  { 1,   0,   0,  0,
-                         0,   1,   0,  0,
-                         0,   0,   1,  0,
-                       t.x, t.y, t.z,  1 };
-}
+// MatrixIdentity and MatrixTranslation are constexpr and defined in the header
 
 
 // Return an X-axis rotation matrix of the given angle (in radians)
 CMatrix4x4 MatrixRotationX(float x)
 {
-    float sX = std::sin(x);
-    float cX = std::cos(x);
+    float sX, cX;
+    SinCos(x, sX, cX);
 
     return CMatrix4x4{ 1,   0,   0,  0,
                        0,  cX,  sX,  0,
@@ -151,8 +235,8 @@ CMatrix4x4 MatrixRotationX(float x)
 // Return a Y-axis rotation matrix of the given angle (in radians)
 CMatrix4x4 MatrixRotationY(float y)
 {
-    float sY = std::sin(y);
-    float cY = std::cos(y);
+    float sY, cY;
+    SinCos(y, sY, cY);
 
     return CMatrix4x4{ cY,   0, -sY,  0,
                         0,   1,   0,  0,
@@ -163,8 +247,8 @@ CMatrix4x4 MatrixRotationY(float y)
 // Return a Z-axis rotation matrix of the given angle (in radians)
 CMatrix4x4 MatrixRotationZ(float z)
 {
-    float sZ = std::sin(z);
-    float cZ = std::cos(z);
+    float sZ, cZ;
+    SinCos(z, sZ, cZ);
 
     return CMatrix4x4{ cZ,  sZ,  0,  0,
                       -sZ,  cZ,  0,  0,
@@ -173,28 +257,81 @@ CMatrix4x4 MatrixRotationZ(float z)
 }
 
 
-// Return a matrix that is a scaling in X,Y and Z of the values in the given vector
-CMatrix4x4 MatrixScaling(const CVector3& s)
+// MatrixScaling is constexpr and defined in the header
+
+
+// Return a projection matrix, see header. std::tan is much faster than ConstexprTan at run-time
+CMatrix4x4 MatrixProjection(float aspectRatio, float FOVx, float nearClip, float farClip)
 {
-    return CMatrix4x4{ s.x,   0,   0,  0,
-                       0,   s.y,   0,  0,
-                       0,     0, s.z,  0,
-                       0,     0,   0,  1 };
+    return MatrixProjectionFromTan(aspectRatio, std::tan(ClampProjectionFOV(FOVx) * 0.5f), nearClip, farClip);
 }
 
-// Return a matrix that is a uniform scaling of the given amount
-CMatrix4x4 MatrixScaling(const float s)
+
+// Build an affine world matrix from scale, Euler angle rotation (radians) and translation. Gives the same
+// matrix as MatrixScaling(scale) * MatrixRotationZ(rotation.z) * MatrixRotationX(rotation.x) *
+// MatrixRotationY(rotation.y) * MatrixTranslation(position), but writes each element directly
+CMatrix4x4 MatrixFromTRS(const CVector3& position, const CVector3& rotation, const CVector3& scale)
 {
-    return CMatrix4x4{ s, 0, 0, 0,
-                       0, s, 0, 0,
-                       0, 0, s, 0,
-                       0, 0, 0, 1 };
+    float sX, cX, sY, cY, sZ, cZ;
+    SinCos(rotation.x, sX, cX);
+    SinCos(rotation.y, sY, cY);
+    SinCos(rotation.z, sZ, cZ);
+
+    // Rows of the combined Z, X, Y rotation, each scaled by one component of the scale
+    return CMatrix4x4{ scale.x * (cZ * cY + sZ * sX * sY),  scale.x * (sZ * cX), scale.x * (sZ * sX * cY - cZ * sY), 0.0f,
+                       scale.y * (cZ * sX * sY - sZ * cY),  scale.y * (cZ * cX), scale.y * (sZ * sY + cZ * sX * cY), 0.0f,
+                       scale.z * (cX * sY),                 scale.z * (-sX),     scale.z * (cX * cY),                0.0f,
+                       position.x,                          position.y,          position.z,                         1.0f };
 }
 
 
 // Return the inverse of given matrix assuming that it is an affine matrix
 // Advanced calulation needed to get the view matrix from the camera's positioning matrix
 CMatrix4x4 InverseAffine(const CMatrix4x4& m)
+{
+#if defined(MATH_SIMD_SSE)
+    __m128 r0 = LoadRow(m, 0);
+    __m128 r1 = LoadRow(m, 1);
+    __m128 r2 = LoadRow(m, 2);
+
+    // The columns of the inverse of the upper left 3x3 are cross products of pairs of its rows
+    __m128 c0 = Cross3(r1, r2);
+    __m128 c1 = Cross3(r2, r0);
+    __m128 c2 = Cross3(r0, r1);
+
+    // Determinant is the dot product of the first row with the first column above, summed in scalar order
+    __m128 p = _mm_mul_ps(r0, c0);
+    __m128 det = _mm_add_ss(_mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(det, det, _MM_SHUFFLE(0, 0, 0, 0)));
+    c0 = _mm_mul_ps(invDet, c0);
+    c1 = _mm_mul_ps(invDet, c1);
+    c2 = _mm_mul_ps(invDet, c2);
+
+    // Transpose columns into rows, the zero column provides the 4th element of each row
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    // Transform negative translation by inverted 3x3 to get inverse, then set 4th element to 1
+    __m128 t = LoadRow(m, 3);
+    __m128 out3 = _mm_mul_ps(_mm_xor_ps(_mm_set1_ps(-0.0f), _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0))), c0);
+    out3 = _mm_sub_ps(out3, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1)), c1));
+    out3 = _mm_sub_ps(out3, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2)), c2));
+    __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    out3 = _mm_or_ps(_mm_and_ps(out3, xyzMask), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+
+    CMatrix4x4 mOut;
+    StoreRow(mOut, 0, c0);
+    StoreRow(mOut, 1, c1);
+    StoreRow(mOut, 2, c2);
+    StoreRow(mOut, 3, out3);
+    return mOut;
+#else
+    return InverseAffineScalar(m);
+#endif
+}
+
+// Inverse of an affine matrix - plain C++ reference version
+CMatrix4x4 InverseAffineScalar(const CMatrix4x4& m)
 {
     CMatrix4x4 mOut;
 
@@ -291,3 +428,35 @@ CVector3 CMatrix4x4::GetEulerAngles()
 
 	return { atan2(sX, cX), atan2(sY, cY), atan2(sZ, cZ) };
 }
+
+
+/*-----------------------------------------------------------------------------------------
+    Compile-time checks
+-----------------------------------------------------------------------------------------*/
+// The constexpr maths must give the same results whether evaluated by the compiler or at run-time.
+// These expressions are all calculated by the compiler, the values they are compared to are the
+// exact run-time results
+
+static_assert(Dot(CVector3{ 1, 2, 3 }, CVector3{ 4, 5, 6 }) == 32.0f, "Dot product");
+static_assert(Cross(CVector3{ 1, 0, 0 }, CVector3{ 0, 1, 0 }).z == 1.0f, "Cross product");
+static_assert((CVector3{ 1, 2, 3 } + CVector3{ 1, 1, 1 } * 2.0f).z == 5.0f, "Vector operators");
+static_assert(ToDegrees(ToRadians(90.0f)) == 90.0f, "Angle conversion");
+static_assert(IsZero(0.0f) && !IsZero(1e-5f), "IsZero");
+
+static_assert(MultiplyScalar(MatrixIdentity(), MatrixTranslation({ 1, 2, 3 })).e31 == 2.0f, "Identity");
+static_assert(MultiplyScalar(MatrixScaling(2.0f), MatrixTranslation({ 1, 2, 3 })).e00 == 2.0f &&
+              MultiplyScalar(MatrixScaling(2.0f), MatrixTranslation({ 1, 2, 3 })).e32 == 3.0f, "Scale then translate");
+static_assert(MultiplyScalar(MatrixTranslation({ 1, 2, 3 }), MatrixScaling({ 2, 3, 4 })).e32 == 12.0f, "Translate then scale");
+
+// tan(30 degrees) = 1/sqrt(3) = 0.57735026918962576..., nearest float is 0.577350259f
+static_assert(ConstexprTan(PI / 6) == 0.577350259f, "ConstexprTan");
+static_assert(ConstexprTan(PI / 6 + 1000 * PI) > 0.57f && ConstexprTan(PI / 6 + 1000 * PI) < 0.58f,  // 1000 * PI is not exact in floats
+              "ConstexprTan of a large angle");
+static_assert(ConstexprTan(std::numeric_limits<float>::infinity()) != ConstexprTan(std::numeric_limits<float>::infinity()), "ConstexprTan of infinity is NaN");
+static_assert(ConstexprMatrixProjection(1.0f, PI / 2, 1.0f, 11.0f).e00 > 0.9999999f &&
+              ConstexprMatrixProjection(1.0f, PI / 2, 1.0f, 11.0f).e00 < 1.0000001f &&
+              ConstexprMatrixProjection(1.0f, PI / 2, 1.0f, 11.0f).e22 == 1.1f &&
+              ConstexprMatrixProjection(1.0f, PI / 2, 1.0f, 11.0f).e23 == 1.0f, "Projection matrix");
+static_assert(ConstexprMatrixProjection(1.0f, -1.0f, 1.0f, 11.0f).e00 == ConstexprMatrixProjection(1.0f, MIN_PROJECTION_FOV, 1.0f, 11.0f).e00,
+              "Projection field of view is clamped");
+// The run-time results these match are checked by MathBenchmark
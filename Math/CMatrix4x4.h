@@ -1,7 +1,7 @@
 //--------------------------------------------------------------------------------------
 // Matrix4x4 class (cut down version) to hold matrices for 3D
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Code in .cpp file, except for constexpr functions that can be used at compile time
 
 #ifndef _CMATRIX4X4_H_DEFINED_
 #define _CMATRIX4X4_H_DEFINED_
@@ -70,10 +70,22 @@ CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2);
 //     CMatrix4x4 m = MatrixScaling( 3.0f ) * MatrixTranslation( CVector3(10.0f, -10.0f, 20.0f) );
 
 // Return an identity matrix
-CMatrix4x4 MatrixIdentity();
+constexpr CMatrix4x4 MatrixIdentity()
+{
+    return CMatrix4x4{ 1, 0, 0, 0,
+                       0, 1, 0, 0,
+                       0, 0, 1, 0,
+                       0, 0, 0, 1 };
+}
 
 // Return a translation matrix of the given vector
-CMatrix4x4 MatrixTranslation(const CVector3& t);
+constexpr CMatrix4x4 MatrixTranslation(const CVector3& t)
+{
+    return CMatrix4x4  { 1,   0,   0,  0,
+                         0,   1,   0,  0,
+                         0,   0,   1,  0,
+                       t.x, t.y, t.z,  1 };
+}
 
 
 // Return an X-axis rotation matrix of the given angle (in radians)
@@ -87,10 +99,69 @@ CMatrix4x4 MatrixRotationZ(float z);
 
 
 // Return a matrix that is a scaling in X,Y and Z of the values in the given vector
-CMatrix4x4 MatrixScaling(const CVector3& s);
+constexpr CMatrix4x4 MatrixScaling(const CVector3& s)
+{
+    return CMatrix4x4{ s.x,   0,   0,  0,
+                       0,   s.y,   0,  0,
+                       0,     0, s.z,  0,
+                       0,     0,   0,  1 };
+}
 
 // Return a matrix that is a uniform scaling of the given amount
-CMatrix4x4 MatrixScaling(const float s);
+constexpr CMatrix4x4 MatrixScaling(const float s)
+{
+    return CMatrix4x4{ s, 0, 0, 0,
+                       0, s, 0, 0,
+                       0, 0, s, 0,
+                       0, 0, 0, 1 };
+}
+
+
+// Range of field of view angles (radians) the projection matrix functions accept, others are clamped to it.
+// A NaN angle gives the smallest
+constexpr float MIN_PROJECTION_FOV = 0.001f;
+constexpr float MAX_PROJECTION_FOV = PI - 0.001f;
+
+constexpr float ClampProjectionFOV(float FOVx)
+{
+    return (FOVx > MIN_PROJECTION_FOV) ? (FOVx < MAX_PROJECTION_FOV ? FOVx : MAX_PROJECTION_FOV) : MIN_PROJECTION_FOV;
+}
+
+// Return a projection matrix given the tangent of half the horizontal field of view. Used by the two functions
+// below, which differ only in how they calculate the tangent
+constexpr CMatrix4x4 MatrixProjectionFromTan(float aspectRatio, float tanHalfFOVx, float nearClip, float farClip)
+{
+    float scaleX = 1.0f / tanHalfFOVx;
+    float scaleY = aspectRatio / tanHalfFOVx;
+    float scaleZa = farClip / (farClip - nearClip);
+    float scaleZb = -nearClip * scaleZa;
+
+    return CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
+                         0.0f, scaleY,    0.0f,   0.0f,
+                         0.0f,   0.0f, scaleZa,   1.0f,
+                         0.0f,   0.0f, scaleZb,   0.0f };
+}
+
+// Return a projection matrix, e.g. for a camera each frame
+// - Aspect ratio is screen width / height (like 4:3, 16:9)
+// - FOVx is the viewing angle from left->right in radians, clamped to MIN_PROJECTION_FOV..MAX_PROJECTION_FOV
+// - near and far clip are the range of z distances that can be rendered
+CMatrix4x4 MatrixProjection(float aspectRatio, float FOVx, float nearClip, float farClip);
+
+// Return the same projection matrix calculated at compile time for fixed camera settings, e.g.
+//     constexpr CMatrix4x4 projection = ConstexprMatrixProjection(16.0f / 9.0f, ToRadians(60), 1.0f, 1000.0f);
+// Uses ConstexprTan, which is slower than std::tan, so use MatrixProjection for matrices made at run-time
+constexpr CMatrix4x4 ConstexprMatrixProjection(float aspectRatio, float FOVx, float nearClip, float farClip)
+{
+    return MatrixProjectionFromTan(aspectRatio, ConstexprTan(ClampProjectionFOV(FOVx) * 0.5f), nearClip, farClip);
+}
+
+
+// Build an affine world matrix from scale, Euler angle rotation (radians) and translation. Gives the same
+// matrix as MatrixScaling(scale) * MatrixRotationZ(rotation.z) * MatrixRotationX(rotation.x) *
+// MatrixRotationY(rotation.y) * MatrixTranslation(position), but writes each element directly
+// (one sin and cos per axis, no matrix products). There is a quaternion version in CQuaternion.h
+CMatrix4x4 MatrixFromTRS(const CVector3& position, const CVector3& rotation, const CVector3& scale);
 
 
 
@@ -99,4 +170,34 @@ CMatrix4x4 MatrixScaling(const float s);
 CMatrix4x4 InverseAffine(const CMatrix4x4& m);
 
 
+// Plain C++ versions of the functions above. Matrix multiply and InverseAffine use SIMD instructions
+// where available (see MathSIMD.h), these reference versions are always scalar and are kept to check
+// the optimised code against. MultiplyScalar is constexpr so it can also combine matrices at compile time,
+// results are bit-identical to operator*
+CMatrix4x4 InverseAffineScalar(const CMatrix4x4& m);
+
+constexpr CMatrix4x4 MultiplyScalar(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    return CMatrix4x4{ m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20 + m1.e03*m2.e30,
+                       m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21 + m1.e03*m2.e31,
+                       m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22 + m1.e03*m2.e32,
+                       m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23 + m1.e03*m2.e33,
+
+                       m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20 + m1.e13*m2.e30,
+                       m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21 + m1.e13*m2.e31,
+                       m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22 + m1.e13*m2.e32,
+                       m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23 + m1.e13*m2.e33,
+
+                       m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20 + m1.e23*m2.e30,
+                       m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21 + m1.e23*m2.e31,
+                       m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22 + m1.e23*m2.e32,
+                       m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23 + m1.e23*m2.e33,
+
+                       m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m1.e33*m2.e30,
+                       m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m1.e33*m2.e31,
+                       m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m1.e33*m2.e32,
+                       m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m1.e33*m2.e33 };
+}
+
+
 #endif // _CMATRIX4X4_H_DEFINED_
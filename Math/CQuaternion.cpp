@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version) to hold rotations
+//--------------------------------------------------------------------------------------
+
+#include "CQuaternion.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the rotation held in this quaternion as Euler angles (Z, then X, then Y order)
+CVector3 CQuaternion::GetEulerAngles() const
+{
+    // Use the matrix code so the angles match those returned by CMatrix4x4::GetEulerAngles exactly
+    return MatrixFromTRS({ 0, 0, 0 }, *this, { 1, 1, 1 }).GetEulerAngles();
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two rotations: q1 followed by q2 (same order as matrix multiplication)
+// This is the standard (Hamilton) quaternion product q2 * q1
+CQuaternion operator* (const CQuaternion& q1, const CQuaternion& q2)
+{
+    return CQuaternion{ q2.w * q1.x + q2.x * q1.w + q2.y * q1.z - q2.z * q1.y,
+                        q2.w * q1.y - q2.x * q1.z + q2.y * q1.w + q2.z * q1.x,
+                        q2.w * q1.z + q2.x * q1.y - q2.y * q1.x + q2.z * q1.w,
+                        q2.w * q1.w - q2.x * q1.x - q2.y * q1.y - q2.z * q1.z };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the identity quaternion (no rotation)
+CQuaternion QuaternionIdentity()
+{
+    return CQuaternion{ 0, 0, 0, 1 };
+}
+
+// Return a rotation of the given angle (radians) around the given axis, which must be unit length
+CQuaternion QuaternionAxisAngle(const CVector3& axis, float angle)
+{
+    float s, c;
+    SinCos(angle * 0.5f, s, c);
+    return CQuaternion{ axis.x * s, axis.y * s, axis.z * s, c };
+}
+
+// Return a rotation matching the given Euler angles (radians), same result as
+// MatrixRotationZ(r.z) * MatrixRotationX(r.x) * MatrixRotationY(r.y)
+CQuaternion QuaternionFromEuler(const CVector3& r)
+{
+    // Expanded form of QuaternionAxisAngle(Z) * QuaternionAxisAngle(X) * QuaternionAxisAngle(Y)
+    float sX, cX, sY, cY, sZ, cZ;
+    SinCos(r.x * 0.5f, sX, cX);
+    SinCos(r.y * 0.5f, sY, cY);
+    SinCos(r.z * 0.5f, sZ, cZ);
+
+    return CQuaternion{ cY * sX * cZ + sY * cX * sZ,
+                        sY * cX * cZ - cY * sX * sZ,
+                        cY * cX * sZ - sY * sX * cZ,
+                        cY * cX * cZ + sY * sX * sZ };
+}
+
+// Return the rotation with the given local axes (unit length and orthogonal, i.e. the rows of an
+// unscaled rotation matrix)
+CQuaternion QuaternionFromAxes(const CVector3& axisX, const CVector3& axisY, const CVector3& axisZ)
+{
+    // Standard method choosing the largest of w,x,y,z to calculate first for accuracy
+    float trace = axisX.x + axisY.y + axisZ.z;
+    if (trace > 0.0f)
+    {
+        float s = 0.5f / std::sqrt(trace + 1.0f);
+        return CQuaternion{ (axisY.z - axisZ.y) * s, (axisZ.x - axisX.z) * s, (axisX.y - axisY.x) * s, 0.25f / s };
+    }
+    else if (axisX.x > axisY.y && axisX.x > axisZ.z)
+    {
+        float s = 2.0f * std::sqrt(1.0f + axisX.x - axisY.y - axisZ.z);
+        float invS = 1.0f / s;
+        return CQuaternion{ 0.25f * s, (axisY.x + axisX.y) * invS, (axisZ.x + axisX.z) * invS, (axisY.z - axisZ.y) * invS };
+    }
+    else if (axisY.y > axisZ.z)
+    {
+        float s = 2.0f * std::sqrt(1.0f + axisY.y - axisX.x - axisZ.z);
+        float invS = 1.0f / s;
+        return CQuaternion{ (axisX.y + axisY.x) * invS, 0.25f * s, (axisZ.y + axisY.z) * invS, (axisZ.x - axisX.z) * invS };
+    }
+    else
+    {
+        float s = 2.0f * std::sqrt(1.0f + axisZ.z - axisX.x - axisY.y);
+        float invS = 1.0f / s;
+        return CQuaternion{ (axisZ.x + axisX.z) * invS, (axisZ.y + axisY.z) * invS, 0.25f * s, (axisX.y - axisY.x) * invS };
+    }
+}
+
+// Return a rotation whose Z axis faces from position towards target with the Y axis as close to world up
+// as possible. If the target is at the position or directly above / below it then currentRotation is returned
+CQuaternion QuaternionFaceTarget(const CVector3& position, const CVector3& target, const CQuaternion& currentRotation)
+{
+    // Same axis calculations as CMatrix4x4::FaceTarget, but no need to build a matrix or restore scale
+    CVector3 axisX, axisY, axisZ;
+    axisZ = Normalise(target - position);
+    if (IsZero(Length(axisZ))) return currentRotation;
+    axisX = Normalise(Cross({ 0, 1, 0 }, axisZ));
+    if (IsZero(Length(axisX))) return currentRotation;
+    axisY = Cross(axisZ, axisX); // Will already be normalised
+
+    return QuaternionFromAxes(axisX, axisY, axisZ);
+}
+
+// Return unit length quaternion in the same direction as given one (rotations must be unit length)
+CQuaternion Normalise(const CQuaternion& q)
+{
+    float lengthSq = q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w;
+
+    // Zero length quaternion isn't a rotation, return identity rather than dividing by zero
+    if (IsZero(lengthSq))
+    {
+        return QuaternionIdentity();
+    }
+    else
+    {
+        float invLength = InvSqrt(lengthSq);
+        return CQuaternion{ q.x * invLength, q.y * invLength, q.z * invLength, q.w * invLength };
+    }
+}
+
+
+// Build an affine world matrix from scale, rotation and translation, i.e. the result of
+// MatrixScaling(scale) * <rotation matrix> * MatrixTranslation(position) but without any matrix products
+CMatrix4x4 MatrixFromTRS(const CVector3& position, const CQuaternion& rotation, const CVector3& scale)
+{
+    float x2 = rotation.x + rotation.x, y2 = rotation.y + rotation.y, z2 = rotation.z + rotation.z;
+    float xx = rotation.x * x2, yy = rotation.y * y2, zz = rotation.z * z2;
+    float xy = rotation.x * y2, xz = rotation.x * z2, yz = rotation.y * z2;
+    float wx = rotation.w * x2, wy = rotation.w * y2, wz = rotation.w * z2;
+
+    return CMatrix4x4{ scale.x * (1.0f - yy - zz), scale.x * (xy + wz),        scale.x * (xz - wy),        0.0f,
+                       scale.y * (xy - wz),        scale.y * (1.0f - xx - zz), scale.y * (yz + wx),        0.0f,
+                       scale.z * (xz + wy),        scale.z * (yz - wx),        scale.z * (1.0f - xx - yy), 0.0f,
+                       position.x,                 position.y,                 position.z,                 1.0f };
+}
+
+// As MatrixFromTRS but returns the compact affine form used for model and camera world matrices
+CMatrix3x4 AffineFromTRS(const CVector3& position, const CQuaternion& rotation, const CVector3& scale)
+{
+    float x2 = rotation.x + rotation.x, y2 = rotation.y + rotation.y, z2 = rotation.z + rotation.z;
+    float xx = rotation.x * x2, yy = rotation.y * y2, zz = rotation.z * z2;
+    float xy = rotation.x * y2, xz = rotation.x * z2, yz = rotation.y * z2;
+    float wx = rotation.w * x2, wy = rotation.w * y2, wz = rotation.w * z2;
+
+    // Elements are listed column by column, see CMatrix3x4.h
+    return CMatrix3x4{ scale.x * (1.0f - yy - zz), scale.y * (xy - wz),        scale.z * (xz + wy),        position.x,
+                       scale.x * (xy + wz),        scale.y * (1.0f - xx - zz), scale.z * (yz - wx),        position.y,
+                       scale.x * (xz - wy),        scale.y * (yz + wx),        scale.z * (1.0f - xx - yy), position.z };
+}
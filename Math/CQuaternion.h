@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version) to hold rotations
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Quaternions follow the same conventions as CMatrix4x4: q1 * q2 is the rotation q1 followed by the
+// rotation q2, just as m1 * m2 is m1 followed by m2. Euler angles are applied in the same order as
+// Model and Camera have always used: Z first, then X, then Y
+
+#ifndef _CQUATERNION_H_DEFINED_
+#define _CQUATERNION_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
+#include <cmath>
+
+
+class CQuaternion
+{
+// Concrete class - public access
+public:
+    // Quaternion components - x,y,z is the vector part, w is the scalar part
+    float x;
+    float y;
+    float z;
+    float w;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    CQuaternion() {}
+
+    // Construct with 4 values
+    CQuaternion(const float xIn, const float yIn, const float zIn, const float wIn)
+    {
+        x = xIn;
+        y = yIn;
+        z = zIn;
+        w = wIn;
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Return the rotation held in this quaternion as Euler angles (Z, then X, then Y order)
+    CVector3 GetEulerAngles() const;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two rotations: q1 followed by q2 (same order as matrix multiplication)
+CQuaternion operator* (const CQuaternion& q1, const CQuaternion& q2);
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the identity quaternion (no rotation)
+CQuaternion QuaternionIdentity();
+
+// Return a rotation of the given angle (radians) around the given axis, which must be unit length
+CQuaternion QuaternionAxisAngle(const CVector3& axis, float angle);
+
+// Return a rotation matching the given Euler angles (radians), same result as
+// MatrixRotationZ(r.z) * MatrixRotationX(r.x) * MatrixRotationY(r.y)
+CQuaternion QuaternionFromEuler(const CVector3& r);
+
+// Return the rotation with the given local axes (unit length and orthogonal, i.e. the rows of an
+// unscaled rotation matrix)
+CQuaternion QuaternionFromAxes(const CVector3& axisX, const CVector3& axisY, const CVector3& axisZ);
+
+// Return a rotation whose Z axis faces from position towards target with the Y axis as close to world up
+// as possible. If the target is at the position or directly above / below it then currentRotation is returned
+CQuaternion QuaternionFaceTarget(const CVector3& position, const CVector3& target, const CQuaternion& currentRotation);
+
+// Return unit length quaternion in the same direction as given one (rotations must be unit length)
+CQuaternion Normalise(const CQuaternion& q);
+
+
+// Build an affine world matrix from scale, rotation and translation, i.e. the result of
+// MatrixScaling(scale) * <rotation matrix> * MatrixTranslation(position) but without any matrix products
+CMatrix4x4 MatrixFromTRS(const CVector3& position, const CQuaternion& rotation, const CVector3& scale);
+
+// As MatrixFromTRS but returns the compact affine form used for model and camera world matrices
+CMatrix3x4 AffineFromTRS(const CVector3& position, const CQuaternion& rotation, const CVector3& scale);
+
+
+#endif // _CQUATERNION_H_DEFINED_
@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------
+// Fast approximate maths: sine / cosine, reciprocal square root and normalisation
+//--------------------------------------------------------------------------------------
+
+#include "FastMath.h"
+#include "MathHelpers.h"
+#include <cstring>
+
+
+/*-----------------------------------------------------------------------------------------
+    Sine and cosine
+-----------------------------------------------------------------------------------------*/
+// The angle is reduced to r in [-PI/4, PI/4] by subtracting the nearest multiple q of PI/2. PI/2 is split
+// into three parts so q * part is exact for the first two parts, which keeps r accurate for large angles.
+// Sine and cosine of r come from minimax polynomials (same coefficients as the Cephes library), then:
+//     sin(r + q*PI/2) = sin(r) * A + cos(r) * B      cos(r + q*PI/2) = cos(r) * A - sin(r) * B
+// where A = cos(q*PI/2) and B = sin(q*PI/2) are each 1, 0 or -1. A and B are found from small cubics in
+// q mod 4 rather than with integer operations or branches, so the same code works for every SIMD backend
+
+static const float TWO_OVER_PI = 0.636619772367581f;
+static const float PI_OVER_2_A = 1.5703125f;
+static const float PI_OVER_2_B = 4.837512969970703125e-4f;
+static const float PI_OVER_2_C = 7.549789954891882e-8f;
+
+static const float SIN_C0 = -1.6666654611e-1f;
+static const float SIN_C1 =  8.3321608736e-3f;
+static const float SIN_C2 = -1.9515295891e-4f;
+
+static const float COS_C0 =  4.166664568298827e-2f;
+static const float COS_C1 = -1.388731625493765e-3f;
+static const float COS_C2 =  2.443315711809948e-5f;
+
+
+// Sine and cosine of SIMD_WIDTH angles
+static inline void SinCosBlock(const float* angles, float* sines, float* cosines)
+{
+    SimdFloat x = SimdLoad(angles);
+
+    // Quadrant q and reduced angle r
+    SimdFloat q = SimdRound(SimdMul(x, SimdSet1(TWO_OVER_PI)));
+    SimdFloat r = SimdSub(x, SimdMul(q, SimdSet1(PI_OVER_2_A)));
+    r = SimdSub(r, SimdMul(q, SimdSet1(PI_OVER_2_B)));
+    r = SimdSub(r, SimdMul(q, SimdSet1(PI_OVER_2_C)));
+
+    // Polynomials
+    SimdFloat z = SimdMul(r, r);
+    SimdFloat sinR = SimdAdd(SimdMul(z, SimdSet1(SIN_C2)), SimdSet1(SIN_C1));
+    sinR = SimdAdd(SimdMul(sinR, z), SimdSet1(SIN_C0));
+    sinR = SimdAdd(SimdMul(SimdMul(sinR, z), r), r);
+
+    SimdFloat cosR = SimdAdd(SimdMul(z, SimdSet1(COS_C2)), SimdSet1(COS_C1));
+    cosR = SimdAdd(SimdMul(cosR, z), SimdSet1(COS_C0));
+    cosR = SimdMul(SimdMul(cosR, z), z);
+    cosR = SimdAdd(SimdSub(cosR, SimdMul(z, SimdSet1(0.5f))), SimdSet1(1.0f));
+
+    // Quadrant q mod 4 in 0-3 (the floor is done by rounding since q / 4 only has fractions of quarters)
+    SimdFloat q4 = SimdSub(q, SimdMul(SimdSet1(4.0f), SimdRound(SimdSub(SimdMul(q, SimdSet1(0.25f)), SimdSet1(0.375f)))));
+
+    // A = (q4-1)(q4-3)(q4+1)/3 and B = q4(q4-2)(q4-4)/3 - exactly 1, 0 or -1
+    SimdFloat third = SimdSet1(1.0f / 3.0f);
+    SimdFloat a = SimdMul(SimdMul(SimdMul(SimdSub(q4, SimdSet1(1.0f)), SimdSub(q4, SimdSet1(3.0f))), SimdAdd(q4, SimdSet1(1.0f))), third);
+    SimdFloat b = SimdMul(SimdMul(SimdMul(q4, SimdSub(q4, SimdSet1(2.0f))), SimdSub(q4, SimdSet1(4.0f))), third);
+
+    SimdStore(sines,   SimdAdd(SimdMul(sinR, a), SimdMul(cosR, b)));
+    SimdStore(cosines, SimdSub(SimdMul(cosR, a), SimdMul(sinR, b)));
+}
+
+
+// Sine and cosine of a single angle (radians)
+void FastSinCos(float angle, float& s, float& c)
+{
+    // Same steps as SinCosBlock. Round to nearest by truncating (a plain conversion, std::nearbyint is a
+    // library call on some compilers), ties may round differently to the SIMD code but either is correct
+    int quadrant = static_cast<int>(angle * TWO_OVER_PI + std::copysign(0.5f, angle));
+    float q = static_cast<float>(quadrant);
+    float r = angle - q * PI_OVER_2_A;
+    r = r - q * PI_OVER_2_B;
+    r = r - q * PI_OVER_2_C;
+
+    float z = r * r;
+    float sinR = ((SIN_C2 * z + SIN_C1) * z + SIN_C0) * z * r + r;
+    float cosR = ((COS_C2 * z + COS_C1) * z + COS_C0) * z * z - 0.5f * z + 1.0f;
+
+    // Look up A and B rather than branching on the quadrant, angles from animations are not predictable
+    static const float quadrantA[4] = { 1, 0, -1,  0 };
+    static const float quadrantB[4] = { 0, 1,  0, -1 };
+    quadrant &= 3;
+    s = sinR * quadrantA[quadrant] + cosR * quadrantB[quadrant];
+    c = cosR * quadrantA[quadrant] - sinR * quadrantB[quadrant];
+}
+
+
+// Sine and cosine of count angles, SIMD_WIDTH at a time. Output arrays may be the same as the input
+void FastSinCos(const float* angles, float* sines, float* cosines, unsigned int count)
+{
+    unsigned int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        SinCosBlock(angles + i, sines + i, cosines + i);
+    }
+
+    // Remainder goes through a padded temporary block
+    unsigned int remaining = count - i;
+    if (remaining > 0)
+    {
+        float a[SIMD_WIDTH] = {}, s[SIMD_WIDTH], c[SIMD_WIDTH];
+        std::memcpy(a, angles + i, remaining * sizeof(float));
+        SinCosBlock(a, s, c);
+        std::memcpy(sines   + i, s, remaining * sizeof(float));
+        std::memcpy(cosines + i, c, remaining * sizeof(float));
+    }
+}
+
+
+// Sine and cosine of count angles, uses FastSinCos in MATH_FAST_MATH builds and std::sin / std::cos otherwise
+void SinCos(const float* angles, float* sines, float* cosines, unsigned int count)
+{
+#ifdef MATH_FAST_MATH
+    FastSinCos(angles, sines, cosines, count);
+#else
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float angle = angles[i]; // Outputs may overwrite the input
+        sines[i]   = std::sin(angle);
+        cosines[i] = std::cos(angle);
+    }
+#endif
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Normalisation
+-----------------------------------------------------------------------------------------*/
+
+// Normalise SIMD_WIDTH vectors from SoA arrays
+static inline void NormaliseBlock(const float* xIn, const float* yIn, const float* zIn, float* xOut, float* yOut, float* zOut)
+{
+    SimdFloat x = SimdLoad(xIn);
+    SimdFloat y = SimdLoad(yIn);
+    SimdFloat z = SimdLoad(zIn);
+
+    SimdFloat lengthSq = SimdAdd(SimdAdd(SimdMul(x, x), SimdMul(y, y)), SimdMul(z, z));
+
+    // Estimate plus one Newton-Raphson step: y * (1.5 - 0.5 * lengthSq * y * y)
+    SimdFloat invLength = SimdRsqrtEstimate(lengthSq);
+    SimdFloat halfLengthSq = SimdMul(lengthSq, SimdSet1(0.5f));
+    invLength = SimdMul(invLength, SimdSub(SimdSet1(1.5f), SimdMul(halfLengthSq, SimdMul(invLength, invLength))));
+
+    // Zero length vectors (which give infinity or NaN above) are set to zero
+    invLength = SimdSelect(SimdCmpLT(lengthSq, SimdSet1(EPSILON)), SimdSet1(0.0f), invLength);
+
+    SimdStore(xOut, SimdMul(x, invLength));
+    SimdStore(yOut, SimdMul(y, invLength));
+    SimdStore(zOut, SimdMul(z, invLength));
+}
+
+
+// Normalise count vectors held in structure-of-arrays form. Output arrays may be the same as the input
+void FastNormalise(const float* xIn, const float* yIn, const float* zIn,
+                   float* xOut, float* yOut, float* zOut, unsigned int count)
+{
+    unsigned int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        NormaliseBlock(xIn + i, yIn + i, zIn + i, xOut + i, yOut + i, zOut + i);
+    }
+
+    // Remainder goes through a padded temporary block
+    unsigned int remaining = count - i;
+    if (remaining > 0)
+    {
+        float x[SIMD_WIDTH] = {}, y[SIMD_WIDTH] = {}, z[SIMD_WIDTH] = {};
+        std::memcpy(x, xIn + i, remaining * sizeof(float));
+        std::memcpy(y, yIn + i, remaining * sizeof(float));
+        std::memcpy(z, zIn + i, remaining * sizeof(float));
+        NormaliseBlock(x, y, z, x, y, z);
+        std::memcpy(xOut + i, x, remaining * sizeof(float));
+        std::memcpy(yOut + i, y, remaining * sizeof(float));
+        std::memcpy(zOut + i, z, remaining * sizeof(float));
+    }
+}
+
+
+// Normalise count vectors in strided arrays of structures. Gathering strided vectors into SIMD registers
+// costs more than it saves here, so each vector is done on its own using FastInvSqrt
+void FastNormalise(const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count)
+{
+    const unsigned char* src = static_cast<const unsigned char*>(in);
+    unsigned char*       dst = static_cast<unsigned char*>(out);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float v[3];
+        std::memcpy(v, src, sizeof(v));
+
+        float lengthSq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        float invLength = (lengthSq < EPSILON) ? 0.0f : FastInvSqrt(lengthSq);
+        v[0] *= invLength;
+        v[1] *= invLength;
+        v[2] *= invLength;
+
+        std::memcpy(dst, v, sizeof(v));
+        src += inStride;
+        dst += outStride;
+    }
+}
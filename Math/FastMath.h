@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------
+// Fast approximate maths: sine / cosine, reciprocal square root and normalisation
+//--------------------------------------------------------------------------------------
+// Code in .cpp file, except FastInvSqrt which is inline
+//
+// The Fast functions here are always the approximate versions. Define MATH_FAST_MATH in the project
+// settings to make the rest of the maths code use them too: InvSqrt (so Normalise), SinCos (so the
+// rotation matrices, MatrixFromTRS and the quaternion functions) and the batch SinCos used by the scene.
+// Without MATH_FAST_MATH those all use the standard library as before.
+//
+// Maximum errors against double precision results (checked by the Math benchmark program):
+// - FastSinCos:    1e-7 absolute for |angle| <= 8192 radians (about 1 ulp for results near 1). Accuracy falls
+//                  away for larger angles (1e-6 at 100000 radians), so wrap long running animation angles
+// - FastInvSqrt:   3e-7 relative with SSE / AVX (12-bit hardware estimate plus one Newton-Raphson step).
+//                  NEON's estimate is less precise so it takes two steps. Scalar builds use 1 / std::sqrt.
+//                  The input must be greater than zero
+// - FastNormalise: 1.3e-7 absolute per component. Vectors with length squared below EPSILON become zero,
+//                  like Normalise
+
+#ifndef _FAST_MATH_H_DEFINED_
+#define _FAST_MATH_H_DEFINED_
+
+#include "MathSIMD.h"
+#include <cmath>
+
+
+/*-----------------------------------------------------------------------------------------
+    Reciprocal square root
+-----------------------------------------------------------------------------------------*/
+
+// Approximate 1 / sqrt(x) for x > 0 - see error bounds above
+inline float FastInvSqrt(const float x)
+{
+#if defined(MATH_SIMD_SSE)
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    return y * (1.5f - 0.5f * x * y * y); // One Newton-Raphson step
+#elif defined(MATH_SIMD_NEON)
+    float32x2_t v = vdup_n_f32(x);
+    float32x2_t y = vrsqrte_f32(v);
+    y = vmul_f32(y, vrsqrts_f32(vmul_f32(v, y), y));
+    y = vmul_f32(y, vrsqrts_f32(vmul_f32(v, y), y));
+    return vget_lane_f32(y, 0);
+#else
+    return 1.0f / std::sqrt(x);
+#endif
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Sine and cosine
+-----------------------------------------------------------------------------------------*/
+
+// Sine and cosine of a single angle (radians)
+void FastSinCos(float angle, float& s, float& c);
+
+// Sine and cosine of count angles, SIMD_WIDTH at a time. Output arrays may be the same as the input
+void FastSinCos(const float* angles, float* sines, float* cosines, unsigned int count);
+
+// Sine and cosine of count angles, uses FastSinCos in MATH_FAST_MATH builds and std::sin / std::cos otherwise
+void SinCos(const float* angles, float* sines, float* cosines, unsigned int count);
+
+
+/*-----------------------------------------------------------------------------------------
+    Normalisation
+-----------------------------------------------------------------------------------------*/
+
+// Normalise count vectors held in structure-of-arrays form. Output arrays may be the same as the input
+void FastNormalise(const float* xIn, const float* yIn, const float* zIn,
+                   float* xOut, float* yOut, float* zOut, unsigned int count);
+
+// Normalise count vectors in strided arrays of structures, strides are the distance in bytes from one x,y,z
+// to the next (see TransformBatch.h). Input and output may be the same
+void FastNormalise(const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count);
+
+
+#endif // _FAST_MATH_H_DEFINED_
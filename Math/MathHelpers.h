@@ -6,40 +6,95 @@
 #define _MATH_HELPERS_H_DEFINED_
 
 #include <cmath>
+#include <limits>
+
+#ifdef MATH_FAST_MATH
+#include "FastMath.h"
+#endif
 
 
 // Surprisingly, pi is not *officially* defined anywhere in C++
-const float PI = 3.14159265359f;
+constexpr float PI = 3.14159265359f;
 
 
 
 // Test if a float value is approximately 0
 // Epsilon value is the range around zero that is considered equal to zero
-const float EPSILON = 0.5e-6f; // For 32-bit floats, requires zero to 6 decimal places
-inline bool IsZero(const float x)
+constexpr float EPSILON = 0.5e-6f; // For 32-bit floats, requires zero to 6 decimal places
+constexpr bool IsZero(const float x)
 {
-    return std::abs(x) < EPSILON;
+    return x < EPSILON && x > -EPSILON;
 }
 
 
 // 1 / Sqrt. Used often (e.g. normalising) and can be optimised, so it gets its own function
+// MATH_FAST_MATH builds use the approximate FastInvSqrt (see FastMath.h)
 inline float InvSqrt(const float x)
 {
+#ifdef MATH_FAST_MATH
+    return FastInvSqrt(x);
+#else
     return 1.0f / std::sqrt(x);
+#endif
+}
+
+
+// Sine and cosine of the same angle (radians). MATH_FAST_MATH builds use FastSinCos (see FastMath.h)
+inline void SinCos(const float angle, float& s, float& c)
+{
+#ifdef MATH_FAST_MATH
+    FastSinCos(angle, s, c);
+#else
+    s = std::sin(angle);
+    c = std::cos(angle);
+#endif
 }
 
 
 // Pass an angle in degrees, returns the angle in radians
-inline float ToRadians(float d)
+constexpr float ToRadians(float d)
 {
     return  d * PI / 180.0f;
 }
 
 // Pass an angle in radians, returns the angle in degrees
-inline float ToDegrees(float r)
+constexpr float ToDegrees(float r)
 {
     return  r * 180.0f / PI;
 }
 
 
+// Largest angle (radians, either sign) ConstexprTan accepts. Floats this large are 0.06 radians apart, so
+// their tangents are meaningless anyway
+constexpr float CONSTEXPR_TAN_MAX_ANGLE = 1e6f;
+
+// Tangent of an angle (radians) that can be calculated at compile time, std::tan cannot. Accurate to within
+// 1 ulp of std::tan for angles in the range -PI/2 to PI/2 (e.g. half a field of view). Slower than std::tan
+// so prefer that for run-time only code. Returns NaN for angles that are not finite or are larger than
+// CONSTEXPR_TAN_MAX_ANGLE
+constexpr float ConstexprTan(float r)
+{
+    if (!(r >= -CONSTEXPR_TAN_MAX_ANGLE && r <= CONSTEXPR_TAN_MAX_ANGLE))  return std::numeric_limits<float>::quiet_NaN();
+
+    // Reduce angle to range -PI/2 to PI/2 (tan repeats every PI) by taking off the nearest multiple of PI
+    const double pi = 3.14159265358979323846;
+    double x = r;
+    double turns = x / pi;
+    x -= pi * static_cast<double>(static_cast<long long>(turns + (turns >= 0 ? 0.5 : -0.5)));
+
+    // Taylor series for sin and cos in double precision, enough terms for full float accuracy in this range
+    double x2 = x * x;
+    double sinTerm = x, sinSum = x;
+    double cosTerm = 1, cosSum = 1;
+    for (int n = 1; n < 12; ++n)
+    {
+        sinTerm *= -x2 / ((2 * n) * (2 * n + 1));
+        cosTerm *= -x2 / ((2 * n - 1) * (2 * n));
+        sinSum += sinTerm;
+        cosSum += cosTerm;
+    }
+    return static_cast<float>(sinSum / cosSum);
+}
+
+
 #endif // _MATH_HELPERS_H_DEFINED_
@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------
+// Compile-time selection of the SIMD instruction set used by the maths code
+//--------------------------------------------------------------------------------------
+// Exactly one of MATH_SIMD_AVX, MATH_SIMD_SSE, MATH_SIMD_NEON or MATH_SIMD_NONE is defined after
+// including this file. AVX builds also define MATH_SIMD_SSE since they use the SSE code for 4-wide work.
+// Define MATH_NO_SIMD in the project settings to force the plain C++ (scalar) code everywhere.
+
+#ifndef _MATH_SIMD_H_DEFINED_
+#define _MATH_SIMD_H_DEFINED_
+
+#if !defined(MATH_NO_SIMD) && (defined(__AVX__))
+    #define MATH_SIMD_AVX
+    #define MATH_SIMD_SSE
+    #include <immintrin.h>
+#elif !defined(MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define MATH_SIMD_SSE
+    #include <emmintrin.h>
+#elif !defined(MATH_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+    #define MATH_SIMD_NEON
+    #include <arm_neon.h>
+#else
+    #define MATH_SIMD_NONE
+    #include <cmath>
+#endif
+
+
+// Name of the instruction set selected above, useful when reporting timings
+#if defined(MATH_SIMD_AVX)
+const char* const MATH_SIMD_NAME = "AVX";
+#elif defined(MATH_SIMD_SSE)
+const char* const MATH_SIMD_NAME = "SSE2";
+#elif defined(MATH_SIMD_NEON)
+const char* const MATH_SIMD_NAME = "NEON";
+#else
+const char* const MATH_SIMD_NAME = "Scalar";
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Lane-width wrappers
+-----------------------------------------------------------------------------------------*/
+// Batch kernels that work on arrays of floats are written once using SimdFloat and the functions below.
+// SimdFloat holds SIMD_WIDTH floats: 8 for AVX, 4 for SSE/NEON and 1 (a plain float) for scalar builds.
+// Loads and stores are unaligned.
+//
+// Comparisons return a SimdMask with all bits set in lanes where the comparison is true. SimdMaskBits packs a
+// mask into an int with bit i set for lane i, which is used to build lists of indexes from SIMD results.
+// SimdSelect(m, a, b) picks a in lanes where the mask is set and b elsewhere.
+//
+// SimdRound rounds to the nearest integer (halves to even), valid for |x| < 2^31. SimdRsqrtEstimate is an
+// approximate 1/sqrt with at least 12 bits of precision, FastMath.h refines it.
+
+#if defined(MATH_SIMD_AVX)
+
+typedef __m256 SimdFloat;
+const int SIMD_WIDTH = 8;
+
+inline SimdFloat SimdLoad(const float* p)           { return _mm256_loadu_ps(p); }
+inline void      SimdStore(float* p, SimdFloat v)   { _mm256_storeu_ps(p, v); }
+inline SimdFloat SimdSet1(float f)                  { return _mm256_set1_ps(f); }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)  { return _mm256_add_ps(a, b); }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)  { return _mm256_sub_ps(a, b); }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)  { return _mm256_mul_ps(a, b); }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)  { return _mm256_div_ps(a, b); }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)  { return _mm256_min_ps(a, b); }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)  { return _mm256_max_ps(a, b); }
+
+typedef __m256 SimdMask;
+inline SimdMask  SimdCmpLT(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline SimdMask  SimdMaskOr(SimdMask a, SimdMask b)  { return _mm256_or_ps(a, b); }
+inline int       SimdMaskBits(SimdMask m)            { return _mm256_movemask_ps(m); }
+inline SimdFloat SimdSelect(SimdMask m, SimdFloat a, SimdFloat b) { return _mm256_blendv_ps(b, a, m); }
+
+inline SimdFloat SimdRound(SimdFloat a)             { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline SimdFloat SimdRsqrtEstimate(SimdFloat a)     { return _mm256_rsqrt_ps(a); }
+
+#elif defined(MATH_SIMD_SSE)
+
+typedef __m128 SimdFloat;
+const int SIMD_WIDTH = 4;
+
+inline SimdFloat SimdLoad(const float* p)           { return _mm_loadu_ps(p); }
+inline void      SimdStore(float* p, SimdFloat v)   { _mm_storeu_ps(p, v); }
+inline SimdFloat SimdSet1(float f)                  { return _mm_set1_ps(f); }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)  { return _mm_add_ps(a, b); }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)  { return _mm_sub_ps(a, b); }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)  { return _mm_mul_ps(a, b); }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)  { return _mm_div_ps(a, b); }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)  { return _mm_min_ps(a, b); }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)  { return _mm_max_ps(a, b); }
+
+typedef __m128 SimdMask;
+inline SimdMask  SimdCmpLT(SimdFloat a, SimdFloat b) { return _mm_cmplt_ps(a, b); }
+inline SimdMask  SimdMaskOr(SimdMask a, SimdMask b)  { return _mm_or_ps(a, b); }
+inline int       SimdMaskBits(SimdMask m)            { return _mm_movemask_ps(m); }
+inline SimdFloat SimdSelect(SimdMask m, SimdFloat a, SimdFloat b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+inline SimdFloat SimdRound(SimdFloat a)             { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline SimdFloat SimdRsqrtEstimate(SimdFloat a)     { return _mm_rsqrt_ps(a); }
+
+#elif defined(MATH_SIMD_NEON)
+
+typedef float32x4_t SimdFloat;
+const int SIMD_WIDTH = 4;
+
+inline SimdFloat SimdLoad(const float* p)           { return vld1q_f32(p); }
+inline void      SimdStore(float* p, SimdFloat v)   { vst1q_f32(p, v); }
+inline SimdFloat SimdSet1(float f)                  { return vdupq_n_f32(f); }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)  { return vaddq_f32(a, b); }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)  { return vsubq_f32(a, b); }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)  { return vmulq_f32(a, b); }
+#if defined(__aarch64__) || defined(_M_ARM64)
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)  { return vdivq_f32(a, b); }
+#else
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)
+{
+    float fa[4], fb[4];
+    vst1q_f32(fa, a);  vst1q_f32(fb, b);
+    for (int i = 0; i < 4; ++i)  fa[i] /= fb[i];
+    return vld1q_f32(fa);
+}
+#endif
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)  { return vminq_f32(a, b); }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)  { return vmaxq_f32(a, b); }
+
+typedef uint32x4_t SimdMask;
+inline SimdMask  SimdCmpLT(SimdFloat a, SimdFloat b) { return vcltq_f32(a, b); }
+inline SimdMask  SimdMaskOr(SimdMask a, SimdMask b)  { return vorrq_u32(a, b); }
+inline int       SimdMaskBits(SimdMask m)
+{
+    const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+    uint32x4_t bits = vandq_u32(m, vld1q_u32(laneBits));
+    uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+    return static_cast<int>(vget_lane_u32(vpadd_u32(sum, sum), 0));
+}
+inline SimdFloat SimdSelect(SimdMask m, SimdFloat a, SimdFloat b) { return vbslq_f32(m, a, b); }
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+inline SimdFloat SimdRound(SimdFloat a)             { return vrndnq_f32(a); }
+#else
+inline SimdFloat SimdRound(SimdFloat a)
+{
+    // Add and subtract 1.5 * 2^23 to round in the current (nearest even) rounding mode, |a| < 2^22 only
+    const float32x4_t magic = vdupq_n_f32(12582912.0f);
+    return vsubq_f32(vaddq_f32(a, magic), magic);
+}
+#endif
+// NEON's estimate has about 8 bits of precision, one refinement step brings it up to SSE's 12 bits
+inline SimdFloat SimdRsqrtEstimate(SimdFloat a)
+{
+    float32x4_t e = vrsqrteq_f32(a);
+    return vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a, e), e));
+}
+
+#else
+
+typedef float SimdFloat;
+const int SIMD_WIDTH = 1;
+
+inline SimdFloat SimdLoad(const float* p)           { return *p; }
+inline void      SimdStore(float* p, SimdFloat v)   { *p = v; }
+inline SimdFloat SimdSet1(float f)                  { return f; }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)  { return a + b; }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)  { return a - b; }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)  { return a * b; }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)  { return a / b; }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)  { return a < b ? a : b; }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)  { return a > b ? a : b; }
+
+typedef bool SimdMask;
+inline SimdMask  SimdCmpLT(SimdFloat a, SimdFloat b) { return a < b; }
+inline SimdMask  SimdMaskOr(SimdMask a, SimdMask b)  { return a || b; }
+inline int       SimdMaskBits(SimdMask m)            { return m ? 1 : 0; }
+inline SimdFloat SimdSelect(SimdMask m, SimdFloat a, SimdFloat b) { return m ? a : b; }
+
+inline SimdFloat SimdRound(SimdFloat a)             { return std::nearbyint(a); }
+inline SimdFloat SimdRsqrtEstimate(SimdFloat a)     { return 1.0f / std::sqrt(a); }
+
+#endif
+
+
+#endif // _MATH_SIMD_H_DEFINED_
@@ -0,0 +1,416 @@
+//--------------------------------------------------------------------------------------
+// Packing of floats and unit vectors into compact formats for GPU data
+//--------------------------------------------------------------------------------------
+
+#include "Packing.h"
+#include "MathSIMD.h"
+#include <cmath>
+#include <cstring>
+
+// MSVC has no __F16C__, its /arch:AVX2 implies F16C. GCC and clang only enable F16C when asked (-mf16c or an
+// -march that has it), -mavx2 alone does not
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+    #define PACKING_F16C
+    #include <immintrin.h>
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Helpers
+-----------------------------------------------------------------------------------------*/
+
+static inline uint32_t FloatBits(float f)     { uint32_t u; std::memcpy(&u, &f, sizeof(u)); return u; }
+static inline float    BitsToFloat(uint32_t u) { float f; std::memcpy(&f, &u, sizeof(f)); return f; }
+
+static inline float Clamp(float f, float minimum, float maximum)
+{
+    return f < minimum ? minimum : (f > maximum ? maximum : f);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Half float
+-----------------------------------------------------------------------------------------*/
+// Conversions work on the bit patterns rather than with branches on the exponent, using float adds to do
+// the rounding and denormal shifts (after F. Giesen's "half to float done quic"). The SSE2 versions below
+// are the same steps with each branch calculated for all lanes then selected with a mask
+
+static const uint32_t F32_INFINITY    = 255u << 23;             // Float infinity bits
+static const uint32_t F16_MAX_AS_F32  = (127u + 16) << 23;      // Smallest float that is too big for a half
+static const uint32_t F16_MIN_NORMAL  = 113u << 23;             // Smallest float that is a normal half (2^-14)
+static const uint32_t DENORM_MAGIC    = ((127u - 15) + (23 - 10) + 1) << 23; // Adding this shifts denormals into place
+static const uint32_t HALF_EXPONENT   = 0x7c00u << 13;          // Half exponent bits after shifting to float position
+
+uint16_t FloatToHalf(float f)
+{
+    uint32_t bits = FloatBits(f);
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t half;
+    if (bits >= F16_MAX_AS_F32)
+    {
+        half = (bits > F32_INFINITY) ? 0x7e00 : 0x7c00; // NaN or infinity
+    }
+    else if (bits < F16_MIN_NORMAL)
+    {
+        // Denormal or zero: adding the magic number leaves the rounded half mantissa in the low bits
+        half = FloatBits(BitsToFloat(bits) + BitsToFloat(DENORM_MAGIC)) - DENORM_MAGIC;
+    }
+    else
+    {
+        // Normal: rebias exponent, round to nearest even, and shift down
+        uint32_t mantissaOdd = (bits >> 13) & 1;
+        bits += ((uint32_t)(15 - 127) << 23) + 0xfff;
+        bits += mantissaOdd;
+        half = bits >> 13;
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+float HalfToFloat(uint16_t h)
+{
+    uint32_t bits = (h & 0x7fffu) << 13; // Exponent and mantissa
+    uint32_t exponent = bits & HALF_EXPONENT;
+    bits += (127u - 15) << 23;           // Rebias exponent
+
+    if (exponent == HALF_EXPONENT)
+    {
+        bits += (128u - 16) << 23;       // Infinity or NaN
+    }
+    else if (exponent == 0)
+    {
+        bits += 1u << 23;                // Zero or denormal, renormalise
+        bits = FloatBits(BitsToFloat(bits) - BitsToFloat(F16_MIN_NORMAL));
+    }
+    return BitsToFloat(bits | ((h & 0x8000u) << 16));
+}
+
+
+#if defined(MATH_SIMD_SSE) && !defined(PACKING_F16C)
+
+static inline __m128i SelectInt(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Four floats to four halves in the low 16 bits of each 32-bit lane
+static inline __m128i FloatToHalf4(__m128 f)
+{
+    __m128i bits = _mm_castps_si128(f);
+    __m128i sign = _mm_and_si128(bits, _mm_set1_epi32(0x80000000u));
+    bits = _mm_xor_si128(bits, sign);
+
+    // Signed comparisons are fine since the sign bit has been cleared
+    __m128i isInfNaN  = _mm_cmpgt_epi32(bits, _mm_set1_epi32(F16_MAX_AS_F32 - 1));
+    __m128i isDenorm  = _mm_cmplt_epi32(bits, _mm_set1_epi32(F16_MIN_NORMAL));
+    __m128i infNaN    = SelectInt(_mm_cmpgt_epi32(bits, _mm_set1_epi32(F32_INFINITY)), _mm_set1_epi32(0x7e00), _mm_set1_epi32(0x7c00));
+
+    __m128  magic     = _mm_castsi128_ps(_mm_set1_epi32(DENORM_MAGIC));
+    __m128i denorm    = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), magic)), _mm_set1_epi32(DENORM_MAGIC));
+
+    __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    __m128i normal    = _mm_add_epi32(bits, _mm_set1_epi32(((uint32_t)(15 - 127) << 23) + 0xfff));
+    normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+    __m128i half = SelectInt(isInfNaN, infNaN, SelectInt(isDenorm, denorm, normal));
+    return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+}
+
+// Four halves in the low 16 bits of each 32-bit lane to four floats
+static inline __m128 HalfToFloat4(__m128i h)
+{
+    __m128i bits = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+    __m128i exponent = _mm_and_si128(bits, _mm_set1_epi32(HALF_EXPONENT));
+    bits = _mm_add_epi32(bits, _mm_set1_epi32((127u - 15) << 23));
+
+    __m128i infNaN = _mm_add_epi32(bits, _mm_set1_epi32((128u - 16) << 23));
+    __m128  denorm = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1u << 23))),
+                                _mm_castsi128_ps(_mm_set1_epi32(F16_MIN_NORMAL)));
+
+    bits = SelectInt(_mm_cmpeq_epi32(exponent, _mm_set1_epi32(HALF_EXPONENT)), infNaN, bits);
+    bits = SelectInt(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()), _mm_castps_si128(denorm), bits);
+    return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+}
+
+#endif
+
+
+void FloatToHalf(const float* in, uint16_t* out, unsigned int count)
+{
+    unsigned int i = 0;
+#if defined(PACKING_F16C)
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_ph(_mm_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif defined(MATH_SIMD_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        // Sign extend the 16-bit results so the signed saturating pack leaves them unchanged
+        __m128i half = FloatToHalf4(_mm_loadu_ps(in + i));
+        half = _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(half, half));
+    }
+#elif defined(MATH_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+    }
+#endif
+    for (; i < count; ++i)  out[i] = FloatToHalf(in[i]);
+}
+
+void HalfToFloat(const uint16_t* in, float* out, unsigned int count)
+{
+    unsigned int i = 0;
+#if defined(PACKING_F16C)
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i))));
+    }
+#elif defined(MATH_SIMD_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i halves = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)), _mm_setzero_si128());
+        _mm_storeu_ps(out + i, HalfToFloat4(halves));
+    }
+#elif defined(MATH_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + i))));
+    }
+#endif
+    for (; i < count; ++i)  out[i] = HalfToFloat(in[i]);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Normalised integers
+-----------------------------------------------------------------------------------------*/
+// std::lrint rounds to nearest even, the same as the SSE conversion used in the bulk versions
+
+int16_t FloatToSnorm16(float f)  { return static_cast<int16_t>(std::lrint(Clamp(f, -1.0f, 1.0f) * 32767.0f)); }
+int8_t  FloatToSnorm8(float f)   { return static_cast<int8_t> (std::lrint(Clamp(f, -1.0f, 1.0f) * 127.0f)); }
+uint8_t FloatToUnorm8(float f)   { return static_cast<uint8_t>(std::lrint(Clamp(f,  0.0f, 1.0f) * 255.0f)); }
+
+// -32768 and -128 are valid SNORM values that also mean -1
+float Snorm16ToFloat(int16_t s)  { float f = s * (1.0f / 32767.0f);  return f < -1.0f ? -1.0f : f; }
+float Snorm8ToFloat(int8_t s)    { float f = s * (1.0f / 127.0f);    return f < -1.0f ? -1.0f : f; }
+float Unorm8ToFloat(uint8_t u)   { return u * (1.0f / 255.0f); }
+
+
+void FloatToSnorm16(const float* in, int16_t* out, unsigned int count)
+{
+    unsigned int i = 0;
+#if defined(MATH_SIMD_SSE)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 f0 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i),     _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        __m128 f1 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        __m128i s0 = _mm_cvtps_epi32(_mm_mul_ps(f0, _mm_set1_ps(32767.0f)));
+        __m128i s1 = _mm_cvtps_epi32(_mm_mul_ps(f1, _mm_set1_ps(32767.0f)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(s0, s1));
+    }
+#endif
+    for (; i < count; ++i)  out[i] = FloatToSnorm16(in[i]);
+}
+
+void Snorm16ToFloat(const int16_t* in, float* out, unsigned int count)
+{
+    unsigned int i = 0;
+#if defined(MATH_SIMD_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        // Unpack each value into the top 16 bits of a lane then shift down to sign extend
+        __m128i s = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        s = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(1.0f / 32767.0f));
+        _mm_storeu_ps(out + i, _mm_max_ps(f, _mm_set1_ps(-1.0f)));
+    }
+#endif
+    for (; i < count; ++i)  out[i] = Snorm16ToFloat(in[i]);
+}
+
+
+void FloatToUnorm8(const float* in, uint8_t* out, unsigned int count)
+{
+    unsigned int i = 0;
+#if defined(MATH_SIMD_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i u = _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set1_ps(255.0f)));
+        u = _mm_packus_epi16(_mm_packs_epi32(u, u), u);
+        int packed = _mm_cvtsi128_si32(u);
+        std::memcpy(out + i, &packed, 4);
+    }
+#endif
+    for (; i < count; ++i)  out[i] = FloatToUnorm8(in[i]);
+}
+
+void Unorm8ToFloat(const uint8_t* in, float* out, unsigned int count)
+{
+    unsigned int i = 0;
+#if defined(MATH_SIMD_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        int packed;
+        std::memcpy(&packed, in + i, 4);
+        __m128i u = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), _mm_setzero_si128());
+        u = _mm_unpacklo_epi16(u, _mm_setzero_si128());
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(u), _mm_set1_ps(1.0f / 255.0f)));
+    }
+#endif
+    for (; i < count; ++i)  out[i] = Unorm8ToFloat(in[i]);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Octahedral unit vectors
+-----------------------------------------------------------------------------------------*/
+
+// Unpacked octahedral coordinates, both -1 to 1. The vector need not be unit length but must not be zero
+CVector2 OctahedralEncode(const CVector3& v)
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half (z < 0) over the upper half
+    float invL1 = 1.0f / (std::abs(v.x) + std::abs(v.y) + std::abs(v.z));
+    float u = v.x * invL1;
+    float w = v.y * invL1;
+    if (v.z < 0.0f)
+    {
+        float foldedU = (1.0f - std::abs(w)) * (u < 0.0f ? -1.0f : 1.0f);
+        float foldedW = (1.0f - std::abs(u)) * (w < 0.0f ? -1.0f : 1.0f);
+        u = foldedU;
+        w = foldedW;
+    }
+    return CVector2{ u, w };
+}
+
+// Unit vector from octahedral coordinates
+CVector3 OctahedralDecode(const CVector2& p)
+{
+    CVector3 v{ p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y) };
+    float t = v.z < 0.0f ? -v.z : 0.0f; // Unfold the lower half
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+
+    float invLength = 1.0f / std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    return CVector3{ v.x * invLength, v.y * invLength, v.z * invLength };
+}
+
+
+uint32_t PackOctahedral16(const CVector3& v)
+{
+    CVector2 p = OctahedralEncode(v);
+    return static_cast<uint16_t>(FloatToSnorm16(p.x)) | (static_cast<uint32_t>(static_cast<uint16_t>(FloatToSnorm16(p.y))) << 16);
+}
+
+CVector3 UnpackOctahedral16(uint32_t packed)
+{
+    return OctahedralDecode({ Snorm16ToFloat(static_cast<int16_t>(packed & 0xffff)), Snorm16ToFloat(static_cast<int16_t>(packed >> 16)) });
+}
+
+uint16_t PackOctahedral8(const CVector3& v)
+{
+    CVector2 p = OctahedralEncode(v);
+    return static_cast<uint16_t>(static_cast<uint8_t>(FloatToSnorm8(p.x)) | (static_cast<uint8_t>(FloatToSnorm8(p.y)) << 8));
+}
+
+CVector3 UnpackOctahedral8(uint16_t packed)
+{
+    return OctahedralDecode({ Snorm8ToFloat(static_cast<int8_t>(packed & 0xff)), Snorm8ToFloat(static_cast<int8_t>(packed >> 8)) });
+}
+
+
+// Encode SIMD_WIDTH vectors from SoA arrays to octahedral coordinates - same steps as OctahedralEncode
+static inline void OctahedralEncodeBlock(const float* xIn, const float* yIn, const float* zIn, float* uOut, float* wOut)
+{
+    SimdFloat zero = SimdSet1(0.0f);
+    SimdFloat one  = SimdSet1(1.0f);
+    SimdFloat x = SimdLoad(xIn);
+    SimdFloat y = SimdLoad(yIn);
+    SimdFloat z = SimdLoad(zIn);
+
+    SimdFloat absX = SimdMax(x, SimdSub(zero, x));
+    SimdFloat absY = SimdMax(y, SimdSub(zero, y));
+    SimdFloat absZ = SimdMax(z, SimdSub(zero, z));
+    SimdFloat invL1 = SimdDiv(one, SimdAdd(SimdAdd(absX, absY), absZ));
+    SimdFloat u = SimdMul(x, invL1);
+    SimdFloat w = SimdMul(y, invL1);
+
+    SimdFloat absU = SimdMax(u, SimdSub(zero, u));
+    SimdFloat absW = SimdMax(w, SimdSub(zero, w));
+    SimdFloat signU = SimdSelect(SimdCmpLT(u, zero), SimdSet1(-1.0f), one);
+    SimdFloat signW = SimdSelect(SimdCmpLT(w, zero), SimdSet1(-1.0f), one);
+    SimdMask  lowerHalf = SimdCmpLT(z, zero);
+
+    SimdStore(uOut, SimdSelect(lowerHalf, SimdMul(SimdSub(one, absW), signU), u));
+    SimdStore(wOut, SimdSelect(lowerHalf, SimdMul(SimdSub(one, absU), signW), w));
+}
+
+// Gather up to SIMD_WIDTH strided vectors, encode them and pass each result to the given packing function
+template <typename Packed, typename PackFn>
+static void PackOctahedralStrided(const void* in, unsigned int inStride, Packed* out, unsigned int count, PackFn pack)
+{
+    const unsigned char* src = static_cast<const unsigned char*>(in);
+
+    float x[SIMD_WIDTH] = {}, y[SIMD_WIDTH] = {}, z[SIMD_WIDTH] = {}, u[SIMD_WIDTH], w[SIMD_WIDTH];
+    for (unsigned int i = 0; i < count; i += SIMD_WIDTH)
+    {
+        unsigned int blockSize = (count - i < SIMD_WIDTH) ? count - i : SIMD_WIDTH;
+        for (unsigned int lane = 0; lane < blockSize; ++lane)
+        {
+            float v[3];
+            std::memcpy(v, src, sizeof(v));
+            x[lane] = v[0];
+            y[lane] = v[1];
+            z[lane] = v[2];
+            src += inStride;
+        }
+        for (unsigned int lane = blockSize; lane < SIMD_WIDTH; ++lane)  z[lane] = 1.0f; // Avoid 0 / 0 in unused lanes
+
+        OctahedralEncodeBlock(x, y, z, u, w);
+
+        for (unsigned int lane = 0; lane < blockSize; ++lane)  out[i + lane] = pack(u[lane], w[lane]);
+    }
+}
+
+void PackOctahedral16(const void* in, unsigned int inStride, uint32_t* out, unsigned int count)
+{
+    PackOctahedralStrided(in, inStride, out, count, [](float u, float w)
+    {
+        return static_cast<uint16_t>(FloatToSnorm16(u)) | (static_cast<uint32_t>(static_cast<uint16_t>(FloatToSnorm16(w))) << 16);
+    });
+}
+
+void PackOctahedral8(const void* in, unsigned int inStride, uint16_t* out, unsigned int count)
+{
+    PackOctahedralStrided(in, inStride, out, count, [](float u, float w)
+    {
+        return static_cast<uint16_t>(static_cast<uint8_t>(FloatToSnorm8(u)) | (static_cast<uint8_t>(FloatToSnorm8(w)) << 8));
+    });
+}
+
+
+void UnpackOctahedral16(const uint32_t* in, void* out, unsigned int outStride, unsigned int count)
+{
+    unsigned char* dst = static_cast<unsigned char*>(out);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        CVector3 v = UnpackOctahedral16(in[i]);
+        std::memcpy(dst, &v, sizeof(v));
+        dst += outStride;
+    }
+}
+
+void UnpackOctahedral8(const uint16_t* in, void* out, unsigned int outStride, unsigned int count)
+{
+    unsigned char* dst = static_cast<unsigned char*>(out);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        CVector3 v = UnpackOctahedral8(in[i]);
+        std::memcpy(dst, &v, sizeof(v));
+        dst += outStride;
+    }
+}
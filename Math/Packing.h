@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// Packing of floats and unit vectors into compact formats for GPU data
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Each format matches a DXGI format so packed data can be put straight into vertex or constant buffers:
+// - Half:     16-bit IEEE float (DXGI_FORMAT_R16_FLOAT etc.). Rounds to nearest even, values too large
+//             become infinity, tiny values become half denormals, NaN stays NaN
+// - SNORM16:  -1 to 1 in a signed 16-bit integer, -32767 to 32767 (DXGI_FORMAT_R16_SNORM)
+// - SNORM8:   -1 to 1 in a signed 8-bit integer, -127 to 127 (DXGI_FORMAT_R8_SNORM)
+// - UNORM8:   0 to 1 in an unsigned 8-bit integer, 0 to 255 (DXGI_FORMAT_R8_UNORM)
+// Values outside the range of a normalised format are clamped. Rounding is to nearest.
+//
+// Octahedral encoding stores a unit vector (e.g. a normal) as two values in -1 to 1 by projecting it onto
+// an octahedron then unfolding that into a square. The two values are packed as SNORM16 (32 bits in total,
+// DXGI_FORMAT_R16G16_SNORM) or SNORM8 (16 bits, DXGI_FORMAT_R8G8_SNORM). The first value is in the low bits.
+//
+// Maximum round trip errors (pack then unpack), checked by the Math benchmark program:
+// - Half:          relative error 2^-11 (4.9e-4) for values in the normal half range (6.1e-5 to 65504)
+// - SNORM16:       1 / (2 * 32767) = 1.5e-5.  SNORM8: 1 / 254 = 3.9e-3.  UNORM8: 1 / 510 = 2.0e-3
+// - Octahedral16:  angle between original and unpacked unit vector 0.004 degrees
+// - Octahedral8:   1 degree
+//
+// The bulk (array) versions use SSE2 / F16C / NEON where available (see MathSIMD.h) and give exactly the
+// same results as the single value versions (hardware conversions may set the quiet bit of a NaN half).
+
+#ifndef _PACKING_H_DEFINED_
+#define _PACKING_H_DEFINED_
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include <cstdint>
+
+
+/*-----------------------------------------------------------------------------------------
+    Half float
+-----------------------------------------------------------------------------------------*/
+
+uint16_t FloatToHalf(float f);
+float    HalfToFloat(uint16_t h);
+
+void FloatToHalf(const float* in, uint16_t* out, unsigned int count);
+void HalfToFloat(const uint16_t* in, float* out, unsigned int count);
+
+
+/*-----------------------------------------------------------------------------------------
+    Normalised integers
+-----------------------------------------------------------------------------------------*/
+
+int16_t FloatToSnorm16(float f);
+float   Snorm16ToFloat(int16_t s);
+
+int8_t  FloatToSnorm8(float f);
+float   Snorm8ToFloat(int8_t s);
+
+uint8_t FloatToUnorm8(float f);
+float   Unorm8ToFloat(uint8_t u);
+
+void FloatToSnorm16(const float* in, int16_t* out, unsigned int count);
+void Snorm16ToFloat(const int16_t* in, float* out, unsigned int count);
+
+void FloatToUnorm8(const float* in, uint8_t* out, unsigned int count);
+void Unorm8ToFloat(const uint8_t* in, float* out, unsigned int count);
+
+
+/*-----------------------------------------------------------------------------------------
+    Octahedral unit vectors
+-----------------------------------------------------------------------------------------*/
+
+// Unpacked octahedral coordinates, both -1 to 1. The vector need not be unit length but must not be zero
+CVector2 OctahedralEncode(const CVector3& v);
+
+// Unit vector from octahedral coordinates
+CVector3 OctahedralDecode(const CVector2& p);
+
+uint32_t PackOctahedral16(const CVector3& v);
+CVector3 UnpackOctahedral16(uint32_t packed);
+
+uint16_t PackOctahedral8(const CVector3& v);
+CVector3 UnpackOctahedral8(uint16_t packed);
+
+// Pack count unit vectors from strided arrays of structures (stride is the number of bytes from one x,y,z to
+// the next, see TransformBatch.h) - e.g. the normals in a vertex buffer
+void PackOctahedral16(const void* in, unsigned int inStride, uint32_t* out, unsigned int count);
+void PackOctahedral8 (const void* in, unsigned int inStride, uint16_t* out, unsigned int count);
+
+// Unpack count unit vectors to strided arrays of structures
+void UnpackOctahedral16(const uint32_t* in, void* out, unsigned int outStride, unsigned int count);
+void UnpackOctahedral8 (const uint16_t* in, void* out, unsigned int outStride, unsigned int count);
+
+
+#endif // _PACKING_H_DEFINED_
@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------
+// Batch transformation of many points / vectors by a single matrix
+//--------------------------------------------------------------------------------------
+
+#include "TransformBatch.h"
+#include "MathSIMD.h"
+#include <cstring>
+
+
+/*-----------------------------------------------------------------------------------------
+    Single point / vector
+-----------------------------------------------------------------------------------------*/
+
+// Transform a single point by a matrix (point has a w of 1 so translation is applied)
+CVector3 TransformPoint(const CVector3& p, const CMatrix4x4& m)
+{
+    return CVector3{ p.x * m.e00 + p.y * m.e10 + p.z * m.e20 + m.e30,
+                     p.x * m.e01 + p.y * m.e11 + p.z * m.e21 + m.e31,
+                     p.x * m.e02 + p.y * m.e12 + p.z * m.e22 + m.e32 };
+}
+
+// Transform a single vector by a matrix (vector has a w of 0 so translation is ignored)
+CVector3 TransformVector(const CVector3& v, const CMatrix4x4& m)
+{
+    return CVector3{ v.x * m.e00 + v.y * m.e10 + v.z * m.e20,
+                     v.x * m.e01 + v.y * m.e11 + v.z * m.e21,
+                     v.x * m.e02 + v.y * m.e12 + v.z * m.e22 };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Batch kernel
+-----------------------------------------------------------------------------------------*/
+
+// What to do with each x,y,z
+enum TransformMode { TRANSFORM_POINT, TRANSFORM_VECTOR, TRANSFORM_PROJECT };
+
+// Matrix with every element copied across all SIMD lanes - prepared once per batch
+struct MatrixSplat
+{
+    SimdFloat e[16];
+
+    MatrixSplat(const CMatrix4x4& m)
+    {
+        const float* pfElts = &m.e00;
+        for (int i = 0; i < 16; ++i)  e[i] = SimdSet1(pfElts[i]);
+    }
+};
+
+// Transform exactly SIMD_WIDTH elements from SoA arrays
+template <TransformMode Mode>
+static inline void TransformBlock(const MatrixSplat& m, const float* xIn, const float* yIn, const float* zIn,
+                                  float* xOut, float* yOut, float* zOut)
+{
+    SimdFloat x = SimdLoad(xIn);
+    SimdFloat y = SimdLoad(yIn);
+    SimdFloat z = SimdLoad(zIn);
+
+    SimdFloat tx = SimdAdd(SimdAdd(SimdMul(x, m.e[0]), SimdMul(y, m.e[4])), SimdMul(z, m.e[8]));
+    SimdFloat ty = SimdAdd(SimdAdd(SimdMul(x, m.e[1]), SimdMul(y, m.e[5])), SimdMul(z, m.e[9]));
+    SimdFloat tz = SimdAdd(SimdAdd(SimdMul(x, m.e[2]), SimdMul(y, m.e[6])), SimdMul(z, m.e[10]));
+    if (Mode != TRANSFORM_VECTOR)
+    {
+        tx = SimdAdd(tx, m.e[12]);
+        ty = SimdAdd(ty, m.e[13]);
+        tz = SimdAdd(tz, m.e[14]);
+    }
+    if (Mode == TRANSFORM_PROJECT)
+    {
+        SimdFloat tw = SimdAdd(SimdAdd(SimdAdd(SimdMul(x, m.e[3]), SimdMul(y, m.e[7])), SimdMul(z, m.e[11])), m.e[15]);
+        SimdFloat invW = SimdDiv(SimdSet1(1.0f), tw);
+        tx = SimdMul(tx, invW);
+        ty = SimdMul(ty, invW);
+        tz = SimdMul(tz, invW);
+    }
+
+    SimdStore(xOut, tx);
+    SimdStore(yOut, ty);
+    SimdStore(zOut, tz);
+}
+
+
+// SoA batch - whole blocks straight from the arrays, the remainder goes through a padded temporary block
+template <TransformMode Mode>
+static void TransformSoA(const CMatrix4x4& matrix, const float* xIn, const float* yIn, const float* zIn,
+                         float* xOut, float* yOut, float* zOut, unsigned int count)
+{
+    MatrixSplat m(matrix);
+
+    unsigned int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH)
+    {
+        TransformBlock<Mode>(m, xIn + i, yIn + i, zIn + i, xOut + i, yOut + i, zOut + i);
+    }
+
+    unsigned int remaining = count - i;
+    if (remaining > 0)
+    {
+        float x[SIMD_WIDTH] = {}, y[SIMD_WIDTH] = {}, z[SIMD_WIDTH] = {};
+        std::memcpy(x, xIn + i, remaining * sizeof(float));
+        std::memcpy(y, yIn + i, remaining * sizeof(float));
+        std::memcpy(z, zIn + i, remaining * sizeof(float));
+        TransformBlock<Mode>(m, x, y, z, x, y, z);
+        std::memcpy(xOut + i, x, remaining * sizeof(float));
+        std::memcpy(yOut + i, y, remaining * sizeof(float));
+        std::memcpy(zOut + i, z, remaining * sizeof(float));
+    }
+}
+
+
+// Strided AoS batch - gather up to SIMD_WIDTH elements into a temporary SoA block, transform, then scatter
+template <TransformMode Mode>
+static void TransformAoS(const CMatrix4x4& matrix, const void* in, unsigned int inStride,
+                         void* out, unsigned int outStride, unsigned int count)
+{
+    MatrixSplat m(matrix);
+
+    const unsigned char* src = static_cast<const unsigned char*>(in);
+    unsigned char*       dst = static_cast<unsigned char*>(out);
+
+    float x[SIMD_WIDTH] = {}, y[SIMD_WIDTH] = {}, z[SIMD_WIDTH] = {};
+    for (unsigned int i = 0; i < count; i += SIMD_WIDTH)
+    {
+        unsigned int blockSize = (count - i < SIMD_WIDTH) ? count - i : SIMD_WIDTH;
+
+        for (unsigned int lane = 0; lane < blockSize; ++lane)
+        {
+            float v[3];
+            std::memcpy(v, src, sizeof(v));
+            x[lane] = v[0];
+            y[lane] = v[1];
+            z[lane] = v[2];
+            src += inStride;
+        }
+
+        TransformBlock<Mode>(m, x, y, z, x, y, z);
+
+        for (unsigned int lane = 0; lane < blockSize; ++lane)
+        {
+            float v[3] = { x[lane], y[lane], z[lane] };
+            std::memcpy(dst, v, sizeof(v));
+            dst += outStride;
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Structure-of-arrays batches
+-----------------------------------------------------------------------------------------*/
+
+// Transform count points by the given matrix, translation is applied
+void TransformPoints(const CMatrix4x4& m, const float* xIn, const float* yIn, const float* zIn,
+                     float* xOut, float* yOut, float* zOut, unsigned int count)
+{
+    TransformSoA<TRANSFORM_POINT>(m, xIn, yIn, zIn, xOut, yOut, zOut, count);
+}
+
+// Transform count normals (or other vectors) by the given matrix, translation is ignored
+void TransformNormals(const CMatrix4x4& m, const float* xIn, const float* yIn, const float* zIn,
+                      float* xOut, float* yOut, float* zOut, unsigned int count)
+{
+    TransformSoA<TRANSFORM_VECTOR>(m, xIn, yIn, zIn, xOut, yOut, zOut, count);
+}
+
+// Transform count points by the given matrix then divide by w
+void TransformAndProject(const CMatrix4x4& m, const float* xIn, const float* yIn, const float* zIn,
+                         float* xOut, float* yOut, float* zOut, unsigned int count)
+{
+    TransformSoA<TRANSFORM_PROJECT>(m, xIn, yIn, zIn, xOut, yOut, zOut, count);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Strided array-of-structures batches
+-----------------------------------------------------------------------------------------*/
+
+void TransformPoints(const CMatrix4x4& m, const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count)
+{
+    TransformAoS<TRANSFORM_POINT>(m, in, inStride, out, outStride, count);
+}
+
+void TransformNormals(const CMatrix4x4& m, const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count)
+{
+    TransformAoS<TRANSFORM_VECTOR>(m, in, inStride, out, outStride, count);
+}
+
+void TransformAndProject(const CMatrix4x4& m, const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count)
+{
+    TransformAoS<TRANSFORM_PROJECT>(m, in, inStride, out, outStride, count);
+}
@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------------
+// Batch transformation of many points / vectors by a single matrix
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Two data layouts are supported:
+// - Structure-of-arrays (SoA): separate arrays of x, y and z values. Fastest, SIMD_WIDTH points are
+//   transformed at a time straight from the arrays (see MathSIMD.h)
+// - Strided array-of-structures (AoS): pointer to the first x,y,z in a block of bytes and the distance
+//   in bytes from one x,y,z to the next. This matches the vertex data built in Mesh.cpp, e.g. pass
+//   vertices + normalOffset with a stride of mVertexSize to work on the normals in a vertex buffer
+//
+// Matrices are used in the same way as the rest of the app (and the shaders), i.e. points are row
+// vectors that are multiplied on the left of the matrix. Input and output arrays can be the same.
+
+#ifndef _TRANSFORM_BATCH_H_DEFINED_
+#define _TRANSFORM_BATCH_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Single point / vector
+-----------------------------------------------------------------------------------------*/
+
+// Transform a single point by a matrix (point has a w of 1 so translation is applied)
+CVector3 TransformPoint(const CVector3& p, const CMatrix4x4& m);
+
+// Transform a single vector by a matrix (vector has a w of 0 so translation is ignored)
+CVector3 TransformVector(const CVector3& v, const CMatrix4x4& m);
+
+
+/*-----------------------------------------------------------------------------------------
+    Structure-of-arrays batches
+-----------------------------------------------------------------------------------------*/
+
+// Transform count points by the given matrix, translation is applied
+void TransformPoints(const CMatrix4x4& m, const float* xIn, const float* yIn, const float* zIn,
+                     float* xOut, float* yOut, float* zOut, unsigned int count);
+
+// Transform count normals (or other vectors) by the given matrix, translation is ignored. Normals are not
+// renormalised. For correct normals under non-uniform scaling pass the inverse transpose of the matrix
+void TransformNormals(const CMatrix4x4& m, const float* xIn, const float* yIn, const float* zIn,
+                      float* xOut, float* yOut, float* zOut, unsigned int count);
+
+// Transform count points by the given matrix (e.g. a view-projection matrix) then divide by w. Outputs
+// are in normalised device coordinates if the matrix includes a projection
+void TransformAndProject(const CMatrix4x4& m, const float* xIn, const float* yIn, const float* zIn,
+                         float* xOut, float* yOut, float* zOut, unsigned int count);
+
+
+/*-----------------------------------------------------------------------------------------
+    Strided array-of-structures batches
+-----------------------------------------------------------------------------------------*/
+// Each input / output element is three floats, the stride is the number of bytes from the start of
+// one element to the start of the next (12 for a plain array of CVector3)
+
+void TransformPoints    (const CMatrix4x4& m, const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count);
+void TransformNormals   (const CMatrix4x4& m, const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count);
+void TransformAndProject(const CMatrix4x4& m, const void* in, unsigned int inStride, void* out, unsigned int outStride, unsigned int count);
+
+
+#endif // _TRANSFORM_BATCH_H_DEFINED_
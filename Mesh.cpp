@@ -1,267 +1,514 @@
 //--------------------------------------------------------------------------------------
 // Class encapsulating a mesh
 //--------------------------------------------------------------------------------------
-// The mesh class splits the mesh into sub-meshes that only use one texture each.
-// ** THIS VERSION WILL ONLY KEEP THE FIRST SUB-MESH OTHER PARTS WILL BE MISSING **
-// ** DO NOT USE THIS VERSION FOR PROJECTS **
-// The class also doesn't load textures, filters or shaders as the outer code is
-// expected to select these things. A later lab will introduce a more robust loader.
+// The mesh class loads every sub-mesh (part) of the file into one shared vertex buffer and one shared index
+// buffer. Each sub-mesh is a range of the index buffer, rendered with its own draw call but no buffer changes.
+// Streamed meshes too large for one Direct3D buffer are divided between several sets of buffers (see Mesh.h).
+// The class doesn't load textures, filters or shaders as the outer code is expected to select these things,
+// so all sub-meshes are drawn with the same settings.
+//
+// The first time a mesh file is loaded the imported result is saved as a cooked mesh file next to it (see
+// CookedMesh.h). Later loads memory map the cooked file and create the buffers straight from it without
+// importing anything, as long as the source file and import settings are unchanged. Larger meshes can have
+// their vertices and indices compressed in the cooked file (MeshCodec.h), decoded when it is loaded. Very large
+// files are streamed instead (see Mesh.h), with their own cooked file read a chunk at a time.
 
 #include "Mesh.h"
 #include "Shader.h" // Needed for helper function CreateSignatureForVertexLayout
-#include "CVector2.h" 
-#include "CVector3.h" 
+#include "AssimpImport.h"
+#include "CookedMesh.h"
+#include "MeshImport.h"
+#include "MeshStreaming.h"
+#include "StreamedMesh.h"
+#include "MappedFile.h"
+#include "Hash.h"
 
-#include <assimp/Importer.hpp>
-#include <assimp/DefaultLogger.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
 
-#include <memory>
 
+// Level of detail selection and statistics, see Mesh.h
+MeshCamera   gMeshCamera;
+unsigned int gTrianglesDrawn = 0;
 
-// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
-// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
-// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
+// Streaming import of very large files, see Mesh.h
+size_t gMeshStreamingThreshold = 512 * 1024 * 1024;
+size_t gMeshStreamingBudget    = 256 * 1024 * 1024;
+
+// Compression of cooked mesh files, see Mesh.h
+size_t gMeshCompressionThreshold = 0;
+
+
+// Vertex formats are passed straight to DirectX
+static_assert(static_cast<DXGI_FORMAT>(VertexFormat::Float3)    == DXGI_FORMAT_R32G32B32_FLOAT    &&
+              static_cast<DXGI_FORMAT>(VertexFormat::UNorm16x4) == DXGI_FORMAT_R16G16B16A16_UNORM &&
+              static_cast<DXGI_FORMAT>(VertexFormat::Float2)    == DXGI_FORMAT_R32G32_FLOAT       &&
+              static_cast<DXGI_FORMAT>(VertexFormat::Half2)     == DXGI_FORMAT_R16G16_FLOAT       &&
+              static_cast<DXGI_FORMAT>(VertexFormat::SNorm16x2) == DXGI_FORMAT_R16G16_SNORM, "VertexFormat must match DXGI_FORMAT");
+
+
+namespace
 {
-    Assimp::Importer importer;
-
-    // Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
-    // and "Peek Definition" to see documention above each constant
-    unsigned int assimpFlags = aiProcess_MakeLeftHanded |
-                               aiProcess_GenSmoothNormals |
-                               aiProcess_FixInfacingNormals |
-                               aiProcess_GenUVCoords | 
-                               aiProcess_TransformUVCoords |
-                               aiProcess_FlipUVs |
-                               aiProcess_FlipWindingOrder |
-                               aiProcess_Triangulate |
-                               aiProcess_PreTransformVertices |
-                               aiProcess_JoinIdenticalVertices |
-                               aiProcess_ImproveCacheLocality |
-                               aiProcess_SortByPType |
-                               aiProcess_FindInvalidData | 
-                               aiProcess_OptimizeMeshes |
-                               aiProcess_FindInstances |
-                               aiProcess_FindDegenerates |
-                               aiProcess_RemoveRedundantMaterials |
-                               aiProcess_Debone |
-                               aiProcess_RemoveComponent;
-
-    // Flags to specify what mesh data to ignore
-    int removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS | 
-                           aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_MATERIALS;
-
-    // Add / remove tangents as required by user
-    if (requireTangents)
-    {
-        assimpFlags |= aiProcess_CalcTangentSpace;
-    }
-    else
+    // Largest buffer Direct3D 11 allows on any GPU. GPUs with less than 8GB of memory allow a quarter of their
+    // memory, but always at least STREAMED_BUFFER_BYTES
+    const uint64_t MAX_BUFFER_BYTES = static_cast<uint64_t>(D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_C_TERM) * 1024 * 1024;
+
+    // Largest buffer in each set of a streamed mesh's buffers, one every GPU allows
+    const uint64_t STREAMED_BUFFER_BYTES = static_cast<uint64_t>(D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM) * 1024 * 1024;
+
+    // Copy data into a range of bytes of a buffer with default usage
+    void UpdateBufferRange(ID3D11Buffer* buffer, size_t offset, const void* data, size_t size)
     {
-        removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
+        if (size == 0)  return;
+        D3D11_BOX box = { static_cast<UINT>(offset), 0, 0, static_cast<UINT>(offset + size), 1, 1 };
+        gD3DContext->UpdateSubresource(buffer, 0, &box, data, 0, 0);
     }
+}
 
-    // Other miscellaneous settings
-    importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
-    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
-    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
-    importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
-  
-    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
 
-    // Import mesh with assimp given above requirements - log output
-    Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
-    const aiScene* scene = importer.ReadFile(fileName, assimpFlags);
-    Assimp::DefaultLogger::kill();
-    if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
-    if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+/*-----------------------------------------------------------------------------------------
+    Construction
+-----------------------------------------------------------------------------------------*/
 
+// Pass the name of the mesh file to load. Reads .x files directly and uses assimp (http://www.assimp.org/) to
+// support many other file types. Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+// and choose the vertex formats (VertexProfile::Compact for half the vertex memory). Pass rayQueries to be
+// able to use Intersect.
+// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/, VertexProfile profile /*= VertexProfile::Full*/,
+           bool rayQueries /*= false*/)
+{
+    MappedFile sourceFile;
+    if (!sourceFile.Open(fileName))  throw std::runtime_error("Error loading mesh (" + fileName + "). Cannot open file");
+    Load(fileName, sourceFile, HashMappedFile(sourceFile), requireTangents, profile, rayQueries);
+}
 
-    //-----------------------------------
+// As above for a source file that has already been mapped and hashed with HashMappedFile (see MeshRegistry.h)
+Mesh::Mesh(const std::string& fileName, const MappedFile& sourceFile, uint64_t sourceHash,
+           bool requireTangents /*= false*/, VertexProfile profile /*= VertexProfile::Full*/, bool rayQueries /*= false*/)
+{
+    Load(fileName, sourceFile, sourceHash, requireTangents, profile, rayQueries);
+}
 
-    // Only importing first submesh - significant limitation - do not use this importer for your own projects
-    aiMesh* assimpMesh = scene->mMeshes[0];
-    std::string subMeshName = assimpMesh->mName.C_Str();
 
-    
-    //-----------------------------------
+// Import or load the cooked mesh and create the GPU buffers, shared by the constructors
+void Mesh::Load(const std::string& fileName, const MappedFile& sourceFile, uint64_t sourceHash,
+                bool requireTangents, VertexProfile profile, bool rayQueries)
+{
+    // Very large .x files use the streaming import
+    std::string extension = fileName.size() > 2 ? fileName.substr(fileName.size() - 2) : "";
+    bool streamed = (extension == ".x" || extension == ".X") && gMeshStreamingThreshold > 0 && sourceFile.Size() >= gMeshStreamingThreshold;
+    if (streamed && rayQueries)  throw std::runtime_error("Ray queries are not available for streamed mesh " + fileName);
+
+    // The cooked mesh key is a hash of the source file, the import settings, the vertex profile and the
+    // cooked format version
+    uint64_t key = AssimpImportKey(requireTangents, sourceHash);
+    key = HashValue(profile, key);
+    key = HashValue(streamed ? STREAMED_MESH_VERSION : COOKED_MESH_VERSION, key);
+
+    // Use the cooked mesh if it is up to date, otherwise import the mesh and cook it for next time. It is not
+    // an error if the cooked file can't be written (e.g. a read-only folder), the mesh is just imported again.
+    // A streamed mesh is always imported into its cooked file, then read from there. Other meshes are cooked
+    // uncompressed so they can be used in place, unless their GPU buffers reach gMeshCompressionThreshold
+    std::string cookedFileName = fileName + (requireTangents ? ".tangents" : "") +
+                                            (profile == VertexProfile::Compact ? ".compact" : "") +
+                                            (streamed ? ".streamed.cooked" : ".cooked");
+    CookedMesh   cookedMesh;
+    StreamedMesh streamedMesh;
+    PackedMesh   packedMesh;
+    MeshDataView mesh;
+    if (streamed)
+    {
+        if (!streamedMesh.Open(cookedFileName, key))
+        {
+            StreamImportMesh(fileName, sourceFile, cookedFileName, key, requireTangents, profile, gMeshStreamingBudget);
+            if (!streamedMesh.Open(cookedFileName, key))  throw std::runtime_error("Error loading streamed mesh (" + cookedFileName + ")");
+        }
+        mesh = streamedMesh.View(); // Layout and ranges only, the data is read below
+    }
+    else if (cookedMesh.Open(cookedFileName, key))
+    {
+        mesh = cookedMesh.View();
+    }
+    else
+    {
+        packedMesh = ImportMesh(fileName, sourceFile, requireTangents, profile);
+        mesh = packedMesh.View();
+        bool compress = gMeshCompressionThreshold > 0 && MeshGPUBytes(mesh) >= gMeshCompressionThreshold;
+        WriteCookedMesh(cookedFileName, key, mesh, compress);
+    }
 
-    // Check for presence of position and normal data. Tangents and UVs are optional.
-    std::vector<D3D11_INPUT_ELEMENT_DESC> vertexElements;
-    unsigned int offset = 0;
-    
-    if (!assimpMesh->HasPositions())  throw std::runtime_error("No position data for sub-mesh " + subMeshName + " in " + fileName);
-    unsigned int positionOffset = offset;
-    vertexElements.push_back( { "Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, positionOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-    offset += 12;
-
-    if (!assimpMesh->HasNormals())  throw std::runtime_error("No normal data for sub-mesh " + subMeshName + " in " + fileName);
-    unsigned int normalOffset = offset;
-    vertexElements.push_back( { "Normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, normalOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-    offset += 12;
-
-    unsigned int tangentOffset = offset;
-    if (requireTangents)
+    mVertexSize  = mesh.vertexSize;
+    mNumVertices = mesh.numVertices;
+    mNumIndices  = mesh.numIndices;
+    mIndexFormat = (mesh.indexSize == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    mSubMeshes.assign(mesh.subMeshes, mesh.subMeshes + mesh.numSubMeshes);
+    mLODs.assign(mesh.lods, mesh.lods + mesh.numLODs);
+    if (mLODs.empty())
     {
-        if (!assimpMesh->HasTangentsAndBitangents())  throw std::runtime_error("No tangent data for sub-mesh " + subMeshName + " in " + fileName);
-        vertexElements.push_back( { "Tangent", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, tangentOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-        offset += 12;
+        // No levels of detail, all the sub-meshes are the full detail mesh
+        MeshLOD lod = { 0, mesh.numSubMeshes, 0, mNumIndices / 3 };
+        mLODs.push_back(lod);
     }
-    
-    unsigned int uvOffset = offset;
-    if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+    mBoundingBox    = mesh.boundingBox;
+    mBoundingSphere = mesh.boundingSphere;
+    mMeshletCuller.Init(mesh);
+    if (rayQueries && !mBVH.Build(mesh))  throw std::runtime_error("No triangles for ray queries in " + fileName);
+
+    // Divide the mesh between sets of buffers, see Mesh.h. A streamed mesh has as many as keep each buffer within
+    // STREAMED_BUFFER_BYTES, other meshes a single set of the whole mesh
+    StreamedBufferPlan bufferPlan;
+    if (streamed)
+    {
+        bufferPlan = streamedMesh.PlanBuffers(STREAMED_BUFFER_BYTES);
+        mSubMeshes = bufferPlan.subMeshes;
+        mSubMeshBufferSets.assign(bufferPlan.subMeshSets.begin(), bufferPlan.subMeshSets.end());
+    }
+    else
     {
-        if (assimpMesh->mNumUVComponents[0] != 2)  throw std::runtime_error("Unsupported texture coordinates in " + subMeshName + " in " + fileName);
-        vertexElements.push_back( { "UV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, uvOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-        offset += 8;
+        bufferPlan.sets.push_back({ 0, mNumVertices, 0, mesh.numDepthVertices, mNumIndices });
+        mSubMeshBufferSets.assign(mSubMeshes.size(), 0);
     }
+    const std::vector<StreamedBufferSet>& ranges = bufferPlan.sets;
+
+    // Depth-only draws for each level of detail. The depth indices have no base vertex, so neighbouring
+    // sub-meshes in the same set are drawn together
+    if (mesh.numDepthVertices > 0)
+    {
+        for (const MeshLOD& lod : mLODs)
+        {
+            mFirstDepthDraw.push_back(static_cast<unsigned int>(mDepthDraws.size()));
+            for (unsigned int i = lod.firstSubMesh; i < lod.firstSubMesh + lod.numSubMeshes; ++i)
+            {
+                const SubMesh& subMesh = mSubMeshes[i];
+                unsigned int   set     = mSubMeshBufferSets[i];
+                if (mDepthDraws.size() > mFirstDepthDraw.back() && mDepthDrawBufferSets.back() == set &&
+                    mDepthDraws.back().startIndex + mDepthDraws.back().numIndices == subMesh.startIndex)
+                {
+                    mDepthDraws.back().numIndices += subMesh.numIndices;
+                }
+                else
+                {
+                    SubMesh draw = { subMesh.startIndex, subMesh.numIndices, 0, ranges[set].numDepthVertices };
+                    mDepthDraws.push_back(draw);
+                    mDepthDrawBufferSets.push_back(set);
+                }
+            }
+        }
+        mFirstDepthDraw.push_back(static_cast<unsigned int>(mDepthDraws.size()));
+    }
+
 
-    mVertexSize = offset;
+    //-----------------------------------
 
+    // Vertex layout shared by all sub-meshes
+    std::vector<D3D11_INPUT_ELEMENT_DESC> vertexElements;
+    for (unsigned int i = 0; i < mesh.numElements; ++i)
+    {
+        const VertexElement& element = mesh.elements[i];
+        vertexElements.push_back( { element.semantic, element.semanticIndex, static_cast<DXGI_FORMAT>(element.format),
+                                    0, element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
+    }
 
     // Create a "vertex layout" to describe to DirectX what is data in each vertex of this mesh
     auto shaderSignature = CreateSignatureForVertexLayout(vertexElements.data(), static_cast<int>(vertexElements.size()));
+    if (shaderSignature == nullptr)  throw std::runtime_error("Unsupported vertex layout in " + fileName);
     HRESULT hr = gD3DDevice->CreateInputLayout(vertexElements.data(), static_cast<UINT>(vertexElements.size()),
                                                shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
                                                &mVertexLayout);
-    if (shaderSignature)  shaderSignature->Release();
+    shaderSignature->Release();
     if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for " + fileName);
 
+    // The depth stream's layout is the position element alone
+    if (mesh.numDepthVertices > 0)
+    {
+        const VertexElement* position = FindElement(mesh, "Position");
+        D3D11_INPUT_ELEMENT_DESC depthElement = { position->semantic, position->semanticIndex, static_cast<DXGI_FORMAT>(position->format),
+                                                  0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+        shaderSignature = CreateSignatureForVertexLayout(&depthElement, 1);
+        if (shaderSignature == nullptr)  throw std::runtime_error("Unsupported position format in " + fileName);
+        hr = gD3DDevice->CreateInputLayout(&depthElement, 1, shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
+                                           &mDepthVertexLayout);
+        shaderSignature->Release();
+        if (FAILED(hr))  throw std::runtime_error("Failure creating depth input layout for " + fileName);
+    }
 
 
     //-----------------------------------
 
-    // Create CPU-side buffers to hold current mesh data - exact content is flexible so can't use a structure for a vertex - so just a block of bytes
-    // Note: for large arrays a unique_ptr is better than a vector because vectors default-initialise all the values which is a waste of time.
-    mNumVertices = assimpMesh->mNumVertices;
-    mNumIndices  = assimpMesh->mNumFaces * 3;
-    auto vertices = std::make_unique<unsigned char[]>(mNumVertices * mVertexSize);
-    auto indices  = std::make_unique<unsigned char[]>(mNumIndices * 4); // Using 32 bit indexes (4 bytes) for each indeex
-
-
-    //-----------------------------------
+    D3D11_BUFFER_DESC bufferDesc;
+    D3D11_SUBRESOURCE_DATA initData;
 
-    // Copy mesh data from assimp to our CPU-side vertex buffer
+    // Streamed meshes create the buffers empty and fill them below
+    D3D11_SUBRESOURCE_DATA* init = streamed ? nullptr : &initData;
 
-    CVector3* assimpPosition = reinterpret_cast<CVector3*>(assimpMesh->mVertices);
-    unsigned char* position = vertices.get() + positionOffset;
-    unsigned char* positionEnd = position + mNumVertices * mVertexSize;
-    while (position != positionEnd)
+    if (mesh.numDepthVertices > 0)
     {
-        *(CVector3*)position = *assimpPosition;
-        position += mVertexSize;
-        ++assimpPosition;
+        mDepthVertexSize = mesh.depthVertexSize;
+        mDepthIndexFormat = (mesh.depthIndexSize == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
     }
 
-    CVector3* assimpNormal = reinterpret_cast<CVector3*>(assimpMesh->mNormals);
-    unsigned char* normal = vertices.get() + normalOffset;
-    unsigned char* normalEnd = normal + mNumVertices * mVertexSize;
-    while (normal != normalEnd)
+    mBufferSets.resize(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
     {
-        *(CVector3*)normal = *assimpNormal;
-        normal += mVertexSize;
-        ++assimpNormal;
-    }
+        const StreamedBufferSet& range   = ranges[i];
+        BufferSet&               buffers = mBufferSets[i];
+
+        // Direct3D 11 buffers are limited in size, which a mesh imported without streaming can still pass
+        uint64_t vertexBytes      = static_cast<uint64_t>(range.numVertices)      * mVertexSize;
+        uint64_t indexBytes       = static_cast<uint64_t>(range.numIndices)       * mesh.indexSize;
+        uint64_t depthVertexBytes = static_cast<uint64_t>(range.numDepthVertices) * mDepthVertexSize;
+        uint64_t depthIndexBytes  = static_cast<uint64_t>(range.numIndices)       * mesh.depthIndexSize;
+        if (vertexBytes > MAX_BUFFER_BYTES || indexBytes > MAX_BUFFER_BYTES || depthVertexBytes > MAX_BUFFER_BYTES ||
+            (mDepthVertexSize > 0 && depthIndexBytes > MAX_BUFFER_BYTES))
+        {
+            throw std::runtime_error("Mesh " + fileName + " is too large for a Direct3D 11 buffer");
+        }
 
-    if (requireTangents)
-    {
-      CVector3* assimpTangent = reinterpret_cast<CVector3*>(assimpMesh->mTangents);
-      unsigned char* tangent =  vertices.get() + tangentOffset;
-      unsigned char* tangentEnd = tangent + mNumVertices * mVertexSize;
-      while (tangent != tangentEnd)
-      {
-        *(CVector3*)tangent = *assimpTangent;
-        tangent += mVertexSize;
-        ++assimpTangent;
-      }
+        // Create GPU-side vertex buffer and copy the vertices into it (straight from the mapped file if cooked)
+        bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Indicate it is a vertex buffer
+        bufferDesc.Usage = D3D11_USAGE_DEFAULT;          // Default usage for this buffer - we'll see other usages later
+        bufferDesc.ByteWidth = static_cast<UINT>(vertexBytes); // Size of the buffer in bytes
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        initData.pSysMem = mesh.vertices; // Fill the new vertex buffer with the mesh data
+
+        hr = gD3DDevice->CreateBuffer(&bufferDesc, init, &buffers.vertexBuffer);
+        if (FAILED(hr))  throw std::runtime_error("Failure creating vertex buffer for " + fileName);
+
+
+        // Create GPU-side index buffer and copy the indices into it
+        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; // Indicate it is an index buffer
+        bufferDesc.Usage = D3D11_USAGE_DEFAULT;         // Default usage for this buffer - we'll see other usages later
+        bufferDesc.ByteWidth = static_cast<UINT>(indexBytes); // Size of the buffer in bytes
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        initData.pSysMem = mesh.indices; // Fill the new index buffer with the mesh data
+
+        hr = gD3DDevice->CreateBuffer(&bufferDesc, init, &buffers.indexBuffer);
+        if (FAILED(hr))  throw std::runtime_error("Failure creating index buffer for " + fileName);
+
+        // Position-only vertex buffer and its index buffer, for depth-only passes
+        if (mDepthVertexSize > 0)
+        {
+            bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+            bufferDesc.ByteWidth = static_cast<UINT>(depthVertexBytes);
+            bufferDesc.CPUAccessFlags = 0;
+            bufferDesc.MiscFlags = 0;
+            initData.pSysMem = mesh.depthVertices;
+
+            hr = gD3DDevice->CreateBuffer(&bufferDesc, init, &buffers.depthVertexBuffer);
+            if (FAILED(hr))  throw std::runtime_error("Failure creating depth vertex buffer for " + fileName);
+
+            bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+            bufferDesc.ByteWidth = static_cast<UINT>(depthIndexBytes);
+            initData.pSysMem = mesh.depthIndices;
+
+            hr = gD3DDevice->CreateBuffer(&bufferDesc, init, &buffers.depthIndexBuffer);
+            if (FAILED(hr))  throw std::runtime_error("Failure creating depth index buffer for " + fileName);
+        }
     }
 
-    if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+    // Fill a streamed mesh's buffers one chunk at a time: its vertices and depth positions go in one range of
+    // its set's vertex buffers, its indices in a range of the set's index buffers for each sub-mesh it has. The
+    // depth indices are moved down to index the set's depth positions
+    if (streamed)
     {
-        aiVector3D* assimpUV = assimpMesh->mTextureCoords[0];
-        unsigned char* uv = vertices.get() + uvOffset;
-        unsigned char* uvEnd = uv + mNumVertices * mVertexSize;
-        while (uv != uvEnd)
+        StreamedChunk chunk;
+        for (unsigned int i = 0; i < streamedMesh.NumChunks(); ++i)
         {
-            *(CVector2*)uv = CVector2(assimpUV->x, assimpUV->y);
-            uv += mVertexSize;
-            ++assimpUV;
+            if (!streamedMesh.ReadChunk(i, chunk))  throw std::runtime_error("Error reading streamed mesh (" + cookedFileName + ")");
+
+            const StreamedBufferSet& range   = ranges[bufferPlan.chunkSets[i]];
+            const BufferSet&         buffers = mBufferSets[bufferPlan.chunkSets[i]];
+            for (uint32_t& index : chunk.depthIndices)  index -= range.firstDepthVertex;
+
+            UpdateBufferRange(buffers.vertexBuffer, static_cast<size_t>(chunk.firstVertex - range.firstVertex) * mVertexSize,
+                              chunk.vertices.data(), chunk.vertices.size());
+            UpdateBufferRange(buffers.depthVertexBuffer, static_cast<size_t>(chunk.firstDepthVertex - range.firstDepthVertex) * mDepthVertexSize,
+                              chunk.depthVertices.data(), chunk.depthVertices.size());
+            for (const StreamedSlice& slice : chunk.slices)
+            {
+                const SubMesh& subMesh = mSubMeshes[slice.subMesh];
+                UpdateBufferRange(buffers.indexBuffer, static_cast<size_t>(subMesh.startIndex) * mesh.indexSize,
+                                  chunk.indices.data() + static_cast<size_t>(slice.sourceIndex) * mesh.indexSize,
+                                  static_cast<size_t>(slice.numIndices) * mesh.indexSize);
+                UpdateBufferRange(buffers.depthIndexBuffer, static_cast<size_t>(subMesh.startIndex) * sizeof(uint32_t),
+                                  chunk.depthIndices.data() + slice.sourceIndex, slice.numIndices * sizeof(uint32_t));
+            }
         }
     }
 
-
-    //-----------------------------------
-
-    // Copy face data from assimp to our CPU-side index buffer
-    if (!assimpMesh->HasFaces())  throw std::runtime_error("No face data in " + subMeshName + " in " + fileName);
-
-    DWORD* index = reinterpret_cast<DWORD*>(indices.get());
-    for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
+    // Index buffer for the visible meshlets, rewritten by the CPU each time the mesh is drawn
+    if (!mMeshletCuller.Empty())
     {
-        *index++ = assimpMesh->mFaces[face].mIndices[0];
-        *index++ = assimpMesh->mFaces[face].mIndices[1];
-        *index++ = assimpMesh->mFaces[face].mIndices[2];
+        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.ByteWidth = mMeshletCuller.MaxIndices() * mMeshletCuller.IndexSize();
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = 0;
+
+        hr = gD3DDevice->CreateBuffer(&bufferDesc, nullptr, &mCulledIndexBuffer);
+        if (FAILED(hr))  throw std::runtime_error("Failure creating meshlet index buffer for " + fileName);
     }
 
 
-    //-----------------------------------
-
-    D3D11_BUFFER_DESC bufferDesc;
-    D3D11_SUBRESOURCE_DATA initData;
+    // Create the constant buffer holding the vertex decoding constants, which never change
+    PerMeshConstants meshConstants;
+    PositionDecoding(mesh, meshConstants.positionScale, meshConstants.positionOffset);
+    const VertexElement* normal  = FindElement(mesh, "Normal");
+    const VertexElement* tangent = FindElement(mesh, "Tangent");
+    meshConstants.octahedralNormals  = (normal  != nullptr && normal ->format == VertexFormat::SNorm16x2) ? 1 : 0;
+    meshConstants.octahedralTangents = (tangent != nullptr && tangent->format == VertexFormat::SNorm16x2) ? 1 : 0;
 
-    // Create GPU-side vertex buffer and copy the vertices imported by assimp into it
-    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Indicate it is a vertex buffer
-    bufferDesc.Usage = D3D11_USAGE_DEFAULT;          // Default usage for this buffer - we'll see other usages later
-    bufferDesc.ByteWidth = mNumVertices * mVertexSize; // Size of the buffer in bytes
+    bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    bufferDesc.ByteWidth = sizeof(meshConstants); // Already a multiple of 16 bytes
     bufferDesc.CPUAccessFlags = 0;
     bufferDesc.MiscFlags = 0;
-    initData.pSysMem = vertices.get(); // Fill the new vertex buffer with data loaded by assimp
-    
-    hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mVertexBuffer);
-    if (FAILED(hr))  throw std::runtime_error("Failure creating vertex buffer for " + fileName);
+    initData.pSysMem = &meshConstants;
 
+    hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mConstantBuffer);
+    if (FAILED(hr))  throw std::runtime_error("Failure creating constant buffer for " + fileName);
 
-    // Create GPU-side index buffer and copy the vertices imported by assimp into it
-    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; // Indicate it is an index buffer
-    bufferDesc.Usage = D3D11_USAGE_DEFAULT;         // Default usage for this buffer - we'll see other usages later
-    bufferDesc.ByteWidth = mNumIndices * sizeof(DWORD); // Size of the buffer in bytes
-    bufferDesc.CPUAccessFlags = 0;
-    bufferDesc.MiscFlags = 0;
-    initData.pSysMem = indices.get(); // Fill the new index buffer with data loaded by assimp
-
-    hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mIndexBuffer);
-    if (FAILED(hr))  throw std::runtime_error("Failure creating index buffer for " + fileName);
+    mGPUBytes = MeshGPUBytes(mesh) + sizeof(meshConstants);
 }
 
 
 Mesh::~Mesh()
 {
-    if (mIndexBuffer)   mIndexBuffer ->Release();
-    if (mVertexBuffer)  mVertexBuffer->Release();
-    if (mVertexLayout)  mVertexLayout->Release();
+    if (mCulledIndexBuffer)  mCulledIndexBuffer->Release();
+    if (mDepthVertexLayout)  mDepthVertexLayout->Release();
+    if (mConstantBuffer)     mConstantBuffer   ->Release();
+    for (BufferSet& buffers : mBufferSets)
+    {
+        if (buffers.depthIndexBuffer)   buffers.depthIndexBuffer ->Release();
+        if (buffers.depthVertexBuffer)  buffers.depthVertexBuffer->Release();
+        if (buffers.indexBuffer)        buffers.indexBuffer      ->Release();
+        if (buffers.vertexBuffer)       buffers.vertexBuffer     ->Release();
+    }
+    if (mVertexLayout)       mVertexLayout     ->Release();
 }
 
 
 // The render function assumes shaders, matrices, textures, samplers etc. have been set up already.
 // It simply draws this mesh with whatever settings the GPU is currently using.
-void Mesh::Render()
+void Mesh::Render(unsigned int lod /*= 0*/, const CMatrix3x4* worldMatrix /*= nullptr*/)
 {
-    // Set vertex buffer as next data source for GPU
+    // Set vertex buffer as next data source for GPU (the first set's, see Mesh.h)
     UINT stride = mVertexSize;
     UINT offset = 0;
-    gD3DContext->IASetVertexBuffers(0, 1, &mVertexBuffer, &stride, &offset);
+    gD3DContext->IASetVertexBuffers(0, 1, &mBufferSets[0].vertexBuffer, &stride, &offset);
 
     // Indicate the layout of vertex buffer
     gD3DContext->IASetInputLayout(mVertexLayout);
 
-    // Set index buffer as next data source for GPU, indicate it uses 32-bit integers
-    gD3DContext->IASetIndexBuffer(mIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+    // Set index buffer as next data source for GPU, indicate if it uses 16 or 32-bit integers
+    gD3DContext->IASetIndexBuffer(mBufferSets[0].indexBuffer, mIndexFormat, 0);
 
     // Using triangle lists only in this class
     gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    // Render mesh
-    gD3DContext->DrawIndexed(mNumIndices, 0, 0);
+    // Constants for the vertex shader to decode this mesh's vertices
+    gD3DContext->VSSetConstantBuffers(2, 1, &mConstantBuffer); // First parameter must match constant buffer number in the shader
+
+    // Full detail meshes with meshlets draw only the visible meshlets, culled in model space. If every meshlet
+    // is visible the full index buffer is drawn as usual. The buffer is rewritten with discard, so the GPU
+    // can still be reading the previous contents. If it can't be mapped the full index buffer is drawn instead,
+    // drawing more than is visible rather than nothing
+    if (lod == 0 && worldMatrix != nullptr && gMeshCamera.cullMeshlets && !mMeshletCuller.Empty())
+    {
+        CFrustum frustum = FrustumFromMatrix(*worldMatrix * gMeshCamera.viewProjectionMatrix);
+        CVector3 cameraPosition = TransformPoint(gMeshCamera.position, InverseAffine(*worldMatrix));
+        unsigned int numTriangles = mMeshletCuller.Cull(frustum, cameraPosition, gMeshCamera.faceCulling);
+        if (mMeshletCuller.NumVisibleMeshlets() < mMeshletCuller.NumMeshlets())
+        {
+            if (numTriangles == 0)  return; // Nothing visible
+
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            if (SUCCEEDED(gD3DContext->Map(mCulledIndexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+            {
+                std::memcpy(mapped.pData, mMeshletCuller.Indices(), mMeshletCuller.NumIndices() * mMeshletCuller.IndexSize());
+                gD3DContext->Unmap(mCulledIndexBuffer, 0);
+
+                gD3DContext->IASetIndexBuffer(mCulledIndexBuffer, mIndexFormat, 0);
+                for (const SubMesh& subMesh : mMeshletCuller.SubMeshes())
+                {
+                    if (subMesh.numIndices > 0)  gD3DContext->DrawIndexed(subMesh.numIndices, subMesh.startIndex, static_cast<INT>(subMesh.baseVertex));
+                }
+                gTrianglesDrawn += numTriangles;
+                return;
+            }
+        }
+    }
+
+    // Render each sub-mesh of the level of detail from its range of the shared buffers, changing buffers when
+    // the sub-mesh is in another set
+    const MeshLOD& meshLOD = mLODs[std::min(lod, NumLODs() - 1)];
+    unsigned int set = 0;
+    for (unsigned int i = meshLOD.firstSubMesh; i < meshLOD.firstSubMesh + meshLOD.numSubMeshes; ++i)
+    {
+        if (mSubMeshBufferSets[i] != set)
+        {
+            set = mSubMeshBufferSets[i];
+            gD3DContext->IASetVertexBuffers(0, 1, &mBufferSets[set].vertexBuffer, &stride, &offset);
+            gD3DContext->IASetIndexBuffer(mBufferSets[set].indexBuffer, mIndexFormat, 0);
+        }
+        const SubMesh& subMesh = mSubMeshes[i];
+        gD3DContext->DrawIndexed(subMesh.numIndices, subMesh.startIndex, static_cast<INT>(subMesh.baseVertex));
+    }
+    gTrianglesDrawn += meshLOD.numTriangles;
+}
+
+
+// Draw the mesh from its position-only stream, for vertex shaders that only read the position
+void Mesh::RenderDepthOnly(unsigned int lod /*= 0*/)
+{
+    if (mDepthVertexSize == 0)
+    {
+        Render(lod);
+        return;
+    }
+
+    UINT stride = mDepthVertexSize;
+    UINT offset = 0;
+    gD3DContext->IASetVertexBuffers(0, 1, &mBufferSets[0].depthVertexBuffer, &stride, &offset);
+    gD3DContext->IASetInputLayout(mDepthVertexLayout);
+    gD3DContext->IASetIndexBuffer(mBufferSets[0].depthIndexBuffer, mDepthIndexFormat, 0);
+    gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    // The positions are packed as in the full vertices and decoded with the same constants
+    gD3DContext->VSSetConstantBuffers(2, 1, &mConstantBuffer);
+
+    lod = std::min(lod, NumLODs() - 1);
+    unsigned int set = 0;
+    for (unsigned int i = mFirstDepthDraw[lod]; i < mFirstDepthDraw[lod + 1]; ++i)
+    {
+        if (mDepthDrawBufferSets[i] != set)
+        {
+            set = mDepthDrawBufferSets[i];
+            gD3DContext->IASetVertexBuffers(0, 1, &mBufferSets[set].depthVertexBuffer, &stride, &offset);
+            gD3DContext->IASetIndexBuffer(mBufferSets[set].depthIndexBuffer, mDepthIndexFormat, 0);
+        }
+        gD3DContext->DrawIndexed(mDepthDraws[i].numIndices, mDepthDraws[i].startIndex, 0);
+    }
+    gTrianglesDrawn += mLODs[lod].numTriangles;
+}
+
+
+// Choose the level of detail to draw for the mesh's world space bounding sphere, viewed from gMeshCamera.
+// The LOD errors are in model space, scaled to world space by the ratio of the sphere radii. The sphere's
+// radius on screen is close to radius * pixelsPerUnit / distance, and an error scales the same way
+unsigned int Mesh::SelectLOD(const CSphere& worldSphere)
+{
+    float distance = Length(worldSphere.centre - gMeshCamera.position);
+    if (NumLODs() < 2 || gMeshCamera.pixelsPerUnit <= 0 || distance <= worldSphere.radius || mBoundingSphere.radius <= 0)  return 0;
+
+    float pixelsPerModelUnit = (worldSphere.radius / mBoundingSphere.radius) * gMeshCamera.pixelsPerUnit / distance;
+    float maxError = LOD_PIXEL_ERROR * gMeshCamera.lodBias / pixelsPerModelUnit;
+    unsigned int lod = 0;
+    while (lod + 1 < NumLODs() && mLODs[lod + 1].error <= maxError)  ++lod;
+    return lod;
 }
@@ -1,43 +1,210 @@
 //--------------------------------------------------------------------------------------
 // Class encapsulating a mesh
 //--------------------------------------------------------------------------------------
-// The mesh class splits the mesh into sub-meshes that only use one texture each.
-// ** THIS VERSION WILL ONLY KEEP THE FIRST SUB-MESH OTHER PARTS WILL BE MISSING **
-// ** DO NOT USE THIS VERSION FOR PROJECTS **
-// The class also doesn't load textures, filters or shaders as the outer code is
-// expected to select these things. A later lab will introduce a more robust loader.
+// The mesh class loads every sub-mesh (part) of the file into one shared vertex buffer and one shared index
+// buffer. Each sub-mesh is a range of the index buffer, rendered with its own draw call but no buffer changes.
+// The class doesn't load textures, filters or shaders as the outer code is expected to select these things,
+// so all sub-meshes are drawn with the same settings.
+//
+// The first time a mesh file is loaded the imported result is saved as a cooked mesh file next to it (see
+// CookedMesh.h). Later loads memory map the cooked file and create the buffers straight from it without
+// importing anything, as long as the source file and import settings are unchanged.
+//
+// Cooked files can have their vertices and indices compressed (MeshCodec.h), about half the size but decoded
+// into memory when loaded rather than used in place. Decoding runs at about 1 to 1.8 GB/s for vertices and 0.35
+// to 0.65 GB/s for indices on one core, slower than reading the full size file from an NVMe drive and for indices
+// no faster than a SATA one, so it only loads faster from slow storage (hard disks, network folders). Meshes with gMeshCompressionThreshold bytes or more of GPU buffers are cooked compressed, by default
+// none are. A cooked file is used whether it is compressed or not, it is only remade when the mesh is imported.
+//
+// Meshes can be stored with 32-bit floats or with the compact vertex profile, which uses 16-bit formats for
+// half the memory (see VertexPacking.h). Indices are 16-bit whenever they fit. The mesh sets the constants
+// the vertex shaders use to decode its vertices when it is rendered.
+//
+// Meshes are given levels of detail (LODs) when imported, simplified versions sharing the same vertex buffer
+// (see MeshSimplifier.h). SelectLOD picks the coarsest LOD whose error would cover less than a pixel on
+// screen from the current mesh camera (set by the scene before rendering each view), Render draws it.
+//
+// Large meshes are also split into meshlets (see Meshlets.h). When the full detail mesh is drawn with a world
+// matrix, the meshlets outside the camera's frustum or facing away from it are culled on the CPU and the
+// indices of the rest are copied to a dynamic index buffer, which is drawn instead of the full index buffer.
+//
+// Passes that only need depth (depth pre-pass, shadow maps) use RenderDepthOnly, which draws from a second
+// vertex buffer holding positions alone, each different position once (see MeshData.h). It reads 12 bytes per
+// vertex rather than 32 to 44 (8 rather than 16 to 20 with the compact profile), and each level of detail is
+// a single draw call as no sub-mesh needs its own base vertex.
+//
+// Meshes that need ray queries on the CPU (e.g. mouse picking) can be loaded with rayQueries, which keeps a copy
+// of the full detail mesh's positions and indices with a bounding volume hierarchy over them (see MeshBVH.h).
+// Other meshes keep no geometry once their buffers are created.
+//
+// Source files of gMeshStreamingThreshold bytes or more (very large scans) are imported with the streaming import
+// instead (see MeshStreaming.h), which keeps within gMeshStreamingBudget bytes of memory however large the file,
+// and saved as a streamed mesh file (StreamedMesh.h). The GPU buffers are created empty and filled a chunk at a
+// time, so the whole mesh is never in CPU memory. Streamed meshes have no meshlets and can't have ray queries,
+// and the import needs to write its files next to the source file.
+//
+// A Direct3D 11 buffer can't be larger than 2GB (less on GPUs with under 8GB of memory), which a streamed mesh
+// can easily pass. So a streamed mesh's chunks are divided between several sets of vertex and index buffers, each
+// no larger than every GPU allows, and its sub-meshes are drawn from their own set. Other meshes have one set.
+//
+// Scenes that use the same file more than once should load meshes through a MeshRegistry (MeshRegistry.h),
+// which shares one Mesh between all the users of a file and import settings.
 
 #include "common.h"
+#include "BoundingVolumes.h"
+#include "MeshData.h"
+#include "VertexPacking.h"
+#include "Meshlets.h"
+#include "MeshBVH.h"
+#include "MappedFile.h"
 
 #include <string>
+#include <vector>
 
 #ifndef _MESH_H_INCLUDED_
 #define _MESH_H_INCLUDED_
 
+// Largest error allowed on screen by Mesh::SelectLOD, in pixels
+const float LOD_PIXEL_ERROR = 1.0f;
+
+// The view that meshes select levels of detail and cull meshlets for
+struct MeshCamera
+{
+    CVector3    position      = { 0, 0, 0 };
+    float       pixelsPerUnit = 0; // Pixels covered by one unit at distance 1 (Camera::PixelsPerUnit), 0 to always use LOD 0
+    float       lodBias       = 1; // Multiplies the pixel error allowed, more than 1 for coarser LODs (e.g. for a small reflection)
+
+    CMatrix4x4  viewProjectionMatrix;
+    bool        cullMeshlets  = false;             // Turn meshlet culling on or off
+    FaceCulling faceCulling   = FaceCulling::Back; // Must match the rasteriser state used to draw, meshlets are culled the same way
+};
+
+// Set by the scene before rendering each view
+extern MeshCamera gMeshCamera;
+
+// Triangles drawn by all meshes since the scene last reset it
+extern unsigned int gTrianglesDrawn;
+
+// Size of .x file from which meshes use the streaming import (0 to never stream), and the memory that import
+// may use, see comment at top of file. Set before loading meshes
+extern size_t gMeshStreamingThreshold;
+extern size_t gMeshStreamingBudget;
+
+// Size of GPU buffers (MeshGPUBytes, MeshImport.h) from which meshes are cooked compressed (0 to never compress),
+// see comment at top of file. Set before loading meshes
+extern size_t gMeshCompressionThreshold;
+
+
 class Mesh
 {
 public:
-    // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
-    // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+    // Pass the name of the mesh file to load. Reads .x files directly and uses assimp (http://www.assimp.org/) to
+    // support many other file types. Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+    // and choose the vertex formats (VertexProfile::Compact for half the vertex memory). Pass rayQueries to be
+    // able to use Intersect (not for streamed meshes).
     // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-    Mesh(const std::string& fileName, bool requireTangents = false);
+    Mesh(const std::string& fileName, bool requireTangents = false, VertexProfile profile = VertexProfile::Full, bool rayQueries = false);
+
+    // As above for a source file that has already been mapped and hashed with HashMappedFile (see MeshRegistry.h)
+    Mesh(const std::string& fileName, const MappedFile& sourceFile, uint64_t sourceHash,
+         bool requireTangents = false, VertexProfile profile = VertexProfile::Full, bool rayQueries = false);
+
     ~Mesh();
 
+    // Not copyable, the GPU buffers belong to one object
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
     // The render function assumes shaders, matrices, textures, samplers etc. have been set up already.
-    // It simply draws this mesh with whatever settings the GPU is currently using.
-    void Render();
+    // It simply draws this mesh with whatever settings the GPU is currently using. Optionally choose the level
+    // of detail to draw (0 is full detail), and pass the world matrix to cull meshlets for gMeshCamera
+    void Render(unsigned int lod = 0, const CMatrix3x4* worldMatrix = nullptr);
+
+    // Draw the mesh from its position-only stream, for vertex shaders that only read the position (e.g.
+    // DepthOnly_vs). Meshlets are not culled. Draws with Render if the mesh has no depth stream
+    void RenderDepthOnly(unsigned int lod = 0);
+
+    // Levels of detail, see comment at top of file. A mesh without LODs has one, the full detail mesh
+    unsigned int NumLODs()  { return static_cast<unsigned int>(mLODs.size()); }
+    unsigned int LODTriangles(unsigned int lod)  { return mLODs[lod].numTriangles; }
+    float        LODError    (unsigned int lod)  { return mLODs[lod].error;        } // In model space
+
+    // Choose the level of detail to draw for the mesh's world space bounding sphere, viewed from gMeshCamera
+    unsigned int SelectLOD(const CSphere& worldSphere);
+
+    // Bounding volumes of the vertices in model space, calculated at load time. Transform by a model's world
+    // matrix (TransformAABB / TransformSphere) for a world space volume to cull against the camera frustum
+    const CAABB&   BoundingBox()    { return mBoundingBox;    }
+    const CSphere& BoundingSphere() { return mBoundingSphere; }
+
+    // Size in bytes of the GPU buffers created for the mesh
+    size_t GPUBytes()  { return mGPUBytes; }
+
+    // Find the closest triangle of the full detail mesh hit by the ray origin + t * direction with t from 0 to
+    // maxDistance, in model space (see MeshBVH::Intersect). Returns false if nothing is hit or the mesh was not
+    // loaded with rayQueries
+    bool Intersect(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit)
+    {
+        return mBVH.Intersect(origin, direction, maxDistance, hit);
+    }
+    bool HasRayQueries()  { return !mBVH.Empty(); }
 
 
 private:
+    // Import or load the cooked mesh and create the GPU buffers, shared by the constructors
+    void Load(const std::string& fileName, const MappedFile& sourceFile, uint64_t sourceHash,
+              bool requireTangents, VertexProfile profile, bool rayQueries);
+
     unsigned int       mVertexSize;             // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
     ID3D11InputLayout* mVertexLayout = nullptr; // DirectX specification of data held in a single vertex
 
-    // GPU-side vertex and index buffers
-    unsigned int       mNumVertices;
-    ID3D11Buffer*      mVertexBuffer = nullptr;
+    // GPU-side vertex and index buffers, and the position-only stream for RenderDepthOnly (if the mesh has one),
+    // in one or more sets (see comment at top of file)
+    struct BufferSet
+    {
+        ID3D11Buffer* vertexBuffer      = nullptr;
+        ID3D11Buffer* indexBuffer       = nullptr;
+        ID3D11Buffer* depthVertexBuffer = nullptr;
+        ID3D11Buffer* depthIndexBuffer  = nullptr;
+    };
+    std::vector<BufferSet> mBufferSets;
 
+    unsigned int       mNumVertices;
     unsigned int       mNumIndices;
-    ID3D11Buffer*      mIndexBuffer  = nullptr;
+    DXGI_FORMAT        mIndexFormat;            // 16 or 32 bit indices
+
+    // How the vertex shaders decode this mesh's vertices (PerMeshConstants in Common.h)
+    ID3D11Buffer*      mConstantBuffer = nullptr;
+
+    // Ranges of the buffers above, one for each part of each level of detail, and the set each is in
+    std::vector<SubMesh>      mSubMeshes;
+    std::vector<unsigned int> mSubMeshBufferSets;
+
+    // Ranges of the sub-meshes, one for each level of detail (always at least one)
+    std::vector<MeshLOD> mLODs;
+
+    // Meshlet culling for the full detail mesh, with the dynamic index buffer the visible indices are copied to
+    MeshletCuller      mMeshletCuller;
+    ID3D11Buffer*      mCulledIndexBuffer = nullptr;
+
+    // Layout of the position-only stream for RenderDepthOnly, with the index ranges drawn for each level of detail
+    // (the LOD's sub-mesh ranges joined where they meet in the same set, with no base vertex)
+    unsigned int       mDepthVertexSize   = 0;  // 0 if the mesh has no position-only stream
+    ID3D11InputLayout* mDepthVertexLayout = nullptr;
+    DXGI_FORMAT        mDepthIndexFormat;
+
+    std::vector<SubMesh>      mDepthDraws;
+    std::vector<unsigned int> mDepthDrawBufferSets;
+    std::vector<unsigned int> mFirstDepthDraw; // Index into mDepthDraws for each LOD, and one more for the end
+
+    // Model space bounding volumes
+    CAABB              mBoundingBox;
+    CSphere            mBoundingSphere;
+
+    // CPU copy of the full detail mesh for Intersect, empty unless loaded with rayQueries
+    MeshBVH            mBVH;
+
+    size_t             mGPUBytes = 0;
 };
 
 
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// Registry sharing meshes between the users of the same file
+//--------------------------------------------------------------------------------------
+
+#include "MeshRegistry.h"
+#include "MappedFile.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <tuple>
+#include <sstream>
+#include <cctype>
+
+
+/*-----------------------------------------------------------------------------------------
+    Helper functions
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+    // Full path of a file in one form for all the ways of writing it: lower case with backslashes. Returns
+    // the name unchanged apart from case and slashes if Windows can't make a full path
+    std::string CanonicalPath(const std::string& fileName)
+    {
+        std::string path = fileName;
+        DWORD size = GetFullPathNameA(fileName.c_str(), 0, nullptr, nullptr);
+        if (size > 0)
+        {
+            path.resize(size);
+            size = GetFullPathNameA(fileName.c_str(), size, &path[0], nullptr);
+            path.resize(size);
+        }
+        for (char& c : path)
+        {
+            c = (c == '/') ? '\\' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return path;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Mesh registry
+-----------------------------------------------------------------------------------------*/
+
+bool MeshRegistry::Key::operator<(const Key& other) const
+{
+    return std::tie(path, requireTangents, profile, rayQueries, contentHash) <
+           std::tie(other.path, other.requireTangents, other.profile, other.rayQueries, other.contentHash);
+}
+
+
+// Return the mesh for the given file and import settings (see the Mesh constructor), creating it if there
+// is no existing handle to it. Will throw a std::runtime_error exception on failure, as the Mesh constructor
+std::shared_ptr<Mesh> MeshRegistry::Load(const std::string& fileName, bool requireTangents /*= false*/,
+                                         VertexProfile profile /*= VertexProfile::Full*/, bool rayQueries /*= false*/)
+{
+    ++mNumLoads;
+
+    MappedFile sourceFile;
+    if (!sourceFile.Open(fileName))  throw std::runtime_error("Error loading mesh (" + fileName + "). Cannot open file");
+    Key key = { CanonicalPath(fileName), requireTangents, profile, rayQueries, HashMappedFile(sourceFile) };
+
+    // Share the existing mesh if anything still holds it
+    auto entry = mMeshes.find(key);
+    if (entry != mMeshes.end())
+    {
+        std::shared_ptr<Mesh> mesh = entry->second.lock();
+        if (mesh)
+        {
+            ++mNumShared;
+            mBytesSaved += mesh->GPUBytes();
+            return mesh;
+        }
+    }
+
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(fileName, sourceFile, key.contentHash, requireTangents, profile, rayQueries);
+    ++mNumMeshes;
+    mGPUBytes += mesh->GPUBytes();
+
+    // Forget meshes that have been destroyed so the map doesn't grow with every file ever loaded
+    for (auto i = mMeshes.begin(); i != mMeshes.end(); )
+    {
+        if (i->second.expired())  i = mMeshes.erase(i);
+        else                      ++i;
+    }
+    mMeshes[key] = mesh;
+    return mesh;
+}
+
+
+// One line summary of the statistics, e.g. for the debug output after loading a scene
+std::string MeshRegistry::Report()
+{
+    std::ostringstream report;
+    report << "Meshes: " << mNumLoads << " loads, " << mNumMeshes << " created (" << (mGPUBytes + 512) / 1024 << "KB GPU memory), "
+           << mNumShared << " shared (" << (mBytesSaved + 512) / 1024 << "KB saved)";
+    return report.str();
+}
@@ -0,0 +1,71 @@
+//--------------------------------------------------------------------------------------
+// Registry sharing meshes between the users of the same file
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A scene often uses one mesh file in several places (e.g. the cube used by the portal and by the textured
+// cubes). Creating a Mesh for each of them imports or maps the file again and makes another copy of the
+// vertex, index and constant buffers on the GPU. The registry hands out shared Mesh handles instead: a mesh
+// is created once for each file and set of import settings, and every later Load for them returns the same
+// Mesh. The mesh is destroyed when the last handle to it is released, the registry doesn't keep it alive.
+//
+// Meshes are identified by the full path of the file (made lower case with backslashes, as Windows paths
+// are not case sensitive and can use either slash), the import settings and a hash of the file contents.
+// The file is mapped and hashed on each Load, which costs far less than creating the mesh, so a file that
+// has changed on disk is loaded again rather than sharing the out of date mesh. The hash is passed on to
+// the Mesh, which uses it for its cooked mesh key (see Mesh.h), so a new mesh doesn't hash the file twice.
+//
+// The registry counts the loads that shared an existing mesh and the GPU memory that saved, see Report.
+
+#include "Mesh.h"
+
+#include <string>
+#include <memory>
+#include <map>
+
+#ifndef _MESH_REGISTRY_H_INCLUDED_
+#define _MESH_REGISTRY_H_INCLUDED_
+
+class MeshRegistry
+{
+public:
+    // Return the mesh for the given file and import settings (see the Mesh constructor), creating it if there
+    // is no existing handle to it. Will throw a std::runtime_error exception on failure, as the Mesh constructor
+    std::shared_ptr<Mesh> Load(const std::string& fileName, bool requireTangents = false, VertexProfile profile = VertexProfile::Full,
+                               bool rayQueries = false);
+
+    // Statistics since the registry was created
+    unsigned int NumLoads()       { return mNumLoads;   } // Calls to Load
+    unsigned int NumMeshes()      { return mNumMeshes;  } // Meshes created by Load
+    unsigned int NumShared()      { return mNumShared;  } // Loads that returned an existing mesh
+    size_t       GPUBytes()       { return mGPUBytes;   } // GPU memory of the meshes created
+    size_t       GPUBytesSaved()  { return mBytesSaved; } // GPU memory the shared loads would have used
+
+    // One line summary of the statistics above, e.g. for the debug output after loading a scene
+    std::string Report();
+
+
+private:
+    // What identifies a mesh, see comment at top of file
+    struct Key
+    {
+        std::string   path;
+        bool          requireTangents;
+        VertexProfile profile;
+        bool          rayQueries;
+        uint64_t      contentHash;
+
+        bool operator<(const Key& other) const;
+    };
+
+    std::map<Key, std::weak_ptr<Mesh>> mMeshes;
+
+    unsigned int mNumLoads   = 0;
+    unsigned int mNumMeshes  = 0;
+    unsigned int mNumShared  = 0;
+    size_t       mGPUBytes   = 0;
+    size_t       mBytesSaved = 0;
+};
+
+
+#endif //_MESH_REGISTRY_H_INCLUDED_
@@ -14,14 +14,38 @@ void Model::Render()
 {
     UpdateWorldMatrix();
 
-    gPerModelConstants.worldMatrix = mWorldMatrix; // Update C++ side constant buffer
+    gPerModelConstants.worldMatrix = mWorldMatrix; // Update C++ side constant buffer, the 3x4 matrix is already in GPU layout
     UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants); // Send to GPU
 
     // Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
     gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer); // First parameter must match constant buffer number in the shader
     gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
 
-    mMesh->Render();
+    // Draw the level of detail suited to the model's size on screen, culling meshlets at full detail
+    mMesh->Render(mMesh->SelectLOD(TransformSphere(mMesh->BoundingSphere(), mWorldMatrix)), &mWorldMatrix);
+}
+
+
+void Model::RenderDepthOnly()
+{
+    UpdateWorldMatrix();
+
+    gPerModelConstants.worldMatrix = mWorldMatrix;
+    UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants);
+    gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+
+    mMesh->RenderDepthOnly(mMesh->SelectLOD(TransformSphere(mMesh->BoundingSphere(), mWorldMatrix)));
+}
+
+
+// Find the closest triangle of the model hit by a world space ray, see Model.h
+bool Model::Intersect(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit)
+{
+    if (!mMesh->HasRayQueries())  return false;
+
+    UpdateWorldMatrix();
+    CMatrix3x4 inverseWorld = InverseAffine(mWorldMatrix);
+    return mMesh->Intersect(TransformPoint(origin, inverseWorld), TransformVector(direction, inverseWorld), maxDistance, hit);
 }
 
 
@@ -32,30 +56,34 @@ void Model::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode t
 {
     UpdateWorldMatrix();
 
+	// Turning up/down and rolling are around the model's local X and Z axes, turning left/right is
+	// around the world Y axis. Matches the old Euler angle controls for a model that isn't rolled
+	float turn = ROTATION_SPEED * frameTime;
 	if (KeyHeld( turnDown ))
 	{
-		mRotation.x += ROTATION_SPEED * frameTime;
+		mRotation = QuaternionAxisAngle({ 1, 0, 0 },  turn) * mRotation;
 	}
 	if (KeyHeld( turnUp ))
 	{
-		mRotation.x -= ROTATION_SPEED * frameTime;
+		mRotation = QuaternionAxisAngle({ 1, 0, 0 }, -turn) * mRotation;
 	}
 	if (KeyHeld( turnRight ))
 	{
-		mRotation.y += ROTATION_SPEED * frameTime;
+		mRotation = mRotation * QuaternionAxisAngle({ 0, 1, 0 },  turn);
 	}
 	if (KeyHeld( turnLeft ))
 	{
-		mRotation.y -= ROTATION_SPEED * frameTime;
+		mRotation = mRotation * QuaternionAxisAngle({ 0, 1, 0 }, -turn);
 	}
 	if (KeyHeld( turnCW ))
 	{
-		mRotation.z += ROTATION_SPEED * frameTime;
+		mRotation = QuaternionAxisAngle({ 0, 0, 1 },  turn) * mRotation;
 	}
 	if (KeyHeld( turnCCW ))
 	{
-		mRotation.z -= ROTATION_SPEED * frameTime;
+		mRotation = QuaternionAxisAngle({ 0, 0, 1 }, -turn) * mRotation;
 	}
+	mRotation = Normalise(mRotation); // Prevent rounding errors building up
 
 	// Local Z movement - move in the direction of the Z axis, get axis from world matrix
 	if (KeyHeld( moveForward ))
@@ -75,5 +103,6 @@ void Model::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode t
 
 void Model::UpdateWorldMatrix()
 {
-    mWorldMatrix = MatrixScaling(mScale) * MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
+    // Writes the world matrix elements directly from position, rotation and scale - no matrix multiplies
+    mWorldMatrix = AffineFromTRS(mPosition, mRotation, mScale);
 }
\ No newline at end of file
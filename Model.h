@@ -7,12 +7,15 @@
 #include "Common.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "CMatrix3x4.h"
+#include "CQuaternion.h"
 #include "Input.h"
 
 #ifndef _MODEL_H_INCLUDED_
 #define _MODEL_H_INCLUDED_
 
 class Mesh;
+struct RayHit;
 
 class Model
 {
@@ -22,25 +25,34 @@ public:
 	//-------------------------------------
 
     Model(Mesh* mesh, CVector3 position = { 0,0,0 }, CVector3 rotation = { 0,0,0 }, float scale = 1)
-        : mMesh(mesh), mPosition(position), mRotation(rotation), mScale({ scale, scale, scale })
+        : mMesh(mesh), mPosition(position), mRotation(QuaternionFromEuler(rotation)), mScale({ scale, scale, scale })
     {
     }
 
     // The render function sets the world matrix in the per-frame constant buffer and makes that buffer available
     // to vertex & pixel shader. Then it calls Mesh:Render, which renders the geometry with current GPU settings.
     // So all other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
+    // The mesh's level of detail is chosen for the model's size on screen from gMeshCamera (see Mesh.h)
     void Render();
 
+    // As Render, but draws the mesh's position-only stream (Mesh::RenderDepthOnly) for depth-only passes, which
+    // must use a vertex shader that only reads positions (e.g. DepthOnly_vs) and need no pixel shader constants
+    void RenderDepthOnly();
+
+    // Find the closest triangle of the model hit by the world space ray origin + t * direction with t from 0 to
+    // maxDistance. The ray is moved into model space without normalising it, so the hit distance is also in
+    // multiples of the world space direction. Returns false if nothing is hit or the mesh has no ray queries
+    bool Intersect(const CVector3& origin, const CVector3& direction, float maxDistance, RayHit& hit);
+
 
 	// Control the model's position and rotation using keys provided. Amount of motion performed depends on frame time
 	void Control( float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,  
 				  KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward );
 
+	// Rotate the model so its Z axis faces the given target point
 	void FaceTarget(CVector3 target)
 	{
-		UpdateWorldMatrix();
-		mWorldMatrix.FaceTarget(target);
-		mRotation = mWorldMatrix.GetEulerAngles();
+		mRotation = QuaternionFaceTarget(mPosition, target, mRotation);
 	}
 
 
@@ -48,20 +60,22 @@ public:
 	// Data access
 	//-------------------------------------
 
-	// Getters / setters
-	CVector3 Position()  { return mPosition; }
-	CVector3 Rotation()  { return mRotation; }
-	CVector3 Scale()     { return mScale;    }
+	// Getters / setters. Rotation is stored as a quaternion, Rotation / SetRotation convert to / from Euler angles
+	CVector3    Position()     { return mPosition; }
+	CVector3    Rotation()     { return mRotation.GetEulerAngles(); }
+	CQuaternion Orientation()  { return mRotation; }
+	CVector3    Scale()        { return mScale;    }
 
-	void SetPosition( CVector3 position )  { mPosition = position; }
-	void SetRotation( CVector3 rotation )  { mRotation = rotation; }
+	void SetPosition   ( CVector3 position )       { mPosition = position; }
+	void SetRotation   ( CVector3 rotation )       { mRotation = QuaternionFromEuler(rotation); }
+	void SetOrientation( CQuaternion orientation ) { mRotation = orientation; }
 
 	// Two ways to set scale: x,y,z separately, or all to the same value
 	void SetScale   ( CVector3 scale    )  { mScale = scale;       } 
 	void SetScale   ( float scale       )  { mScale = { scale, scale, scale };}
 
 	// Read only access to model world matrix, updated on request
-	CMatrix4x4 WorldMatrix()  { UpdateWorldMatrix();  return mWorldMatrix; }
+	CMatrix3x4 WorldMatrix()  { UpdateWorldMatrix();  return mWorldMatrix; }
 
 
 	//-------------------------------------
@@ -73,12 +87,13 @@ private:
     Mesh* mMesh;
 
 	// Position, rotation and scaling for the model
-	CVector3 mPosition;
-	CVector3 mRotation;
-	CVector3 mScale;
+	CVector3    mPosition;
+	CQuaternion mRotation;
+	CVector3    mScale;
 
-	// World matrix for the model - built from the above
-	CMatrix4x4 mWorldMatrix;
+	// World matrix for the model - built from the above. Affine so held in the compact 3x4 form, which is
+	// also the form the shaders take it in
+	CMatrix3x4 mWorldMatrix;
 };
 
 
@@ -5,6 +5,7 @@
 
 #include "Scene.h"
 #include "Mesh.h"
+#include "MeshRegistry.h"
 #include "Model.h"
 #include "Camera.h"
 #include "State.h"
@@ -15,6 +16,7 @@
 #include "CVector3.h" 
 #include "CMatrix4x4.h"
 #include "MathHelpers.h"     // Helper functions for maths
+#include "FastMath.h"        // Batch sine / cosine for the orbiting lights
 #include "GraphicsHelpers.h" // Helper functions to unclutter the code
 #include "ColourRGBA.h" 
 #include <sstream>
@@ -36,15 +38,17 @@ valueChange redColour   = UP;
 valueChange greenColour = UP;
 valueChange lerpEffect  = UP;
 
-// Meshes
-Mesh* gPortalMesh;
-Mesh* gLightMesh;
-Mesh* gFloorMesh;
-Mesh* gTeapotMesh;
-Mesh* gSphereMesh;
-Mesh* gCubeMesh;
-Mesh* gTrollMesh;
-Mesh* gRobotMesh;
+// Meshes, shared handles from the registry so a file used twice (e.g. Cube.x) is only loaded once. All but the
+// light mesh keep a copy of their triangles for picking with the mouse (see RayQueryScene)
+MeshRegistry gMeshRegistry;
+std::shared_ptr<Mesh> gPortalMesh;
+std::shared_ptr<Mesh> gLightMesh;
+std::shared_ptr<Mesh> gFloorMesh;
+std::shared_ptr<Mesh> gTeapotMesh;
+std::shared_ptr<Mesh> gSphereMesh;
+std::shared_ptr<Mesh> gCubeMesh;
+std::shared_ptr<Mesh> gTrollMesh;
+std::shared_ptr<Mesh> gRobotMesh;
 
 // Models
 Model* gFloor;
@@ -64,6 +68,31 @@ Model* gTroll;
 Model* gPortal;
 Model* gRobot;
 
+// Models that rays can hit, with the names shown when they are picked
+struct PickableModel
+{
+	Model**     model;
+	const char* name;
+};
+const PickableModel PICKABLE_MODELS[] =
+{
+	{ &gFloor,          "Floor"           },
+	{ &gTeapot,         "Teapot"          },
+	{ &gSphere,         "Sphere"          },
+	{ &gTwoTextureCube, "Two texture cube"},
+	{ &gAddBlendcube,   "Additive cube"   },
+	{ &gMultiBlendcube, "Multiply cube"   },
+	{ &gAlphaBlendCube, "Alpha cube"      },
+	{ &gNormalMapCube,  "Normal map cube" },
+	{ &gTroll,          "Troll"           },
+	{ &gPortal,         "Portal"          },
+	{ &gRobot,          "Robot"           },
+};
+
+// Last model picked with the left mouse button, shown in the window title
+ScenePick gPick;
+bool      gHasPick = false;
+
 // Cameras
 Camera* gCamera;
 Camera* gPortalCamera;
@@ -113,31 +142,31 @@ float    OutlineThickness = 0.050f;
 // Variables controlling Lights orbiting of the models
 
 // Light 1
-const float gLight2Orbit = 20.0f;
-const float gLight3Orbit = 40.0f;
-const float gLight4Orbit = 20.0f;
-const float gLight5Orbit = 30.0f;
-const float gLight1Multiplier = 10.0f;
+constexpr float gLight2Orbit = 20.0f;
+constexpr float gLight3Orbit = 40.0f;
+constexpr float gLight4Orbit = 20.0f;
+constexpr float gLight5Orbit = 30.0f;
+constexpr float gLight1Multiplier = 10.0f;
 
 // Light 2
-const float gLight2OrbitSpeed = 0.7f;
-const float gLight3OrbitSpeed = 1.0f;
-const float gLight4OrbitSpeed = 1.0f;
-const float gLight5OrbitSpeed = 1.0f;
+constexpr float gLight2OrbitSpeed = 0.7f;
+constexpr float gLight3OrbitSpeed = 1.0f;
+constexpr float gLight4OrbitSpeed = 1.0f;
+constexpr float gLight5OrbitSpeed = 1.0f;
 
 // Other
-const int   gLightStrengthModifer = 2;
-const int   gLightColorModifier   = 5;
-const int   gWiggleMultipler      = 6;
-const int   gRotateModifer        = 2;
-
-const float gMinLightStrength      = 1.0f;
-const float gMaxLightStrength      = 30.0f;
-const float gMinLightColour        = 0.2f;
-const float gMaxLightColour        = 0.99f;
-const float gLerpMinValue          = 0.0f;
-const float gLerpMaxValue          = 1.0f;
-const float gPortalRotateMultipler = 0.5f;
+constexpr int   gLightStrengthModifer = 2;
+constexpr int   gLightColorModifier   = 5;
+constexpr int   gWiggleMultipler      = 6;
+constexpr int   gRotateModifer        = 2;
+
+constexpr float gMinLightStrength      = 1.0f;
+constexpr float gMaxLightStrength      = 30.0f;
+constexpr float gMinLightColour        = 0.2f;
+constexpr float gMaxLightColour        = 0.99f;
+constexpr float gLerpMinValue          = 0.0f;
+constexpr float gLerpMaxValue          = 1.0f;
+constexpr float gPortalRotateMultipler = 0.5f;
 
 //--------------------------------------------------------------------------------------
 //**** Portal Texture  ****//
@@ -148,6 +177,12 @@ const float gPortalRotateMultipler = 0.5f;
 int gPortalWidth  = 1024;
 int gPortalHeight = 1024;
 
+// The portal shows the scene small, so allow coarser levels of detail in it
+constexpr float gPortalLODBias = 4.0f;
+
+// Cull the meshlets of large meshes on the CPU (see Mesh.h)
+bool gCullMeshlets = true;
+
 // The portal texture - each frame it is rendered to, then it is used as a texture for model
 ID3D11Texture2D*          gPortalTexture      = nullptr; // This object represents the memory used by the texture on the GPU
 ID3D11RenderTargetView*   gPortalRenderTarget = nullptr; // This object is used when we want to render to the texture above
@@ -239,20 +274,21 @@ bool InitGeometry()
 	// Load mesh geometry data.
 	try
 	{
-		gLightMesh  = new Mesh(".\\Media\\Light.x");
-		gPortalMesh = new Mesh(".\\Media\\Cube.x");
-		gFloorMesh  = new Mesh(".\\Media\\Ground.x");
-		gTeapotMesh = new Mesh(".\\Media\\Teapot.x");
-		gSphereMesh = new Mesh(".\\Media\\Sphere.x");
-		gCubeMesh   = new Mesh(".\\Media\\Cube.x");
-		gTrollMesh  = new Mesh(".\\Media\\troll.x");
-		gRobotMesh  = new Mesh(".\\Media\\Robot.x");
+		gLightMesh  = gMeshRegistry.Load(".\\Media\\Light.x");
+		gPortalMesh = gMeshRegistry.Load(".\\Media\\Cube.x",   false, VertexProfile::Full, true);
+		gFloorMesh  = gMeshRegistry.Load(".\\Media\\Ground.x", false, VertexProfile::Full, true);
+		gTeapotMesh = gMeshRegistry.Load(".\\Media\\Teapot.x", false, VertexProfile::Full, true);
+		gSphereMesh = gMeshRegistry.Load(".\\Media\\Sphere.x", false, VertexProfile::Full, true);
+		gCubeMesh   = gMeshRegistry.Load(".\\Media\\Cube.x",   false, VertexProfile::Full, true);
+		gTrollMesh  = gMeshRegistry.Load(".\\Media\\troll.x",  false, VertexProfile::Full, true);
+		gRobotMesh  = gMeshRegistry.Load(".\\Media\\Robot.x",  false, VertexProfile::Full, true);
 	}
 	catch (std::runtime_error e)  
 	{
 		gLastError = e.what(); // This picks up the error message put in the exception (see Mesh.cpp)
 		return false;
 	}
+	OutputDebugStringA((gMeshRegistry.Report() + "\n").c_str());
 
 
 	// Load the shaders required for the geometry we will use (see Shader.cpp / .h)
@@ -394,22 +430,22 @@ bool InitScene()
 {
 	//// Set up scene ////
 
-	gFloor          = new Model(gFloorMesh);
-	gTeapot         = new Model(gTeapotMesh);
-	gSphere         = new Model(gSphereMesh);
-	gLight1         = new Model(gLightMesh);
-	gLight2         = new Model(gLightMesh);
-	gLight3         = new Model(gLightMesh);
-	gLight4         = new Model(gLightMesh);
-	gLight5         = new Model(gLightMesh);
-	gTwoTextureCube = new Model(gCubeMesh);
-	gAddBlendcube   = new Model(gCubeMesh);
-	gMultiBlendcube = new Model(gCubeMesh);
-	gAlphaBlendCube = new Model(gCubeMesh);
-	gNormalMapCube  = new Model(gCubeMesh);
-	gTroll          = new Model(gTrollMesh);
-	gPortal         = new Model(gPortalMesh);
-	gRobot          = new Model(gRobotMesh);
+	gFloor          = new Model(gFloorMesh.get());
+	gTeapot         = new Model(gTeapotMesh.get());
+	gSphere         = new Model(gSphereMesh.get());
+	gLight1         = new Model(gLightMesh.get());
+	gLight2         = new Model(gLightMesh.get());
+	gLight3         = new Model(gLightMesh.get());
+	gLight4         = new Model(gLightMesh.get());
+	gLight5         = new Model(gLightMesh.get());
+	gTwoTextureCube = new Model(gCubeMesh.get());
+	gAddBlendcube   = new Model(gCubeMesh.get());
+	gMultiBlendcube = new Model(gCubeMesh.get());
+	gAlphaBlendCube = new Model(gCubeMesh.get());
+	gNormalMapCube  = new Model(gCubeMesh.get());
+	gTroll          = new Model(gTrollMesh.get());
+	gPortal         = new Model(gPortalMesh.get());
+	gRobot          = new Model(gRobotMesh.get());
 
 	// Initial positions
 
@@ -478,6 +514,7 @@ bool InitScene()
 	gPortalCamera = new Camera();
 	gPortalCamera->SetPosition({ 45, 45, 85 });
 	gPortalCamera->SetRotation({ ToRadians(20.0f), ToRadians(215.0f), 0 });
+	gPortalCamera->SetLODBias(gPortalLODBias);
 
 	return true;
 }
@@ -528,14 +565,14 @@ void ReleaseResources()
 
 	delete gCamera;         gCamera         = nullptr;
 	delete gPortalCamera;   gPortalCamera   = nullptr;
-	delete gPortalMesh;     gPortalMesh     = nullptr;
-	delete gLightMesh;      gLightMesh      = nullptr;
+	gPortalMesh     = nullptr;
+	gLightMesh      = nullptr;
 	delete gTroll;          gTroll          = nullptr;
-	delete gFloorMesh;      gFloorMesh      = nullptr;
-	delete gTeapotMesh;     gTeapotMesh     = nullptr;
-	delete gSphereMesh;     gSphereMesh     = nullptr;
-	delete gCubeMesh;       gCubeMesh       = nullptr;
-	delete gTrollMesh;      gTrollMesh      = nullptr;
+	gFloorMesh      = nullptr;
+	gTeapotMesh     = nullptr;
+	gSphereMesh     = nullptr;
+	gCubeMesh       = nullptr;
+	gTrollMesh      = nullptr;
 	delete gFloor;          gFloor          = nullptr;
 	delete gTeapot;         gTeapot         = nullptr;
 	delete gSphere;         gSphere         = nullptr;
@@ -551,6 +588,7 @@ void ReleaseResources()
 	delete gLight4;         gLight4         = nullptr;
 	delete gLight5;         gLight5         = nullptr;
 	delete gRobot;          gRobot          = nullptr;
+	gRobotMesh      = nullptr;
 
 }
 
@@ -560,9 +598,18 @@ void ReleaseResources()
 
 // Render everything in the scene from the given camera
 // This code is common between rendering the main scene and rendering the scene in the portal
-// See RenderScene function below
-void RenderSceneFromCamera(Camera* camera)
+// See RenderScene function below. Pass the height of the viewport being rendered to, for mesh level of detail selection
+void RenderSceneFromCamera(Camera* camera, float viewportHeight)
 {
+	// Meshes choose their level of detail for this camera
+	gMeshCamera.position      = camera->Position();
+	gMeshCamera.pixelsPerUnit = camera->PixelsPerUnit(viewportHeight);
+	gMeshCamera.lodBias       = camera->LODBias();
+
+	// Large meshes cull their meshlets for this camera
+	gMeshCamera.viewProjectionMatrix = camera->ViewProjectionMatrix();
+	gMeshCamera.cullMeshlets         = gCullMeshlets;
+
 	// Set camera matrices in the constant buffer and send over to GPU
 	gPerFrameConstants.viewMatrix           = camera->ViewMatrix();
 	gPerFrameConstants.projectionMatrix     = camera->ProjectionMatrix();
@@ -587,6 +634,7 @@ void RenderSceneFromCamera(Camera* camera)
 	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
 	gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
 	gD3DContext->RSSetState(gCullBackState);
+	gMeshCamera.faceCulling = FaceCulling::Back; // Meshlets are culled the same way as faces
 
 	// Select the approriate textures and sampler to use in the pixel shader
 	gD3DContext->PSSetShaderResources(0, 1, &gFloorDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
@@ -604,6 +652,7 @@ void RenderSceneFromCamera(Camera* camera)
 	// RENDER ADDITAVE BLENDING CUBE //
 	gD3DContext->PSSetShaderResources(0, 1, &gAddBlendCubeDiffuseSpecularMapSRV);
 	gD3DContext->RSSetState(gCullNoneState);
+	gMeshCamera.faceCulling = FaceCulling::None;
 	gD3DContext->OMSetBlendState(gAdditiveBlendingState, nullptr, 0xffffff);
 	gAddBlendcube->Render();
 
@@ -636,6 +685,7 @@ void RenderSceneFromCamera(Camera* camera)
 	// States - no blending, normal depth buffer. However, use front culling to draw *inside* of model
 	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
 	gD3DContext->RSSetState(gCullFrontState);
+	gMeshCamera.faceCulling = FaceCulling::Front;
 
 	// No textures needed, draws outline in plain colour
 	// Render models, no GPU changes needed between rendering them in this case
@@ -649,6 +699,7 @@ void RenderSceneFromCamera(Camera* camera)
 
 	// Switch back to the usual back face culling (not inside out)
 	gD3DContext->RSSetState(gCullBackState);
+	gMeshCamera.faceCulling = FaceCulling::Back;
 
 	// Select the troll texture and sampler
 	gD3DContext->PSSetShaderResources(0, 1, &gTrollDiffuseMapSRV); // First parameter must match texture slot number in the shaer
@@ -686,6 +737,7 @@ void RenderSceneFromCamera(Camera* camera)
 	gD3DContext->OMSetBlendState(gAdditiveBlendingState, nullptr, 0xffffff);
 	gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
 	gD3DContext->RSSetState(gCullNoneState);
+	gMeshCamera.faceCulling = FaceCulling::None;
 
 	// The shaders, texture and states are the same, so no need to set them again to draw the second light
 
@@ -706,6 +758,7 @@ void RenderSceneFromCamera(Camera* camera)
 	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
 	gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
 	gD3DContext->RSSetState(gCullBackState);
+	gMeshCamera.faceCulling = FaceCulling::Back;
 
 	gD3DContext->PSSetShaderResources(0, 1, &gPortalTextureSRV);
 	gPortal->Render();
@@ -716,6 +769,7 @@ void RenderSceneFromCamera(Camera* camera)
 	gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
 	gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
 	gD3DContext->RSSetState(gCullBackState);
+	gMeshCamera.faceCulling = FaceCulling::Back;
 	gRobot->Render();
 
 
@@ -728,6 +782,8 @@ void RenderScene()
 {
 	//// Common settings for both main scene and portal scene ////
 
+	gTrianglesDrawn = 0; // Counted by the meshes as they render
+
 	// Set up the light information in the constant buffer
 	// Don't send to the GPU yet, the function RenderSceneFromCamera will do that
 	gPerFrameConstants.light1Colour   = gLight1Colour * gLight1Strength;
@@ -765,7 +821,7 @@ void RenderScene()
 	gD3DContext->RSSetViewports(1, &vp);
 
 	// Render the scene for the portal
-	RenderSceneFromCamera(gPortalCamera);
+	RenderSceneFromCamera(gPortalCamera, vp.Height);
 
 
 	//// Main scene rendering ////
@@ -788,7 +844,7 @@ void RenderScene()
 	gD3DContext->RSSetViewports(1, &vp);
 
 	// Render the scene for the main window
-	RenderSceneFromCamera(gCamera);
+	RenderSceneFromCamera(gCamera, vp.Height);
 
 	//// Scene completion ////
 
@@ -857,10 +913,15 @@ void UpdateScene(float frameTime)
 	}
 	gLight2Colour = { gLight2Red, 0.5f, 1.0f };
 
+	// Orbiting lights and portal - sines and cosines of all the orbit angles are calculated together
+	enum { Light2Orbit, Light3Orbit, Light4Orbit, Light5Orbit, PortalOrbit, NumOrbits };
+	static float orbitAngles[NumOrbits] = {};
+	float orbitSin[NumOrbits], orbitCos[NumOrbits];
+	SinCos(orbitAngles, orbitSin, orbitCos, NumOrbits);
+
 	// Orbit Light2
-	static float rotate = 0.0f;
-	gLight2->SetPosition(gTeapot->Position() + CVector3{ cos(rotate) * gLight2Orbit, 10.0f, sin(rotate) * gLight2Orbit });
-	rotate -= gLight2OrbitSpeed * frameTime;
+	gLight2->SetPosition(gTeapot->Position() + CVector3{ orbitCos[Light2Orbit] * gLight2Orbit, 10.0f, orbitSin[Light2Orbit] * gLight2Orbit });
+	orbitAngles[Light2Orbit] -= gLight2OrbitSpeed * frameTime;
 
 	// Wiggle effect - Used on sphere
 	gPerModelConstants.wiggle += gWiggleMultipler * frameTime;
@@ -893,31 +954,39 @@ void UpdateScene(float frameTime)
 	gAlphaBlendCube->SetRotation (CVector3{ rotateX, rotateY, 0.0f });
 
 	// Orbit Light3
-	static float rotate2 = 0.0f;
-	gLight3->SetPosition(gMultiBlendcube->Position() + CVector3{ cos(rotate2) * gLight3Orbit, 5.0f, sin(rotate2) * gLight3Orbit });
-	rotate2 -= gLight3OrbitSpeed * frameTime;
+	gLight3->SetPosition(gMultiBlendcube->Position() + CVector3{ orbitCos[Light3Orbit] * gLight3Orbit, 5.0f, orbitSin[Light3Orbit] * gLight3Orbit });
+	orbitAngles[Light3Orbit] -= gLight3OrbitSpeed * frameTime;
 
 	// Orbit Light4
-	static float rotate3 = 0.0f;
-	gLight4->SetPosition(gNormalMapCube->Position() + CVector3{ cos(rotate3) * gLight4Orbit, .0f, sin(rotate3) * gLight4Orbit });
-	rotate3 -= gLight4OrbitSpeed * frameTime;
+	gLight4->SetPosition(gNormalMapCube->Position() + CVector3{ orbitCos[Light4Orbit] * gLight4Orbit, .0f, orbitSin[Light4Orbit] * gLight4Orbit });
+	orbitAngles[Light4Orbit] -= gLight4OrbitSpeed * frameTime;
 
 	// Orbit Light5
-	static float rotate4 = 0.0f;
-	gLight5->SetPosition(gTroll->Position() + CVector3{ cos(rotate4) * gLight5Orbit, 5.0f, sin(rotate4) * gLight5Orbit });
-	rotate4 -= gLight5OrbitSpeed * frameTime;
+	gLight5->SetPosition(gTroll->Position() + CVector3{ orbitCos[Light5Orbit] * gLight5Orbit, 5.0f, orbitSin[Light5Orbit] * gLight5Orbit });
+	orbitAngles[Light5Orbit] -= gLight5OrbitSpeed * frameTime;
 
 	// Move portal
-	static float rotate5 = 0.0f;
-	gPortal->SetPosition(gTwoTextureCube->Position() + CVector3{ cos(rotate5) * 80.0f, 40.0f, sin(rotate5) * 80.0f });
+	gPortal->SetPosition(gTwoTextureCube->Position() + CVector3{ orbitCos[PortalOrbit] * 80.0f, 40.0f, orbitSin[PortalOrbit] * 80.0f });
 	gPortal->FaceTarget(gTwoTextureCube->Position()); // Face target function. Makes the portal face the cube at all times while moving
 	gPortalCamera->SetPosition(gPortal->Position());
 	gPortalCamera->FaceTarget(gTwoTextureCube->Position());
-	rotate5 -= gPortalRotateMultipler * frameTime;
+	orbitAngles[PortalOrbit] -= gPortalRotateMultipler * frameTime;
+
+	// Keep the orbit angles in a small range, they would otherwise grow forever and lose precision
+	for (int orbit = 0; orbit < NumOrbits; ++orbit)
+	{
+		if (orbitAngles[orbit] < -2 * PI)  orbitAngles[orbit] += 2 * PI;
+	}
 
 	// Control camera (will update its view matrix)
 	gCamera->Control(frameTime, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D);
 
+	// Pick the model under the mouse
+	if (KeyHit(Mouse_LButton))
+	{
+		gHasPick = PickScene(GetMouseX(), GetMouseY(), gPick);
+	}
+
 	// Show frame time / FPS in the window title //
 	const float fpsUpdateTime = 0.5f; // How long between updates (in seconds)
 	static float totalFrameTime = 0;
@@ -932,9 +1001,49 @@ void UpdateScene(float frameTime)
 		frameTimeMs.precision(2);
 		frameTimeMs << std::fixed << avgFrameTime * 1000;
 		std::string windowTitle = "CO2409 Assignment 1: Shaders - Mark Ince - Frame Time: " + frameTimeMs.str() +
-			"ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f));
+			"ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f)) +
+			", Triangles: " + std::to_string(gTrianglesDrawn);
+		if (gHasPick)
+		{
+			windowTitle += ", Picked: " + std::string(gPick.name) + " (triangle " + std::to_string(gPick.hit.triangle) + ")";
+		}
 		SetWindowTextA(gHWnd, windowTitle.c_str());
 		totalFrameTime = 0;
 		frameCount = 0;
 	}
 }
+
+
+//--------------------------------------------------------------------------------------
+// Scene Ray Queries
+//--------------------------------------------------------------------------------------
+
+// Find the closest model hit by a world space ray, see Scene.h
+bool RayQueryScene(const CVector3& origin, const CVector3& direction, float maxDistance, ScenePick& pick)
+{
+	// Each model only looks for hits closer than the closest so far
+	bool found = false;
+	for (const PickableModel& pickable : PICKABLE_MODELS)
+	{
+		RayHit hit;
+		if ((*pickable.model)->Intersect(origin, direction, maxDistance, hit))
+		{
+			maxDistance   = hit.distance;
+			pick.model    = *pickable.model;
+			pick.name     = pickable.name;
+			pick.hit      = hit;
+			pick.position = origin + direction * hit.distance;
+			found = true;
+		}
+	}
+	return found;
+}
+
+
+// Find the closest model hit by the ray from the main camera through a pixel of the viewport
+bool PickScene(int x, int y, ScenePick& pick)
+{
+	CVector3 origin, direction;
+	gCamera->ScreenRay(x + 0.5f, y + 0.5f, static_cast<float>(gViewportWidth), static_cast<float>(gViewportHeight), origin, direction);
+	return RayQueryScene(origin, direction, 1, pick);
+}
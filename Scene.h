@@ -6,6 +6,9 @@
 #ifndef _SCENE_H_INCLUDED_
 #define _SCENE_H_INCLUDED_
 
+#include "Model.h"
+#include "MeshBVH.h"
+
 //--------------------------------------------------------------------------------------
 // Scene Geometry and Layout
 //--------------------------------------------------------------------------------------
@@ -32,6 +35,27 @@ void RenderScene();
 void UpdateScene(float frameTime);
 
 
+//--------------------------------------------------------------------------------------
+// Scene Ray Queries
+//--------------------------------------------------------------------------------------
+
+// The closest model hit by a ray, the triangle of its mesh and where it was hit
+struct ScenePick
+{
+	Model*      model;
+	const char* name;     // Name of the model in the scene, e.g. "Teapot"
+	RayHit      hit;      // Distance along the ray, triangle and barycentric coordinates (see MeshBVH.h)
+	CVector3    position; // World space
+};
+
+// Find the closest model hit by the world space ray origin + t * direction with t from 0 to maxDistance. Only
+// models whose meshes were loaded with ray queries can be hit (not the lights). Returns false if nothing is hit
+bool RayQueryScene(const CVector3& origin, const CVector3& direction, float maxDistance, ScenePick& pick);
+
+// As above for the ray from the main camera through a pixel of the viewport (e.g. the mouse position)
+bool PickScene(int x, int y, ScenePick& pick);
+
+
 // Enums
 enum valueChange { UP, DOWN };
 enum camera {POS1, POS2, POS3, POS4 };
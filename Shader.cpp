@@ -38,6 +38,8 @@ ID3D11PixelShader*  gCellShadingOutlinePixelShader = nullptr;
 ID3D11VertexShader* gCellShadingVertexShader = nullptr;
 ID3D11PixelShader*  gCellShadingPixelShader = nullptr;
 
+ID3D11VertexShader*  gDepthOnlyVertexShader       = nullptr; // No pixel shader, depth-only passes write no colour
+
 //--------------------------------------------------------------------------------------
 // Shader creation / destruction
 //--------------------------------------------------------------------------------------
@@ -64,6 +66,7 @@ bool LoadShaders()
 	gCellShadingOutlinePixelShader = LoadPixelShader("CellShadingOutline_ps");
 	gCellShadingVertexShader = LoadVertexShader("CellShading_vs");
 	gCellShadingPixelShader = LoadPixelShader("CellShading_ps");
+	gDepthOnlyVertexShader         = LoadVertexShader("DepthOnly_vs");
 
 
 
@@ -74,7 +77,8 @@ bool LoadShaders()
 		gAlphaVertexShader           == nullptr || gAlphaPixelShader              == nullptr ||
 		gNormalMappingVertexShader   == nullptr || gNormalMappingPixelShader      == nullptr ||
 		gCellShadingOutlineVertexShader == nullptr || gCellShadingOutlinePixelShader == nullptr ||
-		gCellShadingVertexShader == nullptr || gCellShadingPixelShader == nullptr)
+		gCellShadingVertexShader == nullptr || gCellShadingPixelShader == nullptr ||
+		gDepthOnlyVertexShader       == nullptr)
 
     {
         gLastError = "Error loading shaders";
@@ -103,6 +107,7 @@ void ReleaseShaders()
 	if (gCellShadingPixelShader)          gCellShadingPixelShader->Release();
 	if (gCellShadingOutlineVertexShader)  gCellShadingOutlineVertexShader->Release();
 	if (gCellShadingOutlinePixelShader)   gCellShadingOutlinePixelShader->Release();
+	if (gDepthOnlyVertexShader)         gDepthOnlyVertexShader->Release();
 
 }
 
@@ -191,6 +196,9 @@ ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLa
         else if (format == DXGI_FORMAT_R32G32B32_FLOAT)    shaderSource += "float3";
         else if (format == DXGI_FORMAT_R32G32_FLOAT)       shaderSource += "float2";
         else if (format == DXGI_FORMAT_R32_FLOAT)          shaderSource += "float";
+        else if (format == DXGI_FORMAT_R16G16B16A16_UNORM) shaderSource += "float4";
+        else if (format == DXGI_FORMAT_R16G16_SNORM)       shaderSource += "float2";
+        else if (format == DXGI_FORMAT_R16G16_FLOAT)       shaderSource += "float2";
         else return nullptr; // Unsupported type in layout
 
         uint8_t index = static_cast<uint8_t>(vertexLayout[elt].SemanticIndex);
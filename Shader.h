@@ -31,6 +31,7 @@ extern ID3D11VertexShader* gCellShadingOutlineVertexShader;
 extern ID3D11PixelShader*  gCellShadingOutlinePixelShader;
 extern ID3D11VertexShader* gCellShadingVertexShader;
 extern ID3D11PixelShader*  gCellShadingPixelShader;
+extern ID3D11VertexShader* gDepthOnlyVertexShader;
 
 
 
@@ -43,14 +43,5 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 CMatrix4x4 MakeProjectionMatrix(float aspectRatio /*= 4.0f / 3.0f*/, float FOVx /*= ToRadians(60)*/,
                                 float nearClip /*= 0.1f*/, float farClip /*= 10000.0f*/)
 {
-    float tanFOVx = std::tan(FOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = aspectRatio / tanFOVx;
-    float scaleZa = farClip / (farClip - nearClip);
-    float scaleZb = -nearClip * scaleZa;
-
-    return CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
-                         0.0f, scaleY,    0.0f,   0.0f,
-                         0.0f,   0.0f, scaleZa,   1.0f,
-                         0.0f,   0.0f, scaleZb,   0.0f };
+    return MatrixProjection(aspectRatio, FOVx, nearClip, farClip);
 }
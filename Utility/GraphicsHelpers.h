@@ -49,6 +49,7 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 // - Aspect ratio is screen width / height (like 4:3, 16:9)
 // - FOVx is the viewing angle from left->right (high values give a fish-eye look),
 // - near and far clip are the range of z distances that can be rendered
+// Use ConstexprMatrixProjection (CMatrix4x4.h) for a projection matrix calculated at compile time
 CMatrix4x4 MakeProjectionMatrix(float aspectRatio = 4.0f / 3.0f, float FOVx = ToRadians(60),
                                 float nearClip = 0.1f, float farClip = 10000.0f);
 
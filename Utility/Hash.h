@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------
+// 64-bit hash of a block of memory
+//--------------------------------------------------------------------------------------
+// Used to identify data, e.g. the source file a cooked mesh was made from (see CookedMesh.h). Not a
+// cryptographic hash. Reads 32 bytes at a time, so hashing a file costs far less than reading it from disk.
+// Results depend on byte order, they are only compared on the machine that made them
+
+#ifndef _HASH_H_INCLUDED_
+#define _HASH_H_INCLUDED_
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+// Mix the bits of a 64-bit value so every input bit affects every output bit
+inline uint64_t HashMix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Hash size bytes of data. Pass the result of a previous call as seed to hash several blocks in turn
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+{
+    const uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    uint64_t h = seed ^ (size * multiplier);
+
+    // Large blocks are hashed as four independent streams of words, so the multiplies overlap in the CPU
+    if (size >= 32)
+    {
+        uint64_t lanes[4] = { h, h + 1, h + 2, h + 3 };
+        while (size >= 32)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                uint64_t word;
+                std::memcpy(&word, bytes + i * 8, 8); // memcpy as data may not be aligned, compiles to a single load
+                lanes[i] = (lanes[i] ^ HashMix(word)) * multiplier;
+            }
+            bytes += 32;
+            size  -= 32;
+        }
+        h = HashMix(lanes[0]) ^ (HashMix(lanes[1]) * 3) ^ (HashMix(lanes[2]) * 5) ^ (HashMix(lanes[3]) * 7);
+    }
+
+    while (size >= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        h = (h ^ HashMix(word)) * multiplier;
+        bytes += 8;
+        size  -= 8;
+    }
+
+    uint64_t last = 0;
+    std::memcpy(&last, bytes, size);
+    h = (h ^ HashMix(last)) * multiplier;
+
+    return HashMix(h);
+}
+
+// Hash a single value (an integer, float or plain structure)
+template <typename T>
+inline uint64_t HashValue(const T& value, uint64_t seed = 0)
+{
+    return HashBytes(&value, sizeof(T), seed);
+}
+
+
+#endif //_HASH_H_INCLUDED_
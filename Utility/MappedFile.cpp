@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//--------------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+#include "Hash.h"
+
+#include <cstdint>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+// Map the given file, closing any file currently mapped. Returns false if the file can't be opened or
+// is empty (an empty file can't be mapped)
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)  return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFile    = file;
+    mMapping = mapping;
+    mData    = static_cast<const unsigned char*>(data);
+    mSize    = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+// Unmap the file, any pointers into it become invalid
+void MappedFile::Close()
+{
+    if (mData)     UnmapViewOfFile(mData);
+    if (mMapping)  CloseHandle(mMapping);
+    if (mFile)     CloseHandle(mFile);
+    mData    = nullptr;
+    mSize    = 0;
+    mMapping = nullptr;
+    mFile    = nullptr;
+}
+
+// Tell the OS the given range of the file won't be needed again soon. Unlocking pages that aren't locked
+// removes them from the working set
+void MappedFile::Release(size_t offset, size_t size) const
+{
+    if (mData == nullptr || offset >= mSize)  return;
+    if (size > mSize - offset)  size = mSize - offset;
+    VirtualUnlock(const_cast<unsigned char*>(mData) + offset, size);
+}
+
+#else
+
+// Map the given file, closing any file currently mapped. Returns false if the file can't be opened or
+// is empty (an empty file can't be mapped)
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0)  return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size <= 0)
+    {
+        close(file);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file so the descriptor can be closed straight away
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)  return false;
+
+    mData = static_cast<const unsigned char*>(data);
+    mSize = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+// Unmap the file, any pointers into it become invalid
+void MappedFile::Close()
+{
+    if (mData)  munmap(const_cast<unsigned char*>(mData), mSize);
+    mData = nullptr;
+    mSize = 0;
+}
+
+// Tell the OS the given range of the file won't be needed again soon. Only whole pages inside the range are
+// dropped, the mapping is private and read-only so they are read back from the file if touched again
+void MappedFile::Release(size_t offset, size_t size) const
+{
+    if (mData == nullptr || offset >= mSize)  return;
+    if (size > mSize - offset)  size = mSize - offset;
+
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t start = reinterpret_cast<uintptr_t>(mData) + offset;
+    uintptr_t end   = start + size;
+    start = (start + pageSize - 1) & ~(pageSize - 1);
+    end   = end & ~(pageSize - 1);
+    if (end > start)  madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED);
+}
+
+#endif
+
+
+// Hash the contents of a mapped file a block at a time, releasing each block once it is hashed
+uint64_t HashMappedFile(const MappedFile& file)
+{
+    const size_t BLOCK_SIZE = 16 << 20;
+    uint64_t hash = 0;
+    for (size_t offset = 0; offset < file.Size(); offset += BLOCK_SIZE)
+    {
+        size_t size = (file.Size() - offset < BLOCK_SIZE) ? file.Size() - offset : BLOCK_SIZE;
+        hash = HashBytes(file.Data() + offset, size, hash);
+        file.Release(offset, size);
+    }
+    return hash;
+}
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Maps a whole file into the address space so its contents can be used directly as a block of memory. Pages
+// are read from disk (or the OS file cache) when first touched, so opening a large file is almost free and
+// nothing is copied. Uses CreateFileMapping on Windows and mmap elsewhere.
+
+#ifndef _MAPPED_FILE_H_INCLUDED_
+#define _MAPPED_FILE_H_INCLUDED_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile()  { Close(); }
+
+    // Map the given file, closing any file currently mapped. Returns false if the file can't be opened or
+    // is empty (an empty file can't be mapped)
+    bool Open(const std::string& fileName);
+
+    // Unmap the file, any pointers into it become invalid
+    void Close();
+
+    bool                 IsOpen() const  { return mData != nullptr; }
+    const unsigned char* Data()   const  { return mData; }
+    size_t               Size()   const  { return mSize; }
+
+    // Tell the OS the given range of the file won't be needed again soon, so its pages can leave the process's
+    // memory (resident set / working set) now rather than when memory runs short. The data stays readable,
+    // touching it again reads it back from the file. For reading files larger than the memory wanted for them
+    void Release(size_t offset, size_t size) const;
+
+    // Not copyable, the mapping belongs to one object
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+
+private:
+    const unsigned char* mData = nullptr;
+    size_t               mSize = 0;
+
+#ifdef _WIN32
+    void*                mFile    = nullptr; // HANDLEs, kept as void* to keep Windows.h out of this header
+    void*                mMapping = nullptr;
+#endif
+};
+
+
+
+// Hash the contents of a mapped file (see Hash.h) a block at a time, releasing each block once it is hashed so
+// hashing a very large file doesn't fill memory with it. Used for the source file key of cooked meshes
+uint64_t HashMappedFile(const MappedFile& file);
+
+
+#endif //_MAPPED_FILE_H_INCLUDED_
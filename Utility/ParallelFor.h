@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------
+// Splitting a loop across the CPU cores
+//--------------------------------------------------------------------------------------
+// ParallelFor(count, numThreads, fn) calls fn(begin, end) for ranges of items covering 0 to count, one range
+// per thread with the calling thread doing the first. Threads are started for each call rather than kept
+// in a pool, which costs some tens of microseconds, so this is for work on whole meshes at load time, not
+// per frame. The ranges only depend on count and the number of threads, so code that writes each item's
+// result from within its own range gives the same output however many threads are used.
+
+#ifndef _PARALLEL_FOR_H_INCLUDED_
+#define _PARALLEL_FOR_H_INCLUDED_
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+
+// Number of threads to use for a requested count, 0 meaning one for each core
+inline unsigned int ParallelThreads(unsigned int numThreads = 0)
+{
+    if (numThreads == 0)  numThreads = std::thread::hardware_concurrency();
+    return std::max(numThreads, 1u);
+}
+
+
+// Call fn(begin, end) on ranges of 0 to count, see comment at top of file. Each thread is given at least
+// minPerThread items (so small loops run on the calling thread alone). fn must not throw
+template <typename Fn>
+void ParallelFor(uint32_t count, unsigned int numThreads, Fn fn, uint32_t minPerThread = 4096)
+{
+    numThreads = std::min(ParallelThreads(numThreads), std::max(count / std::max(minPerThread, 1u), 1u));
+    if (numThreads == 1)
+    {
+        fn(0u, count);
+        return;
+    }
+
+    auto rangeStart = [&](unsigned int thread) { return static_cast<uint32_t>(static_cast<uint64_t>(count) * thread / numThreads); };
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (unsigned int thread = 1; thread < numThreads; ++thread)
+    {
+        threads.emplace_back(fn, rangeStart(thread), rangeStart(thread + 1));
+    }
+    fn(0u, rangeStart(1));
+    for (std::thread& thread : threads)  thread.join();
+}
+
+
+#endif //_PARALLEL_FOR_H_INCLUDED_
@@ -0,0 +1,330 @@
+//--------------------------------------------------------------------------------------
+// Size and format of texture files without loading them
+//--------------------------------------------------------------------------------------
+
+#include "TextureInfo.h"
+
+#include <cstring>
+
+
+namespace
+{
+    /*-----------------------------------------------------------------------------------------
+        Formats
+    -----------------------------------------------------------------------------------------*/
+
+    // The DXGI_FORMAT values the loaders can create (values from dxgiformat.h)
+    struct FormatDesc
+    {
+        uint32_t    format;
+        const char* name;
+        uint32_t    bits;       // Per pixel
+        uint32_t    blockBytes; // Bytes per 4x4 block for block compressed formats, 0 for others
+    };
+
+    const FormatDesc FORMATS[] =
+    {
+        {   2, "R32G32B32A32_FLOAT",   128,  0 },
+        {   6, "R32G32B32_FLOAT",       96,  0 },
+        {  10, "R16G16B16A16_FLOAT",    64,  0 },
+        {  11, "R16G16B16A16_UNORM",    64,  0 },
+        {  13, "R16G16B16A16_SNORM",    64,  0 },
+        {  16, "R32G32_FLOAT",          64,  0 },
+        {  24, "R10G10B10A2_UNORM",     32,  0 },
+        {  28, "R8G8B8A8_UNORM",        32,  0 },
+        {  29, "R8G8B8A8_UNORM_SRGB",   32,  0 },
+        {  31, "R8G8B8A8_SNORM",        32,  0 },
+        {  34, "R16G16_FLOAT",          32,  0 },
+        {  35, "R16G16_UNORM",          32,  0 },
+        {  37, "R16G16_SNORM",          32,  0 },
+        {  41, "R32_FLOAT",             32,  0 },
+        {  49, "R8G8_UNORM",            16,  0 },
+        {  51, "R8G8_SNORM",            16,  0 },
+        {  54, "R16_FLOAT",             16,  0 },
+        {  56, "R16_UNORM",             16,  0 },
+        {  61, "R8_UNORM",               8,  0 },
+        {  65, "A8_UNORM",               8,  0 },
+        {  71, "BC1_UNORM",              4,  8 },
+        {  72, "BC1_UNORM_SRGB",         4,  8 },
+        {  74, "BC2_UNORM",              8, 16 },
+        {  75, "BC2_UNORM_SRGB",         8, 16 },
+        {  77, "BC3_UNORM",              8, 16 },
+        {  78, "BC3_UNORM_SRGB",         8, 16 },
+        {  80, "BC4_UNORM",              4,  8 },
+        {  81, "BC4_SNORM",              4,  8 },
+        {  83, "BC5_UNORM",              8, 16 },
+        {  84, "BC5_SNORM",              8, 16 },
+        {  85, "B5G6R5_UNORM",          16,  0 },
+        {  86, "B5G5R5A1_UNORM",        16,  0 },
+        {  87, "B8G8R8A8_UNORM",        32,  0 },
+        {  88, "B8G8R8X8_UNORM",        32,  0 },
+        {  91, "B8G8R8A8_UNORM_SRGB",   32,  0 },
+        {  93, "B8G8R8X8_UNORM_SRGB",   32,  0 },
+        {  95, "BC6H_UF16",              8, 16 },
+        {  96, "BC6H_SF16",              8, 16 },
+        {  98, "BC7_UNORM",              8, 16 },
+        {  99, "BC7_UNORM_SRGB",         8, 16 },
+        { 115, "B4G4R4A4_UNORM",        16,  0 },
+    };
+
+    const FormatDesc* FindFormat(uint32_t format)
+    {
+        for (const FormatDesc& desc : FORMATS)
+        {
+            if (desc.format == format)  return &desc;
+        }
+        return nullptr;
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Reading headers
+    -----------------------------------------------------------------------------------------*/
+
+    uint32_t ReadLE32(const unsigned char* p)  { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+    uint32_t ReadBE32(const unsigned char* p)  { return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+    uint32_t ReadBE16(const unsigned char* p)  { return (p[0] << 8) | p[1]; }
+
+    uint32_t FourCC(const char* text)  { return ReadLE32(reinterpret_cast<const unsigned char*>(text)); }
+
+    // Number of mip levels in a full chain down to 1x1
+    uint32_t FullMipChain(uint32_t width, uint32_t height)
+    {
+        uint32_t size = (width > height) ? width : height;
+        uint32_t levels = 1;
+        while (size > 1)
+        {
+            size /= 2;
+            ++levels;
+        }
+        return levels;
+    }
+
+
+    // DXGI format of a DDS file without a DX10 header, from its pixel format, in the same way as the DDS
+    // loader in DirectXTK (its GetDXGIFormat). 0 if the loader doesn't support it (e.g. 24-bit RGB)
+    uint32_t LegacyDDSFormat(const unsigned char* pixelFormat)
+    {
+        const uint32_t DDPF_ALPHA = 0x2, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40, DDPF_LUMINANCE = 0x20000, DDPF_BUMPDUDV = 0x80000;
+
+        uint32_t flags    = ReadLE32(pixelFormat + 4);
+        uint32_t fourCC   = ReadLE32(pixelFormat + 8);
+        uint32_t bitCount = ReadLE32(pixelFormat + 12);
+        uint32_t r = ReadLE32(pixelFormat + 16), g = ReadLE32(pixelFormat + 20);
+        uint32_t b = ReadLE32(pixelFormat + 24), a = ReadLE32(pixelFormat + 28);
+
+        if (flags & DDPF_RGB)
+        {
+            if (bitCount == 32)
+            {
+                if (r == 0x000000ff && g == 0x0000ff00 && b == 0x00ff0000 && a == 0xff000000)  return 28; // R8G8B8A8
+                if (r == 0x00ff0000 && g == 0x0000ff00 && b == 0x000000ff && a == 0xff000000)  return 87; // B8G8R8A8
+                if (r == 0x00ff0000 && g == 0x0000ff00 && b == 0x000000ff && a == 0)           return 88; // B8G8R8X8
+                if (r == 0x3ff00000 && g == 0x000ffc00 && b == 0x000003ff && a == 0xc0000000)  return 24; // R10G10B10A2, stored reversed by old tools
+                if (r == 0x0000ffff && g == 0xffff0000 && b == 0 && a == 0)                    return 35; // R16G16
+                if (r == 0xffffffff && g == 0 && b == 0 && a == 0)                             return 41; // R32_FLOAT
+            }
+            else if (bitCount == 16)
+            {
+                if (r == 0x7c00 && g == 0x03e0 && b == 0x001f && a == 0x8000)  return 86; // B5G5R5A1
+                if (r == 0xf800 && g == 0x07e0 && b == 0x001f && a == 0)       return 85; // B5G6R5
+                if (r == 0x0f00 && g == 0x00f0 && b == 0x000f && a == 0xf000)  return 115; // B4G4R4A4
+            }
+        }
+        else if (flags & DDPF_LUMINANCE)
+        {
+            if (bitCount == 8  && r == 0xff)                 return 61; // R8
+            if (bitCount == 16 && r == 0xffff)               return 56; // R16
+            if (bitCount == 16 && r == 0xff && a == 0xff00)  return 49; // R8G8
+        }
+        else if (flags & DDPF_ALPHA)
+        {
+            if (bitCount == 8)  return 65; // A8
+        }
+        else if (flags & DDPF_BUMPDUDV)
+        {
+            if (bitCount == 16 && r == 0x00ff && g == 0xff00)                                      return 51; // R8G8_SNORM
+            if (bitCount == 32 && r == 0x000000ff && g == 0x0000ff00 && b == 0x00ff0000)           return 31; // R8G8B8A8_SNORM
+            if (bitCount == 32 && r == 0x0000ffff && g == 0xffff0000)                              return 37; // R16G16_SNORM
+        }
+        else if (flags & DDPF_FOURCC)
+        {
+            if (fourCC == FourCC("DXT1"))                               return 71;
+            if (fourCC == FourCC("DXT2") || fourCC == FourCC("DXT3"))  return 74;
+            if (fourCC == FourCC("DXT4") || fourCC == FourCC("DXT5"))  return 77;
+            if (fourCC == FourCC("ATI1") || fourCC == FourCC("BC4U"))  return 80;
+            if (fourCC == FourCC("BC4S"))                               return 81;
+            if (fourCC == FourCC("ATI2") || fourCC == FourCC("BC5U"))  return 83;
+            if (fourCC == FourCC("BC5S"))                               return 84;
+
+            // D3DFORMAT values stored as the FourCC
+            switch (fourCC)
+            {
+                case 36:  return 11; // A16B16G16R16
+                case 110: return 13; // Q16W16V16U16
+                case 111: return 54; // R16F
+                case 112: return 34; // G16R16F
+                case 113: return 10; // A16B16G16R16F
+                case 114: return 41; // R32F
+                case 115: return 16; // G32R32F
+                case 116: return 2;  // A32B32G32R32F
+            }
+        }
+        return 0;
+    }
+
+
+    bool ReadDDSInfo(const unsigned char* data, size_t size, TextureInfo& info)
+    {
+        const size_t HEADER_SIZE = 4 + 124, DX10_HEADER_SIZE = 20;
+        if (size < HEADER_SIZE || ReadLE32(data + 4) != 124)  return false;
+        const unsigned char* header = data + 4;
+
+        const uint32_t DDSD_DEPTH = 0x800000, DDSCAPS2_CUBEMAP = 0x200, DDPF_FOURCC = 0x4;
+        info.container = "DDS";
+        info.height    = ReadLE32(header + 8);
+        info.width     = ReadLE32(header + 12);
+        info.depth     = (ReadLE32(header + 4) & DDSD_DEPTH) ? ReadLE32(header + 20) : 1;
+        info.mipLevels = ReadLE32(header + 24);
+        if (info.mipLevels == 0)  info.mipLevels = 1;
+        if (info.depth     == 0)  info.depth = 1;
+
+        const unsigned char* pixelFormat = header + 72;
+        if ((ReadLE32(pixelFormat + 4) & DDPF_FOURCC) && ReadLE32(pixelFormat + 8) == FourCC("DX10"))
+        {
+            if (size < HEADER_SIZE + DX10_HEADER_SIZE)  return false;
+            const unsigned char* dx10 = data + HEADER_SIZE;
+            const uint32_t RESOURCE_MISC_TEXTURECUBE = 0x4;
+            info.format    = ReadLE32(dx10);
+            info.arraySize = ReadLE32(dx10 + 12);
+            if (info.arraySize == 0)  return false;
+            if (ReadLE32(dx10 + 8) & RESOURCE_MISC_TEXTURECUBE)  info.arraySize *= 6;
+        }
+        else
+        {
+            info.format = LegacyDDSFormat(pixelFormat);
+            if (ReadLE32(header + 108) & DDSCAPS2_CUBEMAP)  info.arraySize = 6;
+        }
+        return info.width > 0 && info.height > 0;
+    }
+
+
+    // The WIC loader converts PNG and JPEG pixels to one of these formats
+    const uint32_t WIC_RGBA8 = 28, WIC_RGBA16 = 11, WIC_R8 = 61, WIC_R16 = 56;
+
+    bool ReadPNGInfo(const unsigned char* data, size_t size, TextureInfo& info)
+    {
+        // Signature, then the IHDR chunk must come first
+        if (size < 8 + 8 + 13 || std::memcmp(data + 12, "IHDR", 4) != 0)  return false;
+        const unsigned char* header = data + 16;
+
+        // Only plain grey stays one channel, grey with alpha and palettes become RGBA like colour
+        const uint32_t GREY = 0;
+        uint32_t bitDepth  = header[8];
+        uint32_t colorType = header[9];
+        info.container = "PNG";
+        info.width     = ReadBE32(header);
+        info.height    = ReadBE32(header + 4);
+        if (colorType == GREY)  info.format = (bitDepth == 16) ? WIC_R16    : WIC_R8;
+        else                    info.format = (bitDepth == 16) ? WIC_RGBA16 : WIC_RGBA8;
+        return info.width > 0 && info.height > 0;
+    }
+
+
+    bool ReadJPEGInfo(const unsigned char* data, size_t size, TextureInfo& info)
+    {
+        // Walk the markers to the start of frame, which holds the size. Every marker before it has a length
+        size_t pos = 2;
+        while (pos + 4 <= size)
+        {
+            if (data[pos] != 0xff)  return false;
+            uint32_t marker = data[pos + 1];
+            if (marker == 0xff)  // Fill byte
+            {
+                ++pos;
+                continue;
+            }
+            uint32_t length = ReadBE16(data + pos + 2);
+            bool startOfFrame = (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc);
+            if (startOfFrame)
+            {
+                if (pos + 2 + 6 > size)  return false;
+                const unsigned char* frame = data + pos + 4;
+                uint32_t components = frame[5];
+                info.container = "JPEG";
+                info.height    = ReadBE16(frame + 1);
+                info.width     = ReadBE16(frame + 3);
+                info.format    = (components == 1) ? WIC_R8 : WIC_RGBA8;
+                return info.width > 0 && info.height > 0;
+            }
+            pos += 2 + length;
+        }
+        return false;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Texture info
+-----------------------------------------------------------------------------------------*/
+
+// Read the header of a texture file already in memory. Returns false if the file isn't a DDS, PNG or JPEG
+// file or its header is damaged
+bool ReadTextureInfo(const void* data, size_t size, TextureInfo& info)
+{
+    info = TextureInfo();
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    bool ok;
+    if      (size >= 4 && std::memcmp(bytes, "DDS ", 4) == 0)             ok = ReadDDSInfo(bytes, size, info);
+    else if (size >= 8 && std::memcmp(bytes, PNG_SIGNATURE, 8) == 0)      ok = ReadPNGInfo(bytes, size, info);
+    else if (size >= 3 && bytes[0] == 0xff && bytes[1] == 0xd8 && bytes[2] == 0xff)  ok = ReadJPEGInfo(bytes, size, info);
+    else                                                                  ok = false;
+    if (!ok)  return false;
+
+    // The WIC loader generates a full mip chain
+    if (std::strcmp(info.container, "DDS") != 0)
+    {
+        info.mipLevels     = FullMipChain(info.width, info.height);
+        info.mipsGenerated = true;
+    }
+    return true;
+}
+
+
+// Name of a DXGI_FORMAT value without the prefix, "UNKNOWN" for formats not listed
+const char* TextureFormatName(uint32_t format)
+{
+    const FormatDesc* desc = FindFormat(format);
+    return (desc != nullptr) ? desc->name : "UNKNOWN";
+}
+
+
+// Bits per pixel of a DXGI_FORMAT value, 0 for formats not listed
+uint32_t TextureFormatBits(uint32_t format)
+{
+    const FormatDesc* desc = FindFormat(format);
+    return (desc != nullptr) ? desc->bits : 0;
+}
+
+
+// Bytes of GPU memory for the texture with all its mip levels, array slices and cube faces
+size_t TextureBytes(const TextureInfo& info)
+{
+    const FormatDesc* desc = FindFormat(info.format);
+    if (desc == nullptr)  return 0;
+
+    size_t bytes = 0;
+    uint32_t width = info.width, height = info.height, depth = info.depth;
+    for (uint32_t level = 0; level < info.mipLevels; ++level)
+    {
+        // Block compressed mips are whole 4x4 blocks, even the 2x2 and 1x1 levels
+        if (desc->blockBytes > 0)  bytes += static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * desc->blockBytes * depth;
+        else                       bytes += static_cast<size_t>(width) * height * depth * desc->bits / 8;
+        if (width  > 1)  width  /= 2;
+        if (height > 1)  height /= 2;
+        if (depth  > 1)  depth  /= 2;
+    }
+    return bytes * info.arraySize;
+}
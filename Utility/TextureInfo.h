@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// Size and format of texture files without loading them
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Reads just the header of a DDS, PNG or JPEG file to find the texture LoadTexture (GraphicsHelpers.h) would
+// create from it: its dimensions, DXGI format and number of mip levels, and so how much GPU memory it takes.
+// Doesn't need Direct3D, so tools can report on textures on any platform (e.g. the asset audit in the
+// Benchmark folder).
+//
+// DDS files are created as stored, with the format and mip levels in the file (the DDS loader isn't given a
+// device context, so never generates mip levels). PNG and JPEG files go through the WIC loader, which
+// converts them to a format the GPU has (greyscale to R8, 16-bit channels to 16-bit formats, everything else
+// to R8G8B8A8) and, as it is given a device context, creates a full chain of mip levels. Formats are given as
+// DXGI_FORMAT values, which are fixed numbers, so this file doesn't need the Windows headers.
+
+#ifndef _TEXTURE_INFO_H_INCLUDED_
+#define _TEXTURE_INFO_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+
+// The GPU texture a texture file becomes
+struct TextureInfo
+{
+    const char* container = "";    // "DDS", "PNG" or "JPEG"
+    uint32_t    width     = 0;
+    uint32_t    height    = 0;
+    uint32_t    depth     = 1;     // More than 1 for volume textures
+    uint32_t    arraySize = 1;     // Number of textures in an array, 6 for each cube map
+    uint32_t    mipLevels = 1;     // Mip levels on the GPU, including any the loader generates
+    bool        mipsGenerated = false; // True if the mip levels are generated when loaded, not stored
+    uint32_t    format    = 0;     // DXGI_FORMAT value, 0 (DXGI_FORMAT_UNKNOWN) if the loader can't create it
+};
+
+
+// Read the header of a texture file already in memory. Returns false if the file isn't a DDS, PNG or JPEG
+// file or its header is damaged. A file in a DDS format the loader doesn't support gives format 0
+bool ReadTextureInfo(const void* data, size_t size, TextureInfo& info);
+
+// Name of a DXGI_FORMAT value without the prefix (e.g. "BC3_UNORM"), "UNKNOWN" for formats not listed
+const char* TextureFormatName(uint32_t format);
+
+// Bits per pixel of a DXGI_FORMAT value (4 or 8 for block compressed formats), 0 for formats not listed
+uint32_t TextureFormatBits(uint32_t format);
+
+// Bytes of GPU memory for the texture with all its mip levels, array slices and cube faces. Ignores any
+// padding the driver adds, so is an estimate. 0 if the format isn't known
+size_t TextureBytes(const TextureInfo& info);
+
+
+#endif //_TEXTURE_INFO_H_INCLUDED_